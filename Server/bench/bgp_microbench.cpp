@@ -0,0 +1,1027 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * \file    bgp_microbench.cpp
+ *
+ * \brief   Google benchmark suite of the BGP decoders and the message bus row encoders
+ * \details Decoders are driven by synthetic UPDATE corpora built at startup, one per address
+ *          family, and optionally by a captured corpus.  The encoder objects are recorded by
+ *          running parseBGP over the synthetic corpora, so the rows match what the collector
+ *          produces.  The row encoders run in a msgBus_kafka that doesn't produce, both in
+ *          the TSV and binary formats; no broker is needed.
+ *
+ *          Options, in addition to the google benchmark options (--benchmark_filter,
+ *          --benchmark_format=json, --benchmark_out=<file>, ...):
+ *
+ *              --corpus=<file>         Captured UPDATEs, either a stream of BGP messages or a
+ *                                      raw BMP stream (route monitoring messages are used)
+ *              --corpus_two_octet_asn  Decode the captured UPDATEs with 2 octet ASNs
+ */
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Config.h"
+#include "Logger.h"
+#include "HashEngine.h"                 // includes md5.h, which has no include guard
+#include "MsgBusInterface.hpp"
+#include "MsgBusImpl_kafka.h"
+#include "BMPReader.h"
+#include "parseBMP.h"
+#include "parseBGP.h"
+#include "UpdateMsg.h"
+#include "MPReachAttr.h"
+#include "ExtCommunity.h"
+#include "EVPN.h"
+#include "MPLinkStateAttr.h"
+
+using namespace std;
+
+#define SYNTH_PREFIXES          100         ///< Prefixes per synthetic UPDATE
+#define SYNTH_AS_PATH_LEN       6           ///< ASNs in the AS_PATH of the synthetic UPDATEs
+#define BMP_PEER_HDR_LEN        42          ///< Length of the BMP per-peer header
+
+static const char *PEER_ADDR = "192.0.2.1";
+static const char *ROUTER_ADDR = "192.0.2.254";
+
+static Logger *logger;
+
+/**
+ * UPDATE corpus, the messages include the BGP header
+ */
+struct Corpus {
+    string          name;
+    vector<string>  msgs;
+    bool            two_octet_asn;
+    uint64_t        bytes;
+};
+
+static vector<Corpus> corpora;
+
+/**
+ * Builder of BGP wire encoded data
+ */
+class Wire {
+public:
+    string  buf;
+
+    Wire &u8(uint8_t v)         { buf.push_back((char)v); return *this; }
+    Wire &u16(uint16_t v)       { u8(v >> 8); return u8(v & 0xff); }
+    Wire &u32(uint32_t v)       { u16(v >> 16); return u16(v & 0xffff); }
+    Wire &bytes(const string &v) { buf.append(v); return *this; }
+
+    Wire &ipv4(const char *addr) {
+        u_char raw[4];
+        inet_pton(AF_INET, addr, raw);
+        buf.append((char *)raw, 4);
+        return *this;
+    }
+
+    Wire &ipv6(const char *addr) {
+        u_char raw[16];
+        inet_pton(AF_INET6, addr, raw);
+        buf.append((char *)raw, 16);
+        return *this;
+    }
+
+    /**
+     * Path attribute, the extended length is used when needed
+     */
+    Wire &attr(uint8_t flags, uint8_t type, const string &value) {
+        if (value.size() > 255) {
+            u8(flags | 0x10).u8(type).u16(value.size());
+        } else
+            u8(flags & ~0x10).u8(type).u8(value.size());
+
+        return bytes(value);
+    }
+
+    /**
+     * BGP-LS TLV
+     */
+    Wire &tlv(uint16_t type, const string &value) {
+        return u16(type).u16(value.size()).bytes(value);
+    }
+};
+
+/**
+ * Build an UPDATE message, including the BGP header
+ */
+static string buildUpdate(const string &withdrawn, const string &attrs, const string &nlri) {
+    Wire msg;
+
+    msg.bytes(string(16, (char)0xff));
+    msg.u16(19 + 2 + withdrawn.size() + 2 + attrs.size() + nlri.size());
+    msg.u8(parseBGP::BGP_MSG_UPDATE);
+    msg.u16(withdrawn.size()).bytes(withdrawn);
+    msg.u16(attrs.size()).bytes(attrs);
+    msg.bytes(nlri);
+
+    return msg.buf;
+}
+
+/**
+ * ORIGIN, AS_PATH, MED, LOCAL_PREF and COMMUNITIES; NEXT_HOP if next_hop is set
+ */
+static string baseAttrs(int as_path_len, const char *next_hop) {
+    Wire attrs, as_path, v;
+
+    attrs.attr(0x40, 1, string(1, 0));
+
+    as_path.u8(2).u8(as_path_len);                  // AS_SEQUENCE
+    for (int i = 0; i < as_path_len; i++)
+        as_path.u32(64496 + i * 7);
+    attrs.attr(0x40, 2, as_path.buf);
+
+    if (next_hop != NULL) {
+        v.ipv4(next_hop);
+        attrs.attr(0x40, 3, v.buf);
+    }
+
+    v.buf.clear();
+    attrs.attr(0x80, 4, v.u32(100).buf);
+
+    v.buf.clear();
+    attrs.attr(0x40, 5, v.u32(200).buf);
+
+    v.buf.clear();
+    v.u32(64496U << 16 | 100).u32(64496U << 16 | 200).u32(64497U << 16 | 300).u32(0xFFFFFF01);
+    attrs.attr(0xc0, 8, v.buf);
+
+    return attrs.buf;
+}
+
+/**
+ * MP_REACH_NLRI attribute
+ */
+static string mpReach(uint16_t afi, uint8_t safi, const string &next_hop, const string &nlri) {
+    Wire value, attr;
+
+    value.u16(afi).u8(safi).u8(next_hop.size()).bytes(next_hop).u8(0).bytes(nlri);
+    attr.attr(0x80, 14, value.buf);
+
+    return attr.buf;
+}
+
+/**
+ * IPv4 /24 prefixes, with MPLS labels and RD if set
+ */
+static string ipv4Prefixes(int count, bool label, bool rd) {
+    Wire nlri;
+
+    for (int i = 0; i < count; i++) {
+        nlri.u8(24 + (label ? 24 : 0) + (rd ? 64 : 0));
+
+        if (label)
+            nlri.u8((16000 + i) >> 12).u8(((16000 + i) >> 4) & 0xff).u8((((16000 + i) & 0xf) << 4) | 1);
+
+        if (rd)
+            nlri.u16(0).u16(64496).u32(100 + i % 4);
+
+        nlri.u8(10).u8((i >> 8) & 0xff).u8(i & 0xff);
+    }
+
+    return nlri.buf;
+}
+
+/**
+ * IPv6 /48 prefixes
+ */
+static string ipv6Prefixes(int count) {
+    Wire nlri;
+
+    for (int i = 0; i < count; i++)
+        nlri.u8(48).u16(0x2001).u16(0x0db8).u16(i);
+
+    return nlri.buf;
+}
+
+/**
+ * EVPN MAC/IP advertisement routes, with an IPv4 address and one label
+ */
+static string evpnRoutes(int count) {
+    Wire nlri;
+
+    for (int i = 0; i < count; i++) {
+        nlri.u8(2).u8(37);
+        nlri.u16(1).ipv4("192.0.2.1").u16(100);                         // RD type 1
+        nlri.bytes(string(10, 0));                                      // ESI
+        nlri.u32(i % 16);                                               // Ethernet tag
+        nlri.u8(48).u16(0x0200).u32(i);                                 // MAC
+        nlri.u8(32).u8(10).u8(1).u8((i >> 8) & 0xff).u8(i & 0xff);      // IP
+        nlri.u8(0).u8(0x10 + (i >> 12)).u8(((i & 0xff) << 4) | 1);      // Label
+    }
+
+    return nlri.buf;
+}
+
+/**
+ * BGP-LS local or remote node descriptor of an OSPF router
+ */
+static string lsNodeDescr(uint16_t type, uint32_t router_id) {
+    Wire sub, v;
+
+    sub.tlv(512, v.u32(64496).buf);                 // AS
+    v.buf.clear();
+    sub.tlv(513, v.u32(0).buf);                     // BGP-LS ID
+    v.buf.clear();
+    sub.tlv(515, v.u32(router_id).buf);             // IGP router ID
+
+    Wire descr;
+    return descr.tlv(type, sub.buf).buf;
+}
+
+/**
+ * BGP-LS node, link or prefix NLRIs of OSPFv2
+ */
+static string lsNlris(int nlri_type, int count) {
+    Wire nlri;
+
+    for (int i = 0; i < count; i++) {
+        Wire value, v;
+
+        value.u8(3).u32(0).u32(0);                                      // OSPFv2, instance ID 0
+        value.bytes(lsNodeDescr(256, 0x0a000001 + i));
+
+        if (nlri_type == 2) {
+            value.bytes(lsNodeDescr(257, 0x0a000002 + i));
+            value.tlv(258, v.u32(i + 1).u32(i + 2).buf);                // Link IDs
+            v.buf.clear();
+            value.tlv(259, v.u32(0xac100000 + i * 4 + 1).buf);         // Interface address
+            v.buf.clear();
+            value.tlv(260, v.u32(0xac100000 + i * 4 + 2).buf);         // Neighbor address
+
+        } else if (nlri_type == 3) {
+            value.tlv(265, v.u8(24).u8(10).u8((i >> 8) & 0xff).u8(i & 0xff).buf);
+        }
+
+        nlri.u16(nlri_type).u16(value.buf.size()).bytes(value.buf);
+    }
+
+    return nlri.buf;
+}
+
+/**
+ * BGP-LS attribute of the node, link or prefix NLRIs
+ */
+static string lsAttrData(int nlri_type) {
+    Wire attr, v;
+
+    switch (nlri_type) {
+        case 1:
+            attr.tlv(1026, "router-1.example.net");                     // Node name
+            attr.tlv(1028, v.u32(0x0a000001).buf);                      // IPv4 router ID
+            break;
+
+        case 2:
+            attr.tlv(1028, v.u32(0x0a000001).buf);                      // IPv4 router ID local
+            v.buf.clear();
+            attr.tlv(1030, v.u32(0x0a000002).buf);                      // IPv4 router ID remote
+            v.buf.clear();
+            attr.tlv(1089, v.u32(0x4cbebc20).buf);                      // Max link bandwidth, 100Mbytes/sec
+            v.buf.clear();
+            attr.tlv(1090, v.u32(0x4cbebc20).buf);                      // Max reservable bandwidth
+            v.buf.clear();
+            attr.tlv(1092, v.u32(10).buf);                              // TE default metric
+            v.buf.clear();
+            attr.tlv(1095, v.u8(0).u8(0).u8(10).buf);                   // IGP metric
+            break;
+
+        default:
+            attr.tlv(1155, v.u32(20).buf);                              // Prefix metric
+            break;
+    }
+
+    return attr.buf;
+}
+
+/**
+ * UPDATE of BGP-LS NLRIs with their BGP-LS attribute
+ */
+static string lsUpdate(int nlri_type, int count) {
+    Wire nh, ls_attr;
+
+    nh.ipv4("192.0.2.1");
+    ls_attr.attr(0x80, 29, lsAttrData(nlri_type));
+
+    return buildUpdate("", baseAttrs(SYNTH_AS_PATH_LEN, NULL) + ls_attr.buf +
+                               mpReach(bgp::BGP_AFI_BGPLS, bgp::BGP_SAFI_BGPLS, nh.buf, lsNlris(nlri_type, count)),
+                       "");
+}
+
+/**
+ * Add a corpus
+ */
+static void addCorpus(const string &name, const vector<string> &msgs, bool two_octet_asn=false) {
+    Corpus c;
+
+    c.name = name;
+    c.msgs = msgs;
+    c.two_octet_asn = two_octet_asn;
+    c.bytes = 0;
+
+    for (size_t i = 0; i < msgs.size(); i++)
+        c.bytes += msgs[i].size();
+
+    corpora.push_back(c);
+}
+
+/**
+ * Build the synthetic corpora, one UPDATE per corpus
+ */
+static void buildSyntheticCorpora() {
+    Wire nh;
+
+    addCorpus("ipv4_unicast", vector<string>(1, buildUpdate("", baseAttrs(SYNTH_AS_PATH_LEN, "192.0.2.1"),
+                                                            ipv4Prefixes(SYNTH_PREFIXES, false, false))));
+
+    addCorpus("ipv4_withdraw", vector<string>(1, buildUpdate(ipv4Prefixes(SYNTH_PREFIXES, false, false), "", "")));
+
+    nh.ipv6("2001:db8::1").ipv6("fe80::1");
+    addCorpus("ipv6_unicast", vector<string>(1, buildUpdate("", baseAttrs(SYNTH_AS_PATH_LEN, NULL) +
+                                    mpReach(bgp::BGP_AFI_IPV6, bgp::BGP_SAFI_UNICAST, nh.buf, ipv6Prefixes(SYNTH_PREFIXES)), "")));
+
+    nh.buf.clear();
+    nh.ipv4("192.0.2.1");
+    addCorpus("ipv4_labeled", vector<string>(1, buildUpdate("", baseAttrs(SYNTH_AS_PATH_LEN, NULL) +
+                                    mpReach(bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_NLRI_LABEL, nh.buf,
+                                            ipv4Prefixes(SYNTH_PREFIXES, true, false)), "")));
+
+    nh.buf.clear();
+    nh.u32(0).u32(0).ipv4("192.0.2.1");
+    addCorpus("vpnv4", vector<string>(1, buildUpdate("", baseAttrs(SYNTH_AS_PATH_LEN, NULL) +
+                                    mpReach(bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_MPLS, nh.buf,
+                                            ipv4Prefixes(SYNTH_PREFIXES, true, true)), "")));
+
+    nh.buf.clear();
+    nh.ipv4("192.0.2.1");
+    addCorpus("evpn", vector<string>(1, buildUpdate("", baseAttrs(SYNTH_AS_PATH_LEN, NULL) +
+                                    mpReach(bgp::BGP_AFI_L2VPN, bgp::BGP_SAFI_EVPN, nh.buf, evpnRoutes(SYNTH_PREFIXES)), "")));
+
+    vector<string> ls;
+    ls.push_back(lsUpdate(1, SYNTH_PREFIXES));
+    ls.push_back(lsUpdate(2, SYNTH_PREFIXES));
+    ls.push_back(lsUpdate(3, SYNTH_PREFIXES));
+    addCorpus("bgp_ls", ls);
+}
+
+/**
+ * Load the UPDATEs of a captured corpus
+ *
+ * \return false if the file can't be read
+ */
+static bool loadCorpus(const char *filename, bool two_octet_asn) {
+    ifstream in(filename, ios::in | ios::binary);
+    if (not in) {
+        cerr << "Failed to open " << filename << endl;
+        return false;
+    }
+
+    stringstream ss;
+    ss << in.rdbuf();
+    string file = ss.str();
+
+    vector<string> msgs;
+    bool bmp = file.size() > 0 and file[0] == 3;
+
+    for (size_t off = 0; off + 19 <= file.size(); ) {
+        const u_char *p = (const u_char *)file.data() + off;
+        size_t len, bgp_off = 0;
+
+        if (bmp) {
+            len = (size_t)p[1] << 24 | p[2] << 16 | p[3] << 8 | p[4];
+            if (p[5] == parseBMP::TYPE_ROUTE_MON)
+                bgp_off = 6 + BMP_PEER_HDR_LEN;
+        } else
+            len = p[16] << 8 | p[17];
+
+        if (len < 6 or off + len > file.size())
+            break;
+
+        if (bgp_off + 19 <= len and p[bgp_off + 18] == parseBGP::BGP_MSG_UPDATE)
+            msgs.push_back(file.substr(off + bgp_off, len - bgp_off));
+
+        off += len;
+    }
+
+    if (msgs.empty()) {
+        cerr << "No UPDATEs found in " << filename << endl;
+        return false;
+    }
+
+    addCorpus("corpus", msgs, two_octet_asn);
+    return true;
+}
+
+/**
+ * Persistent peer info of a peer using 4 (or 2) octet ASNs, without add paths
+ */
+static void initPeerInfo(BMPReader::peer_info &info, bool two_octet_asn) {
+    info = BMPReader::peer_info();
+    info.sent_four_octet_asn = not two_octet_asn;
+    info.recv_four_octet_asn = not two_octet_asn;
+}
+
+/**
+ * Clear the NLRI lists that parseUpdateMsg() appends to, see parseBGP::handleUpdate()
+ */
+static void clearParsed(bgp_msg::UpdateMsg::parsed_update_data &parsed) {
+    parsed.vpn.clear();
+    parsed.vpn_withdrawn.clear();
+    parsed.evpn.clear();
+    parsed.evpn_withdrawn.clear();
+    parsed.ls.clear();
+    parsed.ls_withdrawn.clear();
+    parsed.ls_attrs.clear();
+}
+
+/**
+ * Number of NLRIs in parsed data
+ */
+static size_t countNlris(bgp_msg::UpdateMsg::parsed_update_data &parsed) {
+    return parsed.advertised.size() + parsed.withdrawn.size() + parsed.vpn.size() + parsed.vpn_withdrawn.size() +
+           parsed.evpn.size() + parsed.evpn_withdrawn.size() + parsed.ls.nodes.size() + parsed.ls.links.size() +
+           parsed.ls.prefixes.size() + parsed.ls_withdrawn.nodes.size() + parsed.ls_withdrawn.links.size() +
+           parsed.ls_withdrawn.prefixes.size();
+}
+
+/****************************************************************************
+ * Decoder benchmarks
+ ****************************************************************************/
+
+/**
+ * UpdateMsg::parseUpdateMsg() of all UPDATEs of a corpus
+ */
+static void BM_parseUpdateMsg(benchmark::State &state, const Corpus *c) {
+    BMPReader::peer_info info;
+    bgp_msg::UpdateMsg::parsed_update_data parsed;
+    vector<string> msgs = c->msgs;                  // Parsers take non-const data
+    uint64_t nlris = 0;
+
+    initPeerInfo(info, c->two_octet_asn);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < msgs.size(); i++) {
+            bgp_msg::UpdateMsg update(logger, PEER_ADDR, ROUTER_ADDR, &info);
+
+            clearParsed(parsed);
+            benchmark::DoNotOptimize(update.parseUpdateMsg((u_char *)&msgs[i][19], msgs[i].size() - 19, parsed));
+            nlris += countNlris(parsed);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * msgs.size());
+    state.SetBytesProcessed(state.iterations() * c->bytes);
+    state.counters["nlris"] = benchmark::Counter(nlris, benchmark::Counter::kIsRate);
+}
+
+/**
+ * UpdateMsg::parseAttr_AsPath(), through an UPDATE with only the ORIGIN and AS_PATH attributes
+ *
+ * \details parseAttr_AsPath() is private; the rest of the UPDATE is the header checks.
+ */
+static void BM_parseAttr_AsPath(benchmark::State &state) {
+    BMPReader::peer_info info;
+    bgp_msg::UpdateMsg::parsed_update_data parsed;
+    Wire attrs, as_path;
+
+    initPeerInfo(info, false);
+
+    as_path.u8(2).u8(state.range(0));
+    for (int i = 0; i < state.range(0); i++)
+        as_path.u32(64496 + i);
+
+    attrs.attr(0x40, 1, string(1, 0));
+    attrs.attr(0x40, 2, as_path.buf);
+
+    string msg = buildUpdate("", attrs.buf, "");
+
+    for (auto _ : state) {
+        bgp_msg::UpdateMsg update(logger, PEER_ADDR, ROUTER_ADDR, &info);
+
+        benchmark::DoNotOptimize(update.parseUpdateMsg((u_char *)&msg[19], msg.size() - 19, parsed));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * MPReachAttr::parseNlriData_IPv4IPv6()
+ */
+static void BM_parseNlriData_IPv4IPv6(benchmark::State &state, bool isIPv4) {
+    BMPReader::peer_info info;
+    vector<bgp::prefix_tuple> prefixes;
+    string nlri = isIPv4 ? ipv4Prefixes(SYNTH_PREFIXES, false, false) : ipv6Prefixes(SYNTH_PREFIXES);
+
+    initPeerInfo(info, false);
+
+    for (auto _ : state) {
+        prefixes.clear();
+        bgp_msg::MPReachAttr::parseNlriData_IPv4IPv6(isIPv4, (u_char *)&nlri[0], nlri.size(), &info, prefixes);
+        benchmark::DoNotOptimize(prefixes.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * SYNTH_PREFIXES);
+}
+
+/**
+ * MPReachAttr::parseNlriData_LabelIPv4IPv6() of labeled unicast and VPNv4 prefixes
+ */
+template <typename PREFIX_TUPLE>
+static void BM_parseNlriData_LabelIPv4IPv6(benchmark::State &state, bool rd) {
+    BMPReader::peer_info info;
+    vector<PREFIX_TUPLE> prefixes;
+    string nlri = ipv4Prefixes(SYNTH_PREFIXES, true, rd);
+
+    initPeerInfo(info, false);
+
+    for (auto _ : state) {
+        prefixes.clear();
+        bgp_msg::MPReachAttr::parseNlriData_LabelIPv4IPv6(true, (u_char *)&nlri[0], nlri.size(), &info, prefixes);
+        benchmark::DoNotOptimize(prefixes.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * SYNTH_PREFIXES);
+}
+
+/**
+ * ExtCommunity::parseExtCommunities() of range(0) route targets, cached if range(1) is set
+ */
+static void BM_ExtCommunity(benchmark::State &state) {
+    bgp_msg::UpdateMsg::parsed_update_data parsed;
+    bgp_msg::ExtCommCache cache;
+    Wire data;
+
+    for (int i = 0; i < state.range(0); i++) {
+        if (i % 2)
+            data.u8(0x01).u8(0x02).ipv4("192.0.2.1").u16(i);     // IPv4 address route target
+        else
+            data.u8(0x00).u8(0x02).u16(64496).u32(i);            // 2 octet AS route target
+    }
+
+    for (auto _ : state) {
+        parsed.attrs.clear();
+
+        bgp_msg::ExtCommunity ec(logger, PEER_ADDR, false, state.range(1) ? &cache : NULL);
+        ec.parseExtCommunities(data.buf.size(), (u_char *)&data.buf[0], parsed);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/**
+ * EVPN::parseNlriData() of MAC/IP advertisement routes
+ */
+static void BM_EVPN(benchmark::State &state) {
+    bgp_msg::UpdateMsg::parsed_update_data parsed;
+    string nlri = evpnRoutes(SYNTH_PREFIXES);
+
+    for (auto _ : state) {
+        parsed.evpn.clear();
+
+        bgp_msg::EVPN evpn(logger, PEER_ADDR, false, &parsed, false);
+        evpn.parseNlriData((u_char *)&nlri[0], nlri.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * SYNTH_PREFIXES);
+}
+
+/**
+ * MPLinkStateAttr::parseAttrLinkState() of the node, link or prefix attribute
+ */
+static void BM_MPLinkStateAttr(benchmark::State &state, int nlri_type) {
+    bgp_msg::UpdateMsg::parsed_update_data parsed;
+    string data = lsAttrData(nlri_type);
+
+    for (auto _ : state) {
+        parsed.ls_attrs.clear();
+
+        bgp_msg::MPLinkStateAttr ls(logger, PEER_ADDR, &parsed, false);
+        ls.parseAttrLinkState(data.size(), (u_char *)&data[0]);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * MD5 digest of range(0) bytes
+ */
+static void BM_MD5(benchmark::State &state) {
+    string data(state.range(0), 'x');
+    u_char digest[16];
+    MD5 md5;
+
+    for (auto _ : state) {
+        md5.reset();
+        md5.update((unsigned char *)&data[0], data.size());
+        md5.finalize();
+        md5.raw_digest(digest);
+        benchmark::DoNotOptimize(digest);
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+/**
+ * HashEngine digest of range(0) bytes
+ */
+static void BM_HashEngine(benchmark::State &state) {
+    string data(state.range(0), 'x');
+    u_char digest[HASH_ENGINE_DIGEST_SIZE];
+
+    for (auto _ : state) {
+        HashEngine hash;
+
+        hash.update(data.data(), data.size());
+        hash.finalize();
+        hash.digest(digest);
+        benchmark::DoNotOptimize(digest);
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+/**
+ * MsgBusInterface::hash_toStr() to a char buffer
+ */
+static void BM_hash_toStr(benchmark::State &state) {
+    u_char hash[16];
+    char str[33];
+
+    for (int i = 0; i < 16; i++)
+        hash[i] = i * 17;
+
+    for (auto _ : state) {
+        MsgBusInterface::hash_toStr(hash, str);
+        benchmark::DoNotOptimize(str);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * MsgBusInterface::hash_toStr() to a string
+ */
+static void BM_hash_toStr_string(benchmark::State &state) {
+    u_char hash[16];
+    string str;
+
+    for (int i = 0; i < 16; i++)
+        hash[i] = i * 17;
+
+    for (auto _ : state) {
+        MsgBusInterface::hash_toStr(hash, str);
+        benchmark::DoNotOptimize(str.data());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+/****************************************************************************
+ * Encoder benchmarks
+ ****************************************************************************/
+
+/**
+ * Message bus that keeps the objects of the first call of each kind
+ */
+class RecordingMsgBus : public MsgBusInterface {
+public:
+    obj_path_attr               attr;
+    std::vector<obj_rib>        rib;
+    std::vector<obj_rib>        rib_withdrawn;
+    std::vector<obj_vpn>        vpn;
+    std::vector<obj_evpn>       evpn;
+    std::vector<obj_ls_node>    ls_nodes;
+    std::vector<obj_ls_link>    ls_links;
+    std::vector<obj_ls_prefix>  ls_prefixes;
+    obj_path_attr               ls_attr;
+    bool                        has_attr;
+
+    RecordingMsgBus() {
+        has_attr = false;
+        ribSeq = 0;
+    }
+
+    void update_Collector(struct obj_collector &c_obj, collector_action_code action_code) { }
+    void update_Router(struct obj_router &r_object, router_action_code code) { }
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) { }
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) { }
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) { }
+    void send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len) { }
+
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+        if (not has_attr) {
+            this->attr = attr;
+            has_attr = true;
+        }
+    }
+
+    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                              unicast_prefix_action_code code) {
+        std::vector<obj_rib> &list = code == UNICAST_PREFIX_ACTION_DEL ? rib_withdrawn : this->rib;
+        if (list.empty())
+            list = rib;
+    }
+
+    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code) {
+        if (this->vpn.empty())
+            this->vpn = vpn;
+    }
+
+    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code) {
+        if (evpn.empty())
+            evpn = vpn;
+    }
+
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_node> &nodes,
+                       ls_action_code code) {
+        if (ls_nodes.empty()) {
+            ls_nodes = nodes;
+            ls_attr = attr;
+        }
+    }
+
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_link> &links,
+                       ls_action_code code) {
+        if (ls_links.empty())
+            ls_links = links;
+    }
+
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_prefix> &prefixes,
+                         ls_action_code code) {
+        if (ls_prefixes.empty())
+            ls_prefixes = prefixes;
+    }
+};
+
+/**
+ * Kafka message bus that encodes the rows but doesn't produce them
+ *
+ * \details The bus is not deleted, the destructor terminates the router through the producer.
+ */
+class EncodeOnlyMsgBus : public msgBus_kafka {
+public:
+    uint64_t    bytes;                      ///< Bytes of the encoded messages
+    uint64_t    rows;                       ///< Rows of the encoded messages
+
+    EncodeOnlyMsgBus(Logger *logPtr, Config *cfg, u_char *c_hash_id) : msgBus_kafka(logPtr, cfg, c_hash_id) {
+        bytes = rows = 0;
+    }
+
+protected:
+    void produce(const char *topic_var, topic_idx idx, char *msg, size_t msg_size, int rows,
+                 const std::string &key, peer_cache *peer, uint32_t peer_asn, bool priority) {
+        bytes += msg_size;
+        this->rows += rows;
+    }
+};
+
+static Config           tsv_cfg;
+static Config           binary_cfg;
+static EncodeOnlyMsgBus *tsv_bus;
+static EncodeOnlyMsgBus *binary_bus;
+static RecordingMsgBus  recorded;
+
+static MsgBusInterface::obj_collector       collector;
+static MsgBusInterface::obj_router          router;
+static MsgBusInterface::obj_bgp_peer        peer;
+static MsgBusInterface::obj_peer_up_event   peer_up;
+static MsgBusInterface::obj_stats_report    stats;
+
+/**
+ * Fill the collector, router, peer and stats objects
+ */
+static void initObjects() {
+    bzero(&collector, sizeof(collector));
+    snprintf(collector.admin_id, sizeof(collector.admin_id), "collector-1");
+    snprintf(collector.routers, sizeof(collector.routers), "%s", ROUTER_ADDR);
+    collector.router_count = 1;
+
+    bzero(&router, sizeof(router));
+    router.hash_id[0] = 1;
+    snprintf((char *)router.name, sizeof(router.name), "router-1.example.net");
+    snprintf((char *)router.descr, sizeof(router.descr), "Synthetic router\tversion 1.0");
+    snprintf((char *)router.ip_addr, sizeof(router.ip_addr), "%s", ROUTER_ADDR);
+    snprintf(router.initiate_data, sizeof(router.initiate_data), "sysName=router-1.example.net");
+
+    bzero(&peer, sizeof(peer));
+    peer.hash_id[0] = 2;
+    memcpy(peer.router_hash_id, router.hash_id, sizeof(peer.router_hash_id));
+    snprintf(peer.peer_rd, sizeof(peer.peer_rd), "0:0");
+    snprintf(peer.peer_addr, sizeof(peer.peer_addr), "%s", PEER_ADDR);
+    snprintf(peer.peer_bgp_id, sizeof(peer.peer_bgp_id), "%s", PEER_ADDR);
+    peer.peer_as = 64496;
+    peer.isPrePolicy = true;
+    peer.isIPv4 = true;
+
+    bzero(&peer_up, sizeof(peer_up));
+    snprintf(peer_up.local_ip, sizeof(peer_up.local_ip), "192.0.2.2");
+    snprintf(peer_up.local_bgp_id, sizeof(peer_up.local_bgp_id), "192.0.2.2");
+    snprintf(peer_up.remote_bgp_id, sizeof(peer_up.remote_bgp_id), "%s", PEER_ADDR);
+    snprintf(peer_up.sent_cap, sizeof(peer_up.sent_cap), "MPBGP (1) : afi=1 safi=1 : Unicast IPv4, 4 Octet ASN (65)");
+    snprintf(peer_up.recv_cap, sizeof(peer_up.recv_cap), "MPBGP (1) : afi=1 safi=1 : Unicast IPv4, 4 Octet ASN (65)");
+    peer_up.local_asn = peer_up.remote_asn = 64496;
+    peer_up.local_port = 179;
+    peer_up.remote_port = 53000;
+    peer_up.local_hold_time = peer_up.remote_hold_time = 90;
+
+    bzero(&stats, sizeof(stats));
+    stats.routes_adj_rib_in = 800000;
+    stats.routes_loc_rib = 790000;
+}
+
+/**
+ * Record the encoder objects by running parseBGP over the synthetic corpora
+ */
+static void recordObjects() {
+    for (size_t c = 0; c < corpora.size(); c++) {
+        if (corpora[c].name == "corpus")
+            continue;
+
+        BMPReader::peer_info info;
+        initPeerInfo(info, false);
+
+        for (size_t i = 0; i < corpora[c].msgs.size(); i++) {
+            string msg = corpora[c].msgs[i];
+            parseBGP parser(logger, &recorded, &peer, ROUTER_ADDR, &info);
+
+            parser.handleUpdate((u_char *)&msg[0], msg.size());
+        }
+
+        delete info.nlri_arena;
+    }
+}
+
+/**
+ * Encode one message of the kind
+ */
+enum Encoder {
+    ENC_COLLECTOR=0,
+    ENC_ROUTER,
+    ENC_PEER,
+    ENC_BASE_ATTRIBUTE,
+    ENC_UNICAST_PREFIX,
+    ENC_UNICAST_WITHDRAW,
+    ENC_L3VPN,
+    ENC_EVPN,
+    ENC_LS_NODE,
+    ENC_LS_LINK,
+    ENC_LS_PREFIX,
+    ENC_BMP_STAT
+};
+
+static void BM_encode(benchmark::State &state, Encoder enc, bool binary) {
+    EncodeOnlyMsgBus *bus = binary ? binary_bus : tsv_bus;
+    uint64_t bytes = bus->bytes, rows = bus->rows;
+
+    for (auto _ : state) {
+        switch (enc) {
+            case ENC_COLLECTOR:
+                bus->update_Collector(collector, MsgBusInterface::COLLECTOR_ACTION_HEARTBEAT);
+                break;
+            case ENC_ROUTER:
+                bus->update_Router(router, MsgBusInterface::ROUTER_ACTION_INIT);
+                break;
+            case ENC_PEER:
+                bus->update_Peer(peer, &peer_up, NULL, MsgBusInterface::PEER_ACTION_UP);
+                break;
+            case ENC_BASE_ATTRIBUTE:
+                bus->update_baseAttribute(peer, recorded.attr, MsgBusInterface::BASE_ATTR_ACTION_ADD);
+                break;
+            case ENC_UNICAST_PREFIX:
+                bus->update_unicastPrefix(peer, recorded.rib, &recorded.attr, MsgBusInterface::UNICAST_PREFIX_ACTION_ADD);
+                break;
+            case ENC_UNICAST_WITHDRAW:
+                bus->update_unicastPrefix(peer, recorded.rib_withdrawn, NULL, MsgBusInterface::UNICAST_PREFIX_ACTION_DEL);
+                break;
+            case ENC_L3VPN:
+                bus->update_L3Vpn(peer, recorded.vpn, &recorded.attr, MsgBusInterface::VPN_ACTION_ADD);
+                break;
+            case ENC_EVPN:
+                bus->update_eVPN(peer, recorded.evpn, &recorded.attr, MsgBusInterface::VPN_ACTION_ADD);
+                break;
+            case ENC_LS_NODE:
+                bus->update_LsNode(peer, recorded.ls_attr, recorded.ls_nodes, MsgBusInterface::LS_ACTION_ADD);
+                break;
+            case ENC_LS_LINK:
+                bus->update_LsLink(peer, recorded.ls_attr, recorded.ls_links, MsgBusInterface::LS_ACTION_ADD);
+                break;
+            case ENC_LS_PREFIX:
+                bus->update_LsPrefix(peer, recorded.ls_attr, recorded.ls_prefixes, MsgBusInterface::LS_ACTION_ADD);
+                break;
+            case ENC_BMP_STAT:
+                bus->add_StatReport(peer, stats);
+                break;
+        }
+    }
+
+    state.SetBytesProcessed(bus->bytes - bytes);
+    state.SetItemsProcessed(bus->rows - rows);
+}
+
+/**
+ * Register the benchmarks, the encoders need the recorded objects
+ */
+static void registerBenchmarks() {
+    for (size_t c = 0; c < corpora.size(); c++)
+        benchmark::RegisterBenchmark(("parseUpdateMsg/" + corpora[c].name).c_str(), BM_parseUpdateMsg, &corpora[c]);
+
+    benchmark::RegisterBenchmark("parseAttr_AsPath", BM_parseAttr_AsPath)->Arg(2)->Arg(8)->Arg(32)->Arg(128);
+
+    benchmark::RegisterBenchmark("MPReachAttr/parseNlriData_IPv4IPv6/ipv4", BM_parseNlriData_IPv4IPv6, true);
+    benchmark::RegisterBenchmark("MPReachAttr/parseNlriData_IPv4IPv6/ipv6", BM_parseNlriData_IPv4IPv6, false);
+    benchmark::RegisterBenchmark("MPReachAttr/parseNlriData_LabelIPv4IPv6/labeled",
+                                 BM_parseNlriData_LabelIPv4IPv6<bgp::prefix_tuple>, false);
+    benchmark::RegisterBenchmark("MPReachAttr/parseNlriData_LabelIPv4IPv6/vpnv4",
+                                 BM_parseNlriData_LabelIPv4IPv6<bgp::vpn_tuple>, true);
+
+    benchmark::RegisterBenchmark("ExtCommunity", BM_ExtCommunity)
+            ->ArgNames({"communities", "cached"})->Args({2, 0})->Args({16, 0})->Args({2, 1})->Args({16, 1});
+
+    benchmark::RegisterBenchmark("EVPN", BM_EVPN);
+
+    benchmark::RegisterBenchmark("MPLinkStateAttr/node", BM_MPLinkStateAttr, 1);
+    benchmark::RegisterBenchmark("MPLinkStateAttr/link", BM_MPLinkStateAttr, 2);
+    benchmark::RegisterBenchmark("MPLinkStateAttr/prefix", BM_MPLinkStateAttr, 3);
+
+    benchmark::RegisterBenchmark("MD5", BM_MD5)->Arg(64)->Arg(256)->Arg(1024);
+    benchmark::RegisterBenchmark("HashEngine", BM_HashEngine)->Arg(64)->Arg(256)->Arg(1024);
+    benchmark::RegisterBenchmark("hash_toStr", BM_hash_toStr);
+    benchmark::RegisterBenchmark("hash_toStr/string", BM_hash_toStr_string);
+
+    static const char *names[] = { "collector", "router", "peer", "base_attribute", "unicast_prefix",
+                                   "unicast_prefix_withdraw", "l3vpn", "evpn", "ls_node", "ls_link",
+                                   "ls_prefix", "bmp_stat" };
+
+    for (int enc = ENC_COLLECTOR; enc <= ENC_BMP_STAT; enc++) {
+        benchmark::RegisterBenchmark((string("encode/") + names[enc] + "/tsv").c_str(), BM_encode, (Encoder)enc, false);
+        benchmark::RegisterBenchmark((string("encode/") + names[enc] + "/binary").c_str(), BM_encode, (Encoder)enc, true);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *corpus_file = NULL;
+    bool two_octet_asn = false;
+    int args = 1;
+
+    // Remove the options of the suite, the rest are google benchmark options
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--corpus=", 9) == 0)
+            corpus_file = argv[i] + 9;
+        else if (strcmp(argv[i], "--corpus_two_octet_asn") == 0)
+            two_octet_asn = true;
+        else
+            argv[args++] = argv[i];
+    }
+    argc = args;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    try {
+        logger = new Logger("/dev/null", "/dev/null");
+
+        buildSyntheticCorpora();
+        if (corpus_file != NULL and not loadCorpus(corpus_file, two_octet_asn))
+            return 2;
+
+        initObjects();
+        recordObjects();
+
+        // All topics are binary in binary_cfg
+        for (Config::topic_names_map_iter it = binary_cfg.topic_names_map.begin();
+                it != binary_cfg.topic_names_map.end(); ++it)
+            binary_cfg.topic_format_map[it->first] = "binary";
+
+        u_char c_hash_id[16] = { 0 };
+        tsv_bus = new EncodeOnlyMsgBus(logger, &tsv_cfg, c_hash_id);
+        binary_bus = new EncodeOnlyMsgBus(logger, &binary_cfg, c_hash_id);
+
+    } catch (char const *str) {
+        cerr << "ERROR: " << str << endl;
+        return 2;
+    }
+
+    registerBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * \file    bmp_bench.cpp
+ *
+ * \brief   Replays a recorded BMP stream through BMPReader, parseBMP and parseBGP
+ * \details The capture is loaded in memory and copied to an in-process ring per router
+ *          before the clock starts, so only the parsing is measured.  Parsed objects are
+ *          counted by a message bus that doesn't encode or produce anything.
+ *
+ *          Captures can be a raw BMP byte stream, a dump of bmp_raw topic messages
+ *          (headers followed by L bytes, as written by kafkacat -f '%s') or a pcap of
+ *          the router TCP stream.
+ */
+
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Config.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "MsgBusInterface.hpp"
+#include "BMPListener.h"
+#include "BMPReader.h"
+#include "spscRing.hpp"
+
+using namespace std;
+
+#define PCAP_MAGIC_USEC         0xa1b2c3d4      ///< pcap magic, microsecond timestamps
+#define PCAP_MAGIC_NSEC         0xa1b23c4d      ///< pcap magic, nanosecond timestamps
+#define PCAP_LINKTYPE_ETHERNET  1
+#define PCAP_LINKTYPE_RAW       101
+#define PCAP_LINKTYPE_SLL       113
+
+/*
+ * Allocations made with operator new, by all threads
+ *
+ * The replacements are not inlined, gcc would otherwise match malloc()/free() against
+ * new/delete at the call sites and warn (-Wmismatched-new-delete).
+ */
+static atomic<uint64_t> alloc_count(0);
+
+__attribute__((noinline)) void *operator new(size_t size) {
+    alloc_count.fetch_add(1, memory_order_relaxed);
+
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == NULL)
+        throw bad_alloc();
+
+    return ptr;
+}
+
+__attribute__((noinline)) void *operator new[](size_t size) {
+    alloc_count.fetch_add(1, memory_order_relaxed);
+
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == NULL)
+        throw bad_alloc();
+
+    return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+/**
+ * Message bus that counts the objects it is given
+ */
+class CountingMsgBus : public MsgBusInterface {
+public:
+    uint64_t    routers;
+    uint64_t    peers;
+    uint64_t    attrs;
+    uint64_t    nlris;
+    uint64_t    stats;
+    uint64_t    raw;
+
+    CountingMsgBus() {
+        routers = peers = attrs = nlris = stats = raw = 0;
+        ribSeq = 0;
+    }
+
+    void update_Collector(struct obj_collector &c_obj, collector_action_code action_code) { }
+
+    void update_Router(struct obj_router &r_object, router_action_code code) {
+        ++routers;
+    }
+
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) {
+        ++peers;
+    }
+
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+        ++attrs;
+    }
+
+    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                              unicast_prefix_action_code code) {
+        nlris += rib.size();
+        ribSeq += rib.size();
+    }
+
+    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code) {
+        nlris += vpn.size();
+    }
+
+    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code) {
+        nlris += vpn.size();
+    }
+
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
+        ++this->stats;
+    }
+
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_node> &nodes,
+                       ls_action_code code) {
+        nlris += nodes.size();
+    }
+
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_link> &links,
+                       ls_action_code code) {
+        nlris += links.size();
+    }
+
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_prefix> &prefixes,
+                         ls_action_code code) {
+        nlris += prefixes.size();
+    }
+
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) {
+        ++raw;
+    }
+
+    void send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len) {
+        ++raw;
+    }
+};
+
+/**
+ * Replay of the capture by one router
+ */
+struct Router {
+    BMPListener::ClientInfo client;
+    CountingMsgBus          mbus;
+    BMPReader               *reader;
+    thread                  *thr;
+};
+
+/**
+ * Extract the TCP payload to port from a pcap
+ *
+ * \details Segments are used in capture order; retransmissions and reordering are
+ *          not handled, the capture should be of a single clean router session.
+ */
+static bool loadPcap(const string &file, uint16_t port, string &data) {
+    const u_char *p = (const u_char *)file.data();
+    size_t len = file.size();
+    uint32_t magic, linktype;
+    bool swap;
+
+    memcpy(&magic, p, 4);
+    swap = magic != PCAP_MAGIC_USEC and magic != PCAP_MAGIC_NSEC;
+
+    memcpy(&linktype, p + 20, 4);
+    if (swap)
+        linktype = __builtin_bswap32(linktype);
+
+    for (size_t off = 24; off + 16 <= len; ) {
+        uint32_t caplen;
+        memcpy(&caplen, p + off + 8, 4);
+        if (swap)
+            caplen = __builtin_bswap32(caplen);
+
+        const u_char *pkt = p + off + 16;
+        off += 16 + caplen;
+        if (off > len)
+            break;
+
+        size_t l2 = 0;
+        uint16_t ethertype = 0;
+
+        if (linktype == PCAP_LINKTYPE_ETHERNET) {
+            l2 = 14;
+            ethertype = (pkt[12] << 8) | pkt[13];
+            while ((ethertype == 0x8100 or ethertype == 0x88a8) and caplen >= l2 + 4) {
+                ethertype = (pkt[l2 + 2] << 8) | pkt[l2 + 3];
+                l2 += 4;
+            }
+        } else if (linktype == PCAP_LINKTYPE_SLL) {
+            l2 = 16;
+            ethertype = (pkt[14] << 8) | pkt[15];
+        } else if (linktype == PCAP_LINKTYPE_RAW) {
+            ethertype = (pkt[0] >> 4) == 6 ? 0x86dd : 0x0800;
+        } else {
+            cerr << "pcap link type " << linktype << " is not supported" << endl;
+            return false;
+        }
+
+        if (caplen < l2 + 20)
+            continue;
+
+        const u_char *ip = pkt + l2;
+        size_t ip_len, ip_hlen;
+
+        if (ethertype == 0x0800 and ip[9] == IPPROTO_TCP) {
+            ip_hlen = (ip[0] & 0x0f) * 4;
+            ip_len = (ip[2] << 8) | ip[3];
+        } else if (ethertype == 0x86dd and ip[6] == IPPROTO_TCP and caplen >= l2 + 40) {
+            ip_hlen = 40;
+            ip_len = 40 + ((ip[4] << 8) | ip[5]);
+        } else
+            continue;
+
+        if (l2 + ip_len > caplen or ip_len < ip_hlen + 20)
+            continue;
+
+        const u_char *tcp = ip + ip_hlen;
+        size_t tcp_hlen = (tcp[12] >> 4) * 4;
+        uint16_t dport = (tcp[2] << 8) | tcp[3];
+
+        if (dport != port or ip_len < ip_hlen + tcp_hlen)
+            continue;
+
+        data.append((const char *)tcp + tcp_hlen, ip_len - ip_hlen - tcp_hlen);
+    }
+
+    return true;
+}
+
+/**
+ * Extract the BMP data of bmp_raw topic messages
+ */
+static bool loadRawTopic(const string &file, string &data) {
+    size_t off = 0;
+
+    while (off < file.size()) {
+        size_t end = file.find("\n\n", off);
+        if (end == string::npos)
+            break;
+
+        size_t l = file.find("\nL: ", off);
+        if (l == string::npos or l > end) {
+            cerr << "bmp_raw message at offset " << off << " has no length header" << endl;
+            return false;
+        }
+
+        size_t msg_len = strtoul(file.c_str() + l + 4, NULL, 10);
+        off = end + 2;
+
+        if (off + msg_len > file.size())
+            msg_len = file.size() - off;
+
+        data.append(file, off, msg_len);
+        off += msg_len;
+    }
+
+    return true;
+}
+
+/**
+ * Load a capture, the format is detected from the content
+ */
+static bool loadCapture(const char *filename, uint16_t port, string &data) {
+    ifstream in(filename, ios::in | ios::binary);
+    if (not in) {
+        cerr << "Failed to open " << filename << endl;
+        return false;
+    }
+
+    stringstream ss;
+    ss << in.rdbuf();
+    string file = ss.str();
+
+    uint32_t magic = 0;
+    if (file.size() >= 24)
+        memcpy(&magic, file.data(), 4);
+
+    if (magic == PCAP_MAGIC_USEC or magic == PCAP_MAGIC_NSEC or
+            __builtin_bswap32(magic) == PCAP_MAGIC_USEC or __builtin_bswap32(magic) == PCAP_MAGIC_NSEC)
+        return loadPcap(file, port, data);
+
+    if (file.compare(0, 3, "V: ") == 0)
+        return loadRawTopic(file, data);
+
+    data.swap(file);
+    return true;
+}
+
+/**
+ * Count the BMP messages of a stream
+ *
+ * \return Number of messages, -1 if not all messages are BMPv3
+ */
+static int64_t countMessages(const string &data) {
+    int64_t count = 0;
+
+    for (size_t off = 0; off + 6 <= data.size(); ++count) {
+        uint32_t len;
+
+        if (data[off] != 3)
+            return -1;
+
+        memcpy(&len, data.data() + off + 1, 4);
+        len = ntohl(len);
+        if (len < 6)
+            return -1;
+
+        off += len;
+    }
+
+    return count;
+}
+
+static void usage(const char *prog) {
+    cout << "Usage: " << prog << " [options] <capture file>" << endl
+         << endl
+         << "  -r <routers>      Number of routers replaying the capture in parallel, default is 1" << endl
+         << "  -c <file>         Configuration file, default is the built-in defaults" << endl
+         << "  -P <port>         Collector TCP port of the router stream in a pcap, default is 5000" << endl
+         << "  -l <file>         Log file, default is /dev/null" << endl;
+}
+
+int main(int argc, char **argv) {
+    int routers = 1;
+    uint16_t port = 5000;
+    const char *cfg_file = NULL;
+    const char *log_file = "/dev/null";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:c:P:l:h")) != -1) {
+        switch (opt) {
+            case 'r' : routers = atoi(optarg); break;
+            case 'c' : cfg_file = optarg; break;
+            case 'P' : port = atoi(optarg); break;
+            case 'l' : log_file = optarg; break;
+            default  : usage(argv[0]); return 1;
+        }
+    }
+
+    if (optind >= argc or routers < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Config cfg;
+    Logger *logger;
+
+    try {
+        if (cfg_file != NULL)
+            cfg.load(cfg_file);
+
+        logger = new Logger(log_file, log_file);
+
+    } catch (char const *str) {
+        cerr << "ERROR: " << str << endl;
+        return 2;
+    }
+
+    // Replay is not paced, the reader thread reads the ring directly
+    cfg.bmp_ring_buffer = true;
+
+    string data;
+    if (not loadCapture(argv[optind], port, data))
+        return 2;
+
+    if (data.empty()) {
+        cerr << "No BMP data found in " << argv[optind] << endl;
+        return 2;
+    }
+
+    int64_t msgs = countMessages(data);
+
+    Metrics::enabled = true;
+
+    vector<Router *> list;
+    for (int i = 0; i < routers; i++) {
+        Router *r = new Router();
+
+        bzero(&r->client, sizeof(r->client));
+        r->client.c_sock = -1;
+        r->client.incoming_cpu = -1;
+        r->client.hash_id[0] = i >> 8;
+        r->client.hash_id[1] = i & 0xff;
+        snprintf(r->client.c_ip, sizeof(r->client.c_ip), "10.%d.%d.1", (i >> 8) & 0xff, i & 0xff);
+        gettimeofday(&r->client.startTime, NULL);
+
+        // The whole capture is in the ring before the clock starts
+        r->client.ring = new spscRing(data.size());
+        u_char *ptr;
+        r->client.ring->writeSpace(&ptr);
+        memcpy(ptr, data.data(), data.size());
+        r->client.ring->commitWrite(data.size());
+        r->client.ring->close();
+
+        r->reader = new BMPReader(logger, &cfg);
+        list.push_back(r);
+    }
+
+    uint64_t allocs = alloc_count.load();
+    uint64_t start = Metrics::now();
+
+    for (size_t i = 0; i < list.size(); i++) {
+        Router *r = list[i];
+        r->thr = new thread([r]() {
+            bool run = true;
+            r->reader->readerThreadLoop(run, &r->client, &r->mbus);
+        });
+    }
+
+    for (size_t i = 0; i < list.size(); i++) {
+        list[i]->thr->join();
+        delete list[i]->thr;
+    }
+
+    double secs = (Metrics::now() - start) / 1000000.0;
+    allocs = alloc_count.load() - allocs;
+
+    uint64_t nlris = 0, peers = 0, attrs = 0;
+    for (size_t i = 0; i < list.size(); i++) {
+        nlris += list[i]->mbus.nlris;
+        peers += list[i]->mbus.peers;
+        attrs += list[i]->mbus.attrs;
+    }
+
+    uint64_t total_msgs = msgs > 0 ? msgs * routers : 0;
+    uint64_t total_bytes = (uint64_t)data.size() * routers;
+
+    if (secs <= 0)
+        secs = 0.000001;
+
+    printf("routers             %d\n", routers);
+    printf("capture             %lu bytes, %s messages\n", (unsigned long)data.size(),
+           msgs >= 0 ? to_string(msgs).c_str() : "unknown (not BMPv3)");
+    printf("elapsed             %.3f secs\n", secs);
+    if (msgs >= 0)
+        printf("messages            %lu (%.0f msgs/sec)\n", (unsigned long)total_msgs, total_msgs / secs);
+    printf("bytes               %lu (%.1f MB/sec)\n", (unsigned long)total_bytes, total_bytes / secs / 1000000);
+    printf("nlris               %lu (%.0f nlris/sec)\n", (unsigned long)nlris, nlris / secs);
+    printf("peer messages       %lu\n", (unsigned long)peers);
+    printf("attribute sets      %lu\n", (unsigned long)attrs);
+    printf("allocations         %lu", (unsigned long)allocs);
+    if (total_msgs > 0)
+        printf(" (%.1f per message)", (double)allocs / total_msgs);
+    printf("\n");
+
+    for (int s = Metrics::STAGE_READ; s <= Metrics::STAGE_ENCODE; s++) {
+        uint64_t count, usecs;
+        Metrics::stageTotals((Metrics::Stage)s, count, usecs);
+
+        if (count > 0)
+            printf("stage %-13s %lu calls, %.3f secs, %.2f usecs avg\n", Metrics::stageName((Metrics::Stage)s),
+                   (unsigned long)count, usecs / 1000000.0, (double)usecs / count);
+    }
+
+    for (size_t i = 0; i < list.size(); i++) {
+        delete list[i]->reader;
+        delete list[i]->client.ring;
+        delete list[i];
+    }
+
+    delete logger;
+
+    return 0;
+}
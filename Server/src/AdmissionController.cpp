@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+
+#include "AdmissionController.h"
+#include "KafkaProducer.h"
+#include "MonotonicClock.h"
+
+/**
+ * User and system CPU time of the process in microseconds
+ */
+static uint64_t processCpuUs() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfg          Pointer to the config instance
+ * \param [in] pipeline     Parse pipeline, NULL if not used
+ */
+AdmissionController::AdmissionController(Logger *logPtr, Config *cfg, ParsePipeline *pipeline) {
+    logger = logPtr;
+    this->cfg = cfg;
+    this->pipeline = pipeline;
+    debug = cfg->debug_general;
+
+    rate = 0;
+    tokens = 0;
+    acquired = 0;
+    admit = true;
+    load = 0;
+
+    cpus = std::thread::hardware_concurrency();
+    if (cpus < 1)
+        cpus = 1;
+
+    sample_ms = refill_ms = monotonicMs();
+    sample_acquired = 0;
+    sample_cpu_us = processCpuUs();
+
+    LOG_INFO("Admission control enabled, CPU max is %d%% of %d cores", cfg->admission_cpu_max, cpus);
+}
+
+/**
+ * Sample the load and adjust the rate
+ *
+ * \details Called periodically by the accept loop, samples at most every ADMISSION_SAMPLE_MS.
+ */
+void AdmissionController::sample() {
+    uint64_t now_ms = monotonicMs();
+    uint64_t cpu_us, msgs;
+    double   secs, read_rate, kafka_load, parse_load = 0, cpu_load;
+    int      new_rate;
+
+    if (now_ms < sample_ms + ADMISSION_SAMPLE_MS)
+        return;
+
+    secs = (now_ms - sample_ms) / 1000.0;
+    msgs = acquired;
+    cpu_us = processCpuUs();
+
+    read_rate = (msgs - sample_acquired) / secs;
+
+    kafka_load = (double)KafkaProducer::maxOutqLen() / cfg->q_buf_max_msgs;
+
+    if (pipeline != NULL and pipeline->groups() > 0)
+        parse_load = (double)pipeline->pending() / ((double)cfg->parse_max_pending * pipeline->groups());
+
+    cpu_load = (cpu_us - sample_cpu_us) / (secs * 1000000.0 * cpus) / (cfg->admission_cpu_max / 100.0);
+
+    load = kafka_load;
+    if (parse_load > load)
+        load = parse_load;
+    if (cpu_load > load)
+        load = cpu_load;
+
+    sample_ms = now_ms;
+    sample_acquired = msgs;
+    sample_cpu_us = cpu_us;
+
+    new_rate = rate;
+
+    if (load >= ADMISSION_HIGH) {
+        // Start from the rate read while it's not limited
+        new_rate = (new_rate == 0 ? read_rate : new_rate) * ADMISSION_DECREASE;
+        if (new_rate < ADMISSION_MIN_RATE)
+            new_rate = ADMISSION_MIN_RATE;
+
+    } else if (load < ADMISSION_LOW and new_rate > 0) {
+        // Remove the limit once the routers don't use it
+        if (read_rate < new_rate / 2)
+            new_rate = 0;
+        else
+            new_rate *= ADMISSION_INCREASE;
+    }
+
+    if (new_rate != rate) {
+        if (rate == 0)
+            LOG_INFO("Collector load is high (kafka %.2f, parse %.2f, cpu %.2f), limiting routers to %d messages/sec",
+                     kafka_load, parse_load, cpu_load, new_rate);
+        else if (new_rate == 0)
+            LOG_INFO("Collector load is low (kafka %.2f, parse %.2f, cpu %.2f), routers are no longer limited",
+                     kafka_load, parse_load, cpu_load);
+        else
+            SELF_DEBUG("Admission rate changed to %d messages/sec, load %.2f", new_rate, load);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        refill(now_ms);
+        rate = new_rate;
+    }
+
+    admit = load < ADMISSION_LOW and rate == 0;
+}
+
+/**
+ * Indicates if another router can be admitted
+ */
+bool AdmissionController::admitRouter() {
+    return admit;
+}
+
+/**
+ * Current load, 1.0 is the max of the most loaded resource
+ */
+double AdmissionController::getLoad() {
+    return load;
+}
+
+/**
+ * Acquire a token to read a message
+ *
+ * \details Called by the router reader threads before each message.  Sleeps while the rate
+ *          is limited and the bucket is empty.
+ */
+void AdmissionController::acquire() {
+    uint64_t retry_ms, now_ms;
+
+    while ((retry_ms = tryAcquire()) != 0) {
+        now_ms = monotonicMs();
+
+        // Check the rate again at least every ADMISSION_MAX_WAIT_MS, it may have been raised
+        if (retry_ms > now_ms + ADMISSION_MAX_WAIT_MS)
+            retry_ms = now_ms + ADMISSION_MAX_WAIT_MS;
+
+        if (retry_ms > now_ms)
+            usleep((retry_ms - now_ms) * 1000);
+    }
+}
+
+/**
+ * Acquire a token to read a message without waiting
+ *
+ * \details Used by the router workers, which service other routers until the retry time.
+ *
+ * \return 0 if acquired, otherwise the time to retry at, see monotonicMs()
+ */
+uint64_t AdmissionController::tryAcquire() {
+    // Not limited, no need to lock
+    if (rate == 0) {
+        ++acquired;
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t now_ms = monotonicMs();
+    int cur_rate = rate;
+
+    refill(now_ms);
+
+    if (cur_rate == 0 or tokens >= 1) {
+        if (cur_rate > 0)
+            tokens -= 1;
+
+        ++acquired;
+        return 0;
+    }
+
+    return now_ms + (uint64_t)((1 - tokens) * 1000 / cur_rate) + 1;
+}
+
+/**
+ * Refill the bucket, mutex must be locked
+ *
+ * \param [in] now_ms   Current monotonic time in milliseconds
+ */
+void AdmissionController::refill(uint64_t now_ms) {
+    double burst = rate * ADMISSION_BURST_SECS;
+
+    if (burst < 1)
+        burst = 1;
+
+    if (now_ms > refill_ms)
+        tokens += (now_ms - refill_ms) * rate / 1000.0;
+
+    if (tokens > burst)
+        tokens = burst;
+
+    refill_ms = now_ms;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ADMISSIONCONTROLLER_H_
+#define ADMISSIONCONTROLLER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "Logger.h"
+#include "Config.h"
+#include "ParsePipeline.h"
+
+#define ADMISSION_SAMPLE_MS         500         ///< Min time between load samples
+#define ADMISSION_HIGH              0.8         ///< Load at or above this reduces the read rate
+#define ADMISSION_LOW               0.5         ///< Load below this raises the read rate and admits routers
+#define ADMISSION_DECREASE          0.7         ///< Rate multiplier when the load is high
+#define ADMISSION_INCREASE          1.25        ///< Rate multiplier when the load is low
+#define ADMISSION_MIN_RATE          100         ///< Min messages per second read by all routers
+#define ADMISSION_BURST_SECS        0.1         ///< Burst size of the token bucket, in seconds of the rate
+#define ADMISSION_MAX_WAIT_MS       100         ///< Max time acquire() sleeps before checking the rate again
+
+/**
+ * \class   AdmissionController
+ *
+ * \brief   Paces the routers by the collector load
+ * \details The load is the highest of the kafka producer queue (relative to
+ *          kafka.queue.buffering.max.messages), the parse pipeline queue (relative to
+ *          buffers.parse_max_pending of each router) and the process CPU (relative to
+ *          startup.admission_cpu_max).
+ *
+ *          When the load is high the messages read by all routers are limited by a token
+ *          bucket.  The rate starts at the current read rate and is decreased while the load
+ *          stays high and increased once it's low again (AIMD); the limit is removed when the
+ *          routers read less than half of it.  Unread data stays in the router buffer and
+ *          then in the socket, so the routers are slowed down by TCP.
+ *
+ *          New routers are only admitted while the load is low and the rate isn't limited.
+ */
+class AdmissionController {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     * \param [in] pipeline     Parse pipeline, NULL if not used
+     */
+    AdmissionController(Logger *logPtr, Config *cfg, ParsePipeline *pipeline);
+
+    /**
+     * Sample the load and adjust the rate
+     *
+     * \details Called periodically by the accept loop, samples at most every ADMISSION_SAMPLE_MS.
+     */
+    void sample();
+
+    /**
+     * Indicates if another router can be admitted
+     */
+    bool admitRouter();
+
+    /**
+     * Acquire a token to read a message
+     *
+     * \details Called by the router reader threads before each message.  Sleeps while the rate
+     *          is limited and the bucket is empty.
+     */
+    void acquire();
+
+    /**
+     * Acquire a token to read a message without waiting
+     *
+     * \details Used by the router workers, which service other routers until the retry time.
+     *
+     * \return 0 if acquired, otherwise the time to retry at, see monotonicMs()
+     */
+    uint64_t tryAcquire();
+
+    /**
+     * Current load, 1.0 is the max of the most loaded resource
+     */
+    double getLoad();
+
+private:
+    Config                  *cfg;               ///< Pointer to config instance
+    Logger                  *logger;            ///< Logging class pointer
+    bool                    debug;              ///< debug flag to indicate debugging
+    ParsePipeline           *pipeline;          ///< Parse pipeline, NULL if not used
+
+    std::mutex              mutex;              ///< Guards the token bucket
+    std::atomic<int>        rate;               ///< Messages per second of all routers, 0 is not limited
+    double                  tokens;             ///< Tokens in the bucket
+    uint64_t                refill_ms;          ///< Time the bucket was last refilled
+
+    std::atomic<uint64_t>   acquired;           ///< Number of tokens acquired
+    std::atomic<bool>       admit;              ///< Indicates new routers can be admitted
+    double                  load;               ///< Load of the last sample
+
+    uint64_t                sample_ms;          ///< Time of the last sample
+    uint64_t                sample_acquired;    ///< Tokens acquired at the last sample
+    uint64_t                sample_cpu_us;      ///< Process CPU time at the last sample
+    int                     cpus;               ///< Number of CPU cores
+
+    /**
+     * Refill the bucket, mutex must be locked
+     *
+     * \param [in] now_ms   Current monotonic time in milliseconds
+     */
+    void refill(uint64_t now_ms);
+};
+
+#endif /* ADMISSIONCONTROLLER_H_ */
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef CACHEALIGNED_H_
+#define CACHEALIGNED_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#define CACHE_LINE_SIZE     64              ///< Alignment of the alignas(64) members and types
+
+/**
+ * \class   CacheAligned
+ *
+ * \brief   Base of the types with alignas(64) members that are allocated with new
+ * \details Before C++17, new only aligns to alignof(max_align_t), which is less than a cache
+ *          line, so the alignas(64) of the members isn't honored on the heap.  The class
+ *          operator new allocates cache line aligned memory with posix_memalign instead.
+ */
+struct CacheAligned {
+    static void *operator new(size_t size) {
+        void *ptr;
+
+        if (posix_memalign(&ptr, CACHE_LINE_SIZE, size) != 0)
+            throw std::bad_alloc();
+
+        return ptr;
+    }
+
+    static void operator delete(void *ptr) {
+        free(ptr);
+    }
+};
+
+#endif /* CACHEALIGNED_H_ */
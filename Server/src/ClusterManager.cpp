@@ -0,0 +1,704 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ClusterManager.h"
+#include "HashEngine.h"
+
+std::mutex                              ClusterManager::mutex;
+std::map<std::string, ClusterManager::Member> ClusterManager::members;
+ClusterManager::Member                  ClusterManager::self;
+std::vector<ClusterManager::Forward *>  ClusterManager::forwards;
+std::thread                             *ClusterManager::thread = NULL;
+std::atomic<bool>                       ClusterManager::running(false);
+Config                                  *ClusterManager::cfg = NULL;
+Logger                                  *ClusterManager::logger = NULL;
+RdKafka::Producer                       *ClusterManager::producer = NULL;
+RdKafka::Topic                          *ClusterManager::topic = NULL;
+RdKafka::KafkaConsumer                  *ClusterManager::consumer = NULL;
+
+/**
+ * Set a kafka config property
+ *
+ * \throw (const char *) if not valid
+ */
+static void setConf(RdKafka::Conf *conf, const std::string &name, const std::string &value) {
+    std::string errstr;
+
+    if (conf->set(name, value, errstr) != RdKafka::Conf::CONF_OK) {
+        static std::string error;
+        error = "Failed to configure kafka cluster membership " + name + ": " + errstr;
+        throw error.c_str();
+    }
+}
+
+/**
+ * Map an IPv4 mapped IPv6 address to the IPv4 address, printed form
+ */
+static std::string unmapAddress(const std::string &addr) {
+    if (addr.compare(0, 7, "::ffff:") == 0 and addr.find('.') != std::string::npos)
+        return addr.substr(7);
+
+    return addr;
+}
+
+/**
+ * Join the cluster, if cluster.enabled
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfgPtr       Pointer to the config instance
+ */
+void ClusterManager::start(Logger *logPtr, Config *cfgPtr) {
+    if (running or not cfgPtr->cluster_enabled)
+        return;
+
+    logger = logPtr;
+    cfg = cfgPtr;
+
+    self.node_id = cfg->cluster_node_id.empty() ? std::string(cfg->admin_id) : cfg->cluster_node_id;
+    self.address = cfg->cluster_address;
+    self.draining = false;
+    self.capacity = cfg->cluster_weight > 0 ? cfg->cluster_weight : std::thread::hardware_concurrency();
+    self.load = 0;
+    self.routers = 0;
+    self.timestamp = time(NULL);
+
+    if (self.capacity <= 0)
+        self.capacity = 1;
+
+    std::string errstr;
+
+    // Producer of the heartbeats
+    RdKafka::Conf *conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
+    setConf(conf, "metadata.broker.list", cfg->kafka_brokers);
+
+    producer = RdKafka::Producer::create(conf, errstr);
+    delete conf;
+
+    if (producer == NULL) {
+        static std::string error;
+        error = "Failed to create the kafka cluster membership producer: " + errstr;
+        throw error.c_str();
+    }
+
+    topic = RdKafka::Topic::create(producer, cfg->cluster_topic, NULL, errstr);
+    if (topic == NULL) {
+        static std::string error;
+        error = "Failed to create the kafka cluster membership topic: " + errstr;
+        throw error.c_str();
+    }
+
+    /*
+     * Consumer of the heartbeats, offsets are not committed so the compacted topic is read
+     *      from the start on every restart
+     */
+    conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
+    RdKafka::Conf *tconf = RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC);
+
+    setConf(conf, "metadata.broker.list", cfg->kafka_brokers);
+    setConf(conf, "group.id", cfg->cluster_name + "-" + self.node_id);
+    setConf(conf, "enable.auto.commit", "false");
+    setConf(tconf, "auto.offset.reset", "earliest");
+
+    if (conf->set("default_topic_conf", tconf, errstr) != RdKafka::Conf::CONF_OK)
+        LOG_WARN("Failed to configure the kafka cluster membership consumer offset reset: %s", errstr.c_str());
+
+    consumer = RdKafka::KafkaConsumer::create(conf, errstr);
+    delete tconf;
+    delete conf;
+
+    if (consumer == NULL) {
+        static std::string error;
+        error = "Failed to create the kafka cluster membership consumer: " + errstr;
+        throw error.c_str();
+    }
+
+    std::vector<std::string> topics(1, cfg->cluster_topic);
+    RdKafka::ErrorCode err = consumer->subscribe(topics);
+    if (err != RdKafka::ERR_NO_ERROR) {
+        static std::string error;
+        error = "Failed to subscribe to the kafka cluster membership topic " + cfg->cluster_topic;
+        throw error.c_str();
+    }
+
+    LOG_INFO("Joining cluster %s as node %s, address %s, capacity %.0f", cfg->cluster_name.c_str(),
+             self.node_id.c_str(), self.address.c_str(), self.capacity);
+
+    heartbeat(false);
+
+    running = true;
+    thread = new std::thread(ClusterManager::run);
+}
+
+/**
+ * Leave the cluster, closes the forwarded connections
+ */
+void ClusterManager::stop() {
+    if (not running)
+        return;
+
+    running = false;
+
+    thread->join();
+    delete thread;
+    thread = NULL;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reapForwards(true);
+    }
+
+    heartbeat(true);
+    producer->flush(2000);
+
+    consumer->close();
+    delete consumer;
+    delete topic;
+    delete producer;
+
+    consumer = NULL;
+    topic = NULL;
+    producer = NULL;
+
+    LOG_INFO("Left cluster %s", cfg->cluster_name.c_str());
+}
+
+/**
+ * Indicates if the cluster is enabled and started
+ */
+bool ClusterManager::enabled() {
+    return running;
+}
+
+/**
+ * Update the load of this node, published by the next heartbeat
+ *
+ * \param [in] routers      Number of routers collected by the node
+ * \param [in] load         Sum of the dump times of the routers in seconds
+ */
+void ClusterManager::setLoad(int routers, double load) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    self.routers = routers;
+    self.load = load;
+}
+
+/**
+ * Start draining this node, new routers are assigned to the other nodes
+ */
+void ClusterManager::drain() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (self.draining)
+            return;
+
+        self.draining = true;
+    }
+
+    LOG_NOTICE("Draining node %s, routers are handed off to the other nodes", self.node_id.c_str());
+
+    // Other nodes stop forwarding new routers now instead of on the next heartbeat
+    heartbeat(false);
+}
+
+/**
+ * Indicates if this node is draining
+ */
+bool ClusterManager::draining() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return self.draining;
+}
+
+/**
+ * Find the owner of a router, mutex must be held
+ *
+ * \details Weighted rendezvous hash, the score of a node is -weight / ln(u) where u is the
+ *          hash of the node ID and router address mapped to (0,1).  A node is only
+ *          assigned routers while it has heartbeats and isn't draining.
+ *
+ * \param [in] router       Router address, printed form
+ *
+ * \return Owner of the router, NULL if this node
+ */
+const ClusterManager::Member *ClusterManager::owner(const std::string &router) {
+    std::vector<const Member *> nodes;
+    time_t now = time(NULL);
+
+    if (not self.draining)
+        nodes.push_back(&self);
+
+    for (std::map<std::string, Member>::iterator it = members.begin(); it != members.end(); ++it) {
+        if (not it->second.draining and now - it->second.timestamp <= cfg->cluster_node_timeout)
+            nodes.push_back(&it->second);
+    }
+
+    if (nodes.empty())
+        return NULL;
+
+    double mean_load = 0;
+    for (size_t i = 0; i < nodes.size(); i++)
+        mean_load += nodes[i]->load;
+    mean_load /= nodes.size();
+
+    const Member *best = NULL;
+    double best_score = 0;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const Member *node = nodes[i];
+
+        HashEngine hash;
+        u_char digest[16];
+        uint64_t h = 0;
+
+        hash.update(node->node_id.data(), node->node_id.size());
+        hash.update(router.data(), router.size());
+        hash.finalize();
+        hash.digest(digest);
+
+        for (int b = 0; b < 8; b++)
+            h = (h << 8) | digest[b];
+
+        // 53 bits of the hash, strictly between 0 and 1
+        double u = ((h >> 11) + 0.5) / 9007199254740992.0;
+
+        double weight = node->capacity;
+        if (mean_load > 0)
+            weight /= 1 + node->load / mean_load;
+
+        double score = -weight / log(u);
+
+        if (best == NULL or score > best_score or (score == best_score and node->node_id < best->node_id)) {
+            best = node;
+            best_score = score;
+        }
+    }
+
+    return best == &self ? NULL : best;
+}
+
+/**
+ * Forward an accepted router connection if it's owned by another node
+ *
+ * \param [in] client       Accepted client connection
+ *
+ * \return true if forwarded, false if the router is collected by this node
+ */
+bool ClusterManager::forward(BMPListener::ClientInfo &client) {
+    std::string router = unmapAddress(client.c_ip);
+    Member node;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const Member *found = owner(router);
+        if (found == NULL)
+            return false;
+
+        node = *found;
+    }
+
+    int sock = connectNode(node.address);
+    if (sock < 0) {
+        LOG_WARN("%s: Unable to forward the router to node %s (%s), collecting it locally", client.c_ip,
+                 node.node_id.c_str(), node.address.c_str());
+        return false;
+    }
+
+    // PROXY protocol v1 header of the router connection
+    char hdr[CLUSTER_PROXY_HDR_MAX];
+    int len = snprintf(hdr, sizeof(hdr), "PROXY %s %s %s %s %s\r\n",
+                       client.c_addr.ss_family == AF_INET ? "TCP4" : "TCP6",
+                       client.c_ip, client.s_ip, client.c_port, client.s_port);
+
+    if (send(sock, hdr, len, MSG_NOSIGNAL) != len) {
+        LOG_WARN("%s: Unable to forward the router to node %s (%s): %s, collecting it locally", client.c_ip,
+                 node.node_id.c_str(), node.address.c_str(), strerror(errno));
+        close(sock);
+        return false;
+    }
+
+    Forward *fwd = new Forward;
+    fwd->router_sock = client.c_sock;
+    fwd->owner_sock = sock;
+    fwd->router = router;
+    fwd->done = false;
+
+    LOG_INFO("%s: Router is owned by node %s, forwarding it to %s", client.c_ip, node.node_id.c_str(),
+             node.address.c_str());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    fwd->thread = new std::thread(ClusterManager::forwardLoop, fwd);
+    forwards.push_back(fwd);
+
+    return true;
+}
+
+/**
+ * Read the PROXY protocol header of a connection forwarded by another node
+ *
+ * \param [in,out] client   Accepted client connection
+ *
+ * \return PROXY_FORWARDED if forwarded, PROXY_PENDING if the header hasn't arrived yet
+ */
+int ClusterManager::readProxyHeader(BMPListener::ClientInfo &client) {
+    std::string peer = unmapAddress(client.c_ip);
+    bool member = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (std::map<std::string, Member>::iterator it = members.begin(); it != members.end(); ++it) {
+            std::string ip, port;
+
+            if (splitAddress(it->second.address, ip, port) and ip == peer) {
+                member = true;
+                break;
+            }
+        }
+    }
+
+    if (not member)
+        return PROXY_NONE;
+
+    // The forwarding node sends the header first, peek without waiting for it
+    char hdr[CLUSTER_PROXY_HDR_MAX + 1];
+    ssize_t len = recv(client.c_sock, hdr, CLUSTER_PROXY_HDR_MAX, MSG_PEEK | MSG_DONTWAIT);
+
+    if (len < 0)
+        return (errno == EAGAIN or errno == EWOULDBLOCK or errno == EINTR) ? PROXY_PENDING : PROXY_NONE;
+    else if (len == 0)
+        return PROXY_NONE;
+
+    hdr[len] = 0;
+    if (strncmp(hdr, "PROXY ", len < 6 ? len : 6) != 0)
+        return PROXY_NONE;
+
+    char *end = strstr(hdr, "\r\n");
+
+    if (end == NULL)
+        return len < CLUSTER_PROXY_HDR_MAX ? PROXY_PENDING : PROXY_NONE;
+
+    // Consume the header, the BMP stream follows it
+    len = end - hdr + 2;
+    if (recv(client.c_sock, hdr, len, 0) != len)
+        return PROXY_NONE;
+
+    *end = 0;
+
+    char proto[8], src[INET6_ADDRSTRLEN], dst[INET6_ADDRSTRLEN];
+    unsigned int sport, dport;
+
+    if (sscanf(hdr, "PROXY %7s %45s %45s %u %u", proto, src, dst, &sport, &dport) != 5 or sport > 65535) {
+        LOG_WARN("%s: Invalid PROXY header from cluster node: %s", client.c_ip, hdr);
+        return PROXY_NONE;
+    }
+
+    sockaddr_in *v4_addr = (sockaddr_in *) &client.c_addr;
+    sockaddr_in6 *v6_addr = (sockaddr_in6 *) &client.c_addr;
+
+    bzero(&client.c_addr, sizeof(client.c_addr));
+
+    if (strcmp(proto, "TCP4") == 0 and inet_pton(AF_INET, src, &v4_addr->sin_addr) == 1) {
+        v4_addr->sin_family = AF_INET;
+        v4_addr->sin_port = htons(sport);
+
+    } else if (strcmp(proto, "TCP6") == 0 and inet_pton(AF_INET6, src, &v6_addr->sin6_addr) == 1) {
+        v6_addr->sin6_family = AF_INET6;
+        v6_addr->sin6_port = htons(sport);
+
+    } else {
+        LOG_WARN("%s: Invalid PROXY header from cluster node: %s", client.c_ip, hdr);
+        return PROXY_NONE;
+    }
+
+    LOG_INFO("%s: Router %s:%u forwarded by a cluster node", client.c_ip, src, sport);
+
+    snprintf(client.c_ip, sizeof(client.c_ip), "%s", src);
+    snprintf(client.c_port, sizeof(client.c_port), "%u", sport);
+
+    return PROXY_FORWARDED;
+}
+
+/**
+ * Produce the heartbeat of this node
+ *
+ * \param [in] leave        True to produce a tombstone
+ */
+void ClusterManager::heartbeat(bool leave) {
+    std::string value;
+
+    if (not leave) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ostringstream out;
+
+        self.timestamp = time(NULL);
+
+        out << self.node_id << '\t' << self.address << '\t' << (self.draining ? "draining" : "active") << '\t'
+            << self.capacity << '\t' << self.load << '\t' << self.routers << '\t' << self.timestamp;
+        value = out.str();
+    }
+
+    RdKafka::ErrorCode err = producer->produce(topic, RdKafka::Topic::PARTITION_UA, RdKafka::Producer::RK_MSG_COPY,
+                                               leave ? NULL : (void *)value.data(), value.size(),
+                                               &self.node_id, NULL);
+
+    if (err != RdKafka::ERR_NO_ERROR)
+        LOG_WARN("Failed to produce the cluster heartbeat, error = %d", err);
+
+    producer->poll(0);
+}
+
+/**
+ * Apply a heartbeat of another node
+ */
+void ClusterManager::receive(RdKafka::Message *msg) {
+    if (msg->err() != RdKafka::ERR_NO_ERROR or msg->key() == NULL or *msg->key() == self.node_id)
+        return;
+
+    const std::string &node_id = *msg->key();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Tombstone of a stopped node
+    if (msg->len() == 0) {
+        if (members.erase(node_id) > 0)
+            LOG_INFO("Cluster node %s left", node_id.c_str());
+        return;
+    }
+
+    std::istringstream in(std::string((const char *)msg->payload(), msg->len()));
+    std::vector<std::string> fields;
+    std::string field;
+
+    while (std::getline(in, field, '\t'))
+        fields.push_back(field);
+
+    if (fields.size() < 7) {
+        LOG_WARN("Ignoring invalid heartbeat of cluster node %s", node_id.c_str());
+        return;
+    }
+
+    Member node;
+    node.node_id = node_id;
+    node.address = fields[1];
+    node.draining = fields[2] == "draining";
+    node.capacity = strtod(fields[3].c_str(), NULL);
+    node.load = strtod(fields[4].c_str(), NULL);
+    node.routers = atoi(fields[5].c_str());
+    node.timestamp = strtoll(fields[6].c_str(), NULL, 10);
+
+    std::map<std::string, Member>::iterator it = members.find(node_id);
+
+    if (it == members.end()) {
+        if (time(NULL) - node.timestamp <= cfg->cluster_node_timeout)
+            LOG_INFO("Cluster node %s joined, address %s, capacity %.0f", node_id.c_str(), node.address.c_str(),
+                     node.capacity);
+
+    } else if (node.draining and not it->second.draining) {
+        LOG_INFO("Cluster node %s is draining", node_id.c_str());
+    }
+
+    members[node_id] = node;
+}
+
+/**
+ * Split an ip:port or [ip]:port address
+ *
+ * \return false if the address has no port
+ */
+bool ClusterManager::splitAddress(const std::string &address, std::string &ip, std::string &port) {
+    size_t sep = address.rfind(':');
+    if (sep == std::string::npos or sep + 1 >= address.size())
+        return false;
+
+    ip = address.substr(0, sep);
+    port = address.substr(sep + 1);
+
+    if (ip.size() >= 2 and ip[0] == '[' and ip[ip.size() - 1] == ']')
+        ip = ip.substr(1, ip.size() - 2);
+
+    return true;
+}
+
+/**
+ * Connect to the address of a node
+ *
+ * \return socket, -1 if not connected
+ */
+int ClusterManager::connectNode(const std::string &address) {
+    std::string ip, port;
+    if (not splitAddress(address, ip, port))
+        return -1;
+
+    addrinfo hints, *res = NULL;
+    bzero(&hints, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+
+    if (getaddrinfo(ip.c_str(), port.c_str(), &hints, &res) != 0 or res == NULL)
+        return -1;
+
+    int sock = socket(res->ai_family, SOCK_STREAM, 0);
+
+    if (sock >= 0) {
+        // Connect with a timeout, the accept loop waits for it
+        int flags = fcntl(sock, F_GETFL, 0);
+        fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+
+        int ret = connect(sock, res->ai_addr, res->ai_addrlen);
+
+        if (ret < 0 and errno == EINPROGRESS) {
+            pollfd pfd = { sock, POLLOUT, 0 };
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+
+            if (poll(&pfd, 1, CLUSTER_CONNECT_TIMEOUT_MS) == 1 and
+                    getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 and err == 0)
+                ret = 0;
+        }
+
+        if (ret == 0) {
+            fcntl(sock, F_SETFL, flags);
+        } else {
+            close(sock);
+            sock = -1;
+        }
+    }
+
+    freeaddrinfo(res);
+    return sock;
+}
+
+/**
+ * Copy the stream of a forwarded router between the router and the owner
+ */
+void ClusterManager::forwardLoop(Forward *fwd) {
+    char *buf = new char[CLUSTER_FORWARD_BUF_SIZE];
+    pollfd pfd[2];
+
+    pfd[0].fd = fwd->router_sock;
+    pfd[1].fd = fwd->owner_sock;
+
+    while (running) {
+        pfd[0].events = pfd[1].events = POLLIN;
+        pfd[0].revents = pfd[1].revents = 0;
+
+        int ready = poll(pfd, 2, 1000);
+        if (ready < 0 and errno != EINTR)
+            break;
+
+        bool closed = false;
+
+        for (int i = 0; i < 2 and ready > 0 and not closed; i++) {
+            if (pfd[i].revents == 0)
+                continue;
+
+            ssize_t len = read(pfd[i].fd, buf, CLUSTER_FORWARD_BUF_SIZE);
+            if (len < 0 and (errno == EINTR or errno == EAGAIN))
+                continue;
+
+            else if (len <= 0) {
+                closed = true;
+                break;
+            }
+
+            for (ssize_t sent = 0; sent < len; ) {
+                ssize_t n = send(pfd[1 - i].fd, buf + sent, len - sent, MSG_NOSIGNAL);
+                if (n < 0 and errno == EINTR)
+                    continue;
+
+                else if (n <= 0) {
+                    closed = true;
+                    break;
+                }
+                sent += n;
+            }
+        }
+
+        if (closed)
+            break;
+    }
+
+    // The other side sees the close, the sockets are closed once joined
+    shutdown(fwd->router_sock, SHUT_RDWR);
+    shutdown(fwd->owner_sock, SHUT_RDWR);
+
+    delete [] buf;
+    fwd->done = true;
+}
+
+/**
+ * Join the threads of the forwarded connections that are done, mutex must be held
+ *
+ * \param [in] all          True to join all, the connections are closed first
+ */
+void ClusterManager::reapForwards(bool all) {
+    for (size_t i = 0; i < forwards.size(); ) {
+        Forward *fwd = forwards[i];
+
+        if (not all and not fwd->done) {
+            i++;
+            continue;
+        }
+
+        if (all) {
+            shutdown(fwd->router_sock, SHUT_RDWR);
+            shutdown(fwd->owner_sock, SHUT_RDWR);
+        }
+
+        fwd->thread->join();
+        delete fwd->thread;
+
+        close(fwd->router_sock);
+        close(fwd->owner_sock);
+
+        LOG_INFO("%s: Forwarded router connection closed", fwd->router.c_str());
+
+        delete fwd;
+        forwards.erase(forwards.begin() + i);
+    }
+}
+
+/**
+ * Heartbeat and membership thread
+ */
+void ClusterManager::run() {
+    time_t last_heartbeat = time(NULL);
+
+    while (running) {
+        RdKafka::Message *msg = consumer->consume(1000);
+
+        if (msg != NULL) {
+            receive(msg);
+            delete msg;
+        }
+
+        if (time(NULL) - last_heartbeat >= cfg->cluster_heartbeat_interval) {
+            heartbeat(false);
+            last_heartbeat = time(NULL);
+        }
+
+        producer->poll(0);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        reapForwards(false);
+    }
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef CLUSTERMANAGER_H_
+#define CLUSTERMANAGER_H_
+
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <librdkafka/rdkafkacpp.h>
+
+#include "Logger.h"
+#include "Config.h"
+#include "BMPListener.h"
+
+#define CLUSTER_FORWARD_BUF_SIZE    65536       ///< Bytes copied at a time by a forwarded router connection
+#define CLUSTER_PROXY_HDR_MAX       108         ///< Max length of a PROXY protocol v1 header, including CRLF
+#define CLUSTER_CONNECT_TIMEOUT_MS  2000        ///< Max wait to connect to the node that owns a router
+#define CLUSTER_PROXY_WAIT_MS       1000        ///< Max wait for the PROXY header of a connection from a member
+
+/**
+ * \class   ClusterManager
+ *
+ * \brief   Assigns routers over a cluster of collectors
+ * \details The nodes share membership through a compacted kafka topic (cluster.topic), each
+ *          node produces a heartbeat keyed by its node ID with its forwarding address, state,
+ *          capacity and load, and reads the heartbeats of the others.  A node without a
+ *          heartbeat for cluster.node_timeout seconds is down; a stopped node produces a
+ *          tombstone.
+ *
+ *          A router is owned by the node with the highest weighted rendezvous hash of the
+ *          router address.  The weight of a node is its capacity (cluster.weight or CPU cores)
+ *          divided by 1 + its load relative to the mean load of the cluster; the load is the
+ *          sum of the dump times (router baselines) of the routers it collects.  Only new
+ *          connections are assigned, a router stays on the node that is collecting it.
+ *
+ *          A node that accepts a router owned by another node forwards the TCP stream to the
+ *          owner, prefixed with a PROXY protocol v1 header of the router address.  The owner
+ *          uses the router address of the header, so together with the collector hash ID
+ *          shared by the cluster (from cluster.name) the router hash ID doesn't depend on the
+ *          node.  Forwarded connections are never forwarded again.
+ *
+ *          A draining node is not assigned new routers and hands its routers off one at a
+ *          time by closing their connection; they reconnect to their new owner.
+ */
+class ClusterManager {
+public:
+    /**
+     * Result of readProxyHeader()
+     */
+    enum ProxyResult {
+        PROXY_NONE,                             ///< Not forwarded, collected as a router
+        PROXY_FORWARDED,                        ///< Forwarded by another node, the router address is set
+        PROXY_PENDING                           ///< From a member but the header hasn't arrived yet
+    };
+
+    /**
+     * Node of the cluster, from its heartbeat
+     */
+    struct Member {
+        std::string node_id;                ///< Node ID
+        std::string address;                ///< Address (ip:port) routers are forwarded to
+        bool        draining;               ///< Node is not assigned new routers
+        double      capacity;               ///< Capacity of the node
+        double      load;                   ///< Sum of the dump times of the routers of the node
+        int         routers;                ///< Number of routers collected by the node
+        time_t      timestamp;              ///< Time of the heartbeat
+    };
+
+    /**
+     * Join the cluster, if cluster.enabled
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     *
+     * \throw (const char *) if the kafka producer or consumer can't be created
+     */
+    static void start(Logger *logPtr, Config *cfg);
+
+    /**
+     * Leave the cluster, closes the forwarded connections
+     */
+    static void stop();
+
+    /**
+     * Indicates if the cluster is enabled and started
+     */
+    static bool enabled();
+
+    /**
+     * Update the load of this node, published by the next heartbeat
+     *
+     * \param [in] routers      Number of routers collected by the node
+     * \param [in] load         Sum of the dump times of the routers in seconds
+     */
+    static void setLoad(int routers, double load);
+
+    /**
+     * Forward an accepted router connection if it's owned by another node
+     *
+     * \details The forwarded connection is owned by the cluster manager, the client socket
+     *          must not be used by the caller.  If the owner can't be reached the router is
+     *          collected by this node.
+     *
+     * \param [in] client       Accepted client connection
+     *
+     * \return true if forwarded, false if the router is collected by this node
+     */
+    static bool forward(BMPListener::ClientInfo &client);
+
+    /**
+     * Read the PROXY protocol header of a connection forwarded by another node
+     *
+     * \details Only connections from the address of a member are checked.  The client
+     *          address and port are replaced by those of the router.  Doesn't wait, the
+     *          header is read once it has fully arrived.
+     *
+     * \param [in,out] client   Accepted client connection
+     *
+     * \return PROXY_FORWARDED if forwarded by another node, PROXY_PENDING if the header
+     *         hasn't arrived yet, otherwise PROXY_NONE
+     */
+    static int readProxyHeader(BMPListener::ClientInfo &client);
+
+    /**
+     * Start draining this node, new routers are assigned to the other nodes
+     */
+    static void drain();
+
+    /**
+     * Indicates if this node is draining
+     */
+    static bool draining();
+
+private:
+    /**
+     * Connection of a router forwarded to its owner
+     */
+    struct Forward {
+        int                 router_sock;    ///< Socket of the router
+        int                 owner_sock;     ///< Socket to the owner node
+        std::string         router;         ///< Router address, printed form
+        std::thread         *thread;        ///< Thread copying the stream
+        std::atomic<bool>   done;           ///< Both sockets are closed, the thread can be joined
+    };
+
+    static std::mutex                       mutex;          ///< Guards members, self and forwards
+    static std::map<std::string, Member>    members;        ///< Other nodes by node ID
+    static Member                           self;           ///< This node
+    static std::vector<Forward *>           forwards;       ///< Forwarded router connections
+    static std::thread                      *thread;        ///< Heartbeat and membership thread
+    static std::atomic<bool>                running;
+    static Config                           *cfg;
+    static Logger                           *logger;
+
+    static RdKafka::Producer                *producer;      ///< Producer of the heartbeats
+    static RdKafka::Topic                   *topic;         ///< Membership topic
+    static RdKafka::KafkaConsumer           *consumer;      ///< Consumer of the membership topic
+
+    /**
+     * Find the owner of a router, mutex must be held
+     *
+     * \param [in] router       Router address, printed form
+     *
+     * \return Owner of the router, NULL if this node
+     */
+    static const Member *owner(const std::string &router);
+
+    /**
+     * Produce the heartbeat of this node
+     *
+     * \param [in] leave        True to produce a tombstone
+     */
+    static void heartbeat(bool leave);
+
+    /**
+     * Apply a heartbeat of another node
+     */
+    static void receive(RdKafka::Message *msg);
+
+    /**
+     * Connect to the address of a node
+     *
+     * \return socket, -1 if not connected
+     */
+    static int connectNode(const std::string &address);
+
+    /**
+     * Split an ip:port or [ip]:port address
+     *
+     * \return false if the address has no port
+     */
+    static bool splitAddress(const std::string &address, std::string &ip, std::string &port);
+
+    /**
+     * Copy the stream of a forwarded router between the router and the owner
+     */
+    static void forwardLoop(Forward *fwd);
+
+    /**
+     * Join the threads of the forwarded connections that are done, mutex must be held
+     *
+     * \param [in] all          True to join all, the connections are closed first
+     */
+    static void reapForwards(bool all);
+
+    /**
+     * Heartbeat and membership thread
+     */
+    static void run();
+};
+
+#endif /* CLUSTERMANAGER_H_ */
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include "CollectorState.h"
+#include "HostResolver.h"
+
+std::mutex                              CollectorState::mutex;
+std::condition_variable                 CollectorState::stop_cond;
+std::map<std::string, CollectorState::Peer> CollectorState::peers;
+std::thread                             *CollectorState::thread = NULL;
+bool                                    CollectorState::running = false;
+std::string                             CollectorState::saved;
+Config                                  *CollectorState::cfg = NULL;
+Logger                                  *CollectorState::logger = NULL;
+
+/*
+ * Big endian encoding of the record fields
+ */
+static void put8(std::string &out, uint8_t v) {
+    out.push_back((char)v);
+}
+
+static void put16(std::string &out, uint16_t v) {
+    put8(out, v >> 8);
+    put8(out, v & 0xff);
+}
+
+static void put32(std::string &out, uint32_t v) {
+    put16(out, v >> 16);
+    put16(out, v & 0xffff);
+}
+
+static void putStr(std::string &out, const std::string &v) {
+    size_t len = v.size() < 255 ? v.size() : 255;
+
+    put8(out, len);
+    out.append(v, 0, len);
+}
+
+static void putRecord(std::string &out, uint8_t type, const std::string &value) {
+    put8(out, type);
+    put16(out, value.size());
+    out.append(value);
+}
+
+/**
+ * Reader of the record fields, fails once a field is past the end
+ */
+struct StateReader {
+    const u_char    *p;
+    size_t          len;
+    bool            ok;
+
+    StateReader(const u_char *data, size_t size) : p(data), len(size), ok(true) { }
+
+    bool need(size_t size) {
+        if (len < size)
+            ok = false;
+
+        return ok;
+    }
+
+    uint8_t get8() {
+        if (not need(1))
+            return 0;
+
+        len--;
+        return *p++;
+    }
+
+    uint16_t get16() {
+        uint16_t v = get8() << 8;
+        return v | get8();
+    }
+
+    uint32_t get32() {
+        uint32_t v = (uint32_t)get16() << 16;
+        return v | get16();
+    }
+
+    std::string getBytes(size_t size) {
+        if (not need(size))
+            return "";
+
+        std::string v((const char *)p, size);
+        p += size;
+        len -= size;
+        return v;
+    }
+
+    std::string getStr() {
+        return getBytes(get8());
+    }
+};
+
+/**
+ * Load the state file and start the checkpoint thread
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfgPtr       Pointer to the config instance
+ */
+void CollectorState::start(Logger *logPtr, Config *cfgPtr) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running or cfgPtr->state_file.empty())
+        return;
+
+    logger = logPtr;
+    cfg = cfgPtr;
+
+    load();
+
+    running = true;
+    thread = new std::thread(CollectorState::run);
+}
+
+/**
+ * Stop the checkpoint thread and save the state
+ */
+void CollectorState::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (not running)
+            return;
+
+        running = false;
+    }
+
+    stop_cond.notify_all();
+
+    thread->join();
+    delete thread;
+    thread = NULL;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    save();
+}
+
+/**
+ * Get the saved capabilities of a peer
+ *
+ * \param [in]  router_hash     Router hash id (raw 16 bytes)
+ * \param [in]  peer_key        Key of the peer in the reader peer info map
+ * \param [out] peer            Capabilities of the peer
+ *
+ * \return true if the peer is known
+ */
+bool CollectorState::getPeer(const u_char *router_hash, const std::string &peer_key, Peer &peer) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (not running)
+        return false;
+
+    std::map<std::string, Peer>::iterator it = peers.find(std::string((const char *)router_hash, 16) + peer_key);
+    if (it == peers.end())
+        return false;
+
+    peer = it->second;
+    return true;
+}
+
+/**
+ * Save the capabilities of a peer, written by the next checkpoint
+ *
+ * \param [in] router_hash      Router hash id (raw 16 bytes)
+ * \param [in] peer_key         Key of the peer in the reader peer info map
+ * \param [in] peer             Capabilities of the peer
+ */
+void CollectorState::setPeer(const u_char *router_hash, const std::string &peer_key, const Peer &peer) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running)
+        peers[std::string((const char *)router_hash, 16) + peer_key] = peer;
+}
+
+/**
+ * Load the state file, mutex must be held
+ *
+ * \details Baselines already loaded from startup.baseline_file are kept.
+ */
+void CollectorState::load() {
+    std::ifstream in(cfg->state_file.c_str(), std::ios::in | std::ios::binary);
+    if (not in)
+        return;
+
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string file = ss.str();
+
+    size_t magic_len = strlen(COLLECTOR_STATE_MAGIC);
+    StateReader rd((const u_char *)file.data(), file.size());
+
+    if (rd.getBytes(magic_len) != COLLECTOR_STATE_MAGIC or rd.get8() != COLLECTOR_STATE_VERSION) {
+        LOG_WARN("State file %s is not a version %d state file, ignoring it", cfg->state_file.c_str(),
+                 COLLECTOR_STATE_VERSION);
+        return;
+    }
+
+    size_t baselines = 0, hosts = 0;
+
+    while (rd.ok and rd.len > 0) {
+        uint8_t type = rd.get8();
+        std::string value = rd.getBytes(rd.get16());
+        if (not rd.ok)
+            break;
+
+        StateReader rec((const u_char *)value.data(), value.size());
+
+        switch (type) {
+            case RECORD_BASELINE : {
+                std::string hash_id = rec.getBytes(16);
+                float secs = rec.get32() / 10.0;
+
+                if (rec.ok) {
+                    std::lock_guard<std::mutex> baseline_lock(cfg->baseline_mutex);
+                    cfg->router_baseline_time.insert(std::make_pair(hash_id, secs));
+                    ++baselines;
+                }
+                break;
+            }
+
+            case RECORD_PEER : {
+                std::string key = rec.getBytes(16);
+                key += rec.getStr();
+
+                Peer peer;
+                uint8_t flags = rec.get8();
+                peer.sent_four_octet_asn = flags & 0x01;
+                peer.recv_four_octet_asn = flags & 0x02;
+                peer.using_2_octet_asn = flags & 0x04;
+
+                for (int count = rec.get8(); rec.ok and count > 0; count--) {
+                    uint16_t afi = rec.get16();
+                    uint8_t safi = rec.get8();
+                    peer.add_path.push_back(std::make_pair(afi, safi));
+                }
+
+                if (rec.ok)
+                    peers[key] = peer;
+                break;
+            }
+
+            case RECORD_HOST : {
+                std::string addr = rec.getStr();
+
+                HostResolver::Entry entry;
+                entry.hostname = rec.getStr();
+                entry.expires = rec.get32();
+
+                if (rec.ok) {
+                    HostResolver::addCached(addr, entry);
+                    ++hosts;
+                }
+                break;
+            }
+
+            default :
+                break;
+        }
+    }
+
+    if (not rd.ok)
+        LOG_WARN("State file %s is truncated, using the records before the end", cfg->state_file.c_str());
+
+    LOG_INFO("Loaded %zu router baselines, %zu peers and %zu hostnames from %s", baselines, peers.size(),
+             hosts, cfg->state_file.c_str());
+}
+
+/**
+ * Save the state file if the state changed, mutex must be held
+ */
+void CollectorState::save() {
+    std::string out(COLLECTOR_STATE_MAGIC);
+    std::string value;
+
+    put8(out, COLLECTOR_STATE_VERSION);
+
+    {
+        std::lock_guard<std::mutex> baseline_lock(cfg->baseline_mutex);
+
+        for (Config::router_baseline_time_iter it = cfg->router_baseline_time.begin();
+                it != cfg->router_baseline_time.end(); ++it) {
+            value.assign(it->first);
+            put32(value, it->second * 10 + 0.5);
+            putRecord(out, RECORD_BASELINE, value);
+        }
+    }
+
+    for (std::map<std::string, Peer>::iterator it = peers.begin(); it != peers.end(); ++it) {
+        Peer &peer = it->second;
+        size_t count = peer.add_path.size() < 255 ? peer.add_path.size() : 255;
+
+        value.assign(it->first, 0, 16);
+        putStr(value, it->first.substr(16));
+        put8(value, (peer.sent_four_octet_asn ? 0x01 : 0) | (peer.recv_four_octet_asn ? 0x02 : 0) |
+                    (peer.using_2_octet_asn ? 0x04 : 0));
+        put8(value, count);
+
+        for (size_t i = 0; i < count; i++) {
+            put16(value, peer.add_path[i].first);
+            put8(value, peer.add_path[i].second);
+        }
+
+        putRecord(out, RECORD_PEER, value);
+    }
+
+    std::vector<std::pair<std::string, HostResolver::Entry> > hosts;
+    HostResolver::getCached(hosts);
+
+    for (size_t i = 0; i < hosts.size(); i++) {
+        value.clear();
+        putStr(value, hosts[i].first);
+        putStr(value, hosts[i].second.hostname);
+        put32(value, hosts[i].second.expires);
+        putRecord(out, RECORD_HOST, value);
+    }
+
+    if (out == saved)
+        return;
+
+    // Replace the file only once it's complete
+    std::string tmp_file = cfg->state_file + ".tmp";
+    FILE *fp = fopen(tmp_file.c_str(), "w");
+
+    if (fp == NULL) {
+        LOG_WARN("Unable to save the collector state to %s: %s", tmp_file.c_str(), strerror(errno));
+        return;
+    }
+
+    bool written = fwrite(out.data(), 1, out.size(), fp) == out.size();
+
+    if (fclose(fp) != 0 or not written or rename(tmp_file.c_str(), cfg->state_file.c_str()) != 0) {
+        LOG_WARN("Unable to save the collector state to %s: %s", cfg->state_file.c_str(), strerror(errno));
+        return;
+    }
+
+    saved.swap(out);
+}
+
+/**
+ * Checkpoint thread
+ */
+void CollectorState::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (running) {
+        stop_cond.wait_for(lock, std::chrono::seconds(cfg->state_interval));
+
+        if (running)
+            save();
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef COLLECTORSTATE_H_
+#define COLLECTORSTATE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Logger.h"
+#include "Config.h"
+
+#define COLLECTOR_STATE_MAGIC       "OBMPSTAT"  ///< First bytes of the state file
+#define COLLECTOR_STATE_VERSION     1           ///< Version of the state file records
+
+/**
+ * \class   CollectorState
+ *
+ * \brief   Checkpoints the learned collector state so it's known after a restart
+ * \details The state is the router baseline (RIB dump) times, the capabilities of the peers
+ *          (4 octet ASN and add path, by router hash and peer) and the reverse DNS lookups
+ *          that the router and peer groups are matched by.  It's written to
+ *          startup.state_file every startup.state_interval seconds when changed, and at stop.
+ *
+ *          With the baselines restored, the routers reconnecting after a restart hold their
+ *          concurrent router slot for their known dump time instead of initial_router_time.
+ *          Restored peer capabilities are used until the next PEER_UP of the peer.
+ *
+ *          The file is a magic, a version and type/length/value records; unknown records are
+ *          skipped.
+ */
+class CollectorState {
+public:
+    /**
+     * Capabilities of a peer
+     */
+    struct Peer {
+        bool    sent_four_octet_asn;                    ///< Sent OPEN has the 4 octet ASN capability
+        bool    recv_four_octet_asn;                    ///< Received OPEN has the 4 octet ASN capability
+        bool    using_2_octet_asn;                      ///< Peer uses 2 octet ASNs in the AS path
+        std::vector<std::pair<uint16_t, uint8_t> > add_path;  ///< AFI/SAFIs add path is enabled for
+    };
+
+    /**
+     * Load the state file and start the checkpoint thread
+     *
+     * \details Does nothing if startup.state_file is not set.  A missing file is not an
+     *          error, it's created by the first checkpoint.
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     */
+    static void start(Logger *logPtr, Config *cfg);
+
+    /**
+     * Stop the checkpoint thread and save the state
+     */
+    static void stop();
+
+    /**
+     * Get the saved capabilities of a peer
+     *
+     * \param [in]  router_hash     Router hash id (raw 16 bytes)
+     * \param [in]  peer_key        Key of the peer in the reader peer info map
+     * \param [out] peer            Capabilities of the peer
+     *
+     * \return true if the peer is known
+     */
+    static bool getPeer(const u_char *router_hash, const std::string &peer_key, Peer &peer);
+
+    /**
+     * Save the capabilities of a peer, written by the next checkpoint
+     *
+     * \param [in] router_hash      Router hash id (raw 16 bytes)
+     * \param [in] peer_key         Key of the peer in the reader peer info map
+     * \param [in] peer             Capabilities of the peer
+     */
+    static void setPeer(const u_char *router_hash, const std::string &peer_key, const Peer &peer);
+
+private:
+    /**
+     * Record types of the state file
+     */
+    enum Record {
+        RECORD_BASELINE=1,                      ///< Router hash, baseline time in 1/10 of seconds
+        RECORD_PEER,                            ///< Router hash, peer key and capabilities
+        RECORD_HOST                             ///< Address, hostname and the time the lookup expires
+    };
+
+    static std::mutex                       mutex;
+    static std::condition_variable          stop_cond;      ///< Signaled to stop the checkpoint thread
+    static std::map<std::string, Peer>      peers;          ///< Peers by router hash and peer key, guarded by mutex
+    static std::thread                      *thread;        ///< Checkpoint thread, NULL if not running
+    static bool                             running;
+    static std::string                      saved;          ///< Content of the last saved file
+    static Config                           *cfg;
+    static Logger                           *logger;
+
+    /**
+     * Load the state file
+     */
+    static void load();
+
+    /**
+     * Save the state file if the state changed
+     */
+    static void save();
+
+    /**
+     * Checkpoint thread
+     */
+    static void run();
+};
+
+#endif /* COLLECTORSTATE_H_ */
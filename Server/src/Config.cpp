@@ -8,6 +8,9 @@
  */
 
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cerrno>
 #include <string>
 #include <list>
 #include <cstring>
@@ -15,6 +18,7 @@
 #include <unistd.h>
 
 #include <arpa/inet.h>
+#include <sys/un.h>
 #include <yaml-cpp/yaml.h>
 #include <boost/xpressive/xpressive.hpp>
 #include <boost/exception/all.hpp>
@@ -35,11 +39,41 @@ Config::Config() {
     debug_bmp           = false;
     debug_msgbus        = false;
     bmp_buffer_size     = 15 * 1024 * 1024; // 15MB
+    bmp_ring_buffer     = false;
+    bmp_buffer_hugepages = RecvBuffer::HUGEPAGES_OFF;
+    bmp_buffer_release  = 4 * 1024 * 1024; // 4MB
+    bmp_batch_size      = 1;
+    bmp_raw_passthrough = false;
+    bmp_raw_batch_bytes = 256 * 1024;   // Default is 256KB
+    attr_cache_size     = 0;
+    adj_rib_in          = false;
+    adj_rib_in_dedup    = true;
+    adj_rib_in_resync_rate = 0;
+    router_workers      = 0;            // Default is a thread per router
+    router_workers_pin  = false;
+    router_workers_uring = false;
+    parse_threads       = 0;            // Default is to decode in the router thread
+    parse_max_pending   = 10000;
+    placement_policy    = "none";
     svr_ipv6            = false;
     svr_ipv4            = true;
     bind_ipv4           = "";
     bind_ipv6           = "";
+    socket_listeners    = 1;
+    socket_backlog      = 128;
+    socket_rcvbuf       = 0;            // Default is the system default
+    socket_quickack     = false;
+    socket_busy_poll    = 0;
+    socket_incoming_cpu = false;
     heartbeat_interval  = 60 * 5;        // Default is 5 minutes
+    log_async           = false;
+    log_rate_limit      = 1000;
+    metrics_port        = 0;            // Default is disabled
+    metrics_listen_ip   = "0.0.0.0";
+    metrics_control_socket = "";        // Default is disabled
+    resolver_threads    = 2;
+    resolver_timeout    = 0;            // Default is to wait for the lookup
+    resolver_cache_time = 3600;         // Default is 1 hour
     kafka_brokers       = "localhost:9092";
     tx_max_bytes        = 1000000;
     rx_max_bytes        = 100000000;
@@ -50,10 +84,42 @@ Config::Config() {
     msg_send_max_retry  = 2;
     retry_backoff_ms    = 100;
     compression         = "snappy";
+    kafka_producers     = 0;            // Default is a producer per router
+    kafka_priority_lane = false;
+    kafka_spool_dir     = "";           // Default is not spooled
+    kafka_spool_segment_size = 64;
+    kafka_spool_max_size = 4096;
+    partitioner         = "murmur2";
+    partition_key       = "peer";
+    rd_format           = "legacy";
+    kafka_coalesce_max_bytes = 65536;
+    kafka_coalesce_max_ms = 5;
+    kafka_zero_copy_min_bytes = 262144;
+    ls_delta            = false;
+    ls_snapshot_interval = 3600;        // Default is 1 hour
     max_concurrent_routers = 2;
     initial_router_time = 60;
     calculate_baseline  = true;
+    baseline_file       = "";
+    state_file          = "";
+    state_interval      = 60;
+    admission_control   = false;
+    admission_cpu_max   = 90;
     pat_enabled		= false;
+    hash_algorithm      = "md5";
+    msgbus_backend      = "kafka";
+    msgbus_shm_prefix   = "/openbmp.";
+    msgbus_shm_size     = 64 * 1024 * 1024; // 64MB
+    parsed_outputs      = MSGBUS_OUTPUT_ALL;
+    cluster_enabled     = false;
+    cluster_name        = "openbmp";
+    cluster_node_id     = "";           // Default is admin_id
+    cluster_address     = "";
+    cluster_topic       = "openbmp.cluster";
+    cluster_weight      = 0;            // Default is the number of CPU cores
+    cluster_heartbeat_interval = 5;
+    cluster_node_timeout = 20;
+    cluster_drain_interval = 5;
     bzero(admin_id, sizeof(admin_id));
 
     /*
@@ -103,8 +169,12 @@ void Config::load(const char *cfg_filename) {
                         parseDebug(node);
                     else if (key.compare("kafka") == 0)
                         parseKafka(node);
+                    else if (key.compare("msgbus") == 0)
+                        parseMsgBus(node);
                     else if (key.compare("mapping") == 0)
                         parseMapping(node);
+                    else if (key.compare("cluster") == 0)
+                        parseCluster(node);
 
                     else if (debug_general)
                         std::cout << "   Config: Key " << key << " Type " << node.Type() << std::endl;
@@ -126,10 +196,155 @@ void Config::load(const char *cfg_filename) {
         throw err.what();
     }
 
+    compileGroupMatchers();
+
+    if (calculate_baseline and baseline_file.size() > 0)
+        loadBaselines();
+
     if (debug_general)
         std::cout << "---| Done Loading configuration file |------------------------- " << std::endl;
 }
 
+/*********************************************************************//**
+ * Get the baseline time of a router
+ *
+ * \param [in]  hash_id     Router hash id (raw 16 bytes)
+ * \param [out] secs        Baseline time in seconds, not changed if not known
+ *
+ * \return true if the router baseline time is known
+ ***********************************************************************/
+bool Config::getRouterBaseline(const std::string &hash_id, int &secs) {
+    std::lock_guard<std::mutex> lock(baseline_mutex);
+
+    router_baseline_time_iter it = router_baseline_time.find(hash_id);
+    if (it == router_baseline_time.end())
+        return false;
+
+    secs = it->second;
+    return true;
+}
+
+/*********************************************************************//**
+ * Get the outputs of a router or peer
+ *
+ * \param [in] router_group    Router group name, empty if not matched
+ * \param [in] peer_group      Peer group name, empty if not matched or a router
+ *
+ * \return MSGBUS_OUTPUT_* bits enabled by the topics and the outputs of both groups
+ ***********************************************************************/
+uint32_t Config::getOutputs(const std::string &router_group, const std::string &peer_group) const {
+    uint32_t outputs = parsed_outputs;
+    group_outputs_iter it;
+
+    // Groups without an outputs list use all enabled topics
+    if (router_group.size() > 0 and (it = router_group_outputs.find(router_group)) != router_group_outputs.end())
+        outputs &= it->second;
+
+    if (peer_group.size() > 0 and (it = peer_group_outputs.find(peer_group)) != peer_group_outputs.end())
+        outputs &= it->second;
+
+    return outputs;
+}
+
+/*********************************************************************//**
+ * Get the MSGBUS_OUTPUT_* bit of a topic var
+ *
+ * \param [in] topic_var       Topic var MSGBUS_TOPIC_VAR_*
+ *
+ * \return Output bit, 0 if the topic is not a parsed output (e.g. collector)
+ ***********************************************************************/
+uint32_t Config::outputBit(const std::string &topic_var) {
+    if (topic_var == MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE)       return MSGBUS_OUTPUT_BASE_ATTRIBUTE;
+    else if (topic_var == MSGBUS_TOPIC_VAR_UNICAST_PREFIX)  return MSGBUS_OUTPUT_UNICAST_PREFIX;
+    else if (topic_var == MSGBUS_TOPIC_VAR_L3VPN)           return MSGBUS_OUTPUT_L3VPN;
+    else if (topic_var == MSGBUS_TOPIC_VAR_EVPN)            return MSGBUS_OUTPUT_EVPN;
+    else if (topic_var == MSGBUS_TOPIC_VAR_LS_NODE)         return MSGBUS_OUTPUT_LS_NODE;
+    else if (topic_var == MSGBUS_TOPIC_VAR_LS_LINK)         return MSGBUS_OUTPUT_LS_LINK;
+    else if (topic_var == MSGBUS_TOPIC_VAR_LS_PREFIX)       return MSGBUS_OUTPUT_LS_PREFIX;
+    else if (topic_var == MSGBUS_TOPIC_VAR_BMP_STAT)        return MSGBUS_OUTPUT_BMP_STAT;
+    else if (topic_var == MSGBUS_TOPIC_VAR_BMP_RAW)         return MSGBUS_OUTPUT_BMP_RAW;
+
+    return 0;
+}
+
+/*********************************************************************//**
+ * Set the baseline time of a router
+ *
+ * \details Saves the baseline times to baseline_file if configured.
+ *
+ * \param [in] hash_id      Router hash id (raw 16 bytes)
+ * \param [in] secs         Baseline time in seconds
+ ***********************************************************************/
+void Config::setRouterBaseline(const std::string &hash_id, float secs) {
+    std::lock_guard<std::mutex> lock(baseline_mutex);
+
+    router_baseline_time[hash_id] = secs;
+
+    if (baseline_file.size() > 0)
+        saveBaselines();
+}
+
+/**
+ * Load the router baseline times from baseline_file
+ *
+ * \details A missing file is not an error, it's created when the first baseline is saved.
+ */
+void Config::loadBaselines() {
+    std::lock_guard<std::mutex> lock(baseline_mutex);
+    std::ifstream in(baseline_file.c_str());
+    std::string   line;
+    char          hex[33];
+    float         secs;
+    u_char        hash_id[16];
+    unsigned int  byte;
+    bool          valid;
+
+    while (std::getline(in, line)) {
+        // Each line is the router hash id in hex and the baseline time in seconds
+        if (sscanf(line.c_str(), "%32s %f", hex, &secs) != 2 or strlen(hex) != 32)
+            continue;
+
+        valid = true;
+        for (int i = 0; valid and i < 16; i++) {
+            valid = sscanf(hex + i * 2, "%2x", &byte) == 1;
+            hash_id[i] = byte;
+        }
+
+        if (valid)
+            router_baseline_time[std::string((char *)hash_id, sizeof(hash_id))] = secs;
+    }
+
+    if (debug_general)
+        std::cout << "   Config: loaded " << router_baseline_time.size() << " router baseline times from "
+                  << baseline_file << std::endl;
+}
+
+/**
+ * Save the router baseline times to baseline_file
+ *
+ * \details Must be called with baseline_mutex locked.
+ */
+void Config::saveBaselines() {
+    std::string tmp_file = baseline_file + ".tmp";
+    FILE        *fp = fopen(tmp_file.c_str(), "w");
+
+    if (fp == NULL) {
+        std::cout << "WARN: unable to save router baseline times to " << tmp_file << ": " << strerror(errno) << std::endl;
+        return;
+    }
+
+    for (router_baseline_time_iter it = router_baseline_time.begin(); it != router_baseline_time.end(); ++it) {
+        for (size_t i = 0; i < it->first.size(); i++)
+            fprintf(fp, "%02x", (u_char)it->first[i]);
+
+        fprintf(fp, " %.1f\n", it->second);
+    }
+
+    // Replace the file only once it's complete
+    if (fclose(fp) != 0 or rename(tmp_file.c_str(), baseline_file.c_str()) != 0)
+        std::cout << "WARN: unable to save router baseline times to " << baseline_file << ": " << strerror(errno) << std::endl;
+}
+
 /**
  * Parse the base configuration
  *
@@ -207,40 +422,426 @@ void Config::parseBase(const YAML::Node &node) {
         }
     }
 
-    if (node["buffers"]) {
-        if (node["buffers"]["router"]) {
+    if (node["buffers"]) {
+        if (node["buffers"]["router"]) {
+            try {
+                bmp_buffer_size = node["buffers"]["router"].as<int>();
+
+                if (bmp_buffer_size < 2 || bmp_buffer_size > 384)
+                    throw "invalid router buffer size, not within range of 2 - 384)";
+
+                bmp_buffer_size *= 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: bmp buffer: " << bmp_buffer_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("buffers.router is not of type int", node["buffers"]["router"]);
+            }
+        }
+
+        if (node["buffers"]["ring"]) {
+            try {
+                bmp_ring_buffer = node["buffers"]["ring"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: bmp ring buffer: " << bmp_ring_buffer << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("buffers.ring is not of type bool", node["buffers"]["ring"]);
+            }
+        }
+
+        if (node["buffers"]["hugepages"]) {
+            try {
+                std::string value = node["buffers"]["hugepages"].as<std::string>();
+
+                if (not RecvBuffer::parseHugepages(value, bmp_buffer_hugepages))
+                    throw "invalid router buffer hugepages, must be off, transparent or explicit";
+
+                if (debug_general)
+                    std::cout << "   Config: bmp buffer hugepages: " << value << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("buffers.hugepages is not of type string", node["buffers"]["hugepages"]);
+            }
+        }
+
+        if (node["buffers"]["release"]) {
+            try {
+                bmp_buffer_release = node["buffers"]["release"].as<int>();
+
+                if (bmp_buffer_release < 0 || bmp_buffer_release > 384)
+                    throw "invalid router buffer release size, not within range of 0 - 384)";
+
+                bmp_buffer_release *= 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: bmp buffer release: " << bmp_buffer_release << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("buffers.release is not of type int", node["buffers"]["release"]);
+            }
+        }
+
+        if (node["buffers"]["batch"]) {
+            try {
+                bmp_batch_size = node["buffers"]["batch"].as<int>();
+
+                if (bmp_batch_size < 1 || bmp_batch_size > 10000)
+                    throw "invalid router batch size, not within range of 1 - 10000)";
+
+                if (debug_general)
+                    std::cout << "   Config: bmp batch size: " << bmp_batch_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("buffers.batch is not of type int", node["buffers"]["batch"]);
+            }
+        }
+    }
+
+    if (node["raw"]) {
+        if (node["raw"]["passthrough"]) {
+            try {
+                bmp_raw_passthrough = node["raw"]["passthrough"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: raw passthrough: " << bmp_raw_passthrough << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("raw.passthrough is not of type bool", node["raw"]["passthrough"]);
+            }
+        }
+
+        if (node["raw"]["batch_size"]) {
+            try {
+                bmp_raw_batch_bytes = node["raw"]["batch_size"].as<int>();
+
+                if (bmp_raw_batch_bytes < 1 || bmp_raw_batch_bytes > 256)
+                    throw "invalid raw batch size, not within range of 1 - 256";
+
+                bmp_raw_batch_bytes *= 1024;
+
+                if (debug_general)
+                    std::cout << "   Config: raw batch size: " << bmp_raw_batch_bytes << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("raw.batch_size is not of type int", node["raw"]["batch_size"]);
+            }
+        }
+    }
+
+    if (node["socket"]) {
+        if (node["socket"]["listeners"]) {
+            try {
+                socket_listeners = node["socket"]["listeners"].as<int>();
+
+                if (socket_listeners < 1 || socket_listeners > 64)
+                    throw "invalid socket listeners, not within range of 1 - 64";
+
+                if (debug_general)
+                    std::cout << "   Config: socket listeners: " << socket_listeners << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("socket.listeners is not of type int", node["socket"]["listeners"]);
+            }
+        }
+
+        if (node["socket"]["backlog"]) {
+            try {
+                socket_backlog = node["socket"]["backlog"].as<int>();
+
+                if (socket_backlog < 1 || socket_backlog > 65535)
+                    throw "invalid socket backlog, not within range of 1 - 65535";
+
+                if (debug_general)
+                    std::cout << "   Config: socket backlog: " << socket_backlog << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("socket.backlog is not of type int", node["socket"]["backlog"]);
+            }
+        }
+
+        if (node["socket"]["rcvbuf"]) {
+            try {
+                socket_rcvbuf = node["socket"]["rcvbuf"].as<int>();
+
+                if (socket_rcvbuf < 0 || socket_rcvbuf > 256)
+                    throw "invalid socket rcvbuf, not within range of 0 - 256";
+
+                socket_rcvbuf *= 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: socket rcvbuf: " << socket_rcvbuf << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("socket.rcvbuf is not of type int", node["socket"]["rcvbuf"]);
+            }
+        }
+
+        if (node["socket"]["quickack"]) {
+            try {
+                socket_quickack = node["socket"]["quickack"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: socket quickack: " << socket_quickack << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("socket.quickack is not of type bool", node["socket"]["quickack"]);
+            }
+        }
+
+        if (node["socket"]["busy_poll"]) {
+            try {
+                socket_busy_poll = node["socket"]["busy_poll"].as<int>();
+
+                if (socket_busy_poll < 0 || socket_busy_poll > 1000)
+                    throw "invalid socket busy_poll, not within range of 0 - 1000";
+
+                if (debug_general)
+                    std::cout << "   Config: socket busy poll: " << socket_busy_poll << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("socket.busy_poll is not of type int", node["socket"]["busy_poll"]);
+            }
+        }
+
+        if (node["socket"]["incoming_cpu"]) {
+            try {
+                socket_incoming_cpu = node["socket"]["incoming_cpu"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: socket incoming cpu: " << socket_incoming_cpu << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("socket.incoming_cpu is not of type bool", node["socket"]["incoming_cpu"]);
+            }
+        }
+    }
+
+    if (node["workers"]) {
+        if (node["workers"]["count"]) {
+            try {
+                router_workers = node["workers"]["count"].as<int>();
+
+                if (router_workers < -1 || router_workers > 256)
+                    throw "invalid router workers count, not within range of -1 - 256)";
+
+                if (debug_general)
+                    std::cout << "   Config: router workers: " << router_workers << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("workers.count is not of type int", node["workers"]["count"]);
+            }
+        }
+
+        if (node["workers"]["pin"]) {
+            try {
+                router_workers_pin = node["workers"]["pin"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: router workers pinned: " << router_workers_pin << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("workers.pin is not of type bool", node["workers"]["pin"]);
+            }
+        }
+
+        if (node["workers"]["io_uring"]) {
+            try {
+                router_workers_uring = node["workers"]["io_uring"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: router workers io_uring: " << router_workers_uring << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("workers.io_uring is not of type bool", node["workers"]["io_uring"]);
+            }
+        }
+
+        if (node["workers"]["parse_threads"]) {
+            try {
+                parse_threads = node["workers"]["parse_threads"].as<int>();
+
+                if (parse_threads < -1 || parse_threads > 256)
+                    throw "invalid parse threads, not within range of -1 - 256)";
+
+                if (debug_general)
+                    std::cout << "   Config: parse threads: " << parse_threads << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("workers.parse_threads is not of type int", node["workers"]["parse_threads"]);
+            }
+        }
+
+        if (node["workers"]["parse_max_pending"]) {
+            try {
+                parse_max_pending = node["workers"]["parse_max_pending"].as<int>();
+
+                if (parse_max_pending < 1 || parse_max_pending > 1000000)
+                    throw "invalid parse max pending, not within range of 1 - 1000000)";
+
+                if (debug_general)
+                    std::cout << "   Config: parse max pending: " << parse_max_pending << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("workers.parse_max_pending is not of type int", node["workers"]["parse_max_pending"]);
+            }
+        }
+    }
+
+    if (node["placement"]) {
+        if (node["placement"]["policy"]) {
+            try {
+                placement_policy = node["placement"]["policy"].as<std::string>();
+
+                if (placement_policy != "none" && placement_policy != "node" && placement_policy != "core")
+                    throw "invalid placement policy, should be none, node or core";
+
+                if (debug_general)
+                    std::cout << "   Config: placement policy: " << placement_policy << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("placement.policy is not of type string", node["placement"]["policy"]);
+            }
+        }
+    }
+
+    if (node["heartbeat"]) {
+        if (node["heartbeat"]["interval"]) {
+            try {
+                heartbeat_interval = node["heartbeat"]["interval"].as<int>();
+
+                if (heartbeat_interval < 1 || heartbeat_interval > 1440)
+                    throw "invalid heartbeat interval not within range of 1 - 1440)";
+
+                heartbeat_interval *= 60;   // minutes to seconds
+
+                if (debug_general)
+                    std::cout << "   Config: heartbeat interval: " << heartbeat_interval << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("heartbeat.router is not of type int", node["heartbeat"]["interval"]);
+            }
+        }
+    }
+
+    if (node["log"]) {
+        if (node["log"]["async"]) {
+            try {
+                log_async = node["log"]["async"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: log async: " << log_async << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("log.async is not of type bool", node["log"]["async"]);
+            }
+        }
+
+        if (node["log"]["rate_limit"]) {
+            try {
+                log_rate_limit = node["log"]["rate_limit"].as<int>();
+
+                if (log_rate_limit < 0 || log_rate_limit > 1000000)
+                    throw "invalid log rate limit, not within range of 0 - 1000000";
+
+                if (debug_general)
+                    std::cout << "   Config: log rate limit: " << log_rate_limit << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("log.rate_limit is not of type int", node["log"]["rate_limit"]);
+            }
+        }
+    }
+
+    if (node["metrics"]) {
+        if (node["metrics"]["port"]) {
+            try {
+                metrics_port = node["metrics"]["port"].as<int>();
+
+                if (metrics_port < 0 || metrics_port > 65535)
+                    throw "invalid metrics port, not within range of 0 - 65535";
+
+                if (debug_general)
+                    std::cout << "   Config: metrics port: " << metrics_port << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("metrics.port is not of type int", node["metrics"]["port"]);
+            }
+        }
+
+        if (node["metrics"]["listen_ip"]) {
+            try {
+                metrics_listen_ip = node["metrics"]["listen_ip"].as<std::string>();
+
+                if (debug_general)
+                    std::cout << "   Config: metrics listen ip: " << metrics_listen_ip << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("metrics.listen_ip is not of type string", node["metrics"]["listen_ip"]);
+            }
+        }
+
+        if (node["metrics"]["control_socket"]) {
+            try {
+                metrics_control_socket = node["metrics"]["control_socket"].as<std::string>();
+
+                if (metrics_control_socket.size() >= sizeof(((sockaddr_un *)0)->sun_path))
+                    throw "invalid metrics control_socket, path is too long";
+
+                if (debug_general)
+                    std::cout << "   Config: metrics control socket: " << metrics_control_socket << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("metrics.control_socket is not of type string", node["metrics"]["control_socket"]);
+            }
+        }
+    }
+
+    if (node["resolver"]) {
+        if (node["resolver"]["threads"]) {
             try {
-                bmp_buffer_size = node["buffers"]["router"].as<int>();
-
-                if (bmp_buffer_size < 2 || bmp_buffer_size > 384)
-                    throw "invalid router buffer size, not within range of 2 - 384)";
+                resolver_threads = node["resolver"]["threads"].as<int>();
 
-                bmp_buffer_size *= 1024 * 1024;  // MB to bytes
+                if (resolver_threads < 1 || resolver_threads > 64)
+                    throw "invalid resolver threads, not within range of 1 - 64";
 
                 if (debug_general)
-                    std::cout << "   Config: bmp buffer: " << bmp_buffer_size << std::endl;
+                    std::cout << "   Config: resolver threads: " << resolver_threads << std::endl;
 
             } catch (YAML::TypedBadConversion<int> err) {
-                printWarning("buffers.router is not of type int", node["buffers"]["router"]);
+                printWarning("resolver.threads is not of type int", node["resolver"]["threads"]);
             }
         }
-    }
 
-    if (node["heartbeat"]) {
-        if (node["heartbeat"]["interval"]) {
+        if (node["resolver"]["timeout"]) {
             try {
-                heartbeat_interval = node["heartbeat"]["interval"].as<int>();
+                resolver_timeout = node["resolver"]["timeout"].as<int>();
 
-                if (heartbeat_interval < 1 || heartbeat_interval > 1440)
-                    throw "invalid heartbeat interval not within range of 1 - 1440)";
+                if (resolver_timeout < 0 || resolver_timeout > 60000)
+                    throw "invalid resolver timeout, not within range of 0 - 60000";
 
-                heartbeat_interval *= 60;   // minutes to seconds
+                if (debug_general)
+                    std::cout << "   Config: resolver timeout: " << resolver_timeout << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("resolver.timeout is not of type int", node["resolver"]["timeout"]);
+            }
+        }
+
+        if (node["resolver"]["cache_time"]) {
+            try {
+                resolver_cache_time = node["resolver"]["cache_time"].as<int>();
+
+                if (resolver_cache_time < 0 || resolver_cache_time > 604800)
+                    throw "invalid resolver cache_time, not within range of 0 - 604800";
 
                 if (debug_general)
-                    std::cout << "   Config: heartbeat interval: " << heartbeat_interval << std::endl;
+                    std::cout << "   Config: resolver cache time: " << resolver_cache_time << std::endl;
 
             } catch (YAML::TypedBadConversion<int> err) {
-                printWarning("heartbeat.router is not of type int", node["heartbeat"]["interval"]);
+                printWarning("resolver.cache_time is not of type int", node["resolver"]["cache_time"]);
             }
         }
     }
@@ -291,6 +892,72 @@ void Config::parseBase(const YAML::Node &node) {
             }
         }
 
+        if (node["startup"]["baseline_file"]) {
+            try {
+                baseline_file = node["startup"]["baseline_file"].as<std::string>();
+
+                if (debug_general)
+                    std::cout << "   Config: baseline_file: " << baseline_file << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("baseline_file is not of type string", node["startup"]["baseline_file"]);
+            }
+        }
+
+        if (node["startup"]["state_file"]) {
+            try {
+                state_file = node["startup"]["state_file"].as<std::string>();
+
+                if (debug_general)
+                    std::cout << "   Config: state_file: " << state_file << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("state_file is not of type string", node["startup"]["state_file"]);
+            }
+        }
+
+        if (node["startup"]["state_interval"]) {
+            try {
+                state_interval = node["startup"]["state_interval"].as<int>();
+
+                if (state_interval < 5 || state_interval > 3600)
+                    throw "invalid state_interval, not within range of 5 - 3600";
+
+                if (debug_general)
+                    std::cout << "   Config: state_interval: " << state_interval << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("state_interval is not of type int", node["startup"]["state_interval"]);
+            }
+        }
+
+        if (node["startup"]["admission_control"]) {
+            try {
+                admission_control = node["startup"]["admission_control"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: admission_control: " << admission_control << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("admission_control is not of type bool", node["startup"]["admission_control"]);
+            }
+        }
+
+        if (node["startup"]["admission_cpu_max"]) {
+            try {
+                admission_cpu_max = node["startup"]["admission_cpu_max"].as<int>();
+
+                if (admission_cpu_max < 10 || admission_cpu_max > 100)
+                    throw "invalid admission_cpu_max, not within range of 10 - 100";
+
+                if (debug_general)
+                    std::cout << "   Config: admission_cpu_max: " << admission_cpu_max << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("admission_cpu_max is not of type int", node["startup"]["admission_cpu_max"]);
+            }
+        }
+
         if (node["startup"]["pat_enabled"]) {
             try {
                 pat_enabled = node["startup"]["pat_enabled"].as<bool>();
@@ -304,6 +971,74 @@ void Config::parseBase(const YAML::Node &node) {
         }
     }
 
+    if (node["path_attr_cache"]) {
+        try {
+            attr_cache_size = node["path_attr_cache"].as<int>();
+
+            if (attr_cache_size < 0 || attr_cache_size > 1000000)
+                throw "invalid path_attr_cache, not within range of 0 - 1000000";
+
+            if (debug_general)
+                std::cout << "   Config: path attribute cache size: " << attr_cache_size << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("path_attr_cache is not of type int", node["path_attr_cache"]);
+        }
+    }
+
+    if (node["adj_rib_in"]) {
+        if (node["adj_rib_in"]["enabled"]) {
+            try {
+                adj_rib_in = node["adj_rib_in"]["enabled"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: adj_rib_in enabled: " << adj_rib_in << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("adj_rib_in.enabled is not of type bool", node["adj_rib_in"]["enabled"]);
+            }
+        }
+
+        if (node["adj_rib_in"]["suppress_duplicates"]) {
+            try {
+                adj_rib_in_dedup = node["adj_rib_in"]["suppress_duplicates"].as<bool>();
+
+                if (debug_general)
+                    std::cout << "   Config: adj_rib_in suppress duplicates: " << adj_rib_in_dedup << std::endl;
+
+            } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("adj_rib_in.suppress_duplicates is not of type bool", node["adj_rib_in"]["suppress_duplicates"]);
+            }
+        }
+
+        if (node["adj_rib_in"]["resync_rate"]) {
+            try {
+                adj_rib_in_resync_rate = node["adj_rib_in"]["resync_rate"].as<int>();
+
+                if (debug_general)
+                    std::cout << "   Config: adj_rib_in resync rate: " << adj_rib_in_resync_rate << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("adj_rib_in.resync_rate is not of type int", node["adj_rib_in"]["resync_rate"]);
+            }
+        }
+    }
+
+    if (node["hash_algorithm"]) {
+        try {
+            hash_algorithm = node["hash_algorithm"].as<std::string>();
+
+            if (hash_algorithm != "md5" && hash_algorithm != "murmur3")
+                throw "invalid value for hash_algorithm, should be md5 or murmur3";
+
+            if (debug_general)
+                std::cout << "   Config: hash algorithm: " << hash_algorithm << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("hash_algorithm is not of type string", node["hash_algorithm"]);
+        }
+    }
+
 }
 
 /**
@@ -480,76 +1215,297 @@ void Config::parseKafka(const YAML::Node &node) {
         }
     }
 
-    if (node["queue.buffering.max.ms"]  && 
-        node["queue.buffering.max.ms"].Type() == YAML::NodeType::Scalar) {
+    if (node["queue.buffering.max.ms"]  && 
+        node["queue.buffering.max.ms"].Type() == YAML::NodeType::Scalar) {
+        try {
+            q_buf_max_ms = node["queue.buffering.max.ms"].as<int>();
+
+            if (q_buf_max_ms < 1 || q_buf_max_ms > 900000)
+               throw "invalid receive max bytes , should be "
+				"in range 1 - 900000";
+            if (debug_general)
+                   std::cout << "   Config: queue buffering max time in ms: " << 
+                                q_buf_max_ms << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("q_buf_max_ms is not of type int", 
+				node["queue.buffering.max.ms"]);
+        }
+    }
+
+    if (node["message.send.max.retries"]  && 
+        node["message.send.max.retries"].Type() == YAML::NodeType::Scalar) {
+        try {
+            msg_send_max_retry = node["message.send.max.retries"].as<int>();
+
+            if (msg_send_max_retry < 0 || msg_send_max_retry > 10000000)
+               throw "invalid receive max bytes , should be "
+				"in range 1 - 10000000";
+            if (debug_general)
+                   std::cout << "   Config: max message send retry: " << 
+                                msg_send_max_retry << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("msg_send_max_retry is not of type int", 
+				node["message.send.max.retries"]);
+        }
+    }
+
+    if (node["retry.backoff.ms"]  && 
+        node["retry.backoff.ms"].Type() == YAML::NodeType::Scalar) {
+        try {
+            retry_backoff_ms = node["retry.backoff.ms"].as<int>();
+
+            if (retry_backoff_ms < 1 || retry_backoff_ms > 300000)
+               throw "invalid receive max bytes , should be "
+				"in range 1 - 300000";
+            if (debug_general)
+                   std::cout << "   Config: backoff time before resending failed message in ms: " << 
+                                retry_backoff_ms << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("retry_backoff_ms is not of type int", 
+				node["retry.backoff.ms"]);
+        }
+    }
+
+    if (node["compression.codec"]  && 
+        node["compression.codec"].Type() == YAML::NodeType::Scalar) {
+        try {
+            compression = node["compression.codec"].as<std::string>();
+
+            if (compression != "none" && compression != "snappy" && 
+                compression != "gzip" && compression != "lz4")
+               throw "invalid value for compression, should be one of none,"
+			" gzip, snappy, or lz4";
+            if (debug_general)
+                   std::cout << "   Config: Compression : " << 
+                                compression << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("Compression is not of type string", 
+				node["compression.codec"]);
+        }
+    }
+
+    if (node["producer.pool.size"]  &&
+        node["producer.pool.size"].Type() == YAML::NodeType::Scalar) {
+        try {
+            kafka_producers = node["producer.pool.size"].as<int>();
+
+            if (kafka_producers < -1 || kafka_producers > 256)
+               throw "invalid producer pool size, should be "
+                        "in range -1 - 256";
+            if (debug_general)
+                   std::cout << "   Config: producer pool size : " <<
+                                kafka_producers << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("producer.pool.size is not of type int",
+                                node["producer.pool.size"]);
+        }
+    }
+
+    if (node["priority.lane"]  &&
+        node["priority.lane"].Type() == YAML::NodeType::Scalar) {
+        try {
+            kafka_priority_lane = node["priority.lane"].as<bool>();
+
+            if (debug_general)
+                   std::cout << "   Config: priority lane : " <<
+                                kafka_priority_lane << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("priority.lane is not of type bool",
+                                node["priority.lane"]);
+        }
+    }
+
+    if (node["spool.dir"]  &&
+        node["spool.dir"].Type() == YAML::NodeType::Scalar) {
+        try {
+            kafka_spool_dir = node["spool.dir"].as<std::string>();
+
+            if (debug_general)
+                   std::cout << "   Config: spool dir : " <<
+                                kafka_spool_dir << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("spool.dir is not of type string",
+                                node["spool.dir"]);
+        }
+    }
+
+    if (node["spool.segment.size"]  &&
+        node["spool.segment.size"].Type() == YAML::NodeType::Scalar) {
+        try {
+            kafka_spool_segment_size = node["spool.segment.size"].as<int>();
+
+            if (kafka_spool_segment_size < 1 || kafka_spool_segment_size > 1024)
+               throw "invalid spool segment size, should be "
+                        "in range 1 - 1024";
+            if (debug_general)
+                   std::cout << "   Config: spool segment size : " <<
+                                kafka_spool_segment_size << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("spool.segment.size is not of type int",
+                                node["spool.segment.size"]);
+        }
+    }
+
+    if (node["spool.max.size"]  &&
+        node["spool.max.size"].Type() == YAML::NodeType::Scalar) {
+        try {
+            kafka_spool_max_size = node["spool.max.size"].as<int>();
+
+            if (kafka_spool_max_size < 1)
+               throw "invalid spool max size, should be at least 1";
+            if (debug_general)
+                   std::cout << "   Config: spool max size : " <<
+                                kafka_spool_max_size << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("spool.max.size is not of type int",
+                                node["spool.max.size"]);
+        }
+    }
+
+    if (node["partitioner"]  &&
+        node["partitioner"].Type() == YAML::NodeType::Scalar) {
+        try {
+            partitioner = node["partitioner"].as<std::string>();
+
+            if (partitioner != "murmur2" && partitioner != "legacy")
+               throw "invalid value for partitioner, should be murmur2 or legacy";
+            if (debug_general)
+                   std::cout << "   Config: partitioner : " <<
+                                partitioner << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("partitioner is not of type string",
+                                node["partitioner"]);
+        }
+    }
+
+    if (node["partition.key"]  &&
+        node["partition.key"].Type() == YAML::NodeType::Scalar) {
+        try {
+            partition_key = node["partition.key"].as<std::string>();
+
+            if (partition_key != "peer" && partition_key != "router")
+               throw "invalid value for partition.key, should be peer or router";
+            if (debug_general)
+                   std::cout << "   Config: partition key : " <<
+                                partition_key << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("partition.key is not of type string",
+                                node["partition.key"]);
+        }
+    }
+
+    if (node["rd.format"]  &&
+        node["rd.format"].Type() == YAML::NodeType::Scalar) {
+        try {
+            rd_format = node["rd.format"].as<std::string>();
+
+            if (rd_format != "legacy" && rd_format != "rfc4364")
+               throw "invalid value for rd.format, should be legacy or rfc4364";
+            if (debug_general)
+                   std::cout << "   Config: rd format : " <<
+                                rd_format << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("rd.format is not of type string",
+                                node["rd.format"]);
+        }
+    }
+
+    if (node["coalesce.max.bytes"]  &&
+        node["coalesce.max.bytes"].Type() == YAML::NodeType::Scalar) {
+        try {
+            kafka_coalesce_max_bytes = node["coalesce.max.bytes"].as<int>();
+
+            if (kafka_coalesce_max_bytes < 0 || kafka_coalesce_max_bytes > 1000000)
+               throw "invalid coalesce max bytes, should be "
+                        "in range 0 - 1000000";
+            if (debug_general)
+                   std::cout << "   Config: coalesce max bytes : " <<
+                                kafka_coalesce_max_bytes << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("coalesce.max.bytes is not of type int",
+                                node["coalesce.max.bytes"]);
+        }
+    }
+
+    if (node["coalesce.max.ms"]  &&
+        node["coalesce.max.ms"].Type() == YAML::NodeType::Scalar) {
         try {
-            q_buf_max_ms = node["queue.buffering.max.ms"].as<int>();
+            kafka_coalesce_max_ms = node["coalesce.max.ms"].as<int>();
 
-            if (q_buf_max_ms < 1 || q_buf_max_ms > 900000)
-               throw "invalid receive max bytes , should be "
-				"in range 1 - 900000";
+            if (kafka_coalesce_max_ms < 0 || kafka_coalesce_max_ms > 1000)
+               throw "invalid coalesce max ms, should be "
+                        "in range 0 - 1000";
             if (debug_general)
-                   std::cout << "   Config: queue buffering max time in ms: " << 
-                                q_buf_max_ms << std::endl;
+                   std::cout << "   Config: coalesce max ms : " <<
+                                kafka_coalesce_max_ms << std::endl;
 
         } catch (YAML::TypedBadConversion<int> err) {
-                printWarning("q_buf_max_ms is not of type int", 
-				node["queue.buffering.max.ms"]);
+                printWarning("coalesce.max.ms is not of type int",
+                                node["coalesce.max.ms"]);
         }
     }
 
-    if (node["message.send.max.retries"]  && 
-        node["message.send.max.retries"].Type() == YAML::NodeType::Scalar) {
+    if (node["zero_copy.min.bytes"]  &&
+        node["zero_copy.min.bytes"].Type() == YAML::NodeType::Scalar) {
         try {
-            msg_send_max_retry = node["message.send.max.retries"].as<int>();
+            kafka_zero_copy_min_bytes = node["zero_copy.min.bytes"].as<int>();
 
-            if (msg_send_max_retry < 0 || msg_send_max_retry > 10000000)
-               throw "invalid receive max bytes , should be "
-				"in range 1 - 10000000";
+            if (kafka_zero_copy_min_bytes < 0 || kafka_zero_copy_min_bytes > 1800000)
+               throw "invalid zero copy min bytes, should be "
+                        "in range 0 - 1800000";
             if (debug_general)
-                   std::cout << "   Config: max message send retry: " << 
-                                msg_send_max_retry << std::endl;
+                   std::cout << "   Config: zero copy min bytes : " <<
+                                kafka_zero_copy_min_bytes << std::endl;
 
         } catch (YAML::TypedBadConversion<int> err) {
-                printWarning("msg_send_max_retry is not of type int", 
-				node["message.send.max.retries"]);
+                printWarning("zero_copy.min.bytes is not of type int",
+                                node["zero_copy.min.bytes"]);
         }
     }
 
-    if (node["retry.backoff.ms"]  && 
-        node["retry.backoff.ms"].Type() == YAML::NodeType::Scalar) {
+    if (node["linkstate.delta"]  &&
+        node["linkstate.delta"].Type() == YAML::NodeType::Scalar) {
         try {
-            retry_backoff_ms = node["retry.backoff.ms"].as<int>();
+            ls_delta = node["linkstate.delta"].as<bool>();
 
-            if (retry_backoff_ms < 1 || retry_backoff_ms > 300000)
-               throw "invalid receive max bytes , should be "
-				"in range 1 - 300000";
             if (debug_general)
-                   std::cout << "   Config: backoff time before resending failed message in ms: " << 
-                                retry_backoff_ms << std::endl;
+                   std::cout << "   Config: linkstate delta : " <<
+                                ls_delta << std::endl;
 
-        } catch (YAML::TypedBadConversion<int> err) {
-                printWarning("retry_backoff_ms is not of type int", 
-				node["retry.backoff.ms"]);
+        } catch (YAML::TypedBadConversion<bool> err) {
+                printWarning("linkstate.delta is not of type bool",
+                                node["linkstate.delta"]);
         }
     }
 
-    if (node["compression.codec"]  && 
-        node["compression.codec"].Type() == YAML::NodeType::Scalar) {
+    if (node["linkstate.snapshot.interval"]  &&
+        node["linkstate.snapshot.interval"].Type() == YAML::NodeType::Scalar) {
         try {
-            compression = node["compression.codec"].as<std::string>();
+            ls_snapshot_interval = node["linkstate.snapshot.interval"].as<int>();
 
-            if (compression != "none" && compression != "snappy" && 
-                compression != "gzip" && compression != "lz4")
-               throw "invalid value for compression, should be one of none,"
-			" gzip, snappy, or lz4";
+            if (ls_snapshot_interval < 0 || ls_snapshot_interval > 604800)
+               throw "invalid linkstate snapshot interval, should be "
+                        "in range 0 - 604800";
             if (debug_general)
-                   std::cout << "   Config: Compression : " << 
-                                compression << std::endl;
+                   std::cout << "   Config: linkstate snapshot interval : " <<
+                                ls_snapshot_interval << std::endl;
 
-        } catch (YAML::TypedBadConversion<std::string> err) {
-                printWarning("Compression is not of type string", 
-				node["compression.codec"]);
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("linkstate.snapshot.interval is not of type int",
+                                node["linkstate.snapshot.interval"]);
         }
     }
 
@@ -591,13 +1547,24 @@ void Config::parseTopics(const YAML::Node &node) {
     if (node["names"] and node["names"].Type() == YAML::NodeType::Map) {
         for (YAML::const_iterator it = node["names"].begin(); it != node["names"].end(); ++it) {
             try {
+                const std::string &var = it->first.as<std::string>();
+                std::string name = it->second.IsNull() ? "" : it->second.as<std::string>();
+
                 // Only add topic names that are initialized, otherwise ignore them
-                if (topic_names_map.find(it->first.as<std::string>()) != topic_names_map.end())
-                    topic_names_map[it->first.as<std::string>()] = it->second.as<std::string>();
-                else if (debug_general)
-                    std::cout << "   Ignore: '" << it->first.as<std::string>()
-                              << "' is not a valid topic name entry" << std::endl;
+                if (topic_names_map.find(var) == topic_names_map.end()) {
+                    if (debug_general)
+                        std::cout << "   Ignore: '" << var << "' is not a valid topic name entry" << std::endl;
+
+                } else if (name.empty()) {
+                    // An empty name disables the topic, the messages are not decoded or produced
+                    if (outputBit(var) != 0)
+                        parsed_outputs &= ~outputBit(var);
+                    else
+                        printWarning("kafka.topics.names only the parsed topics can be disabled, using the default name",
+                                     it->first);
 
+                } else
+                    topic_names_map[var] = name;
 
             } catch (YAML::TypedBadConversion<std::string> err) {
                 printWarning("kafka.topics.names error in map.  Make sure to define var: <string value>", it->second);
@@ -606,7 +1573,89 @@ void Config::parseTopics(const YAML::Node &node) {
 
         if (debug_general) {
             for (topic_names_map_iter it = topic_names_map.begin(); it != topic_names_map.end(); ++it) {
-                std::cout << "   Config: kafka.topics.names: " << it->first << " = " << it->second << std::endl;
+                if (outputBit(it->first) != 0 and not (parsed_outputs & outputBit(it->first)))
+                    std::cout << "   Config: kafka.topics.names: " << it->first << " is disabled" << std::endl;
+                else
+                    std::cout << "   Config: kafka.topics.names: " << it->first << " = " << it->second << std::endl;
+            }
+        }
+    }
+
+    if (node["format"] and node["format"].Type() == YAML::NodeType::Map) {
+        for (YAML::const_iterator it = node["format"].begin(); it != node["format"].end(); ++it) {
+            try {
+                const std::string &var = it->first.as<std::string>();
+                const std::string &format = it->second.as<std::string>();
+
+                if (format != "tsv" and format != "binary")
+                    throw "invalid value for kafka.topics.format, should be one of tsv or binary";
+
+                // Only the row topics can be binary, the others are always tsv
+                if (var == MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE or var == MSGBUS_TOPIC_VAR_UNICAST_PREFIX or
+                        var == MSGBUS_TOPIC_VAR_LS_NODE or var == MSGBUS_TOPIC_VAR_LS_LINK or
+                        var == MSGBUS_TOPIC_VAR_LS_PREFIX or var == MSGBUS_TOPIC_VAR_L3VPN or
+                        var == MSGBUS_TOPIC_VAR_EVPN)
+                    topic_format_map[var] = format;
+                else if (debug_general)
+                    std::cout << "   Ignore: '" << var << "' does not support kafka.topics.format" << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("kafka.topics.format error in map.  Make sure to define var: <tsv|binary>", it->second);
+            }
+        }
+
+        if (debug_general) {
+            for (topic_format_map_iter it = topic_format_map.begin(); it != topic_format_map.end(); ++it) {
+                std::cout << "   Config: kafka.topics.format: " << it->first << " = " << it->second << std::endl;
+            }
+        }
+    }
+
+    if (node["profiles"] and node["profiles"].Type() == YAML::NodeType::Map) {
+        for (YAML::const_iterator it = node["profiles"].begin(); it != node["profiles"].end(); ++it) {
+            try {
+                const std::string &var = it->first.as<std::string>();
+
+                if (topic_names_map.find(var) == topic_names_map.end()) {
+                    if (debug_general)
+                        std::cout << "   Ignore: '" << var << "' is not a valid topic name entry" << std::endl;
+                    continue;
+                }
+
+                if (it->second.Type() != YAML::NodeType::Map) {
+                    printWarning("kafka.topics.profiles error in map.  Make sure to define var: <map of properties>", it->second);
+                    continue;
+                }
+
+                for (YAML::const_iterator p_it = it->second.begin(); p_it != it->second.end(); ++p_it) {
+                    const std::string &property = p_it->first.as<std::string>();
+                    const std::string &value = p_it->second.as<std::string>();
+
+                    // Only topic level properties can be different per topic
+                    if (property == "compression.codec") {
+                        if (value != "none" and value != "snappy" and value != "gzip" and value != "lz4")
+                            throw "invalid value for kafka.topics.profiles compression.codec, should be one of none,"
+                                  " gzip, snappy, or lz4";
+
+                    } else if (property != "request.required.acks" and property != "request.timeout.ms" and
+                               property != "message.timeout.ms") {
+                        throw "invalid kafka.topics.profiles property, should be one of compression.codec,"
+                              " request.required.acks, request.timeout.ms, or message.timeout.ms";
+                    }
+
+                    topic_profile_map[var][property] = value;
+                }
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("kafka.topics.profiles error in map.  Make sure to define property: <string value>", it->second);
+            }
+        }
+
+        if (debug_general) {
+            for (topic_profile_map_iter it = topic_profile_map.begin(); it != topic_profile_map.end(); ++it) {
+                for (std::map<std::string, std::string>::iterator p_it = it->second.begin(); p_it != it->second.end(); ++p_it)
+                    std::cout << "   Config: kafka.topics.profiles: " << it->first << ": "
+                              << p_it->first << " = " << p_it->second << std::endl;
             }
         }
     }
@@ -621,6 +1670,228 @@ void Config::parseTopics(const YAML::Node &node) {
     }
 }
 
+/**
+ * Parse the message bus backend configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseMsgBus(const YAML::Node &node) {
+    if (node["backend"]) {
+        try {
+            msgbus_backend = node["backend"].as<std::string>();
+
+            if (debug_general)
+                std::cout << "   Config: msgbus backend: " << msgbus_backend << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("msgbus.backend is not of type string", node["backend"]);
+        }
+    }
+
+    if (node["shm"]) {
+        if (node["shm"]["prefix"]) {
+            try {
+                msgbus_shm_prefix = node["shm"]["prefix"].as<std::string>();
+
+                if (msgbus_shm_prefix.size() == 0 or msgbus_shm_prefix[0] != '/')
+                    throw "invalid msgbus.shm.prefix, should start with /";
+
+                if (debug_general)
+                    std::cout << "   Config: msgbus shm prefix: " << msgbus_shm_prefix << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("msgbus.shm.prefix is not of type string", node["shm"]["prefix"]);
+            }
+        }
+
+        if (node["shm"]["size"]) {
+            try {
+                msgbus_shm_size = node["shm"]["size"].as<int>();
+
+                if (msgbus_shm_size < 1024 * 1024)
+                    throw "invalid msgbus.shm.size, should be at least 1048576 (1MB)";
+
+                if (debug_general)
+                    std::cout << "   Config: msgbus shm size: " << msgbus_shm_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("msgbus.shm.size is not of type int", node["shm"]["size"]);
+            }
+        }
+    }
+
+    if (node["fanout"] and node["fanout"]["clusters"] and
+            node["fanout"]["clusters"].Type() == YAML::NodeType::Sequence) {
+        const YAML::Node &clusters = node["fanout"]["clusters"];
+
+        msgbus_fanout_brokers.clear();
+
+        // Each cluster is a list of brokers, same as kafka.brokers
+        for (std::size_t i = 0; i < clusters.size(); i++) {
+            std::string brokers;
+
+            if (clusters[i].Type() == YAML::NodeType::Sequence) {
+                for (std::size_t n = 0; n < clusters[i].size(); n++) {
+                    if (brokers.size() > 0)
+                        brokers.append(",");
+
+                    brokers.append(clusters[i][n].Scalar());
+                }
+            } else
+                brokers = clusters[i].Scalar();
+
+            if (brokers.size() == 0) {
+                printWarning("msgbus.fanout.clusters entry has no brokers", clusters[i]);
+                continue;
+            }
+
+            msgbus_fanout_brokers.push_back(brokers);
+
+            if (debug_general)
+                std::cout << "   Config: msgbus fanout cluster " << i << ": " << brokers << std::endl;
+        }
+    }
+}
+
+/**
+ * Parse the cluster configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseCluster(const YAML::Node &node) {
+    if (node["enabled"]) {
+        try {
+            cluster_enabled = node["enabled"].as<bool>();
+
+            if (debug_general)
+                std::cout << "   Config: cluster enabled: " << cluster_enabled << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+            printWarning("cluster.enabled is not of type bool", node["enabled"]);
+        }
+    }
+
+    if (node["name"]) {
+        try {
+            cluster_name = node["name"].as<std::string>();
+
+            if (cluster_name.size() == 0)
+                throw "invalid cluster.name, should not be empty";
+
+            if (debug_general)
+                std::cout << "   Config: cluster name: " << cluster_name << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("cluster.name is not of type string", node["name"]);
+        }
+    }
+
+    if (node["node_id"]) {
+        try {
+            cluster_node_id = node["node_id"].as<std::string>();
+
+            if (debug_general)
+                std::cout << "   Config: cluster node id: " << cluster_node_id << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("cluster.node_id is not of type string", node["node_id"]);
+        }
+    }
+
+    if (node["address"]) {
+        try {
+            cluster_address = node["address"].as<std::string>();
+
+            if (cluster_address.find(':') == std::string::npos)
+                throw "invalid cluster.address, should be ip:port";
+
+            if (debug_general)
+                std::cout << "   Config: cluster address: " << cluster_address << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("cluster.address is not of type string", node["address"]);
+        }
+    }
+
+    if (node["topic"]) {
+        try {
+            cluster_topic = node["topic"].as<std::string>();
+
+            if (cluster_topic.size() == 0)
+                throw "invalid cluster.topic, should not be empty";
+
+            if (debug_general)
+                std::cout << "   Config: cluster topic: " << cluster_topic << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("cluster.topic is not of type string", node["topic"]);
+        }
+    }
+
+    if (node["weight"]) {
+        try {
+            cluster_weight = node["weight"].as<int>();
+
+            if (cluster_weight < 0 || cluster_weight > 1024)
+                throw "invalid cluster.weight, not within range of 0 - 1024";
+
+            if (debug_general)
+                std::cout << "   Config: cluster weight: " << cluster_weight << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("cluster.weight is not of type int", node["weight"]);
+        }
+    }
+
+    if (node["heartbeat_interval"]) {
+        try {
+            cluster_heartbeat_interval = node["heartbeat_interval"].as<int>();
+
+            if (cluster_heartbeat_interval < 1 || cluster_heartbeat_interval > 300)
+                throw "invalid cluster.heartbeat_interval, not within range of 1 - 300";
+
+            if (debug_general)
+                std::cout << "   Config: cluster heartbeat interval: " << cluster_heartbeat_interval << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("cluster.heartbeat_interval is not of type int", node["heartbeat_interval"]);
+        }
+    }
+
+    if (node["node_timeout"]) {
+        try {
+            cluster_node_timeout = node["node_timeout"].as<int>();
+
+            if (cluster_node_timeout < 3 || cluster_node_timeout > 3600)
+                throw "invalid cluster.node_timeout, not within range of 3 - 3600";
+
+            if (debug_general)
+                std::cout << "   Config: cluster node timeout: " << cluster_node_timeout << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("cluster.node_timeout is not of type int", node["node_timeout"]);
+        }
+    }
+
+    if (node["drain_interval"]) {
+        try {
+            cluster_drain_interval = node["drain_interval"].as<int>();
+
+            if (cluster_drain_interval < 0 || cluster_drain_interval > 600)
+                throw "invalid cluster.drain_interval, not within range of 0 - 600";
+
+            if (debug_general)
+                std::cout << "   Config: cluster drain interval: " << cluster_drain_interval << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("cluster.drain_interval is not of type int", node["drain_interval"]);
+        }
+    }
+
+    if (cluster_enabled and cluster_address.size() == 0)
+        throw "cluster.address is required when the cluster is enabled";
+}
+
 /**
  * Parse the mapping configuration
  *
@@ -659,6 +1930,14 @@ void Config::parseMapping(const YAML::Node &node) {
 
                     } else if (cur_node["prefix_range"])
                         throw "Invalid mapping.groups.router_group.prefix_range, should be of type list/sequence";
+
+                    if (cur_node["outputs"] and cur_node["outputs"].Type() == YAML::NodeType::Sequence) {
+
+                        router_group_outputs[name] = parseOutputList(cur_node["outputs"],
+                                                                     "mapping.groups.router_group.outputs");
+
+                    } else if (cur_node["outputs"])
+                        throw "Invalid mapping.groups.router_group.outputs, should be of type list/sequence";
                 }
             }
         }
@@ -714,6 +1993,14 @@ void Config::parseMapping(const YAML::Node &node) {
                     } else if (cur_node["asn"])
                         throw "Invalid mapping.groups.peer_group.asn, should be of type list/sequence";
 
+                    if (cur_node["outputs"] and cur_node["outputs"].Type() == YAML::NodeType::Sequence) {
+
+                        peer_group_outputs[name] = parseOutputList(cur_node["outputs"],
+                                                                   "mapping.groups.peer_group.outputs");
+
+                    } else if (cur_node["outputs"])
+                        throw "Invalid mapping.groups.peer_group.outputs, should be of type list/sequence";
+
                 }
             }
         }
@@ -721,6 +2008,39 @@ void Config::parseMapping(const YAML::Node &node) {
     }
 }
 
+/**
+ * Parse the outputs list of a group
+ *
+ * \param [in]  node     outputs list node - should be of type sequence
+ * \param [in]  path     Config path of the node, used in messages
+ *
+ * \return MSGBUS_OUTPUT_* bits of the listed topic vars
+ */
+uint32_t Config::parseOutputList(const YAML::Node &node, const std::string &path) {
+    uint32_t outputs = 0;
+
+    for (std::size_t i = 0; i < node.size(); i++) {
+        try {
+            const std::string &var = node[i].as<std::string>();
+
+            if (outputBit(var) == 0) {
+                printWarning(path + " is not a parsed topic var, ignoring", node[i]);
+                continue;
+            }
+
+            outputs |= outputBit(var);
+
+            if (debug_general)
+                std::cout << "   Config: " << path << ": " << var << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning(path + " error in list.  Make sure to define a list of topic vars", node[i]);
+        }
+    }
+
+    return outputs;
+}
+
 /**
  * Parse matching regexp list and update the provided map with compiled expressions
  *
@@ -813,6 +2133,47 @@ void Config::parsePrefixList(const YAML::Node &node, std::string name,
     }
 }
 
+/**
+ * Compile the router and peer group matching maps
+ *
+ * \details Groups are added in map order for each match type, which is the order the
+ *          lookup precedence follows.
+ */
+void Config::compileGroupMatchers() {
+    router_group_matcher.clear();
+    peer_group_matcher.clear();
+
+    for (match_router_group_by_name_iter it = match_router_group_by_name.begin();
+         it != match_router_group_by_name.end(); ++it) {
+        for (std::list<match_type_regex>::iterator lit = it->second.begin(); lit != it->second.end(); ++lit)
+            router_group_matcher.addRegexp(it->first, lit->regexp);
+    }
+
+    for (match_router_group_by_ip_iter it = match_router_group_by_ip.begin();
+         it != match_router_group_by_ip.end(); ++it) {
+        for (std::list<match_type_ip>::iterator lit = it->second.begin(); lit != it->second.end(); ++lit)
+            router_group_matcher.addPrefix(it->first, lit->isIPv4, lit->prefix, lit->bits);
+    }
+
+    for (match_peer_group_by_name_iter it = match_peer_group_by_name.begin();
+         it != match_peer_group_by_name.end(); ++it) {
+        for (std::list<match_type_regex>::iterator lit = it->second.begin(); lit != it->second.end(); ++lit)
+            peer_group_matcher.addRegexp(it->first, lit->regexp);
+    }
+
+    for (match_peer_group_by_ip_iter it = match_peer_group_by_ip.begin();
+         it != match_peer_group_by_ip.end(); ++it) {
+        for (std::list<match_type_ip>::iterator lit = it->second.begin(); lit != it->second.end(); ++lit)
+            peer_group_matcher.addPrefix(it->first, lit->isIPv4, lit->prefix, lit->bits);
+    }
+
+    for (match_peer_group_by_asn_iter it = match_peer_group_by_asn.begin();
+         it != match_peer_group_by_asn.end(); ++it) {
+        for (std::list<uint32_t>::iterator lit = it->second.begin(); lit != it->second.end(); ++lit)
+            peer_group_matcher.addAsn(it->first, *lit);
+    }
+}
+
 /**
  * Perform topic name substitutions based on topic variables
  */
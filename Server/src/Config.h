@@ -13,12 +13,35 @@
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
+#include <mutex>
 #include <yaml-cpp/yaml.h>
 #include <boost/xpressive/xpressive.hpp>
 #include <boost/exception/all.hpp>
 
+#include "GroupMatcher.h"
+#include "RecvBuffer.h"
+
 #define MAX_THREADS 200
 
+/**
+ * Parsed outputs, a bit per topic var of the messages decoded from the BMP feed (see Config::parsed_outputs)
+ */
+#define MSGBUS_OUTPUT_BASE_ATTRIBUTE    0x0001
+#define MSGBUS_OUTPUT_UNICAST_PREFIX    0x0002
+#define MSGBUS_OUTPUT_L3VPN             0x0004
+#define MSGBUS_OUTPUT_EVPN              0x0008
+#define MSGBUS_OUTPUT_LS_NODE           0x0010
+#define MSGBUS_OUTPUT_LS_LINK           0x0020
+#define MSGBUS_OUTPUT_LS_PREFIX         0x0040
+#define MSGBUS_OUTPUT_BMP_STAT          0x0080
+#define MSGBUS_OUTPUT_BMP_RAW           0x0100
+
+#define MSGBUS_OUTPUT_LS                (MSGBUS_OUTPUT_LS_NODE | MSGBUS_OUTPUT_LS_LINK | MSGBUS_OUTPUT_LS_PREFIX)
+#define MSGBUS_OUTPUT_ATTRS             (MSGBUS_OUTPUT_BASE_ATTRIBUTE | MSGBUS_OUTPUT_UNICAST_PREFIX | \
+                                         MSGBUS_OUTPUT_L3VPN | MSGBUS_OUTPUT_EVPN | MSGBUS_OUTPUT_LS)
+#define MSGBUS_OUTPUT_ALL               0x01ff
+
 using namespace boost::xpressive;
 
 /**
@@ -39,8 +62,30 @@ public:
     std::string bind_ipv6;                ///< IP to listen on for IPv6
 
     int         bmp_buffer_size;          ///< BMP buffer size in bytes (min is 2M max is 128M)
+    bool        bmp_ring_buffer;          ///< Indicates if router buffer is an in-process ring instead of a socketpair
+    RecvBuffer::Hugepages bmp_buffer_hugepages;  ///< Hugepage backing of the router buffers
+    int         bmp_buffer_release;       ///< Bytes received before a drained router buffer gives its memory back (0 keeps it)
+    int         attr_cache_size;          ///< Max number of path attribute sets cached per peer (0 disables the cache)
+    bool        adj_rib_in;               ///< Indicates if the collector keeps an Adj-RIB-In per peer
+    bool        adj_rib_in_dedup;         ///< Indicates if duplicate announcements are suppressed using the Adj-RIB-In
+    int         adj_rib_in_resync_rate;   ///< Routes per second published by a resync, 0 disables resyncs
+    int         bmp_batch_size;           ///< Max number of buffered BMP messages to parse per read batch (1 disables batching)
+    bool        bmp_raw_passthrough;      ///< Indicates if BMP messages are forwarded raw without being parsed
+    int         bmp_raw_batch_bytes;      ///< Max bytes of consecutive raw BMP messages per kafka message
+    int         router_workers;           ///< Event driven router workers: 0 is a thread per router, -1 is one per CPU core
+    bool        router_workers_pin;       ///< Indicates if router workers are pinned to cores
+    bool        router_workers_uring;     ///< Indicates if router workers receive with io_uring instead of epoll
+    int         parse_threads;            ///< Parse pipeline workers: 0 decodes in the router thread, -1 is one per CPU core
+    int         parse_max_pending;        ///< Max route monitoring messages queued in the parse pipeline per router
+    std::string placement_policy;         ///< Placement of the router threads: none, node or core (see CpuPlacement)
     bool        svr_ipv4;                 ///< Indicates if server should listen for IPv4 connections
     bool        svr_ipv6;                 ///< Indicates if server should listen for IPv6 connections
+    int         socket_listeners;         ///< Listening sockets per address family, more than one uses SO_REUSEPORT
+    int         socket_backlog;           ///< Listen backlog of each listening socket
+    int         socket_rcvbuf;            ///< SO_RCVBUF of the router sockets in bytes, 0 is the system default
+    bool        socket_quickack;          ///< Indicates if TCP_QUICKACK is set on the router sockets
+    int         socket_busy_poll;         ///< SO_BUSY_POLL of the router sockets in usecs, 0 is disabled
+    bool        socket_incoming_cpu;      ///< Indicates if routers are assigned to the worker pinned to their SO_INCOMING_CPU
 
     bool        debug_general;
     bool        debug_bgp;
@@ -48,6 +93,14 @@ public:
     bool        debug_msgbus;
 
     int         heartbeat_interval;      ///< Heartbeat interval in seconds for collector updates
+    bool        log_async;               ///< Indicates if log messages are written by a background thread
+    int         log_rate_limit;          ///< Max log messages per second per thread when async, 0 is unlimited
+    int         metrics_port;            ///< HTTP port of the metrics endpoint, 0 is disabled
+    std::string metrics_listen_ip;       ///< IP the metrics endpoint listens on
+    std::string metrics_control_socket;  ///< Unix socket path of the RIB control API, empty is disabled
+    int         resolver_threads;        ///< Number of reverse DNS resolver threads
+    int         resolver_timeout;        ///< Max ms to wait for a reverse DNS lookup, 0 waits for the lookup
+    int         resolver_cache_time;     ///< Seconds reverse DNS results are cached
     int   	tx_max_bytes;            ///< Maximum transmit message size
     int 	rx_max_bytes;            ///< Maximum receive  message size
     int 	session_timeout;         ///< Client session timeout
@@ -57,10 +110,43 @@ public:
     int         msg_send_max_retry;      ///< No. of times to resend failed msgs
     int         retry_backoff_ms;        ///< Backoff time before resending msgs  
     std::string compression;		 ///< Compression to use :none, gzip, snappy
+    int         kafka_producers;         ///< Shared producers: 0 is one per router, -1 is one per CPU core
+    bool        kafka_priority_lane;     ///< Indicates if collector, router and peer messages use their own producer
+    std::string kafka_spool_dir;         ///< Directory messages are spooled to when kafka can't take them, empty is disabled
+    int         kafka_spool_segment_size; ///< Size in MB of a spool segment file
+    int         kafka_spool_max_size;    ///< Max size in MB of the spool of a cluster
+    std::string partitioner;             ///< Partitioner for the message keys: murmur2 or legacy
+    std::string partition_key;           ///< Message key of the peer topics: peer or router
+    std::string rd_format;               ///< Printed route distinguishers: legacy or rfc4364
+    int         kafka_coalesce_max_bytes; ///< Max bytes of the rows of a peer topic coalesced into one message, 0 is disabled
+    int         kafka_coalesce_max_ms;   ///< Max ms rows are held back to be coalesced
+    int         kafka_zero_copy_min_bytes; ///< Messages this size or larger are produced without copy, 0 is disabled
+    bool        ls_delta;                ///< Indicates if unchanged BGP-LS records are not republished
+    int         ls_snapshot_interval;    ///< Seconds before an unchanged BGP-LS record is republished, 0 is never
     int         max_concurrent_routers;  ///<Maximum allowed routers that can connect
     int         initial_router_time;     ///<Initial time in allowing another concurrent router
     bool        calculate_baseline;      ///<Indicates if router baseline time should be calculated
+    std::string baseline_file;           ///< File the router baseline times are saved to, empty if not saved
+    std::string state_file;              ///< File the collector state is checkpointed to, empty if not saved
+    int         state_interval;          ///< Seconds between checkpoints of the collector state
+    bool        admission_control;       ///< Indicates if router reads and accepts are paced by the collector load
+    int         admission_cpu_max;       ///< Process CPU percent (of all cores) considered full load
     bool        pat_enabled;             ///<Indicates if router hash needs to be based on INIT message instead of source IP
+    std::string hash_algorithm;          ///< Algorithm for the hash ids: md5 or murmur3
+    std::string msgbus_backend;          ///< Message bus backend: kafka, null, shm or fanout (see MsgBusFactory)
+    std::string msgbus_shm_prefix;       ///< Name prefix of the shm rings, followed by the router hash
+    int         msgbus_shm_size;         ///< Size in bytes of the shm ring of each router
+    std::vector<std::string> msgbus_fanout_brokers;  ///< Broker list of each fan-out kafka cluster
+    uint32_t    parsed_outputs;          ///< MSGBUS_OUTPUT_* bits of the enabled topics, a topic with an empty name is disabled
+    bool        cluster_enabled;         ///< Indicates if routers are assigned over a cluster of collectors
+    std::string cluster_name;            ///< Name of the cluster, the collector hash ID of all nodes
+    std::string cluster_node_id;         ///< Node ID in the cluster, default is admin_id
+    std::string cluster_address;         ///< Address (ip:port) other nodes forward the routers of this node to
+    std::string cluster_topic;           ///< Compacted kafka topic of the cluster membership
+    int         cluster_weight;          ///< Capacity of the node, 0 is the number of CPU cores
+    int         cluster_heartbeat_interval; ///< Seconds between membership heartbeats
+    int         cluster_node_timeout;    ///< Seconds without a heartbeat before a node is considered down
+    int         cluster_drain_interval;  ///< Seconds between the routers handed off by a draining node
 
     /**
      * matching structs and maps
@@ -97,6 +183,19 @@ public:
     std::map<std::string,  std::list<uint32_t>> match_peer_group_by_asn;
     typedef std::map<std::string, std::list<uint32_t>>::iterator match_peer_group_by_asn_iter;
 
+    /**
+     * Router and peer group matching maps compiled for lookups, built by load()
+     */
+    GroupMatcher router_group_matcher;
+    GroupMatcher peer_group_matcher;
+
+    /**
+     * MSGBUS_OUTPUT_* bits by group name, only groups with an outputs list are listed
+     */
+    std::map<std::string, uint32_t> router_group_outputs;
+    std::map<std::string, uint32_t> peer_group_outputs;
+    typedef std::map<std::string, uint32_t>::const_iterator group_outputs_iter;
+
     /**
      * kafka topic variables
      */
@@ -110,10 +209,23 @@ public:
     typedef std::map<std::string, std::string>::iterator topic_names_map_iter;
 
     /**
-     * map for router baseline times
+     * kafka topic row encoding (tsv or binary) by topic var, topics not listed are tsv
+     */
+    std::map<std::string, std::string> topic_format_map;
+    typedef std::map<std::string, std::string>::iterator topic_format_map_iter;
+
+    /**
+     * kafka topic level producer properties by topic var, map value is property = value
+     */
+    std::map<std::string, std::map<std::string, std::string>> topic_profile_map;
+    typedef std::map<std::string, std::map<std::string, std::string>>::iterator topic_profile_map_iter;
+
+    /**
+     * map for router baseline times, key is the router hash id.  Guarded by baseline_mutex.
      */
     std::map<std::string, float> router_baseline_time;
     typedef std::map<std::string, float>::iterator router_baseline_time_iter;
+    std::mutex baseline_mutex;
 
     /*********************************************************************//**
      * Constructor for class
@@ -127,7 +239,60 @@ public:
      ***********************************************************************/
     void load(const char *cfg_filename);
 
+    /*********************************************************************//**
+     * Get the baseline time of a router
+     *
+     * \param [in]  hash_id     Router hash id (raw 16 bytes)
+     * \param [out] secs        Baseline time in seconds, not changed if not known
+     *
+     * \return true if the router baseline time is known
+     ***********************************************************************/
+    bool getRouterBaseline(const std::string &hash_id, int &secs);
+
+    /*********************************************************************//**
+     * Set the baseline time of a router
+     *
+     * \details Saves the baseline times to baseline_file if configured.
+     *
+     * \param [in] hash_id      Router hash id (raw 16 bytes)
+     * \param [in] secs         Baseline time in seconds
+     ***********************************************************************/
+    void setRouterBaseline(const std::string &hash_id, float secs);
+
+    /*********************************************************************//**
+     * Get the outputs of a router or peer
+     *
+     * \param [in] router_group    Router group name, empty if not matched
+     * \param [in] peer_group      Peer group name, empty if not matched or a router
+     *
+     * \return MSGBUS_OUTPUT_* bits enabled by the topics and the outputs of both groups
+     ***********************************************************************/
+    uint32_t getOutputs(const std::string &router_group, const std::string &peer_group) const;
+
+    /*********************************************************************//**
+     * Get the MSGBUS_OUTPUT_* bit of a topic var
+     *
+     * \param [in] topic_var       Topic var MSGBUS_TOPIC_VAR_*
+     *
+     * \return Output bit, 0 if the topic is not a parsed output (e.g. collector)
+     ***********************************************************************/
+    static uint32_t outputBit(const std::string &topic_var);
+
 private:
+    /**
+     * Load the router baseline times from baseline_file
+     *
+     * \details A missing file is not an error, it's created when the first baseline is saved.
+     */
+    void loadBaselines();
+
+    /**
+     * Save the router baseline times to baseline_file
+     *
+     * \details Must be called with baseline_mutex locked.
+     */
+    void saveBaselines();
+
     /**
      * Parse the base configuration
      *
@@ -156,6 +321,13 @@ private:
      */
     void parseTopics(const YAML::Node &node);
 
+    /**
+     * Parse the message bus backend configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseMsgBus(const YAML::Node &node);
+
     /**
      * Parse the mapping configuration
      *
@@ -163,6 +335,13 @@ private:
      */
     void parseMapping(const YAML::Node &node);
 
+    /**
+     * Parse the cluster configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseCluster(const YAML::Node &node);
+
     /**
      * Parse matching prefix_range list and update the provided map with compiled expressions
      *
@@ -182,6 +361,16 @@ private:
      */
     void parseRegexpList(const YAML::Node &node, std::string name, std::map<std::string, std::list<match_type_regex>> &map);
 
+    /**
+     * Parse the outputs list of a group
+     *
+     * \param [in]  node     outputs list node - should be of type sequence
+     * \param [in]  path     Config path of the node, used in messages
+     *
+     * \return MSGBUS_OUTPUT_* bits of the listed topic vars
+     */
+    uint32_t parseOutputList(const YAML::Node &node, const std::string &path);
+
     /**
      * print warning message for parsing node
      *
@@ -195,6 +384,11 @@ private:
      */
     void topicSubstitutions();
 
+    /**
+     * Compile the router and peer group matching maps
+     */
+    void compileGroupMatchers();
+
 };
 
 
@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "CpuPlacement.h"
+
+std::mutex                          CpuPlacement::mutex;
+std::vector<CpuPlacement::Node *>   CpuPlacement::nodes;
+std::vector<int>                    CpuPlacement::cpu_node;
+std::vector<int>                    CpuPlacement::cpu_routers;
+bool                                CpuPlacement::by_core = false;
+std::atomic<bool>                   CpuPlacement::running(false);
+Logger                              *CpuPlacement::logger = NULL;
+
+/**
+ * Read the topology, if base.placement.policy is not none
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfg          Pointer to the config instance
+ */
+void CpuPlacement::start(Logger *logPtr, Config *cfg) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running or cfg->placement_policy == "none")
+        return;
+
+    logger = logPtr;
+    by_core = cfg->placement_policy == "core";
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        LOG_WARN("Unable to get the cores of the process, router threads are not placed");
+        return;
+    }
+
+    cpu_node.assign(CPU_SETSIZE, -1);
+    cpu_routers.assign(CPU_SETSIZE, 0);
+
+    // Nodes of the kernel, node<N> directories with the cpulist of the node
+    std::vector<int> ids;
+    DIR *dir = opendir(PLACEMENT_SYSFS_NODE_DIR);
+
+    if (dir != NULL) {
+        dirent *entry;
+
+        while ((entry = readdir(dir)) != NULL) {
+            char *end;
+
+            if (strncmp(entry->d_name, "node", 4) != 0)
+                continue;
+
+            int id = strtol(entry->d_name + 4, &end, 10);
+            if (end != entry->d_name + 4 and *end == 0)
+                ids.push_back(id);
+        }
+
+        closedir(dir);
+    }
+
+    std::sort(ids.begin(), ids.end());
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        char path[128];
+        snprintf(path, sizeof(path), PLACEMENT_SYSFS_NODE_DIR "/node%d/cpulist", ids[i]);
+
+        std::ifstream in(path);
+        std::string list;
+        std::vector<int> cpus;
+
+        if (std::getline(in, list)) {
+            parseCpuList(list, cpus);
+            addNode(ids[i], cpus, allowed);
+        }
+    }
+
+    // Without NUMA information all cores are one node
+    if (nodes.empty()) {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            cpus.push_back(cpu);
+
+        addNode(0, cpus, allowed);
+    }
+
+    if (nodes.empty()) {
+        LOG_WARN("No usable cores found, router threads are not placed");
+        return;
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++)
+        LOG_INFO("Placement node %d has %lu cores", nodes[i]->id, nodes[i]->cpus.size());
+
+    LOG_INFO("Router threads are placed by %s on %lu NUMA nodes", by_core ? "core" : "node", nodes.size());
+
+    running = true;
+}
+
+/**
+ * Indicates if the router threads are placed
+ */
+bool CpuPlacement::enabled() {
+    return running;
+}
+
+/**
+ * Choose the node and core of a router, placement_node and placement_cpu are set
+ *
+ * \param [in,out] client   Accepted client connection, incoming_cpu is used if known
+ */
+void CpuPlacement::assign(BMPListener::ClientInfo &client) {
+    client.placement_node = -1;
+    client.placement_cpu = -1;
+
+    if (not running)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    int cpu = client.incoming_cpu;
+    int node;
+
+    // The node and core receiving the router packets if usable, otherwise the least used
+    if (cpu >= 0 and cpu < CPU_SETSIZE and cpu_node[cpu] >= 0) {
+        node = cpu_node[cpu];
+
+    } else {
+        node = 0;
+        for (size_t i = 1; i < nodes.size(); i++) {
+            if (nodes[i]->routers < nodes[node]->routers)
+                node = i;
+        }
+
+        cpu = nodes[node]->cpus[0];
+        for (size_t i = 1; i < nodes[node]->cpus.size(); i++) {
+            if (cpu_routers[nodes[node]->cpus[i]] < cpu_routers[cpu])
+                cpu = nodes[node]->cpus[i];
+        }
+    }
+
+    nodes[node]->routers++;
+    client.placement_node = node;
+
+    if (by_core) {
+        cpu_routers[cpu]++;
+        client.placement_cpu = cpu;
+
+        LOG_INFO("%s: Router placed on cpu %d of node %d, %d routers on the node", client.c_ip, cpu,
+                 nodes[node]->id, nodes[node]->routers);
+    } else
+        LOG_INFO("%s: Router placed on node %d, %d routers on the node", client.c_ip, nodes[node]->id,
+                 nodes[node]->routers);
+}
+
+/**
+ * Release the placement of a router once its threads are done
+ *
+ * \param [in] client       Client connection given to assign()
+ */
+void CpuPlacement::release(const BMPListener::ClientInfo &client) {
+    if (not running or client.placement_node < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (nodes[client.placement_node]->routers > 0)
+        nodes[client.placement_node]->routers--;
+
+    if (client.placement_cpu >= 0 and cpu_routers[client.placement_cpu] > 0)
+        cpu_routers[client.placement_cpu]--;
+}
+
+/**
+ * Pin the calling thread to the placement of a router
+ *
+ * \param [in] client       Client connection given to assign()
+ *
+ * \return true if pinned
+ */
+bool CpuPlacement::pin(const BMPListener::ClientInfo &client) {
+    if (not running or client.placement_node < 0)
+        return false;
+
+    cpu_set_t cpus;
+
+    if (client.placement_cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(client.placement_cpu, &cpus);
+    } else
+        cpus = nodes[client.placement_node]->cpuset;
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        LOG_WARN("%s: Failed to pin the router thread to node %d", client.c_ip, nodes[client.placement_node]->id);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * NUMA node of the core the calling thread runs on
+ *
+ * \return node index, -1 if not placed or unknown
+ */
+int CpuPlacement::currentNode() {
+    if (not running)
+        return -1;
+
+    int cpu = sched_getcpu();
+
+    return cpu >= 0 and cpu < CPU_SETSIZE ? cpu_node[cpu] : -1;
+}
+
+/**
+ * Widen the affinity of the calling thread to its node until the scope ends
+ */
+CpuPlacement::NodeScope::NodeScope() {
+    restore = false;
+
+    int node = currentNode();
+    if (node < 0 or pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) != 0)
+        return;
+
+    restore = pthread_setaffinity_np(pthread_self(), sizeof(nodes[node]->cpuset), &nodes[node]->cpuset) == 0;
+}
+
+CpuPlacement::NodeScope::~NodeScope() {
+    if (restore)
+        pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+}
+
+/**
+ * Count the messages parsed by a router, for the per node totals
+ *
+ * \param [in] node         Placement node of the router
+ * \param [in] msgs         Number of messages
+ * \param [in] bytes        Number of bytes
+ */
+void CpuPlacement::count(int node, uint64_t msgs, uint64_t bytes) {
+    if (node < 0 or node >= (int)nodes.size())
+        return;
+
+    nodes[node]->messages.fetch_add(msgs, std::memory_order_relaxed);
+    nodes[node]->bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/**
+ * Render the per node metrics in the Prometheus text format, see Metrics
+ *
+ * \details The busy and idle time of the cores of a node are of all processes, from /proc/stat.
+ *
+ * \param [out] out         Rendered metrics, appended to
+ */
+void CpuPlacement::render(std::string &out) {
+    if (not running)
+        return;
+
+    char buf[256];
+
+    // Busy and idle ticks of the usable cores of each node
+    std::vector<uint64_t> busy(nodes.size(), 0), idle(nodes.size(), 0);
+    std::ifstream stat("/proc/stat");
+    std::string line;
+
+    while (std::getline(stat, line)) {
+        int cpu;
+        unsigned long long user, nice, system, idle_t, iowait, irq, softirq, steal;
+
+        if (sscanf(line.c_str(), "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu", &cpu, &user, &nice, &system,
+                   &idle_t, &iowait, &irq, &softirq, &steal) != 9 or cpu < 0 or cpu >= CPU_SETSIZE or cpu_node[cpu] < 0)
+            continue;
+
+        busy[cpu_node[cpu]] += user + nice + system + irq + softirq + steal;
+        idle[cpu_node[cpu]] += idle_t + iowait;
+    }
+
+    double ticks = sysconf(_SC_CLK_TCK);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    out.append("# HELP openbmp_node_routers Routers placed on the NUMA node\n"
+               "# TYPE openbmp_node_routers gauge\n");
+    for (size_t i = 0; i < nodes.size(); i++) {
+        snprintf(buf, sizeof(buf), "openbmp_node_routers{node=\"%d\"} %d\n", nodes[i]->id, nodes[i]->routers);
+        out.append(buf);
+    }
+
+    out.append("# HELP openbmp_node_messages_total BMP messages parsed by the routers of the NUMA node\n"
+               "# TYPE openbmp_node_messages_total counter\n");
+    for (size_t i = 0; i < nodes.size(); i++) {
+        snprintf(buf, sizeof(buf), "openbmp_node_messages_total{node=\"%d\"} %lu\n", nodes[i]->id,
+                 (unsigned long)nodes[i]->messages.load());
+        out.append(buf);
+    }
+
+    out.append("# HELP openbmp_node_bytes_total BMP bytes parsed by the routers of the NUMA node\n"
+               "# TYPE openbmp_node_bytes_total counter\n");
+    for (size_t i = 0; i < nodes.size(); i++) {
+        snprintf(buf, sizeof(buf), "openbmp_node_bytes_total{node=\"%d\"} %lu\n", nodes[i]->id,
+                 (unsigned long)nodes[i]->bytes.load());
+        out.append(buf);
+    }
+
+    out.append("# HELP openbmp_node_cpu_seconds_total Time of the cores of the NUMA node by mode\n"
+               "# TYPE openbmp_node_cpu_seconds_total counter\n");
+    for (size_t i = 0; i < nodes.size(); i++) {
+        snprintf(buf, sizeof(buf), "openbmp_node_cpu_seconds_total{node=\"%d\",mode=\"busy\"} %g\n"
+                 "openbmp_node_cpu_seconds_total{node=\"%d\",mode=\"idle\"} %g\n",
+                 nodes[i]->id, busy[i] / ticks, nodes[i]->id, idle[i] / ticks);
+        out.append(buf);
+    }
+}
+
+/**
+ * Parse a kernel cpu list, e.g. 0-7,16-23
+ *
+ * \param [in]  list        CPU list
+ * \param [out] cpus        CPUs of the list, appended to
+ */
+void CpuPlacement::parseCpuList(const std::string &list, std::vector<int> &cpus) {
+    std::stringstream ss(list);
+    std::string range;
+
+    while (std::getline(ss, range, ',')) {
+        int first, last;
+
+        switch (sscanf(range.c_str(), "%d-%d", &first, &last)) {
+            case 1 :
+                last = first;
+                break;
+
+            case 2 :
+                break;
+
+            default:
+                continue;
+        }
+
+        for (int cpu = first; cpu <= last and cpu < CPU_SETSIZE; cpu++)
+            cpus.push_back(cpu);
+    }
+}
+
+/**
+ * Add a node with the usable cpus of a cpu list
+ *
+ * \param [in] id           Node number of the kernel
+ * \param [in] cpus         CPUs of the node
+ * \param [in] allowed      CPUs the process may run on
+ */
+void CpuPlacement::addNode(int id, const std::vector<int> &cpus, const cpu_set_t &allowed) {
+    Node *node = new Node();
+    node->id = id;
+    node->routers = 0;
+    CPU_ZERO(&node->cpuset);
+
+    for (size_t i = 0; i < cpus.size(); i++) {
+        if (cpus[i] < 0 or cpus[i] >= CPU_SETSIZE or not CPU_ISSET(cpus[i], &allowed))
+            continue;
+
+        node->cpus.push_back(cpus[i]);
+        CPU_SET(cpus[i], &node->cpuset);
+        cpu_node[cpus[i]] = nodes.size();
+    }
+
+    // Memory only nodes and nodes the process can't use are skipped
+    if (node->cpus.empty()) {
+        delete node;
+        return;
+    }
+
+    nodes.push_back(node);
+}
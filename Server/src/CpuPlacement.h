@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef CPUPLACEMENT_H_
+#define CPUPLACEMENT_H_
+
+#include <sched.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+#include "Config.h"
+#include "BMPListener.h"
+#include "CacheAligned.h"
+
+#define PLACEMENT_SYSFS_NODE_DIR    "/sys/devices/system/node"  ///< NUMA topology of the kernel
+
+/**
+ * \class   CpuPlacement
+ *
+ * \brief   Places the threads of a router on one NUMA node or core
+ * \details With base.placement.policy node, the client and reader threads of a router are
+ *          pinned to the cores of one NUMA node; with core both are pinned to one core.  The
+ *          node, or core, is the one receiving the router packets (SO_INCOMING_CPU) if known,
+ *          otherwise the one with the fewest routers.
+ *
+ *          The client thread is pinned before it allocates anything, so the router buffers,
+ *          the message bus working buffers and a dedicated kafka producer are first touched,
+ *          and allocated, on the node.  The reader thread and the librdkafka threads inherit
+ *          the affinity.  Shared producers (kafka.producer.pool.size) are assigned to the
+ *          routers of the node that created them, see KafkaProducerPool.
+ *
+ *          The topology is read from sysfs and limited to the cores the process may run on.
+ *          Without NUMA information all cores are one node.
+ */
+class CpuPlacement {
+public:
+    /**
+     * Read the topology, if base.placement.policy is not none
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     */
+    static void start(Logger *logPtr, Config *cfg);
+
+    /**
+     * Indicates if the router threads are placed
+     */
+    static bool enabled();
+
+    /**
+     * Choose the node and core of a router, placement_node and placement_cpu are set
+     *
+     * \param [in,out] client   Accepted client connection, incoming_cpu is used if known
+     */
+    static void assign(BMPListener::ClientInfo &client);
+
+    /**
+     * Release the placement of a router once its threads are done
+     *
+     * \param [in] client       Client connection given to assign()
+     */
+    static void release(const BMPListener::ClientInfo &client);
+
+    /**
+     * Pin the calling thread to the placement of a router
+     *
+     * \details Threads created by the calling thread after this inherit the affinity.
+     *
+     * \param [in] client       Client connection given to assign()
+     *
+     * \return true if pinned
+     */
+    static bool pin(const BMPListener::ClientInfo &client);
+
+    /**
+     * NUMA node of the core the calling thread runs on
+     *
+     * \return node index, -1 if not placed or unknown
+     */
+    static int currentNode();
+
+    /**
+     * Widen the affinity of the calling thread to its node until the scope ends
+     *
+     * \details Used to create threads shared by the routers of a node from a router thread
+     *          pinned to one core, e.g. the librdkafka threads of a shared producer.
+     */
+    class NodeScope {
+    public:
+        NodeScope();
+        ~NodeScope();
+
+    private:
+        cpu_set_t   saved;              ///< Affinity to restore
+        bool        restore;            ///< Indicates the affinity was changed
+    };
+
+    /**
+     * Count the messages parsed by a router, for the per node totals
+     *
+     * \param [in] node         Placement node of the router
+     * \param [in] msgs         Number of messages
+     * \param [in] bytes        Number of bytes
+     */
+    static void count(int node, uint64_t msgs, uint64_t bytes);
+
+    /**
+     * Render the per node metrics in the Prometheus text format, see Metrics
+     *
+     * \param [out] out         Rendered metrics, appended to
+     */
+    static void render(std::string &out);
+
+private:
+    /**
+     * NUMA node
+     */
+    struct alignas(64) Node : public CacheAligned {
+        int                     id;         ///< Node number of the kernel
+        std::vector<int>        cpus;       ///< Cores of the node the process may use
+        cpu_set_t               cpuset;     ///< Cores as an affinity mask
+        int                     routers;    ///< Routers placed on the node, guarded by mutex
+        std::atomic<uint64_t>   messages;   ///< BMP messages parsed by the routers of the node
+        std::atomic<uint64_t>   bytes;      ///< BMP bytes parsed by the routers of the node
+    };
+
+    static std::mutex           mutex;      ///< Guards the router counts
+    static std::vector<Node *>  nodes;      ///< Nodes with at least one usable core
+    static std::vector<int>     cpu_node;   ///< Node index by cpu, -1 if not usable
+    static std::vector<int>     cpu_routers; ///< Routers placed on each cpu by the core policy
+    static bool                 by_core;    ///< Indicates the core policy, node policy if false
+    static std::atomic<bool>    running;
+    static Logger               *logger;
+
+    /**
+     * Parse a kernel cpu list, e.g. 0-7,16-23
+     *
+     * \param [in]  list        CPU list
+     * \param [out] cpus        CPUs of the list, appended to
+     */
+    static void parseCpuList(const std::string &list, std::vector<int> &cpus);
+
+    /**
+     * Add a node with the usable cpus of a cpu list
+     */
+    static void addNode(int id, const std::vector<int> &cpus, const cpu_set_t &allowed);
+};
+
+#endif /* CPUPLACEMENT_H_ */
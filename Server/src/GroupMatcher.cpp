@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <arpa/inet.h>
+#include <cstring>
+
+#include "GroupMatcher.h"
+
+/**
+ * Constructor for class
+ */
+GroupMatcher::GroupMatcher() {
+    clear();
+}
+
+/**
+ * Remove all rules
+ */
+void GroupMatcher::clear() {
+    TrieNode root = { { 0, 0 }, -1 };
+
+    names.clear();
+    regexps.clear();
+    asns.clear();
+
+    nodes.clear();
+    nodes.push_back(root);              // IPv4
+    nodes.push_back(root);              // IPv6
+    has_prefixes = false;
+}
+
+/**
+ * Index of the group
+ *
+ * \details A group is only compared against groups of the same match type, so a new index is
+ *          added whenever the group differs from the last one added.  Index order is then the
+ *          order the groups were added in each match type.
+ */
+int GroupMatcher::groupIndex(const std::string &group) {
+    if (names.empty() or names.back() != group)
+        names.push_back(group);
+
+    return names.size() - 1;
+}
+
+/**
+ * Add a hostname regular expression of a group
+ *
+ * \param [in] group     Group name
+ * \param [in] regexp    Compiled regular expression
+ */
+void GroupMatcher::addRegexp(const std::string &group, const boost::xpressive::sregex &regexp) {
+    regexps.push_back(std::make_pair(regexp, groupIndex(group)));
+}
+
+/**
+ * Add an IP prefix of a group
+ *
+ * \param [in] group     Group name
+ * \param [in] isIPv4    True if IPv4, false if IPv6
+ * \param [in] prefix    Prefix in network byte order (4 or 16 bytes)
+ * \param [in] bits      Prefix length
+ */
+void GroupMatcher::addPrefix(const std::string &group, bool isIPv4, const uint32_t *prefix, uint8_t bits) {
+    const u_char *addr = (const u_char *)prefix;
+    int idx = groupIndex(group);
+    int node = isIPv4 ? 0 : 1;
+
+    if (bits > (isIPv4 ? 32 : 128))
+        bits = isIPv4 ? 32 : 128;
+
+    for (int i = 0; i < bits; i++) {
+        int bit = (addr[i / 8] >> (7 - i % 8)) & 1;
+
+        if (nodes[node].child[bit] == 0) {
+            TrieNode child = { { 0, 0 }, -1 };
+            nodes.push_back(child);
+            nodes[node].child[bit] = nodes.size() - 1;
+        }
+
+        node = nodes[node].child[bit];
+    }
+
+    // Keep the first group for duplicate prefixes
+    if (nodes[node].group < 0)
+        nodes[node].group = idx;
+
+    has_prefixes = true;
+}
+
+/**
+ * Add an ASN of a group
+ *
+ * \param [in] group     Group name
+ * \param [in] asn       ASN
+ */
+void GroupMatcher::addAsn(const std::string &group, uint32_t asn) {
+    int idx = groupIndex(group);
+
+    // emplace keeps the first group of a duplicate ASN
+    asns.emplace(asn, idx);
+}
+
+/**
+ * Lookup the group
+ *
+ * \param [in] hostname  Hostname/fqdn, regular expressions are skipped if empty
+ * \param [in] ip_addr   IP address (printed form)
+ * \param [in] asn       Pointer to the ASN, NULL to skip the ASN match
+ *
+ * \return Pointer to the group name, NULL if no group matched
+ */
+const std::string *GroupMatcher::lookup(const std::string &hostname, const std::string &ip_addr,
+                                        const uint32_t *asn) const {
+    /*
+     * Match against hostname regexp
+     */
+    if (hostname.size() > 0) {
+        for (size_t i = 0; i < regexps.size(); i++) {
+            if (regex_search(hostname, regexps[i].first))
+                return &names[regexps[i].second];
+        }
+    }
+
+    /*
+     * Match against prefix ranges, the first group of all prefixes covering the address wins
+     */
+    if (has_prefixes) {
+        bool isIPv4 = ip_addr.find_first_of(':') == std::string::npos;
+        u_char addr[16];
+
+        bzero(addr, sizeof(addr));
+        if (inet_pton(isIPv4 ? AF_INET : AF_INET6, ip_addr.c_str(), addr) == 1) {
+            int max_bits = isIPv4 ? 32 : 128;
+            int node = isIPv4 ? 0 : 1;
+            int found = -1;
+
+            for (int i = 0; i < max_bits; i++) {
+                int bit = (addr[i / 8] >> (7 - i % 8)) & 1;
+
+                node = nodes[node].child[bit];
+                if (node == 0)
+                    break;
+
+                if (nodes[node].group >= 0 and (found < 0 or nodes[node].group < found))
+                    found = nodes[node].group;
+            }
+
+            if (found >= 0)
+                return &names[found];
+        }
+    }
+
+    /*
+     * Match against asn list
+     */
+    if (asn != NULL) {
+        std::unordered_map<uint32_t, int>::const_iterator it = asns.find(*asn);
+
+        if (it != asns.end())
+            return &names[it->second];
+    }
+
+    return NULL;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef GROUPMATCHER_H_
+#define GROUPMATCHER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <boost/xpressive/xpressive.hpp>
+
+/**
+ * \class   GroupMatcher
+ *
+ * \brief   Compiled router or peer group matching rules
+ * \details Built once when the configuration is loaded.  Hostname regular expressions are
+ *          checked first, then the IP prefixes and last the ASNs; within each the first group
+ *          in the configuration map order wins, same as the linear search it replaces.
+ *
+ *          Prefixes are kept in a binary trie per address family, a lookup walks at most the
+ *          address length.  ASNs are in a hash map.  Regular expressions are searched in order,
+ *          xpressive has no combined set matcher.
+ *
+ *          Lookups don't modify the matcher and are safe from multiple threads.
+ */
+class GroupMatcher {
+public:
+    GroupMatcher();
+
+    /**
+     * Add a hostname regular expression of a group
+     *
+     * \details Groups must be added in the order of precedence within the match type
+     *
+     * \param [in] group     Group name
+     * \param [in] regexp    Compiled regular expression
+     */
+    void addRegexp(const std::string &group, const boost::xpressive::sregex &regexp);
+
+    /**
+     * Add an IP prefix of a group
+     *
+     * \param [in] group     Group name
+     * \param [in] isIPv4    True if IPv4, false if IPv6
+     * \param [in] prefix    Prefix in network byte order (4 or 16 bytes)
+     * \param [in] bits      Prefix length
+     */
+    void addPrefix(const std::string &group, bool isIPv4, const uint32_t *prefix, uint8_t bits);
+
+    /**
+     * Add an ASN of a group
+     *
+     * \param [in] group     Group name
+     * \param [in] asn       ASN
+     */
+    void addAsn(const std::string &group, uint32_t asn);
+
+    /**
+     * Lookup the group
+     *
+     * \param [in] hostname  Hostname/fqdn, regular expressions are skipped if empty
+     * \param [in] ip_addr   IP address (printed form)
+     * \param [in] asn       Pointer to the ASN, NULL to skip the ASN match
+     *
+     * \return Pointer to the group name, NULL if no group matched
+     */
+    const std::string *lookup(const std::string &hostname, const std::string &ip_addr,
+                              const uint32_t *asn = NULL) const;
+
+    /**
+     * Remove all rules
+     */
+    void clear();
+
+private:
+    /**
+     * Prefix trie node, children are indexes in nodes
+     */
+    struct TrieNode {
+        int         child[2];                   ///< Child for the next bit 0 and 1, 0 if none
+        int         group;                      ///< Group of a prefix ending here, -1 if none
+    };
+
+    std::vector<std::string>    names;          ///< Group names, the index is the group precedence
+
+    /// Regular expressions in order, paired with the group index
+    std::vector<std::pair<boost::xpressive::sregex, int>> regexps;
+
+    std::vector<TrieNode>       nodes;          ///< Trie nodes, 0 is the IPv4 root and 1 the IPv6 root
+    bool                        has_prefixes;   ///< True if any prefix was added
+
+    std::unordered_map<uint32_t, int> asns;     ///< ASN to group index
+
+    /**
+     * Index of the group, a new index is added if the group differs from the last added
+     */
+    int groupIndex(const std::string &group);
+};
+
+#endif /* GROUPMATCHER_H_ */
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <cstring>
+
+#include "HashEngine.h"
+
+HashEngine::Algorithm HashEngine::algorithm = HashEngine::HASH_MD5;
+
+/*
+ * MurmurHash3 x64 128 constants, see https://github.com/aappleby/smhasher
+ */
+#define MM3_C1      0x87c37b91114253d5ULL
+#define MM3_C2      0x4cf5ad432745937fULL
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+
+    return k;
+}
+
+static inline uint64_t load64(const u_char *p) {
+    return   (uint64_t)p[0]        | ((uint64_t)p[1] << 8)
+          | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24)
+          | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40)
+          | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline void store64(u_char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++)
+        p[i] = (u_char)(v >> (i * 8));
+}
+
+HashEngine::HashEngine() {
+    reset();
+}
+
+/**
+ * Select the algorithm used by all new HashEngine instances
+ *
+ * \details Must be called before any router threads are started.
+ *
+ * \param [in] name     Algorithm name, "md5" or "murmur3"
+ *
+ * \return true if the name is valid, false otherwise (algorithm isn't changed)
+ */
+bool HashEngine::setAlgorithm(const std::string &name) {
+    if (name.compare("md5") == 0)
+        algorithm = HASH_MD5;
+    else if (name.compare("murmur3") == 0)
+        algorithm = HASH_MURMUR3;
+    else
+        return false;
+
+    return true;
+}
+
+/**
+ * Get the current algorithm
+ */
+HashEngine::Algorithm HashEngine::getAlgorithm() {
+    return algorithm;
+}
+
+/**
+ * Reset to start a new hash
+ */
+void HashEngine::reset() {
+    alg = algorithm;
+
+    if (alg == HASH_MD5) {
+        md5.reset();
+
+    } else {
+        h1 = h2 = 0;            // seed is zero
+        tail_len = 0;
+        total_len = 0;
+    }
+}
+
+/**
+ * Add data to the hash
+ *
+ * \param [in] data     Data to hash
+ * \param [in] len      Length of data in bytes
+ */
+void HashEngine::update(const void *data, size_t len) {
+    const u_char *p = (const u_char *)data;
+
+    if (alg == HASH_MD5) {
+        md5.update((unsigned char *)p, len);
+        return;
+    }
+
+    total_len += len;
+
+    // Complete a partial block from the previous update
+    if (tail_len > 0) {
+        size_t n = sizeof(tail) - tail_len;
+        if (n > len)
+            n = len;
+
+        memcpy(tail + tail_len, p, n);
+        tail_len += n;
+        p += n;
+        len -= n;
+
+        if (tail_len < sizeof(tail))
+            return;
+
+        murmurBlock(tail);
+        tail_len = 0;
+    }
+
+    for (; len >= 16; p += 16, len -= 16)
+        murmurBlock(p);
+
+    if (len > 0) {
+        memcpy(tail, p, len);
+        tail_len = len;
+    }
+}
+
+/**
+ * Finalize the hash, update() cannot be called after this
+ */
+void HashEngine::finalize() {
+    if (alg == HASH_MD5)
+        md5.finalize();
+    else
+        murmurFinalize();
+}
+
+/**
+ * Copy the binary hash
+ *
+ * \param [out] out     Buffer of HASH_ENGINE_DIGEST_SIZE bytes for the hash
+ */
+void HashEngine::digest(u_char *out) {
+    if (alg == HASH_MD5)
+        md5.raw_digest(out);
+    else
+        memcpy(out, mm_digest, sizeof(mm_digest));
+}
+
+/**
+ * Mix a 16 byte block into the murmur state
+ */
+void HashEngine::murmurBlock(const u_char *block) {
+    uint64_t k1 = load64(block);
+    uint64_t k2 = load64(block + 8);
+
+    k1 *= MM3_C1; k1 = rotl64(k1, 31); k1 *= MM3_C2; h1 ^= k1;
+    h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= MM3_C2; k2 = rotl64(k2, 33); k2 *= MM3_C1; h2 ^= k2;
+    h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+}
+
+/**
+ * Mix the remaining bytes and length into the murmur state and store the digest
+ */
+void HashEngine::murmurFinalize() {
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    uint64_t a = h1, b = h2;
+
+    if (tail_len > 8) {
+        for (size_t i = tail_len; i > 8; i--)
+            k2 ^= (uint64_t)tail[i - 1] << ((i - 9) * 8);
+
+        k2 *= MM3_C2; k2 = rotl64(k2, 33); k2 *= MM3_C1; b ^= k2;
+    }
+
+    if (tail_len > 0) {
+        for (size_t i = (tail_len > 8 ? 8 : tail_len); i > 0; i--)
+            k1 ^= (uint64_t)tail[i - 1] << ((i - 1) * 8);
+
+        k1 *= MM3_C1; k1 = rotl64(k1, 31); k1 *= MM3_C2; a ^= k1;
+    }
+
+    a ^= total_len;
+    b ^= total_len;
+
+    a += b;
+    b += a;
+
+    a = fmix64(a);
+    b = fmix64(b);
+
+    a += b;
+    b += a;
+
+    store64(mm_digest, a);
+    store64(mm_digest + 8, b);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef HASHENGINE_H_
+#define HASHENGINE_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
+
+#include "md5.h"
+
+/**
+ * \class   HashEngine
+ *
+ * \brief   128 bit hash used for the collector, router, peer, path and prefix hash ids
+ * \details The algorithm is selected once at startup with setAlgorithm().  MD5 is the
+ *          default and generates the same hash ids as previous versions.  MURMUR3 is
+ *          MurmurHash3 x64 128 bit, which is several times faster but generates
+ *          different hash ids; consumers that store hash ids must not mix the two.
+ *
+ *          The digest is copied into a caller supplied buffer, no memory is allocated.
+ */
+class HashEngine {
+public:
+    #define HASH_ENGINE_DIGEST_SIZE     16              ///< Size in bytes of the binary hash
+
+    enum Algorithm { HASH_MD5=0, HASH_MURMUR3 };
+
+    HashEngine();
+
+    /**
+     * Select the algorithm used by all new HashEngine instances
+     *
+     * \details Must be called before any router threads are started.
+     *
+     * \param [in] name     Algorithm name, "md5" or "murmur3"
+     *
+     * \return true if the name is valid, false otherwise (algorithm isn't changed)
+     */
+    static bool setAlgorithm(const std::string &name);
+
+    /**
+     * Get the current algorithm
+     */
+    static Algorithm getAlgorithm();
+
+    /**
+     * Add data to the hash
+     *
+     * \param [in] data     Data to hash
+     * \param [in] len      Length of data in bytes
+     */
+    void update(const void *data, size_t len);
+
+    /**
+     * Finalize the hash, update() cannot be called after this
+     */
+    void finalize();
+
+    /**
+     * Copy the binary hash
+     *
+     * \param [out] out     Buffer of HASH_ENGINE_DIGEST_SIZE bytes for the hash
+     */
+    void digest(u_char *out);
+
+    /**
+     * Reset to start a new hash
+     */
+    void reset();
+
+private:
+    static Algorithm    algorithm;                  ///< Algorithm used by new instances
+
+    Algorithm           alg;                        ///< Algorithm of this instance
+
+    MD5                 md5;                        ///< MD5 context
+
+    /*
+     * MurmurHash3 x64 128 state
+     */
+    uint64_t            h1;
+    uint64_t            h2;
+    u_char              tail[16];                   ///< Partial block
+    size_t              tail_len;                   ///< Number of bytes in tail
+    uint64_t            total_len;                  ///< Total number of bytes hashed
+    u_char              mm_digest[16];              ///< Finalized murmur digest
+
+    void murmurBlock(const u_char *block);
+    void murmurFinalize();
+};
+
+#endif /* HASHENGINE_H_ */
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <sys/socket.h>
+#include <netdb.h>
+#include <chrono>
+
+#include "HostResolver.h"
+
+std::mutex                      HostResolver::mutex;
+std::condition_variable         HostResolver::queue_cond;
+std::condition_variable         HostResolver::done_cond;
+std::unordered_map<std::string, HostResolver::Entry> HostResolver::cache;
+std::deque<std::string>         HostResolver::queue;
+std::vector<std::thread *>      HostResolver::threads;
+bool                            HostResolver::running = false;
+int                             HostResolver::timeout = 0;
+int                             HostResolver::cache_time = 3600;
+Logger                          *HostResolver::logger = NULL;
+
+/**
+ * Start the resolver threads
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfg          Pointer to the config instance
+ */
+void HostResolver::start(Logger *logPtr, Config *cfg) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running)
+        return;
+
+    logger = logPtr;
+    timeout = cfg->resolver_timeout;
+    cache_time = cfg->resolver_cache_time;
+    running = true;
+
+    for (int i = 0; i < cfg->resolver_threads; i++)
+        threads.push_back(new std::thread(HostResolver::run));
+}
+
+/**
+ * Stop the resolver threads
+ */
+void HostResolver::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+
+    queue_cond.notify_all();
+
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    threads.clear();
+
+    // Wake callers of lookups that were still queued
+    done_cond.notify_all();
+}
+
+/**
+ * Resolve an IP address to a hostname
+ *
+ * \param [in]  addr        IP address (printed form)
+ * \param [out] hostname    Hostname, not changed if not resolved
+ *
+ * \return true if resolved, false if the lookup failed or timed out
+ */
+bool HostResolver::resolve(const std::string &addr, std::string &hostname) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (not running) {
+        lock.unlock();
+        return lookup(addr, hostname);
+    }
+
+    time_t now = time(NULL);
+    std::unordered_map<std::string, Entry>::iterator it = cache.find(addr);
+
+    if (it == cache.end() or (it->second.expires != 0 and it->second.expires <= now)) {
+        Entry &entry = cache[addr];
+        entry.expires = 0;
+        queue.push_back(addr);
+        queue_cond.notify_one();
+    }
+
+    // Wait for the lookup, entries are never erased while pending
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+                                                     std::chrono::milliseconds(timeout);
+
+    while (running) {
+        it = cache.find(addr);
+        if (it == cache.end() or it->second.expires != 0)
+            break;
+
+        if (timeout == 0)
+            done_cond.wait(lock);
+
+        else if (done_cond.wait_until(lock, deadline) == std::cv_status::timeout)
+            break;
+    }
+
+    it = cache.find(addr);
+    if (it == cache.end() or it->second.expires == 0 or it->second.hostname.empty())
+        return false;
+
+    hostname = it->second.hostname;
+    return true;
+}
+
+/**
+ * Get the completed lookups that haven't expired
+ *
+ * \param [out] entries    Lookups by address, appended to
+ */
+void HostResolver::getCached(std::vector<std::pair<std::string, Entry> > &entries) {
+    std::lock_guard<std::mutex> lock(mutex);
+    time_t now = time(NULL);
+
+    for (std::unordered_map<std::string, Entry>::iterator it = cache.begin(); it != cache.end(); ++it) {
+        if (it->second.expires > now)
+            entries.push_back(*it);
+    }
+}
+
+/**
+ * Add a lookup done before a restart
+ *
+ * \param [in] addr        IP address (printed form)
+ * \param [in] entry       Hostname and time it expires
+ */
+void HostResolver::addCached(const std::string &addr, const Entry &entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (entry.expires <= time(NULL) or cache.size() >= RESOLVER_MAX_CACHE)
+        return;
+
+    cache.insert(std::make_pair(addr, entry));
+}
+
+/**
+ * Lookup an address using DNS
+ *
+ * \return true if resolved
+ */
+bool HostResolver::lookup(const std::string &addr, std::string &hostname) {
+    addrinfo *ai;
+    char host[255];
+    bool resolved = false;
+
+    if (!getaddrinfo(addr.c_str(), NULL, NULL, &ai)) {
+
+        if (!getnameinfo(ai->ai_addr,ai->ai_addrlen, host, sizeof(host), NULL, 0, NI_NAMEREQD)) {
+            hostname.assign(host);
+            resolved = true;
+
+            if (logger != NULL)
+                LOG_INFO("resolve: %s to %s", addr.c_str(), hostname.c_str());
+        }
+
+        freeaddrinfo(ai);
+    }
+
+    return resolved;
+}
+
+/**
+ * Store the result of a lookup, mutex must be held
+ */
+void HostResolver::store(const std::string &addr, const std::string &hostname) {
+    time_t now = time(NULL);
+
+    if (cache.size() >= RESOLVER_MAX_CACHE) {
+        for (std::unordered_map<std::string, Entry>::iterator it = cache.begin(); it != cache.end(); ) {
+            if (it->second.expires != 0 and it->second.expires <= now)
+                it = cache.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    Entry &entry = cache[addr];
+    entry.hostname = hostname;
+    entry.expires = now + cache_time;
+}
+
+/**
+ * Resolver thread
+ */
+void HostResolver::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (running) {
+        if (queue.empty()) {
+            queue_cond.wait(lock);
+            continue;
+        }
+
+        std::string addr = queue.front();
+        queue.pop_front();
+
+        lock.unlock();
+
+        std::string hostname;
+        lookup(addr, hostname);
+
+        lock.lock();
+        store(addr, hostname);
+        done_cond.notify_all();
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef HOSTRESOLVER_H_
+#define HOSTRESOLVER_H_
+
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Logger.h"
+#include "Config.h"
+
+#define RESOLVER_MAX_CACHE      65536       ///< Cache size at which expired entries are pruned
+
+/**
+ * \class   HostResolver
+ *
+ * \brief   Cached reverse DNS lookups of router and peer addresses
+ * \details Lookups are done by resolver threads.  Concurrent requests for the same address
+ *          wait on the same lookup.  Results, including failed lookups, are cached for
+ *          resolver.cache_time seconds.
+ *
+ *          A caller waits up to resolver.timeout ms for the lookup; on timeout the hostname is
+ *          left empty and the lookup completes in the background for the next caller.  Before
+ *          start() lookups are done in the calling thread.
+ */
+class HostResolver {
+public:
+    /**
+     * Start the resolver threads
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     */
+    static void start(Logger *logPtr, Config *cfg);
+
+    /**
+     * Stop the resolver threads
+     */
+    static void stop();
+
+    /**
+     * Resolve an IP address to a hostname
+     *
+     * \param [in]  addr        IP address (printed form)
+     * \param [out] hostname    Hostname, not changed if not resolved
+     *
+     * \return true if resolved, false if the lookup failed or timed out
+     */
+    static bool resolve(const std::string &addr, std::string &hostname);
+
+    /**
+     * Cached lookup of an address
+     */
+    struct Entry {
+        std::string hostname;               ///< Hostname, empty if the lookup failed
+        time_t      expires;                ///< Time the entry expires, 0 while the lookup is pending
+    };
+
+    /**
+     * Get the completed lookups that haven't expired, see CollectorState
+     *
+     * \param [out] entries    Lookups by address, appended to
+     */
+    static void getCached(std::vector<std::pair<std::string, Entry> > &entries);
+
+    /**
+     * Add a lookup done before a restart, see CollectorState
+     *
+     * \details Ignored if expired or the address is already cached.
+     *
+     * \param [in] addr        IP address (printed form)
+     * \param [in] entry       Hostname and time it expires
+     */
+    static void addCached(const std::string &addr, const Entry &entry);
+
+private:
+
+    static std::mutex                       mutex;
+    static std::condition_variable          queue_cond;     ///< Signaled when a lookup is queued
+    static std::condition_variable          done_cond;      ///< Signaled when a lookup is done
+    static std::unordered_map<std::string, Entry> cache;    ///< Cache by address, guarded by mutex
+    static std::deque<std::string>          queue;          ///< Addresses to lookup, guarded by mutex
+    static std::vector<std::thread *>       threads;
+    static bool                             running;
+    static int                              timeout;        ///< Caller wait in ms, 0 waits for the lookup
+    static int                              cache_time;     ///< Seconds a result is cached
+    static Logger                           *logger;
+
+    /**
+     * Lookup an address using DNS
+     *
+     * \return true if resolved
+     */
+    static bool lookup(const std::string &addr, std::string &hostname);
+
+    /**
+     * Store the result of a lookup, mutex must be held
+     */
+    static void store(const std::string &addr, const std::string &hostname);
+
+    /**
+     * Resolver thread
+     */
+    static void run();
+};
+
+#endif /* HOSTRESOLVER_H_ */
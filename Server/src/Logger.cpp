@@ -15,9 +15,12 @@
 #include <ctime>
 #include <cerrno>
 #include <stdarg.h>
+#include <unistd.h>
 
 #include "Logger.h"
 
+thread_local Logger::RingRef Logger::thread_ring;
+
 /*********************************************************************//**
  * Constructor for class
  *
@@ -36,6 +39,9 @@ Logger::Logger(const char *log_filename, const char *debug_filename) {
     debugFile_REALFILE  = false;
     width_filename      = 20;
     width_function      = 20;
+    async               = false;
+    rate_limit          = 0;
+    flusher             = NULL;
 
     /*
      * Open log file
@@ -73,6 +79,23 @@ Logger::Logger(const char *log_filename, const char *debug_filename) {
  ***********************************************************************/
 Logger::~Logger() {
 
+    // Stop the flusher and write what is still buffered
+    if (flusher != NULL) {
+        async = false;
+        flusher->join();
+        delete flusher;
+
+        flushRings();
+
+        // Rings of threads still running are not freed, they can still log
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (size_t i = 0; i < rings.size(); i++) {
+            if (rings[i]->closed)
+                delete rings[i];
+        }
+        rings.clear();
+    }
+
     /*
      * Close open files
      */
@@ -117,6 +140,117 @@ void Logger::setWidthFilename(u_char width) {
         width_filename = width;
 }
 
+/*********************************************************************//**
+ * Write the log messages from a background thread
+ *
+ * \details Each thread formats its messages into its own ring of lines, which the
+ *          flusher thread writes every LOGGER_FLUSH_MS.  Logging doesn't lock or block;
+ *          messages are dropped when the ring is full or the thread is over the rate
+ *          limit, the number dropped is logged by the flusher.
+ *
+ *          Must be called after the process is daemonized.
+ *
+ * \param [in] rate_limit   Max messages per second per thread, 0 is unlimited
+ ***********************************************************************/
+void Logger::startAsync(int rate_limit) {
+    if (flusher != NULL)
+        return;
+
+    this->rate_limit = rate_limit;
+    async = true;
+
+    flusher = new std::thread(&Logger::flusherLoop, this);
+}
+
+/*********************************************************************//**
+ * Flusher thread loop
+ ***********************************************************************/
+void Logger::flusherLoop() {
+    while (async) {
+        if (not flushRings())
+            usleep(LOGGER_FLUSH_MS * 1000);
+    }
+}
+
+/*********************************************************************//**
+ * Write the buffered lines of all rings
+ *
+ * \return true if any line was written
+ ***********************************************************************/
+bool Logger::flushRings() {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    bool        written = false;
+    uint64_t    head, tail, dropped;
+
+    for (size_t i = 0; i < rings.size(); i++) {
+        LogRing *ring = rings[i];
+
+        // Check closed before reading head, lines written before the thread exited are then flushed
+        bool closed = ring->closed;
+
+        head = ring->head.load(std::memory_order_acquire);
+        tail = ring->tail.load(std::memory_order_relaxed);
+
+        for (; tail < head; tail++) {
+            LogLine &line = ring->lines[tail % LOGGER_RING_LINES];
+            fwrite(line.text, 1, line.len, line.output);
+            written = true;
+        }
+
+        ring->tail.store(tail, std::memory_order_release);
+
+        if ((dropped = ring->dropped.exchange(0)) > 0) {
+            char        time_str[32];
+            timeval     tv;
+            struct tm   t;
+
+            gettimeofday(&tv, NULL);
+            gmtime_r(&tv.tv_sec, &t);
+            strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", &t);
+
+            fprintf(logFile, "%s.%06u | %-8s | %-*s | %lu log messages of a thread were dropped (rate limit or buffer full)\n",
+                    time_str, (unsigned int)tv.tv_usec, "WARN", width_function, __FUNCTION__, dropped);
+            written = true;
+        }
+
+        if (closed) {
+            delete ring;
+            rings.erase(rings.begin() + i);
+            --i;
+        }
+    }
+
+    if (written) {
+        fflush(logFile);
+
+        if (debugFile != logFile)
+            fflush(debugFile);
+    }
+
+    return written;
+}
+
+/*********************************************************************//**
+ * Get the ring of the current thread, allocated on first use
+ ***********************************************************************/
+Logger::LogRing *Logger::getRing() {
+    if (thread_ring.ring == NULL) {
+        LogRing *ring = new LogRing;
+        ring->head = 0;
+        ring->tail = 0;
+        ring->dropped = 0;
+        ring->closed = false;
+        ring->rate_sec = 0;
+        ring->rate_count = 0;
+
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(ring);
+        thread_ring.ring = ring;
+    }
+
+    return thread_ring.ring;
+}
+
 /*********************************************************************//**
  * Prints debug message if debug is enabled
  *
@@ -153,7 +287,9 @@ void Logger::Print(const char *sev, const char *func_name, const char *msg, ...)
 
     // Print without the filename and line number included
     printV(sev, logFile, NULL, 0, func_name, msg, args);
-    fflush(logFile);
+
+    if (not async)
+        fflush(logFile);
 
     // Free/end the args
     va_end(args);
@@ -217,7 +353,50 @@ void Logger::printV(const char *sev,
                 func_name, msg);
     }
 
-    // Print the message
-    vfprintf(output, bufmsg, args);
+    if (not async) {
+        // Print the message
+        vfprintf(output, bufmsg, args);
+        return;
+    }
+
+    /*
+     * Format into the ring of the thread, the flusher writes it
+     */
+    LogRing     *ring = getRing();
+    uint64_t    head = ring->head.load(std::memory_order_relaxed);
+    int         len;
+
+    if (rate_limit > 0) {
+        if (ring->rate_sec != tv.tv_sec) {
+            ring->rate_sec = tv.tv_sec;
+            ring->rate_count = 0;
+        }
+
+        if (++ring->rate_count > rate_limit) {
+            ring->dropped++;
+            return;
+        }
+    }
+
+    if (head - ring->tail.load(std::memory_order_acquire) >= LOGGER_RING_LINES) {
+        ring->dropped++;
+        return;
+    }
+
+    LogLine &line = ring->lines[head % LOGGER_RING_LINES];
+    line.output = output;
+
+    len = vsnprintf(line.text, sizeof(line.text), bufmsg, args);
+    if (len < 0)
+        return;
+
+    // Truncated, keep the newline
+    if (len >= (int)sizeof(line.text)) {
+        len = sizeof(line.text) - 1;
+        memcpy(line.text + len - 4, "...\n", 4);
+    }
+
+    line.len = len;
+    ring->head.store(head + 1, std::memory_order_release);
 }
 
@@ -12,13 +12,30 @@
 #include <cstdio>
 #include <iostream>
 #include <cstdint>
+#include <cstdarg>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#include "CacheAligned.h"
+
+#define LOGGER_RING_LINES       128         ///< Lines buffered per thread when async
+#define LOGGER_LINE_SIZE        1024        ///< Max length of a line when async, longer lines are truncated
+#define LOGGER_FLUSH_MS         50          ///< Interval the flusher writes the buffered lines
 
 /*
  * DEBUG is a macro for DebugPrint with FILE, LINE, FUNCTION added
+ *
+ *      Building with DISABLE_DEBUG_LOG compiles out the debug statements, including their arguments
  */
+#ifdef DISABLE_DEBUG_LOG
+#define DEBUG(...) ((void)0)
+#define SELF_DEBUG(...) ((void)0)
+#else
 #define DEBUG(...) logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__)
-#define SELF_DEBUG(...) if (debug) logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__)
+#define SELF_DEBUG(...) if (__builtin_expect(debug, 0)) logger->DebugPrint(__FILE__, __LINE__, __FUNCTION__, __VA_ARGS__)
+#endif
 
 /*
  * Below defines LOG macros for various severities
@@ -105,6 +122,20 @@ public:
      ***********************************************************************/
     void setWidthFilename(u_char width);
 
+    /*********************************************************************//**
+     * Write the log messages from a background thread
+     *
+     * \details Each thread formats its messages into its own ring of lines, which the
+     *          flusher thread writes every LOGGER_FLUSH_MS.  Logging doesn't lock or block;
+     *          messages are dropped when the ring is full or the thread is over the rate
+     *          limit, the number dropped is logged by the flusher.
+     *
+     *          Must be called after the process is daemonized.
+     *
+     * \param [in] rate_limit   Max messages per second per thread, 0 is unlimited
+     ***********************************************************************/
+    void startAsync(int rate_limit);
+
 
     /*********************************************************************//**
      * Prints the message
@@ -131,6 +162,42 @@ public:
 
 
 private:
+    /**
+     * Formatted line buffered for the flusher
+     */
+    struct LogLine {
+        FILE            *output;            ///< File to write the line to
+        uint16_t        len;                ///< Length of text
+        char            text[LOGGER_LINE_SIZE]; ///< Formatted line
+    };
+
+    /**
+     * Lines of a thread, single producer (the thread) and single consumer (the flusher)
+     */
+    struct LogRing : public CacheAligned {
+        LogLine         lines[LOGGER_RING_LINES];   ///< Ring of lines
+        alignas(64) std::atomic<uint64_t> head;     ///< Lines written (producer owned)
+        alignas(64) std::atomic<uint64_t> tail;     ///< Lines written to the file (flusher owned)
+        std::atomic<uint64_t> dropped;      ///< Lines dropped by the producer
+        std::atomic<bool>     closed;       ///< Indicates the thread exited, the flusher frees the ring
+        time_t          rate_sec;           ///< Second of rate_count
+        int             rate_count;         ///< Lines written in rate_sec
+    };
+
+    /**
+     * Ring of the current thread, marks the ring closed when the thread exits
+     */
+    struct RingRef {
+        LogRing         *ring;              ///< Ring of the thread, NULL until the first message
+
+        ~RingRef() {
+            if (ring != NULL)
+                ring->closed = true;
+        }
+    };
+
+    static thread_local RingRef thread_ring;    ///< Ring of the current thread
+
     bool    logFile_REALFILE;           ///< Indicates if the log file is using a real file or not
     bool    debugFile_REALFILE;         ///< Indicates if the debug log file is using a real file or not
     FILE    *debugFile;                 ///< Debug log file
@@ -141,6 +208,29 @@ private:
     u_char  width_function;             ///< Defines the width of the function field when printed
     u_char  width_filename;             ///< Defines the width of the filename field when printed
 
+    std::atomic<bool>       async;      ///< Indicates messages are written by the flusher
+    int                     rate_limit; ///< Max messages per second per thread when async, 0 is unlimited
+    std::thread             *flusher;   ///< Flusher thread, NULL if not async
+    std::mutex              rings_mutex;///< Guards rings
+    std::vector<LogRing *>  rings;      ///< Rings of all threads that logged
+
+    /**
+     * Flusher thread loop
+     */
+    void flusherLoop();
+
+    /**
+     * Write the buffered lines of all rings
+     *
+     * \return true if any line was written
+     */
+    bool flushRings();
+
+    /**
+     * Get the ring of the current thread, allocated on first use
+     */
+    LogRing *getRing();
+
 
     /**
      * Prints the message using a variable arg list
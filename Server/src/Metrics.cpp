@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+
+#include "Metrics.h"
+#include "KafkaProducer.h"
+#include "AdjRibIn.h"
+#include "RibResync.h"
+#include "CpuPlacement.h"
+
+std::atomic<bool>               Metrics::enabled(false);
+thread_local Metrics::ShardRef  Metrics::thread_shard = { NULL };
+std::mutex                      Metrics::mutex;
+std::vector<Metrics::Shard *>   Metrics::shards;
+Metrics::Shard                  Metrics::retired;
+std::vector<Metrics::Router *>  Metrics::routers;
+Logger                          *Metrics::logger = NULL;
+int                             Metrics::sock = -1;
+int                             Metrics::control_sock = -1;
+std::string                     Metrics::control_path;
+std::thread                     *Metrics::server = NULL;
+std::atomic<bool>               Metrics::running(false);
+
+/**
+ * Upper bounds of the latency histogram buckets in microseconds
+ */
+static const uint64_t hist_bounds[METRICS_HIST_BUCKETS] = {
+        1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000,
+        10000, 20000, 50000, 100000, 200000, 500000, 1000000 };
+
+static const char *family_names[Metrics::FAMILY_MAX] = {
+        "ipv4_unicast", "ipv6_unicast", "ipv4_labeled", "ipv6_labeled",
+        "ipv4_vpn", "ipv6_vpn", "evpn", "bgp_ls" };
+
+static const char *stage_names[Metrics::STAGE_MAX] = {
+        "read", "parse", "encode", "produce", "delivery" };
+
+/**
+ * Append a formatted line to the output
+ */
+static void appendf(std::string &out, const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+static void appendf(std::string &out, const char *fmt, ...) {
+    char buf[512];
+    va_list args;
+
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    if (len > 0)
+        out.append(buf, std::min(len, (int)sizeof(buf) - 1));
+}
+
+/**
+ * Start the HTTP server, enables the metrics if metrics.port is set
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfg          Pointer to the config instance
+ *
+ * \throw (char const *str) message indicate error
+ */
+void Metrics::start(Logger *logPtr, Config *cfg) {
+    sockaddr_storage addr;
+    socklen_t addr_len;
+    int on = 1;
+
+    logger = logPtr;
+    control_path = cfg->metrics_control_socket;
+
+    if (cfg->metrics_port <= 0) {
+        startControl();
+
+        running = true;
+        server = new std::thread(serverLoop);
+        return;
+    }
+
+    bzero(&addr, sizeof(addr));
+
+    sockaddr_in *addr4 = (sockaddr_in *)&addr;
+    sockaddr_in6 *addr6 = (sockaddr_in6 *)&addr;
+
+    if (inet_pton(AF_INET, cfg->metrics_listen_ip.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(cfg->metrics_port);
+        addr_len = sizeof(sockaddr_in);
+
+    } else if (inet_pton(AF_INET6, cfg->metrics_listen_ip.c_str(), &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(cfg->metrics_port);
+        addr_len = sizeof(sockaddr_in6);
+
+    } else
+        throw "ERROR: Invalid metrics listen IP address";
+
+    if ((sock = socket(addr.ss_family, SOCK_STREAM, 0)) < 0)
+        throw "ERROR: Cannot open metrics socket.";
+
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0) {
+        close(sock);
+        sock = -1;
+        throw "ERROR: Failed to set metrics socket option SO_REUSEADDR";
+    }
+
+    if (::bind(sock, (sockaddr *)&addr, addr_len) < 0) {
+        close(sock);
+        sock = -1;
+        throw "ERROR: Cannot bind to metrics address and port";
+    }
+
+    listen(sock, 10);
+
+    try {
+        startControl();
+
+    } catch (char const *str) {
+        close(sock);
+        sock = -1;
+        throw;
+    }
+
+    enabled = true;
+    running = true;
+    server = new std::thread(serverLoop);
+
+    LOG_INFO("Metrics available at http://%s:%d/metrics", cfg->metrics_listen_ip.c_str(), cfg->metrics_port);
+}
+
+/**
+ * Stop the HTTP server
+ */
+void Metrics::stop() {
+    if (server == NULL)
+        return;
+
+    running = false;
+    server->join();
+    delete server;
+    server = NULL;
+
+    if (sock >= 0)
+        close(sock);
+    sock = -1;
+
+    if (control_sock >= 0) {
+        close(control_sock);
+        unlink(control_path.c_str());
+    }
+    control_sock = -1;
+}
+
+/**
+ * Open the unix socket of the control API, only the owner may connect
+ *
+ * \throw (char const *str) message indicate error
+ */
+void Metrics::startControl() {
+    sockaddr_un addr;
+
+    if (control_path.empty())
+        return;
+
+    bzero(&addr, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, control_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if ((control_sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        throw "ERROR: Cannot open control socket.";
+
+    // Stale socket of a previous run
+    unlink(control_path.c_str());
+
+    // Created without group/other permissions, the socket is then owner only
+    mode_t mask = umask(0077);
+    int rc = ::bind(control_sock, (sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+
+    if (rc < 0) {
+        close(control_sock);
+        control_sock = -1;
+        throw "ERROR: Cannot bind to the control socket path";
+    }
+
+    listen(control_sock, 10);
+
+    LOG_INFO("RIB control API available on unix socket %s", control_path.c_str());
+}
+
+/**
+ * Monotonic time in microseconds, used for the stage latencies
+ */
+uint64_t Metrics::now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Count a BGP update
+ */
+void Metrics::countUpdate() {
+    add(getShard()->updates, 1);
+}
+
+/**
+ * Count NLRIs of an update
+ *
+ * \param [in] family       Address family
+ * \param [in] withdrawn    True if withdrawn, false if advertised
+ * \param [in] count        Number of NLRIs
+ */
+void Metrics::countNlri(Family family, bool withdrawn, uint64_t count) {
+    if (count > 0)
+        add(getShard()->nlri[family][withdrawn ? 1 : 0], count);
+}
+
+/**
+ * Add a latency to the histogram of a stage
+ *
+ * \param [in] stage        Stage
+ * \param [in] usecs        Latency in microseconds
+ */
+void Metrics::observe(Stage stage, uint64_t usecs) {
+    Histogram &hist = getShard()->hist[stage];
+    int i = std::lower_bound(hist_bounds, hist_bounds + METRICS_HIST_BUCKETS, usecs) - hist_bounds;
+
+    add(hist.buckets[i], 1);
+    add(hist.sum, usecs);
+}
+
+/**
+ * Add the counters of a router
+ *
+ * \param [in] router       Router IP address in printed form
+ *
+ * \return counters to free with removeRouter()
+ */
+Metrics::Router *Metrics::addRouter(const char *router) {
+    Router *r = new Router();
+
+    r->router = router;
+    r->messages = 0;
+    r->bytes = 0;
+    r->ring_fill = 0;
+    r->ring_size = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    routers.push_back(r);
+
+    return r;
+}
+
+/**
+ * Remove and free the counters of a router
+ *
+ * \param [in] router       Counters returned by addRouter()
+ */
+void Metrics::removeRouter(Router *router) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        routers.erase(std::remove(routers.begin(), routers.end(), router), routers.end());
+    }
+
+    delete router;
+}
+
+/**
+ * Render all metrics in the Prometheus text format
+ *
+ * \param [out] out         Rendered metrics
+ */
+void Metrics::render(std::string &out) {
+    Shard *total = new Shard();
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    sum(*total, retired);
+    for (size_t i = 0; i < shards.size(); i++)
+        sum(*total, *shards[i]);
+
+    out.append("# HELP openbmp_router_messages_total BMP messages parsed\n"
+               "# TYPE openbmp_router_messages_total counter\n");
+    for (size_t i = 0; i < routers.size(); i++)
+        appendf(out, "openbmp_router_messages_total{router=\"%s\"} %lu\n",
+                routers[i]->router.c_str(), (unsigned long)routers[i]->messages.load());
+
+    out.append("# HELP openbmp_router_bytes_total BMP bytes parsed\n"
+               "# TYPE openbmp_router_bytes_total counter\n");
+    for (size_t i = 0; i < routers.size(); i++)
+        appendf(out, "openbmp_router_bytes_total{router=\"%s\"} %lu\n",
+                routers[i]->router.c_str(), (unsigned long)routers[i]->bytes.load());
+
+    out.append("# HELP openbmp_router_buffer_bytes Bytes buffered in the router ring buffer\n"
+               "# TYPE openbmp_router_buffer_bytes gauge\n");
+    for (size_t i = 0; i < routers.size(); i++) {
+        if (routers[i]->ring_size > 0)
+            appendf(out, "openbmp_router_buffer_bytes{router=\"%s\"} %lu\n",
+                    routers[i]->router.c_str(), (unsigned long)routers[i]->ring_fill.load());
+    }
+
+    out.append("# HELP openbmp_router_buffer_size_bytes Size of the router ring buffer\n"
+               "# TYPE openbmp_router_buffer_size_bytes gauge\n");
+    for (size_t i = 0; i < routers.size(); i++) {
+        if (routers[i]->ring_size > 0)
+            appendf(out, "openbmp_router_buffer_size_bytes{router=\"%s\"} %lu\n",
+                    routers[i]->router.c_str(), (unsigned long)routers[i]->ring_size.load());
+    }
+
+    lock.unlock();
+
+    out.append("# HELP openbmp_bgp_updates_total BGP UPDATE messages parsed\n"
+               "# TYPE openbmp_bgp_updates_total counter\n");
+    appendf(out, "openbmp_bgp_updates_total %lu\n", (unsigned long)total->updates.load());
+
+    out.append("# HELP openbmp_bgp_nlri_total NLRIs parsed by address family\n"
+               "# TYPE openbmp_bgp_nlri_total counter\n");
+    for (int f = 0; f < FAMILY_MAX; f++) {
+        appendf(out, "openbmp_bgp_nlri_total{family=\"%s\",action=\"advertised\"} %lu\n",
+                family_names[f], (unsigned long)total->nlri[f][0].load());
+        appendf(out, "openbmp_bgp_nlri_total{family=\"%s\",action=\"withdrawn\"} %lu\n",
+                family_names[f], (unsigned long)total->nlri[f][1].load());
+    }
+
+    out.append("# HELP openbmp_stage_latency_seconds Latency of the processing stages\n"
+               "# TYPE openbmp_stage_latency_seconds histogram\n");
+    for (int s = 0; s < STAGE_MAX; s++) {
+        Histogram &hist = total->hist[s];
+        uint64_t count = 0;
+
+        for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+            count += hist.buckets[i];
+            appendf(out, "openbmp_stage_latency_seconds_bucket{stage=\"%s\",le=\"%g\"} %lu\n",
+                    stage_names[s], hist_bounds[i] / 1000000.0, (unsigned long)count);
+        }
+
+        count += hist.buckets[METRICS_HIST_BUCKETS];
+        appendf(out, "openbmp_stage_latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n",
+                stage_names[s], (unsigned long)count);
+        appendf(out, "openbmp_stage_latency_seconds_sum{stage=\"%s\"} %g\n",
+                stage_names[s], hist.sum / 1000000.0);
+        appendf(out, "openbmp_stage_latency_seconds_count{stage=\"%s\"} %lu\n",
+                stage_names[s], (unsigned long)count);
+    }
+
+    out.append("# HELP openbmp_kafka_queue_messages Messages waiting in the kafka producer queues\n"
+               "# TYPE openbmp_kafka_queue_messages gauge\n");
+    appendf(out, "openbmp_kafka_queue_messages %d\n", KafkaProducer::totalOutqLen());
+
+    out.append("# HELP openbmp_kafka_queue_max_messages Largest kafka producer queue\n"
+               "# TYPE openbmp_kafka_queue_max_messages gauge\n");
+    appendf(out, "openbmp_kafka_queue_max_messages %d\n", KafkaProducer::maxOutqLen());
+
+    out.append("# HELP openbmp_kafka_spool_bytes Size of the kafka spool segments\n"
+               "# TYPE openbmp_kafka_spool_bytes gauge\n");
+    appendf(out, "openbmp_kafka_spool_bytes %lu\n", (unsigned long)KafkaSpool::totalBytes());
+
+    out.append("# HELP openbmp_kafka_spool_dropped_total Messages dropped because the kafka spool was full\n"
+               "# TYPE openbmp_kafka_spool_dropped_total counter\n");
+    appendf(out, "openbmp_kafka_spool_dropped_total %lu\n", (unsigned long)KafkaSpool::totalDropped());
+
+    CpuPlacement::render(out);
+
+    delete total;
+}
+
+/**
+ * Retire the shard of an exiting thread
+ */
+Metrics::ShardRef::~ShardRef() {
+    if (shard == NULL)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    sum(retired, *shard);
+    shards.erase(std::remove(shards.begin(), shards.end(), shard), shards.end());
+
+    delete shard;
+    shard = NULL;
+}
+
+/**
+ * Get the shard of the current thread, allocated on first use
+ */
+Metrics::Shard *Metrics::getShard() {
+    if (thread_shard.shard == NULL) {
+        Shard *shard = new Shard();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        shards.push_back(shard);
+        thread_shard.shard = shard;
+    }
+
+    return thread_shard.shard;
+}
+
+/**
+ * Add the counters of a shard to another
+ *
+ * \details Called with the mutex locked; dst isn't a running thread's shard.
+ */
+void Metrics::sum(Shard &dst, Shard &src) {
+    dst.updates += src.updates;
+
+    for (int f = 0; f < FAMILY_MAX; f++) {
+        dst.nlri[f][0] += src.nlri[f][0];
+        dst.nlri[f][1] += src.nlri[f][1];
+    }
+
+    for (int s = 0; s < STAGE_MAX; s++) {
+        for (int i = 0; i <= METRICS_HIST_BUCKETS; i++)
+            dst.hist[s].buckets[i] += src.hist[s].buckets[i];
+
+        dst.hist[s].sum += src.hist[s].sum;
+    }
+}
+
+/**
+ * Totals of the latency histogram of a stage, summed over all threads
+ *
+ * \param [in]  stage       Stage
+ * \param [out] count       Number of latencies observed
+ * \param [out] usecs       Sum of the latencies in microseconds
+ */
+void Metrics::stageTotals(Stage stage, uint64_t &count, uint64_t &usecs) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    count = 0;
+    usecs = retired.hist[stage].sum;
+    for (int i = 0; i <= METRICS_HIST_BUCKETS; i++)
+        count += retired.hist[stage].buckets[i];
+
+    for (size_t n = 0; n < shards.size(); n++) {
+        usecs += shards[n]->hist[stage].sum;
+        for (int i = 0; i <= METRICS_HIST_BUCKETS; i++)
+            count += shards[n]->hist[stage].buckets[i];
+    }
+}
+
+/**
+ * Name of a stage as used in the stage label
+ */
+const char *Metrics::stageName(Stage stage) {
+    return stage_names[stage];
+}
+
+/**
+ * HTTP server loop
+ */
+void Metrics::serverLoop() {
+    pollfd pfd[2];
+    int fd;
+
+    // A socket of -1 is ignored by poll
+    pfd[0].fd = sock;
+    pfd[1].fd = control_sock;
+
+    while (running) {
+        for (int i = 0; i < 2; i++) {
+            pfd[i].events = POLLIN;
+            pfd[i].revents = 0;
+        }
+
+        if (poll(pfd, 2, 500) <= 0)
+            continue;
+
+        for (int i = 0; i < 2; i++) {
+            if (not (pfd[i].revents & POLLIN))
+                continue;
+
+            if ((fd = accept(pfd[i].fd, NULL, NULL)) < 0)
+                continue;
+
+            handleRequest(fd, i == 1);
+            close(fd);
+        }
+    }
+}
+
+/**
+ * Handle an HTTP connection
+ *
+ * \param [in] fd           Connection socket
+ * \param [in] control      Indicates the connection is on the control socket, the RIB routes are served
+ */
+void Metrics::handleRequest(int fd, bool control) {
+    char request[METRICS_REQUEST_SIZE];
+    size_t len = 0;
+    ssize_t n;
+    pollfd pfd;
+    std::string body, response;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    // Read the request line and headers, slow clients are dropped
+    while (len < sizeof(request) - 1) {
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 1000) <= 0)
+            return;
+
+        if ((n = read(fd, request + len, sizeof(request) - 1 - len)) <= 0)
+            return;
+
+        len += n;
+        request[len] = 0;
+
+        if (strstr(request, "\r\n\r\n") != NULL or strstr(request, "\n\n") != NULL)
+            break;
+    }
+    request[len] = 0;
+
+    if (not control and (strncmp(request, "GET /metrics ", 13) == 0 or strncmp(request, "GET /metrics?", 13) == 0)) {
+        render(body);
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n";
+
+    } else if (not control) {
+        body = "Not found\n";
+        response = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+
+    } else if (strncmp(request, "GET /rib ", 9) == 0 or strncmp(request, "GET /rib?peer=", 14) == 0) {
+        // Adj-RIB-In snapshot of a peer, or the list of peers with a RIB
+        char peer_hash[33] = { 0 };
+        if (request[8] == '?')
+            sscanf(request + 14, "%32[0-9a-fA-F]", peer_hash);
+
+        if (bgp_msg::AdjRibIn::renderSnapshot(peer_hash, body))
+            response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n";
+        else {
+            body = "Not found\n";
+            response = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+        }
+
+    } else if (strncmp(request, "POST /rib/resync?peer=", 22) == 0 or
+               strncmp(request, "POST /rib/resync?router=", 24) == 0) {
+        // Publish the Adj-RIB-In of a peer, or of the peers of a router, again
+        char peer_hash[33] = { 0 };
+        char router_hash[33] = { 0 };
+
+        if (request[17] == 'p')
+            sscanf(request + 22, "%32[0-9a-fA-F]", peer_hash);
+        else
+            sscanf(request + 24, "%32[0-9a-fA-F]", router_hash);
+
+        int queued = bgp_msg::RibResync::request(peer_hash, router_hash);
+        if (queued > 0) {
+            appendf(body, "Resync queued for %d peers\n", queued);
+            response = "HTTP/1.0 202 Accepted\r\nContent-Type: text/plain\r\n";
+
+        } else if (queued < 0) {
+            body = "Resync not enabled\n";
+            response = "HTTP/1.0 503 Service Unavailable\r\nContent-Type: text/plain\r\n";
+
+        } else {
+            body = "Not found\n";
+            response = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+        }
+
+    } else {
+        body = "Not found\n";
+        response = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+    }
+
+    appendf(response, "Content-Length: %lu\r\nConnection: close\r\n\r\n", (unsigned long)body.size());
+    response.append(body);
+
+    for (size_t sent = 0; sent < response.size(); sent += n) {
+        if ((n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL)) <= 0)
+            return;
+    }
+}
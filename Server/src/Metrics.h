@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+#include "Config.h"
+#include "CacheAligned.h"
+
+#define METRICS_HIST_BUCKETS    19          ///< Number of latency histogram bucket bounds, +Inf is added
+#define METRICS_REQUEST_SIZE    4096        ///< Max size of an HTTP request read
+
+/**
+ * \class   Metrics
+ *
+ * \brief   Collector metrics exported over HTTP in the Prometheus text format
+ * \details Counters of a thread are kept in a cache line aligned shard of the thread, written
+ *          without locks or atomic read-modify-write since the thread is the only writer.
+ *          Shards are summed when scraped; the shard of an exited thread is added to the
+ *          retired totals.  Router counters are written by the reader of the router.
+ *
+ *          When metrics are disabled (metrics.port is 0) the hot path cost is a check of
+ *          Metrics::enabled.
+ */
+class Metrics {
+public:
+    /**
+     * Address families of the NLRI counters
+     */
+    enum Family {
+        FAMILY_IPV4_UNICAST=0,
+        FAMILY_IPV6_UNICAST,
+        FAMILY_IPV4_LABELED,
+        FAMILY_IPV6_LABELED,
+        FAMILY_IPV4_VPN,
+        FAMILY_IPV6_VPN,
+        FAMILY_EVPN,
+        FAMILY_BGP_LS,
+        FAMILY_MAX
+    };
+
+    /**
+     * Stages of the latency histograms
+     */
+    enum Stage {
+        STAGE_READ=0,                       ///< Buffering a route monitoring message from the router stream
+        STAGE_PARSE,                        ///< Decoding a BGP update
+        STAGE_ENCODE,                       ///< Encoding the update to the message bus, including produce if not batched
+        STAGE_PRODUCE,                      ///< Handing a message to librdkafka
+        STAGE_DELIVERY,                     ///< librdkafka delivery latency of a message
+        STAGE_MAX
+    };
+
+    /**
+     * Counters of a router, written by the reader of the router
+     */
+    struct alignas(64) Router : public CacheAligned {
+        std::string             router;         ///< Router IP address in printed form
+        std::atomic<uint64_t>   messages;       ///< BMP messages parsed
+        std::atomic<uint64_t>   bytes;          ///< BMP bytes parsed
+        std::atomic<uint64_t>   ring_fill;      ///< Bytes buffered in the router ring, 0 if no ring
+        std::atomic<uint64_t>   ring_size;      ///< Size of the router ring, 0 if no ring
+    };
+
+    static std::atomic<bool>    enabled;        ///< Indicates metrics are collected
+
+    /**
+     * Start the HTTP server, enables the metrics if metrics.port is set
+     *
+     * \details The RIB control API (GET /rib, POST /rib/resync) is only served on the unix
+     *          socket metrics.control_socket, the metrics port only serves GET /metrics.
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     *
+     * \throw (char const *str) message indicate error
+     */
+    static void start(Logger *logPtr, Config *cfg);
+
+    /**
+     * Stop the HTTP server
+     */
+    static void stop();
+
+    /**
+     * Monotonic time in microseconds, used for the stage latencies
+     */
+    static uint64_t now();
+
+    /**
+     * Count a BGP update
+     */
+    static void countUpdate();
+
+    /**
+     * Count NLRIs of an update
+     *
+     * \param [in] family       Address family
+     * \param [in] withdrawn    True if withdrawn, false if advertised
+     * \param [in] count        Number of NLRIs
+     */
+    static void countNlri(Family family, bool withdrawn, uint64_t count);
+
+    /**
+     * Add a latency to the histogram of a stage
+     *
+     * \param [in] stage        Stage
+     * \param [in] usecs        Latency in microseconds
+     */
+    static void observe(Stage stage, uint64_t usecs);
+
+    /**
+     * Add the counters of a router
+     *
+     * \param [in] router       Router IP address in printed form
+     *
+     * \return counters to free with removeRouter()
+     */
+    static Router *addRouter(const char *router);
+
+    /**
+     * Remove and free the counters of a router
+     *
+     * \param [in] router       Counters returned by addRouter()
+     */
+    static void removeRouter(Router *router);
+
+    /**
+     * Render all metrics in the Prometheus text format
+     *
+     * \param [out] out         Rendered metrics
+     */
+    static void render(std::string &out);
+
+    /**
+     * Totals of the latency histogram of a stage, summed over all threads
+     *
+     * \param [in]  stage       Stage
+     * \param [out] count       Number of latencies observed
+     * \param [out] usecs       Sum of the latencies in microseconds
+     */
+    static void stageTotals(Stage stage, uint64_t &count, uint64_t &usecs);
+
+    /**
+     * Name of a stage as used in the stage label
+     */
+    static const char *stageName(Stage stage);
+
+private:
+    /**
+     * Latency histogram
+     */
+    struct Histogram {
+        std::atomic<uint64_t>   buckets[METRICS_HIST_BUCKETS + 1];  ///< Count per bucket, last is +Inf
+        std::atomic<uint64_t>   sum;            ///< Sum of the latencies in microseconds
+    };
+
+    /**
+     * Counters of a thread
+     */
+    struct alignas(64) Shard : public CacheAligned {
+        std::atomic<uint64_t>   updates;                    ///< BGP updates
+        std::atomic<uint64_t>   nlri[FAMILY_MAX][2];        ///< NLRIs by family, advertised/withdrawn
+        Histogram               hist[STAGE_MAX];            ///< Latencies by stage
+    };
+
+    /**
+     * Shard of the current thread, retires the shard when the thread exits
+     */
+    struct ShardRef {
+        Shard                   *shard;         ///< Shard of the thread, NULL until first used
+
+        ~ShardRef();
+    };
+
+    static thread_local ShardRef thread_shard;  ///< Shard of the current thread
+
+    static std::mutex           mutex;          ///< Guards shards, retired and routers
+    static std::vector<Shard *> shards;         ///< Shards of the running threads
+    static Shard                retired;        ///< Sum of the shards of exited threads
+    static std::vector<Router *> routers;       ///< Counters of the connected routers
+
+    static Logger               *logger;        ///< Logging class pointer
+    static int                  sock;           ///< HTTP listening socket, -1 if not started
+    static int                  control_sock;   ///< Control API unix listening socket, -1 if not started
+    static std::string          control_path;   ///< Path of the control API unix socket
+    static std::thread          *server;        ///< HTTP server thread
+    static std::atomic<bool>    running;        ///< Indicates the server should run
+
+    /**
+     * Get the shard of the current thread, allocated on first use
+     */
+    static Shard *getShard();
+
+    /**
+     * Add a value to a counter only written by this thread
+     */
+    static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /**
+     * Add the counters of a shard to another
+     */
+    static void sum(Shard &dst, Shard &src);
+
+    /**
+     * HTTP server loop
+     */
+    static void serverLoop();
+
+    /**
+     * Open the unix socket of the control API, only the owner may connect
+     *
+     * \throw (char const *str) message indicate error
+     */
+    static void startControl();
+
+    /**
+     * Handle an HTTP connection
+     *
+     * \param [in] fd           Connection socket
+     * \param [in] control      Indicates the connection is on the control socket, the RIB routes are served
+     */
+    static void handleRequest(int fd, bool control);
+};
+
+#endif /* METRICS_H_ */
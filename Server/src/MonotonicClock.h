@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MONOTONICCLOCK_H_
+#define MONOTONICCLOCK_H_
+
+#include <cstdint>
+#include <ctime>
+
+/**
+ * Monotonic time in milliseconds
+ *
+ * \details Shared clock of the RIB dump rates, the admission retry times and
+ *          the coalesced rows, unaffected by changes of the wall clock.
+ *
+ * \return Milliseconds since an unspecified start
+ */
+inline uint64_t monotonicMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#endif /* MONOTONICCLOCK_H_ */
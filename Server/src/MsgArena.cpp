@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "MsgArena.h"
+
+/**
+ * Constructor for class
+ *
+ * \param [in] block_size   Size of the arena blocks
+ */
+MsgArena::MsgArena(size_t block_size) {
+    this->block_size = block_size;
+    cur = 0;
+    offset = 0;
+    dtors = NULL;
+}
+
+MsgArena::~MsgArena() {
+    reset();
+
+    for (size_t i = 0; i < blocks.size(); i++)
+        delete [] blocks[i].data;
+
+    blocks.clear();
+}
+
+/**
+ * Destroy the objects and free all allocations, the blocks are kept
+ */
+void MsgArena::reset() {
+    while (dtors != NULL) {
+        Dtor *d = dtors;
+        dtors = d->next;
+        d->destroy(d->obj);
+    }
+
+    cur = 0;
+    offset = 0;
+}
+
+/**
+ * Number of bytes allocated from the heap for the blocks
+ */
+size_t MsgArena::capacity() {
+    size_t size = 0;
+
+    for (size_t i = 0; i < blocks.size(); i++)
+        size += blocks[i].size;
+
+    return size;
+}
+
+/**
+ * Allocate from the next block that fits, adding a block if none fits
+ *
+ * \param [in] size     Number of bytes
+ * \param [in] align    Alignment, power of 2
+ *
+ * \return Pointer to the memory
+ */
+void *MsgArena::allocSlow(size_t size, size_t align) {
+    // Blocks are aligned by new[] to at least MSG_ARENA_ALIGN
+    size_t need = size + (align > MSG_ARENA_ALIGN ? align : 0);
+
+    if (cur < blocks.size())
+        ++cur;
+
+    while (cur < blocks.size() and blocks[cur].size < need)
+        ++cur;
+
+    if (cur >= blocks.size()) {
+        Block block;
+        block.size = need > block_size ? need : block_size;
+        block.data = new u_char[block.size];
+        blocks.push_back(block);
+        cur = blocks.size() - 1;
+    }
+
+    // Blocks skipped above stay unused until the next reset
+    uintptr_t base = (uintptr_t)blocks[cur].data;
+    uintptr_t addr = (base + align - 1) & ~(uintptr_t)(align - 1);
+    offset = addr + size - base;
+
+    return (void *)addr;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MSGARENA_H_
+#define MSGARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+#define MSG_ARENA_BLOCK_SIZE    (512 * 1024)    ///< Size of an arena block, holds the parsers of a message
+#define MSG_ARENA_ALIGN         16              ///< Default alignment of the allocations
+
+/**
+ * \class   MsgArena
+ *
+ * \brief   Bump allocator for the objects of a message, freed all at once by reset()
+ * \details Allocations are carved from blocks that are kept across resets, so once the
+ *          arena has grown to the largest message (or batch) nothing is allocated from
+ *          the heap.  Allocations larger than a block get a block of their own.
+ *
+ *          Objects made with create() are destroyed by reset(), newest first.  Memory
+ *          from alloc() is not initialized and nothing is run on reset.
+ *
+ *          The arena is not thread safe, it belongs to a router reader.
+ */
+class MsgArena {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] block_size   Size of the arena blocks
+     */
+    MsgArena(size_t block_size=MSG_ARENA_BLOCK_SIZE);
+    ~MsgArena();
+
+    /**
+     * Allocate memory from the arena
+     *
+     * \param [in] size     Number of bytes
+     * \param [in] align    Alignment, power of 2
+     *
+     * \return Pointer to the memory, valid until reset()
+     */
+    void *alloc(size_t size, size_t align=MSG_ARENA_ALIGN) {
+        if (cur < blocks.size()) {
+            uintptr_t base = (uintptr_t)blocks[cur].data;
+            uintptr_t addr = (base + offset + align - 1) & ~(uintptr_t)(align - 1);
+
+            if (addr + size <= base + blocks[cur].size) {
+                offset = addr + size - base;
+                return (void *)addr;
+            }
+        }
+
+        return allocSlow(size, align);
+    }
+
+    /**
+     * Construct an object in the arena
+     *
+     * \param [in] args     Constructor arguments
+     *
+     * \return Pointer to the object, destroyed by reset()
+     */
+    template <typename T, typename... Args>
+    T *create(Args&&... args) {
+        void *mem = alloc(sizeof(T), alignof(T) > MSG_ARENA_ALIGN ? alignof(T) : MSG_ARENA_ALIGN);
+        T *obj = new (mem) T(std::forward<Args>(args)...);
+
+        if (not std::is_trivially_destructible<T>::value) {
+            Dtor *d = (Dtor *)alloc(sizeof(Dtor));
+            d->destroy = &destroyObj<T>;
+            d->obj = obj;
+            d->next = dtors;
+            dtors = d;
+        }
+
+        return obj;
+    }
+
+    /**
+     * Destroy the objects and free all allocations, the blocks are kept
+     */
+    void reset();
+
+    /**
+     * Number of bytes allocated from the heap for the blocks
+     */
+    size_t capacity();
+
+private:
+    /**
+     * Memory block of the arena
+     */
+    struct Block {
+        u_char      *data;                  ///< Start of the block
+        size_t      size;                   ///< Size of the block
+    };
+
+    /**
+     * Destructor to run on reset, allocated in the arena
+     */
+    struct Dtor {
+        void        (*destroy)(void *obj);  ///< Destroys obj
+        void        *obj;                   ///< Object made by create()
+        Dtor        *next;                  ///< Previously created object
+    };
+
+    size_t              block_size;         ///< Size of new blocks
+    std::vector<Block>  blocks;             ///< Blocks, in order of use
+    size_t              cur;                ///< Index of the block allocations come from
+    size_t              offset;             ///< Offset of the next allocation in the current block
+    Dtor                *dtors;             ///< Objects to destroy on reset, newest first
+
+    /**
+     * Allocate from the next block that fits, adding a block if none fits
+     */
+    void *allocSlow(size_t size, size_t align);
+
+    template <typename T>
+    static void destroyObj(void *obj) {
+        ((T *)obj)->~T();
+    }
+};
+
+#endif /* MSGARENA_H_ */
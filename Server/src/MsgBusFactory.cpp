@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <cstring>
+
+#include "MsgBusFactory.h"
+#include "MsgBusImpl_kafka.h"
+#include "MsgBusImpl_null.h"
+#include "MsgBusImpl_shm.h"
+#include "MsgBusImpl_fanout.h"
+#include "KafkaSpool.h"
+
+using namespace std;
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr   Pointer to Logger instance
+ * \param [in] cfg      Pointer to the config instance
+ *
+ * \throw (const char *) if msgbus.backend is not registered or its config is invalid
+ */
+MsgBusFactory::MsgBusFactory(Logger *logPtr, Config *cfg) {
+    logger = logPtr;
+    this->cfg = cfg;
+    producer_pool = NULL;
+    priority_producer = NULL;
+
+    map<string, Creator>::iterator it = backends().find(cfg->msgbus_backend);
+    if (it == backends().end()) {
+        LOG_ERR("Message bus backend %s is not known", cfg->msgbus_backend.c_str());
+        throw "ERROR: Unknown msgbus.backend";
+    }
+
+    creator = it->second;
+
+    if (cfg->msgbus_backend == "kafka") {
+        // The spool is found by the producers, it's opened first
+        if (cfg->kafka_spool_dir.size() > 0)
+            KafkaSpool::open(logger, cfg);
+
+        // Shared kafka producers
+        if (cfg->kafka_producers != 0)
+            producer_pool = new KafkaProducerPool(logger, cfg, cfg->kafka_producers);
+
+        // State messages don't wait for the buffered prefix messages
+        if (cfg->kafka_priority_lane)
+            priority_producer = new KafkaProducer(logger, cfg, "", 0);
+
+    } else if (cfg->msgbus_backend == "fanout") {
+        if (cfg->msgbus_fanout_brokers.size() == 0)
+            throw "ERROR: msgbus.backend fanout requires msgbus.fanout.clusters";
+
+        // Clusters always use shared producers, a producer per router is one per CPU core per cluster
+        for (size_t i = 0; i < cfg->msgbus_fanout_brokers.size(); i++) {
+            if (cfg->kafka_spool_dir.size() > 0)
+                KafkaSpool::open(logger, cfg, cfg->msgbus_fanout_brokers[i]);
+
+            cluster_pools.push_back(new KafkaProducerPool(logger, cfg,
+                                                          cfg->kafka_producers != 0 ? cfg->kafka_producers : -1,
+                                                          cfg->msgbus_fanout_brokers[i]));
+
+            if (cfg->kafka_priority_lane)
+                cluster_priority.push_back(new KafkaProducer(logger, cfg, cfg->msgbus_fanout_brokers[i], 0));
+        }
+    }
+
+    LOG_INFO("Using message bus backend %s", cfg->msgbus_backend.c_str());
+}
+
+/**
+ * Destructor, frees the kafka producer pools and closes the spools
+ */
+MsgBusFactory::~MsgBusFactory() {
+    if (producer_pool != NULL)
+        delete producer_pool;
+
+    if (priority_producer != NULL)
+        delete priority_producer;
+
+    for (size_t i = 0; i < cluster_pools.size(); i++)
+        delete cluster_pools[i];
+
+    for (size_t i = 0; i < cluster_priority.size(); i++)
+        delete cluster_priority[i];
+
+    cluster_pools.clear();
+    cluster_priority.clear();
+
+    KafkaSpool::closeAll();
+}
+
+/**
+ * Create the message bus of a router or of the collector
+ *
+ * \param [in] router_hash  Router hash ID, NULL for the collector bus
+ *
+ * \return New message bus, freed by the caller
+ *
+ * \throw (const char *) if the bus can't be created
+ */
+MsgBusInterface *MsgBusFactory::create(const u_char *router_hash) {
+    MsgBusInterface *mbus = creator(this, router_hash);
+
+    if (cfg->debug_msgbus)
+        mbus->enableDebug();
+
+    return mbus;
+}
+
+/**
+ * Register a backend
+ *
+ * \param [in] name     Backend name, as in msgbus.backend
+ * \param [in] creator  Function that creates the bus
+ */
+void MsgBusFactory::registerBackend(const std::string &name, Creator creator) {
+    backends()[name] = creator;
+}
+
+/**
+ * Registered backends, initialized with the built-in backends
+ */
+std::map<std::string, MsgBusFactory::Creator> &MsgBusFactory::backends() {
+    static map<string, Creator> registry;
+
+    if (registry.size() == 0) {
+        registry["kafka"]   = createKafka;
+        registry["null"]    = createNull;
+        registry["shm"]     = createShm;
+        registry["fanout"]  = createFanout;
+    }
+
+    return registry;
+}
+
+MsgBusInterface *MsgBusFactory::createKafka(MsgBusFactory *factory, const u_char *router_hash) {
+    return new msgBus_kafka(factory->logger, factory->cfg, factory->cfg->c_hash_id, factory->producer_pool,
+                            factory->priority_producer);
+}
+
+MsgBusInterface *MsgBusFactory::createNull(MsgBusFactory *factory, const u_char *router_hash) {
+    return new msgBus_null();
+}
+
+MsgBusInterface *MsgBusFactory::createShm(MsgBusFactory *factory, const u_char *router_hash) {
+    return new msgBus_shm(factory->logger, factory->cfg, router_hash);
+}
+
+MsgBusInterface *MsgBusFactory::createFanout(MsgBusFactory *factory, const u_char *router_hash) {
+    vector<KafkaProducerPool *> &pools = factory->cluster_pools;
+    vector<KafkaProducer *> &priority = factory->cluster_priority;
+
+    // A router is sharded to one cluster, the hash is already uniformly distributed
+    if (router_hash != NULL) {
+        uint32_t shard;
+        memcpy(&shard, router_hash, sizeof(shard));
+
+        return new msgBus_kafka(factory->logger, factory->cfg, factory->cfg->c_hash_id,
+                                pools[shard % pools.size()],
+                                priority.size() > 0 ? priority[shard % priority.size()] : NULL);
+    }
+
+    vector<MsgBusInterface *> buses;
+    for (size_t i = 0; i < pools.size(); i++)
+        buses.push_back(new msgBus_kafka(factory->logger, factory->cfg, factory->cfg->c_hash_id, pools[i],
+                                         priority.size() > 0 ? priority[i] : NULL));
+
+    return new msgBus_fanout(buses);
+}
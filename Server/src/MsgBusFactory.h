@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OPENBMP_MSGBUSFACTORY_H
+#define OPENBMP_MSGBUSFACTORY_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "Config.h"
+#include "Logger.h"
+#include "KafkaProducerPool.h"
+
+/**
+ * \class   MsgBusFactory
+ *
+ * \brief   Creates the message bus of the collector and of each router
+ * \details The backend is selected by msgbus.backend.  Built-in backends are:
+ *
+ *              kafka   - msgBus_kafka, the default
+ *              null    - msgBus_null, discards everything
+ *              shm     - msgBus_shm, a shared memory ring per router
+ *              fanout  - msgBus_kafka per router sharded by router hash over the
+ *                        msgbus.fanout.clusters, the collector messages go to all clusters
+ *
+ *          With kafka priority.lane, the collector, router and peer messages of all routers
+ *          are produced by a shared producer (one per cluster) that doesn't linger.
+ *
+ *          With kafka spool.dir, a KafkaSpool is opened for each cluster.
+ *
+ *          Other backends can be added with registerBackend() before the factory is created.
+ *          The factory owns the kafka producer pools, it must outlive the message buses.
+ */
+class MsgBusFactory {
+public:
+    /**
+     * Create a message bus
+     *
+     * \param [in] factory      Factory the bus is created by
+     * \param [in] router_hash  Router hash ID, NULL for the collector bus
+     *
+     * \return New message bus, freed by the caller
+     */
+    typedef MsgBusInterface *(*Creator)(MsgBusFactory *factory, const u_char *router_hash);
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr   Pointer to Logger instance
+     * \param [in] cfg      Pointer to the config instance
+     *
+     * \throw (const char *) if msgbus.backend is not registered or its config is invalid
+     */
+    MsgBusFactory(Logger *logPtr, Config *cfg);
+
+    /**
+     * Destructor, frees the kafka producer pools and closes the spools
+     */
+    ~MsgBusFactory();
+
+    /**
+     * Create the message bus of a router or of the collector
+     *
+     * \details Debug is enabled on the bus if debug.msgbus is set.
+     *
+     * \param [in] router_hash  Router hash ID, NULL for the collector bus
+     *
+     * \return New message bus, freed by the caller
+     *
+     * \throw (const char *) if the bus can't be created
+     */
+    MsgBusInterface *create(const u_char *router_hash);
+
+    /**
+     * Register a backend
+     *
+     * \details Not thread safe, backends are registered at startup.  A backend of the
+     *          same name is replaced.
+     *
+     * \param [in] name     Backend name, as in msgbus.backend
+     * \param [in] creator  Function that creates the bus
+     */
+    static void registerBackend(const std::string &name, Creator creator);
+
+    Config *getConfig()     { return cfg; }
+    Logger *getLogger()     { return logger; }
+
+private:
+    Config                      *cfg;                   ///< Pointer to config instance
+    Logger                      *logger;                ///< Logging class pointer
+    Creator                     creator;                ///< Creator of the configured backend
+
+    KafkaProducerPool           *producer_pool;         ///< Shared kafka producers, NULL if each router has its own
+    std::vector<KafkaProducerPool *> cluster_pools;     ///< Producers of each fan-out cluster
+    KafkaProducer               *priority_producer;     ///< Producer of the state messages, NULL if not used
+    std::vector<KafkaProducer *> cluster_priority;      ///< Producer of the state messages of each fan-out cluster
+
+    /**
+     * Registered backends, initialized with the built-in backends
+     */
+    static std::map<std::string, Creator> &backends();
+
+    /*
+     * Built-in backends
+     */
+    static MsgBusInterface *createKafka(MsgBusFactory *factory, const u_char *router_hash);
+    static MsgBusInterface *createNull(MsgBusFactory *factory, const u_char *router_hash);
+    static MsgBusInterface *createShm(MsgBusFactory *factory, const u_char *router_hash);
+    static MsgBusInterface *createFanout(MsgBusFactory *factory, const u_char *router_hash);
+};
+
+#endif //OPENBMP_MSGBUSFACTORY_H
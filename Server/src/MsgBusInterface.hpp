@@ -18,6 +18,10 @@
 #include <cstdio>
 #include <ctime>
 #include <sys/time.h>
+#include <cstring>
+
+#include "MsgBusWriter.hpp"
+#include "bgp_common.h"
 
 /**
  * \class   MsgBusInterface
@@ -201,6 +205,11 @@ public:
          */
         std::string  ext_community_list;
 
+        /**
+         * large community list (RFC8092).
+         */
+        std::string large_community_list;
+
         /**
          * cluster list.
          */
@@ -229,14 +238,12 @@ public:
         uint8_t     prefix_bin[16];         ///< Prefix in binary form
         uint8_t     prefix_bcast_bin[16];   ///< Broadcast address/last address in binary form
         uint32_t    path_id;                ///< Add path ID - zero if not used
-        char        labels[255];            ///< Labels delimited by comma
+        bgp::label_stack labels;            ///< Labels of a labeled prefix, printed by the message bus
     };
 
     /// Rib extended with Route Distinguisher
     struct obj_route_distinguisher {
-        std::string     rd_administrator_subfield;
-        std::string     rd_assigned_number;
-        uint8_t         rd_type;
+        u_char          rd[8];              ///< Route distinguisher in wire format, rd[1] is the type
     };
     
     /// Rib extended with vpn specific fields
@@ -246,14 +253,15 @@ public:
 
     /// Rib extended with evpn specific fields
     struct obj_evpn: obj_rib, obj_route_distinguisher {
+        uint8_t     route_type;                         ///< Route type, zero if the route wasn't decoded
         uint8_t     originating_router_ip_len;
-        char        originating_router_ip[46];
-        char        ethernet_segment_identifier[255];
-        char        ethernet_tag_id_hex[16];
+        u_char      originating_router_ip[16];
+        u_char      ethernet_segment_identifier[10];    ///< ESI in wire format
+        u_char      ethernet_tag_id[4];
         uint8_t     mac_len;
-        char        mac[255];
+        u_char      mac[6];
         uint8_t     ip_len;
-        char        ip[46];
+        u_char      ip[16];
         int         mpls_label_1;
         int         mpls_label_2;
     };
@@ -541,7 +549,7 @@ public:
      * \param[in]   code       Linkstate action code
      *****************************************************************/
     virtual void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr,
-                                std::list<MsgBusInterface::obj_ls_node> &nodes,
+                                std::vector<MsgBusInterface::obj_ls_node> &nodes,
                                 ls_action_code code) = 0;
 
     /*****************************************************************//**
@@ -558,7 +566,7 @@ public:
      *              supplied data for each object.
      *****************************************************************/
     virtual void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr,
-                             std::list<MsgBusInterface::obj_ls_link> &links,
+                             std::vector<MsgBusInterface::obj_ls_link> &links,
                              ls_action_code code) = 0;
 
     /*****************************************************************//**
@@ -575,7 +583,7 @@ public:
      *              supplied data for each object.
      *****************************************************************/
     virtual void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr,
-                                std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
+                                std::vector<MsgBusInterface::obj_ls_prefix> &prefixes,
                                 ls_action_code code) = 0;
 
     /*****************************************************************//**
@@ -593,6 +601,83 @@ public:
      *****************************************************************/
     virtual void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) = 0;
 
+    /*****************************************************************//**
+     * \brief       Send consecutive unparsed BMP messages
+     *
+     * \details     Will generate one message for all BMP messages, used by
+     *              the raw passthrough.  The data is not referenced after
+     *              the call returns.
+     *
+     * \param[in]    r_hash     Router hash
+     * \param[in]    peer_asn   Peer ASN of the messages, 0 if not known
+     * \param[in]    data       BMP messages
+     * \param[in]    data_len   Length in bytes of all BMP messages
+     *****************************************************************/
+    virtual void send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len) = 0;
+
+    /*****************************************************************//**
+     * \brief       Check if raw messages of different peer ASNs can't be combined
+     *
+     * \returns     True if the raw message destination depends on the peer ASN
+     *****************************************************************/
+    virtual bool rawByPeerAsn() { return false; }
+
+    /*****************************************************************//**
+     * \brief       Get the outputs of the router
+     *
+     * \details     Used to skip decoding the messages that are not
+     *              produced.  Default is all outputs.
+     *
+     * \returns     MSGBUS_OUTPUT_* bits (see Config.h) of the router
+     *****************************************************************/
+    virtual uint32_t getRouterOutputs() { return ~0U; }
+
+    /*****************************************************************//**
+     * \brief       Get the outputs of a peer
+     *
+     * \details     The peer must have been added by update_Peer().
+     *              Default is all outputs.
+     *
+     * \param[in]   peer_hash  Peer hash ID (binary)
+     *
+     * \returns     MSGBUS_OUTPUT_* bits (see Config.h) of the peer
+     *****************************************************************/
+    virtual uint32_t getPeerOutputs(const u_char *peer_hash) { return ~0U; }
+
+    /*****************************************************************//**
+     * \brief       Start a batch of messages
+     *
+     * \details     Messages produced until endBatch() may be queued without
+     *              being flushed/serviced individually.  Default is a no-op.
+     *****************************************************************/
+    virtual void beginBatch() { }
+
+    /*****************************************************************//**
+     * \brief       End a batch of messages
+     *
+     * \details     Flushes/services everything produced since beginBatch()
+     *              in one call.  Default is a no-op.
+     *****************************************************************/
+    virtual void endBatch() { }
+
+    /*****************************************************************//**
+     * \brief       Produce the messages held back to be coalesced
+     *
+     * \details     Called when the reader has no more buffered messages of
+     *              the router, so rows are not held while the router is
+     *              quiet, and by RibResync at the end of each chunk since
+     *              the reader may be idle meanwhile.  Default is a no-op.
+     *****************************************************************/
+    virtual void flush() { }
+
+    /*****************************************************************//**
+     * \brief       Enable/disable debug messages of the backend
+     *
+     * \details     Default is a no-op.
+     *****************************************************************/
+    virtual void enableDebug() { }
+    virtual void disableDebug() { }
+
 
     /* ---------------------------------------------------------------------------
      * Commonly used methods
@@ -610,16 +695,21 @@ public:
      *
      */
     static void hash_toStr(const u_char *hash_bin, std::string &hash_str){
-
-        int i;
         char s[33];
 
-        for (i=0; i<16; i++)
-            sprintf(s+i*2, "%02x", hash_bin[i]);
-
-        s[32]='\0';
+        hash_toStr(hash_bin, s);
+        hash_str.assign(s, 32);
+    }
 
-        hash_str = s;
+    /**
+     * \brief       binary hash to printed string format, into a caller buffer
+     *
+     * \param[in]   hash_bin      16 byte binary/unsigned value
+     * \param[out]  hash_str      At least 33 bytes, NULL terminated
+     */
+    static void hash_toStr(const u_char *hash_bin, char *hash_str){
+        MsgBusWriter::hexEncode(hash_bin, 16, hash_str);
+        hash_str[32] = '\0';
     }
 
     /**
@@ -629,13 +719,16 @@ public:
      * \param[in]   time_us       Microseconds to add to timestamp
      * \param[out]  ts_str        Reference to storage of string value
      *
+     * \details     The date and time part is formatted once per second per thread,
+     *              messages of the same second only add the microseconds.
      */
     void getTimestamp(uint32_t time_secs, uint32_t time_us, std::string &ts_str){
-        char buf[48];
+        static thread_local std::time_t cached_secs = -1;
+        static thread_local char        cached_date[20];       // "%Y-%m-%d %H:%M:%S"
+        char buf[27];
         timeval tv;
         std::time_t secs;
         uint32_t us;
-        tm *p_tm;
 
         if (time_secs <= 1000) {
             gettimeofday(&tv, NULL);
@@ -647,12 +740,23 @@ public:
             us = time_us;
         }
 
-        p_tm = std::gmtime(&secs);
-        std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", p_tm);
-        ts_str = buf;
+        if (secs != cached_secs) {
+            tm p_tm;
+            gmtime_r(&secs, &p_tm);
+            std::strftime(cached_date, sizeof(cached_date), "%Y-%m-%d %H:%M:%S", &p_tm);
+            cached_secs = secs;
+        }
+
+        memcpy(buf, cached_date, 19);
+        buf[19] = '.';
+
+        us %= 1000000;
+        for (int i = 25; i > 19; i--) {
+            buf[i] = '0' + us % 10;
+            us /= 10;
+        }
 
-        sprintf(buf, ".%06u", us);
-        ts_str.append(buf);
+        ts_str.assign(buf, 26);
     }
 
 protected:
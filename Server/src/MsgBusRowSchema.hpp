@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#ifndef MSGBUSROWSCHEMA_HPP_
+#define MSGBUSROWSCHEMA_HPP_
+
+#include "MsgBusInterface.hpp"
+#include "MsgBusWriter.hpp"
+
+/**
+ * \brief   Compile time field descriptors of the message bus rows
+ * \details A descriptor names a member of an object and how it's written; a RowSchema
+ *          is an ordered list of descriptors for the same object type.  Writing a schema
+ *          expands at compile time to one MsgBusWriter field call per member, so both the
+ *          TSV and binary encodings get the same fields in the same order and the empty
+ *          form of a schema (e.g. the attributes of a DEL row) always has the right count.
+ *
+ *          Fields that don't come from the object (action, sequence, timestamp, ...) are
+ *          written by the encoder around the schemas.
+ */
+namespace msgbus_row {
+
+/**
+ * Member written with the MsgBusWriter::field() overload of its type
+ */
+template <typename T, typename V, V T::*M>
+struct Field {
+    static void write(MsgBusWriter &out, const T &obj)  { out.field(obj.*M); }
+};
+
+/**
+ * u_char array member holding printed text
+ */
+template <typename T, typename V, V T::*M>
+struct Text {
+    static void write(MsgBusWriter &out, const T &obj)  { out.field((const char *)(obj.*M)); }
+};
+
+/**
+ * Free form text member, tabs and newlines are escaped
+ */
+template <typename T, typename V, V T::*M>
+struct Escaped {
+    static void write(MsgBusWriter &out, const T &obj)  { out.fieldEscaped((const char *)(obj.*M)); }
+};
+
+/**
+ * 16 byte binary hash member
+ */
+template <typename T, typename V, V T::*M>
+struct Hash {
+    static void write(MsgBusWriter &out, const T &obj)  { out.fieldHash(obj.*M); }
+};
+
+/**
+ * Ordered fields of an object
+ */
+template <typename T, typename... Fields>
+struct RowSchema {
+    static const int count = sizeof...(Fields);         ///< Number of fields
+
+    /**
+     * Write the fields of obj, in order
+     */
+    static void write(MsgBusWriter &out, const T &obj) {
+        // Braced init lists are evaluated left to right
+        int expand[] = { 0, (Fields::write(out, obj), 0)... };
+        (void)expand;
+    }
+
+    /**
+     * Write the fields as empty, e.g. the object isn't known for the row
+     */
+    static void empty(MsgBusWriter &out) {
+        out.fieldEmpty(count);
+    }
+};
+
+#define MSGBUS_ROW_FIELD(T, m)      msgbus_row::Field<T, decltype(T::m), &T::m>
+#define MSGBUS_ROW_TEXT(T, m)       msgbus_row::Text<T, decltype(T::m), &T::m>
+#define MSGBUS_ROW_ESCAPED(T, m)    msgbus_row::Escaped<T, decltype(T::m), &T::m>
+#define MSGBUS_ROW_HASH(T, m)       msgbus_row::Hash<T, decltype(T::m), &T::m>
+
+typedef MsgBusInterface::obj_router             router;
+typedef MsgBusInterface::obj_path_attr          path_attr;
+typedef MsgBusInterface::obj_bgp_peer           bgp_peer;
+typedef MsgBusInterface::obj_peer_up_event      peer_up;
+typedef MsgBusInterface::obj_peer_down_event    peer_down;
+typedef MsgBusInterface::obj_stats_report       stats_report;
+
+/**
+ * Router fields of the router rows, name to term_data
+ */
+typedef RowSchema<router,
+        MSGBUS_ROW_TEXT(router, name),
+        MSGBUS_ROW_HASH(router, hash_id),
+        MSGBUS_ROW_TEXT(router, ip_addr),
+        MSGBUS_ROW_ESCAPED(router, descr),
+        MSGBUS_ROW_FIELD(router, term_reason_code),
+        MSGBUS_ROW_FIELD(router, term_reason_text),
+        MSGBUS_ROW_ESCAPED(router, initiate_data),
+        MSGBUS_ROW_ESCAPED(router, term_data)>          RouterFields;
+
+/**
+ * Path attributes of the unicast, L3VPN and EVPN rows, origin to originator_id
+ */
+typedef RowSchema<path_attr,
+        MSGBUS_ROW_FIELD(path_attr, origin),
+        MSGBUS_ROW_FIELD(path_attr, as_path),
+        MSGBUS_ROW_FIELD(path_attr, as_path_count),
+        MSGBUS_ROW_FIELD(path_attr, origin_as),
+        MSGBUS_ROW_FIELD(path_attr, next_hop),
+        MSGBUS_ROW_FIELD(path_attr, med),
+        MSGBUS_ROW_FIELD(path_attr, local_pref),
+        MSGBUS_ROW_FIELD(path_attr, aggregator),
+        MSGBUS_ROW_FIELD(path_attr, community_list),
+        MSGBUS_ROW_FIELD(path_attr, ext_community_list),
+        MSGBUS_ROW_FIELD(path_attr, cluster_list),
+        MSGBUS_ROW_FIELD(path_attr, atomic_agg),
+        MSGBUS_ROW_FIELD(path_attr, nexthop_isIPv4),
+        MSGBUS_ROW_FIELD(path_attr, originator_id)>     AttrFields;
+
+/**
+ * Peer ASN, address and RD of the peer rows
+ */
+typedef RowSchema<bgp_peer,
+        MSGBUS_ROW_FIELD(bgp_peer, peer_as),
+        MSGBUS_ROW_FIELD(bgp_peer, peer_addr),
+        MSGBUS_ROW_FIELD(bgp_peer, peer_rd)>            PeerAddrFields;
+
+/**
+ * Peer up event fields of the peer rows
+ */
+typedef RowSchema<peer_up,
+        MSGBUS_ROW_FIELD(peer_up, remote_port),
+        MSGBUS_ROW_FIELD(peer_up, local_asn),
+        MSGBUS_ROW_FIELD(peer_up, local_ip),
+        MSGBUS_ROW_FIELD(peer_up, local_port),
+        MSGBUS_ROW_FIELD(peer_up, local_bgp_id),
+        MSGBUS_ROW_ESCAPED(peer_up, info_data),
+        MSGBUS_ROW_FIELD(peer_up, sent_cap),
+        MSGBUS_ROW_FIELD(peer_up, recv_cap),
+        MSGBUS_ROW_FIELD(peer_up, remote_hold_time),
+        MSGBUS_ROW_FIELD(peer_up, local_hold_time)>     PeerUpFields;
+
+/**
+ * Peer down event fields of the peer rows
+ */
+typedef RowSchema<peer_down,
+        MSGBUS_ROW_FIELD(peer_down, bmp_reason),
+        MSGBUS_ROW_FIELD(peer_down, bgp_err_code),
+        MSGBUS_ROW_FIELD(peer_down, bgp_err_subcode),
+        MSGBUS_ROW_FIELD(peer_down, error_text)>        PeerDownFields;
+
+/**
+ * Peer flags of the peer rows, followed by the table name
+ */
+typedef RowSchema<bgp_peer,
+        MSGBUS_ROW_FIELD(bgp_peer, isL3VPN),
+        MSGBUS_ROW_FIELD(bgp_peer, isPrePolicy),
+        MSGBUS_ROW_FIELD(bgp_peer, isIPv4),
+        MSGBUS_ROW_FIELD(bgp_peer, isLocRib),
+        MSGBUS_ROW_FIELD(bgp_peer, isLocRibFiltered)>   PeerFlagFields;
+
+/**
+ * Counters of the bmp_stat rows
+ */
+typedef RowSchema<stats_report,
+        MSGBUS_ROW_FIELD(stats_report, prefixes_rej),
+        MSGBUS_ROW_FIELD(stats_report, known_dup_prefixes),
+        MSGBUS_ROW_FIELD(stats_report, known_dup_withdraws),
+        MSGBUS_ROW_FIELD(stats_report, invalid_cluster_list),
+        MSGBUS_ROW_FIELD(stats_report, invalid_as_path_loop),
+        MSGBUS_ROW_FIELD(stats_report, invalid_originator_id),
+        MSGBUS_ROW_FIELD(stats_report, invalid_as_confed_loop),
+        MSGBUS_ROW_FIELD(stats_report, routes_adj_rib_in),
+        MSGBUS_ROW_FIELD(stats_report, routes_loc_rib)> StatsFields;
+
+} /* namespace msgbus_row */
+
+#endif /* MSGBUSROWSCHEMA_HPP_ */
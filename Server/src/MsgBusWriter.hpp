@@ -0,0 +1,483 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#ifndef MSGBUSWRITER_HPP_
+#define MSGBUSWRITER_HPP_
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#define MSGBUS_BINARY_VERSION       1           ///< Version of the binary row encoding
+
+/**
+ * \class   MsgBusWriter
+ *
+ * \brief   Append only writer for tab delimited or binary message bus rows
+ * \details Writes rows directly into a working buffer at a cursor, replacing the
+ *          snprintf() into a second buffer followed by strcat() per row.  Integers,
+ *          hashes and IPv4 addresses are formatted by hand.
+ *
+ *          Fields are tab separated; the first field of a row is not prefixed with a tab.
+ *          A row that does not fit is dropped and the writer is marked full, so
+ *          that all following rows are dropped as well.  This matches the previous
+ *          behavior of skipping the strcat() once the working buffer size was exceeded.
+ *
+ *          With FORMAT_BINARY, fields are written in the same order but encoded as
+ *          type tagged values instead of text:
+ *
+ *              row     = uint32 length (network byte order) followed by the fields
+ *              field   = 1 byte type followed by the value, see BIN_TYPE_*
+ *              varint  = unsigned LEB128, signed values are zigzag encoded
+ *
+ *          Hashes and addresses are written as raw bytes instead of hex/printed text.
+ */
+class MsgBusWriter {
+public:
+    /**
+     * Row encoding
+     */
+    enum Format {
+        FORMAT_TSV=0,                       ///< Tab delimited text rows
+        FORMAT_BINARY                       ///< Length delimited, type tagged binary rows
+    };
+
+    /**
+     * Binary field types
+     */
+    enum BinaryType {
+        BIN_TYPE_EMPTY=0,                   ///< No value
+        BIN_TYPE_STRING,                    ///< varint length followed by the bytes
+        BIN_TYPE_UINT,                      ///< Unsigned varint
+        BIN_TYPE_INT,                       ///< Zigzag signed varint
+        BIN_TYPE_HASH,                      ///< 16 byte binary hash
+        BIN_TYPE_IPV4,                      ///< 4 byte address, network byte order
+        BIN_TYPE_IPV6                       ///< 16 byte address, network byte order
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] buf      Working buffer to write to
+     * \param [in] size     Size of the working buffer in bytes
+     * \param [in] format   Row encoding
+     */
+    MsgBusWriter(char *buf, size_t size, Format format=FORMAT_TSV) {
+        this->buf = buf;
+        this->size = size;
+        this->format = format;
+
+        reset();
+    }
+
+    /**
+     * Reset the writer to an empty buffer
+     */
+    void reset() {
+        len = 0;
+        row_start = 0;
+        first_field = true;
+        full = false;
+        str_start = 0;
+        in_str = false;
+
+        if (size > 0)
+            buf[0] = 0;
+    }
+
+    /**
+     * Length in bytes of the committed rows
+     */
+    size_t length() {
+        return len;
+    }
+
+    /**
+     * Drop the committed rows after length
+     *
+     * \param [in] length   Length returned by length() before the first row to drop
+     */
+    void truncate(size_t length) {
+        if (length > len)
+            return;
+
+        len = length;
+        row_start = length;
+        buf[len] = 0;
+    }
+
+    /**
+     * Pointer to the start of the buffer
+     */
+    char *data() {
+        return buf;
+    }
+
+    /**
+     * Check if a row was dropped because the buffer is full
+     */
+    bool isFull() {
+        return full;
+    }
+
+    /**
+     * Row encoding of the writer
+     */
+    Format getFormat() {
+        return format;
+    }
+
+    /**
+     * Start a new row
+     */
+    void beginRow() {
+        row_start = len;
+        first_field = true;
+
+        // Binary rows start with the length, filled in by endRow()
+        if (format == FORMAT_BINARY and reserve(4))
+            len += 4;
+    }
+
+    /**
+     * End the current row
+     *
+     * \details Adds the newline and commits the row if it fits, otherwise the
+     *          row is dropped.
+     *
+     * \return true if the row was committed, false if it was dropped
+     */
+    bool endRow() {
+        if (format == FORMAT_BINARY) {
+            endString();
+
+            if (not full) {
+                uint32_t row_len = htonl(len - row_start - 4);
+                memcpy(buf + row_start, &row_len, 4);
+            }
+
+        } else
+            append('\n');
+
+        if (full) {
+            len = row_start;
+            buf[len] = 0;
+            return false;
+        }
+
+        buf[len] = 0;
+        row_start = len;
+        return true;
+    }
+
+    /*********************************************************************
+     * Field methods - Each adds a tab before the value unless it's the
+     *    first field of the row
+     *********************************************************************/
+    void field(const char *value)           { sep(BIN_TYPE_STRING); append(value); }
+    void field(const std::string &value)    { sep(BIN_TYPE_STRING); append(value); }
+    void field(int value)                   { sep(BIN_TYPE_INT); appendInt(value); }
+    void field(uint32_t value)              { sep(BIN_TYPE_UINT); appendUInt(value); }
+    void field(uint64_t value)              { sep(BIN_TYPE_UINT); appendUInt(value); }
+
+    /**
+     * Add free form text field, newlines are written as a backslash n and tabs as spaces
+     */
+    void fieldEscaped(const char *value) {
+        sep(BIN_TYPE_STRING);
+
+        while (*value != 0) {
+            size_t n = strcspn(value, "\t\n");
+            append(value, n);
+            value += n;
+
+            if (*value == '\n')
+                append("\\n", 2);
+            else if (*value == '\t')
+                append(' ');
+            else
+                break;
+
+            value++;
+        }
+    }
+
+    /**
+     * Add count empty fields
+     */
+    void fieldEmpty(int count=1) {
+        for (int i = 0; i < count; i++)
+            sep(BIN_TYPE_EMPTY);
+    }
+
+    /**
+     * Add lowercase hex field without leading zeros (same as %x), binary is an unsigned varint
+     */
+    void fieldHex(uint64_t value)           { sep(BIN_TYPE_UINT); appendHex(value); }
+
+    /**
+     * Add 16 byte binary hash field in printed format (same as hash_toStr), binary is the raw hash
+     */
+    void fieldHash(const u_char *hash_bin)  { sep(BIN_TYPE_HASH); appendHash(hash_bin); }
+
+    /**
+     * Add IP address field in printed format, binary is the raw address
+     *
+     * \param [in] isIPv4   True if addr is 4 bytes IPv4, otherwise 16 bytes IPv6
+     * \param [in] addr     Binary address in network byte order
+     */
+    void fieldIp(bool isIPv4, const u_char *addr)   { sep(isIPv4 ? BIN_TYPE_IPV4 : BIN_TYPE_IPV6); appendIp(isIPv4, addr); }
+
+    /*********************************************************************
+     * Append methods - Append to the current field without a separator
+     *
+     *      With FORMAT_BINARY the text append methods extend the current
+     *      string field; the numeric ones write the value of their field.
+     *********************************************************************/
+
+    void append(char c) {
+        if (reserve(1))
+            buf[len++] = c;
+    }
+
+    void append(const char *value) {
+        append(value, strlen(value));
+    }
+
+    void append(const std::string &value) {
+        append(value.data(), value.length());
+    }
+
+    void append(const char *value, size_t value_len) {
+        if (reserve(value_len)) {
+            memcpy(buf + len, value, value_len);
+            len += value_len;
+        }
+    }
+
+    void appendUInt(uint64_t value) {
+        if (format == FORMAT_BINARY) {
+            appendVarint(value);
+            return;
+        }
+
+        char tmp[20];
+        int  i = sizeof(tmp);
+
+        do {
+            tmp[--i] = '0' + (value % 10);
+            value /= 10;
+        } while (value > 0);
+
+        append(tmp + i, sizeof(tmp) - i);
+    }
+
+    void appendInt(int64_t value) {
+        if (format == FORMAT_BINARY) {
+            appendVarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+            return;
+        }
+
+        if (value < 0) {
+            append('-');
+            appendUInt(~(uint64_t)value + 1);
+        } else
+            appendUInt(value);
+    }
+
+    void appendHex(uint64_t value) {
+        if (format == FORMAT_BINARY) {
+            appendVarint(value);
+            return;
+        }
+
+        char tmp[16];
+        int  i = sizeof(tmp);
+
+        do {
+            tmp[--i] = hexChar(value & 0xF);
+            value >>= 4;
+        } while (value > 0);
+
+        append(tmp + i, sizeof(tmp) - i);
+    }
+
+    void appendHash(const u_char *hash_bin) {
+        if (format == FORMAT_BINARY) {
+            append((const char *)hash_bin, 16);
+            return;
+        }
+
+        if (not reserve(32))
+            return;
+
+        hexEncode(hash_bin, 16, buf + len);
+        len += 32;
+    }
+
+    void appendIp(bool isIPv4, const u_char *addr) {
+        if (format == FORMAT_BINARY) {
+            append((const char *)addr, isIPv4 ? 4 : 16);
+            return;
+        }
+
+        if (isIPv4) {
+            for (int i = 0; i < 4; i++) {
+                if (i > 0)
+                    append('.');
+                appendUInt(addr[i]);
+            }
+
+        } else if (reserve(INET6_ADDRSTRLEN)) {
+            if (inet_ntop(AF_INET6, addr, buf + len, INET6_ADDRSTRLEN) != NULL)
+                len += strlen(buf + len);
+        }
+    }
+
+private:
+    char        *buf;                       ///< Working buffer
+    size_t      size;                       ///< Size of the working buffer
+    size_t      len;                        ///< Current write position (cursor)
+    size_t      row_start;                  ///< Position of the start of the current row
+    bool        first_field;                ///< True if the next field is the first of the row
+    bool        full;                       ///< True once a row did not fit in the buffer
+    Format      format;                     ///< Row encoding
+    size_t      str_start;                  ///< Binary: position of the length byte of the current string field
+    bool        in_str;                     ///< Binary: true while a string field is being appended to
+
+    static char hexChar(int value) {
+        return "0123456789abcdef"[value];
+    }
+
+public:
+    /**
+     * Encode bytes as lower case hex, two characters per byte by table lookup
+     *
+     * \param [in]  bin     Bytes to encode
+     * \param [in]  n       Number of bytes
+     * \param [out] out     At least 2 * n characters, not NULL terminated
+     */
+    static void hexEncode(const u_char *bin, size_t n, char *out) {
+        static const char pairs[513] =
+            "000102030405060708090a0b0c0d0e0f"
+            "101112131415161718191a1b1c1d1e1f"
+            "202122232425262728292a2b2c2d2e2f"
+            "303132333435363738393a3b3c3d3e3f"
+            "404142434445464748494a4b4c4d4e4f"
+            "505152535455565758595a5b5c5d5e5f"
+            "606162636465666768696a6b6c6d6e6f"
+            "707172737475767778797a7b7c7d7e7f"
+            "808182838485868788898a8b8c8d8e8f"
+            "909192939495969798999a9b9c9d9e9f"
+            "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+            "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+            "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+            "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+            "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+            "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+        for (size_t i = 0; i < n; i++)
+            memcpy(out + i * 2, pairs + bin[i] * 2, 2);
+    }
+
+private:
+    /**
+     * Check that len bytes plus the NULL terminator fit, marks the writer full if not
+     */
+    bool reserve(size_t n) {
+        if (full or len + n >= size) {
+            full = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Append an unsigned LEB128 varint
+     */
+    void appendVarint(uint64_t value) {
+        if (not reserve(10))
+            return;
+
+        while (value >= 0x80) {
+            buf[len++] = (char)(value | 0x80);
+            value >>= 7;
+        }
+
+        buf[len++] = (char)value;
+    }
+
+    /**
+     * Binary: Set the length of the current string field
+     *
+     * \details One length byte is reserved when the field is started; strings of 128 bytes
+     *          or more are moved up to make room for the longer varint.
+     */
+    void endString() {
+        if (not in_str)
+            return;
+
+        in_str = false;
+
+        if (full)
+            return;
+
+        size_t  str_len = len - str_start - 1;
+        u_char  tmp[10];
+        size_t  n = 0;
+
+        for (uint64_t value = str_len; ; value >>= 7) {
+            tmp[n++] = (u_char)(value | (value >= 0x80 ? 0x80 : 0));
+            if (value < 0x80)
+                break;
+        }
+
+        if (n > 1) {
+            if (not reserve(n - 1))
+                return;
+
+            memmove(buf + str_start + n, buf + str_start + 1, str_len);
+            len += n - 1;
+        }
+
+        memcpy(buf + str_start, tmp, n);
+    }
+
+    /**
+     * Start a field, tab separator or binary type
+     *
+     * \param [in] type     Binary type of the field
+     */
+    void sep(BinaryType type) {
+        if (format == FORMAT_BINARY) {
+            endString();
+            first_field = false;
+
+            if (not reserve(type == BIN_TYPE_STRING ? 2 : 1))
+                return;
+
+            buf[len++] = (char)type;
+
+            if (type == BIN_TYPE_STRING) {
+                str_start = len++;
+                in_str = true;
+            }
+
+        } else if (first_field)
+            first_field = false;
+        else
+            append('\t');
+    }
+};
+
+#endif /* MSGBUSWRITER_HPP_ */
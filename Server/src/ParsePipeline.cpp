@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include "ParsePipeline.h"
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfg          Pointer to the config instance
+ * \param [in] size         Number of workers, < 0 is one per CPU core
+ */
+ParsePipeline::ParsePipeline(Logger *logPtr, Config *cfg, int size) {
+    logger = logPtr;
+    this->cfg = cfg;
+    debug = cfg->debug_general;
+
+    if (size < 0)
+        size = std::thread::hardware_concurrency();
+
+    if (size < 1)
+        size = 1;
+
+    running = true;
+    next_home = 0;
+    ready_count = 0;
+    pending_count = 0;
+    group_count = 0;
+
+    // Create all workers before starting them, workers steal from each other
+    for (int i = 0; i < size; i++) {
+        Worker *worker = new Worker;
+        worker->id = i;
+        worker->thr = NULL;
+        workers.push_back(worker);
+    }
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i]->thr = new std::thread(&ParsePipeline::workerLoop, this, workers[i]);
+
+    LOG_INFO("Using a parse pipeline of %d workers", size);
+}
+
+/**
+ * Destructor, stops the workers
+ *
+ * \details All groups must be freed before this is called.
+ */
+ParsePipeline::~ParsePipeline() {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        running = false;
+    }
+
+    idle_cond.notify_all();
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->thr->join();
+        delete workers[i]->thr;
+        delete workers[i];
+    }
+
+    workers.clear();
+}
+
+/**
+ * Number of workers
+ */
+size_t ParsePipeline::size() {
+    return workers.size();
+}
+
+/**
+ * Number of tasks submitted but not done, of all groups
+ */
+int ParsePipeline::pending() {
+    return pending_count;
+}
+
+/**
+ * Number of groups
+ */
+int ParsePipeline::groups() {
+    return group_count;
+}
+
+/**
+ * Allocate a new group
+ */
+ParsePipeline::Group *ParsePipeline::newGroup() {
+    Group *group = new Group;
+
+    group->pending = 0;
+    group->waiting = false;
+    group->error = NULL;
+
+    ++group_count;
+
+    return group;
+}
+
+/**
+ * Drain and free a group, including its strands
+ *
+ * \param [in] group        Group to free
+ * \param [in] strands      Strands of the group
+ */
+void ParsePipeline::freeGroup(Group *group, std::vector<Strand *> &strands) {
+    {
+        std::unique_lock<std::mutex> lock(group->mutex);
+        waitPending(lock, group, 1);
+    }
+
+    for (size_t i = 0; i < strands.size(); i++)
+        delete strands[i];
+
+    strands.clear();
+
+    delete group;
+
+    --group_count;
+}
+
+/**
+ * Allocate a new strand
+ *
+ * \param [in] group        Group the strand belongs to
+ */
+ParsePipeline::Strand *ParsePipeline::newStrand(Group *group) {
+    Strand *strand = new Strand;
+
+    strand->group = group;
+    strand->scheduled = false;
+    strand->home = next_home++ % workers.size();
+
+    return strand;
+}
+
+/**
+ * Submit a task to be run after the tasks already submitted to the strand
+ *
+ * \details Blocks while the group has the max pending tasks or the strand is full.  The task is freed
+ *          after it's run.
+ *
+ * \param [in] strand       Strand to run the task on
+ * \param [in] task         Task to run
+ *
+ * \throw (char const *str) error of a previous task in the group
+ */
+void ParsePipeline::submit(Strand *strand, Task *task) {
+    Group *group = strand->group;
+
+    {
+        std::unique_lock<std::mutex> lock(group->mutex);
+
+        waitPending(lock, group, cfg->parse_max_pending);
+
+        if (group->error != NULL) {
+            delete task;
+            throw group->error;
+        }
+
+        group->pending++;
+    }
+
+    ++pending_count;
+
+    strand->tasks.push(task);
+
+    if (not strand->scheduled.exchange(true))
+        schedule(strand, workers[strand->home]);
+}
+
+/**
+ * Wait for all submitted tasks of the group to be done
+ *
+ * \param [in] group        Group to drain
+ *
+ * \throw (char const *str) error of a task in the group
+ */
+void ParsePipeline::drain(Group *group) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+
+    waitPending(lock, group, 1);
+
+    if (group->error != NULL)
+        throw group->error;
+}
+
+/**
+ * Wait for the pending tasks of a group to be below max
+ *
+ * \param [in] lock     Lock of group->mutex
+ * \param [in] group    Group to wait on
+ * \param [in] max      Wait until pending is below this
+ */
+void ParsePipeline::waitPending(std::unique_lock<std::mutex> &lock, Group *group, int max) {
+    while (group->pending >= max) {
+        group->waiting = true;
+        group->cond.wait(lock);
+    }
+
+    group->waiting = false;
+}
+
+/**
+ * Queue a ready strand on a worker
+ *
+ * \param [in] strand   Strand to queue
+ * \param [in] worker   Worker to queue on
+ */
+void ParsePipeline::schedule(Strand *strand, Worker *worker) {
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->ready.push_back(strand);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        ready_count++;
+    }
+
+    idle_cond.notify_one();
+}
+
+/**
+ * Get the next ready strand, from the worker or stolen from another worker
+ *
+ * \param [in] worker   Worker looking for work
+ *
+ * \return strand or NULL if none are ready
+ */
+ParsePipeline::Strand *ParsePipeline::nextStrand(Worker *worker) {
+    Strand *strand = NULL;
+
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+
+        if (not worker->ready.empty()) {
+            strand = worker->ready.front();
+            worker->ready.pop_front();
+        }
+    }
+
+    // Steal from the other workers, starting with the next one
+    for (size_t i = 1; strand == NULL and i < workers.size(); i++) {
+        Worker *victim = workers[(worker->id + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+
+        if (not victim->ready.empty()) {
+            strand = victim->ready.back();
+            victim->ready.pop_back();
+        }
+    }
+
+    if (strand != NULL)
+        ready_count--;
+
+    return strand;
+}
+
+/**
+ * Run tasks of a strand
+ *
+ * \param [in] worker   Worker running the strand
+ * \param [in] strand   Strand to run
+ */
+void ParsePipeline::runStrand(Worker *worker, Strand *strand) {
+    Group *group = strand->group;
+    Task  *task;
+    bool  failed;
+    bool  more = true;
+
+    // A scheduled strand always has at least one task, it can still be being filled by the reader
+    for (int i = 0; more and i < PARSE_PIPELINE_STRAND_BATCH; i++) {
+        while (not strand->tasks.tryPop(task))
+            std::this_thread::yield();
+
+        {
+            std::lock_guard<std::mutex> lock(group->mutex);
+            failed = group->error != NULL;
+        }
+
+        // Remaining tasks of a failed group are discarded
+        if (not failed) {
+            try {
+                task->run();
+
+            } catch (char const *str) {
+                LOG_INFO("Parse pipeline worker %d caught: %s", worker->id, str);
+
+                std::lock_guard<std::mutex> lock(group->mutex);
+                group->error = str;
+            }
+        }
+
+        delete task;
+
+        /*
+         * Unschedule when empty.  Check again after, the reader doesn't schedule a task
+         *    submitted before scheduled was cleared
+         */
+        if (strand->tasks.empty()) {
+            strand->scheduled = false;
+            more = not strand->tasks.empty() and not strand->scheduled.exchange(true);
+        }
+
+        /*
+         * The group and strand can be freed once pending reaches zero, so they are
+         *    not used after this when the strand is done
+         */
+        {
+            --pending_count;
+
+            std::lock_guard<std::mutex> lock(group->mutex);
+            group->pending--;
+
+            if (group->waiting)
+                group->cond.notify_all();
+        }
+    }
+
+    // Still has tasks, requeue at the back so that other strands run and it can be stolen
+    if (more)
+        schedule(strand, worker);
+}
+
+/**
+ * Worker thread loop
+ *
+ * \param [in] worker   Worker to run
+ */
+void ParsePipeline::workerLoop(Worker *worker) {
+    Strand *strand;
+
+    while (running) {
+        if ((strand = nextStrand(worker)) != NULL) {
+            runStrand(worker, strand);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idle_mutex);
+
+        while (running and ready_count <= 0)
+            idle_cond.wait(lock);
+    }
+}
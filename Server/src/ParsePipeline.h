@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PARSEPIPELINE_H_
+#define PARSEPIPELINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+#include "Config.h"
+#include "boundedQueue.hpp"
+#include "CacheAligned.h"
+
+#define PARSE_PIPELINE_STRAND_BATCH     64          ///< Max tasks run for a strand before it can be stolen
+#define PARSE_PIPELINE_STRAND_QUEUE     256         ///< Max tasks queued per strand, submit waits when full
+
+/**
+ * \class   ParsePipeline
+ *
+ * \brief   Work stealing pool used to decode and encode BGP messages off the router thread
+ * \details The router reader frames the BMP messages and submits the decode/encode of each
+ *          one as a task.  Tasks are submitted to a strand; each peer has its own strand and
+ *          the tasks of a strand are run one at a time in submit order, so the messages of a
+ *          peer are produced in the order they were received.  Strands of different peers
+ *          run in parallel.
+ *
+ *          A ready strand is queued on the worker it was assigned to.  Idle workers steal
+ *          ready strands from the other workers, so a single busy router can use all of the
+ *          workers.
+ *
+ *          Strands are grouped per router.  drain() waits for all tasks of the group, which
+ *          is used before processing messages that change the peer state (e.g. peer up/down).
+ */
+class ParsePipeline {
+public:
+    /**
+     * Unit of work run by a worker
+     */
+    class Task {
+    public:
+        virtual ~Task() {}
+
+        /**
+         * Run the task
+         *
+         * \throw (char const *str) message indicate error, the remaining tasks of the group are discarded
+         */
+        virtual void run() = 0;
+    };
+
+    /**
+     * Group of strands, one per router
+     */
+    struct Group {
+        std::mutex              mutex;          ///< Guards pending, waiting and error
+        std::condition_variable cond;           ///< Signals the submitter/drain
+        int                     pending;        ///< Number of tasks submitted but not done
+        bool                    waiting;        ///< Indicates a submitter is waiting on cond
+        char const              *error;         ///< First task error, NULL if none
+    };
+
+    /**
+     * Tasks run serially, one per peer
+     *
+     * \details The router reader is the only producer and the worker running the strand is
+     *          the only consumer; scheduled hands the consumer side between workers.
+     */
+    struct Strand : public CacheAligned {
+        Group                   *group;         ///< Group of the strand
+        boundedQueue<Task *, false> tasks;      ///< Tasks in submit order
+        std::atomic<bool>       scheduled;      ///< Indicates the strand is queued or being run by a worker
+        int                     home;           ///< Worker the strand is queued to
+
+        Strand() : tasks(PARSE_PIPELINE_STRAND_QUEUE) {}
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     * \param [in] size         Number of workers, < 0 is one per CPU core
+     */
+    ParsePipeline(Logger *logPtr, Config *cfg, int size);
+
+    /**
+     * Destructor, stops the workers
+     *
+     * \details All groups must be freed before this is called.
+     */
+    ~ParsePipeline();
+
+    /**
+     * Allocate a new group
+     */
+    Group *newGroup();
+
+    /**
+     * Drain and free a group, including its strands
+     *
+     * \param [in] group        Group to free
+     * \param [in] strands      Strands of the group
+     */
+    void freeGroup(Group *group, std::vector<Strand *> &strands);
+
+    /**
+     * Allocate a new strand
+     *
+     * \param [in] group        Group the strand belongs to
+     */
+    Strand *newStrand(Group *group);
+
+    /**
+     * Submit a task to be run after the tasks already submitted to the strand
+     *
+     * \details Blocks while the group has the max pending tasks or the strand is full.  The task is freed
+     *          after it's run.
+     *
+     * \param [in] strand       Strand to run the task on
+     * \param [in] task         Task to run
+     *
+     * \throw (char const *str) error of a previous task in the group
+     */
+    void submit(Strand *strand, Task *task);
+
+    /**
+     * Wait for all submitted tasks of the group to be done
+     *
+     * \param [in] group        Group to drain
+     *
+     * \throw (char const *str) error of a task in the group
+     */
+    void drain(Group *group);
+
+    /**
+     * Number of workers
+     */
+    size_t size();
+
+    /**
+     * Number of tasks submitted but not done, of all groups
+     */
+    int pending();
+
+    /**
+     * Number of groups
+     */
+    int groups();
+
+private:
+    /**
+     * Worker thread state
+     */
+    struct Worker {
+        int                     id;             ///< Worker number
+        std::thread             *thr;           ///< Worker thread
+        std::mutex              mutex;          ///< Guards ready
+        std::deque<Strand *>    ready;          ///< Strands ready to run, owner runs from front, thieves from back
+    };
+
+    Config                      *cfg;           ///< Pointer to config instance
+    Logger                      *logger;        ///< Logging class pointer
+    bool                        debug;          ///< debug flag to indicate debugging
+
+    std::atomic<bool>           running;        ///< Indicates if the workers should run
+    std::vector<Worker *>       workers;        ///< Worker threads
+    std::atomic<unsigned int>   next_home;      ///< Round robin worker assignment of new strands
+
+    std::mutex                  idle_mutex;     ///< Guards the increment of ready_count, used by idle_cond
+    std::condition_variable     idle_cond;      ///< Signals idle workers
+    std::atomic<int>            ready_count;    ///< Number of strands queued on all workers
+    std::atomic<int>            pending_count;  ///< Number of tasks submitted but not done, of all groups
+    std::atomic<int>            group_count;    ///< Number of groups
+
+    /**
+     * Worker thread loop
+     *
+     * \param [in] worker   Worker to run
+     */
+    void workerLoop(Worker *worker);
+
+    /**
+     * Queue a ready strand on a worker
+     *
+     * \param [in] strand   Strand to queue
+     * \param [in] worker   Worker to queue on
+     */
+    void schedule(Strand *strand, Worker *worker);
+
+    /**
+     * Get the next ready strand, from the worker or stolen from another worker
+     *
+     * \param [in] worker   Worker looking for work
+     *
+     * \return strand or NULL if none are ready
+     */
+    Strand *nextStrand(Worker *worker);
+
+    /**
+     * Run tasks of a strand
+     *
+     * \param [in] worker   Worker running the strand
+     * \param [in] strand   Strand to run
+     */
+    void runStrand(Worker *worker, Strand *strand);
+
+    /**
+     * Wait for the pending tasks of a group to be below max
+     *
+     * \param [in] lock     Lock of group->mutex
+     * \param [in] group    Group to wait on
+     * \param [in] max      Wait until pending is below this
+     */
+    void waitPending(std::unique_lock<std::mutex> &lock, Group *group, int max);
+};
+
+#endif /* PARSEPIPELINE_H_ */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "RecvBuffer.h"
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+/**
+ * Constructor for class
+ *
+ * \param [in] size         Size in bytes of the buffer
+ * \param [in] hugepages    Hugepage backing of the buffer
+ *
+ * \throw (const char *) if the address space can't be reserved
+ */
+RecvBuffer::RecvBuffer(size_t size, Hugepages hugepages) {
+    void *addr = MAP_FAILED;
+
+    len = size;
+    backing = hugepages;
+
+#ifdef MAP_HUGETLB
+    if (backing == HUGEPAGES_EXPLICIT) {
+        page_size = RECV_BUFFER_HUGEPAGE_SIZE;
+        map_len = (len + page_size - 1) & ~(page_size - 1);
+
+        addr = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+
+    // Hugepage pool is exhausted or not supported
+    if (addr == MAP_FAILED) {
+        if (backing == HUGEPAGES_EXPLICIT)
+            backing = HUGEPAGES_TRANSPARENT;
+
+        page_size = sysconf(_SC_PAGESIZE);
+        map_len = (len + page_size - 1) & ~(page_size - 1);
+
+        addr = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (addr == MAP_FAILED)
+            throw "Failed to reserve the router receive buffer";
+
+#ifdef MADV_HUGEPAGE
+        if (backing == HUGEPAGES_TRANSPARENT)
+            madvise(addr, map_len, MADV_HUGEPAGE);
+#else
+        backing = HUGEPAGES_OFF;
+#endif
+    }
+
+    buf = (unsigned char *)addr;
+}
+
+RecvBuffer::~RecvBuffer() {
+    munmap(buf, map_len);
+}
+
+/**
+ * Give the memory of a range back to the kernel
+ *
+ * \details Only the pages fully in the range are released.  The range must not
+ *          be in use by another thread.
+ *
+ * \param [in] offset       Offset of the range in the buffer
+ * \param [in] length       Length of the range in bytes
+ */
+void RecvBuffer::release(size_t offset, size_t length) {
+    size_t start = (offset + page_size - 1) & ~(page_size - 1);
+    size_t end = offset + length >= len ? map_len : (offset + length) & ~(page_size - 1);
+
+    if (end > start)
+        madvise(buf + start, end - start, MADV_DONTNEED);
+}
+
+/**
+ * Parse the hugepages config value
+ *
+ * \param [in]  value       off, transparent or explicit
+ * \param [out] hugepages   Updated with the parsed value
+ *
+ * \return false if the value is not valid
+ */
+bool RecvBuffer::parseHugepages(const std::string &value, Hugepages &hugepages) {
+    if (value == "off")
+        hugepages = HUGEPAGES_OFF;
+    else if (value == "transparent")
+        hugepages = HUGEPAGES_TRANSPARENT;
+    else if (value == "explicit")
+        hugepages = HUGEPAGES_EXPLICIT;
+    else
+        return false;
+
+    return true;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef RECVBUFFER_H_
+#define RECVBUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+#define RECV_BUFFER_HUGEPAGE_SIZE   (2 * 1024 * 1024)   ///< Size of the explicit hugepages
+
+/**
+ * \class   RecvBuffer
+ *
+ * \brief   Receive buffer of a router that only uses memory for what it holds
+ * \details The address space of the buffer is reserved up front, but the memory is only
+ *          committed by the kernel when a page is first written.  release() gives the
+ *          pages back, the owner calls it when the buffer is drained, so the memory of a
+ *          router follows its backlog instead of the configured buffer size.
+ *
+ *          The buffer can be backed by hugepages to cut the TLB misses of large buffers:
+ *
+ *              transparent - madvise(MADV_HUGEPAGE), the kernel uses hugepages when it can
+ *              explicit    - MAP_HUGETLB from the preallocated pool (vm.nr_hugepages), the
+ *                            buffer falls back to transparent if the pool is exhausted
+ *
+ *          Released memory reads back as zeros.
+ */
+class RecvBuffer {
+public:
+    /**
+     * Hugepage backing of the buffer
+     */
+    enum Hugepages {
+        HUGEPAGES_OFF=0,
+        HUGEPAGES_TRANSPARENT,
+        HUGEPAGES_EXPLICIT
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] size         Size in bytes of the buffer
+     * \param [in] hugepages    Hugepage backing of the buffer
+     *
+     * \throw (const char *) if the address space can't be reserved
+     */
+    RecvBuffer(size_t size, Hugepages hugepages=HUGEPAGES_OFF);
+    ~RecvBuffer();
+
+    /**
+     * Pointer to the buffer memory
+     */
+    unsigned char *data() {
+        return buf;
+    }
+
+    /**
+     * Size in bytes of the buffer
+     */
+    size_t size() const {
+        return len;
+    }
+
+    /**
+     * Hugepage backing actually used, see the fallback of HUGEPAGES_EXPLICIT
+     */
+    Hugepages hugepages() const {
+        return backing;
+    }
+
+    /**
+     * Give the memory of a range back to the kernel
+     *
+     * \details Only the pages fully in the range are released.  The range must not
+     *          be in use by another thread.
+     *
+     * \param [in] offset       Offset of the range in the buffer
+     * \param [in] length       Length of the range in bytes
+     */
+    void release(size_t offset, size_t length);
+
+    /**
+     * Give the memory of the whole buffer back to the kernel
+     */
+    void release() {
+        release(0, len);
+    }
+
+    /**
+     * Parse the hugepages config value
+     *
+     * \param [in]  value       off, transparent or explicit
+     * \param [out] hugepages   Updated with the parsed value
+     *
+     * \return false if the value is not valid
+     */
+    static bool parseHugepages(const std::string &value, Hugepages &hugepages);
+
+private:
+    unsigned char   *buf;                   ///< Reserved memory
+    size_t          len;                    ///< Size of the buffer
+    size_t          map_len;                ///< Size of the mapping, rounded up to the page size
+    size_t          page_size;              ///< Page size of the mapping
+    Hugepages       backing;                ///< Hugepage backing of the mapping
+};
+
+#endif /* RECVBUFFER_H_ */
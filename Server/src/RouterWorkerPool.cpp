@@ -0,0 +1,804 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "RouterWorkerPool.h"
+#include "BMPStreamReader.h"
+#include "MonotonicClock.h"
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr           Pointer to Logger instance
+ * \param [in] cfg              Pointer to the config instance
+ * \param [in] size             Number of workers, < 0 is one per CPU core
+ * \param [in] msgbus_factory   Creates the message bus of each router
+ * \param [in] parse_pipeline   Shared parse pipeline, NULL if messages are decoded inline
+ * \param [in] admission        Paces the reads of the routers, NULL if not used
+ */
+RouterWorkerPool::RouterWorkerPool(Logger *logPtr, Config *cfg, int size, MsgBusFactory *msgbus_factory,
+                                   ParsePipeline *parse_pipeline, AdmissionController *admission) {
+    logger = logPtr;
+    this->cfg = cfg;
+    this->msgbus_factory = msgbus_factory;
+    this->parse_pipeline = parse_pipeline;
+    this->admission = admission;
+    debug = cfg->debug_general;
+
+    int ncpus = std::thread::hardware_concurrency();
+
+    if (size < 0)
+        size = ncpus;
+
+    if (size < 1)
+        size = 1;
+
+    running = true;
+    reaper_stop = false;
+
+    use_uring = cfg->router_workers_uring;
+#ifndef HAVE_LIBURING
+    if (use_uring) {
+        LOG_WARN("workers.io_uring is enabled but openbmpd was built without liburing, using epoll");
+        use_uring = false;
+    }
+#endif
+
+    for (int i = 0; i < size; i++) {
+        Worker *worker = new Worker;
+        worker->id = i;
+
+        if ((worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+            LOG_ERR("Failed to create epoll instance for router worker %d: %s", i, strerror(errno));
+            delete worker;
+            throw "ERROR: Failed to create epoll instance for router worker";
+        }
+
+#ifdef HAVE_LIBURING
+        // The kernel may not support io_uring, decided by the first worker
+        if (use_uring and not uringSetup(worker)) {
+            close(worker->epoll_fd);
+            delete worker;
+
+            if (i > 0)
+                throw "ERROR: Failed to setup io_uring for router worker";
+
+            LOG_WARN("io_uring is not available, router workers use epoll");
+            use_uring = false;
+            i--;
+            continue;
+        }
+#endif
+
+        worker->thr = new std::thread(&RouterWorkerPool::workerLoop, this, worker);
+
+        // Pin the worker to a core
+        if (cfg->router_workers_pin and ncpus > 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % ncpus, &cpus);
+
+            if (pthread_setaffinity_np(worker->thr->native_handle(), sizeof(cpus), &cpus) != 0)
+                LOG_WARN("Failed to pin router worker %d to cpu %d", i, i % ncpus);
+        }
+
+        workers.push_back(worker);
+    }
+
+    reaper = new std::thread(&RouterWorkerPool::reaperLoop, this);
+
+    LOG_INFO("Using a pool of %d router workers%s", size, use_uring ? " with io_uring" : "");
+}
+
+/**
+ * Destructor, stops the workers and closes all router sessions
+ */
+RouterWorkerPool::~RouterWorkerPool() {
+    running = false;
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->thr->join();
+        delete workers[i]->thr;
+
+        for (std::list<RouterSession *>::iterator it = workers[i]->sessions.begin();
+                it != workers[i]->sessions.end(); ++it) {
+            close((*it)->thr->client.c_sock);
+
+            std::lock_guard<std::mutex> lock(closed_mutex);
+            closed.push_back(*it);
+        }
+
+        workers[i]->sessions.clear();
+        workers[i]->incoming.clear();
+        close(workers[i]->epoll_fd);
+
+#ifdef HAVE_LIBURING
+        if (use_uring)
+            uringFree(workers[i]);
+#endif
+
+        delete workers[i];
+    }
+
+    workers.clear();
+
+    // Reaper frees what is left before exiting
+    {
+        std::lock_guard<std::mutex> lock(closed_mutex);
+        reaper_stop = true;
+    }
+
+    closed_cond.notify_one();
+    reaper->join();
+    delete reaper;
+}
+
+/**
+ * Number of workers
+ */
+size_t RouterWorkerPool::size() {
+    return workers.size();
+}
+
+/**
+ * Add a newly accepted router connection
+ *
+ * \details thr->running is set to false once the session is closed and freed,
+ *          thr must not be freed before then.
+ *
+ * \param [in] thr      Router thread management entry, with the accepted client
+ */
+void RouterWorkerPool::addRouter(ThreadMgmt *thr) {
+    RouterSession *session = new RouterSession;
+    Worker *worker = workers[0];
+    epoll_event ev;
+
+    session->thr = thr;
+    session->reader = NULL;
+    session->mbus = NULL;
+    session->pending = false;
+    session->retry_ms = 0;
+    session->armed = false;
+    session->closing = false;
+    session->eof = false;
+
+    thr->running = true;
+
+    // Socket is read directly by the BMP reader stream
+    thr->client.pipe_sock = 0;
+    thr->client.ring = NULL;
+
+    try {
+        session->mbus = msgbus_factory->create(thr->client.hash_id);
+
+        session->reader = new BMPReader(logger, cfg, parse_pipeline, admission);
+
+        // The worker services the other routers while this one is paced
+        session->reader->setAdmissionWait(false);
+
+    } catch (char const *str) {
+        LOG_ERR("%s: Failed to start router session: %s", thr->client.c_ip, str);
+        close(thr->client.c_sock);
+        freeSession(session);
+        return;
+    }
+
+    // Assign to the least loaded worker, of the workers pinned to the cpu receiving the router packets if known
+    int ncpus = std::thread::hardware_concurrency();
+    bool by_cpu = cfg->socket_incoming_cpu and cfg->router_workers_pin and ncpus > 0
+                  and thr->client.incoming_cpu >= 0 and thr->client.incoming_cpu < (int)workers.size();
+
+    size_t min_sessions = (size_t)-1;
+    for (size_t i = 0; i < workers.size(); i++) {
+        if (by_cpu and (int)i % ncpus != thr->client.incoming_cpu)
+            continue;
+
+        std::lock_guard<std::mutex> lock(workers[i]->mutex);
+
+        if (workers[i]->sessions.size() < min_sessions) {
+            min_sessions = workers[i]->sessions.size();
+            worker = workers[i];
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->sessions.push_back(session);
+
+        // The io_uring of the worker is only used by the worker thread, it arms the receive
+        if (use_uring)
+            worker->incoming.push_back(session);
+    }
+
+    if (use_uring) {
+        LOG_INFO("%s: Router assigned to io_uring worker %d using socket %d", thr->client.c_ip, worker->id,
+                 thr->client.c_sock);
+        return;
+    }
+
+    bzero(&ev, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = session;
+
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, thr->client.c_sock, &ev) < 0) {
+        LOG_ERR("%s: Failed to add router socket %d to worker %d: %s", thr->client.c_ip,
+                thr->client.c_sock, worker->id, strerror(errno));
+        closeRouter(worker, session);
+        return;
+    }
+
+    LOG_INFO("%s: Router assigned to worker %d using socket %d", thr->client.c_ip, worker->id, thr->client.c_sock);
+}
+
+/**
+ * Worker thread loop
+ *
+ * \param [in] worker   Worker to run
+ */
+void RouterWorkerPool::workerLoop(Worker *worker) {
+    epoll_event events[ROUTER_WORKER_MAX_EVENTS];
+    std::list<RouterSession *> pending;         // Sessions with messages still buffered
+    std::list<RouterSession *> paced;           // Sessions paced by the admission rate, not in the epoll set
+    RouterSession *session;
+    int n, timeout;
+
+#ifdef HAVE_LIBURING
+    if (use_uring) {
+        uringLoop(worker);
+        return;
+    }
+#endif
+
+    while (running) {
+        timeout = resume(worker, paced, pending);
+
+        n = epoll_wait(worker->epoll_fd, events, ROUTER_WORKER_MAX_EVENTS, pending.empty() ? timeout : 0);
+
+        if (n < 0 and errno != EINTR) {
+            LOG_ERR("Router worker %d epoll wait failed: %s", worker->id, strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            session = (RouterSession *)events[i].data.ptr;
+
+            if (session->pending)
+                continue;                       // Will be read when serviced below
+
+            if (serviceRouter(session)) {
+                if (session->retry_ms != 0)
+                    pace(worker, session, paced);
+
+                else if (session->reader->getStream(&session->thr->client)->canParse()) {
+                    session->pending = true;
+                    pending.push_back(session);
+                }
+            } else
+                closeRouter(worker, session);
+        }
+
+        /*
+         * Service the routers that have more buffered, one round per wait so that
+         *    all routers on the worker are serviced in turn
+         */
+        for (std::list<RouterSession *>::iterator it = pending.begin(); it != pending.end(); ) {
+            session = *it;
+
+            if (not serviceRouter(session)) {
+                it = pending.erase(it);
+                closeRouter(worker, session);
+
+            } else if (session->retry_ms != 0) {
+                it = pending.erase(it);
+                pace(worker, session, paced);
+
+            } else if (not session->reader->getStream(&session->thr->client)->canParse()) {
+                session->pending = false;
+                it = pending.erase(it);
+
+            } else
+                ++it;
+        }
+    }
+}
+
+/**
+ * Read and parse the buffered messages of a router
+ *
+ * \param [in] session  Router session
+ *
+ * \return true if the session is still open, false if it was closed
+ */
+bool RouterWorkerPool::serviceRouter(RouterSession *session) {
+    BMPListener::ClientInfo *client = &session->thr->client;
+    BMPStreamReader *stream = session->reader->getStream(client);
+    ssize_t rval;
+    bool    is_closed;
+
+    session->retry_ms = 0;
+
+    // Read what is available without blocking
+    rval = stream->fillAvailable();
+    is_closed = rval == 0 or (rval < 0 and errno != EAGAIN and errno != EWOULDBLOCK);
+
+    // Messages received before the close are still parsed
+    try {
+        for (int i = 0; i < ROUTER_WORKER_MAX_MSGS and stream->canParse(); i++) {
+            if (not session->reader->ReadIncomingMsg(client, session->mbus))
+                return false;
+
+            // Paced by the admission rate, the rest (and the close) is handled once resumed
+            if ((session->retry_ms = session->reader->admissionRetryMs()) != 0)
+                return true;
+        }
+
+    } catch (char const *str) {
+        LOG_INFO("%s: %s - Router session for sock [%d] ended", client->c_ip, str, client->c_sock);
+        return false;
+    }
+
+    if (is_closed) {
+        LOG_INFO("%s: Router connection closed on socket %d", client->c_ip, client->c_sock);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Stop servicing a session paced by the admission rate until its retry time
+ *
+ * \details With epoll, the socket is removed from the epoll set meanwhile so that the worker
+ *          isn't woken by its data.  The session stays pending so that it isn't queued again.
+ *
+ * \param [in] worker   Worker of the session
+ * \param [in] session  Router session, retry_ms is set
+ * \param [in] paced    Paced sessions of the worker, session is added
+ */
+void RouterWorkerPool::pace(Worker *worker, RouterSession *session, std::list<RouterSession *> &paced) {
+    if (not use_uring)
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, session->thr->client.c_sock, NULL);
+
+    session->pending = true;
+    paced.push_back(session);
+}
+
+/**
+ * Service again the paced sessions whose retry time has come
+ *
+ * \param [in] worker   Worker of the sessions
+ * \param [in] paced    Paced sessions of the worker, those resumed are removed
+ * \param [in] pending  Sessions to be serviced, those resumed are added
+ *
+ * \return Time in ms until the next paced session is due, at most 100
+ */
+int RouterWorkerPool::resume(Worker *worker, std::list<RouterSession *> &paced, std::list<RouterSession *> &pending) {
+    uint64_t now_ms = monotonicMs();
+    uint64_t next_ms = now_ms + 100;
+    epoll_event ev;
+
+    for (std::list<RouterSession *>::iterator it = paced.begin(); it != paced.end(); ) {
+        RouterSession *session = *it;
+
+        if (session->retry_ms > now_ms) {
+            if (session->retry_ms < next_ms)
+                next_ms = session->retry_ms;
+            ++it;
+            continue;
+        }
+
+        if (not use_uring) {
+            bzero(&ev, sizeof(ev));
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.ptr = session;
+
+            if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, session->thr->client.c_sock, &ev) < 0)
+                LOG_ERR("%s: Failed to add router socket %d back to worker %d: %s", session->thr->client.c_ip,
+                        session->thr->client.c_sock, worker->id, strerror(errno));
+        }
+
+        // Still pending, serviced in the next round
+        session->retry_ms = 0;
+        pending.push_back(session);
+        it = paced.erase(it);
+    }
+
+    return next_ms - now_ms;
+}
+
+/**
+ * Remove a session from its worker and queue it to be freed
+ *
+ * \param [in] worker   Worker of the session
+ * \param [in] session  Router session
+ */
+void RouterWorkerPool::closeRouter(Worker *worker, RouterSession *session) {
+    if (not use_uring)
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, session->thr->client.c_sock, NULL);
+    close(session->thr->client.c_sock);
+
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->sessions.remove(session);
+        worker->incoming.remove(session);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(closed_mutex);
+        closed.push_back(session);
+    }
+
+    closed_cond.notify_one();
+}
+
+/**
+ * Free a closed session
+ *
+ * \param [in] session  Router session
+ */
+void RouterWorkerPool::freeSession(RouterSession *session) {
+    ThreadMgmt *thr = session->thr;
+
+    // Reader uses the message bus, free it first
+    if (session->reader != NULL)
+        delete session->reader;
+
+    // Sends the router term message
+    if (session->mbus != NULL)
+        delete session->mbus;
+
+    delete session;
+
+    // Indicate that the router is no longer running, thr may be freed after this
+    thr->running = false;
+}
+
+/**
+ * Reaper thread loop, frees the closed sessions
+ */
+void RouterWorkerPool::reaperLoop() {
+    RouterSession *session;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(closed_mutex);
+
+            while (not reaper_stop and closed.empty())
+                closed_cond.wait(lock);
+
+            if (closed.empty())
+                break;                          // Stopped and nothing left to free
+
+            session = closed.front();
+            closed.pop_front();
+        }
+
+        freeSession(session);
+    }
+}
+
+#ifdef HAVE_LIBURING
+/**
+ * Setup the io_uring and receive buffers of a worker
+ *
+ * \param [in] worker   Worker to setup
+ *
+ * \return true if setup, false if io_uring is not available
+ */
+bool RouterWorkerPool::uringSetup(Worker *worker) {
+    int ret;
+
+    if ((ret = io_uring_queue_init(ROUTER_WORKER_URING_ENTRIES, &worker->uring, 0)) < 0) {
+        LOG_WARN("Failed to create io_uring for router worker %d: %s", worker->id, strerror(-ret));
+        return false;
+    }
+
+    // Buffer ring (group 0) the multishot receives select their buffers from
+    worker->buf_ring = io_uring_setup_buf_ring(&worker->uring, ROUTER_WORKER_URING_BUFS, 0, 0, &ret);
+    if (worker->buf_ring == NULL) {
+        LOG_WARN("Failed to register receive buffers for router worker %d: %s", worker->id, strerror(-ret));
+        io_uring_queue_exit(&worker->uring);
+        return false;
+    }
+
+    worker->bufs = new u_char[ROUTER_WORKER_URING_BUFS * ROUTER_WORKER_URING_BUF_SIZE];
+
+    for (int i = 0; i < ROUTER_WORKER_URING_BUFS; i++)
+        io_uring_buf_ring_add(worker->buf_ring, worker->bufs + i * ROUTER_WORKER_URING_BUF_SIZE,
+                              ROUTER_WORKER_URING_BUF_SIZE, i, io_uring_buf_ring_mask(ROUTER_WORKER_URING_BUFS), i);
+
+    io_uring_buf_ring_advance(worker->buf_ring, ROUTER_WORKER_URING_BUFS);
+
+    return true;
+}
+
+/**
+ * Free the io_uring and receive buffers of a worker
+ *
+ * \param [in] worker   Worker
+ */
+void RouterWorkerPool::uringFree(Worker *worker) {
+    // Outstanding receives are canceled by the exit, the buffers are not used after
+    io_uring_free_buf_ring(&worker->uring, worker->buf_ring, ROUTER_WORKER_URING_BUFS, 0);
+    io_uring_queue_exit(&worker->uring);
+
+    delete [] worker->bufs;
+}
+
+/**
+ * Worker thread loop using io_uring
+ *
+ * \param [in] worker   Worker to run
+ */
+void RouterWorkerPool::uringLoop(Worker *worker) {
+    std::list<RouterSession *> pending;         // Sessions with received data or messages still buffered
+    std::list<RouterSession *> done;            // Closing sessions whose receive has completed
+    std::list<RouterSession *> paced;           // Sessions paced by the admission rate
+    RouterSession *session;
+    io_uring_cqe *cqe;
+    unsigned head, count;
+    int timeout;
+
+    while (running) {
+        // Arm the receive of the routers added since the last round
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+
+            while (not worker->incoming.empty() and uringArm(worker, worker->incoming.front()))
+                worker->incoming.pop_front();
+        }
+
+        timeout = resume(worker, paced, pending);
+
+        // Submit and wait in one call, don't wait if routers still have messages buffered
+        __kernel_timespec ts = { 0, timeout * 1000000 };
+        int ret = io_uring_submit_and_wait_timeout(&worker->uring, &cqe, pending.empty() ? 1 : 0,
+                                                   pending.empty() ? &ts : NULL, NULL);
+
+        if (ret < 0 and ret != -ETIME and ret != -EINTR and ret != -EBUSY) {
+            LOG_ERR("Router worker %d io_uring wait failed: %s", worker->id, strerror(-ret));
+            break;
+        }
+
+        // Reap all completions in a batch
+        count = 0;
+        io_uring_for_each_cqe(&worker->uring, head, cqe) {
+            count++;
+
+            if ((session = (RouterSession *)io_uring_cqe_get_data(cqe)) == NULL)
+                continue;                       // Completion of a cancel
+
+            if (cqe->res > 0 and (cqe->flags & IORING_CQE_F_BUFFER)) {
+                RouterSession::Held held;
+                held.bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                held.off = 0;
+                held.len = cqe->res;
+                session->held.push_back(held);
+            }
+
+            // Multishot receive ended; closed, failed, canceled or out of buffers
+            if (not (cqe->flags & IORING_CQE_F_MORE)) {
+                session->armed = false;
+
+                if (cqe->res == 0)
+                    session->eof = true;
+
+                else if (cqe->res < 0 and cqe->res != -ENOBUFS and cqe->res != -ECANCELED) {
+                    if (not session->closing)
+                        LOG_INFO("%s: Router receive failed on socket %d: %s", session->thr->client.c_ip,
+                                 session->thr->client.c_sock, strerror(-cqe->res));
+                    session->eof = true;
+                }
+
+                if (session->closing) {
+                    done.push_back(session);
+                    continue;
+                }
+            }
+
+            if (not session->pending and not session->closing) {
+                session->pending = true;
+                pending.push_back(session);
+            }
+        }
+
+        io_uring_cq_advance(&worker->uring, count);
+
+        while (not done.empty()) {
+            session = done.front();
+            done.pop_front();
+
+            uringRelease(worker, session);
+            closeRouter(worker, session);
+        }
+
+        /*
+         * Service the routers with received data, one round per wait so that
+         *    all routers on the worker are serviced in turn
+         */
+        for (std::list<RouterSession *>::iterator it = pending.begin(); it != pending.end(); ) {
+            session = *it;
+
+            if (not uringService(worker, session)) {
+                it = pending.erase(it);
+                session->pending = false;
+                uringClose(worker, session);
+                continue;
+            }
+
+            // Received data is held meanwhile, the receive stops once all buffers are held
+            if (session->retry_ms != 0) {
+                it = pending.erase(it);
+                pace(worker, session, paced);
+                continue;
+            }
+
+            // Receive stopped for lack of buffers, restart it once the router holds none
+            if (not session->armed and not session->eof and session->held.empty())
+                uringArm(worker, session);
+
+            if (session->held.empty() and session->armed and
+                    not session->reader->getStream(&session->thr->client)->canParse()) {
+                session->pending = false;
+                it = pending.erase(it);
+
+            } else
+                ++it;
+        }
+    }
+}
+
+/**
+ * Queue a multishot receive for a router
+ *
+ * \param [in] worker   Worker of the session
+ * \param [in] session  Router session
+ *
+ * \return true if queued, false if the submission queue is full
+ */
+bool RouterWorkerPool::uringArm(Worker *worker, RouterSession *session) {
+    io_uring_sqe *sqe = io_uring_get_sqe(&worker->uring);
+
+    if (sqe == NULL)
+        return false;
+
+    io_uring_prep_recv_multishot(sqe, session->thr->client.c_sock, NULL, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    io_uring_sqe_set_data(sqe, session);
+
+    session->armed = true;
+
+    return true;
+}
+
+/**
+ * Copy the held buffers of a router to its stream and parse the buffered messages
+ *
+ * \details Only complete messages are parsed, the stream never reads the socket.
+ *
+ * \param [in] worker   Worker of the session
+ * \param [in] session  Router session
+ *
+ * \return true if the session is still open, false if it should be closed
+ */
+bool RouterWorkerPool::uringService(Worker *worker, RouterSession *session) {
+    BMPListener::ClientInfo *client = &session->thr->client;
+    BMPStreamReader *stream = session->reader->getStream(client);
+    int parsed = 0;
+
+    session->retry_ms = 0;
+
+    while (true) {
+        // Copy the received data in order, as much as the stream buffer takes
+        while (not session->held.empty()) {
+            RouterSession::Held &held = session->held.front();
+
+            held.off += stream->append(worker->bufs + held.bid * ROUTER_WORKER_URING_BUF_SIZE + held.off,
+                                       held.len - held.off);
+            if (held.off < held.len)
+                break;                          // Stream buffer is full
+
+            io_uring_buf_ring_add(worker->buf_ring, worker->bufs + held.bid * ROUTER_WORKER_URING_BUF_SIZE,
+                                  ROUTER_WORKER_URING_BUF_SIZE, held.bid,
+                                  io_uring_buf_ring_mask(ROUTER_WORKER_URING_BUFS), 0);
+            io_uring_buf_ring_advance(worker->buf_ring, 1);
+
+            session->held.pop_front();
+        }
+
+        if (parsed >= ROUTER_WORKER_MAX_MSGS or not stream->canParse())
+            break;
+
+        try {
+            for (; parsed < ROUTER_WORKER_MAX_MSGS and stream->canParse(); parsed++) {
+                if (not session->reader->ReadIncomingMsg(client, session->mbus))
+                    return false;
+
+                // Paced by the admission rate, the rest is parsed once resumed
+                if ((session->retry_ms = session->reader->admissionRetryMs()) != 0)
+                    return true;
+            }
+
+        } catch (char const *str) {
+            LOG_INFO("%s: %s - Router session for sock [%d] ended", client->c_ip, str, client->c_sock);
+            return false;
+        }
+    }
+
+    // Reading the rest from the socket would race with the receive
+    if (not stream->canParse() and stream->buffered() == BMP_STREAM_BUF_SIZE) {
+        LOG_WARN("%s: Message larger than the stream buffer or not BMPv3, not supported with io_uring",
+                 client->c_ip);
+        return false;
+    }
+
+    // Messages received before the close are still parsed
+    if (session->eof and session->held.empty() and not stream->canParse()) {
+        LOG_INFO("%s: Router connection closed on socket %d", client->c_ip, client->c_sock);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Close a session, canceling its receive first if outstanding
+ *
+ * \param [in] worker   Worker of the session
+ * \param [in] session  Router session
+ */
+void RouterWorkerPool::uringClose(Worker *worker, RouterSession *session) {
+    session->closing = true;
+
+    if (not session->armed) {
+        uringRelease(worker, session);
+        closeRouter(worker, session);
+        return;
+    }
+
+    io_uring_sqe *sqe = io_uring_get_sqe(&worker->uring);
+    if (sqe == NULL) {
+        io_uring_submit(&worker->uring);
+        sqe = io_uring_get_sqe(&worker->uring);
+    }
+
+    // The final completion of the receive closes the session
+    io_uring_prep_cancel(sqe, session, 0);
+    io_uring_sqe_set_data(sqe, NULL);
+}
+
+/**
+ * Return the held buffers of a session to the buffer ring
+ *
+ * \param [in] worker   Worker of the session
+ * \param [in] session  Router session
+ */
+void RouterWorkerPool::uringRelease(Worker *worker, RouterSession *session) {
+    int n = 0;
+
+    for (; not session->held.empty(); n++) {
+        uint16_t bid = session->held.front().bid;
+
+        io_uring_buf_ring_add(worker->buf_ring, worker->bufs + bid * ROUTER_WORKER_URING_BUF_SIZE,
+                              ROUTER_WORKER_URING_BUF_SIZE, bid, io_uring_buf_ring_mask(ROUTER_WORKER_URING_BUFS), n);
+        session->held.pop_front();
+    }
+
+    if (n > 0)
+        io_uring_buf_ring_advance(worker->buf_ring, n);
+}
+#endif
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ROUTERWORKERPOOL_H_
+#define ROUTERWORKERPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "client_thread.h"
+#include "BMPReader.h"
+#include "MsgBusFactory.h"
+#include "KafkaProducerPool.h"
+#include "ParsePipeline.h"
+#include "AdmissionController.h"
+#include "Logger.h"
+#include "Config.h"
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#define ROUTER_WORKER_MAX_EVENTS    64          ///< Max epoll events returned per wait
+#define ROUTER_WORKER_MAX_MSGS      1000        ///< Max messages parsed for a router before servicing the next
+#define ROUTER_WORKER_URING_ENTRIES 1024        ///< Submission queue entries of the io_uring of a worker
+#define ROUTER_WORKER_URING_BUFS    256         ///< Receive buffers of a worker, must be a power of 2
+#define ROUTER_WORKER_URING_BUF_SIZE 65536      ///< Size in bytes of each receive buffer
+
+/**
+ * \class   RouterWorkerPool
+ *
+ * \brief   Fixed pool of event driven router workers
+ * \details Used instead of a client thread per router.  Each worker has its own epoll
+ *          instance and services the sockets of the routers assigned to it.  A router
+ *          is assigned to the least loaded worker when it connects and stays on that
+ *          worker, so its messages are parsed in order.
+ *
+ *          The router socket is read (non-blocking) into the BMPReader stream buffer
+ *          and messages are parsed only once they are completely buffered, so a slow
+ *          router does not block the other routers on the worker.  Closed sessions are
+ *          freed by a separate thread since the message bus term can take a few seconds.
+ *          A router paced by the admission control isn't waited for, it is set aside and
+ *          serviced again at the retry time given by AdmissionController::tryAcquire().
+ *
+ *          With workers.io_uring (and HAVE_LIBURING), each worker has an io_uring instead
+ *          of the epoll instance.  A multishot receive per router selects buffers from a
+ *          buffer ring registered by the worker, and the completions of all routers are
+ *          reaped in a batch.  Received buffers are held by the session until they are
+ *          copied to the stream buffer; when all buffers are held the kernel stops the
+ *          receive (ENOBUFS) and it is re-armed once the router has drained them.
+ */
+class RouterWorkerPool {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr           Pointer to Logger instance
+     * \param [in] cfg              Pointer to the config instance
+     * \param [in] size             Number of workers, < 0 is one per CPU core
+     * \param [in] msgbus_factory   Creates the message bus of each router
+     * \param [in] parse_pipeline   Shared parse pipeline, NULL if messages are decoded inline
+     * \param [in] admission        Paces the reads of the routers, NULL if not used
+     */
+    RouterWorkerPool(Logger *logPtr, Config *cfg, int size, MsgBusFactory *msgbus_factory,
+                     ParsePipeline *parse_pipeline=NULL, AdmissionController *admission=NULL);
+
+    /**
+     * Destructor, stops the workers and closes all router sessions
+     */
+    ~RouterWorkerPool();
+
+    /**
+     * Add a newly accepted router connection
+     *
+     * \details thr->running is set to false once the session is closed and freed,
+     *          thr must not be freed before then.
+     *
+     * \param [in] thr      Router thread management entry, with the accepted client
+     */
+    void addRouter(ThreadMgmt *thr);
+
+    /**
+     * Number of workers
+     */
+    size_t size();
+
+private:
+    /**
+     * Router session serviced by a worker
+     */
+    struct RouterSession {
+        ThreadMgmt      *thr;                   ///< Thread management entry of the router
+        BMPReader       *reader;                ///< BMP reader/parser for the router
+        MsgBusInterface *mbus;                  ///< Message bus for the router
+        bool            pending;                ///< True if queued to be serviced
+        uint64_t        retry_ms;               ///< Time the session is serviced again once paced by the admission rate, 0 if not paced
+
+        /**
+         * Received io_uring buffer not yet copied to the stream
+         */
+        struct Held {
+            uint16_t    bid;                    ///< Buffer ID in the worker buffer ring
+            uint32_t    off;                    ///< Offset of the data not yet copied
+            uint32_t    len;                    ///< Length of the received data
+        };
+
+        std::deque<Held> held;                  ///< Received buffers in order (io_uring only)
+        bool            armed;                  ///< True if a multishot receive is outstanding (io_uring only)
+        bool            closing;                ///< True once the receive is canceled to close the session
+        bool            eof;                    ///< True if the router closed the connection or the receive failed
+    };
+
+    /**
+     * Worker thread state
+     */
+    struct Worker {
+        int                         id;         ///< Worker number, used for logging and cpu pinning
+        int                         epoll_fd;   ///< epoll instance for the router sockets
+        std::thread                 *thr;       ///< Worker thread
+        std::mutex                  mutex;      ///< Guards sessions and incoming
+        std::list<RouterSession *>  sessions;   ///< Router sessions assigned to the worker
+        std::list<RouterSession *>  incoming;   ///< Sessions to be armed by the worker (io_uring only)
+
+#ifdef HAVE_LIBURING
+        io_uring                    uring;      ///< Receive ring of the router sockets
+        io_uring_buf_ring           *buf_ring;  ///< Buffer ring registered with uring
+        u_char                      *bufs;      ///< Memory of the receive buffers
+#endif
+    };
+
+    Config                      *cfg;                   ///< Pointer to config instance
+    Logger                      *logger;                ///< Logging class pointer
+    bool                        debug;                  ///< debug flag to indicate debugging
+    MsgBusFactory               *msgbus_factory;        ///< Creates the message bus of each router
+    ParsePipeline               *parse_pipeline;        ///< Shared parse pipeline, NULL if not used
+    AdmissionController         *admission;             ///< Paces the reads of the routers, NULL if not used
+
+    bool                        use_uring;              ///< Indicates if the workers use io_uring instead of epoll
+    bool                        running;                ///< Indicates if the workers should run
+    std::vector<Worker *>       workers;                ///< Worker threads
+
+    std::thread                 *reaper;                ///< Thread freeing closed sessions
+    bool                        reaper_stop;            ///< Indicates the reaper should exit once closed is empty
+    std::mutex                  closed_mutex;           ///< Guards closed and reaper_stop
+    std::condition_variable     closed_cond;            ///< Signals the reaper
+    std::list<RouterSession *>  closed;                 ///< Closed sessions to be freed
+
+    /**
+     * Worker thread loop
+     *
+     * \param [in] worker   Worker to run
+     */
+    void workerLoop(Worker *worker);
+
+#ifdef HAVE_LIBURING
+    /**
+     * Setup the io_uring and receive buffers of a worker
+     *
+     * \param [in] worker   Worker to setup
+     *
+     * \return true if setup, false if io_uring is not available
+     */
+    bool uringSetup(Worker *worker);
+
+    /**
+     * Free the io_uring and receive buffers of a worker
+     *
+     * \param [in] worker   Worker
+     */
+    void uringFree(Worker *worker);
+
+    /**
+     * Worker thread loop using io_uring
+     *
+     * \param [in] worker   Worker to run
+     */
+    void uringLoop(Worker *worker);
+
+    /**
+     * Queue a multishot receive for a router
+     *
+     * \param [in] worker   Worker of the session
+     * \param [in] session  Router session
+     *
+     * \return true if queued, false if the submission queue is full
+     */
+    bool uringArm(Worker *worker, RouterSession *session);
+
+    /**
+     * Copy the held buffers of a router to its stream and parse the buffered messages
+     *
+     * \param [in] worker   Worker of the session
+     * \param [in] session  Router session
+     *
+     * \return true if the session is still open, false if it should be closed
+     */
+    bool uringService(Worker *worker, RouterSession *session);
+
+    /**
+     * Close a session, canceling its receive first if outstanding
+     *
+     * \details The session is closed by the worker loop once the receive has completed.
+     *
+     * \param [in] worker   Worker of the session
+     * \param [in] session  Router session
+     */
+    void uringClose(Worker *worker, RouterSession *session);
+
+    /**
+     * Return the held buffers of a session to the buffer ring
+     *
+     * \param [in] worker   Worker of the session
+     * \param [in] session  Router session
+     */
+    void uringRelease(Worker *worker, RouterSession *session);
+#endif
+
+    /**
+     * Read and parse the buffered messages of a router
+     *
+     * \param [in] session  Router session
+     *
+     * \return true if the session is still open, false if it was closed
+     */
+    bool serviceRouter(RouterSession *session);
+
+    /**
+     * Stop servicing a session paced by the admission rate until its retry time
+     *
+     * \param [in] worker   Worker of the session
+     * \param [in] session  Router session, retry_ms is set
+     * \param [in] paced    Paced sessions of the worker, session is added
+     */
+    void pace(Worker *worker, RouterSession *session, std::list<RouterSession *> &paced);
+
+    /**
+     * Service again the paced sessions whose retry time has come
+     *
+     * \param [in] worker   Worker of the sessions
+     * \param [in] paced    Paced sessions of the worker, those resumed are removed
+     * \param [in] pending  Sessions to be serviced, those resumed are added
+     *
+     * \return Time in ms until the next paced session is due, at most 100
+     */
+    int resume(Worker *worker, std::list<RouterSession *> &paced, std::list<RouterSession *> &pending);
+
+    /**
+     * Remove a session from its worker and queue it to be freed
+     *
+     * \param [in] worker   Worker of the session
+     * \param [in] session  Router session
+     */
+    void closeRouter(Worker *worker, RouterSession *session);
+
+    /**
+     * Free a closed session
+     *
+     * \param [in] session  Router session
+     */
+    void freeSession(RouterSession *session);
+
+    /**
+     * Reaper thread loop, frees the closed sessions
+     */
+    void reaperLoop();
+};
+
+#endif /* ROUTERWORKERPOOL_H_ */
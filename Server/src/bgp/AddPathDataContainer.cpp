@@ -10,8 +10,6 @@
 #include "AddPathDataContainer.h"
 #include "OpenMsg.h"
 
-#include <memory>
-
 AddPathDataContainer::AddPathDataContainer() {
 }
 
@@ -27,66 +25,57 @@ AddPathDataContainer::~AddPathDataContainer() {
  * \param [in] sent_open        Is obtained from sent open message. False if from recieved
  */
 void AddPathDataContainer::addAddPath(int afi, int safi, int send_receive, bool sent_open) {
-    AddPathMap::iterator iterator = this->addPathMap.find(this->getAFiSafiKeyString(afi, safi));
-    if(iterator == this->addPathMap.end()) {
-        sendReceiveCodesForSentAndReceivedOpenMessageStructure newStructure;
+    int idx = afiIndex(afi);
 
-        if (sent_open) {
-            newStructure.sendReceiveCodeForSentOpenMessage = send_receive;
-        } else {
-            newStructure.sendReceiveCodeForReceivedOpenMessage = send_receive;
-        }
+    if (idx >= AFI_IDX_COUNT or safi < 0 or safi >= 256)
+        return;
 
-        this->addPathMap.insert(std::pair<std::string, sendReceiveCodesForSentAndReceivedOpenMessageStructure>(
-                this->getAFiSafiKeyString(afi, safi),
-                newStructure
-        ));
+    // Following the rule:
+    // add_path_<afi/safi> = true IF (SENT_OPEN has ADD-PATH sent or both) AND (RECV_OPEN has ADD-PATH recv or both)
+    if (sent_open) {
+        sent_receive[idx][safi] = send_receive == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_RECEIVE or
+                                  send_receive == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND_RECEIVE;
     } else {
-        if (sent_open) {
-            iterator->second.sendReceiveCodeForSentOpenMessage = send_receive;
-        } else {
-            iterator->second.sendReceiveCodeForReceivedOpenMessage = send_receive;
-        }
+        recv_send[idx][safi] = send_receive == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND or
+                               send_receive == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND_RECEIVE;
     }
+
+    enabled[idx][safi] = sent_receive[idx][safi] and recv_send[idx][safi];
 }
 
 /**
- * Generates unique string from AFI and SAFI combination
+ * Get the AFI/SAFIs that add path is enabled for
  *
- * \param [in] afi              Afi code from RFC
- * \param [in] safi             Safi code form RFC
- *
- * \return string unique for AFI and SAFI combination
+ * \param [out] families       List of (afi, safi), appended to
  */
-std::string AddPathDataContainer::getAFiSafiKeyString(int afi, int safi) {
-    std::string result = std::to_string(static_cast<long long>(afi));
-    result.append("_");
-    result.append(std::to_string(static_cast<long long>(safi)));
-    return result;
+void AddPathDataContainer::getEnabled(std::vector<std::pair<uint16_t, uint8_t> > &families) const {
+    static const uint16_t afis[AFI_IDX_COUNT] = { bgp::BGP_AFI_IPV4, bgp::BGP_AFI_IPV6, bgp::BGP_AFI_L2VPN,
+                                                  bgp::BGP_AFI_BGPLS };
+
+    for (int idx = 0; idx < AFI_IDX_COUNT; idx++) {
+        if (enabled[idx].none())
+            continue;
+
+        for (int safi = 0; safi < 256; safi++) {
+            if (enabled[idx][safi])
+                families.push_back(std::make_pair(afis[idx], (uint8_t)safi));
+        }
+    }
 }
 
 /**
- * Is add path capability enabled for such AFI and SAFI
+ * Enable add path for an AFI and SAFI, as if both OPEN messages had it
  *
  * \param [in] afi              Afi code from RFC
  * \param [in] safi             Safi code form RFC
- *
- * \return is enabled
  */
-bool AddPathDataContainer::isAddPathEnabled(int afi, int safi) {
-    AddPathMap::iterator iterator = this->addPathMap.find(this->getAFiSafiKeyString(afi, safi));
+void AddPathDataContainer::setEnabled(int afi, int safi) {
+    int idx = afiIndex(afi);
 
-    if(iterator == this->addPathMap.end()) {
-        return false;
-    } else {
-        // Following the rule:
-        // add_path_<afi/safi> = true IF (SENT_OPEN has ADD-PATH sent or both) AND (RECV_OPEN has ADD-PATH recv or both)
-        return (
-            iterator->second.sendReceiveCodeForSentOpenMessage == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_RECEIVE or
-                    iterator->second.sendReceiveCodeForSentOpenMessage == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND_RECEIVE
-            ) and (
-            iterator->second.sendReceiveCodeForReceivedOpenMessage == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND or
-                    iterator->second.sendReceiveCodeForReceivedOpenMessage == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND_RECEIVE
-            );
-    }
+    if (idx >= AFI_IDX_COUNT or safi < 0 or safi >= 256)
+        return;
+
+    sent_receive[idx][safi] = true;
+    recv_send[idx][safi] = true;
+    enabled[idx][safi] = true;
 }
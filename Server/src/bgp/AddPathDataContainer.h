@@ -12,33 +12,44 @@
 
 #include "bgp_common.h"
 
-#include <map>
-#include <memory>
+#include <bitset>
+#include <utility>
+#include <vector>
 
 
+/**
+ * Add Path capability of a peer, by AFI and SAFI
+ *
+ * \details Filled from the sent and received OPEN messages.  Whether add path is used is
+ *          computed when the capabilities are added, so the check per NLRI is a bit test.
+ *          Only the AFIs in bgp::BGP_AFI are tracked, add path is disabled for others.
+ */
 class AddPathDataContainer {
 private:
+    enum { AFI_IDX_IPV4=0, AFI_IDX_IPV6, AFI_IDX_L2VPN, AFI_IDX_BGPLS, AFI_IDX_COUNT };
 
-    struct sendReceiveCodesForSentAndReceivedOpenMessageStructure {
-        int     sendReceiveCodeForSentOpenMessage;
-        int     sendReceiveCodeForReceivedOpenMessage;
-    };
+    typedef std::bitset<256> SafiSet;           ///< Bit per SAFI
 
-    // Peer related data container. First key is afi safi unique key. Second is structure with Add Path information
-    typedef std::map<std::string, sendReceiveCodesForSentAndReceivedOpenMessageStructure> AddPathMap;
-
-    // Peer related information about Add Path
-    AddPathMap addPathMap;
+    SafiSet     sent_receive[AFI_IDX_COUNT];    ///< Sent OPEN has ADD-PATH receive or both
+    SafiSet     recv_send[AFI_IDX_COUNT];       ///< Received OPEN has ADD-PATH send or both
+    SafiSet     enabled[AFI_IDX_COUNT];         ///< Add path is used, both of the above
 
     /**
-     * Generates unique string from AFI and SAFI combination
+     * Index of an AFI in the tables
      *
      * \param [in] afi              Afi code from RFC
-     * \param [in] safi             Safi code form RFC
      *
-     * \return string unique for AFI and SAFI combination
+     * \return index, AFI_IDX_COUNT if the AFI is not tracked
      */
-    std::string getAFiSafiKeyString(int afi, int safi);
+    static int afiIndex(int afi) {
+        switch (afi) {
+            case bgp::BGP_AFI_IPV4  : return AFI_IDX_IPV4;
+            case bgp::BGP_AFI_IPV6  : return AFI_IDX_IPV6;
+            case bgp::BGP_AFI_L2VPN : return AFI_IDX_L2VPN;
+            case bgp::BGP_AFI_BGPLS : return AFI_IDX_BGPLS;
+            default                 : return AFI_IDX_COUNT;
+        }
+    }
 
 public:
     AddPathDataContainer();
@@ -63,7 +74,28 @@ public:
      *
      * \return is enabled
      */
-    bool isAddPathEnabled(int afi, int safi);
+    bool isAddPathEnabled(int afi, int safi) const {
+        int idx = afiIndex(afi);
+
+        return idx < AFI_IDX_COUNT and safi >= 0 and safi < 256 and enabled[idx][safi];
+    }
+
+    /**
+     * Get the AFI/SAFIs that add path is enabled for
+     *
+     * \param [out] families       List of (afi, safi), appended to
+     */
+    void getEnabled(std::vector<std::pair<uint16_t, uint8_t> > &families) const;
+
+    /**
+     * Enable add path for an AFI and SAFI, as if both OPEN messages had it
+     *
+     * \details Used to restore the capabilities saved before a collector restart.
+     *
+     * \param [in] afi              Afi code from RFC
+     * \param [in] safi             Safi code form RFC
+     */
+    void setEnabled(int afi, int safi);
 
 };
 
@@ -0,0 +1,602 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "AdjRibIn.h"
+#include "PrefixKernel.h"
+
+namespace bgp_msg {
+
+std::mutex                  AdjRibIn::registry_mutex;
+std::condition_variable     AdjRibIn::registry_cond;
+std::vector<AdjRibIn *>     AdjRibIn::registry;
+uint64_t                    AdjRibIn::next_id = 1;
+
+/**
+ * Bit of a prefix
+ *
+ * \param [in] prefix   Prefix in binary form
+ * \param [in] bit      Bit number, 0 is the most significant bit
+ */
+static inline int bitAt(const uint8_t *prefix, int bit) {
+    return (prefix[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+/**
+ * Number of leading bits two prefixes have in common
+ *
+ * \param [in] a        Prefix in binary form
+ * \param [in] b        Prefix in binary form
+ * \param [in] max_len  Number of bits to compare
+ */
+static inline int commonLen(const uint8_t *a, const uint8_t *b, int max_len) {
+    int len = 0;
+
+    for (int i = 0; len < max_len; i++, len += 8) {
+        uint8_t diff = a[i] ^ b[i];
+
+        if (diff != 0) {
+            while (not (diff & 0x80)) {
+                diff <<= 1;
+                len++;
+            }
+            break;
+        }
+    }
+
+    return len < max_len ? len : max_len;
+}
+
+/**
+ * Check if the first len bits of two prefixes are the same
+ */
+static inline bool prefixMatch(const uint8_t *a, const uint8_t *b, int len) {
+    return commonLen(a, b, len) == len;
+}
+
+/**
+ * Check if a hash ID is all zeros
+ */
+static inline bool hashIsZero(const u_char *hash) {
+    static const u_char zero[16] = { 0 };
+
+    return memcmp(hash, zero, sizeof(zero)) == 0;
+}
+
+/**
+ * Print a hash ID in hex
+ *
+ * \param [in]  hash    16 byte hash ID
+ * \param [out] buf     At least 33 bytes
+ */
+void AdjRibIn::hashStr(const u_char *hash, char *buf) {
+    static const char hex[] = "0123456789abcdef";
+
+    for (int i = 0; i < 16; i++) {
+        buf[i * 2] = hex[hash[i] >> 4];
+        buf[i * 2 + 1] = hex[hash[i] & 0x0f];
+    }
+    buf[32] = 0;
+}
+
+/**
+ * Constructor for class, registers the RIB for snapshots
+ *
+ * \param [in] peer_hash    Peer hash ID
+ * \param [in] peer_addr    Printed form of the peer address
+ * \param [in] router_addr  Printed form of the router address
+ * \param [in] suppress     True if duplicate announcements are reported by announce()
+ */
+AdjRibIn::AdjRibIn(const u_char *peer_hash, const char *peer_addr, const char *router_addr, bool suppress) {
+    memcpy(this->peer_hash, peer_hash, sizeof(this->peer_hash));
+    this->suppress = suppress;
+    this->peer_addr = peer_addr;
+    this->router_addr = router_addr;
+
+    duplicates = 0;
+    enriched = 0;
+
+    root[0] = root[1] = NULL;
+    routes = 0;
+
+    free_nodes = NULL;
+    free_routes = NULL;
+
+    epoch = 0;
+    mbus = NULL;
+    publishing = 0;
+    bzero(&peer, sizeof(peer));
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    id = next_id++;
+    registry.push_back(this);
+}
+
+AdjRibIn::~AdjRibIn() {
+    {
+        // A resync chunk is published without the locks, the message bus is in use until done
+        std::unique_lock<std::mutex> lock(registry_mutex);
+        while (publishing > 0)
+            registry_cond.wait(lock);
+
+        registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+    }
+
+    for (size_t i = 0; i < node_blocks.size(); i++)
+        delete [] node_blocks[i];
+
+    for (size_t i = 0; i < route_blocks.size(); i++)
+        delete [] route_blocks[i];
+
+    for (size_t i = 0; i < attrs.size(); i++)
+        delete attrs[i].attr;
+}
+
+/**
+ * Set the message bus and peer the routes are published to on a resync
+ *
+ * \param [in] mbus         Message bus of the router, must outlive the RIB
+ * \param [in] peer         Peer the routes are published for
+ */
+void AdjRibIn::setPublisher(MsgBusInterface *mbus, const MsgBusInterface::obj_bgp_peer &peer) {
+    this->mbus = mbus;
+    memcpy(&this->peer, &peer, sizeof(this->peer));
+}
+
+/**
+ * Add or replace a route
+ *
+ * \param [in] isIPv4       True if IPv4, false if IPv6
+ * \param [in] prefix       Prefix in binary form, zero filled past len
+ * \param [in] len          Length of the prefix in bits
+ * \param [in] path_id      Add path ID, zero if not used
+ * \param [in] path_hash    Path attribute hash ID of the route
+ * \param [in] attr         Path attributes of the route, kept if there is a publisher
+ *
+ * \return true if the route is new or changed (or duplicates are not suppressed),
+ *         false if it is an exact duplicate
+ */
+bool AdjRibIn::announce(bool isIPv4, const uint8_t *prefix, uint8_t len, uint32_t path_id, const u_char *path_hash,
+                        const MsgBusInterface::obj_path_attr *attr) {
+    Node **link = &root[isIPv4 ? 1 : 0];
+    Node *node;
+    bool found = false;
+
+    if (len > (isIPv4 ? 32 : 128))
+        return true;
+
+    while ((node = *link) != NULL) {
+        if (node->len > len or not prefixMatch(node->prefix, prefix, node->len))
+            break;
+
+        if (node->len == len) {
+            found = true;
+            break;
+        }
+
+        link = &node->child[bitAt(prefix, node->len)];
+    }
+
+    if (not found) {
+        Node *leaf = allocNode(prefix, len);
+
+        if (node != NULL) {
+            int common = commonLen(node->prefix, prefix, node->len < len ? node->len : len);
+
+            if (common == len) {
+                // New prefix covers the node
+                leaf->child[bitAt(node->prefix, len)] = node;
+
+            } else {
+                // Prefixes diverge, branch where they do
+                Node *branch = allocNode(prefix, common);
+                branch->child[bitAt(node->prefix, common)] = node;
+                branch->child[bitAt(prefix, common)] = leaf;
+                *link = branch;
+                link = NULL;
+            }
+        }
+
+        if (link != NULL)
+            *link = leaf;
+
+        node = leaf;
+    }
+
+    for (Route *route = node->routes; route != NULL; route = route->next) {
+        if (route->path_id != path_id)
+            continue;
+
+        if (not hashIsZero(path_hash) and memcmp(attrs[route->attr].hash, path_hash, 16) == 0) {
+            duplicates++;
+            return not suppress;
+        }
+
+        uint32_t idx = refAttr(path_hash, attr);
+        unrefAttr(route->attr);
+        route->attr = idx;
+
+        return true;
+    }
+
+    Route *route = allocRoute();
+    route->path_id = path_id;
+    route->attr = refAttr(path_hash, attr);
+    route->next = node->routes;
+    node->routes = route;
+    routes++;
+
+    return true;
+}
+
+/**
+ * Remove a route
+ *
+ * \param [in]  isIPv4      True if IPv4, false if IPv6
+ * \param [in]  prefix      Prefix in binary form, zero filled past len
+ * \param [in]  len         Length of the prefix in bits
+ * \param [in]  path_id     Add path ID, zero if not used
+ * \param [out] path_hash   Path hash of the removed route, zero if not found
+ *
+ * \return true if the route was found
+ */
+bool AdjRibIn::withdraw(bool isIPv4, const uint8_t *prefix, uint8_t len, uint32_t path_id, u_char *path_hash) {
+    Node **link = &root[isIPv4 ? 1 : 0];
+    Node **parent_link = NULL;
+    Node *node;
+
+    while ((node = *link) != NULL and node->len < len and prefixMatch(node->prefix, prefix, node->len)) {
+        parent_link = link;
+        link = &node->child[bitAt(prefix, node->len)];
+    }
+
+    Route **route_link = NULL;
+
+    if (node != NULL and node->len == len and prefixMatch(node->prefix, prefix, len)) {
+        for (route_link = &node->routes; *route_link != NULL; route_link = &(*route_link)->next) {
+            if ((*route_link)->path_id == path_id)
+                break;
+        }
+    }
+
+    if (route_link == NULL or *route_link == NULL) {
+        bzero(path_hash, 16);
+        return false;
+    }
+
+    Route *route = *route_link;
+    memcpy(path_hash, attrs[route->attr].hash, 16);
+
+    if (not hashIsZero(path_hash))
+        enriched++;
+
+    unrefAttr(route->attr);
+    *route_link = route->next;
+    freeRoute(route);
+    routes--;
+
+    // Remove the node if it's no longer a prefix or a branch
+    if (node->routes == NULL and (node->child[0] == NULL or node->child[1] == NULL)) {
+        Node *child = node->child[0] != NULL ? node->child[0] : node->child[1];
+        *link = child;
+        freeNode(node);
+
+        // A branch left with one child is not needed either
+        if (child == NULL and parent_link != NULL and (*parent_link)->routes == NULL) {
+            Node *parent = *parent_link;
+            *parent_link = parent->child[0] != NULL ? parent->child[0] : parent->child[1];
+            freeNode(parent);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Remove all routes, counters are not reset
+ */
+void AdjRibIn::clear() {
+    std::vector<Node *> stack;
+
+    for (int i = 0; i < 2; i++) {
+        if (root[i] != NULL)
+            stack.push_back(root[i]);
+        root[i] = NULL;
+    }
+
+    while (not stack.empty()) {
+        Node *node = stack.back();
+        stack.pop_back();
+
+        for (int i = 0; i < 2; i++) {
+            if (node->child[i] != NULL)
+                stack.push_back(node->child[i]);
+        }
+
+        while (node->routes != NULL) {
+            Route *route = node->routes;
+            node->routes = route->next;
+            freeRoute(route);
+        }
+
+        freeNode(node);
+    }
+
+    routes = 0;
+    epoch++;
+
+    for (size_t i = 0; i < attrs.size(); i++)
+        delete attrs[i].attr;
+
+    attrs.clear();
+    free_attrs.clear();
+    attr_index.clear();
+}
+
+/**
+ * Approximate memory used in bytes
+ */
+size_t AdjRibIn::memory() {
+    size_t size = node_blocks.size() * ADJ_RIB_POOL_BLOCK * sizeof(Node)
+                  + route_blocks.size() * ADJ_RIB_POOL_BLOCK * sizeof(Route)
+                  + attrs.capacity() * sizeof(Attr)
+                  + attr_index.size() * (sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(void *));
+
+    for (size_t i = 0; i < attrs.size(); i++) {
+        if (attrs[i].attr != NULL)
+            size += sizeof(MsgBusInterface::obj_path_attr) + attrs[i].attr->as_path.size()
+                    + attrs[i].attr->community_list.size() + attrs[i].attr->ext_community_list.size()
+                    + attrs[i].attr->large_community_list.size() + attrs[i].attr->cluster_list.size();
+    }
+
+    return size;
+}
+
+/**
+ * Render a snapshot of a peer's RIB, or the list of RIBs
+ *
+ * \param [in]  peer_hash   Peer hash ID in printed form, NULL or empty to list the RIBs
+ * \param [out] out         Rendered text is appended
+ *
+ * \return false if there is no RIB for peer_hash
+ */
+bool AdjRibIn::renderSnapshot(const char *peer_hash, std::string &out) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    char hash_str[33];
+    char buf[256];
+
+    for (size_t i = 0; i < registry.size(); i++) {
+        AdjRibIn *rib = registry[i];
+        hashStr(rib->peer_hash, hash_str);
+
+        if (peer_hash == NULL or peer_hash[0] == 0) {
+            std::lock_guard<std::mutex> rib_lock(rib->mutex);
+
+            snprintf(buf, sizeof(buf), "%s\t%s\t%s\t%zu\n", hash_str, rib->peer_addr.c_str(),
+                     rib->router_addr.c_str(), rib->routes);
+            out.append(buf);
+
+        } else if (strcmp(hash_str, peer_hash) == 0) {
+            std::lock_guard<std::mutex> rib_lock(rib->mutex);
+
+            rib->renderNode(rib->root[1], true, out);
+            rib->renderNode(rib->root[0], false, out);
+            return true;
+        }
+    }
+
+    return peer_hash == NULL or peer_hash[0] == 0;
+}
+
+/**
+ * Render the routes of a node and its children
+ */
+void AdjRibIn::renderNode(Node *node, bool isIPv4, std::string &out) {
+    char prefix[46];
+    char hash_str[33];
+    char buf[128];
+
+    if (node == NULL)
+        return;
+
+    if (node->routes != NULL) {
+        bgp::formatIp(isIPv4, node->prefix, prefix);
+
+        for (Route *route = node->routes; route != NULL; route = route->next) {
+            hashStr(attrs[route->attr].hash, hash_str);
+            snprintf(buf, sizeof(buf), "%s\t%d\t%" PRIu32 "\t%s\n", prefix, node->len, route->path_id, hash_str);
+            out.append(buf);
+        }
+    }
+
+    renderNode(node->child[0], isIPv4, out);
+    renderNode(node->child[1], isIPv4, out);
+}
+
+/**
+ * Find a route
+ *
+ * \return Route, or NULL if not found
+ */
+AdjRibIn::Route *AdjRibIn::findRoute(bool isIPv4, const uint8_t *prefix, uint8_t len, uint32_t path_id) {
+    Node *node = root[isIPv4 ? 1 : 0];
+
+    while (node != NULL and node->len < len and prefixMatch(node->prefix, prefix, node->len))
+        node = node->child[bitAt(prefix, node->len)];
+
+    if (node == NULL or node->len != len or not prefixMatch(node->prefix, prefix, len))
+        return NULL;
+
+    for (Route *route = node->routes; route != NULL; route = route->next) {
+        if (route->path_id == path_id)
+            return route;
+    }
+
+    return NULL;
+}
+
+/**
+ * Copy the routes of a node and its children
+ */
+void AdjRibIn::snapshot(Node *node, bool isIPv4, std::vector<RouteRef> &out) {
+    RouteRef ref;
+
+    if (node == NULL)
+        return;
+
+    for (Route *route = node->routes; route != NULL; route = route->next) {
+        memcpy(ref.hash, attrs[route->attr].hash, sizeof(ref.hash));
+        memcpy(ref.prefix, node->prefix, sizeof(ref.prefix));
+        ref.len = node->len;
+        ref.isIPv4 = isIPv4;
+        ref.path_id = route->path_id;
+        out.push_back(ref);
+    }
+
+    snapshot(node->child[0], isIPv4, out);
+    snapshot(node->child[1], isIPv4, out);
+}
+
+/**
+ * Find a registered RIB, registry_mutex must be locked
+ *
+ * \return RIB, or NULL if it is no longer registered
+ */
+AdjRibIn *AdjRibIn::lookup(uint64_t id) {
+    for (size_t i = 0; i < registry.size(); i++) {
+        if (registry[i]->id == id)
+            return registry[i];
+    }
+
+    return NULL;
+}
+
+AdjRibIn::Node *AdjRibIn::allocNode(const uint8_t *prefix, uint8_t len) {
+    if (free_nodes == NULL) {
+        Node *block = new Node[ADJ_RIB_POOL_BLOCK];
+        node_blocks.push_back(block);
+
+        for (int i = 0; i < ADJ_RIB_POOL_BLOCK; i++)
+            freeNode(&block[i]);
+    }
+
+    Node *node = free_nodes;
+    free_nodes = node->child[0];
+
+    node->child[0] = node->child[1] = NULL;
+    node->routes = NULL;
+    node->len = len;
+
+    // Bits past len are zero so that nodes compare by whole bytes
+    bzero(node->prefix, sizeof(node->prefix));
+    memcpy(node->prefix, prefix, (len + 7) / 8);
+    if (len % 8)
+        node->prefix[len / 8] &= 0xff << (8 - len % 8);
+
+    return node;
+}
+
+void AdjRibIn::freeNode(Node *node) {
+    node->child[0] = free_nodes;
+    free_nodes = node;
+}
+
+AdjRibIn::Route *AdjRibIn::allocRoute() {
+    if (free_routes == NULL) {
+        Route *block = new Route[ADJ_RIB_POOL_BLOCK];
+        route_blocks.push_back(block);
+
+        for (int i = 0; i < ADJ_RIB_POOL_BLOCK; i++)
+            freeRoute(&block[i]);
+    }
+
+    Route *route = free_routes;
+    free_routes = route->next;
+
+    return route;
+}
+
+void AdjRibIn::freeRoute(Route *route) {
+    route->next = free_routes;
+    free_routes = route;
+}
+
+/**
+ * Add a reference to a path hash
+ *
+ * \param [in] hash     Path hash ID
+ * \param [in] attr     Path attributes, kept if there is a publisher and the hash is known
+ *
+ * \return Index of the path hash in attrs
+ */
+uint32_t AdjRibIn::refAttr(const u_char *hash, const MsgBusInterface::obj_path_attr *attr) {
+    uint64_t key;
+    memcpy(&key, hash, sizeof(key));
+
+    // A zero hash isn't the hash of the attributes, they can't be kept
+    if (mbus == NULL or hashIsZero(hash))
+        attr = NULL;
+
+    std::unordered_map<uint64_t, uint32_t>::iterator it = attr_index.find(key);
+    if (it != attr_index.end() and memcmp(attrs[it->second].hash, hash, 16) == 0) {
+        Attr &entry = attrs[it->second];
+        entry.refs++;
+
+        if (entry.attr == NULL and attr != NULL)
+            entry.attr = new MsgBusInterface::obj_path_attr(*attr);
+
+        return it->second;
+    }
+
+    uint32_t idx;
+    if (not free_attrs.empty()) {
+        idx = free_attrs.back();
+        free_attrs.pop_back();
+
+    } else {
+        idx = attrs.size();
+        attrs.push_back(Attr());
+    }
+
+    memcpy(attrs[idx].hash, hash, 16);
+    attrs[idx].refs = 1;
+    attrs[idx].attr = attr != NULL ? new MsgBusInterface::obj_path_attr(*attr) : NULL;
+
+    // A hash colliding in the first 8 bytes isn't indexed, it's stored once per route
+    if (it == attr_index.end())
+        attr_index[key] = idx;
+
+    return idx;
+}
+
+/**
+ * Remove a reference to a path hash, the entry is freed when not used
+ */
+void AdjRibIn::unrefAttr(uint32_t idx) {
+    if (--attrs[idx].refs > 0)
+        return;
+
+    uint64_t key;
+    memcpy(&key, attrs[idx].hash, sizeof(key));
+
+    std::unordered_map<uint64_t, uint32_t>::iterator it = attr_index.find(key);
+    if (it != attr_index.end() and it->second == idx)
+        attr_index.erase(it);
+
+    delete attrs[idx].attr;
+    attrs[idx].attr = NULL;
+
+    free_attrs.push_back(idx);
+}
+
+} /* namespace bgp_msg */
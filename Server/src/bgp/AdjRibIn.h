@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ADJRIBIN_H_
+#define ADJRIBIN_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+#include "MsgBusInterface.hpp"
+
+namespace bgp_msg {
+
+#define ADJ_RIB_POOL_BLOCK      1024            ///< Number of nodes/routes allocated at a time
+
+/**
+ * \class   AdjRibIn
+ *
+ * \brief   Per peer Adj-RIB-In of the unicast prefixes, prefix to path attribute hash
+ * \details Kept by the collector so that exact duplicate announcements (same prefix, path ID
+ *          and path hash) are not published again and withdrawals carry the path hash of the
+ *          route they remove.
+ *
+ *          Each address family is a path compressed binary trie.  Nodes and routes come from
+ *          pooled blocks and a route refers to its path hash by index into a table of the
+ *          peer's distinct path hashes, so a route costs about 64 bytes.
+ *
+ *          With a publisher set, the path attributes of each distinct path hash are kept
+ *          as well so that RibResync can publish the routes again without the router.
+ *
+ *          The prefixes are updated by the thread parsing the peer, snapshots are rendered
+ *          by the metrics server thread and resyncs by the RibResync thread; all lock mutex.
+ *          Routes are only valid for a single peer session; clear() on peer up/down.
+ */
+class AdjRibIn {
+public:
+    std::mutex  mutex;                      ///< Guards the RIB, locked by the callers of the methods below
+
+    uint64_t    duplicates;                 ///< Announcements that didn't change the route
+    uint64_t    enriched;                   ///< Withdrawals the prior path hash was found for
+
+    /**
+     * Constructor for class, registers the RIB for snapshots
+     *
+     * \param [in] peer_hash    Peer hash ID
+     * \param [in] peer_addr    Printed form of the peer address
+     * \param [in] router_addr  Printed form of the router address
+     * \param [in] suppress     True if duplicate announcements are reported by announce()
+     */
+    AdjRibIn(const u_char *peer_hash, const char *peer_addr, const char *router_addr, bool suppress=true);
+    ~AdjRibIn();
+
+    /**
+     * Set the message bus and peer the routes are published to on a resync
+     *
+     * \details Once set, the path attributes given to announce() are kept.
+     *
+     * \param [in] mbus         Message bus of the router, must outlive the RIB, the
+     *                          destructor waits for resync chunks still being published
+     * \param [in] peer         Peer the routes are published for
+     */
+    void setPublisher(MsgBusInterface *mbus, const MsgBusInterface::obj_bgp_peer &peer);
+
+    /**
+     * Add or replace a route
+     *
+     * \details A zero path hash is stored but never treated as a duplicate, it is not known.
+     *
+     * \param [in] isIPv4       True if IPv4, false if IPv6
+     * \param [in] prefix       Prefix in binary form, zero filled past len
+     * \param [in] len          Length of the prefix in bits
+     * \param [in] path_id      Add path ID, zero if not used
+     * \param [in] path_hash    Path attribute hash ID of the route
+     * \param [in] attr         Path attributes of the route, kept if there is a publisher
+     *
+     * \return true if the route is new or changed (or duplicates are not suppressed),
+     *         false if it is an exact duplicate
+     */
+    bool announce(bool isIPv4, const uint8_t *prefix, uint8_t len, uint32_t path_id, const u_char *path_hash,
+                  const MsgBusInterface::obj_path_attr *attr=NULL);
+
+    /**
+     * Remove a route
+     *
+     * \param [in]  isIPv4      True if IPv4, false if IPv6
+     * \param [in]  prefix      Prefix in binary form, zero filled past len
+     * \param [in]  len         Length of the prefix in bits
+     * \param [in]  path_id     Add path ID, zero if not used
+     * \param [out] path_hash   Path hash of the removed route, zero if not found
+     *
+     * \return true if the route was found
+     */
+    bool withdraw(bool isIPv4, const uint8_t *prefix, uint8_t len, uint32_t path_id, u_char *path_hash);
+
+    /**
+     * Remove all routes, counters are not reset
+     */
+    void clear();
+
+    /**
+     * Number of routes
+     */
+    size_t size() { return routes; }
+
+    /**
+     * Approximate memory used in bytes
+     */
+    size_t memory();
+
+    /**
+     * Render a snapshot of a peer's RIB, or the list of RIBs
+     *
+     * \details The snapshot has a line per route: prefix, prefix length, path ID and the
+     *          path hash, tab separated.  The list has a line per RIB: peer hash, peer
+     *          address, router address and number of routes.
+     *
+     * \param [in]  peer_hash   Peer hash ID in printed form, NULL or empty to list the RIBs
+     * \param [out] out         Rendered text is appended
+     *
+     * \return false if there is no RIB for peer_hash
+     */
+    static bool renderSnapshot(const char *peer_hash, std::string &out);
+
+private:
+    friend class RibResync;
+
+    /**
+     * Route of a prefix, one per path ID
+     */
+    struct Route {
+        Route       *next;                  ///< Next route of the prefix (add path)
+        uint32_t    path_id;                ///< Add path ID
+        uint32_t    attr;                   ///< Index of the path hash in attrs
+    };
+
+    /**
+     * Trie node, a prefix with routes or a branch without
+     */
+    struct Node {
+        Node        *child[2];              ///< Longer prefixes by the bit after len
+        Route       *routes;                ///< Routes of the prefix, NULL for a branch
+        uint8_t     len;                    ///< Prefix length in bits
+        uint8_t     prefix[16];             ///< Prefix, zero filled past len
+    };
+
+    /**
+     * Distinct path hash with the number of routes using it
+     */
+    struct Attr {
+        u_char      hash[16];               ///< Path hash ID
+        uint32_t    refs;                   ///< Number of routes, 0 if free
+        MsgBusInterface::obj_path_attr *attr;   ///< Path attributes, NULL if not kept
+    };
+
+    /**
+     * Route copied out of the RIB by snapshot()
+     */
+    struct RouteRef {
+        u_char      hash[16];               ///< Path hash ID
+        uint8_t     prefix[16];             ///< Prefix, zero filled past len
+        uint8_t     len;                    ///< Prefix length in bits
+        bool        isIPv4;                 ///< True if IPv4, false if IPv6
+        uint32_t    path_id;                ///< Add path ID
+    };
+
+    uint64_t        id;                     ///< Unique ID of the RIB, pointers may be reused
+    uint64_t        epoch;                  ///< Incremented by clear()
+    u_char          peer_hash[16];          ///< Peer hash ID
+    bool            suppress;               ///< True if duplicates are reported
+    MsgBusInterface *mbus;                  ///< Message bus resyncs are published to, NULL if not set
+    uint32_t        publishing;             ///< Resync chunks being published, guarded by registry_mutex
+    MsgBusInterface::obj_bgp_peer peer;     ///< Peer resyncs are published for
+    std::string     peer_addr;              ///< Printed form of the peer address
+    std::string     router_addr;            ///< Printed form of the router address
+
+    Node            *root[2];               ///< Trie of each family, 0 is IPv6 and 1 is IPv4
+    size_t          routes;                 ///< Number of routes
+
+    std::vector<Attr>       attrs;          ///< Path hashes of the routes
+    std::vector<uint32_t>   free_attrs;     ///< Free entries in attrs
+    std::unordered_map<uint64_t, uint32_t> attr_index;     ///< Path hash (first 8 bytes) to attrs entry
+
+    std::vector<Node *>     node_blocks;    ///< Allocated node blocks
+    std::vector<Route *>    route_blocks;   ///< Allocated route blocks
+    Node            *free_nodes;            ///< Free nodes, linked by child[0]
+    Route           *free_routes;           ///< Free routes, linked by next
+
+    static std::mutex               registry_mutex;     ///< Guards registry
+    static std::condition_variable  registry_cond;      ///< Signaled when a RIB is no longer publishing
+    static std::vector<AdjRibIn *>  registry;           ///< RIBs of the connected peers
+    static uint64_t                 next_id;            ///< ID of the next RIB, guarded by registry_mutex
+
+    Node *allocNode(const uint8_t *prefix, uint8_t len);
+    void freeNode(Node *node);
+    Route *allocRoute();
+    void freeRoute(Route *route);
+
+    /**
+     * Add a reference to a path hash
+     *
+     * \return Index of the path hash in attrs
+     */
+    uint32_t refAttr(const u_char *hash, const MsgBusInterface::obj_path_attr *attr);
+
+    /**
+     * Remove a reference to a path hash, the entry is freed when not used
+     */
+    void unrefAttr(uint32_t idx);
+
+    /**
+     * Render the routes of a node and its children
+     */
+    void renderNode(Node *node, bool isIPv4, std::string &out);
+
+    /**
+     * Find a route
+     *
+     * \return Route, or NULL if not found
+     */
+    Route *findRoute(bool isIPv4, const uint8_t *prefix, uint8_t len, uint32_t path_id);
+
+    /**
+     * Copy the routes of a node and its children
+     */
+    void snapshot(Node *node, bool isIPv4, std::vector<RouteRef> &out);
+
+    /**
+     * Find a registered RIB, registry_mutex must be locked
+     *
+     * \return RIB, or NULL if it is no longer registered
+     */
+    static AdjRibIn *lookup(uint64_t id);
+
+    /**
+     * Print a hash ID in hex
+     *
+     * \param [in]  hash    16 byte hash ID
+     * \param [out] buf     At least 33 bytes
+     */
+    static void hashStr(const u_char *hash, char *buf);
+};
+
+} /* namespace bgp_msg */
+
+#endif /* ADJRIBIN_H_ */
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <arpa/inet.h>
+#include <cstring>
+
+#include "CommunityKernel.h"
+
+namespace bgp {
+
+    /**
+     * Number of 32 bit words converted and printed per pass
+     */
+    #define COMMUNITY_CHUNK_WORDS   96
+
+    /**
+     * Two digit decimal strings for 00 to 99
+     */
+    static const char digit_pairs[201] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+    /**
+     * Print an unsigned 32 bit value in decimal
+     *
+     * \param [in]   value      Value to print
+     * \param [out]  buf        Buffer of at least 10 bytes, not null terminated
+     *
+     * \return Length of the printed value
+     */
+    size_t formatUint(uint32_t value, char *buf) {
+        char    tmp[10];
+        char    *p = tmp + sizeof(tmp);
+        size_t  len;
+
+        // Two digits per division, written from the right
+        while (value >= 100) {
+            uint32_t pair = (value % 100) * 2;
+            value /= 100;
+
+            *--p = digit_pairs[pair + 1];
+            *--p = digit_pairs[pair];
+        }
+
+        if (value >= 10) {
+            *--p = digit_pairs[value * 2 + 1];
+            *--p = digit_pairs[value * 2];
+        } else
+            *--p = '0' + value;
+
+        len = tmp + sizeof(tmp) - p;
+        memcpy(buf, p, len);
+
+        return len;
+    }
+
+    /**
+     * Convert words from network to host byte order
+     *
+     * \details Plain loop over a fixed size array so the compiler vectorizes the byte swap.
+     *
+     * \param [in]   data       Pointer to the words in network byte order, need not be aligned
+     * \param [in]   count      Number of words, at most COMMUNITY_CHUNK_WORDS
+     * \param [out]  words      Words in host byte order
+     */
+    static void swapWords(const u_char *data, size_t count, uint32_t *words) {
+        memcpy(words, data, count * 4);
+
+        for (size_t i = 0; i < count; i++)
+            words[i] = ntohl(words[i]);
+    }
+
+    /**
+     * Decode a COMMUNITIES attribute (RFC1997)
+     *
+     * \details Communities are printed as {high}:{low} separated by a space.  Trailing bytes
+     *          that are not a full community are ignored.
+     *
+     * \param [in]   data       Pointer to the attribute value
+     * \param [in]   len        Length of the attribute value in bytes
+     * \param [out]  out        Printed communities, replaces the current value
+     */
+    void decodeCommunities(const u_char *data, size_t len, std::string &out) {
+        uint32_t    words[COMMUNITY_CHUNK_WORDS];
+        char        buf[COMMUNITY_CHUNK_WORDS * 12];        // "65535:65535 " per community
+        size_t      count = len / 4;
+        size_t      n;
+        char        *p;
+
+        out.clear();
+        out.reserve(count * 12);
+
+        while (count > 0) {
+            n = count < COMMUNITY_CHUNK_WORDS ? count : COMMUNITY_CHUNK_WORDS;
+            swapWords(data, n, words);
+
+            p = buf;
+            for (size_t i = 0; i < n; i++) {
+                *p++ = ' ';
+                p += formatUint(words[i] >> 16, p);
+                *p++ = ':';
+                p += formatUint(words[i] & 0xFFFF, p);
+            }
+
+            // Skip the leading space of the first community
+            if (out.empty())
+                out.append(buf + 1, p - buf - 1);
+            else
+                out.append(buf, p - buf);
+
+            data += n * 4;
+            count -= n;
+        }
+    }
+
+    /**
+     * Decode a LARGE_COMMUNITY attribute (RFC8092)
+     *
+     * \details Large communities are printed as {global admin}:{local 1}:{local 2} separated
+     *          by a space.  Trailing bytes that are not a full community are ignored.
+     *
+     * \param [in]   data       Pointer to the attribute value
+     * \param [in]   len        Length of the attribute value in bytes
+     * \param [out]  out        Printed large communities, replaces the current value
+     */
+    void decodeLargeCommunities(const u_char *data, size_t len, std::string &out) {
+        uint32_t    words[COMMUNITY_CHUNK_WORDS];
+        char        buf[COMMUNITY_CHUNK_WORDS * 11];        // 3 words of "4294967295:" per community
+        size_t      count = len / 12;
+        size_t      n;
+        char        *p;
+
+        out.clear();
+        out.reserve(count * 24);
+
+        while (count > 0) {
+            n = count < COMMUNITY_CHUNK_WORDS / 3 ? count : COMMUNITY_CHUNK_WORDS / 3;
+            swapWords(data, n * 3, words);
+
+            p = buf;
+            for (size_t i = 0; i < n * 3; i += 3) {
+                *p++ = ' ';
+                p += formatUint(words[i], p);
+                *p++ = ':';
+                p += formatUint(words[i + 1], p);
+                *p++ = ':';
+                p += formatUint(words[i + 2], p);
+            }
+
+            if (out.empty())
+                out.append(buf + 1, p - buf - 1);
+            else
+                out.append(buf, p - buf);
+
+            data += n * 12;
+            count -= n;
+        }
+    }
+
+} /* namespace bgp */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef COMMUNITYKERNEL_H_
+#define COMMUNITYKERNEL_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
+
+namespace bgp {
+
+    /**
+     * Print an unsigned 32 bit value in decimal
+     *
+     * \param [in]   value      Value to print
+     * \param [out]  buf        Buffer of at least 10 bytes, not null terminated
+     *
+     * \return Length of the printed value
+     */
+    size_t formatUint(uint32_t value, char *buf);
+
+    /**
+     * Decode a COMMUNITIES attribute (RFC1997)
+     *
+     * \details Communities are printed as {high}:{low} separated by a space.  Trailing bytes
+     *          that are not a full community are ignored.
+     *
+     * \param [in]   data       Pointer to the attribute value
+     * \param [in]   len        Length of the attribute value in bytes
+     * \param [out]  out        Printed communities, replaces the current value
+     */
+    void decodeCommunities(const u_char *data, size_t len, std::string &out);
+
+    /**
+     * Decode a LARGE_COMMUNITY attribute (RFC8092)
+     *
+     * \details Large communities are printed as {global admin}:{local 1}:{local 2} separated
+     *          by a space.  Trailing bytes that are not a full community are ignored.
+     *
+     * \param [in]   data       Pointer to the attribute value
+     * \param [in]   len        Length of the attribute value in bytes
+     * \param [out]  out        Printed large communities, replaces the current value
+     */
+    void decodeLargeCommunities(const u_char *data, size_t len, std::string &out);
+
+} /* namespace bgp */
+
+#endif /* COMMUNITYKERNEL_H_ */
@@ -17,6 +17,55 @@
 #include "ExtCommunity.h"
 
 namespace bgp_msg {
+    /**
+     * Decoders of the types 0 - 8, see EXT_COMM_TYPES
+     */
+    const ExtCommunity::type_decoder ExtCommunity::transitive_decoders[EXT_TYPE_FLOW_SPEC + 1] = {
+        { &ExtCommunity::decodeType_common, false, false },     // EXT_TYPE_2OCTET_AS
+        { &ExtCommunity::decodeType_common, true,  true  },     // EXT_TYPE_IPV4
+        { &ExtCommunity::decodeType_common, true,  false },     // EXT_TYPE_4OCTET_AS
+        { &ExtCommunity::decodeType_Opaque, false, false },     // EXT_TYPE_OPAQUE
+        { NULL, false, false },                                 // EXT_TYPE_QOS_MARK - TODO: Implement
+        { NULL, false, false },                                 // EXT_TYPE_COS_CAP - TODO: Implement
+        { &ExtCommunity::decodeType_EVPN, false, false },       // EXT_TYPE_EVPN
+        { NULL, false, false },
+        { NULL, false, false }                                  // EXT_TYPE_FLOW_SPEC - TODO: Implement
+    };
+
+    /**
+     * Decoders of the types 0x80 - 0x82, see EXT_COMM_TYPES
+     */
+    const ExtCommunity::type_decoder ExtCommunity::generic_decoders[EXT_TYPE_GENERIC_4OCTET_AS - EXT_TYPE_GENERIC + 1] = {
+        { &ExtCommunity::decodeType_Generic, false, false },    // EXT_TYPE_GENERIC
+        { &ExtCommunity::decodeType_Generic, true,  true  },    // EXT_TYPE_GENERIC_IPV4
+        { &ExtCommunity::decodeType_Generic, true,  false }     // EXT_TYPE_GENERIC_4OCTET_AS
+    };
+
+    /**
+     * Common subtypes 0 - 0x12, see EXT_COMM_SUBTYPE_IPV4
+     */
+    const ExtCommunity::common_subtype ExtCommunity::common_subtypes[EXT_COMMON_IA_P2MP_SEG_NH + 1] = {
+        { NULL, false, false, false },
+        { NULL, false, false, false },
+        { "rt", false, false, false },                          // EXT_COMMON_ROUTE_TARGET
+        { "soo", false, false, false },                         // EXT_COMMON_ROUTE_ORIGIN
+        { "link-bw", false, true, false },                      // EXT_COMMON_LINK_BANDWIDTH (same as EXT_COMMON_GENERIC)
+        { "ospf-did", false, false, false },                    // EXT_COMMON_OSPF_DOM_ID
+        { NULL, false, false, false },
+        { "ospf-rid", false, false, false },                    // EXT_COMMON_OSPF_ROUTER_ID
+        { "colc", false, true, false },                         // EXT_COMMON_BGP_DATA_COL
+        { "sas", false, true, false },                          // EXT_COMMON_SOURCE_AS
+        { "vpn-id", true, false, false },                       // EXT_COMMON_L2VPN_ID
+        { "import", false, false, true },                       // EXT_COMMON_VRF_IMPORT
+        { NULL, false, false, false },
+        { NULL, false, false, false },
+        { NULL, false, false, false },
+        { NULL, false, false, false },
+        { "vpn-id", true, false, false },                       // EXT_COMMON_CISCO_VPN_ID
+        { NULL, false, false, false },
+        { "p2mp-nh", false, false, true }                       // EXT_COMMON_IA_P2MP_SEG_NH
+    };
+
     /**
      * Constructor for class
      *
@@ -25,11 +74,13 @@ namespace bgp_msg {
      * \param [in]     logPtr       Pointer to existing Logger for app logging
      * \param [in]     pperAddr     Printed form of peer address used for logging
      * \param [in]     enable_debug Debug true to enable, false to disable
+     * \param [in]     cache        Rendered community cache of the peer, NULL to not cache
      */
-    ExtCommunity::ExtCommunity(Logger *logPtr, std::string peerAddr, bool enable_debug) {
+    ExtCommunity::ExtCommunity(Logger *logPtr, const char *peerAddr, bool enable_debug, ExtCommCache *cache) {
         logger = logPtr;
         debug = enable_debug;
         peer_addr = peerAddr;
+        this->cache = cache;
     }
 
     ExtCommunity::~ExtCommunity() {
@@ -51,73 +102,99 @@ namespace bgp_msg {
     void ExtCommunity::parseExtCommunities(int attr_len, u_char *data, bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
 
         std::string decodeStr = "";
-        extcomm_hdr ec_hdr;
+        std::string key;
 
         if ( (attr_len % 8) ) {
-            LOG_NOTICE("%s: Parsing extended community len=%d is invalid, expecting divisible by 8", peer_addr.c_str(), attr_len);
+            LOG_NOTICE("%s: Parsing extended community len=%d is invalid, expecting divisible by 8", peer_addr, attr_len);
             return;
         }
 
+        // Identical lists are only rendered once
+        if (cache != NULL) {
+            key.assign((char *)data, attr_len);
+
+            std::unordered_map<std::string, std::string>::iterator it = cache->lists.find(key);
+            if (it != cache->lists.end()) {
+                parsed_data.attrs.ext_community_list = it->second;
+                return;
+            }
+        }
+
+        decodeStr.reserve(attr_len * 2);
+
         /*
          * Loop through consecutive entries
          */
         for (int i = 0; i < attr_len; i += 8) {
-            // Setup extended community header
-            ec_hdr.high_type = data[0];
-            ec_hdr.low_type  = data[1];
-            ec_hdr.value     = data + 2;
+            decodeCommunity(data, decodeStr);
 
-            /*
-             * Docode the community by type
-             */
-            switch (ec_hdr.high_type << 2 >> 2) {
-                case EXT_TYPE_IPV4 :
-                    decodeStr.append(decodeType_common(ec_hdr, true, true));
-                    break;
+            // Move data pointer to next entry
+            data += 8;
+            if ((i + 8) < attr_len)
+                decodeStr.append(" ");
+        }
 
-                case EXT_TYPE_2OCTET_AS :
-                    decodeStr.append(decodeType_common(ec_hdr));
-                    break;
+        if (cache != NULL) {
+            if (cache->lists.size() >= EXT_COMM_CACHE_MAX_LISTS)
+                cache->lists.clear();
 
-                case EXT_TYPE_4OCTET_AS :
-                    decodeStr.append(decodeType_common(ec_hdr, true));
-                    break;
+            cache->lists[key] = decodeStr;
+        }
 
-                case EXT_TYPE_GENERIC :
-                    decodeStr.append(decodeType_Generic(ec_hdr));
-                    break;
+        parsed_data.attrs.ext_community_list = decodeStr;
+    }
 
-                case EXT_TYPE_GENERIC_4OCTET_AS :
-                    decodeStr.append(decodeType_Generic(ec_hdr, true));
-                    break;
+    /**
+     * Decode one 8 byte extended community and append it
+     *
+     * \param [in]   data           Pointer to the community
+     * \param [out]  out            Rendered community is appended to this string
+     */
+    void ExtCommunity::decodeCommunity(const u_char *data, std::string &out) {
+        const type_decoder  *dec = NULL;
+        extcomm_hdr         ec_hdr;
+        uint64_t            raw = 0;
+
+        if (cache != NULL) {
+            memcpy(&raw, data, 8);
+
+            std::unordered_map<uint64_t, std::string>::iterator it = cache->values.find(raw);
+            if (it != cache->values.end()) {
+                out.append(it->second);
+                return;
+            }
+        }
 
-                case EXT_TYPE_GENERIC_IPV4 :
-                    decodeStr.append(decodeType_Generic(ec_hdr, true, true));
-                    break;
+        // Setup extended community header
+        ec_hdr.high_type = data[0];
+        ec_hdr.low_type  = data[1];
+        ec_hdr.value     = (u_char *)data + 2;
 
-                case EXT_TYPE_OPAQUE :
-                    decodeStr.append(decodeType_Opaque(ec_hdr));
-                    break;
+        /*
+         * Decode the community by type
+         */
+        if (ec_hdr.high_type <= EXT_TYPE_FLOW_SPEC)
+            dec = &transitive_decoders[ec_hdr.high_type];
 
-                case EXT_TYPE_EVPN :
-                    decodeStr.append(decodeType_EVPN(ec_hdr));
-                    break;
+        else if (ec_hdr.high_type >= EXT_TYPE_GENERIC and ec_hdr.high_type <= EXT_TYPE_GENERIC_4OCTET_AS)
+            dec = &generic_decoders[ec_hdr.high_type - EXT_TYPE_GENERIC];
 
-                case EXT_TYPE_QOS_MARK  : // TODO: Implement
-                case EXT_TYPE_FLOW_SPEC : // TODO: Implement
-                case EXT_TYPE_COS_CAP   : // TODO: Implement
-                default:
-                    LOG_INFO("%s: Extended community type %d,%d is not yet supported", peer_addr.c_str(),
-                            ec_hdr.high_type, ec_hdr.low_type);
-            }
+        if (dec == NULL or dec->decode == NULL) {
+            LOG_INFO("%s: Extended community type %d,%d is not yet supported", peer_addr,
+                    ec_hdr.high_type, ec_hdr.low_type);
+            return;
+        }
 
-            // Move data pointer to next entry
-            data += 8;
-            if ((i + 8) < attr_len)
-                decodeStr.append(" ");
+        std::string value = (this->*dec->decode)(ec_hdr, dec->isGlobal4Bytes, dec->isGlobalIPv4);
+
+        if (cache != NULL) {
+            if (cache->values.size() >= EXT_COMM_CACHE_MAX_VALUES)
+                cache->values.clear();
+
+            cache->values[raw] = value;
         }
 
-        parsed_data.attrs[ATTR_TYPE_EXT_COMMUNITY] = decodeStr;
+        out.append(value);
     }
 
     /**
@@ -134,10 +211,19 @@ namespace bgp_msg {
      * \return  Decoded string value
      */
     std::string ExtCommunity::decodeType_common(const extcomm_hdr &ec_hdr, bool isGlobal4Bytes, bool isGlobalIPv4) {
-        std::stringstream   val_ss;
         uint16_t            val_16b;
         uint32_t            val_32b;
         char                ipv4_char[16] = {0};
+        char                buf[64];
+        const char          *local_fmt;
+
+        if (ec_hdr.low_type > EXT_COMMON_IA_P2MP_SEG_NH or common_subtypes[ec_hdr.low_type].name == NULL) {
+            LOG_INFO("%s: Extended community common type %d subtype = %d is not yet supported", peer_addr,
+                    ec_hdr.high_type, ec_hdr.low_type);
+            return "";
+        }
+
+        const common_subtype &subtype = common_subtypes[ec_hdr.low_type];
 
         /*
          * Decode values based on bit size
@@ -159,135 +245,30 @@ namespace bgp_msg {
             memcpy(&val_16b, ec_hdr.value, 2);
             memcpy(&val_32b, ec_hdr.value + 2, 4);
 
-            // Chagne to host order
+            // Change to host order
             bgp::SWAP_BYTES(&val_16b);
             bgp::SWAP_BYTES(&val_32b);
         }
 
         /*
-         * Decode by subtype
+         * Print as <name>=<global admin>:<local admin>, except for the published legacy forms
          */
-        switch (ec_hdr.low_type) {
-
-            case EXT_COMMON_BGP_DATA_COL :
-                if (isGlobal4Bytes)
-                    val_ss << "colc=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "colc=" << val_16b << ":" << val_32b;
-
-                break;
+        local_fmt = subtype.hex_local ? "0x%x" : "%u";
+        int len = snprintf(buf, sizeof(buf), "%s=", subtype.name);
 
-            case EXT_COMMON_ROUTE_ORIGIN :
-                if (isGlobalIPv4)
-                    val_ss << "soo=" << ipv4_char << ":" << val_16b;
+        if (isGlobalIPv4 and not subtype.ipv4_as_number)
+            len += snprintf(buf + len, sizeof(buf) - len, "%s:", ipv4_char);
 
-                else if (isGlobal4Bytes)
-                    val_ss << "soo=" << val_32b << ":" << val_16b;
+        else if (isGlobal4Bytes and not isGlobalIPv4 and subtype.as4_local_first) {
+            snprintf(buf + len, sizeof(buf) - len, "%u:%u", (uint32_t)val_16b, val_32b);
+            return buf;
 
-                else
-                    val_ss << "soo=" << val_16b << ":" << val_32b;
-                break;
+        } else
+            len += snprintf(buf + len, sizeof(buf) - len, "%u:", isGlobal4Bytes ? val_32b : (uint32_t)val_16b);
 
-            case EXT_COMMON_ROUTE_TARGET :
-                if (isGlobalIPv4)
-                    val_ss << "rt=" << ipv4_char << ":" << val_16b;
-
-                else if (isGlobal4Bytes)
-                    val_ss << "rt=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "rt=" << val_16b << ":" << val_32b;
-                break;
-
-            case EXT_COMMON_SOURCE_AS :
-                if (isGlobal4Bytes)
-                    val_ss << "sas=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "sas=" << val_16b << ":" << val_32b;
-
-                break;
-
-            case EXT_COMMON_CISCO_VPN_ID :
-                if (isGlobalIPv4)
-                    val_ss << "vpn-id=" << ipv4_char << ":0x" << std::hex << val_16b;
+        snprintf(buf + len, sizeof(buf) - len, local_fmt, isGlobal4Bytes ? (uint32_t)val_16b : val_32b);
 
-                else if (isGlobal4Bytes)
-                    val_ss << "vpn-id=" << val_32b << ":0x" << std::hex << val_16b;
-
-                else
-                    val_ss << "vpn-id=" << val_16b << ":0x" << std::hex << val_32b;
-
-                break;
-
-            case EXT_COMMON_L2VPN_ID :
-                if (isGlobalIPv4)
-                    val_ss << "vpn-id=" << ipv4_char << ":0x" << std::hex << val_16b;
-
-                else if (isGlobal4Bytes)
-                    val_ss << "vpn-id=" << val_32b << ":0x" << std::hex << val_16b;
-
-                else
-                    val_ss << "vpn-id=" << val_16b << ":0x" << std::hex << val_32b;
-
-                break;
-
-            case EXT_COMMON_LINK_BANDWIDTH : // is same as EXT_COMMON_GENERIC
-                if (isGlobal4Bytes)
-                    val_ss << "link-bw=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "link-bw=" << val_16b << ":" << val_32b;
-
-                break;
-
-            case EXT_COMMON_OSPF_DOM_ID :
-                if (isGlobalIPv4)
-                    val_ss << "ospf-did=" << ipv4_char << ":" << val_16b;
-                else if (isGlobal4Bytes)
-                    val_ss << "ospf-did=" << val_32b << ":" << val_16b;
-                else
-                    val_ss << "ospf-did=" << val_16b << ":" << val_32b;
-                break;
-
-            case EXT_COMMON_VRF_IMPORT :
-                if (isGlobalIPv4)
-                    val_ss << "import=" << ipv4_char << ":" << val_16b;
-
-                else if (isGlobalIPv4)
-                    val_ss << "import=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "import=" << val_16b << ":" << val_32b;
-
-                break;
-
-            case EXT_COMMON_IA_P2MP_SEG_NH :
-                if (isGlobalIPv4)
-                    val_ss << "p2mp-nh=" << ipv4_char << ":" << val_16b;
-
-                else
-                    val_ss << "p2mp-nh=" << val_16b << ":" << val_32b;
-
-                break;
-
-            case EXT_COMMON_OSPF_ROUTER_ID :
-                if (isGlobalIPv4)
-                    val_ss << "ospf-rid=" << ipv4_char << ":" << val_16b;
-                else if (isGlobal4Bytes)
-                    val_ss << "ospf-rid=" << val_32b << ":" << val_16b;
-                else
-                    val_ss << "ospf-rid=" << val_16b << ":" << val_32b;
-                break;
-
-            default :
-                LOG_INFO("%s: Extended community common type %d subtype = %d is not yet supported", peer_addr.c_str(),
-                        ec_hdr.high_type, ec_hdr.low_type);
-                break;
-        }
-
-        return val_ss.str();
+        return buf;
     }
 
     /**
@@ -297,10 +278,12 @@ namespace bgp_msg {
      *      Converts to human readable form.
      *
      * \param [in]   ec_hdr          Reference to the extended community header
+     * \param [in]   isGlobal4Bytes  Not used, the decoders have the same signature
+     * \param [in]   isGlobalIPv4    Not used
      *
      * \return  Decoded string value
      */
-    std::string ExtCommunity::decodeType_EVPN(const extcomm_hdr &ec_hdr) {
+    std::string ExtCommunity::decodeType_EVPN(const extcomm_hdr &ec_hdr, bool isGlobal4Bytes, bool isGlobalIPv4) {
         std::stringstream   val_ss;
         uint32_t            val_32b;
 
@@ -356,10 +339,12 @@ namespace bgp_msg {
      *      Converts to human readable form.
      *
      * \param [in]   ec_hdr          Reference to the extended community header
+     * \param [in]   isGlobal4Bytes  Not used, the decoders have the same signature
+     * \param [in]   isGlobalIPv4    Not used
      *
      * \return  Decoded string value
      */
-    std::string ExtCommunity::decodeType_Opaque(const extcomm_hdr &ec_hdr) {
+    std::string ExtCommunity::decodeType_Opaque(const extcomm_hdr &ec_hdr, bool isGlobal4Bytes, bool isGlobalIPv4) {
         std::stringstream   val_ss;
         uint16_t            val_16b;
         uint32_t            val_32b;
@@ -498,7 +483,7 @@ namespace bgp_msg {
             case EXT_GENERIC_OSPF_ROUTE_TYPE :  // deprecated
             case EXT_GENERIC_OSPF_ROUTER_ID :   // deprecated
             case EXT_GENERIC_OSPF_DOM_ID :      // deprecated
-                LOG_INFO("%s: Ignoring deprecated extended community %d/%d", peer_addr.c_str(),
+                LOG_INFO("%s: Ignoring deprecated extended community %d/%d", peer_addr,
                         ec_hdr.high_type, ec_hdr.low_type);
                 break;
 
@@ -583,10 +568,10 @@ namespace bgp_msg {
         std::string decodeStr = "";
         extcomm_hdr ec_hdr;
 
-        LOG_INFO("%s: Parsing IPv6 extended community len=%d", peer_addr.c_str(), attr_len);
+        LOG_INFO("%s: Parsing IPv6 extended community len=%d", peer_addr, attr_len);
 
         if ( (attr_len % 20) ) {
-            LOG_NOTICE("%s: Parsing IPv6 extended community len=%d is invalid, expecting divisible by 20", peer_addr.c_str(), attr_len);
+            LOG_NOTICE("%s: Parsing IPv6 extended community len=%d is invalid, expecting divisible by 20", peer_addr, attr_len);
             return;
         }
 
@@ -608,7 +593,7 @@ namespace bgp_msg {
                     break;
 
                 default :
-                    LOG_NOTICE("%s: Unexpected type for IPv6 %d,%d", peer_addr.c_str(),
+                    LOG_NOTICE("%s: Unexpected type for IPv6 %d,%d", peer_addr,
                             ec_hdr.high_type, ec_hdr.low_type);
                     break;
             }
@@ -666,7 +651,7 @@ namespace bgp_msg {
                 break;
 
             default :
-                LOG_INFO("%s: Extended community ipv6 specific type %d subtype = %d is not yet supported", peer_addr.c_str(),
+                LOG_INFO("%s: Extended community ipv6 specific type %d subtype = %d is not yet supported", peer_addr,
                         ec_hdr.high_type, ec_hdr.low_type);
                 break;
         }
@@ -16,9 +16,30 @@
 #include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
 
 namespace bgp_msg {
 
+#define EXT_COMM_CACHE_MAX_LISTS    4096        ///< Max rendered lists cached, the cache is cleared when reached
+#define EXT_COMM_CACHE_MAX_VALUES   16384       ///< Max rendered communities cached, the cache is cleared when reached
+
+/**
+ * \brief   Cache of rendered extended communities
+ * \details Route targets and whole community lists repeat across the updates of a peer.
+ *          Rendered strings are cached by their raw value, so each distinct community
+ *          and list is only rendered once.  The cache is only used by the thread parsing
+ *          the peer.
+ */
+struct ExtCommCache {
+    std::unordered_map<std::string, std::string>    lists;      ///< Rendered lists by raw attribute value
+    std::unordered_map<uint64_t, std::string>       values;     ///< Rendered communities by raw 8 byte value
+
+    void clear() {
+        lists.clear();
+        values.clear();
+    }
+};
+
 /**
  * \class   ExtCommunity
  *
@@ -158,8 +179,9 @@ public:
      * \param [in]     logPtr       Pointer to existing Logger for app logging
      * \param [in]     pperAddr     Printed form of peer address used for logging
      * \param [in]     enable_debug Debug true to enable, false to disable
+     * \param [in]     cache        Rendered community cache of the peer, NULL to not cache
      */
-    ExtCommunity(Logger *logPtr, std::string peerAddr, bool enable_debug=false);
+    ExtCommunity(Logger *logPtr, const char *peerAddr, bool enable_debug=false, ExtCommCache *cache=NULL);
     virtual ~ExtCommunity();
 		 
     /**
@@ -193,7 +215,45 @@ public:
 private:
     bool             debug;                           ///< debug flag to indicate debugging
     Logger           *logger;                         ///< Logging class pointer
-    std::string      peer_addr;                       ///< Printed form of the peer address for logging
+    const char       *peer_addr;                      ///< Printed form of the peer address for logging
+    ExtCommCache     *cache;                          ///< Rendered community cache, NULL if not caching
+
+    /**
+     * Decoder of an extended community type
+     */
+    typedef std::string (ExtCommunity::*decode_fn)(const extcomm_hdr &ec_hdr, bool isGlobal4Bytes, bool isGlobalIPv4);
+
+    /**
+     * Dispatch table entry, by high order type byte
+     */
+    struct type_decoder {
+        decode_fn   decode;                           ///< Decoder, NULL if the type is not supported
+        bool        isGlobal4Bytes;                   ///< Global admin field is 4 bytes (decoder argument)
+        bool        isGlobalIPv4;                     ///< Global admin field is an IPv4 address (decoder argument)
+    };
+
+    static const type_decoder transitive_decoders[EXT_TYPE_FLOW_SPEC + 1];          ///< Types 0 - 8
+    static const type_decoder generic_decoders[EXT_TYPE_GENERIC_4OCTET_AS - EXT_TYPE_GENERIC + 1];  ///< Types 0x80 - 0x82
+
+    /**
+     * Common subtype table entry, by subtype
+     */
+    struct common_subtype {
+        const char  *name;                            ///< Printed name, NULL if the subtype is not supported
+        bool        hex_local;                        ///< Local admin field is printed in hex
+        bool        ipv4_as_number;                   ///< IPv4 global admin is printed as its network order number
+        bool        as4_local_first;                  ///< 4-octet AS form is printed as <local>:<global>
+    };
+
+    static const common_subtype common_subtypes[EXT_COMMON_IA_P2MP_SEG_NH + 1];    ///< Subtypes 0 - 0x12
+
+    /**
+     * Decode one 8 byte extended community and append it
+     *
+     * \param [in]   data           Pointer to the community
+     * \param [out]  out            Rendered community is appended to this string
+     */
+    void decodeCommunity(const u_char *data, std::string &out);
 
     /**
      * Decode common Type/Subtypes
@@ -217,10 +277,12 @@ private:
      *      Converts to human readable form.
      *
      * \param [in]   ec_hdr          Reference to the extended community header
+     * \param [in]   isGlobal4Bytes  Not used, the decoders have the same signature
+     * \param [in]   isGlobalIPv4    Not used
      *
      * \return  Decoded string value
      */
-    std::string decodeType_EVPN(const extcomm_hdr &ec_hdr);
+    std::string decodeType_EVPN(const extcomm_hdr &ec_hdr, bool isGlobal4Bytes = false, bool isGlobalIPv4 = false);
 
     /**
      * Decode Opaque subtypes
@@ -229,10 +291,12 @@ private:
      *      Converts to human readable form.
      *
      * \param [in]   ec_hdr          Reference to the extended community header
+     * \param [in]   isGlobal4Bytes  Not used, the decoders have the same signature
+     * \param [in]   isGlobalIPv4    Not used
      *
      * \return  Decoded string value
      */
-    std::string decodeType_Opaque(const extcomm_hdr &ec_hdr);
+    std::string decodeType_Opaque(const extcomm_hdr &ec_hdr, bool isGlobal4Bytes = false, bool isGlobalIPv4 = false);
 
     /**
      * Decode Generic subtypes
@@ -11,6 +11,8 @@
 #include "MPLinkState.h"
 #include "BMPReader.h"
 #include "EVPN.h"
+#include "PrefixKernel.h"
+#include "VpnKernel.h"
 #include <typeinfo>
 
 #include <arpa/inet.h>
@@ -27,7 +29,7 @@ namespace bgp_msg {
  * \param [in]     peer_info                Persistent Peer info pointer
  * \param [in]     enable_debug             Debug true to enable, false to disable
  */
-MPReachAttr::MPReachAttr(Logger *logPtr, std::string peerAddr, BMPReader::peer_info *peer_info, bool enable_debug)
+MPReachAttr::MPReachAttr(Logger *logPtr, const char *peerAddr, BMPReader::peer_info *peer_info, bool enable_debug)
     : logger{logPtr}, peer_info{peer_info}, debug{enable_debug} {
         this->peer_addr = peerAddr;
 }
@@ -68,11 +70,11 @@ void MPReachAttr::parseReachNlriAttr(int attr_len, u_char *data, UpdateMsg::pars
      * Make sure the parsing doesn't exceed buffer
      */
     if (attr_len < 0) {
-        LOG_NOTICE("%s: MP_REACH NLRI data length is larger than attribute data length, skipping parse", peer_addr.c_str());
+        LOG_NOTICE("%s: MP_REACH NLRI data length is larger than attribute data length, skipping parse", peer_addr);
         return;
     }
 
-    SELF_DEBUG("%s: afi=%d safi=%d nh_len=%d reserved=%d", peer_addr.c_str(),
+    SELF_DEBUG("%s: afi=%d safi=%d nh_len=%d reserved=%d", peer_addr,
                 nlri.afi, nlri.safi, nlri.nh_len, nlri.reserved);
 
     /*
@@ -104,6 +106,11 @@ void MPReachAttr::parseAfi(mp_reach_nlri &nlri, UpdateMsg::parsed_update_data &p
 
         case bgp::BGP_AFI_BGPLS : // BGP-LS (draft-ietf-idr-ls-distribution-10)
         {
+            if (skipFamily(peer_info, nlri.afi, nlri.safi)) {
+                SELF_DEBUG("%s: BGP-LS outputs are disabled, skipping %d bytes of NLRI", peer_addr, nlri.nlri_len);
+                break;
+            }
+
             MPLinkState ls(logger, peer_addr, &parsed_data, debug);
             ls.parseReachLinkState(nlri);
 
@@ -125,7 +132,10 @@ void MPReachAttr::parseAfi(mp_reach_nlri &nlri, UpdateMsg::parsed_update_data &p
 
             inet_ntop(nlri.nh_len == 4 ? AF_INET : AF_INET6, ip_raw, ip_char, sizeof(ip_char));
 
-            parsed_data.attrs[ATTR_TYPE_NEXT_HOP] = std::string(ip_char);
+            parsed_data.attrs.setNextHop(ip_char);
+
+            if (skipFamily(peer_info, nlri.afi, nlri.safi))
+                break;
 
             // parse by safi
             switch (nlri.safi) {
@@ -138,14 +148,14 @@ void MPReachAttr::parseAfi(mp_reach_nlri &nlri, UpdateMsg::parsed_update_data &p
 
                 default :
                     LOG_INFO("%s: EVPN::parse SAFI=%d is not implemented yet, skipping",
-                             peer_addr.c_str(), nlri.safi);
+                             peer_addr, nlri.safi);
             }
 
             break;
         }
 
         default : // Unknown
-            LOG_INFO("%s: MP_REACH AFI=%d is not implemented yet, skipping", peer_addr.c_str(), nlri.afi);
+            LOG_INFO("%s: MP_REACH AFI=%d is not implemented yet, skipping", peer_addr, nlri.afi);
             return;
     }
 }
@@ -179,10 +189,11 @@ void MPReachAttr::parseAfi_IPv4IPv6(bool isIPv4, mp_reach_nlri &nlri, UpdateMsg:
 
             inet_ntop(isIPv4 ? AF_INET : AF_INET6, ip_raw, ip_char, sizeof(ip_char));
 
-            parsed_data.attrs[ATTR_TYPE_NEXT_HOP] = std::string(ip_char);
+            parsed_data.attrs.setNextHop(ip_char);
 
             // Data is an IP address - parse the address and save it
-            parseNlriData_IPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info, parsed_data.advertised);
+            if (not skipFamily(peer_info, nlri.afi, nlri.safi))
+                parseNlriData_IPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info, parsed_data.advertised);
             break;
 
         case bgp::BGP_SAFI_NLRI_LABEL:
@@ -194,10 +205,11 @@ void MPReachAttr::parseAfi_IPv4IPv6(bool isIPv4, mp_reach_nlri &nlri, UpdateMsg:
 
             inet_ntop(isIPv4 ? AF_INET : AF_INET6, ip_raw, ip_char, sizeof(ip_char));
 
-            parsed_data.attrs[ATTR_TYPE_NEXT_HOP] = std::string(ip_char);
+            parsed_data.attrs.setNextHop(ip_char);
 
             // Data is an Label, IP address tuple parse and save it
-            parseNlriData_LabelIPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info, parsed_data.advertised);
+            if (not skipFamily(peer_info, nlri.afi, nlri.safi))
+                parseNlriData_LabelIPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info, parsed_data.advertised);
             break;
 
         case bgp::BGP_SAFI_MPLS: {
@@ -216,20 +228,60 @@ void MPReachAttr::parseAfi_IPv4IPv6(bool isIPv4, mp_reach_nlri &nlri, UpdateMsg:
 
             inet_ntop(isIPv4 ? AF_INET : AF_INET6, ip_raw, ip_char, sizeof(ip_char));
 
-            parsed_data.attrs[ATTR_TYPE_NEXT_HOP] = std::string(ip_char);
+            parsed_data.attrs.setNextHop(ip_char);
 
-            parseNlriData_LabelIPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info, parsed_data.vpn);
+            if (not skipFamily(peer_info, nlri.afi, nlri.safi))
+                parseNlriData_LabelIPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info, parsed_data.vpn);
 
             break;
         }
 
         default :
             LOG_INFO("%s: MP_REACH AFI=ipv4/ipv6 (%d) SAFI=%d is not implemented yet, skipping for now",
-                     peer_addr.c_str(), isIPv4, nlri.safi);
+                     peer_addr, isIPv4, nlri.safi);
             return;
     }
 }
 
+/**
+ * Check if the NLRI of an address family is not decoded because its output is disabled
+ *
+ * \details The next-hop of a skipped family is still decoded, it's part of the path attributes.
+ *
+ * \param [in]   peer_info              Persistent Peer info pointer
+ * \param [in]   afi                    Address family
+ * \param [in]   safi                   Subsequent address family
+ *
+ * \returns true if the NLRI is skipped, unknown families are never skipped
+ */
+bool MPReachAttr::skipFamily(BMPReader::peer_info *peer_info, uint16_t afi, uint8_t safi) {
+    uint32_t output = 0;
+
+    if (peer_info == NULL or peer_info->skip_outputs == 0)
+        return false;
+
+    switch (afi) {
+        case bgp::BGP_AFI_IPV4 :
+        case bgp::BGP_AFI_IPV6 :
+            if (safi == bgp::BGP_SAFI_UNICAST or safi == bgp::BGP_SAFI_NLRI_LABEL)
+                output = MSGBUS_OUTPUT_UNICAST_PREFIX;
+            else if (safi == bgp::BGP_SAFI_MPLS)
+                output = MSGBUS_OUTPUT_L3VPN;
+            break;
+
+        case bgp::BGP_AFI_L2VPN :
+            if (safi == bgp::BGP_SAFI_EVPN)
+                output = MSGBUS_OUTPUT_EVPN;
+            break;
+
+        case bgp::BGP_AFI_BGPLS :
+            output = MSGBUS_OUTPUT_LS;
+            break;
+    }
+
+    return peer_info->skips(output);
+}
+
 /**
  * Parses mp_reach_nlri and mp_unreach_nlri (IPv4/IPv6)
  *
@@ -240,63 +292,36 @@ void MPReachAttr::parseAfi_IPv4IPv6(bool isIPv4, mp_reach_nlri &nlri, UpdateMsg:
  * \param [in]   data                   Pointer to the start of the prefixes to be parsed
  * \param [in]   len                    Length of the data in bytes to be read
  * \param [in]   peer_info              Persistent Peer info pointer
- * \param [out]  prefixes               Reference to a list<prefix_tuple> to be updated with entries
+ * \param [out]  prefixes               Reference to a vector<prefix_tuple> to be updated with entries
  */
 void MPReachAttr::parseNlriData_IPv4IPv6(bool isIPv4, u_char *data, uint16_t len,
                                          BMPReader::peer_info * peer_info,
-                                         std::list<bgp::prefix_tuple> &prefixes) {
-    u_char            ip_raw[16];
-    char              ip_char[40];
-    u_char            addr_bytes;
-    bgp::prefix_tuple tuple;
-
+                                         std::vector<bgp::prefix_tuple> &prefixes) {
     if (len <= 0 or data == NULL)
         return;
 
     // TODO: Can extend this to support multicast, but right now we set it to unicast v4/v6
-    tuple.type = isIPv4 ? bgp::PREFIX_UNICAST_V4 : bgp::PREFIX_UNICAST_V6;
-    tuple.isIPv4 = isIPv4;
-
     bool add_path_enabled = peer_info->add_path_capability.isAddPathEnabled(isIPv4 ? bgp::BGP_AFI_IPV4 : bgp::BGP_AFI_IPV6,
                                                                             bgp::BGP_SAFI_UNICAST);
 
-    // Loop through all prefixes
-    for (size_t read_size=0; read_size < len; read_size++) {
-        tuple.path_id = 0;
-
-        bzero(ip_raw, sizeof(ip_raw));
-
-        // Parse add-paths if enabled
-        if (add_path_enabled and (len - read_size) >= 4) {
-            memcpy(&tuple.path_id, data, 4);
-            bgp::SWAP_BYTES(&tuple.path_id);
-            data += 4; read_size += 4;
-        } else
-            tuple.path_id = 0;
-
-        // set the address in bits length
-        tuple.len = *data++;
-
-        // Figure out how many bytes the bits requires
-        addr_bytes = tuple.len / 8;
-        if (tuple.len % 8)
-           ++addr_bytes;
-
-        memcpy(ip_raw, data, addr_bytes);
-        data += addr_bytes;
-        read_size += addr_bytes;
-
-        // Convert the IP to string printed format
-        inet_ntop(isIPv4 ? AF_INET : AF_INET6, ip_raw, ip_char, sizeof(ip_char));
-
-        tuple.prefix.assign(ip_char);
+    bgp::decodeNlri(data, len, isIPv4 ? bgp::PREFIX_UNICAST_V4 : bgp::PREFIX_UNICAST_V6, isIPv4,
+                    add_path_enabled, prefixes);
+}
 
-        // set the raw/binary address
-        memcpy(tuple.prefix_bin, ip_raw, sizeof(ip_raw));
+/**
+ * Store the route distinguisher of a labeled VPN prefix
+ *
+ * \param [out]  tuple      VPN prefix
+ * \param [in]   data       Route distinguisher, 8 bytes in wire format
+ */
+static void storeRd(bgp::vpn_tuple &tuple, const u_char *data) {
+    memcpy(tuple.rd, data, sizeof(tuple.rd));
+}
 
-        // Add tuple to prefix list
-        prefixes.push_back(tuple);
-    }
+/**
+ * Labeled unicast prefixes have no route distinguisher, nothing is stored
+ */
+static void storeRd(bgp::prefix_tuple &tuple, const u_char *data) {
 }
 
 /**
@@ -309,14 +334,13 @@ void MPReachAttr::parseNlriData_IPv4IPv6(bool isIPv4, u_char *data, uint16_t len
  * \param [in]   data                   Pointer to the start of the label + prefixes to be parsed
  * \param [in]   len                    Length of the data in bytes to be read
  * \param [in]   peer_info              Persistent Peer info pointer
- * \param [out]  prefixes               Reference to a list<label, prefix_tuple> to be updated with entries
+ * \param [out]  prefixes               Reference to a vector<label, prefix_tuple> to be updated with entries
  */
 template <typename PREFIX_TUPLE>
 void MPReachAttr::parseNlriData_LabelIPv4IPv6(bool isIPv4, u_char *data, uint16_t len,
                                               BMPReader::peer_info * peer_info,
-                                              std::list<PREFIX_TUPLE> &prefixes) {
+                                              std::vector<PREFIX_TUPLE> &prefixes) {
     u_char            ip_raw[16];
-    char              ip_char[40];
     int               addr_bytes;
     PREFIX_TUPLE      tuple;
 
@@ -325,6 +349,7 @@ void MPReachAttr::parseNlriData_LabelIPv4IPv6(bool isIPv4, u_char *data, uint16_
 
     tuple.type = isIPv4 ? bgp::PREFIX_LABEL_UNICAST_V4 : bgp::PREFIX_LABEL_UNICAST_V6;
     tuple.isIPv4 = isIPv4;
+    tuple.prefix[0] = 0;
 
     bool isVPN = typeid(bgp::vpn_tuple) == typeid(tuple);
     uint16_t label_bytes;
@@ -355,7 +380,7 @@ void MPReachAttr::parseNlriData_LabelIPv4IPv6(bool isIPv4, u_char *data, uint16_
         if (tuple.len % 8)
            ++addr_bytes;
 
-        label_bytes = decodeLabel(data, addr_bytes, tuple.labels);
+        label_bytes = bgp::decodeLabels(data, addr_bytes, tuple.labels);
 
         tuple.len -= (8 * label_bytes);      // Update prefix len to not include the label(s)
         data += label_bytes;               // move data pointer past labels
@@ -364,94 +389,25 @@ void MPReachAttr::parseNlriData_LabelIPv4IPv6(bool isIPv4, u_char *data, uint16_
 
         // Parse RD if VPN
         if (isVPN and addr_bytes >= 8) {
-            bgp::vpn_tuple *vtuple = (bgp::vpn_tuple *)&tuple;
-            EVPN::parseRouteDistinguisher(data, &vtuple->rd_type, &vtuple->rd_assigned_number,
-                                          &vtuple->rd_administrator_subfield);
+            storeRd(tuple, data);
             data += 8;
             addr_bytes -= 8;
             read_size += 8;
             tuple.len -= 64;
         }
 
-        // Parse the prefix if it isn't a default route
+        // Parse the prefix if it isn't a default route, it's printed from the binary prefix
         if (addr_bytes > 0) {
-            memcpy(ip_raw, data, addr_bytes);
+            memcpy(ip_raw, data, addr_bytes > 16 ? 16 : addr_bytes);
             data += addr_bytes;
             read_size += addr_bytes;
-
-            // Convert the IP to string printed format
-            inet_ntop(isIPv4 ? AF_INET : AF_INET6, ip_raw, ip_char, sizeof(ip_char));
-
-            tuple.prefix.assign(ip_char);
-
-            // set the raw/binary address
-            memcpy(tuple.prefix_bin, ip_raw, sizeof(ip_raw));
-
-        } else {
-            tuple.prefix.assign(isIPv4 ? "0.0.0.0" : "::");
         }
 
-        prefixes.push_back(tuple);
-    }
-}
+        // set the raw/binary address, zero for a default route
+        memcpy(tuple.prefix_bin, ip_raw, sizeof(ip_raw));
 
-/**
- * Decode label from NLRI data
- *
- * \details
- *      Decodes the labels from the NLRI data into labels string
- *
- * \param [in]   data                   Pointer to the start of the label + prefixes to be parsed
- * \param [in]   len                    Length of the data in bytes to be read
- * \param [out]  labels                 Reference to string that will be updated with labels delimited by comma
- *
- * \returns number of bytes read to decode the label(s) and updates string labels
- *
- */
-inline uint16_t MPReachAttr::decodeLabel(u_char *data, uint16_t len, std::string &labels) {
-    int read_size = 0;
-    typedef union {
-        struct {
-            uint8_t   ttl     : 8;          // TTL - not present since only 3 octets are used
-            uint8_t   bos     : 1;          // Bottom of stack
-            uint8_t   exp     : 3;          // EXP - not really used
-            uint32_t  value   : 20;         // Label value
-        } decode;
-        uint32_t  data;                 // Raw label - 3 octets only per RFC3107
-    } mpls_label;
-
-    mpls_label label;
-
-    labels.clear();
-
-    u_char *data_ptr = data;
-
-    // the label is 3 octets long
-    while (read_size <= len)
-    {
-        bzero(&label, sizeof(label));
-
-        memcpy(&label.data, data_ptr, 3);
-        bgp::SWAP_BYTES(&label.data);     // change to host order
-
-        data_ptr += 3;
-        read_size += 3;
-
-        ostringstream convert;
-        convert << label.decode.value;
-        labels.append(convert.str());
-
-        //printf("label data = %x\n", label.data);
-        if (label.decode.bos == 1 or label.data == 0x80000000 /* withdrawn label as 32bits instead of 24 */
-                or label.data == 0 /* l3vpn seems to use zero instead of rfc3107 suggested value */) {
-            break;               // Reached EoS
-
-        } else {
-            labels.append(",");
-        }
+        prefixes.push_back(tuple);
     }
-
-    return read_size;
 }
 
 } /* namespace bgp_msg */
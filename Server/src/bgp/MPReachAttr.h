@@ -12,6 +12,7 @@
 #include "bgp_common.h"
 #include "Logger.h"
 #include <list>
+#include <vector>
 #include <string>
 
 #include "UpdateMsg.h"
@@ -51,7 +52,7 @@ public:
      * \param [in]     peer_info                Persistent Peer info pointer
      * \param [in]     enable_debug             Debug true to enable, false to disable
      */
-    MPReachAttr(Logger *logPtr, std::string peerAddr, BMPReader::peer_info *peer_info, bool enable_debug=false);
+    MPReachAttr(Logger *logPtr, const char *peerAddr, BMPReader::peer_info *peer_info, bool enable_debug=false);
 
     virtual ~MPReachAttr();
 
@@ -79,11 +80,11 @@ public:
      * \param [in]   data                       Pointer to the start of the prefixes to be parsed
      * \param [in]   len                        Length of the data in bytes to be read
      * \param [in]   peer_info                  Persistent Peer info pointer
-     * \param [out]  prefixes                   Reference to a list<prefix_tuple> to be updated with entries
+     * \param [out]  prefixes                   Reference to a vector<prefix_tuple> to be updated with entries
      */
     static void parseNlriData_IPv4IPv6(bool isIPv4, u_char *data, uint16_t len,
                                        BMPReader::peer_info *peer_info,
-                                       std::list<bgp::prefix_tuple> &prefixes);
+                                       std::vector<bgp::prefix_tuple> &prefixes);
 
     /**
      * Parses mp_reach_nlri and mp_unreach_nlri (IPv4/IPv6)
@@ -95,32 +96,28 @@ public:
      * \param [in]   data                   Pointer to the start of the label + prefixes to be parsed
      * \param [in]   len                    Length of the data in bytes to be read
      * \param [in]   peer_info              Persistent Peer info pointer
-     * \param [out]  prefixes               Reference to a list<label, prefix_tuple> to be updated with entries
+     * \param [out]  prefixes               Reference to a vector<label, prefix_tuple> to be updated with entries
      */
     template <typename PREFIX_TUPLE>
     static void parseNlriData_LabelIPv4IPv6(bool isIPv4, u_char *data, uint16_t len,
                                             BMPReader::peer_info *peer_info,
-                                            std::list<PREFIX_TUPLE> &prefixes);
+                                            std::vector<PREFIX_TUPLE> &prefixes);
 
     /**
-     * Decode label from NLRI data
+     * Check if the NLRI of an address family is not decoded because its output is disabled
      *
-     * \details
-     *      Decodes the labels from the NLRI data into labels string
-     *
-     * \param [in]   data                   Pointer to the start of the label + prefixes to be parsed
-     * \param [in]   len                    Length of the data in bytes to be read
-     * \param [out]  labels                 Reference to string that will be updated with labels delimited by comma
-     *
-     * \returns number of bytes read to decode the label(s) and updates string labels
+     * \param [in]   peer_info              Persistent Peer info pointer
+     * \param [in]   afi                    Address family
+     * \param [in]   safi                   Subsequent address family
      *
+     * \returns true if the NLRI is skipped, unknown families are never skipped
      */
-    static inline uint16_t decodeLabel(u_char *data, uint16_t len, std::string &labels);
+    static bool skipFamily(BMPReader::peer_info *peer_info, uint16_t afi, uint8_t safi);
 
 private:
     bool                    debug;                  ///< debug flag to indicate debugging
     Logger                   *logger;               ///< Logging class pointer
-    std::string             peer_addr;              ///< Printed form of the peer address for logging
+    const char              *peer_addr;             ///< Printed form of the peer address for logging
     BMPReader::peer_info    *peer_info;
 
     /**
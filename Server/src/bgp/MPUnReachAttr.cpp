@@ -26,7 +26,7 @@ namespace bgp_msg {
  * \param [in]     peer_info                Persistent Peer info pointer
  * \param [in]     enable_debug             Debug true to enable, false to disable
  */
-MPUnReachAttr::MPUnReachAttr(Logger *logPtr, std::string peerAddr, BMPReader::peer_info *peer_info, bool enable_debug)
+MPUnReachAttr::MPUnReachAttr(Logger *logPtr, const char *peerAddr, BMPReader::peer_info *peer_info, bool enable_debug)
         : logger{logPtr}, debug{enable_debug}{
     this->peer_addr = peerAddr;
     this->peer_info = peer_info;
@@ -65,15 +65,19 @@ void MPUnReachAttr::parseUnReachNlriAttr(int attr_len, u_char *data, bgp_msg::Up
      * Make sure the parsing doesn't exceed buffer
      */
     if (attr_len < 0) {
-        LOG_NOTICE("%s: MP_UNREACH NLRI data length is larger than attribute data length, skipping parse", peer_addr.c_str());
+        LOG_NOTICE("%s: MP_UNREACH NLRI data length is larger than attribute data length, skipping parse", peer_addr);
         return;
     }
 
-    SELF_DEBUG("%s: afi=%d safi=%d", peer_addr.c_str(), nlri.afi, nlri.safi);
+    SELF_DEBUG("%s: afi=%d safi=%d", peer_addr, nlri.afi, nlri.safi);
 
     if (nlri.nlri_len == 0) {
 	peer_info->endOfRIB = true;		// Indicates End-Of-RIB Marker is received
-        LOG_INFO("%s: End-Of-RIB marker (mp_unreach len=0)", peer_addr.c_str());
+        LOG_INFO("%s: End-Of-RIB marker (mp_unreach len=0)", peer_addr);
+
+    } else if (MPReachAttr::skipFamily(peer_info, nlri.afi, nlri.safi)) {
+        SELF_DEBUG("%s: afi=%d safi=%d outputs are disabled, skipping %d bytes of NLRI", peer_addr,
+                   nlri.afi, nlri.safi, nlri.nlri_len);
 
     } else {
         /*
@@ -125,14 +129,14 @@ void MPUnReachAttr::parseAfi(mp_unreach_nlri &nlri, UpdateMsg::parsed_update_dat
 
                 default :
                     LOG_INFO("%s: EVPN::parse SAFI=%d is not implemented yet, skipping",
-                             peer_addr.c_str(), nlri.safi);
+                             peer_addr, nlri.safi);
             }
 
             break;
         }
 
         default : // Unknown
-            LOG_INFO("%s: MP_UNREACH AFI=%d is not implemented yet, skipping", peer_addr.c_str(), nlri.afi);
+            LOG_INFO("%s: MP_UNREACH AFI=%d is not implemented yet, skipping", peer_addr, nlri.afi);
             return;
     }
 }
@@ -172,7 +176,7 @@ void MPUnReachAttr::parseAfi_IPv4IPv6(bool isIPv4, mp_unreach_nlri &nlri, Update
 
         default :
             LOG_INFO("%s: MP_UNREACH AFI=ipv4/ipv6 (%d) SAFI=%d is not implemented yet, skipping for now",
-                     peer_addr.c_str(), isIPv4, nlri.safi);
+                     peer_addr, isIPv4, nlri.safi);
             return;
     }
 }
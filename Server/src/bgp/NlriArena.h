@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef NLRIARENA_H_
+#define NLRIARENA_H_
+
+#include <string>
+#include <vector>
+
+#include "bgp_common.h"
+#include "MsgBusInterface.hpp"
+#include "UpdateMsg.h"
+#include "ExtCommunity.h"
+
+namespace bgp_msg {
+
+#define NLRI_ARENA_RESERVE      256             ///< Initial number of prefixes reserved per vector
+
+/**
+ * Printed attribute strings, swapped with the strings of parsed or published attributes
+ */
+struct AttrStrings {
+    std::string     as_path;
+    std::string     community_list;
+    std::string     ext_community_list;
+    std::string     large_community_list;
+    std::string     cluster_list;
+
+    /**
+     * Swap the strings with the strings of the attributes
+     *
+     * \param [in,out] attrs    UpdateMsg::parsed_attrs or MsgBusInterface::obj_path_attr
+     */
+    template <typename T>
+    void swap(T &attrs) {
+        as_path.swap(attrs.as_path);
+        community_list.swap(attrs.community_list);
+        ext_community_list.swap(attrs.ext_community_list);
+        large_community_list.swap(attrs.large_community_list);
+        cluster_list.swap(attrs.cluster_list);
+    }
+
+    /**
+     * Clear the strings, keeping their capacity
+     */
+    template <typename T>
+    static void clear(T &attrs) {
+        attrs.as_path.clear();
+        attrs.community_list.clear();
+        attrs.ext_community_list.clear();
+        attrs.large_community_list.clear();
+        attrs.cluster_list.clear();
+    }
+};
+
+/**
+ * \class   NlriArena
+ *
+ * \brief   Per peer storage reused for the prefixes of each update
+ * \details The vectors are lent to the parsed update data for the duration of an update
+ *          and cleared (keeping their capacity) afterwards, so after the first few updates
+ *          decoding and publishing the unicast prefixes and BGP-LS records doesn't allocate.
+ *          The printed attribute strings are lent the same way.
+ *          The arena is only used by the thread parsing the peer.
+ */
+struct NlriArena {
+    std::vector<bgp::prefix_tuple>          advertised;     ///< Advertised unicast prefixes
+    std::vector<bgp::prefix_tuple>          withdrawn;      ///< Withdrawn unicast prefixes
+    std::vector<MsgBusInterface::obj_rib>   rib;            ///< RIB entries published to the message bus
+    UpdateMsg::parsed_data_ls               ls;             ///< Advertised link state nodes, links and prefixes
+    UpdateMsg::parsed_data_ls               ls_withdrawn;   ///< Withdrawn link state nodes, links and prefixes
+    LsAttrTable                             ls_attrs;       ///< Link state attributes
+    ExtCommCache                            ext_comm;       ///< Rendered extended communities
+    AttrStrings                             attr_strings;   ///< Strings of the parsed attributes
+    AttrStrings                             base_attr_strings;  ///< Strings of the published base attribute
+
+    NlriArena() {
+        advertised.reserve(NLRI_ARENA_RESERVE);
+        withdrawn.reserve(NLRI_ARENA_RESERVE);
+        rib.reserve(NLRI_ARENA_RESERVE);
+    }
+};
+
+} /* namespace bgp_msg */
+
+#endif /* NLRIARENA_H_ */
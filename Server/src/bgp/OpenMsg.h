@@ -133,7 +133,7 @@ public:
       * \param [in]     peer_info       Persistent peer information
       * \param [in]     enable_debug    Debug true to enable, false to disable
       */
-    OpenMsg(Logger *logPtr, std::string peerAddr, BMPReader::peer_info *peer_info, bool enable_debug=false);
+    OpenMsg(Logger *logPtr, const char *peerAddr, BMPReader::peer_info *peer_info, bool enable_debug=false);
     virtual ~OpenMsg();
 
     /**
@@ -160,7 +160,7 @@ public:
 private:
     bool                    debug;          ///< debug flag to indicate debugging
     Logger                  *logger;        ///< Logging class pointer
-    std::string             peer_addr;      ///< Printed form of the peer address for logging
+    const char              *peer_addr;     ///< Printed form of the peer address for logging
     BMPReader::peer_info    *peer_info;     ///< Persistent Peer info pointer
 
     /**
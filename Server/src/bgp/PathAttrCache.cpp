@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "PathAttrCache.h"
+
+namespace bgp_msg {
+
+/**
+ * Constructor for class
+ *
+ * \param [in] max_entries  Maximum number of attribute sets to cache
+ */
+PathAttrCache::PathAttrCache(size_t max_entries) {
+    this->max_entries = max_entries > 0 ? max_entries : 1;
+
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+
+    index.reserve(this->max_entries);
+}
+
+/**
+ * Lookup an attribute set, updates hit/miss counters
+ *
+ * \param [in] key      Raw attribute bytes
+ *
+ * \return Pointer to the entry, or NULL if not found.  Valid until the next add() or clear()
+ */
+PathAttrCacheEntry *PathAttrCache::find(const std::string &key) {
+    auto it = index.find(key);
+
+    if (it == index.end()) {
+        misses++;
+        return NULL;
+    }
+
+    hits++;
+
+    // Move to the front as most recently used
+    if (it->second != lru.begin())
+        lru.splice(lru.begin(), lru, it->second);
+
+    return &(*it->second);
+}
+
+/**
+ * Add a new empty entry, removes the least recently used entry if full
+ *
+ * \param [in] key      Raw attribute bytes
+ *
+ * \return Pointer to the new entry.  Valid until the next add() or clear()
+ */
+PathAttrCacheEntry *PathAttrCache::add(const std::string &key) {
+    auto it = index.find(key);
+
+    if (it != index.end()) {
+        lru.erase(it->second);
+        index.erase(it);
+
+    } else if (lru.size() >= max_entries) {
+        index.erase(lru.back().key);
+        lru.pop_back();
+        evictions++;
+    }
+
+    lru.emplace_front();
+
+    PathAttrCacheEntry &entry = lru.front();
+    entry.key = key;
+    entry.base_attr_valid = false;
+
+    index[key] = lru.begin();
+
+    return &entry;
+}
+
+/**
+ * Remove all entries, counters are not reset
+ */
+void PathAttrCache::clear() {
+    index.clear();
+    lru.clear();
+}
+
+/**
+ * Number of cached entries
+ */
+size_t PathAttrCache::size() {
+    return lru.size();
+}
+
+} /* namespace bgp_msg */
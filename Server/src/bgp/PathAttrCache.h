@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PATHATTRCACHE_H_
+#define PATHATTRCACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <list>
+#include <unordered_map>
+
+#include "UpdateMsg.h"
+#include "MsgBusInterface.hpp"
+
+namespace bgp_msg {
+
+/**
+ * Cached path attribute set
+ */
+struct PathAttrCacheEntry {
+    std::string                         key;                ///< Raw attribute bytes the entry is for
+    UpdateMsg::parsed_attrs             attrs;              ///< Parsed attributes, excluding MP_REACH/MP_UNREACH NLRI
+    MsgBusInterface::obj_path_attr      base_attr;          ///< Base attribute record, including the path hash id
+    bool                                base_attr_valid;    ///< True once base_attr has been published
+};
+
+/**
+ * \class   PathAttrCache
+ *
+ * \brief   Per peer LRU of parsed path attribute sets
+ * \details Keyed by the raw path attribute bytes of the update.  MP_REACH_NLRI contributes
+ *          only its AFI/SAFI and next-hop and MP_UNREACH_NLRI is excluded, so updates
+ *          differing only in NLRI share the same entry.  On a hit the attributes are not
+ *          parsed, hashed or published to the message bus again.
+ *
+ *          Entries are only valid for a single peer session; clear() on peer up/down.
+ */
+class PathAttrCache {
+public:
+    uint64_t    hits;                       ///< Number of lookups found in the cache
+    uint64_t    misses;                     ///< Number of lookups not found in the cache
+    uint64_t    evictions;                  ///< Number of entries removed to make room
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] max_entries  Maximum number of attribute sets to cache
+     */
+    PathAttrCache(size_t max_entries);
+
+    /**
+     * Lookup an attribute set, updates hit/miss counters
+     *
+     * \param [in] key      Raw attribute bytes
+     *
+     * \return Pointer to the entry, or NULL if not found.  Valid until the next add() or clear()
+     */
+    PathAttrCacheEntry *find(const std::string &key);
+
+    /**
+     * Add a new empty entry, removes the least recently used entry if full
+     *
+     * \param [in] key      Raw attribute bytes
+     *
+     * \return Pointer to the new entry.  Valid until the next add() or clear()
+     */
+    PathAttrCacheEntry *add(const std::string &key);
+
+    /**
+     * Remove all entries, counters are not reset
+     */
+    void clear();
+
+    /**
+     * Number of cached entries
+     */
+    size_t size();
+
+private:
+    size_t                                  max_entries;    ///< Maximum number of entries
+    std::list<PathAttrCacheEntry>           lru;            ///< Entries, most recently used first
+
+    std::unordered_map<std::string, std::list<PathAttrCacheEntry>::iterator> index;
+};
+
+} /* namespace bgp_msg */
+
+#endif /* PATHATTRCACHE_H_ */
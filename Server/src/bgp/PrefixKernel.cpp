@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <arpa/inet.h>
+#include <cstring>
+
+#include "PrefixKernel.h"
+
+namespace bgp {
+
+    /**
+     * Host bits mask of a byte, indexed by the number of prefix bits in the byte
+     */
+    static const uint8_t host_mask[9] = { 0xFF, 0x7F, 0x3F, 0x1F, 0x0F, 0x07, 0x03, 0x01, 0x00 };
+
+    /**
+     * Decode a run of length prefixed IPv4/IPv6 NLRI (RFC4271 section 4.3, RFC4760)
+     *
+     * \details Prefixes are appended in binary form, prefix_bin is zero filled past the
+     *          prefix bits.  The printed prefix is not set (empty string), see formatIp().
+     *
+     * \param [in]   data       Pointer to the start of the NLRI
+     * \param [in]   len        Length of the data in bytes
+     * \param [in]   type       Prefix type to set
+     * \param [in]   isIPv4     True if IPv4, false if IPv6
+     * \param [in]   add_path   True if each prefix has a path ID (RFC7911)
+     * \param [out]  prefixes   Prefixes are appended to this vector
+     *
+     * \return true if all of the data was decoded, false if it contains an invalid prefix;
+     *         prefixes before the invalid prefix are still appended
+     */
+    bool decodeNlri(const u_char *data, size_t len, PREFIX_TYPE type, bool isIPv4, bool add_path,
+                    std::vector<prefix_tuple> &prefixes) {
+        const u_char *end = data + len;
+        uint8_t      max_bits = isIPv4 ? 32 : 128;
+        uint32_t     path_id = 0;
+        uint8_t      bits;
+        size_t       addr_bytes;
+
+        if (data == NULL)
+            return len == 0;
+
+        // Each prefix is at least the length byte, reserving the worst case avoids regrowing mid run
+        prefixes.reserve(prefixes.size() + len / (add_path ? 5 : 1));
+
+        while (data < end) {
+            if (add_path) {
+                if (end - data < 5)
+                    return false;
+
+                memcpy(&path_id, data, 4);
+                SWAP_BYTES(&path_id);
+                data += 4;
+            }
+
+            bits = *data++;
+            addr_bytes = (bits + 7) / 8;
+
+            if (bits > max_bits or addr_bytes > (size_t)(end - data))
+                return false;
+
+            prefixes.emplace_back();        // value initialized, prefix_bin is zero and prefix is empty
+            prefix_tuple &tuple = prefixes.back();
+
+            tuple.type = type;
+            tuple.isIPv4 = isIPv4;
+            tuple.len = bits;
+            tuple.path_id = path_id;
+            memcpy(tuple.prefix_bin, data, addr_bytes);
+
+            data += addr_bytes;
+        }
+
+        return true;
+    }
+
+    /**
+     * Last address (broadcast) of a prefix
+     *
+     * \param [in]   addr       Binary prefix, 16 bytes, zero filled for IPv4
+     * \param [in]   bits       Prefix length in bits
+     * \param [in]   isIPv4     True if IPv4, false if IPv6
+     * \param [out]  bcast      16 byte buffer for the last address; bytes past an IPv4 address are copied from addr
+     */
+    void prefixBroadcast(const uint8_t *addr, uint8_t bits, bool isIPv4, uint8_t *bcast) {
+        int addr_len = isIPv4 ? 4 : 16;
+        int prefix_bits;
+
+        // Fixed 16 byte loop without data dependent branches, vectorized by the compiler
+        for (int i = 0; i < 16; i++) {
+            prefix_bits = (int)bits - i * 8;
+            prefix_bits = prefix_bits < 0 ? 0 : (prefix_bits > 8 ? 8 : prefix_bits);
+
+            bcast[i] = addr[i] | (i < addr_len ? host_mask[prefix_bits] : 0);
+        }
+    }
+
+    /**
+     * Print an IPv4/IPv6 address
+     *
+     * \details IPv4 is printed without inet_ntop; IPv6 uses inet_ntop for the zero compression rules.
+     *
+     * \param [in]   isIPv4     True if addr is 4 bytes IPv4, otherwise 16 bytes IPv6
+     * \param [in]   addr       Binary address in network byte order
+     * \param [out]  buf        Buffer of at least 46 bytes (INET6_ADDRSTRLEN)
+     *
+     * \return Length of the printed address
+     */
+    size_t formatIp(bool isIPv4, const uint8_t *addr, char *buf) {
+        char *p = buf;
+
+        if (not isIPv4) {
+            if (inet_ntop(AF_INET6, addr, buf, 46) == NULL) {
+                buf[0] = 0;
+                return 0;
+            }
+
+            return strlen(buf);
+        }
+
+        for (int i = 0; i < 4; i++) {
+            uint8_t octet = addr[i];
+
+            if (i > 0)
+                *p++ = '.';
+
+            if (octet >= 100) {
+                *p++ = '0' + octet / 100;
+                octet %= 100;
+                *p++ = '0' + octet / 10;
+                *p++ = '0' + octet % 10;
+
+            } else if (octet >= 10) {
+                *p++ = '0' + octet / 10;
+                *p++ = '0' + octet % 10;
+
+            } else
+                *p++ = '0' + octet;
+        }
+
+        *p = 0;
+
+        return p - buf;
+    }
+
+} /* namespace bgp */
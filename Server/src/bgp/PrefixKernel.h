@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PREFIXKERNEL_H_
+#define PREFIXKERNEL_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <vector>
+
+#include "bgp_common.h"
+
+namespace bgp {
+
+    /**
+     * Decode a run of length prefixed IPv4/IPv6 NLRI (RFC4271 section 4.3, RFC4760)
+     *
+     * \details Prefixes are appended in binary form, prefix_bin is zero filled past the
+     *          prefix bits.  The printed prefix is not set (empty string), see formatIp().
+     *
+     * \param [in]   data       Pointer to the start of the NLRI
+     * \param [in]   len        Length of the data in bytes
+     * \param [in]   type       Prefix type to set
+     * \param [in]   isIPv4     True if IPv4, false if IPv6
+     * \param [in]   add_path   True if each prefix has a path ID (RFC7911)
+     * \param [out]  prefixes   Prefixes are appended to this vector
+     *
+     * \return true if all of the data was decoded, false if it contains an invalid prefix;
+     *         prefixes before the invalid prefix are still appended
+     */
+    bool decodeNlri(const u_char *data, size_t len, PREFIX_TYPE type, bool isIPv4, bool add_path,
+                    std::vector<prefix_tuple> &prefixes);
+
+    /**
+     * Last address (broadcast) of a prefix
+     *
+     * \param [in]   addr       Binary prefix, 16 bytes, zero filled for IPv4
+     * \param [in]   bits       Prefix length in bits
+     * \param [in]   isIPv4     True if IPv4, false if IPv6
+     * \param [out]  bcast      16 byte buffer for the last address; bytes past an IPv4 address are copied from addr
+     */
+    void prefixBroadcast(const uint8_t *addr, uint8_t bits, bool isIPv4, uint8_t *bcast);
+
+    /**
+     * Print an IPv4/IPv6 address
+     *
+     * \details IPv4 is printed without inet_ntop; IPv6 uses inet_ntop for the zero compression rules.
+     *
+     * \param [in]   isIPv4     True if addr is 4 bytes IPv4, otherwise 16 bytes IPv6
+     * \param [in]   addr       Binary address in network byte order
+     * \param [out]  buf        Buffer of at least 46 bytes (INET6_ADDRSTRLEN)
+     *
+     * \return Length of the printed address
+     */
+    size_t formatIp(bool isIPv4, const uint8_t *addr, char *buf);
+
+} /* namespace bgp */
+
+#endif /* PREFIXKERNEL_H_ */
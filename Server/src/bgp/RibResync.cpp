@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <sys/time.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "RibResync.h"
+#include "AdjRibIn.h"
+#include "PrefixKernel.h"
+
+namespace bgp_msg {
+
+std::mutex                      RibResync::mutex;
+std::condition_variable         RibResync::cond;
+std::deque<uint64_t>            RibResync::queue;
+std::thread                     *RibResync::thr = NULL;
+bool                            RibResync::running = false;
+uint32_t                        RibResync::rate = 50000;
+Logger                          *RibResync::logger = NULL;
+
+/**
+ * Start the resync thread
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfg          Pointer to the config instance
+ */
+void RibResync::start(Logger *logPtr, Config *cfg) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running)
+        return;
+
+    logger = logPtr;
+    rate = cfg->adj_rib_in_resync_rate;
+    running = true;
+
+    thr = new std::thread(RibResync::run);
+}
+
+/**
+ * Stop the resync thread, a running resync is stopped
+ */
+void RibResync::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        queue.clear();
+    }
+
+    cond.notify_all();
+
+    if (thr != NULL) {
+        thr->join();
+        delete thr;
+        thr = NULL;
+    }
+}
+
+/**
+ * Queue a resync of the peers matching the peer or router hash
+ *
+ * \param [in] peer_hash    Peer hash ID in printed form, NULL or empty if not used
+ * \param [in] router_hash  Router hash ID in printed form, NULL or empty if not used
+ *
+ * \return Number of peers queued, -1 if the resync thread is not running
+ */
+int RibResync::request(const char *peer_hash, const char *router_hash) {
+    std::vector<uint64_t> ids;
+    char hash_str[33];
+
+    bool by_peer = peer_hash != NULL and peer_hash[0] != 0;
+    bool by_router = router_hash != NULL and router_hash[0] != 0;
+
+    if (not by_peer and not by_router)
+        return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(AdjRibIn::registry_mutex);
+
+        for (size_t i = 0; i < AdjRibIn::registry.size(); i++) {
+            AdjRibIn *rib = AdjRibIn::registry[i];
+            std::lock_guard<std::mutex> rib_lock(rib->mutex);
+
+            // RIBs without a publisher don't have the attributes
+            if (rib->mbus == NULL)
+                continue;
+
+            if (by_peer) {
+                AdjRibIn::hashStr(rib->peer_hash, hash_str);
+                if (strcmp(hash_str, peer_hash) != 0)
+                    continue;
+            }
+
+            if (by_router) {
+                AdjRibIn::hashStr(rib->peer.router_hash_id, hash_str);
+                if (strcmp(hash_str, router_hash) != 0)
+                    continue;
+            }
+
+            ids.push_back(rib->id);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (not running)
+        return -1;
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (std::find(queue.begin(), queue.end(), ids[i]) == queue.end())
+            queue.push_back(ids[i]);
+    }
+
+    cond.notify_one();
+
+    return ids.size();
+}
+
+/**
+ * Resync thread
+ */
+void RibResync::run() {
+    uint64_t rib_id;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (running and queue.empty())
+                cond.wait(lock);
+
+            if (not running)
+                return;
+
+            rib_id = queue.front();
+            queue.pop_front();
+        }
+
+        resync(rib_id);
+    }
+}
+
+/**
+ * Publish the routes of a RIB
+ *
+ * \param [in] rib_id   ID of the RIB
+ */
+void RibResync::resync(uint64_t rib_id) {
+    std::vector<AdjRibIn::RouteRef> routes;
+    MsgBusInterface::obj_rib rib_entry;
+    u_char last_hash[16] = { 0 };
+    char peer_addr[46];
+    uint64_t epoch;
+    size_t sent = 0;
+    size_t skipped = 0;
+
+    // Copy the routes, they are checked against the RIB again when published
+    {
+        std::lock_guard<std::mutex> lock(AdjRibIn::registry_mutex);
+        AdjRibIn *rib = AdjRibIn::lookup(rib_id);
+        if (rib == NULL)
+            return;
+
+        std::lock_guard<std::mutex> rib_lock(rib->mutex);
+
+        epoch = rib->epoch;
+        snprintf(peer_addr, sizeof(peer_addr), "%s", rib->peer.peer_addr);
+
+        routes.reserve(rib->routes);
+        rib->snapshot(rib->root[1], true, routes);
+        rib->snapshot(rib->root[0], false, routes);
+    }
+
+    // Routes sharing attributes are published together
+    std::sort(routes.begin(), routes.end(), [](const AdjRibIn::RouteRef &a, const AdjRibIn::RouteRef &b) {
+        return memcmp(a.hash, b.hash, sizeof(a.hash)) < 0;
+    });
+
+    LOG_INFO("%s: Resync of %zu routes started", peer_addr, routes.size());
+
+    bzero(&rib_entry, sizeof(rib_entry));
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    for (size_t pos = 0; pos < routes.size(); ) {
+        std::vector<Batch> batches;
+        MsgBusInterface::obj_bgp_peer peer;
+        MsgBusInterface *mbus;
+        AdjRibIn *rib;
+
+        // Copy the chunk with the RIB locked, it's published once both locks are released
+        {
+            std::lock_guard<std::mutex> lock(AdjRibIn::registry_mutex);
+            rib = AdjRibIn::lookup(rib_id);
+
+            if (rib == NULL) {
+                LOG_INFO("%s: Resync stopped, peer RIB was freed after %zu routes", peer_addr, sent);
+                return;
+            }
+
+            std::lock_guard<std::mutex> rib_lock(rib->mutex);
+
+            if (rib->epoch != epoch) {
+                LOG_INFO("%s: Resync stopped, peer session changed after %zu routes", peer_addr, sent);
+                return;
+            }
+
+            mbus = rib->mbus;
+            memcpy(&peer, &rib->peer, sizeof(peer));
+
+            MsgBusInterface::obj_path_attr *attr = NULL;
+
+            for (size_t end = std::min(pos + RIB_RESYNC_CHUNK, routes.size()); pos < end; pos++) {
+                AdjRibIn::RouteRef &ref = routes[pos];
+                AdjRibIn::Route *route = rib->findRoute(ref.isIPv4, ref.prefix, ref.len, ref.path_id);
+
+                // Routes changed since the copy were already published by the router thread
+                if (route == NULL or rib->attrs[route->attr].attr == NULL or
+                        memcmp(rib->attrs[route->attr].hash, ref.hash, sizeof(ref.hash)) != 0) {
+                    skipped++;
+                    continue;
+                }
+
+                if (rib->attrs[route->attr].attr != attr) {
+                    attr = rib->attrs[route->attr].attr;
+
+                    batches.push_back(Batch());
+                    batches.back().attr = *attr;
+
+                    // Base attribute once per path hash, the routes are ordered by hash
+                    if (memcmp(last_hash, ref.hash, sizeof(last_hash)) != 0) {
+                        batches.back().base = true;
+                        memcpy(last_hash, ref.hash, sizeof(last_hash));
+                    }
+                }
+
+                memcpy(rib_entry.path_attr_hash_id, ref.hash, sizeof(rib_entry.path_attr_hash_id));
+                memcpy(rib_entry.peer_hash_id, peer.hash_id, sizeof(rib_entry.peer_hash_id));
+                bgp::formatIp(ref.isIPv4, ref.prefix, rib_entry.prefix);
+                rib_entry.prefix_len = ref.len;
+                rib_entry.isIPv4 = ref.isIPv4 ? 1 : 0;
+                memcpy(rib_entry.prefix_bin, ref.prefix, sizeof(rib_entry.prefix_bin));
+                bgp::prefixBroadcast(ref.prefix, ref.len, ref.isIPv4, rib_entry.prefix_bcast_bin);
+                rib_entry.path_id = ref.path_id;
+
+                batches.back().rows.push_back(rib_entry);
+                sent++;
+            }
+
+            // The RIB, and so its message bus, isn't freed until the chunk is published
+            rib->publishing++;
+        }
+
+        // Timestamp of the copy of the peer, the router thread owns the one of the RIB
+        timeval tv;
+        gettimeofday(&tv, NULL);
+        peer.timestamp_secs = tv.tv_sec;
+        peer.timestamp_us = tv.tv_usec;
+
+        for (size_t i = 0; i < batches.size(); i++) {
+            if (batches[i].base)
+                mbus->update_baseAttribute(peer, batches[i].attr, mbus->BASE_ATTR_ACTION_ADD);
+
+            mbus->update_unicastPrefix(peer, batches[i].rows, &batches[i].attr, mbus->UNICAST_PREFIX_ACTION_ADD);
+        }
+
+        // Coalesced rows are otherwise held until the router thread produces again, which a quiet router may not
+        mbus->flush();
+
+        {
+            std::lock_guard<std::mutex> lock(AdjRibIn::registry_mutex);
+            rib->publishing--;
+        }
+        AdjRibIn::registry_cond.notify_all();
+
+        // Pace to the rate, wakes up early on stop
+        if (rate > 0) {
+            std::chrono::steady_clock::time_point due = begin + std::chrono::microseconds(sent * 1000000 / rate);
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (running and std::chrono::steady_clock::now() < due)
+                cond.wait_until(lock, due);
+
+            if (not running) {
+                LOG_INFO("%s: Resync stopped after %zu routes", peer_addr, sent);
+                return;
+            }
+        }
+    }
+
+    LOG_INFO("%s: Resync done, %zu routes published, %zu changed since the copy", peer_addr, sent, skipped);
+}
+
+} /* namespace bgp_msg */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef RIBRESYNC_H_
+#define RIBRESYNC_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+#include "Config.h"
+#include "MsgBusInterface.hpp"
+
+namespace bgp_msg {
+
+#define RIB_RESYNC_CHUNK        500             ///< Routes copied per lock of the RIB
+
+/**
+ * \class   RibResync
+ *
+ * \brief   Publishes the routes of the Adj-RIB-In of a peer again, without a router session reset
+ * \details Requested through the control socket (metrics.control_socket) when a consumer lost its state.  The
+ *          routes of the peer are copied when the resync starts and published as
+ *          unicast_prefix adds (with their base attributes) in chunks, paced to
+ *          adj_rib_in.resync_rate routes per second.
+ *
+ *          Each chunk is copied with the RIB locked and published once the locks are
+ *          released; a route is only copied if it is still in the RIB with the same path
+ *          hash, changes made after the copy are published by the router thread as usual.
+ *          The session epoch is checked again for every chunk, the resync is stopped if the
+ *          peer goes down or its RIB is freed.
+ *
+ *          Resyncs are done one at a time by a single thread.
+ */
+class RibResync {
+public:
+    /**
+     * Start the resync thread
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     */
+    static void start(Logger *logPtr, Config *cfg);
+
+    /**
+     * Stop the resync thread, a running resync is stopped
+     */
+    static void stop();
+
+    /**
+     * Queue a resync of the peers matching the peer or router hash
+     *
+     * \param [in] peer_hash    Peer hash ID in printed form, NULL or empty if not used
+     * \param [in] router_hash  Router hash ID in printed form, NULL or empty if not used
+     *
+     * \return Number of peers queued, -1 if the resync thread is not running
+     */
+    static int request(const char *peer_hash, const char *router_hash);
+
+private:
+    /**
+     * Routes of a chunk sharing the path attributes, copied out of the RIB
+     */
+    struct Batch {
+        MsgBusInterface::obj_path_attr          attr;   ///< Path attributes of the routes
+        bool                                    base;   ///< Indicates the base attribute is published first
+        std::vector<MsgBusInterface::obj_rib>   rows;   ///< Routes
+
+        Batch() : base(false) { }
+    };
+
+    static std::mutex                   mutex;
+    static std::condition_variable      cond;           ///< Signaled when a resync is queued
+    static std::deque<uint64_t>         queue;          ///< IDs of the RIBs to resync, guarded by mutex
+    static std::thread                  *thr;
+    static bool                         running;
+    static uint32_t                     rate;           ///< Routes per second
+    static Logger                       *logger;
+
+    /**
+     * Resync thread
+     */
+    static void run();
+
+    /**
+     * Publish the routes of a RIB
+     *
+     * \param [in] rib_id   ID of the RIB
+     */
+    static void resync(uint64_t rib_id);
+};
+
+} /* namespace bgp_msg */
+
+#endif /* RIBRESYNC_H_ */
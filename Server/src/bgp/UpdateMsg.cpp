@@ -15,9 +15,13 @@
 #include <arpa/inet.h>
 
 #include "ExtCommunity.h"
+#include "NlriArena.h"
 #include "MPReachAttr.h"
 #include "MPUnReachAttr.h"
 #include "MPLinkStateAttr.h"
+#include "PathAttrCache.h"
+#include "PrefixKernel.h"
+#include "CommunityKernel.h"
 
 namespace bgp_msg {
 
@@ -32,7 +36,7 @@ namespace bgp_msg {
  * \param [in,out] peer_info   Persistent peer information
  * \param [in]     enable_debug     Debug true to enable, false to disable
  */
-UpdateMsg::UpdateMsg(Logger *logPtr, std::string peerAddr, std::string routerAddr, BMPReader::peer_info *peer_info,
+UpdateMsg::UpdateMsg(Logger *logPtr, const char *peerAddr, const char *routerAddr, BMPReader::peer_info *peer_info,
                      bool enable_debug)
         : logger(logPtr),
           debug(enable_debug),
@@ -73,6 +77,7 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
     parsed_data.advertised.clear();
     parsed_data.attrs.clear();
     parsed_data.withdrawn.clear();
+    parsed_data.attr_cache_entry = NULL;
 
 
     /* ---------------------------------------------------------
@@ -80,10 +85,10 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
      */
     update_bgp_hdr uHdr;
 
-    SELF_DEBUG("%s: rtr=%s: Parsing update message of size %d", peer_addr.c_str(), router_addr.c_str(), size);
+    SELF_DEBUG("%s: rtr=%s: Parsing update message of size %d", peer_addr, router_addr, size);
 
     if (size < 2) {
-        LOG_WARN("%s: rtr=%s: Update message is too short to parse header", peer_addr.c_str(), router_addr.c_str());
+        LOG_WARN("%s: rtr=%s: Update message is too short to parse header", peer_addr, router_addr);
         return 0;
     }
 
@@ -94,24 +99,24 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
 
     // Set the withdrawn data pointer
     if ((size - read_size) < uHdr.withdrawn_len) {
-        LOG_WARN("%s: rtr=%s: Update message is too short to parse withdrawn data", peer_addr.c_str(), router_addr.c_str());
+        LOG_WARN("%s: rtr=%s: Update message is too short to parse withdrawn data", peer_addr, router_addr);
         return 0;
     }
 
     uHdr.withdrawnPtr = bufPtr;
     bufPtr += uHdr.withdrawn_len; read_size += uHdr.withdrawn_len;
 
-    SELF_DEBUG("%s: rtr=%s: Withdrawn len = %hu", peer_addr.c_str(), router_addr.c_str(), uHdr.withdrawn_len );
+    SELF_DEBUG("%s: rtr=%s: Withdrawn len = %hu", peer_addr, router_addr, uHdr.withdrawn_len );
 
     // Get the attributes length
     memcpy(&uHdr.attr_len, bufPtr, sizeof(uHdr.attr_len));
     bufPtr += sizeof(uHdr.attr_len); read_size += sizeof(uHdr.attr_len);
     bgp::SWAP_BYTES(&uHdr.attr_len);
-    SELF_DEBUG("%s: rtr=%s: Attribute len = %hu", peer_addr.c_str(), router_addr.c_str(), uHdr.attr_len);
+    SELF_DEBUG("%s: rtr=%s: Attribute len = %hu", peer_addr, router_addr, uHdr.attr_len);
 
     // Set the attributes data pointer
     if ((size - read_size) < uHdr.attr_len) {
-        LOG_WARN("%s: rtr=%s: Update message is too short to parse attr data", peer_addr.c_str(), router_addr.c_str());
+        LOG_WARN("%s: rtr=%s: Update message is too short to parse attr data", peer_addr, router_addr);
         return 0;
     }
     uHdr.attrPtr = bufPtr;
@@ -126,15 +131,15 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
     if (not uHdr.withdrawn_len and (size - read_size) <= 0 and not uHdr.attr_len) {
 
 	peer_info->endOfRIB = true;		// Indicates End-of-RIB Marker received
-        LOG_INFO("%s: rtr=%s: End-Of-RIB marker", peer_addr.c_str(), router_addr.c_str());
+        LOG_INFO("%s: rtr=%s: End-Of-RIB marker", peer_addr, router_addr);
 
     } else {
 
         /* ---------------------------------------------------------
          * Parse the withdrawn prefixes
          */
-        SELF_DEBUG("%s: rtr=%s: Getting the IPv4 withdrawn data", peer_addr.c_str(), router_addr.c_str());
-        if (uHdr.withdrawn_len > 0)
+        SELF_DEBUG("%s: rtr=%s: Getting the IPv4 withdrawn data", peer_addr, router_addr);
+        if (uHdr.withdrawn_len > 0 and not MPReachAttr::skipFamily(peer_info, bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_UNICAST))
             parseNlriData_v4(uHdr.withdrawnPtr, uHdr.withdrawn_len, parsed_data.withdrawn);
 
 
@@ -149,9 +154,10 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
         /* ---------------------------------------------------------
          * Parse the NLRI data
          */
-        SELF_DEBUG("%s: rtr=%s: Getting the IPv4 NLRI data, size = %d", peer_addr.c_str(), router_addr.c_str(), (size - read_size));
+        SELF_DEBUG("%s: rtr=%s: Getting the IPv4 NLRI data, size = %d", peer_addr, router_addr, (size - read_size));
         if ((size - read_size) > 0) {
-            parseNlriData_v4(uHdr.nlriPtr, (size - read_size), parsed_data.advertised);
+            if (not MPReachAttr::skipFamily(peer_info, bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_UNICAST))
+                parseNlriData_v4(uHdr.nlriPtr, (size - read_size), parsed_data.advertised);
             read_size = size;
         }
     }
@@ -168,71 +174,20 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
  *
  * \param [in]   data       Pointer to the start of the prefixes to be parsed
  * \param [in]   len        Length of the data in bytes to be read
- * \param [out]  prefixes   Reference to a list<prefix_tuple> to be updated with entries
+ * \param [out]  prefixes   Reference to a vector<prefix_tuple> to be updated with entries
  */
-void UpdateMsg::parseNlriData_v4(u_char *data, uint16_t len, std::list<bgp::prefix_tuple> &prefixes) {
-    u_char       ipv4_raw[4];
-    char         ipv4_char[16];
-    u_char       addr_bytes;
-
-    bgp::prefix_tuple tuple;
-
+void UpdateMsg::parseNlriData_v4(u_char *data, uint16_t len, std::vector<bgp::prefix_tuple> &prefixes) {
     if (len <= 0 or data == NULL)
         return;
 
     // TODO: Can extend this to support multicast, but right now we set it to unicast v4
-    // Set the type for all to be unicast V4
-    tuple.type = bgp::PREFIX_UNICAST_V4;
-    tuple.isIPv4 = true;
-
-    // Loop through all prefixes
-    for (size_t read_size=0; read_size < len; read_size++) {
-
-        bzero(ipv4_raw, sizeof(ipv4_raw));
-        bzero(tuple.prefix_bin, sizeof(tuple.prefix_bin));
-
-        // Parse add-paths if enabled
-        if (peer_info->add_path_capability.isAddPathEnabled(bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_UNICAST)
-                and (len - read_size) >= 4) {
-            memcpy(&tuple.path_id, data, 4);
-            bgp::SWAP_BYTES(&tuple.path_id);
-            data += 4; read_size += 4;
-        } else
-            tuple.path_id = 0;
-
-        // set the address in bits length
-        tuple.len = *data++;
-
-        // Figure out how many bytes the bits requires
-        addr_bytes = tuple.len / 8;
-        if (tuple.len % 8)
-            ++addr_bytes;
-
-        SELF_DEBUG("%s: rtr=%s: Reading NLRI data prefix bits=%d bytes=%d", peer_addr.c_str(),
-                    router_addr.c_str(), tuple.len, addr_bytes);
-
-        if (addr_bytes <= 4) {
-            memcpy(ipv4_raw, data, addr_bytes);
-            read_size += addr_bytes;
-            data += addr_bytes;
-
-            // Convert the IP to string printed format
-            inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-            tuple.prefix.assign(ipv4_char);
-            SELF_DEBUG("%s: rtr=%s: Adding prefix %s len %d", peer_addr.c_str(),
-                        router_addr.c_str(), ipv4_char, tuple.len);
+    bool add_path = peer_info->add_path_capability.isAddPathEnabled(bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_UNICAST);
 
-            // set the raw/binary address
-            memcpy(tuple.prefix_bin, ipv4_raw, sizeof(ipv4_raw));
+    SELF_DEBUG("%s: rtr=%s: Reading %d bytes of NLRI v4 data", peer_addr, router_addr, len);
 
-            // Add tuple to prefix list
-            prefixes.push_back(tuple);
-
-        } else if (addr_bytes > 4) {
-            LOG_NOTICE("%s: rtr=%s: NRLI v4 address is larger than 4 bytes bytes=%d len=%d",
-                       peer_addr.c_str(), router_addr.c_str(), addr_bytes, tuple.len);
-        }
-    }
+    if (not bgp::decodeNlri(data, len, bgp::PREFIX_UNICAST_V4, true, add_path, prefixes))
+        LOG_NOTICE("%s: rtr=%s: NLRI v4 data has an invalid prefix, prefixes after it are skipped",
+                   peer_addr, router_addr);
 }
 
 /**
@@ -246,22 +201,68 @@ void UpdateMsg::parseNlriData_v4(u_char *data, uint16_t len, std::list<bgp::pref
  * \param [out]  parsed_data    Reference to parsed_update_data; will be updated with all parsed data
  */
 void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &parsed_data) {
-    /*
-     * Per RFC4271 Section 4.3, flat indicates if the length is 1 or 2 octets
-     */
-    u_char   attr_flags;
-    u_char   attr_type;
-    uint16_t attr_len;
+    PathAttrCache       *cache = peer_info != NULL ? peer_info->attr_cache : NULL;
+    PathAttrCacheEntry  *entry;
+    std::string         key;
 
     if (len == 0)
         return;
 
     else if (len < 3) {
         LOG_WARN("%s: rtr=%s: Cannot parse the attributes due to the data being too short, error in update message. len=%d",
-                peer_addr.c_str(), router_addr.c_str(), len);
+                peer_addr, router_addr, len);
+        return;
+    }
+
+    /*
+     * None of the outputs of the peer use the path attributes, only the MP NLRI is parsed
+     */
+    if (peer_info != NULL and peer_info->skips(MSGBUS_OUTPUT_ATTRS)) {
+        parseAttrList(data, len, parsed_data, true);
+        return;
+    }
+
+    if (cache == NULL or not getAttrCacheKey(data, len, key)) {
+        parseAttrList(data, len, parsed_data, false);
         return;
     }
 
+    /*
+     * Same attribute set as a previous update, only the MP NLRI needs to be parsed
+     */
+    if ((entry = cache->find(key)) != NULL) {
+        SELF_DEBUG("%s: rtr=%s: attribute cache hit, size=%lu", peer_addr, router_addr, key.size());
+
+        parsed_data.attrs = entry->attrs;
+        parsed_data.attr_cache_entry = entry;
+
+        parseAttrList(data, len, parsed_data, true);
+        return;
+    }
+
+    parseAttrList(data, len, parsed_data, false);
+
+    entry = cache->add(key);
+    entry->attrs = parsed_data.attrs;
+    parsed_data.attr_cache_entry = entry;
+}
+
+/**
+ * Parses the list of BGP attributes
+ *
+ * \param [in]   data       Pointer to the start of the attributes
+ * \param [in]   len        Length of the data in bytes to be read
+ * \param [out]  parsed_data    Reference to parsed_update_data; will be updated with all parsed data
+ * \param [in]   mp_only    True to only parse MP_REACH/MP_UNREACH, other attributes are skipped
+ */
+void UpdateMsg::parseAttrList(u_char *data, uint16_t len, parsed_update_data &parsed_data, bool mp_only) {
+    /*
+     * Per RFC4271 Section 4.3, flat indicates if the length is 1 or 2 octets
+     */
+    u_char   attr_flags;
+    u_char   attr_type;
+    uint16_t attr_len;
+
     /*
      * Iterate through all attributes and parse them
      */
@@ -271,7 +272,7 @@ void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &
 
         // Check if the length field is 1 or two bytes
         if (ATTR_FLAG_EXTENDED(attr_flags)) {
-            SELF_DEBUG("%s: rtr=%s: extended length path attribute bit set for an entry", peer_addr.c_str(), router_addr.c_str());
+            SELF_DEBUG("%s: rtr=%s: extended length path attribute bit set for an entry", peer_addr, router_addr);
 
             memcpy(&attr_len, data, 2); data += 2; read_size += 2;
             bgp::SWAP_BYTES(&attr_len);
@@ -282,7 +283,7 @@ void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &
         }
 
         SELF_DEBUG("%s: rtr=%s: attribute type = %d len_sz = %d",
-                peer_addr.c_str(), router_addr.c_str(), attr_type, attr_len);
+                peer_addr, router_addr, attr_type, attr_len);
 
         // Get the attribute data, if we have any; making sure to not overrun buffer
         if (attr_len > 0 and (read_size + attr_len) <= len ) {
@@ -291,22 +292,90 @@ void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &
             /*
              * Parse data based on attribute type
              */
-            parseAttrData(attr_type, attr_len, data, parsed_data);
+            if (not mp_only or attr_type == ATTR_TYPE_MP_REACH_NLRI or attr_type == ATTR_TYPE_MP_UNREACH_NLRI)
+                parseAttrData(attr_type, attr_len, data, parsed_data);
+
             data        += attr_len;
             read_size   += attr_len;
 
-            SELF_DEBUG("%s: rtr=%s: parsed attr type=%d, size=%hu", peer_addr.c_str(), router_addr.c_str(),
+            SELF_DEBUG("%s: rtr=%s: parsed attr type=%d, size=%hu", peer_addr, router_addr,
                         attr_type, attr_len);
 
         } else if (attr_len) {
             LOG_NOTICE("%s: rtr=%s: Attribute data len of %hu is larger than available data in update message of %hu",
-                    peer_addr.c_str(), router_addr.c_str(), attr_len, (len - read_size));
+                    peer_addr, router_addr, attr_len, (len - read_size));
             return;
         }
     }
 
 }
 
+/**
+ * Get the path attribute cache key
+ *
+ * \details The key is the raw attribute bytes.  MP_UNREACH is excluded and only the
+ *          AFI/SAFI and next-hop of MP_REACH are included, so that the NLRI does not
+ *          change the key.
+ *
+ * \param [in]   data       Pointer to the start of the attributes
+ * \param [in]   len        Length of the data in bytes
+ * \param [out]  key        Cache key
+ *
+ * \return true if the attributes can be cached, false if not (e.g. BGP-LS or malformed)
+ */
+bool UpdateMsg::getAttrCacheKey(u_char *data, uint16_t len, std::string &key) {
+    size_t   read_size = 0;
+    size_t   hdr_len;
+    uint16_t attr_len;
+    u_char   *value;
+
+    key.clear();
+    key.reserve(len);
+
+    while (read_size < len) {
+        hdr_len = ATTR_FLAG_EXTENDED(data[read_size]) ? 4 : 3;
+
+        if (read_size + hdr_len > len)
+            return false;
+
+        if (hdr_len == 4)
+            attr_len = (data[read_size + 2] << 8) | data[read_size + 3];
+        else
+            attr_len = data[read_size + 2];
+
+        if (read_size + hdr_len + attr_len > len)
+            return false;
+
+        value = data + read_size + hdr_len;
+
+        switch (data[read_size + 1]) {
+            case ATTR_TYPE_MP_UNREACH_NLRI :
+                break;
+
+            case ATTR_TYPE_MP_REACH_NLRI :
+                // AFI (2), SAFI (1), next-hop length (1) and the next-hop
+                if (attr_len < 4 or 4 + value[3] > attr_len)
+                    return false;
+
+                key.append((char *)data + read_size, 2);
+                key.append((char *)value, 4 + value[3]);
+                break;
+
+            case ATTR_TYPE_BGP_LS :
+                // BGP-LS attributes are stored per update in ls_attrs
+                return false;
+
+            default :
+                key.append((char *)data + read_size, hdr_len + attr_len);
+                break;
+        }
+
+        read_size += hdr_len + attr_len;
+    }
+
+    return key.size() > 0;
+}
+
 /**
  * Parse attribute data based on attribute type
  *
@@ -324,7 +393,6 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
     u_char      ipv4_raw[4];
     char        ipv4_char[16];
     uint32_t    value32bit;
-    uint16_t    value16bit;
 
     /*
      * Parse based on attribute type
@@ -333,12 +401,10 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
 
         case ATTR_TYPE_ORIGIN : // Origin
             switch (data[0]) {
-               case 0 : decodeStr.assign("igp"); break;
-               case 1 : decodeStr.assign("egp"); break;
-               case 2 : decodeStr.assign("incomplete"); break;
+               case 0 : parsed_data.attrs.origin = "igp"; break;
+               case 1 : parsed_data.attrs.origin = "egp"; break;
+               case 2 : parsed_data.attrs.origin = "incomplete"; break;
             }
-
-            parsed_data.attrs[ATTR_TYPE_ORIGIN] = decodeStr;
             break;
 
         case ATTR_TYPE_AS_PATH : // AS_PATH
@@ -348,29 +414,23 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
         case ATTR_TYPE_NEXT_HOP : // Next hop v4
             memcpy(ipv4_raw, data, 4);
             inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-            parsed_data.attrs[ATTR_TYPE_NEXT_HOP] = std::string(ipv4_char);
+            parsed_data.attrs.setNextHop(ipv4_char);
             break;
 
         case ATTR_TYPE_MED : // MED value
-        {
             memcpy(&value32bit, data, 4);
             bgp::SWAP_BYTES(&value32bit);
-            std::ostringstream numString;
-            numString << value32bit;
-            parsed_data.attrs[ATTR_TYPE_MED] = numString.str();
+            parsed_data.attrs.med = value32bit;
             break;
-        }
+
         case ATTR_TYPE_LOCAL_PREF : // local pref value
-        {
             memcpy(&value32bit, data, 4);
             bgp::SWAP_BYTES(&value32bit);
-            std::ostringstream numString;
-            numString << value32bit;
-            parsed_data.attrs[ATTR_TYPE_LOCAL_PREF] = numString.str();
+            parsed_data.attrs.local_pref = value32bit;
             break;
-        }
+
         case ATTR_TYPE_ATOMIC_AGGREGATE : // Atomic aggregate
-            parsed_data.attrs[ATTR_TYPE_ATOMIC_AGGREGATE] = std::string("1");
+            parsed_data.attrs.atomic_agg = true;
             break;
 
         case ATTR_TYPE_AGGEGATOR : // Aggregator
@@ -379,8 +439,7 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
 
         case ATTR_TYPE_ORIGINATOR_ID : // Originator ID
             memcpy(ipv4_raw, data, 4);
-            inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-            parsed_data.attrs[ATTR_TYPE_ORIGINATOR_ID] = std::string(ipv4_char);
+            inet_ntop(AF_INET, ipv4_raw, parsed_data.attrs.originator_id, sizeof(parsed_data.attrs.originator_id));
             break;
 
         case ATTR_TYPE_CLUSTER_LIST : // Cluster List (RFC 4456)
@@ -393,39 +452,22 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
                 decodeStr.append(" ");
             }
 
-            parsed_data.attrs[ATTR_TYPE_CLUSTER_LIST] = decodeStr;
+            parsed_data.attrs.cluster_list = decodeStr;
             break;
 
         case ATTR_TYPE_COMMUNITIES : // Community list
-        {
-            for (int i = 0; i < attr_len; i += 4) {
-                std::ostringstream numString;
-
-                // Add space between entries
-                if (i)
-                    decodeStr.append(" ");
-
-                // Add entry
-                memcpy(&value16bit, data, 2);
-                data += 2;
-                bgp::SWAP_BYTES(&value16bit);
-                numString << value16bit;
-                numString << ":";
-
-                memcpy(&value16bit, data, 2);
-                data += 2;
-                bgp::SWAP_BYTES(&value16bit);
-                numString << value16bit;
-                decodeStr.append(numString.str());
-            }
-
-            parsed_data.attrs[ATTR_TYPE_COMMUNITIES] = decodeStr;
+            bgp::decodeCommunities(data, attr_len, parsed_data.attrs.community_list);
+            break;
 
+        case ATTR_TYPE_LARGE_COMMUNITY : // Large community list (RFC 8092)
+            bgp::decodeLargeCommunities(data, attr_len, parsed_data.attrs.large_community_list);
             break;
-        }
+
         case ATTR_TYPE_EXT_COMMUNITY : // extended community list (RFC 4360)
         {
-            ExtCommunity ec(logger, peer_addr, debug);
+            // Rendered communities are cached in the peer arena, NULL until the first update of the peer
+            ExtCommunity ec(logger, peer_addr, debug,
+                            (peer_info != NULL and peer_info->nlri_arena != NULL) ? &peer_info->nlri_arena->ext_comm : NULL);
             ec.parseExtCommunities(attr_len, data, parsed_data);
             break;
         }
@@ -458,6 +500,9 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
 
         case ATTR_TYPE_BGP_LS:
         {
+            if (peer_info != NULL and peer_info->skips(MSGBUS_OUTPUT_LS))
+                break;
+
             MPLinkStateAttr ls(logger, peer_addr, &parsed_data, debug);
             ls.parseAttrLinkState(attr_len, data);
             break;
@@ -466,20 +511,20 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
         case ATTR_TYPE_AS4_PATH:
         {
             SELF_DEBUG("%s: rtr=%s: attribute type AS4_PATH is not yet implemented, skipping for now.",
-                     peer_addr.c_str(), router_addr.c_str());
+                     peer_addr, router_addr);
             break;
         }
 
         case ATTR_TYPE_AS4_AGGREGATOR:
         {
             SELF_DEBUG("%s: rtr=%s: attribute type AS4_AGGREGATOR is not yet implemented, skipping for now.",
-                       peer_addr.c_str(), router_addr.c_str());
+                       peer_addr, router_addr);
             break;
         }
 
         default:
             LOG_INFO("%s: rtr=%s: attribute type %d is not yet implemented or intentionally ignored, skipping for now.",
-                    peer_addr.c_str(), router_addr.c_str(), attr_type);
+                    peer_addr, router_addr, attr_type);
             break;
 
     } // END OF SWITCH ATTR TYPE
@@ -490,10 +535,9 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
  *
  * \param [in]   attr_len       Length of the attribute data
  * \param [in]   data           Pointer to the attribute data
- * \param [out]  attrs          Reference to the parsed attr map - will be updated
+ * \param [out]  attrs          Reference to the parsed attributes - will be updated
  */
-void UpdateMsg::parseAttr_Aggegator(uint16_t attr_len, u_char *data, parsed_attrs_map &attrs) {
-    std::string decodeStr;
+void UpdateMsg::parseAttr_Aggegator(uint16_t attr_len, u_char *data, parsed_attrs &attrs) {
     uint32_t    value32bit = 0;
     uint16_t    value16bit = 0;
     u_char      ipv4_raw[4];
@@ -503,48 +547,93 @@ void UpdateMsg::parseAttr_Aggegator(uint16_t attr_len, u_char *data, parsed_attr
      if (attr_len == 8) { // RFC6793 ASN of 4 octets
          memcpy(&value32bit, data, 4); data += 4;
          bgp::SWAP_BYTES(&value32bit);
-         std::ostringstream numString;
-         numString << value32bit;
-         decodeStr.assign(numString.str());
 
      } else if (attr_len == 6) {
          memcpy(&value16bit, data, 2); data += 2;
          bgp::SWAP_BYTES(&value16bit);
-         std::ostringstream numString;
-         numString << value16bit;
-         decodeStr.assign(numString.str());
+         value32bit = value16bit;
 
      } else {
-         LOG_ERR("%s: rtr=%s: path attribute is not the correct size of 6 or 8 octets.", peer_addr.c_str(), router_addr.c_str());
+         LOG_ERR("%s: rtr=%s: path attribute is not the correct size of 6 or 8 octets.", peer_addr, router_addr);
          return;
      }
 
-     decodeStr.append(" ");
      memcpy(ipv4_raw, data, 4);
      inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-     decodeStr.append(ipv4_char);
 
-     attrs[ATTR_TYPE_AGGEGATOR] = decodeStr;
+     snprintf(attrs.aggregator, sizeof(attrs.aggregator), "%u %s", value32bit, ipv4_char);
 }
 
 /**
- * Parse attribute AS_PATH data
+ * Append an ASN in printed form
  *
- * \param [in]   attr_len       Length of the attribute data
- * \param [in]   data           Pointer to the attribute data
- * \param [out]  attrs          Reference to the parsed attr map - will be updated
+ * \param [in]   buf    Buffer to write to, must have room for 11 chars
+ * \param [in]   asn    ASN to print
+ *
+ * \return number of chars written
  */
-void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_map &attrs) {
-    std::string decoded_path;
-    int         path_len    = attr_len;
-    uint16_t    as_path_cnt = 0;
+static inline size_t formatAsn(char *buf, uint32_t asn) {
+    char   tmp[10];
+    size_t i = sizeof(tmp);
+    size_t len;
 
-    u_char      seg_type;
-    u_char      seg_len;
-    uint32_t    seg_asn = 0;
+    do {
+        tmp[--i] = '0' + (asn % 10);
+        asn /= 10;
+    } while (asn > 0);
+
+    len = sizeof(tmp) - i;
+    memcpy(buf, tmp + i, len);
+
+    return len;
+}
+
+/**
+ * Get the AS path in printed form
+ *
+ * \details Renders the binary AS path, AS_SET segments are enclosed in braces.
+ *
+ * \param [out] out     String to store the printed AS path
+ */
+void UpdateMsg::parsed_attrs::getAsPath(std::string &out) const {
+    // Each ASN is a space plus up to 10 digits, each AS_SET adds " {" and " }"
+    char    buf[AS_PATH_MAX_ASNS * 11 + AS_PATH_MAX_SEGMENTS * 4];
+    size_t  len = 0;
+    int     asn_idx = 0;
+
+    if (as_path_seg_count == 0) {
+        out = as_path;
+        return;
+    }
 
-    u_char *data_ptr = data;
+    for (int i = 0; i < as_path_seg_count; i++) {
+        if (as_path_segs[i].type == 1) {            // If AS-SET open with a brace
+            buf[len++] = ' ';
+            buf[len++] = '{';
+        }
 
+        for (int c = 0; c < as_path_segs[i].count; c++) {
+            buf[len++] = ' ';
+            len += formatAsn(buf + len, as_path_asns[asn_idx++]);
+        }
+
+        if (as_path_segs[i].type == 1) {            // If AS-SET close with a brace
+            buf[len++] = ' ';
+            buf[len++] = '}';
+        }
+    }
+
+    out.assign(buf, len);
+}
+
+/**
+ * Parse attribute AS_PATH data
+ *
+ * \param [in]   attr_len       Length of the attribute data
+ * \param [in]   data           Pointer to the attribute data
+ * \param [out]  attrs          Reference to the parsed attributes - will be updated
+ */
+void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs &attrs) {
     /*
      * We first must try to parse using four octet since the RFC says that the peer header
      *     defines the encoding and not the capabilities.  four_octet_asn represents
@@ -552,9 +641,48 @@ void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_m
      */
     char asn_octet_size = (peer_info->using_2_octet_asn /* and not four_octet_asn */) ? 2 : 4;
 
-    if (path_len < asn_octet_size) // Nothing to parse if length doesn't include at least one asn
+    if (attr_len < asn_octet_size) // Nothing to parse if length doesn't include at least one asn
         return;
 
+    if (not decodeAsPath(attr_len, data, asn_octet_size, attrs)) {
+        LOG_NOTICE("%s: rtr=%s: Could not parse the AS PATH due to update message buffer being too short when using ASN octet size %d",
+                   peer_addr, router_addr, asn_octet_size);
+
+        if (not peer_info->using_2_octet_asn) {
+            LOG_NOTICE("%s: rtr=%s: switching encoding size to 2-octet",
+                       peer_addr, router_addr);
+
+            peer_info->using_2_octet_asn = true;
+
+            if (not decodeAsPath(attr_len, data, 2, attrs))
+                LOG_NOTICE("%s: rtr=%s: Could not parse the AS PATH due to update message buffer being too short when using ASN octet size 2",
+                           peer_addr, router_addr);
+        }
+    }
+}
+
+/**
+ * Decode AS_PATH segments using the given ASN size
+ *
+ * \param [in]   attr_len       Length of the attribute data
+ * \param [in]   data           Pointer to the attribute data
+ * \param [in]   asn_octet_size ASN size in bytes, 2 or 4
+ * \param [out]  attrs          Reference to the parsed attributes - will be updated
+ *
+ * \return true if decoded, false if a segment is longer than the attribute
+ */
+bool UpdateMsg::decodeAsPath(uint16_t attr_len, u_char *data, char asn_octet_size, parsed_attrs &attrs) {
+    int         path_len    = attr_len;
+    uint16_t    as_path_cnt = 0;
+    uint16_t    seg_count   = 0;
+    bool        has_set     = false;
+    bool        is_inline   = true;
+    std::string decoded_path;               // Only used if the path doesn't fit in parsed_attrs
+
+    u_char      seg_type;
+    u_char      seg_len;
+    uint32_t    seg_asn = 0;
+
     /*
      * Loop through each path segment
      */
@@ -564,28 +692,35 @@ void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_m
         seg_len  = *data++;                  // Count of AS's, not bytes
         path_len -= 2;
 
-        if (seg_type == 1) {                 // If AS-SET open with a brace
-            decoded_path.append(" {");
-        }
-
         SELF_DEBUG("%s: rtr=%s: as_path seg_len = %d seg_type = %d, path_len = %d total_len = %d as_octet_size = %d",
-                   peer_addr.c_str(), router_addr.c_str(),
+                   peer_addr, router_addr,
                    seg_len, seg_type, path_len, attr_len, asn_octet_size);
 
-        if ((seg_len * asn_octet_size) > path_len){
+        if ((seg_len * asn_octet_size) > path_len)
+            return false;
 
-            LOG_NOTICE("%s: rtr=%s: Could not parse the AS PATH due to update message buffer being too short when using ASN octet size %d",
-                       peer_addr.c_str(), router_addr.c_str(), asn_octet_size);
+        if (seg_type == 1)
+            has_set = true;
 
-            if (not peer_info->using_2_octet_asn) {
-                LOG_NOTICE("%s: rtr=%s: switching encoding size to 2-octet",
-                           peer_addr.c_str(), router_addr.c_str());
+        /*
+         * Switch to rendering if the path doesn't fit, starting with what was already decoded
+         */
+        if (is_inline and (seg_count >= AS_PATH_MAX_SEGMENTS or as_path_cnt + seg_len > AS_PATH_MAX_ASNS)) {
+            if (seg_count > 0) {
+                attrs.as_path_seg_count = seg_count;
+                attrs.getAsPath(decoded_path);
+                attrs.as_path_seg_count = 0;
+            }
 
-                peer_info->using_2_octet_asn = true;
+            is_inline = false;
+        }
 
-                parseAttr_AsPath(attr_len, data_ptr, attrs);
-            }
-            return;
+        if (is_inline) {
+            attrs.as_path_segs[seg_count].type  = seg_type;
+            attrs.as_path_segs[seg_count].count = seg_len;
+            seg_count++;
+        } else if (seg_type == 1) {         // If AS-SET open with a brace
+            decoded_path.append(" {");
         }
 
         // The rest of the data is the as path sequence, in blocks of 2 or 4 bytes
@@ -595,42 +730,43 @@ void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_m
             path_len -= asn_octet_size;                               // Adjust the path length for what was read
 
             bgp::SWAP_BYTES(&seg_asn, asn_octet_size);
-            decoded_path.append(" ");
-            std::ostringstream numString;
-            numString << seg_asn;
-            decoded_path.append(numString.str());
+
+            if (is_inline)
+                attrs.as_path_asns[as_path_cnt] = seg_asn;
+            else {
+                char asn_char[12];
+                asn_char[0] = ' ';
+                decoded_path.append(asn_char, formatAsn(asn_char + 1, seg_asn) + 1);
+            }
 
             // Increase the as path count
             ++as_path_cnt;
         }
 
-        if (seg_type == 1) {            // If AS-SET close with a brace
+        if (not is_inline and seg_type == 1) {  // If AS-SET close with a brace
             decoded_path.append(" }");
         }
     }
 
-    SELF_DEBUG("%s: rtr=%s: Parsed AS_PATH count %hu : %s", peer_addr.c_str(), router_addr.c_str(), as_path_cnt, decoded_path.c_str());
+    SELF_DEBUG("%s: rtr=%s: Parsed AS_PATH count %hu, segments %hu", peer_addr, router_addr,
+               as_path_cnt, (is_inline ? seg_count : 0));
 
     /*
-     * Update the attributes map
+     * Update the attributes, the origin ASN is the last ASN
      */
-    attrs[ATTR_TYPE_AS_PATH] = decoded_path;
-
-    {
-        std::ostringstream numString;
-        numString << as_path_cnt;
-        attrs[ATTR_TYPE_INTERNAL_AS_COUNT] = numString.str();
+    if (is_inline) {
+        attrs.as_path_seg_count = seg_count;
+        attrs.as_path.clear();
+    } else {
+        attrs.as_path_seg_count = 0;
+        attrs.as_path = decoded_path;
     }
 
-    /*
-     * Get the last ASN and update the attributes map
-     */
-    {
-        std::ostringstream numString;
-        numString << seg_asn;
-        attrs[ATTR_TYPE_INTERNAL_AS_ORIGIN] = numString.str();
-    }
+    attrs.as_path_count   = as_path_cnt;
+    attrs.origin_as       = seg_asn;
+    attrs.as_path_has_set = has_set;
 
+    return true;
 }
 
 } /* namespace bgp_msg */
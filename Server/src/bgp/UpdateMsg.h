@@ -14,14 +14,20 @@
 #include "bgp_common.h"
 #include "MsgBusInterface.hpp"
 #include "AddPathDataContainer.h"
+#include "LsAttrTable.h"
 
 #include <string>
 #include <list>
+#include <vector>
 #include <array>
+#include <cstring>
 #include <map>
 #include <bmp/BMPReader.h>
 
 namespace bgp_msg {
+
+struct PathAttrCacheEntry;
+
 /**
  * Defines the attribute types
  *
@@ -54,14 +60,10 @@ enum UPDATE_ATTR_TYPES {
 
             ATTR_TYPE_BGP_LS=29,                    // BGP LS attribute draft-ietf-idr-ls-distribution
 
-            ATTR_TYPE_BGP_LINK_STATE_OLD=99,        // BGP link state Older
-            ATTR_TYPE_BGP_ATTRIBUTE_SET=128,
+            ATTR_TYPE_LARGE_COMMUNITY=32,           ///< RFC8092 - Large communities
 
-            /*
-             * Below attribute types are for internal use only... These are derived/added based on other attributes
-             */
-            ATTR_TYPE_INTERNAL_AS_COUNT=9000,        // AS path count - number of AS's
-            ATTR_TYPE_INTERNAL_AS_ORIGIN             // The AS that originated the entry
+            ATTR_TYPE_BGP_LINK_STATE_OLD=99,        // BGP link state Older
+            ATTR_TYPE_BGP_ATTRIBUTE_SET=128
 };
 
 
@@ -110,39 +112,138 @@ public:
         u_char *nlriPtr;
     };
 
+    #define AS_PATH_MAX_SEGMENTS    16              ///< Max AS path segments stored in parsed_attrs
+    #define AS_PATH_MAX_ASNS        128             ///< Max AS path ASNs stored in parsed_attrs
+
     /**
-     * parsed path attributes map
+     * AS path segment, RFC4271 section 4.3
      */
-    std::map<bgp_msg::UPDATE_ATTR_TYPES, std::string>            parsed_attrs;
-    typedef std::pair<bgp_msg::UPDATE_ATTR_TYPES, std::string>   parsed_attrs_pair;
-    typedef std::map<bgp_msg::UPDATE_ATTR_TYPES, std::string>    parsed_attrs_map;
+    struct as_path_segment {
+        u_char              type;                       ///< Segment type, 1 = AS_SET, 2 = AS_SEQUENCE
+        u_char              count;                      ///< Number of ASNs in the segment
+    };
+
+    /**
+     * Parsed path attributes
+     *
+     * \details Numeric attributes are stored as values.  Only the lists and addresses that
+     *          are published in printed form are stored as strings.
+     */
+    struct parsed_attrs {
+        const char          *origin;                    ///< Origin name (static string), NULL if not present
+        uint32_t            med;                        ///< MED, 0 if not present
+        uint32_t            local_pref;                 ///< Local pref, 0 if not present
+        bool                atomic_agg;                 ///< True if atomic aggregate is present
+
+        uint16_t            as_path_count;              ///< Count of ASN's in the path (includes all in AS-SET)
+        uint32_t            origin_as;                  ///< Origin ASN, last ASN in the path
+        bool                as_path_has_set;            ///< True if the path contains an AS_SET
+
+        /*
+         * Binary AS path, the ASNs of all segments are stored in order in as_path_asns.
+         *   Paths that don't fit are rendered while parsing and stored in as_path instead.
+         */
+        uint16_t            as_path_seg_count;          ///< Number of segments in as_path_segs
+        as_path_segment     as_path_segs[AS_PATH_MAX_SEGMENTS];
+        uint32_t            as_path_asns[AS_PATH_MAX_ASNS];
+
+        bool                nexthop_isIPv4;             ///< True if the next-hop is IPv4, false if IPv6
+        char                next_hop[40];               ///< Next-hop IP in printed form, empty if not present
+        char                aggregator[40];             ///< Aggregator ASN and IP in printed form
+        char                originator_id[16];          ///< Originator ID in printed form
+
+        std::string         as_path;                    ///< AS path in printed form, only if too long for as_path_asns
+        std::string         community_list;             ///< Standard communities in printed form
+        std::string         ext_community_list;         ///< Extended communities in printed form
+        std::string         large_community_list;       ///< Large communities in printed form
+        std::string         cluster_list;               ///< Cluster list in printed form
 
-    // Parsed bgp-ls attributes map
-    typedef  std::map<uint16_t, std::array<uint8_t, 255>>        parsed_ls_attrs_map;
+        /**
+         * Reset all attributes to not present
+         */
+        void clear() {
+            origin = NULL;
+            med = 0;
+            local_pref = 0;
+            atomic_agg = false;
+            as_path_count = 0;
+            origin_as = 0;
+            as_path_has_set = false;
+            as_path_seg_count = 0;
+            nexthop_isIPv4 = true;
+            next_hop[0] = 0;
+            aggregator[0] = 0;
+            originator_id[0] = 0;
+            as_path.clear();
+            community_list.clear();
+            ext_community_list.clear();
+            large_community_list.clear();
+            cluster_list.clear();
+        }
+
+        /**
+         * Set the next-hop
+         *
+         * \param [in] ip_char  Next-hop IPv4 or IPv6 address in printed form
+         */
+        void setNextHop(const char *ip_char) {
+            strncpy(next_hop, ip_char, sizeof(next_hop) - 1);
+            next_hop[sizeof(next_hop) - 1] = 0;
+            nexthop_isIPv4 = strchr(next_hop, ':') == NULL;
+        }
+
+        /**
+         * Get the AS path in printed form
+         *
+         * \details Renders the binary AS path, AS_SET segments are enclosed in braces.
+         *
+         * \param [out] out     String to store the printed AS path
+         */
+        void getAsPath(std::string &out) const;
+    };
 
     /**
      * Parsed data structure for BGP-LS
      */
     struct parsed_data_ls {
-        std::list<MsgBusInterface::obj_ls_node>   nodes;        ///< List of Link state nodes
-        std::list<MsgBusInterface::obj_ls_link>   links;        ///< List of link state links
-        std::list<MsgBusInterface::obj_ls_prefix> prefixes;     ///< List of link state prefixes
+        std::vector<MsgBusInterface::obj_ls_node>   nodes;      ///< List of Link state nodes
+        std::vector<MsgBusInterface::obj_ls_link>   links;      ///< List of link state links
+        std::vector<MsgBusInterface::obj_ls_prefix> prefixes;   ///< List of link state prefixes
+
+        /**
+         * Remove all nodes, links and prefixes, keeping the capacity
+         */
+        void clear() {
+            nodes.clear();
+            links.clear();
+            prefixes.clear();
+        }
+
+        /**
+         * Swap the nodes, links and prefixes with another instance
+         */
+        void swap(parsed_data_ls &other) {
+            nodes.swap(other.nodes);
+            links.swap(other.links);
+            prefixes.swap(other.prefixes);
+        }
     };
 
     /**
      * Parsed update data - decoded data from complete update parse
      */
     struct parsed_update_data {
-        parsed_attrs_map              attrs;              ///< Parsed attrbutes
-        std::list<bgp::prefix_tuple>  withdrawn;          ///< List of withdrawn prefixes
-        std::list<bgp::prefix_tuple>  advertised;         ///< List of advertised prefixes
-        parsed_ls_attrs_map           ls_attrs;           ///< BGP-LS specific attributes
+        parsed_attrs                  attrs;              ///< Parsed attrbutes
+        std::vector<bgp::prefix_tuple>  withdrawn;          ///< List of withdrawn prefixes
+        std::vector<bgp::prefix_tuple>  advertised;         ///< List of advertised prefixes
+        LsAttrTable                   ls_attrs;           ///< BGP-LS specific attributes
         parsed_data_ls                ls;                 ///< REACH: Link state parsed data
         parsed_data_ls                ls_withdrawn;       ///< UNREACH: Parsed Withdrawn data
-        std::list<bgp::vpn_tuple>     vpn;                ///< List of vpn prefixes advertised
-        std::list<bgp::vpn_tuple>     vpn_withdrawn;      ///< List of vpn prefixes withdrawn
-        std::list<bgp::evpn_tuple>    evpn;               ///< List of evpn nlris advertised
-        std::list<bgp::evpn_tuple>    evpn_withdrawn;     ///< List of evpn nlris withdrawn
+        std::vector<bgp::vpn_tuple>     vpn;                ///< List of vpn prefixes advertised
+        std::vector<bgp::vpn_tuple>     vpn_withdrawn;      ///< List of vpn prefixes withdrawn
+        std::vector<bgp::evpn_tuple>    evpn;               ///< List of evpn nlris advertised
+        std::vector<bgp::evpn_tuple>    evpn_withdrawn;     ///< List of evpn nlris withdrawn
+        PathAttrCacheEntry            *attr_cache_entry;  ///< Cached attribute set of this update, NULL if not cached
     };
 
 
@@ -152,12 +253,12 @@ public:
      * \details Handles bgp update messages
      *
      * \param [in]     logPtr       Pointer to existing Logger for app logging
-     * \param [in]     pperAddr     Printed form of peer address used for logging
-     * \param [in]     routerAddr  The router IP address - used for logging
+     * \param [in]     pperAddr     Printed form of peer address used for logging, must outlive the parser
+     * \param [in]     routerAddr  The router IP address - used for logging, must outlive the parser
      * \param [in,out] peer_info   Persistent peer information
      * \param [in]     enable_debug Debug true to enable, false to disable
      */
-     UpdateMsg(Logger *logPtr, std::string peerAddr, std::string routerAddr, BMPReader::peer_info *peer_info,
+     UpdateMsg(Logger *logPtr, const char *peerAddr, const char *routerAddr, BMPReader::peer_info *peer_info,
                 bool enable_debug=false);
      virtual ~UpdateMsg();
 
@@ -180,8 +281,8 @@ public:
 private:
     bool                    debug;                           ///< debug flag to indicate debugging
     Logger                  *logger;                         ///< Logging class pointer
-    std::string             peer_addr;                       ///< Printed form of the peer address for logging
-    std::string             router_addr;                     ///< Router IP address - used for logging
+    const char              *peer_addr;                      ///< Printed form of the peer address for logging
+    const char              *router_addr;                    ///< Router IP address - used for logging
     bool                    four_octet_asn;                  ///< Indicates true if 4 octets or false if 2
     BMPReader::peer_info    *peer_info;                      ///< Persistent Peer info pointer
 
@@ -195,9 +296,9 @@ private:
      *
      * \param [in]   data       Pointer to the start of the prefixes to be parsed
      * \param [in]   len        Length of the data in bytes to be read
-     * \param [out]  prefixes   Reference to a list<prefix_tuple> to be updated with entries
+     * \param [out]  prefixes   Reference to a vector<prefix_tuple> to be updated with entries
      */
-    void parseNlriData_v4(u_char *data, uint16_t len, std::list<bgp::prefix_tuple> &prefixes);
+    void parseNlriData_v4(u_char *data, uint16_t len, std::vector<bgp::prefix_tuple> &prefixes);
 
     /**
      * Parses the BGP attributes in the update
@@ -211,6 +312,31 @@ private:
      */
     void parseAttributes(u_char *data, uint16_t len, parsed_update_data &parsed_data);
 
+    /**
+     * Parses the list of BGP attributes
+     *
+     * \param [in]   data       Pointer to the start of the attributes
+     * \param [in]   len        Length of the data in bytes to be read
+     * \param [out]  parsed_data    Reference to parsed_update_data; will be updated with all parsed data
+     * \param [in]   mp_only    True to only parse MP_REACH/MP_UNREACH, other attributes are skipped
+     */
+    void parseAttrList(u_char *data, uint16_t len, parsed_update_data &parsed_data, bool mp_only);
+
+    /**
+     * Get the path attribute cache key
+     *
+     * \details The key is the raw attribute bytes.  MP_UNREACH is excluded and only the
+     *          AFI/SAFI and next-hop of MP_REACH are included, so that the NLRI does not
+     *          change the key.
+     *
+     * \param [in]   data       Pointer to the start of the attributes
+     * \param [in]   len        Length of the data in bytes
+     * \param [out]  key        Cache key
+     *
+     * \return true if the attributes can be cached, false if not (e.g. BGP-LS or malformed)
+     */
+    bool getAttrCacheKey(u_char *data, uint16_t len, std::string &key);
+
     /**
      * Parse attribute data based on attribute type
      *
@@ -230,18 +356,30 @@ private:
      *
      * \param [in]   attr_len       Length of the attribute data
      * \param [in]   data           Pointer to the attribute data
-     * \param [out]  attrs          Reference to the parsed attr map - will be updated
+     * \param [out]  attrs          Reference to the parsed attributes - will be updated
+     */
+    void parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs &attrs);
+
+    /**
+     * Decode AS_PATH segments using the given ASN size
+     *
+     * \param [in]   attr_len       Length of the attribute data
+     * \param [in]   data           Pointer to the attribute data
+     * \param [in]   asn_octet_size ASN size in bytes, 2 or 4
+     * \param [out]  attrs          Reference to the parsed attributes - will be updated
+     *
+     * \return true if decoded, false if a segment is longer than the attribute
      */
-    void parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_map &attrs);
+    bool decodeAsPath(uint16_t attr_len, u_char *data, char asn_octet_size, parsed_attrs &attrs);
 
     /**
      * Parse attribute AGGEGATOR data
      *
      * \param [in]   attr_len       Length of the attribute data
      * \param [in]   data           Pointer to the attribute data
-     * \param [out]  attrs          Reference to the parsed attr map - will be updated
+     * \param [out]  attrs          Reference to the parsed attributes - will be updated
      */
-    void parseAttr_Aggegator(uint16_t attr_len, u_char *data, parsed_attrs_map &attrs);
+    void parseAttr_Aggegator(uint16_t attr_len, u_char *data, parsed_attrs &attrs);
 
 };
 
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <cstdio>
+#include <cstring>
+
+#include "VpnKernel.h"
+#include "PrefixKernel.h"
+
+namespace bgp {
+
+    static const char hex_digits[] = "0123456789abcdef";
+
+    /*
+     * Big endian fields of the RD and ESI
+     */
+    static inline uint32_t get16(const u_char *p) {
+        return (p[0] << 8) | p[1];
+    }
+
+    static inline uint32_t get24(const u_char *p) {
+        return (p[0] << 16) | (p[1] << 8) | p[2];
+    }
+
+    static inline uint32_t get32(const u_char *p) {
+        return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    /**
+     * Decode the label stack of a labeled NLRI (RFC3107 section 3)
+     *
+     * \param [in]   data       Pointer to the first label
+     * \param [in]   len        Length of the label, RD and prefix data in bytes
+     * \param [out]  labels     Label stack
+     *
+     * \return number of bytes of the labels
+     */
+    size_t decodeLabels(const u_char *data, size_t len, label_stack &labels) {
+        size_t read_size = 0;
+
+        labels.count = 0;
+
+        // Each label is 3 octets, 20 bits of label, 3 bits of EXP and the bottom of stack bit
+        while (read_size + 3 <= len) {
+            uint32_t label = get24(data + read_size);
+            read_size += 3;
+
+            if (labels.count < BGP_MAX_LABELS)
+                labels.value[labels.count++] = label >> 4;
+
+            if ((label & 0x01) or label == 0x800000 /* withdrawn label */
+                    or label == 0 /* l3vpn seems to use zero instead of rfc3107 suggested value */)
+                break;
+        }
+
+        return read_size;
+    }
+
+    /**
+     * Print a label stack as label,label,...
+     *
+     * \param [in]   labels     Label stack
+     * \param [out]  buf        Buffer of at least BGP_LABELS_STRLEN bytes
+     *
+     * \return Length of the printed labels, zero if not labeled
+     */
+    size_t formatLabels(const label_stack &labels, char *buf) {
+        char *p = buf;
+
+        for (int i = 0; i < labels.count; i++)
+            p += sprintf(p, i > 0 ? ",%u" : "%u", labels.value[i]);
+
+        *p = 0;
+        return p - buf;
+    }
+
+    /**
+     * Print a route distinguisher
+     *
+     * \param [in]   rd         Route distinguisher, 8 bytes in wire format
+     * \param [out]  buf        Buffer of at least BGP_RD_STRLEN bytes
+     * \param [in]   rfc4364    True to print administrator:assigned number, false for the legacy form
+     *
+     * \return Length of the printed route distinguisher
+     */
+    size_t formatRouteDistinguisher(const u_char *rd, char *buf, bool rfc4364) {
+        size_t len;
+
+        switch (rd[1]) {
+            case 0 : // 2 byte ASN : 4 byte assigned number
+                if (not rfc4364)
+                    return sprintf(buf, "%u%u:%u", get32(rd + 4), get16(rd + 2), get32(rd + 4));
+
+                return sprintf(buf, "%u:%u", get16(rd + 2), get32(rd + 4));
+
+            case 1 : // IPv4 address : 2 byte assigned number
+                len = formatIp(true, rd + 2, buf);
+                return len + sprintf(buf + len, ":%u", get16(rd + 6));
+
+            case 2 : // 4 byte ASN : 2 byte assigned number
+                if (not rfc4364)
+                    return sprintf(buf, "%u%u:%u", get16(rd + 6), get32(rd + 2), get16(rd + 6));
+
+                return sprintf(buf, "%u:%u", get32(rd + 2), get16(rd + 6));
+
+            default :
+                strcpy(buf, ":");
+                return 1;
+        }
+    }
+
+    /**
+     * Route distinguisher as it was hashed by the md5 hash ids of previous versions
+     *
+     * \param [in]   rd         Route distinguisher, 8 bytes in wire format
+     * \param [out]  buf        Buffer of at least BGP_RD_STRLEN bytes
+     *
+     * \return Length of the hashed route distinguisher
+     */
+    size_t formatRouteDistinguisherHash(const u_char *rd, char *buf) {
+        size_t len;
+
+        switch (rd[1]) {
+            case 0 :
+                return sprintf(buf, "%u%u%u", get32(rd + 4), get16(rd + 2), get32(rd + 4));
+
+            case 1 :
+                len = formatIp(true, rd + 2, buf);
+                return len + sprintf(buf + len, "%u", get16(rd + 6));
+
+            case 2 :
+                return sprintf(buf, "%u%u%u", get16(rd + 6), get32(rd + 2), get16(rd + 6));
+
+            default :
+                buf[0] = 0;
+                return 0;
+        }
+    }
+
+    /**
+     * Print an ethernet segment identifier (RFC7432 section 5) as the type and its values
+     *
+     * \param [in]   esi        Ethernet segment identifier, 10 bytes in wire format
+     * \param [out]  buf        Buffer of at least BGP_ESI_STRLEN bytes
+     *
+     * \return Length of the printed ESI
+     */
+    size_t formatEsi(const u_char *esi, char *buf) {
+        char *p = buf + sprintf(buf, "%d ", esi[0]);
+
+        switch (esi[0]) {
+            case 0 : // Arbitrary 9 octets
+                p += formatHex(esi + 1, 9, p);
+                break;
+
+            case 1 : // CE LACP system MAC and port key
+            case 2 : // Root bridge MAC and priority
+                p += formatMac(esi + 1, p);
+                p += sprintf(p, " %u", get16(esi + 7));
+                break;
+
+            case 3 : // System MAC and local discriminator
+                p += formatMac(esi + 1, p);
+                p += sprintf(p, " %u", get24(esi + 7));
+                break;
+
+            case 4 : // Router ID and local discriminator
+            case 5 : // ASN and local discriminator
+                p += sprintf(p, "%d %d", (int)get32(esi + 1), (int)get32(esi + 5));
+                break;
+
+            default :
+                break;
+        }
+
+        return p - buf;
+    }
+
+    /**
+     * Print a MAC address as xx:xx:xx:xx:xx:xx
+     *
+     * \param [in]   mac        MAC address, 6 bytes
+     * \param [out]  buf        Buffer of at least BGP_MAC_STRLEN bytes
+     *
+     * \return Length of the printed MAC, 17
+     */
+    size_t formatMac(const u_char *mac, char *buf) {
+        char *p = buf;
+
+        for (int i = 0; i < 6; i++) {
+            if (i > 0)
+                *p++ = ':';
+
+            *p++ = hex_digits[mac[i] >> 4];
+            *p++ = hex_digits[mac[i] & 0x0F];
+        }
+
+        *p = 0;
+        return p - buf;
+    }
+
+    /**
+     * Print bytes in lower case hex
+     *
+     * \param [in]   data       Bytes to print
+     * \param [in]   len        Number of bytes
+     * \param [out]  buf        Buffer of at least len * 2 + 1 bytes
+     *
+     * \return Length of the printed bytes
+     */
+    size_t formatHex(const u_char *data, size_t len, char *buf) {
+        for (size_t i = 0; i < len; i++) {
+            buf[i * 2] = hex_digits[data[i] >> 4];
+            buf[i * 2 + 1] = hex_digits[data[i] & 0x0F];
+        }
+
+        buf[len * 2] = 0;
+        return len * 2;
+    }
+
+} /* namespace bgp */
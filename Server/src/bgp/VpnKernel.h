@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef VPNKERNEL_H_
+#define VPNKERNEL_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <cstddef>
+
+#include "bgp_common.h"
+
+namespace bgp {
+
+    #define BGP_LABELS_STRLEN       (BGP_MAX_LABELS * 8)    // Printed label stack, "1048575," per label
+    #define BGP_RD_STRLEN           32                      // Printed route distinguisher, admin:assigned
+    #define BGP_ESI_STRLEN          32                      // Printed ethernet segment identifier
+    #define BGP_MAC_STRLEN          18                      // Printed MAC address
+
+    /**
+     * Decode the label stack of a labeled NLRI (RFC3107 section 3)
+     *
+     * \details The stack ends at the label with the bottom of stack bit, at the withdrawn
+     *          label (0x800000) or at a zero label.  Labels past BGP_MAX_LABELS are skipped.
+     *
+     * \param [in]   data       Pointer to the first label
+     * \param [in]   len        Length of the label, RD and prefix data in bytes
+     * \param [out]  labels     Label stack
+     *
+     * \return number of bytes of the labels
+     */
+    size_t decodeLabels(const u_char *data, size_t len, label_stack &labels);
+
+    /**
+     * Print a label stack as label,label,...
+     *
+     * \param [in]   labels     Label stack
+     * \param [out]  buf        Buffer of at least BGP_LABELS_STRLEN bytes
+     *
+     * \return Length of the printed labels, zero if not labeled
+     */
+    size_t formatLabels(const label_stack &labels, char *buf);
+
+    /**
+     * Print a route distinguisher
+     *
+     * \details The legacy form is the one published by previous versions, the administrator
+     *          subfield of type 0 and 2 is printed after the assigned number (e.g. 10065000:100
+     *          for 65000:100).  With rfc4364 it is administrator:assigned number (RFC4364
+     *          section 4.2).  Type 1 is printed the same by both.
+     *
+     * \param [in]   rd         Route distinguisher, 8 bytes in wire format
+     * \param [out]  buf        Buffer of at least BGP_RD_STRLEN bytes
+     * \param [in]   rfc4364    True to print administrator:assigned number, false for the legacy form
+     *
+     * \return Length of the printed route distinguisher
+     */
+    size_t formatRouteDistinguisher(const u_char *rd, char *buf, bool rfc4364=false);
+
+    /**
+     * Route distinguisher as it was hashed by the md5 hash ids of previous versions
+     *
+     * \details The administrator subfield of type 0 and 2 was printed after the assigned
+     *          number, the md5 hash ids hash that form to stay the same.
+     *
+     * \param [in]   rd         Route distinguisher, 8 bytes in wire format
+     * \param [out]  buf        Buffer of at least BGP_RD_STRLEN bytes
+     *
+     * \return Length of the hashed route distinguisher
+     */
+    size_t formatRouteDistinguisherHash(const u_char *rd, char *buf);
+
+    /**
+     * Print an ethernet segment identifier (RFC7432 section 5) as the type and its values
+     *
+     * \param [in]   esi        Ethernet segment identifier, 10 bytes in wire format
+     * \param [out]  buf        Buffer of at least BGP_ESI_STRLEN bytes
+     *
+     * \return Length of the printed ESI
+     */
+    size_t formatEsi(const u_char *esi, char *buf);
+
+    /**
+     * Print a MAC address as xx:xx:xx:xx:xx:xx
+     *
+     * \param [in]   mac        MAC address, 6 bytes
+     * \param [out]  buf        Buffer of at least BGP_MAC_STRLEN bytes
+     *
+     * \return Length of the printed MAC, 17
+     */
+    size_t formatMac(const u_char *mac, char *buf);
+
+    /**
+     * Print bytes in lower case hex
+     *
+     * \param [in]   data       Bytes to print
+     * \param [in]   len        Number of bytes
+     * \param [out]  buf        Buffer of at least len * 2 + 1 bytes
+     *
+     * \return Length of the printed bytes
+     */
+    size_t formatHex(const u_char *data, size_t len, char *buf);
+
+} /* namespace bgp */
+
+#endif /* VPNKERNEL_H_ */
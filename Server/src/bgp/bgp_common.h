@@ -109,6 +109,16 @@ namespace bgp {
                 // Add BGP-LS types
     };
 
+    #define BGP_MAX_LABELS          8                       // Labels kept of a label stack, the others are skipped
+
+    /**
+     * MPLS label stack of a labeled NLRI (RFC3107), printed by formatLabels()
+     */
+    struct label_stack {
+        uint8_t       count;                ///< Number of labels, zero if not labeled
+        uint32_t      value[BGP_MAX_LABELS];  ///< 20 bit label values, top of the stack first
+    };
+
     /**
       * struct is used for nlri prefixes
       */
@@ -119,21 +129,19 @@ namespace bgp {
         */
         PREFIX_TYPE   type;                 ///< Prefix type - RIB type
         unsigned char len;                  ///< Length of prefix in bits
-        std::string   prefix;               ///< Printed form of the IP address
+        char          prefix[46];           ///< Printed form of the IP address
         uint8_t       prefix_bin[16];       ///< Prefix in binary form
         uint32_t      path_id;              ///< Path ID (add path draft-ietf-idr-add-paths-15)
         bool          isIPv4;               ///< True if IPv4, false if IPv6
 
-        std::string   labels;               ///< Labels in the format of label, label, ...
+        label_stack   labels;               ///< Labels of a labeled NLRI
     };
 
     /**
     * Struct for Route Distinguisher
     */
     struct rd_tuple {
-        std::string    rd_administrator_subfield;
-        std::string    rd_assigned_number;
-        uint8_t        rd_type;
+        u_char         rd[8];               ///< Route distinguisher in wire format, rd[1] is the type (RFC4364)
     };
      
     /**
@@ -147,16 +155,17 @@ namespace bgp {
     * Struct is used for evpn
     */
     struct evpn_tuple: prefix_tuple, rd_tuple {
-        std::string     ethernet_segment_identifier;
-        std::string     ethernet_tag_id_hex;
+        uint8_t         route_type;                         ///< Route type, zero if the route wasn't decoded
+        u_char          ethernet_segment_identifier[10];    ///< ESI in wire format (RFC7432 section 5)
+        u_char          ethernet_tag_id[4];
         uint8_t         mac_len;
-        std::string     mac;
+        u_char          mac[6];
         uint8_t         ip_len;
-        std::string     ip;
+        u_char          ip[16];
         int             mpls_label_1;
         int             mpls_label_2;
         uint8_t         originating_router_ip_len;
-        std::string     originating_router_ip;
+        u_char          originating_router_ip[16];
     };
 
     /*********************************************************************//**
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef LSATTRTABLE_H_
+#define LSATTRTABLE_H_
+
+#include <sys/types.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bgp_msg {
+
+#define LS_ATTR_TABLE_RESERVE   32              ///< Initial number of attributes reserved
+#define LS_ATTR_STORE_RESERVE   2048            ///< Initial number of bytes reserved for decoded values
+
+/**
+ * \class   LsAttrTable
+ *
+ * \brief   Parsed BGP-LS attributes of an update
+ * \details Each attribute is either a view of the TLV value in the update buffer (e.g. router
+ *          ids) or a decoded value (host order numbers, printed SIDs) stored back to back in
+ *          the table store.  Attributes are looked up by a linear scan, an update has only a
+ *          handful of them.
+ *
+ *          Views are only valid while the update buffer is; the table is cleared (keeping its
+ *          capacity) after each update.
+ */
+class LsAttrTable {
+public:
+    LsAttrTable() {
+        tlvs.reserve(LS_ATTR_TABLE_RESERVE);
+        store.reserve(LS_ATTR_STORE_RESERVE);
+    }
+
+    /**
+     * Remove all attributes
+     */
+    void clear() {
+        tlvs.clear();
+        store.clear();
+    }
+
+    /**
+     * Swap the attributes and storage with another table
+     */
+    void swap(LsAttrTable &other) {
+        tlvs.swap(other.tlvs);
+        store.swap(other.store);
+    }
+
+    /**
+     * Check if the table has an attribute
+     *
+     * \param [in] type     Attribute type
+     */
+    bool has(uint16_t type) const {
+        return find(type) != NULL;
+    }
+
+    /**
+     * Set an attribute to a view of the update buffer, replaces a previous value
+     *
+     * \param [in] type     Attribute type
+     * \param [in] value    Pointer to the value in the update buffer
+     * \param [in] len      Length of the value
+     */
+    void setView(uint16_t type, const u_char *value, uint16_t len) {
+        Tlv *tlv = get(type);
+
+        tlv->view = value;
+        tlv->len = len;
+    }
+
+    /**
+     * Set an attribute to a decoded value, replaces a previous value
+     *
+     * \param [in] type     Attribute type
+     * \param [in] value    Value to copy into the table store
+     * \param [in] len      Length of the value
+     */
+    void set(uint16_t type, const void *value, uint16_t len) {
+        Tlv *tlv = get(type);
+
+        tlv->view = NULL;
+        tlv->offset = store.size();
+        tlv->len = len;
+        store.insert(store.end(), (const u_char *)value, (const u_char *)value + len);
+    }
+
+    /**
+     * Set an attribute to a string, without the terminating null
+     *
+     * \param [in] type     Attribute type
+     * \param [in] value    String value
+     */
+    void setString(uint16_t type, const std::string &value) {
+        set(type, value.data(), value.size() < UINT16_MAX ? value.size() : UINT16_MAX);
+    }
+
+    /**
+     * Append to a string attribute, used for attributes that can be repeated
+     *
+     * \param [in] type     Attribute type
+     * \param [in] value    String to append
+     * \param [in] sep      Separator added before value if the attribute is already set
+     */
+    void appendString(uint16_t type, const std::string &value, const char *sep) {
+        const Tlv   *tlv = find(type);
+        std::string str;
+
+        if (tlv == NULL) {
+            setString(type, value);
+            return;
+        }
+
+        str.assign((const char *)data(*tlv), tlv->len);
+        str.append(sep);
+        str.append(value);
+
+        setString(type, str);
+    }
+
+    /**
+     * Copy an attribute value
+     *
+     * \details The value is truncated to size, the remainder of dst is zero filled.
+     *
+     * \param [in]  type    Attribute type
+     * \param [out] dst     Buffer to copy the value to
+     * \param [in]  size    Size of dst
+     *
+     * \return true if the attribute is set, false if not (dst is not changed)
+     */
+    bool copy(uint16_t type, void *dst, size_t size) const {
+        const Tlv   *tlv = find(type);
+        size_t      len;
+
+        if (tlv == NULL)
+            return false;
+
+        len = tlv->len < size ? tlv->len : size;
+        memcpy(dst, data(*tlv), len);
+        memset((u_char *)dst + len, 0, size - len);
+
+        return true;
+    }
+
+    /**
+     * Copy an attribute value as a null terminated string
+     *
+     * \details The value is truncated to size - 1, the remainder of dst is zero filled.
+     *
+     * \param [in]  type    Attribute type
+     * \param [out] dst     Buffer to copy the string to
+     * \param [in]  size    Size of dst, must be > 0
+     *
+     * \return true if the attribute is set, false if not (dst is not changed)
+     */
+    bool copyString(uint16_t type, char *dst, size_t size) const {
+        const Tlv   *tlv = find(type);
+        size_t      len;
+
+        if (tlv == NULL)
+            return false;
+
+        len = strnlen((const char *)data(*tlv), tlv->len < size - 1 ? tlv->len : size - 1);
+        memcpy(dst, data(*tlv), len);
+        memset(dst + len, 0, size - len);
+
+        return true;
+    }
+
+private:
+    /**
+     * Attribute entry
+     */
+    struct Tlv {
+        uint16_t        type;               ///< Attribute type
+        uint16_t        len;                ///< Length of the value
+        const u_char    *view;              ///< Value in the update buffer, NULL if in the store
+        size_t          offset;             ///< Offset of the value in the store when view is NULL
+    };
+
+    std::vector<Tlv>        tlvs;           ///< Attributes in the order they were set
+    std::vector<u_char>     store;          ///< Decoded values
+
+    /**
+     * Find an attribute
+     *
+     * \return pointer to the attribute or NULL if not found
+     */
+    const Tlv *find(uint16_t type) const {
+        for (size_t i = 0; i < tlvs.size(); i++) {
+            if (tlvs[i].type == type)
+                return &tlvs[i];
+        }
+
+        return NULL;
+    }
+
+    /**
+     * Get the entry of an attribute, adds it if not found
+     */
+    Tlv *get(uint16_t type) {
+        Tlv *tlv = (Tlv *)find(type);
+
+        if (tlv == NULL) {
+            tlvs.emplace_back();
+            tlv = &tlvs.back();
+            tlv->type = type;
+        }
+
+        return tlv;
+    }
+
+    /**
+     * Pointer to the value of an attribute
+     */
+    const u_char *data(const Tlv &tlv) const {
+        return tlv.view != NULL ? tlv.view : store.data() + tlv.offset;
+    }
+};
+
+} /* namespace bgp_msg */
+
+#endif /* LSATTRTABLE_H_ */
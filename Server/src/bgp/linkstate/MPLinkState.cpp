@@ -9,7 +9,7 @@
 #include <arpa/inet.h>
 
 #include "MPLinkState.h"
-#include "md5.h"
+#include "HashEngine.h"
 
 namespace bgp_msg {
     /**
@@ -22,7 +22,7 @@ namespace bgp_msg {
      * \param [out]    parsed_data  Reference to parsed_update_data; will be updated with all parsed data
      * \param [in]     enable_debug Debug true to enable, false to disable
      */
-    MPLinkState::MPLinkState(Logger *logPtr, std::string peerAddr,
+    MPLinkState::MPLinkState(Logger *logPtr, const char *peerAddr,
                              UpdateMsg::parsed_update_data *parsed_data, bool enable_debug) {
         logger = logPtr;
         debug = enable_debug;
@@ -56,7 +56,7 @@ namespace bgp_msg {
             inet_ntop(AF_INET6, ip_raw, ip_char, sizeof(ip_char));
         }
 
-        parsed_data->attrs[ATTR_TYPE_NEXT_HOP] = std::string(ip_char);
+        parsed_data->attrs.setNextHop(ip_char);
 
         /*
          * Decode based on SAFI
@@ -69,7 +69,7 @@ namespace bgp_msg {
 
             default :
                 LOG_INFO("%s: MP_UNREACH AFI=bgp-ls SAFI=%d is not implemented yet, skipping for now",
-                        peer_addr.c_str(), nlri.afi, nlri.safi);
+                        peer_addr, nlri.afi, nlri.safi);
                 return;
         }
     }
@@ -96,7 +96,7 @@ namespace bgp_msg {
 
             default :
                 LOG_INFO("%s: MP_UNREACH AFI=bgp-ls SAFI=%d is not implemented yet, skipping for now",
-                        peer_addr.c_str(), nlri.afi, nlri.safi);
+                        peer_addr, nlri.afi, nlri.safi);
                 return;
         }
     }
@@ -134,7 +134,7 @@ namespace bgp_msg {
 
             if (nlri_len > len) {
                 LOG_NOTICE("%s: bgp-ls: failed to parse link state NLRI; length is larger than available data",
-                        peer_addr.c_str());
+                        peer_addr);
                 return;
             }
 
@@ -156,28 +156,28 @@ namespace bgp_msg {
              */
             switch (nlri_type) {
                 case NLRI_TYPE_NODE:
-                    SELF_DEBUG("%s: bgp-ls: parsing NODE NLRI len=%d", peer_addr.c_str(), nlri_len);
+                    SELF_DEBUG("%s: bgp-ls: parsing NODE NLRI len=%d", peer_addr, nlri_len);
                     parseNlriNode(data, nlri_len, id, proto_id);
                     break;
 
                 case NLRI_TYPE_LINK:
-                    SELF_DEBUG("%s: bgp-ls: parsing LINK NLRI", peer_addr.c_str());
+                    SELF_DEBUG("%s: bgp-ls: parsing LINK NLRI", peer_addr);
                     parseNlriLink(data, nlri_len, id, proto_id);
                     break;
 
                 case NLRI_TYPE_IPV4_PREFIX:
-                    SELF_DEBUG("%s: bgp-ls: parsing IPv4 PREFIX NLRI", peer_addr.c_str());
+                    SELF_DEBUG("%s: bgp-ls: parsing IPv4 PREFIX NLRI", peer_addr);
                     parseNlriPrefix(data, nlri_len, id, proto_id, true);
                     break;
 
                 case NLRI_TYPE_IPV6_PREFIX:
-                    SELF_DEBUG("%s: bgp-ls: parsing IPv6 PREFIX NLRI", peer_addr.c_str());
+                    SELF_DEBUG("%s: bgp-ls: parsing IPv6 PREFIX NLRI", peer_addr);
                     parseNlriPrefix(data, nlri_len, id, proto_id, false);
                     break;
 
                 default :
                     LOG_INFO("%s: bgp-ls NLRI Type %d is not implemented yet, skipping for now",
-                            peer_addr.c_str(), nlri_type);
+                            peer_addr, nlri_type);
                     return;
             }
 
@@ -251,14 +251,14 @@ namespace bgp_msg {
         bzero(&node_tbl, sizeof(node_tbl));
 
         if (data_len < 4) {
-            LOG_WARN("%s: bgp-ls: Unable to parse node NLRI since it's too short (invalid)", peer_addr.c_str());
+            LOG_WARN("%s: bgp-ls: Unable to parse node NLRI since it's too short (invalid)", peer_addr);
             return;
         }
 
         node_tbl.id       = id;
         snprintf(node_tbl.protocol, sizeof(node_tbl.protocol), "%s", decodeNlriProtocolId(proto_id).c_str());
 
-        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, node_tbl.protocol);
+        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr, id, node_tbl.protocol);
 
         /*
          * Parse the local node descriptor sub-tlv
@@ -278,13 +278,13 @@ namespace bgp_msg {
 
         if (len > data_len) {
             LOG_WARN("%s: bgp-ls: failed to parse node descriptor; type length is larger than available data %d>=%d",
-                    peer_addr.c_str(), len, data_len);
+                    peer_addr, len, data_len);
             return;
         }
 
         if (type != NODE_DESCR_LOCAL_DESCR) {
             LOG_WARN("%s: bgp-ls: failed to parse node descriptor; Type (%d) is not local descriptor",
-                    peer_addr.c_str(), type);
+                    peer_addr, type);
             return;
         }
 
@@ -329,14 +329,14 @@ namespace bgp_msg {
         bzero(&link_tbl, sizeof(link_tbl));
 
         if (data_len < 4) {
-            LOG_WARN("%s: bgp-ls: Unable to parse link NLRI since it's too short (invalid)", peer_addr.c_str());
+            LOG_WARN("%s: bgp-ls: Unable to parse link NLRI since it's too short (invalid)", peer_addr);
             return;
         }
 
         link_tbl.id       = id;
         snprintf(link_tbl.protocol, sizeof(link_tbl.protocol), "%s", decodeNlriProtocolId(proto_id).c_str());
 
-        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, link_tbl.protocol);
+        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr, id, link_tbl.protocol);
 
         /*
          * Parse local and remote node descriptors (expect both)
@@ -357,7 +357,7 @@ namespace bgp_msg {
 
             if (len > data_len) {
                 LOG_WARN("%s: bgp-ls: failed to parse node descriptor; type length is larger than available data %d>=%d",
-                        peer_addr.c_str(), len, data_len);
+                        peer_addr, len, data_len);
                 return;
             }
 
@@ -393,7 +393,7 @@ namespace bgp_msg {
 
                 default:
                     LOG_WARN("%s: bgp-ls: failed to parse node descriptor; Type (%d) is not local descriptor",
-                            peer_addr.c_str(), type);
+                            peer_addr, type);
                      break;
             }
         }
@@ -440,14 +440,14 @@ namespace bgp_msg {
         bzero(&prefix_tbl, sizeof(prefix_tbl));
 
         if (data_len < 4) {
-            LOG_WARN("%s: bgp-ls: Unable to parse prefix NLRI since it's too short (invalid)", peer_addr.c_str());
+            LOG_WARN("%s: bgp-ls: Unable to parse prefix NLRI since it's too short (invalid)", peer_addr);
             return;
         }
 
         prefix_tbl.id       = id;
         snprintf(prefix_tbl.protocol, sizeof(prefix_tbl.protocol), "%s", decodeNlriProtocolId(proto_id).c_str());
 
-        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr.c_str(), id, prefix_tbl.protocol);
+        SELF_DEBUG("%s: bgp-ls: ID = %x Protocol = %s", peer_addr, id, prefix_tbl.protocol);
 
         /*
          * Parse the local node descriptor sub-tlv
@@ -467,13 +467,13 @@ namespace bgp_msg {
 
         if (len > data_len) {
             LOG_WARN("%s: bgp-ls: failed to parse node descriptor; type length is larger than available data %d>=%d",
-                    peer_addr.c_str(), len, data_len);
+                    peer_addr, len, data_len);
             return;
         }
 
         if (type != NODE_DESCR_LOCAL_DESCR) {
             LOG_WARN("%s: bgp-ls: failed to parse node descriptor; Type (%d) is not local descriptor",
-                    peer_addr.c_str(), type);
+                    peer_addr, type);
             return;
         }
 
@@ -538,7 +538,7 @@ namespace bgp_msg {
 
         if (data_len < 4) {
             LOG_NOTICE("%s: bgp-ls: failed to parse node descriptor; too short",
-                        peer_addr.c_str());
+                        peer_addr);
             return data_len;
         }
 
@@ -548,11 +548,11 @@ namespace bgp_msg {
         memcpy(&len, data+2, 2);
         bgp::SWAP_BYTES(&len);
 
-        //SELF_DEBUG("%s: bgp-ls: Parsing node descriptor type %d len %d", peer_addr.c_str(), type, len);
+        //SELF_DEBUG("%s: bgp-ls: Parsing node descriptor type %d len %d", peer_addr, type, len);
 
         if (len > data_len - 4) {
             LOG_NOTICE("%s: bgp-ls: failed to parse node descriptor; type length is larger than available data %d>=%d",
-                        peer_addr.c_str(), len, data_len);
+                        peer_addr, len, data_len);
             return data_len;
         }
 
@@ -563,7 +563,7 @@ namespace bgp_msg {
             {
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse node descriptor AS sub-tlv; too short",
-                                peer_addr.c_str());
+                                peer_addr);
                     data_read += len;
                     break;
                 }
@@ -572,7 +572,7 @@ namespace bgp_msg {
                 bgp::SWAP_BYTES(&info.asn);
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor AS = %u", peer_addr.c_str(), info.asn);
+                SELF_DEBUG("%s: bgp-ls: Node descriptor AS = %u", peer_addr, info.asn);
 
                 break;
             }
@@ -581,7 +581,7 @@ namespace bgp_msg {
             {
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse node descriptor BGP-LS ID sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len;
                     break;
                 }
@@ -591,7 +591,7 @@ namespace bgp_msg {
                 bgp::SWAP_BYTES(&info.bgp_ls_id);
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor BGP-LS ID = %08X", peer_addr.c_str(), info.bgp_ls_id);
+                SELF_DEBUG("%s: bgp-ls: Node descriptor BGP-LS ID = %08X", peer_addr, info.bgp_ls_id);
                 break;
             }
 
@@ -599,7 +599,7 @@ namespace bgp_msg {
             {
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse node descriptor OSPF Area ID sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len <= data_len ? len : data_len;
                     break;
                 }
@@ -610,7 +610,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET, info.ospf_area_Id, ipv4_char, sizeof(ipv4_char));
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor OSPF Area ID = %s", peer_addr.c_str(), ipv4_char);
+                SELF_DEBUG("%s: bgp-ls: Node descriptor OSPF Area ID = %s", peer_addr, ipv4_char);
                 break;
             }
 
@@ -618,7 +618,7 @@ namespace bgp_msg {
             {
                 if (len > data_len or len > 8) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse node descriptor IGP Router ID sub-tlv; len (%d) is invalid",
-                            peer_addr.c_str(), len);
+                            peer_addr, len);
                     data_read += len;
                     break;
                 }
@@ -627,7 +627,7 @@ namespace bgp_msg {
                 memcpy(info.igp_router_id, data, len);
                 data_read += len;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor IGP Router ID %d = %d.%d.%d.%d (%02x%02x.%02x%02x.%02x%02x.%02x %02x)", peer_addr.c_str(), data_read,
+                SELF_DEBUG("%s: bgp-ls: Node descriptor IGP Router ID %d = %d.%d.%d.%d (%02x%02x.%02x%02x.%02x%02x.%02x %02x)", peer_addr, data_read,
                             info.igp_router_id[0], info.igp_router_id[1], info.igp_router_id[2], info.igp_router_id[3],
                         info.igp_router_id[0], info.igp_router_id[1], info.igp_router_id[2], info.igp_router_id[3],
                         info.igp_router_id[4], info.igp_router_id[5], info.igp_router_id[6], info.igp_router_id[7]);
@@ -638,7 +638,7 @@ namespace bgp_msg {
             {
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse node descriptor BGP Router ID sub-tlv; too short",
-                               peer_addr.c_str());
+                               peer_addr);
                     data_read += len <= data_len ? len : data_len;
                     break;
                 }
@@ -649,13 +649,13 @@ namespace bgp_msg {
                 inet_ntop(AF_INET, &info.bgp_router_id, ipv4_char, sizeof(ipv4_char));
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Node descriptor BGP Router-ID = %s", peer_addr.c_str(), ipv4_char);
+                SELF_DEBUG("%s: bgp-ls: Node descriptor BGP Router-ID = %s", peer_addr, ipv4_char);
                 break;
             }
 
             default:
                 LOG_NOTICE("%s: bgp-ls: node descriptor sub-tlv %d not yet implemented, skipping.",
-                            peer_addr.c_str(), type);
+                            peer_addr, type);
                 data_read += len;
                 break;
         }
@@ -681,7 +681,7 @@ namespace bgp_msg {
 
         if (data_len < 4) {
             LOG_NOTICE("%s: bgp-ls: failed to parse link descriptor; too short",
-                    peer_addr.c_str());
+                    peer_addr);
             return data_len;
         }
 
@@ -693,7 +693,7 @@ namespace bgp_msg {
 
         if (len > data_len - 4) {
             LOG_NOTICE("%s: bgp-ls: failed to parse link descriptor; type length is larger than available data %d>=%d",
-                    peer_addr.c_str(), len, data_len);
+                    peer_addr, len, data_len);
             return data_len;
         }
 
@@ -704,7 +704,7 @@ namespace bgp_msg {
             {
                 if (len != 8) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse link ID descriptor sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len;
                     break;
                 }
@@ -713,7 +713,7 @@ namespace bgp_msg {
                 memcpy(&info.remote_id, data+4, 4); bgp::SWAP_BYTES(&info.remote_id);
                 data_read += 8;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor ID local = %08x remote = %08x", peer_addr.c_str(), info.local_id, info.remote_id);
+                SELF_DEBUG("%s: bgp-ls: Link descriptor ID local = %08x remote = %08x", peer_addr, info.local_id, info.remote_id);
 
                 break;
             }
@@ -722,14 +722,14 @@ namespace bgp_msg {
             {
                 if (len < 2) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse link MT-ID descriptor sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len;
                     break;
                 }
 
                 if (len > 4) {
                     SELF_DEBUG("%s: bgp-ls: failed to parse link MT-ID descriptor sub-tlv; too long %d",
-                               peer_addr.c_str(), len);
+                               peer_addr, len);
                     info.mt_id = 0;
                     data_read += len;
                     break;
@@ -739,7 +739,7 @@ namespace bgp_msg {
                 info.mt_id >>= 16;          // MT ID is 16 bits
                 data_read += len;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor MT-ID = %08x ", peer_addr.c_str(), info.mt_id);
+                SELF_DEBUG("%s: bgp-ls: Link descriptor MT-ID = %08x ", peer_addr, info.mt_id);
 
                 break;
             }
@@ -750,7 +750,7 @@ namespace bgp_msg {
                 info.isIPv4 = true;
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse link descriptor interface IPv4 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len <= data_len ? len : data_len;
                     break;
                 }
@@ -760,7 +760,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET, info.intf_addr, ip_char, sizeof(ip_char));
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor Interface Address = %s", peer_addr.c_str(), ip_char);
+                SELF_DEBUG("%s: bgp-ls: Link descriptor Interface Address = %s", peer_addr, ip_char);
                 break;
             }
 
@@ -769,7 +769,7 @@ namespace bgp_msg {
                 info.isIPv4 = false;
                 if (len != 16) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse link descriptor interface IPv6 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len <= data_len ? len : data_len;
                     break;
                 }
@@ -779,7 +779,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET6, info.intf_addr, ip_char, sizeof(ip_char));
                 data_read += 16;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor interface address = %s", peer_addr.c_str(), ip_char);
+                SELF_DEBUG("%s: bgp-ls: Link descriptor interface address = %s", peer_addr, ip_char);
                 break;
             }
 
@@ -789,7 +789,7 @@ namespace bgp_msg {
 
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse link descriptor neighbor IPv4 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len <= data_len ? len : data_len;
                     break;
                 }
@@ -799,7 +799,7 @@ namespace bgp_msg {
                 inet_ntop(AF_INET, info.nei_addr, ip_char, sizeof(ip_char));
                 data_read += 4;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor neighbor address = %s", peer_addr.c_str(), ip_char);
+                SELF_DEBUG("%s: bgp-ls: Link descriptor neighbor address = %s", peer_addr, ip_char);
                 break;
             }
 
@@ -808,7 +808,7 @@ namespace bgp_msg {
                 info.isIPv4 = false;
                 if (len != 16) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse link descriptor neighbor IPv6 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len <= data_len ? len : data_len;
                     break;
                 }
@@ -818,14 +818,14 @@ namespace bgp_msg {
                 inet_ntop(AF_INET6, info.nei_addr, ip_char, sizeof(ip_char));
                 data_read += 16;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor neighbor address = %s", peer_addr.c_str(), ip_char);
+                SELF_DEBUG("%s: bgp-ls: Link descriptor neighbor address = %s", peer_addr, ip_char);
                 break;
             }
 
 
             default:
                 LOG_NOTICE("%s: bgp-ls: link descriptor sub-tlv %d not yet implemented, skipping",
-                        peer_addr.c_str(), type);
+                        peer_addr, type);
                 data_read += len;
                 break;
         }
@@ -851,7 +851,7 @@ namespace bgp_msg {
 
         if (data_len < 4) {
             LOG_NOTICE("%s: bgp-ls: failed to parse link descriptor; too short",
-                    peer_addr.c_str());
+                    peer_addr);
             return data_len;
         }
 
@@ -863,7 +863,7 @@ namespace bgp_msg {
 
         if (len > data_len - 4) {
             LOG_NOTICE("%s: bgp-ls: failed to parse prefix descriptor; type length is larger than available data %d>=%d",
-                    peer_addr.c_str(), len, data_len);
+                    peer_addr, len, data_len);
             return data_len;
         }
 
@@ -876,7 +876,7 @@ namespace bgp_msg {
 
                 if (len < 1) {
                     LOG_INFO("%s: bgp-ls: Not parsing prefix ip_reach_info sub-tlv; too short at len=%d",
-                               peer_addr.c_str(), len);
+                               peer_addr, len);
                     data_read += len;
                     break;
                 }
@@ -943,21 +943,21 @@ namespace bgp_msg {
                         memcpy(info.prefix_bcast, info.prefix, sizeof(info.prefix_bcast));
                 }
 
-                SELF_DEBUG("%s: bgp-ls: prefix ip_reach_info: prefix = %s/%d", peer_addr.c_str(),
+                SELF_DEBUG("%s: bgp-ls: prefix ip_reach_info: prefix = %s/%d", peer_addr,
                             ip_char, info.prefix_len);
                 break;
             }
             case PREFIX_DESCR_MT_ID:
                 if (len < 2) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse prefix MT-ID descriptor sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     data_read += len;
                     break;
                 }
 
                 if (len > 4) {
                     SELF_DEBUG("%s: bgp-ls: failed to parse link MT-ID descriptor sub-tlv; too long %d",
-                               peer_addr.c_str(), len);
+                               peer_addr, len);
                     info.mt_id = 0;
                     data_read += len;
                     break;
@@ -968,7 +968,7 @@ namespace bgp_msg {
 
                 data_read += len;
 
-                SELF_DEBUG("%s: bgp-ls: Link descriptor MT-ID = %08x ", peer_addr.c_str(), info.mt_id);
+                SELF_DEBUG("%s: bgp-ls: Link descriptor MT-ID = %08x ", peer_addr, info.mt_id);
 
                 break;
 
@@ -1002,13 +1002,13 @@ namespace bgp_msg {
                     default:
                         snprintf(info.ospf_route_type, sizeof(info.ospf_route_type),"Intra");
                 }
-                SELF_DEBUG("%s: bgp-ls: prefix ospf route type is %s", peer_addr.c_str(), info.ospf_route_type);
+                SELF_DEBUG("%s: bgp-ls: prefix ospf route type is %s", peer_addr, info.ospf_route_type);
                 break;
             }
 
             default:
                 LOG_NOTICE("%s: bgp-ls: Prefix descriptor sub-tlv %d not yet implemented, skipping.",
-                        peer_addr.c_str(), type);
+                        peer_addr, type);
                 data_read += len;
                 break;
         }
@@ -1026,7 +1026,7 @@ namespace bgp_msg {
      * \param [out]  hash_bin       Node descriptor information returned/updated
      */
     void MPLinkState::genNodeHashId(node_descriptor &info) {
-        MD5 hash;
+        HashEngine hash;
 
         hash.update(info.igp_router_id, sizeof(info.igp_router_id));
         hash.update((unsigned char *)&info.bgp_ls_id, sizeof(info.bgp_ls_id));
@@ -1035,9 +1035,7 @@ namespace bgp_msg {
         hash.finalize();
 
         // Save the hash
-        unsigned char *hash_bin = hash.raw_digest();
-        memcpy(info.hash_bin, hash_bin, 16);
-        delete[] hash_bin;
+        hash.digest(info.hash_bin);
     }
 
 } /* namespace bgp_msg */
@@ -99,7 +99,7 @@ namespace bgp_msg {
      * \param [out]    parsed_data  Reference to parsed_update_data; will be updated with all parsed data
      * \param [in]     enable_debug Debug true to enable, false to disable
      */
-    MPLinkStateAttr::MPLinkStateAttr(Logger *logPtr, std::string peerAddr,
+    MPLinkStateAttr::MPLinkStateAttr(Logger *logPtr, const char *peerAddr,
             UpdateMsg::parsed_update_data *parsed_data, bool enable_debug) {
         logger = logPtr;
         debug = enable_debug;
@@ -244,7 +244,7 @@ namespace bgp_msg {
             val_ss << value_32bit;
 
         } else {
-            LOG_WARN("%s: bgp-ls: SID/Label has unexpected length of %d", peer_addr.c_str(), len);
+            LOG_WARN("%s: bgp-ls: SID/Label has unexpected length of %d", peer_addr, len);
             return "";
         }
 
@@ -273,7 +273,7 @@ namespace bgp_msg {
 
         if (attr_len < 4) {
             LOG_NOTICE("%s: bgp-ls: failed to parse attribute; too short",
-                    peer_addr.c_str());
+                    peer_addr);
             return attr_len;
         }
 
@@ -289,54 +289,59 @@ namespace bgp_msg {
             case ATTR_NODE_FLAG: {
                 if (len != 1) {
                     LOG_INFO("%s: bgp-ls: node flag attribute length is too long %d should be 1",
-                             peer_addr.c_str(), len);
+                             peer_addr, len);
                 }
 
                 std::string flags = this->parse_flags_to_string(*data, LS_FLAGS_NODE_NLRI, sizeof(LS_FLAGS_NODE_NLRI));
 
-                SELF_DEBUG("%s: bgp-ls: parsed node flags %s %x (len=%d)", peer_addr.c_str(), flags.c_str(), *data, len);
+                SELF_DEBUG("%s: bgp-ls: parsed node flags %s %x (len=%d)", peer_addr, flags.c_str(), *data, len);
 
-                parsed_data->ls_attrs[ATTR_NODE_FLAG].fill(0);
-                strncpy((char *)parsed_data->ls_attrs[ATTR_NODE_FLAG].data(), flags.c_str(), flags.size());
+                parsed_data->ls_attrs.setString(ATTR_NODE_FLAG, flags);
             }
             break;
 
             case ATTR_NODE_IPV4_ROUTER_ID_LOCAL:  // Includes ATTR_LINK_IPV4_ROUTER_ID_LOCAL
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse attribute local router id IPv4 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     break;
                 }
 
-                memcpy(parsed_data->ls_attrs[ATTR_NODE_IPV4_ROUTER_ID_LOCAL].data(), data, 4);
-                inet_ntop(AF_INET, parsed_data->ls_attrs[ATTR_NODE_IPV4_ROUTER_ID_LOCAL].data(), ip_char, sizeof(ip_char));
+                parsed_data->ls_attrs.setView(ATTR_NODE_IPV4_ROUTER_ID_LOCAL, data, 4);
+                inet_ntop(AF_INET, data, ip_char, sizeof(ip_char));
 
-                SELF_DEBUG("%s: bgp-ls: parsed local IPv4 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
+                SELF_DEBUG("%s: bgp-ls: parsed local IPv4 router id attribute: addr = %s", peer_addr, ip_char);
                 break;
 
             case ATTR_NODE_IPV6_ROUTER_ID_LOCAL:  // Includes ATTR_LINK_IPV6_ROUTER_ID_LOCAL
                 if (len != 16) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse attribute local router id IPv6 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     break;
                 }
 
-                memcpy(parsed_data->ls_attrs[ATTR_NODE_IPV6_ROUTER_ID_LOCAL].data(), data, 16);
-                inet_ntop(AF_INET6, parsed_data->ls_attrs[ATTR_NODE_IPV6_ROUTER_ID_LOCAL].data(), ip_char, sizeof(ip_char));
+                parsed_data->ls_attrs.setView(ATTR_NODE_IPV6_ROUTER_ID_LOCAL, data, 16);
+                inet_ntop(AF_INET6, data, ip_char, sizeof(ip_char));
 
-                SELF_DEBUG("%s: bgp-ls: parsed local IPv6 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
+                SELF_DEBUG("%s: bgp-ls: parsed local IPv6 router id attribute: addr = %s", peer_addr, ip_char);
                 break;
 
-            case ATTR_NODE_ISIS_AREA_ID:
+            case ATTR_NODE_ISIS_AREA_ID: {
+                // Area ID is zero padded to 8 bytes, the last byte is the length
+                uint8_t area_id[9] = { 0 };
+
                 if (len <= 8)
-                    memcpy(parsed_data->ls_attrs[ATTR_NODE_ISIS_AREA_ID].data(), data, len);
-                parsed_data->ls_attrs[ATTR_NODE_ISIS_AREA_ID].data()[8] = len;
+                    memcpy(area_id, data, len);
+                area_id[8] = len;
+
+                parsed_data->ls_attrs.set(ATTR_NODE_ISIS_AREA_ID, area_id, sizeof(area_id));
 
-                SELF_DEBUG("%s: bgp-ls: parsed node ISIS area id %x (len=%d)", peer_addr.c_str(), value_32bit, len);
+                SELF_DEBUG("%s: bgp-ls: parsed node ISIS area id %x (len=%d)", peer_addr, value_32bit, len);
                 break;
+            }
 
             case ATTR_NODE_MT_ID:
-                SELF_DEBUG("%s: bgp-ls: parsing node MT ID attribute (len=%d)", peer_addr.c_str(), len);
+                SELF_DEBUG("%s: bgp-ls: parsing node MT ID attribute (len=%d)", peer_addr, len);
 
                 val_ss.str(std::string());  // Clear
 
@@ -352,20 +357,19 @@ namespace bgp_msg {
                         val_ss << ", " << value_16bit;
                 }
 
-                strncpy((char *)parsed_data->ls_attrs[ATTR_NODE_MT_ID].data(), val_ss.str().data(), val_ss.str().length()+1);
-                // LOG_INFO("%s: bgp-ls: parsed node MT_ID %s (len=%d)", peer_addr.c_str(), val_ss.str().c_str(), len);
+                parsed_data->ls_attrs.setString(ATTR_NODE_MT_ID, val_ss.str());
+                // LOG_INFO("%s: bgp-ls: parsed node MT_ID %s (len=%d)", peer_addr, val_ss.str().c_str(), len);
                 break;
 
             case ATTR_NODE_NAME:
-                parsed_data->ls_attrs[ATTR_NODE_NAME].fill(0);
-                strncpy((char *)parsed_data->ls_attrs[ATTR_NODE_NAME].data(), (char *)data, len);
+                parsed_data->ls_attrs.setView(ATTR_NODE_NAME, data, len);
 
-                SELF_DEBUG("%s: bgp-ls: parsed node name attribute: name = %s", peer_addr.c_str(),
-                           parsed_data->ls_attrs[ATTR_NODE_NAME].data());
+                SELF_DEBUG("%s: bgp-ls: parsed node name attribute: name = %.*s", peer_addr,
+                           len, (char *)data);
                 break;
 
             case ATTR_NODE_OPAQUE:
-                LOG_INFO("%s: bgp-ls: opaque node attribute (len=%d), not yet implemented", peer_addr.c_str(), len);
+                LOG_INFO("%s: bgp-ls: opaque node attribute (len=%d), not yet implemented", peer_addr, len);
                 break;
 
             case ATTR_NODE_SR_CAPABILITIES: {
@@ -435,34 +439,34 @@ namespace bgp_msg {
 
                         } else {
                             LOG_NOTICE("%s: bgp-ls: parsed node sr capabilities, sid label size is unexpected",
-                                       peer_addr.c_str());
+                                       peer_addr);
                             break;
                         }
                     } else {
                         LOG_NOTICE("%s: bgp-ls: parsed node sr capabilities, SUB TLV type %d is unexpected",
-                                   peer_addr.c_str(), type);
+                                   peer_addr, type);
                         break;
                     }
                 }
-                SELF_DEBUG("%s: bgp-ls: parsed node sr capabilities (len=%d) %s", peer_addr.c_str(), len, val_ss.str().c_str());
+                SELF_DEBUG("%s: bgp-ls: parsed node sr capabilities (len=%d) %s", peer_addr, len, val_ss.str().c_str());
 
-                memcpy(parsed_data->ls_attrs[ATTR_NODE_SR_CAPABILITIES].data(), val_ss.str().data(), val_ss.str().length());
+                parsed_data->ls_attrs.setString(ATTR_NODE_SR_CAPABILITIES, val_ss.str());
                 break;
             }
 
             case ATTR_LINK_ADMIN_GROUP:
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse attribute link admin group sub-tlv, size not 4",
-                            peer_addr.c_str());
+                            peer_addr);
                     break;
                 } else {
                     value_32bit = 0;
                     memcpy(&value_32bit, data, len);
                     bgp::SWAP_BYTES(&value_32bit, len);
-                    memcpy(parsed_data->ls_attrs[ATTR_LINK_ADMIN_GROUP].data(), &value_32bit, 4);
+                    parsed_data->ls_attrs.set(ATTR_LINK_ADMIN_GROUP, &value_32bit, 4);
                     SELF_DEBUG("%s: bgp-ls: parsed linked admin group attribute: "
                                " 0x%x, len = %d",
-                               peer_addr.c_str(), value_32bit, len);
+                               peer_addr, value_32bit, len);
                 }
                 break;
 
@@ -471,41 +475,41 @@ namespace bgp_msg {
                     value_32bit = 0;
                     memcpy(&value_32bit, data, len);
                     bgp::SWAP_BYTES(&value_32bit, len);
-                    memcpy(parsed_data->ls_attrs[ATTR_LINK_IGP_METRIC].data(), &value_32bit, 4);
-                    SELF_DEBUG("%s: bgp-ls: parsed link IGP metric attribute: metric = %u", peer_addr.c_str(), value_32bit);
+                    parsed_data->ls_attrs.set(ATTR_LINK_IGP_METRIC, &value_32bit, 4);
+                    SELF_DEBUG("%s: bgp-ls: parsed link IGP metric attribute: metric = %u", peer_addr, value_32bit);
                 }
                 break;
 
             case ATTR_LINK_IPV4_ROUTER_ID_REMOTE:
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse attribute remote IPv4 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     break;
                 }
 
-                memcpy(parsed_data->ls_attrs[ATTR_LINK_IPV4_ROUTER_ID_REMOTE].data(), data, 4);
-                inet_ntop(AF_INET, parsed_data->ls_attrs[ATTR_LINK_IPV4_ROUTER_ID_REMOTE].data(), ip_char, sizeof(ip_char));
+                parsed_data->ls_attrs.setView(ATTR_LINK_IPV4_ROUTER_ID_REMOTE, data, 4);
+                inet_ntop(AF_INET, data, ip_char, sizeof(ip_char));
 
-                SELF_DEBUG("%s: bgp-ls: parsed remote IPv4 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
+                SELF_DEBUG("%s: bgp-ls: parsed remote IPv4 router id attribute: addr = %s", peer_addr, ip_char);
                 break;
 
             case ATTR_LINK_IPV6_ROUTER_ID_REMOTE:
                 if (len != 16) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse attribute remote router id IPv6 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     break;
                 }
 
-                memcpy(parsed_data->ls_attrs[ATTR_LINK_IPV6_ROUTER_ID_REMOTE].data(), data, 16);
-                inet_ntop(AF_INET6, parsed_data->ls_attrs[ATTR_LINK_IPV6_ROUTER_ID_REMOTE].data(), ip_char, sizeof(ip_char));
+                parsed_data->ls_attrs.setView(ATTR_LINK_IPV6_ROUTER_ID_REMOTE, data, 16);
+                inet_ntop(AF_INET6, data, ip_char, sizeof(ip_char));
 
-                SELF_DEBUG("%s: bgp-ls: parsed remote IPv6 router id attribute: addr = %s", peer_addr.c_str(), ip_char);
+                SELF_DEBUG("%s: bgp-ls: parsed remote IPv6 router id attribute: addr = %s", peer_addr, ip_char);
                 break;
 
             case ATTR_LINK_MAX_LINK_BW:
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse attribute maximum link bandwidth sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     break;
                 }
 
@@ -513,55 +517,50 @@ namespace bgp_msg {
                 memcpy(&float_val, data, len);
                 bgp::SWAP_BYTES(&float_val, len);
                 float_val = ieee_float_to_kbps(float_val);
-                memcpy(parsed_data->ls_attrs[ATTR_LINK_MAX_LINK_BW].data(), &float_val, 4);
+                parsed_data->ls_attrs.set(ATTR_LINK_MAX_LINK_BW, &float_val, 4);
 
                 memcpy(&value_32bit, data, 4);
                 bgp::SWAP_BYTES(&value_32bit);
                 SELF_DEBUG("%s: bgp-ls: parsed attribute maximum link bandwidth (raw=%x) %u Kbits (len=%d)",
-                           peer_addr.c_str(), value_32bit, *(int32_t *)&float_val, len);
+                           peer_addr, value_32bit, *(int32_t *)&float_val, len);
                 break;
 
             case ATTR_LINK_MAX_RESV_BW:
                 if (len != 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse attribute remote IPv4 sub-tlv; too short",
-                            peer_addr.c_str());
+                            peer_addr);
                     break;
                 }
                 float_val = 0;
                 memcpy(&float_val, data, len);
                 bgp::SWAP_BYTES(&float_val, len);
                 float_val = ieee_float_to_kbps(float_val);
-                memcpy(parsed_data->ls_attrs[ATTR_LINK_MAX_RESV_BW].data(), &float_val, 4);
+                parsed_data->ls_attrs.set(ATTR_LINK_MAX_RESV_BW, &float_val, 4);
                 SELF_DEBUG("%s: bgp-ls: parsed attribute maximum reserved bandwidth %u Kbits (len=%d)",
-                    peer_addr.c_str(), *(uint32_t *)&float_val, len);
+                    peer_addr, *(uint32_t *)&float_val, len);
                 break;
 
             case ATTR_LINK_MPLS_PROTO_MASK:
                 // SELF_DEBUG("%s: bgp-ls: parsing link MPLS Protocol mask attribute", peer_ad dr.c_str());
-                LOG_INFO("%s: bgp-ls: link MPLS Protocol mask attribute, not yet implemented", peer_addr.c_str());
+                LOG_INFO("%s: bgp-ls: link MPLS Protocol mask attribute, not yet implemented", peer_addr);
                 break;
 
             case ATTR_LINK_PROTECTION_TYPE:
-                // SELF_DEBUG("%s: bgp-ls: parsing link protection type attribute", peer_addr.c_str());
-                LOG_INFO("%s: bgp-ls: link protection type attribute, not yet implemented", peer_addr.c_str());
+                // SELF_DEBUG("%s: bgp-ls: parsing link protection type attribute", peer_addr);
+                LOG_INFO("%s: bgp-ls: link protection type attribute, not yet implemented", peer_addr);
                 break;
 
             case ATTR_LINK_NAME: {
-                parsed_data->ls_attrs[ATTR_LINK_NAME].fill(0);
-                strncpy((char *)parsed_data->ls_attrs[ATTR_LINK_NAME].data(), (char *)data, len);
+                parsed_data->ls_attrs.setView(ATTR_LINK_NAME, data, len);
 
-                SELF_DEBUG("%s: bgp-ls: parsing link name attribute: name = %s",
-                    peer_addr.c_str(), parsed_data->ls_attrs[ATTR_LINK_NAME].data());
+                SELF_DEBUG("%s: bgp-ls: parsing link name attribute: name = %.*s",
+                    peer_addr, len, (char *)data);
                 break;
             }
             
             case ATTR_LINK_ADJACENCY_SID: {
                 val_ss.str(std::string());
 
-                // There can be more than one adj sid, append as list
-                if (strlen((char *)parsed_data->ls_attrs[ATTR_LINK_ADJACENCY_SID].data()) > 0)
-                    val_ss << ", ";
-
                 // Decode flags
                 if (strcmp(parsed_data->ls.links.front().protocol, "IS-IS") >= 0) {
                     val_ss << this->parse_flags_to_string(*data,
@@ -585,18 +584,16 @@ namespace bgp_msg {
                 // Parse the sid/value
                 val_ss << " " << parse_sid_value(data, len - 4);
 
-                SELF_DEBUG("%s: bgp-ls: parsed sr link adjacency segment identifier %s", peer_addr.c_str(), val_ss.str().c_str());
+                SELF_DEBUG("%s: bgp-ls: parsed sr link adjacency segment identifier %s", peer_addr, val_ss.str().c_str());
 
-                strncat((char *)parsed_data->ls_attrs[ATTR_LINK_ADJACENCY_SID].data(),
-                        val_ss.str().c_str(),
-                        parsed_data->ls_attrs[ATTR_LINK_ADJACENCY_SID].size() -
-                                strlen((char *)parsed_data->ls_attrs[ATTR_LINK_ADJACENCY_SID].data()));
+                // There can be more than one adj sid, append as list
+                parsed_data->ls_attrs.appendString(ATTR_LINK_ADJACENCY_SID, val_ss.str(), ", ");
                 break;
             }
 
             case ATTR_LINK_SRLG:
-                // SELF_DEBUG("%s: bgp-ls: parsing link SRLG attribute", peer_addr.c_str());
-                LOG_INFO("%s: bgp-ls: link SRLG attribute, not yet implemented", peer_addr.c_str());
+                // SELF_DEBUG("%s: bgp-ls: parsing link SRLG attribute", peer_addr);
+                LOG_INFO("%s: bgp-ls: link SRLG attribute, not yet implemented", peer_addr);
                 break;
 
             case ATTR_LINK_TE_DEF_METRIC:
@@ -605,17 +602,17 @@ namespace bgp_msg {
                 // Per rfc7752 Section 3.3.2.3, this is supposed to be 4 bytes, but some implementations have this <=4.
 
                 if (len == 0) {
-                    memcpy(parsed_data->ls_attrs[ATTR_LINK_TE_DEF_METRIC].data(), &value_32bit, len);
+                    parsed_data->ls_attrs.set(ATTR_LINK_TE_DEF_METRIC, &value_32bit, len);
                     break;
                 } else if (len > 4) {
                     LOG_NOTICE("%s: bgp-ls: failed to parse attribute TE default metric sub-tlv; too long %d",
-                            peer_addr.c_str(), len);
+                            peer_addr, len);
                     break;
                 } else {
                     memcpy(&value_32bit, data, len);
                     bgp::SWAP_BYTES(&value_32bit, len);
-                    memcpy(parsed_data->ls_attrs[ATTR_LINK_TE_DEF_METRIC].data(), &value_32bit, len);
-                    SELF_DEBUG("%s: bgp-ls: parsed attribute te default metric 0x%X (len=%d)", peer_addr.c_str(),
+                    parsed_data->ls_attrs.set(ATTR_LINK_TE_DEF_METRIC, &value_32bit, len);
+                    SELF_DEBUG("%s: bgp-ls: parsed attribute te default metric 0x%X (len=%d)", peer_addr,
                                value_32bit, len);
                 }
 
@@ -624,11 +621,11 @@ namespace bgp_msg {
             case ATTR_LINK_UNRESV_BW: {
                 std::stringstream   val_ss;
 
-                SELF_DEBUG("%s: bgp-ls: parsing link unreserve bw attribute (len=%d)", peer_addr.c_str(), len);
+                SELF_DEBUG("%s: bgp-ls: parsing link unreserve bw attribute (len=%d)", peer_addr, len);
 
                 if (len != 32) {
                     LOG_INFO("%s: bgp-ls: link unreserve bw attribute is invalid, length is %d but should be 32",
-                             peer_addr.c_str(), len);
+                             peer_addr, len);
                     break;
                 }
 
@@ -648,15 +645,15 @@ namespace bgp_msg {
                         val_ss << ", " << float_val;
                 }
 
-                SELF_DEBUG("%s: bgp-ls: parsed unresvered bandwidth: %s", peer_addr.c_str(), val_ss.str().c_str());
+                SELF_DEBUG("%s: bgp-ls: parsed unresvered bandwidth: %s", peer_addr, val_ss.str().c_str());
 
-                memcpy(parsed_data->ls_attrs[ATTR_LINK_UNRESV_BW].data(), val_ss.str().data(), val_ss.str().length());
+                parsed_data->ls_attrs.setString(ATTR_LINK_UNRESV_BW, val_ss.str());
 
                 break;
             }
 
             case ATTR_LINK_OPAQUE:
-                LOG_INFO("%s: bgp-ls: opaque link attribute (len=%d), not yet implemented", peer_addr.c_str(), len);
+                LOG_INFO("%s: bgp-ls: opaque link attribute (len=%d), not yet implemented", peer_addr, len);
                 break;
 
             case ATTR_LINK_PEER_EPE_NODE_SID:
@@ -678,29 +675,29 @@ namespace bgp_msg {
                 val_ss << " " << (int) *(data + 1) << " " << parse_sid_value( (data+4), len - 4);
 
 
-                SELF_DEBUG("%s: bgp-ls: parsed link peer node SID: %s (len=%d) %x", peer_addr.c_str(),
+                SELF_DEBUG("%s: bgp-ls: parsed link peer node SID: %s (len=%d) %x", peer_addr,
                            val_ss.str().c_str(), len, (data+4));
 
-                memcpy(parsed_data->ls_attrs[ATTR_LINK_PEER_EPE_NODE_SID].data(), val_ss.str().data(), val_ss.str().length());
+                parsed_data->ls_attrs.setString(ATTR_LINK_PEER_EPE_NODE_SID, val_ss.str());
                 break;
 
             case ATTR_LINK_PEER_EPE_SET_SID:
-                LOG_INFO("%s: bgp-ls: peer epe set SID link attribute (len=%d), not yet implemented", peer_addr.c_str(), len);
+                LOG_INFO("%s: bgp-ls: peer epe set SID link attribute (len=%d), not yet implemented", peer_addr, len);
                 break;
 
             case ATTR_LINK_PEER_EPE_ADJ_SID:
-                LOG_INFO("%s: bgp-ls: peer epe adjacency SID link attribute (len=%d), not yet implemented", peer_addr.c_str(), len);
+                LOG_INFO("%s: bgp-ls: peer epe adjacency SID link attribute (len=%d), not yet implemented", peer_addr, len);
                 break;
 
             case ATTR_PREFIX_EXTEND_TAG:
-                // SELF_DEBUG("%s: bgp-ls: parsing prefix extended tag attribute", peer_addr.c_str());
+                // SELF_DEBUG("%s: bgp-ls: parsing prefix extended tag attribute", peer_addr);
                 LOG_INFO("%s: bgp-ls: prefix extended tag attribute (len=%d), not yet implemented",
-                         peer_addr.c_str(), len);
+                         peer_addr, len);
                 break;
 
             case ATTR_PREFIX_IGP_FLAGS:
-                // SELF_DEBUG("%s: bgp-ls: parsing prefix IGP flags attribute", peer_addr.c_str());
-                LOG_INFO("%s: bgp-ls: prefix IGP flags attribute, not yet implemented", peer_addr.c_str());
+                // SELF_DEBUG("%s: bgp-ls: parsing prefix IGP flags attribute", peer_addr);
+                LOG_INFO("%s: bgp-ls: prefix IGP flags attribute, not yet implemented", peer_addr);
                 break;
 
             case ATTR_PREFIX_PREFIX_METRIC:
@@ -710,13 +707,13 @@ namespace bgp_msg {
                     bgp::SWAP_BYTES(&value_32bit, len);
                 }
 
-                memcpy(parsed_data->ls_attrs[ATTR_PREFIX_PREFIX_METRIC].data(), &value_32bit, 4);
-                SELF_DEBUG("%s: bgp-ls: parsing prefix metric attribute: metric = %u", peer_addr.c_str(), value_32bit);
+                parsed_data->ls_attrs.set(ATTR_PREFIX_PREFIX_METRIC, &value_32bit, 4);
+                SELF_DEBUG("%s: bgp-ls: parsing prefix metric attribute: metric = %u", peer_addr, value_32bit);
                 break;
 
             case ATTR_PREFIX_ROUTE_TAG:
             {
-                SELF_DEBUG("%s: bgp-ls: parsing prefix route tag attribute (len=%d)", peer_addr.c_str(), len);
+                SELF_DEBUG("%s: bgp-ls: parsing prefix route tag attribute (len=%d)", peer_addr, len);
 
                 // TODO(undefined): Per RFC7752 section 3.3.3, prefix tag can be multiples, but for now we only decode the first one.
                 value_32bit = 0;
@@ -725,29 +722,25 @@ namespace bgp_msg {
                     memcpy(&value_32bit, data, len);
                     bgp::SWAP_BYTES(&value_32bit);
 
-                    memcpy(parsed_data->ls_attrs[ATTR_PREFIX_ROUTE_TAG].data(), &value_32bit, 4);
-//                    SELF_DEBUG("%s: bgp-ls: parsing prefix route tag attribute %d (len=%d)", peer_addr.c_str(),
+                    parsed_data->ls_attrs.set(ATTR_PREFIX_ROUTE_TAG, &value_32bit, 4);
+//                    SELF_DEBUG("%s: bgp-ls: parsing prefix route tag attribute %d (len=%d)", peer_addr,
 //                             value_32bit, len);
                 }
 
                 break;
             }
             case ATTR_PREFIX_OSPF_FWD_ADDR:
-                // SELF_DEBUG("%s: bgp-ls: parsing prefix OSPF forwarding address attribute", peer_addr.c_str());
-                LOG_INFO("%s: bgp-ls: prefix OSPF forwarding address attribute, not yet implemented", peer_addr.c_str());
+                // SELF_DEBUG("%s: bgp-ls: parsing prefix OSPF forwarding address attribute", peer_addr);
+                LOG_INFO("%s: bgp-ls: prefix OSPF forwarding address attribute, not yet implemented", peer_addr);
                 break;
 
             case ATTR_PREFIX_OPAQUE_PREFIX:
-                LOG_INFO("%s: bgp-ls: opaque prefix attribute (len=%d), not yet implemented", peer_addr.c_str(), len);
+                LOG_INFO("%s: bgp-ls: opaque prefix attribute (len=%d), not yet implemented", peer_addr, len);
                 break;
                 
             case ATTR_PREFIX_SID: {
                 val_ss.str(std::string());
 
-                // There can be more than one prefix_sid, append as list
-                if (strlen((char *)parsed_data->ls_attrs[ATTR_PREFIX_SID].data()) > 0)
-                    val_ss << ", ";
-
                 // Package structure:
                 // https://tools.ietf.org/html/draft-gredler-idr-bgp-ls-segment-routing-ext-04#section-2.3.1
 
@@ -784,20 +777,18 @@ namespace bgp_msg {
                 // Parse the sid/value
                 val_ss << parse_sid_value(data, len - 4);
 
-                strncat((char *)parsed_data->ls_attrs[ATTR_PREFIX_SID].data(),
-                        val_ss.str().c_str(),
-                        parsed_data->ls_attrs[ATTR_PREFIX_SID].size() -
-                                strlen((char *)parsed_data->ls_attrs[ATTR_PREFIX_SID].data()));
+                // There can be more than one prefix_sid, append as list
+                parsed_data->ls_attrs.appendString(ATTR_PREFIX_SID, val_ss.str(), ", ");
 
                 SELF_DEBUG("%s: bgp-ls: parsed sr prefix segment identifier  flags = %x len=%d : %s",
-                           peer_addr.c_str(), *(data - 4), len, val_ss.str().c_str());
+                           peer_addr, *(data - 4), len, val_ss.str().c_str());
 
                 break;
             }
 
             default:
                 LOG_INFO("%s: bgp-ls: Attribute type=%d len=%d not yet implemented, skipping",
-                        peer_addr.c_str(), type, len);
+                        peer_addr, type, len);
                 break;
         }
 
@@ -113,7 +113,7 @@ namespace bgp_msg {
          * \param [out]    parsed_data  Reference to parsed_update_data; will be updated with all parsed data
          * \param [in]     enable_debug Debug true to enable, false to disable
          */
-        MPLinkStateAttr(Logger *logPtr, std::string peerAddr,
+        MPLinkStateAttr(Logger *logPtr, const char *peerAddr,
                 UpdateMsg::parsed_update_data *parsed_data, bool enable_debug);
         virtual ~MPLinkStateAttr();
 
@@ -133,7 +133,7 @@ namespace bgp_msg {
     private:
         bool             debug;                           ///< debug flag to indicate debugging
         Logger           *logger;                         ///< Logging class pointer
-        std::string      peer_addr;                       ///< Printed form of the peer address for logging
+        const char       *peer_addr;                      ///< Printed form of the peer address for logging
 
         UpdateMsg::parsed_update_data *parsed_data;       ///< Parsed data structure
 
@@ -8,6 +8,8 @@
  */
 
 #include "parseBGP.h"
+#include "PathAttrCache.h"
+#include "AdjRibIn.h"
 
 #include <iostream>
 #include <cstdlib>
@@ -29,6 +31,8 @@
 #include "OpenMsg.h"
 #include "UpdateMsg.h"
 #include "bgp_common.h"
+#include "PrefixKernel.h"
+#include "Metrics.h"
 
 using namespace std;
 
@@ -47,7 +51,7 @@ using namespace std;
  * \param [in]     routerAddr  The router IP address - used for logging
  * \param [in,out] peer_info   Persistent peer information
  */
-parseBGP::parseBGP(Logger *logPtr, MsgBusInterface *mbus_ptr, MsgBusInterface::obj_bgp_peer *peer_entry, string routerAddr,
+parseBGP::parseBGP(Logger *logPtr, MsgBusInterface *mbus_ptr, MsgBusInterface::obj_bgp_peer *peer_entry, const char *routerAddr,
                    BMPReader::peer_info *peer_info) {
     debug = false;
 
@@ -57,6 +61,8 @@ parseBGP::parseBGP(Logger *logPtr, MsgBusInterface *mbus_ptr, MsgBusInterface::o
     data = NULL;
 
     bzero(&common_hdr, sizeof(common_hdr));
+    bzero(base_attr.hash_id, sizeof(base_attr.hash_id));
+    bzero(path_hash_id, sizeof(path_hash_id));
 
     // Set our mysql pointer
     this->mbus_ptr = mbus_ptr;
@@ -64,6 +70,7 @@ parseBGP::parseBGP(Logger *logPtr, MsgBusInterface *mbus_ptr, MsgBusInterface::o
     // Set our peer entry
     p_entry = peer_entry;
     p_info = peer_info;
+    arena = NULL;
 
     router_addr = routerAddr;
 }
@@ -87,30 +94,77 @@ parseBGP::~parseBGP() {
 bool parseBGP::handleUpdate(u_char *data, size_t size) {
     bgp_msg::UpdateMsg::parsed_update_data parsed_data;
     int read_size = 0;
+    bool rval = false;
 
     if (parseBgpHeader(data, size) == BGP_MSG_UPDATE) {
         data += BGP_MSG_HDR_LEN;
 
+        // Lend the prefix storage of the peer to this update
+        if (p_info->nlri_arena == NULL)
+            p_info->nlri_arena = new bgp_msg::NlriArena;
+
+        arena = p_info->nlri_arena;
+        parsed_data.advertised.swap(arena->advertised);
+        parsed_data.withdrawn.swap(arena->withdrawn);
+        parsed_data.ls_attrs.swap(arena->ls_attrs);
+        parsed_data.ls.swap(arena->ls);
+        parsed_data.ls_withdrawn.swap(arena->ls_withdrawn);
+        arena->attr_strings.swap(parsed_data.attrs);
+        arena->base_attr_strings.swap(base_attr);
+
         /*
          * Parse the update message - stored results will be in parsed_data
          */
         bgp_msg::UpdateMsg uMsg(logger, p_entry->peer_addr, router_addr, p_info, debug);
 
-        if ((read_size=uMsg.parseUpdateMsg(data, data_bytes_remaining, parsed_data)) != (size - BGP_MSG_HDR_LEN)) {
-            LOG_NOTICE("%s: rtr=%s: Failed to parse the update message, read %d expected %d", p_entry->peer_addr,
-                        router_addr.c_str(), read_size, (size - read_size));
-            return true;
+        uint64_t start_us = Metrics::enabled ? Metrics::now() : 0;
+
+        read_size = uMsg.parseUpdateMsg(data, data_bytes_remaining, parsed_data);
+
+        if (start_us) {
+            uint64_t parsed_us = Metrics::now();
+            Metrics::observe(Metrics::STAGE_PARSE, parsed_us - start_us);
+            start_us = parsed_us;
         }
 
-        data_bytes_remaining -= read_size;
+        if (read_size != (size - BGP_MSG_HDR_LEN)) {
+            LOG_NOTICE("%s: rtr=%s: Failed to parse the update message, read %d expected %d", p_entry->peer_addr,
+                        router_addr, read_size, (size - read_size));
+            rval = true;
 
-        /*
-         * Update the DB with the update data
-         */
-        UpdateDB(parsed_data);
+        } else {
+            data_bytes_remaining -= read_size;
+
+            /*
+             * Update the DB with the update data
+             */
+            UpdateDB(parsed_data);
+
+            if (start_us) {
+                Metrics::observe(Metrics::STAGE_ENCODE, Metrics::now() - start_us);
+                countMetrics(parsed_data);
+            }
+        }
+
+        // Return the storage, capacity is kept for the next update
+        parsed_data.advertised.clear();
+        parsed_data.withdrawn.clear();
+        parsed_data.advertised.swap(arena->advertised);
+        parsed_data.withdrawn.swap(arena->withdrawn);
+        parsed_data.ls_attrs.clear();
+        parsed_data.ls.clear();
+        parsed_data.ls_withdrawn.clear();
+        parsed_data.ls_attrs.swap(arena->ls_attrs);
+        parsed_data.ls.swap(arena->ls);
+        parsed_data.ls_withdrawn.swap(arena->ls_withdrawn);
+        bgp_msg::AttrStrings::clear(parsed_data.attrs);
+        bgp_msg::AttrStrings::clear(base_attr);
+        arena->attr_strings.swap(parsed_data.attrs);
+        arena->base_attr_strings.swap(base_attr);
+        arena = NULL;
     }
 
-    return false;
+    return rval;
 }
 
 /**
@@ -136,7 +190,7 @@ bool parseBGP::handleDownEvent(u_char *data, size_t size, MsgBusInterface::obj_p
         bgp_msg::parsed_notify_msg parsed_msg;
         bgp_msg::NotificationMsg nMsg(logger, debug);
         if ( (rval=nMsg.parseNotify(data, data_bytes_remaining, parsed_msg)))
-            LOG_ERR("%s: rtr=%s: Failed to parse the BGP notification message", p_entry->peer_addr, router_addr.c_str());
+            LOG_ERR("%s: rtr=%s: Failed to parse the BGP notification message", p_entry->peer_addr, router_addr);
 
         else {
             data += 2;                                                 // Move pointer past notification message
@@ -149,7 +203,7 @@ bool parseBGP::handleDownEvent(u_char *data, size_t size, MsgBusInterface::obj_p
     }
     else {
         LOG_ERR("%s: rtr=%s: BGP message type is not a BGP notification, cannot parse the notification",
-                p_entry->peer_addr, router_addr.c_str());
+                p_entry->peer_addr, router_addr);
         throw "ERROR: Invalid BGP MSG for BMP down event, expected NOTIFICATION message.";
     }
 
@@ -192,7 +246,7 @@ int parseBGP::handleUpEvent(u_char *data, size_t size, MsgBusInterface::obj_peer
         total_read_size = common_hdr.len;
 
         if (!read_size) {
-            LOG_ERR("%s: rtr=%s: Failed to read sent open message",  p_entry->peer_addr, router_addr.c_str());
+            LOG_ERR("%s: rtr=%s: Failed to read sent open message",  p_entry->peer_addr, router_addr);
             throw "Failed to read open message";
         }
 
@@ -219,7 +273,7 @@ int parseBGP::handleUpEvent(u_char *data, size_t size, MsgBusInterface::obj_peer
         strncpy(up_event->sent_cap, cap_str.c_str(), sizeof(up_event->sent_cap));
 
     } else {
-        LOG_ERR("%s: rtr=%s: BGP message type is not BGP OPEN, cannot parse the open message",  p_entry->peer_addr, router_addr.c_str());
+        LOG_ERR("%s: rtr=%s: BGP message type is not BGP OPEN, cannot parse the open message",  p_entry->peer_addr, router_addr);
         throw "ERROR: Invalid BGP MSG for BMP Sent OPEN message, expected OPEN message.";
     }
 
@@ -237,7 +291,7 @@ int parseBGP::handleUpEvent(u_char *data, size_t size, MsgBusInterface::obj_peer
         total_read_size += common_hdr.len;
 
         if (!read_size) {
-            LOG_ERR("%s: rtr=%s: Failed to read sent open message", p_entry->peer_addr, router_addr.c_str());
+            LOG_ERR("%s: rtr=%s: Failed to read sent open message", p_entry->peer_addr, router_addr);
             throw "Failed to read open message";
         }
 
@@ -265,7 +319,7 @@ int parseBGP::handleUpEvent(u_char *data, size_t size, MsgBusInterface::obj_peer
 
     } else {
         LOG_ERR("%s: rtr=%s: BGP message type is not BGP OPEN, cannot parse the open message",
-                p_entry->peer_addr, router_addr.c_str());
+                p_entry->peer_addr, router_addr);
         throw "ERROR: Invalid BGP MSG for BMP Received OPEN message, expected OPEN message.";
     }
 
@@ -293,7 +347,7 @@ u_char parseBGP::parseBgpHeader(u_char *data, size_t size) {
      */
     if (size < BGP_MSG_HDR_LEN) {
         LOG_WARN("%s: rtr=%s: BGP message is being parsed is %d but expected at least %d in size",
-                p_entry->peer_addr, router_addr.c_str(), size, BGP_MSG_HDR_LEN);
+                p_entry->peer_addr, router_addr, size, BGP_MSG_HDR_LEN);
         return 0;
     }
 
@@ -311,10 +365,10 @@ u_char parseBGP::parseBgpHeader(u_char *data, size_t size) {
      */
     if (common_hdr.len > size) {
         LOG_WARN("%s: rtr=%s: BGP message size of %hu is greater than passed data buffer, cannot parse the BGP message",
-                p_entry->peer_addr, router_addr.c_str(), common_hdr.len, size);
+                p_entry->peer_addr, router_addr, common_hdr.len, size);
     }
 
-    SELF_DEBUG("%s: rtr=%s: BGP hdr len = %u, type = %d", p_entry->peer_addr, router_addr.c_str(), common_hdr.len, common_hdr.type);
+    SELF_DEBUG("%s: rtr=%s: BGP hdr len = %u, type = %d", p_entry->peer_addr, router_addr, common_hdr.len, common_hdr.type);
 
     /*
      * Validate the message type as being allowed/accepted
@@ -328,17 +382,78 @@ u_char parseBGP::parseBgpHeader(u_char *data, size_t size) {
 
         case BGP_MSG_ROUTE_REFRESH: // Route Refresh message
             LOG_NOTICE("%s: rtr=%s: Received route refresh, nothing to do with this message currently.",
-                        p_entry->peer_addr, router_addr.c_str());
+                        p_entry->peer_addr, router_addr);
             break;
 
         default :
-            LOG_WARN("%s: rtr=%s: Unsupported BGP message type = %d", p_entry->peer_addr, router_addr.c_str(), common_hdr.type);
+            LOG_WARN("%s: rtr=%s: Unsupported BGP message type = %d", p_entry->peer_addr, router_addr, common_hdr.type);
             break;
     }
 
     return common_hdr.type;
 }
 
+/**
+ * Metrics family of a prefix
+ */
+static Metrics::Family prefixFamily(const bgp::prefix_tuple &prefix) {
+    switch (prefix.type) {
+        case bgp::PREFIX_UNICAST_V6 :
+            return Metrics::FAMILY_IPV6_UNICAST;
+
+        case bgp::PREFIX_LABEL_UNICAST_V4 :
+            return Metrics::FAMILY_IPV4_LABELED;
+
+        case bgp::PREFIX_LABEL_UNICAST_V6 :
+            return Metrics::FAMILY_IPV6_LABELED;
+
+        case bgp::PREFIX_VPN_V4 :
+            return Metrics::FAMILY_IPV4_VPN;
+
+        case bgp::PREFIX_VPN_v6 :
+            return Metrics::FAMILY_IPV6_VPN;
+
+        default :
+            return prefix.isIPv4 ? Metrics::FAMILY_IPV4_UNICAST : Metrics::FAMILY_IPV6_UNICAST;
+    }
+}
+
+/**
+ * Count the update and its NLRIs by address family in the metrics
+ *
+ * \param  parsed_data          Reference to the parsed update data
+ */
+void parseBGP::countMetrics(bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
+    uint64_t count[Metrics::FAMILY_MAX][2] = { };
+
+    Metrics::countUpdate();
+
+    for (size_t i = 0; i < parsed_data.advertised.size(); i++)
+        ++count[prefixFamily(parsed_data.advertised[i])][0];
+
+    for (size_t i = 0; i < parsed_data.withdrawn.size(); i++)
+        ++count[prefixFamily(parsed_data.withdrawn[i])][1];
+
+    for (size_t i = 0; i < parsed_data.vpn.size(); i++)
+        ++count[parsed_data.vpn[i].isIPv4 ? Metrics::FAMILY_IPV4_VPN : Metrics::FAMILY_IPV6_VPN][0];
+
+    for (size_t i = 0; i < parsed_data.vpn_withdrawn.size(); i++)
+        ++count[parsed_data.vpn_withdrawn[i].isIPv4 ? Metrics::FAMILY_IPV4_VPN : Metrics::FAMILY_IPV6_VPN][1];
+
+    count[Metrics::FAMILY_EVPN][0] = parsed_data.evpn.size();
+    count[Metrics::FAMILY_EVPN][1] = parsed_data.evpn_withdrawn.size();
+
+    count[Metrics::FAMILY_BGP_LS][0] = parsed_data.ls.nodes.size() + parsed_data.ls.links.size()
+                                       + parsed_data.ls.prefixes.size();
+    count[Metrics::FAMILY_BGP_LS][1] = parsed_data.ls_withdrawn.nodes.size() + parsed_data.ls_withdrawn.links.size()
+                                       + parsed_data.ls_withdrawn.prefixes.size();
+
+    for (int f = 0; f < Metrics::FAMILY_MAX; f++) {
+        Metrics::countNlri((Metrics::Family)f, false, count[f][0]);
+        Metrics::countNlri((Metrics::Family)f, true, count[f][1]);
+    }
+}
+
 /**
  * Update the Database with the parsed updated data
  *
@@ -350,7 +465,7 @@ void parseBGP::UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
     /*
      * Update the path attributes
      */
-    UpdateDBAttrs(parsed_data.attrs);
+    UpdateDBAttrs(parsed_data.attrs, parsed_data.attr_cache_entry);
 
     /*
      * Update the bgp-ls data
@@ -381,62 +496,48 @@ void parseBGP::UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
  *
  * \details This method will update the database for the supplied path attributes
  *
- * \param  attrs            Reference to the parsed attributes map
+ * \param  attrs            Reference to the parsed attributes
+ * \param  cache_entry      Cached attribute set for attrs, NULL if not cached
  */
-void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
+void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs &attrs, bgp_msg::PathAttrCacheEntry *cache_entry) {
 
     /*
-     * Setup the record
+     * Attributes already published for this peer, reuse the record and hash
      */
-    base_attr.as_path                  = (string)attrs[bgp_msg::ATTR_TYPE_AS_PATH];
-    base_attr.cluster_list             = (string)attrs[bgp_msg::ATTR_TYPE_CLUSTER_LIST];
-    base_attr.community_list           = (string)attrs[bgp_msg::ATTR_TYPE_COMMUNITIES];
-    base_attr.ext_community_list       = (string)attrs[bgp_msg::ATTR_TYPE_EXT_COMMUNITY];
-
-    base_attr.atomic_agg               = ((string)attrs[bgp_msg::ATTR_TYPE_ATOMIC_AGGREGATE]).compare("1") == 0 ? true : false;
+    if (cache_entry != NULL and cache_entry->base_attr_valid) {
+        SELF_DEBUG("%s: attributes are cached, not sending attributes to message bus", p_entry->peer_addr);
 
-    if (((string)attrs[bgp_msg::ATTR_TYPE_LOCAL_PREF]).length() > 0)
-        base_attr.local_pref = std::stoul(((string)attrs[bgp_msg::ATTR_TYPE_LOCAL_PREF]));
-    else
-        base_attr.local_pref = 0;
-
-    if (((string)attrs[bgp_msg::ATTR_TYPE_MED]).length() > 0)
-        base_attr.med = std::stoul(((string)attrs[bgp_msg::ATTR_TYPE_MED]));
-    else
-        base_attr.med = 0;
-
-    if (((string)attrs[bgp_msg::ATTR_TYPE_INTERNAL_AS_COUNT]).length() > 0)
-        base_attr.as_path_count = std::stoi(((string)attrs[bgp_msg::ATTR_TYPE_INTERNAL_AS_COUNT]));
-    else
-        base_attr.as_path_count = 0;
-
-    if (((string)attrs[bgp_msg::ATTR_TYPE_INTERNAL_AS_ORIGIN]).length() > 0)
-        base_attr.origin_as = std::stoul(((string)attrs[bgp_msg::ATTR_TYPE_INTERNAL_AS_ORIGIN]));
-    else
-        base_attr.origin_as = 0;
-
-    if (((string)attrs[bgp_msg::ATTR_TYPE_ORIGINATOR_ID]).length() > 0)
-        strncpy(base_attr.originator_id, ((string)attrs[bgp_msg::ATTR_TYPE_ORIGINATOR_ID]).c_str(), sizeof(base_attr.originator_id));
-    else
-        bzero(base_attr.originator_id, sizeof(base_attr.originator_id));
-
-    if ( ((string)attrs[bgp_msg::ATTR_TYPE_NEXT_HOP]).find_first_of(':') ==  string::npos)
-        base_attr.nexthop_isIPv4 = true;
-    else // is IPv6
-        base_attr.nexthop_isIPv4 = false;
-
-    if ( ((string)attrs[bgp_msg::ATTR_TYPE_AGGEGATOR]).length() > 0)
-        strncpy(base_attr.aggregator, ((string)attrs[bgp_msg::ATTR_TYPE_AGGEGATOR]).c_str(), sizeof(base_attr.aggregator));
-    else
-        bzero(base_attr.aggregator, sizeof(base_attr.aggregator));
+        base_attr = cache_entry->base_attr;
+        memcpy(path_hash_id, base_attr.hash_id, sizeof(path_hash_id));
+        return;
+    }
 
-    if ( ((string)attrs[bgp_msg::ATTR_TYPE_ORIGIN]).length() > 0)
-            strncpy(base_attr.origin, ((string)attrs[bgp_msg::ATTR_TYPE_ORIGIN]).c_str(), sizeof(base_attr.origin));
+    /*
+     * Setup the record
+     */
+    attrs.getAsPath(base_attr.as_path);
+    base_attr.cluster_list             = attrs.cluster_list;
+    base_attr.community_list           = attrs.community_list;
+    base_attr.ext_community_list       = attrs.ext_community_list;
+    base_attr.large_community_list     = attrs.large_community_list;
+
+    base_attr.atomic_agg               = attrs.atomic_agg;
+    base_attr.local_pref               = attrs.local_pref;
+    base_attr.med                      = attrs.med;
+    base_attr.as_path_count            = attrs.as_path_count;
+    base_attr.origin_as                = attrs.origin_as;
+    base_attr.nexthop_isIPv4           = attrs.nexthop_isIPv4;
+
+    memcpy(base_attr.originator_id, attrs.originator_id, sizeof(base_attr.originator_id));
+    memcpy(base_attr.aggregator, attrs.aggregator, sizeof(base_attr.aggregator));
+
+    if (attrs.origin != NULL)
+        strncpy(base_attr.origin, attrs.origin, sizeof(base_attr.origin));
     else
         bzero(base_attr.origin, sizeof(base_attr.origin));
 
-    if ( ((string)attrs[bgp_msg::ATTR_TYPE_NEXT_HOP]).length() > 0)
-        strncpy(base_attr.next_hop, ((string)attrs[bgp_msg::ATTR_TYPE_NEXT_HOP]).c_str(), sizeof(base_attr.next_hop));
+    if (attrs.next_hop[0] != 0)
+        memcpy(base_attr.next_hop, attrs.next_hop, sizeof(base_attr.next_hop));
 
     else {
         // Skip adding path attributes if next hop is missing
@@ -453,6 +554,11 @@ void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
 
     // Update the class instance variable path_hash_id
     memcpy(path_hash_id, base_attr.hash_id, sizeof(path_hash_id));
+
+    if (cache_entry != NULL) {
+        cache_entry->base_attr = base_attr;
+        cache_entry->base_attr_valid = true;
+    }
 }
 
 /**
@@ -461,20 +567,18 @@ void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
  * \details This method will update the database for the supplied advertised prefixes
  *
  * \param [in] remove          True if the records should be deleted, false if they are to be added/updated
- * \param [in] prefixes        Reference to the list<vpn_tuple> of advertised vpns
- * \param [in] attrs           Reference to the parsed attributes map
+ * \param [in] prefixes        Reference to the vector<vpn_tuple> of advertised vpns
+ * \param [in] attrs           Reference to the parsed attributes
  */
-void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
-                             bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
+void parseBGP::UpdateDBL3Vpn(bool remove, std::vector<bgp::vpn_tuple> &prefixes,
+                             bgp_msg::UpdateMsg::parsed_attrs &attrs) {
     vector<MsgBusInterface::obj_vpn> rib_list;
     MsgBusInterface::obj_vpn         rib_entry;
-    uint32_t                         value_32bit;
-    uint64_t                         value_64bit;
 
     /*
      * Loop through all vpn and add/update them in the DB
      */
-    for (std::list<bgp::vpn_tuple>::iterator it = prefixes.begin();
+    for (std::vector<bgp::vpn_tuple>::iterator it = prefixes.begin();
                                                 it != prefixes.end();
                                                 it++) {
         bgp::vpn_tuple &tuple = (*it);
@@ -482,66 +586,22 @@ void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
         memcpy(rib_entry.path_attr_hash_id, path_hash_id, sizeof(rib_entry.path_attr_hash_id));
         memcpy(rib_entry.peer_hash_id, p_entry->hash_id, sizeof(rib_entry.peer_hash_id));
 
-        rib_entry.rd_type = tuple.rd_type;
-        rib_entry.rd_assigned_number = tuple.rd_assigned_number;
-        rib_entry.rd_administrator_subfield = tuple.rd_administrator_subfield;
+        memcpy(rib_entry.rd, tuple.rd, sizeof(rib_entry.rd));
+
+        // Printed from the binary prefix, the label decoder only fills in prefix_bin
+        bgp::formatIp(tuple.isIPv4, tuple.prefix_bin, rib_entry.prefix);
 
-        strncpy(rib_entry.prefix, tuple.prefix.c_str(), sizeof(rib_entry.prefix));
-        
         rib_entry.prefix_len = tuple.len;
 
-        snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
-        
         rib_entry.isIPv4 = tuple.isIPv4 ? 1 : 0;
 
         memcpy(rib_entry.prefix_bin, tuple.prefix_bin, sizeof(rib_entry.prefix_bin));
 
         // Add the ending IP for the prefix based on bits
-        if (rib_entry.isIPv4) {
-            if (tuple.len < 32) {
-                memcpy(&value_32bit, tuple.prefix_bin, 4);
-                bgp::SWAP_BYTES(&value_32bit);
-
-                value_32bit |= 0xFFFFFFFF >> tuple.len;
-                bgp::SWAP_BYTES(&value_32bit);
-                memcpy(rib_entry.prefix_bcast_bin, &value_32bit, 4);
-
-            } else
-                memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, sizeof(tuple.prefix_bin));
-
-        } else {
-            if (tuple.len < 128) {
-                if (tuple.len >= 64) {
-                    // High order bytes are left alone
-                    memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, 8);
-
-                    // Low order bytes are updated
-                    memcpy(&value_64bit, &tuple.prefix_bin[8], 8);
-                    bgp::SWAP_BYTES(&value_64bit);
-
-                    value_64bit |= 0xFFFFFFFFFFFFFFFF >> (tuple.len - 64);
-                    bgp::SWAP_BYTES(&value_64bit);
-                    memcpy(&rib_entry.prefix_bcast_bin[8], &value_64bit, 8);
-
-                } else {
-                    // Low order types are all ones
-                    value_64bit = 0xFFFFFFFFFFFFFFFF;
-                    memcpy(&rib_entry.prefix_bcast_bin[8], &value_64bit, 8);
-
-                    // High order bypes are updated
-                    memcpy(&value_64bit, tuple.prefix_bin, 8);
-                    bgp::SWAP_BYTES(&value_64bit);
-
-                    value_64bit |= 0xFFFFFFFFFFFFFFFF >> tuple.len;
-                    bgp::SWAP_BYTES(&value_64bit);
-                    memcpy(rib_entry.prefix_bcast_bin, &value_64bit, 8);
-                }
-            } else
-                memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, sizeof(tuple.prefix_bin));
-        }
+        bgp::prefixBroadcast(tuple.prefix_bin, tuple.len, tuple.isIPv4, rib_entry.prefix_bcast_bin);
 
         rib_entry.path_id = tuple.path_id;
-        snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
+        rib_entry.labels = tuple.labels;
 
         SELF_DEBUG("%s: %s vpn=%s len=%d", p_entry->peer_addr, remove ? "removing" : "adding",
                    rib_entry.prefix, rib_entry.prefix_len);
@@ -563,11 +623,11 @@ void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
  * Updates for either advertised or withdrawn Evpn NLRI's
  *
  * \param [in] remove          True if the records should be deleted, false if they are to be added/updated
- * \param [in] nlris           Reference to the list<evpn_tuple>
- * \param [in] attrs           Reference to the parsed attributes map
+ * \param [in] nlris           Reference to the vector<evpn_tuple>
+ * \param [in] attrs           Reference to the parsed attributes
  */
-void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
-                           bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
+void parseBGP::UpdateDBeVPN(bool remove, std::vector<bgp::evpn_tuple> &nlris,
+                           bgp_msg::UpdateMsg::parsed_attrs &attrs) {
 
     vector<MsgBusInterface::obj_evpn> rib_list;
     MsgBusInterface::obj_evpn         rib_entry;
@@ -575,7 +635,7 @@ void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
     /*
      * Loop through all vpn and add/update them in the DB
      */
-    for (std::list<bgp::evpn_tuple>::iterator it = nlris.begin();
+    for (std::vector<bgp::evpn_tuple>::iterator it = nlris.begin();
          it != nlris.end();
          it++) {
         bgp::evpn_tuple &tuple = (*it);
@@ -583,26 +643,27 @@ void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
         memcpy(rib_entry.path_attr_hash_id, path_hash_id, sizeof(rib_entry.path_attr_hash_id));
         memcpy(rib_entry.peer_hash_id, p_entry->hash_id, sizeof(rib_entry.peer_hash_id));
 
-        rib_entry.rd_type = tuple.rd_type;
-        rib_entry.rd_assigned_number = tuple.rd_assigned_number;
-        rib_entry.rd_administrator_subfield = tuple.rd_administrator_subfield;
+        memcpy(rib_entry.rd, tuple.rd, sizeof(rib_entry.rd));
 
-        strcpy(rib_entry.ethernet_tag_id_hex, tuple.ethernet_tag_id_hex.c_str());
+        // Binary fields, printed by the message bus
+        rib_entry.route_type = tuple.route_type;
+        memcpy(rib_entry.ethernet_tag_id, tuple.ethernet_tag_id, sizeof(rib_entry.ethernet_tag_id));
         rib_entry.mpls_label_1 = tuple.mpls_label_1;
         rib_entry.mac_len = tuple.mac_len;
-        strcpy(rib_entry.mac, tuple.mac.c_str());
+        memcpy(rib_entry.mac, tuple.mac, sizeof(rib_entry.mac));
         rib_entry.ip_len = tuple.ip_len;
-        strcpy(rib_entry.ip, tuple.ip.c_str());
+        memcpy(rib_entry.ip, tuple.ip, sizeof(rib_entry.ip));
         rib_entry.mpls_label_2 = tuple.mpls_label_2;
         rib_entry.originating_router_ip_len = tuple.originating_router_ip_len;
-        strcpy(rib_entry.originating_router_ip, tuple.originating_router_ip.c_str());
-        strcpy(rib_entry.ethernet_segment_identifier, tuple.ethernet_segment_identifier.c_str());
-
+        memcpy(rib_entry.originating_router_ip, tuple.originating_router_ip, sizeof(rib_entry.originating_router_ip));
+        memcpy(rib_entry.ethernet_segment_identifier, tuple.ethernet_segment_identifier,
+               sizeof(rib_entry.ethernet_segment_identifier));
+        rib_entry.labels.count = 0;
 
         rib_entry.path_id = tuple.path_id;
 
-        SELF_DEBUG("%s: %s evpn mac=%s ip=%s", p_entry->peer_addr,
-                   remove ? "removing" : "adding", rib_entry.mac, rib_entry.ip);
+        SELF_DEBUG("%s: %s evpn route type=%d", p_entry->peer_addr,
+                   remove ? "removing" : "adding", rib_entry.route_type);
 
         // Add entry to the list
         rib_list.insert(rib_list.end(), rib_entry);
@@ -623,28 +684,42 @@ void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
  *
  * \details This method will update the database for the supplied advertised prefixes
  *
- * \param  adv_prefixes         Reference to the list<prefix_tuple> of advertised prefixes
- * \param  attrs            Reference to the parsed attributes map
+ * \param  adv_prefixes         Reference to the vector<prefix_tuple> of advertised prefixes
+ * \param  attrs            Reference to the parsed attributes
  */
-void parseBGP::UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes,
-                                   bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
-    vector<MsgBusInterface::obj_rib> rib_list;
+void parseBGP::UpdateDBAdvPrefixes(std::vector<bgp::prefix_tuple> &adv_prefixes,
+                                   bgp_msg::UpdateMsg::parsed_attrs &attrs) {
+    vector<MsgBusInterface::obj_rib> local_rib_list;
+    vector<MsgBusInterface::obj_rib> &rib_list = arena != NULL ? arena->rib : local_rib_list;
     MsgBusInterface::obj_rib         rib_entry;
-    uint32_t                         value_32bit;
-    uint64_t                         value_64bit;
+    bgp_msg::AdjRibIn                *adj_rib = p_info != NULL ? p_info->adj_rib : NULL;
+
+    rib_list.reserve(adv_prefixes.size());
+
+    std::unique_lock<std::mutex> rib_lock;
+    if (adj_rib != NULL)
+        rib_lock = std::unique_lock<std::mutex>(adj_rib->mutex);
 
     /*
      * Loop through all prefixes and add/update them in the DB
      */
-    for (std::list<bgp::prefix_tuple>::iterator it = adv_prefixes.begin();
+    for (std::vector<bgp::prefix_tuple>::iterator it = adv_prefixes.begin();
                                                 it != adv_prefixes.end();
                                                 it++) {
         bgp::prefix_tuple &tuple = (*it);
 
+        // Labeled prefixes are not kept, the route would also depend on the labels
+        if (adj_rib != NULL and tuple.labels.count == 0 and
+                not adj_rib->announce(tuple.isIPv4, tuple.prefix_bin, tuple.len, tuple.path_id, path_hash_id, &base_attr)) {
+            SELF_DEBUG("%s: Duplicate prefix len=%d not published", p_entry->peer_addr, tuple.len);
+            continue;
+        }
+
         memcpy(rib_entry.path_attr_hash_id, path_hash_id, sizeof(rib_entry.path_attr_hash_id));
         memcpy(rib_entry.peer_hash_id, p_entry->hash_id, sizeof(rib_entry.peer_hash_id));
 
-        strncpy(rib_entry.prefix, tuple.prefix.c_str(), sizeof(rib_entry.prefix));
+        // Printed from the binary prefix, the unicast decoder only fills in prefix_bin
+        bgp::formatIp(tuple.isIPv4, tuple.prefix_bin, rib_entry.prefix);
 
         rib_entry.prefix_len     = tuple.len;
 
@@ -653,56 +728,15 @@ void parseBGP::UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes,
         memcpy(rib_entry.prefix_bin, tuple.prefix_bin, sizeof(rib_entry.prefix_bin));
 
         // Add the ending IP for the prefix based on bits
-        if (rib_entry.isIPv4) {
-            if (tuple.len < 32) {
-                memcpy(&value_32bit, tuple.prefix_bin, 4);
-                bgp::SWAP_BYTES(&value_32bit);
-
-                value_32bit |= 0xFFFFFFFF >> tuple.len;
-                bgp::SWAP_BYTES(&value_32bit);
-                memcpy(rib_entry.prefix_bcast_bin, &value_32bit, 4);
-
-            } else
-                memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, sizeof(tuple.prefix_bin));
-
-        } else {
-            if (tuple.len < 128) {
-                if (tuple.len >= 64) {
-                    // High order bytes are left alone
-                    memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, 8);
-
-                    // Low order bytes are updated
-                    memcpy(&value_64bit, &tuple.prefix_bin[8], 8);
-                    bgp::SWAP_BYTES(&value_64bit);
-
-                    value_64bit |= 0xFFFFFFFFFFFFFFFF >> (tuple.len - 64);
-                    bgp::SWAP_BYTES(&value_64bit);
-                    memcpy(&rib_entry.prefix_bcast_bin[8], &value_64bit, 8);
-
-                } else {
-                    // Low order types are all ones
-                    value_64bit = 0xFFFFFFFFFFFFFFFF;
-                    memcpy(&rib_entry.prefix_bcast_bin[8], &value_64bit, 8);
-
-                    // High order bypes are updated
-                    memcpy(&value_64bit, tuple.prefix_bin, 8);
-                    bgp::SWAP_BYTES(&value_64bit);
-
-                    value_64bit |= 0xFFFFFFFFFFFFFFFF >> tuple.len;
-                    bgp::SWAP_BYTES(&value_64bit);
-                    memcpy(rib_entry.prefix_bcast_bin, &value_64bit, 8);
-                }
-            } else
-                memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, sizeof(tuple.prefix_bin));
-        }
+        bgp::prefixBroadcast(tuple.prefix_bin, tuple.len, tuple.isIPv4, rib_entry.prefix_bcast_bin);
 
         rib_entry.path_id = tuple.path_id;
-        snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
+        rib_entry.labels = tuple.labels;
 
         SELF_DEBUG("%s: Adding prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
 
         // Add entry to the list
-        rib_list.insert(rib_list.end(), rib_entry);
+        rib_list.push_back(rib_entry);
     }
 
     // Update the DB
@@ -718,23 +752,38 @@ void parseBGP::UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes,
  *
  * \details This method will update the database for the supplied advertised prefixes
  *
- * \param  wdrawn_prefixes         Reference to the list<prefix_tuple> of withdrawn prefixes
+ * \param  wdrawn_prefixes         Reference to the vector<prefix_tuple> of withdrawn prefixes
  */
-void parseBGP::UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefixes) {
-    vector<MsgBusInterface::obj_rib> rib_list;
+void parseBGP::UpdateDBWdrawnPrefixes(std::vector<bgp::prefix_tuple> &wdrawn_prefixes) {
+    vector<MsgBusInterface::obj_rib> local_rib_list;
+    vector<MsgBusInterface::obj_rib> &rib_list = arena != NULL ? arena->rib : local_rib_list;
     MsgBusInterface::obj_rib         rib_entry;
+    bgp_msg::AdjRibIn                *adj_rib = p_info != NULL ? p_info->adj_rib : NULL;
+
+    rib_list.reserve(wdrawn_prefixes.size());
+
+    std::unique_lock<std::mutex> rib_lock;
+    if (adj_rib != NULL)
+        rib_lock = std::unique_lock<std::mutex>(adj_rib->mutex);
 
     /*
      * Loop through all prefixes and add/update them in the DB
      */
-    for (std::list<bgp::prefix_tuple>::iterator it = wdrawn_prefixes.begin();
+    for (std::vector<bgp::prefix_tuple>::iterator it = wdrawn_prefixes.begin();
                                                 it != wdrawn_prefixes.end();
                                                 it++) {
 
         bgp::prefix_tuple &tuple = (*it);
-        memcpy(rib_entry.path_attr_hash_id, path_hash_id, sizeof(rib_entry.path_attr_hash_id));
+
+        // Path hash of the withdrawn route if known, the attributes of the update are not its path
+        if (adj_rib != NULL and tuple.labels.count == 0)
+            adj_rib->withdraw(tuple.isIPv4, tuple.prefix_bin, tuple.len, tuple.path_id, rib_entry.path_attr_hash_id);
+        else
+            bzero(rib_entry.path_attr_hash_id, sizeof(rib_entry.path_attr_hash_id));
+
         memcpy(rib_entry.peer_hash_id, p_entry->hash_id, sizeof(rib_entry.peer_hash_id));
-        strncpy(rib_entry.prefix, tuple.prefix.c_str(), sizeof(rib_entry.prefix));
+        // Printed from the binary prefix, the unicast decoder only fills in prefix_bin
+        bgp::formatIp(tuple.isIPv4, tuple.prefix_bin, rib_entry.prefix);
 
         rib_entry.prefix_len     = tuple.len;
 
@@ -743,12 +792,12 @@ void parseBGP::UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefi
         memcpy(rib_entry.prefix_bin, tuple.prefix_bin, sizeof(rib_entry.prefix_bin));
 
         rib_entry.path_id = tuple.path_id;
-        snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
+        rib_entry.labels = tuple.labels;
 
         SELF_DEBUG("%s: Removing prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
 
         // Add entry to the list
-        rib_list.insert(rib_list.end(), rib_entry);
+        rib_list.push_back(rib_entry);
     }
 
     // Update the DB
@@ -770,8 +819,8 @@ void parseBGP::UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefi
  * \param [in] ls_data     Reference to the parsed link state nlri information
  * \param [in] ls_attrs    Reference to the parsed link state attribute information
  */
-void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_data,
-                             bgp_msg::UpdateMsg::parsed_ls_attrs_map &ls_attrs) {
+void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls &ls_data,
+                             bgp_msg::LsAttrTable &ls_attrs) {
     /*
      * Update table entry with attributes based on NLRI
      */
@@ -779,34 +828,21 @@ void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_
         SELF_DEBUG("%s: Updating BGP-LS: Nodes %d", p_entry->peer_addr, ls_data.nodes.size());
 
         // Merge attributes to each table entry
-        for (list<MsgBusInterface::obj_ls_node>::iterator it = ls_data.nodes.begin();
+        for (vector<MsgBusInterface::obj_ls_node>::iterator it = ls_data.nodes.begin();
                 it != ls_data.nodes.end(); it++) {
 
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_NAME) != ls_attrs.end())
-                memcpy((*it).name, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_NAME].data(), sizeof((*it).name));
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_NODE_NAME, (*it).name, sizeof((*it).name));
 
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL) != ls_attrs.end())
-                memcpy((*it).router_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL].data(), 4);
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL, (*it).router_id, 4);
 
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL) != ls_attrs.end()) {
-                memcpy((*it).router_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL].data(), 16);
+            if (ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL, (*it).router_id, 16))
                 (*it).isIPv4 = false;
-            }
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_MT_ID) != ls_attrs.end()) {
-                strncpy((char *)&(*it).mt_id, (char *)ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_MT_ID].data(),
-                       strlen((char *)ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_MT_ID].data()) + 1);
-            }
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_FLAG) != ls_attrs.end())
-                memcpy((*it).flags, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_FLAG].data(), sizeof((*it).flags));
 
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID) != ls_attrs.end())
-                memcpy((*it).isis_area_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID].data(), sizeof((*it).isis_area_id));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_SR_CAPABILITIES) != ls_attrs.end()) {
-                memcpy((*it).sr_capabilities_tlv, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_SR_CAPABILITIES].data(), sizeof((*it).sr_capabilities_tlv));
-            }
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_NODE_MT_ID, (*it).mt_id, sizeof((*it).mt_id));
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_NODE_FLAG, (*it).flags, sizeof((*it).flags));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID, (*it).isis_area_id, sizeof((*it).isis_area_id));
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_NODE_SR_CAPABILITIES, (*it).sr_capabilities_tlv,
+                                sizeof((*it).sr_capabilities_tlv));
         }
 
         if (remove)
@@ -819,65 +855,34 @@ void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_
         SELF_DEBUG("%s: Updating BGP-LS: Links %d ", p_entry->peer_addr, ls_data.links.size());
 
         // Merge attributes to each table entry
-        for (list<MsgBusInterface::obj_ls_link>::iterator it = ls_data.links.begin();
+        for (vector<MsgBusInterface::obj_ls_link>::iterator it = ls_data.links.begin();
              it != ls_data.links.end(); it++) {
 
-            if (not (*it).isIPv4 and ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL) != ls_attrs.end())
-                memcpy((*it).router_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL].data(), 16);
+            if (not (*it).isIPv4 and ls_attrs.has(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL))
+                ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL, (*it).router_id, 16);
 
-            else if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL) != ls_attrs.end()) {
-                memcpy((*it).router_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL].data(), 4);
+            else if (ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL, (*it).router_id, 4))
                 (*it).isIPv4 = true;
-            }
-
-            if (not (*it).isIPv4 and ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_IPV6_ROUTER_ID_REMOTE) != ls_attrs.end())
-                memcpy((*it).remote_router_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_IPV6_ROUTER_ID_REMOTE].data(), 16);
-
-            else if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_IPV4_ROUTER_ID_REMOTE) != ls_attrs.end()) {
-                memcpy((*it).remote_router_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_IPV4_ROUTER_ID_REMOTE].data(), 4);
-                //(*it).isIPv4 = true; // only set for local rid
-            }
-
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID) != ls_attrs.end())
-                memcpy((*it).isis_area_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID].data(), sizeof((*it).isis_area_id));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_ADMIN_GROUP) != ls_attrs.end())
-                memcpy(&(*it).admin_group, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_ADMIN_GROUP].data(), sizeof((*it).admin_group));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_MAX_LINK_BW) != ls_attrs.end())
-                memcpy(&(*it).max_link_bw, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_MAX_LINK_BW].data(),
-                       sizeof((*it).max_link_bw));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_MAX_RESV_BW) != ls_attrs.end())
-                memcpy(&(*it).max_resv_bw, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_MAX_RESV_BW].data(), sizeof((*it).max_resv_bw));
 
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_UNRESV_BW) != ls_attrs.end())
-                memcpy(&(*it).unreserved_bw, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_UNRESV_BW].data(), sizeof((*it).unreserved_bw));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_TE_DEF_METRIC) != ls_attrs.end())
-                memcpy(&(*it).te_def_metric, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_TE_DEF_METRIC].data(), sizeof((*it).te_def_metric));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_PROTECTION_TYPE) != ls_attrs.end())
-                memcpy((*it).protection_type, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_PROTECTION_TYPE].data(), sizeof((*it).protection_type));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_MPLS_PROTO_MASK) != ls_attrs.end())
-                memcpy((*it).mpls_proto_mask, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_MPLS_PROTO_MASK].data(), sizeof((*it).mpls_proto_mask));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_IGP_METRIC) != ls_attrs.end())
-                memcpy(&(*it).igp_metric, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_IGP_METRIC].data(), sizeof((*it).igp_metric));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_SRLG) != ls_attrs.end())
-                memcpy((*it).srlg, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_SRLG].data(), sizeof((*it).srlg));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_NAME) != ls_attrs.end())
-                memcpy((*it).name, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_NAME].data(), sizeof((*it).name));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_PEER_EPE_NODE_SID) != ls_attrs.end())
-                memcpy((*it).peer_node_sid, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_PEER_EPE_NODE_SID].data(), sizeof((*it).peer_node_sid));
-                
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_LINK_ADJACENCY_SID) != ls_attrs.end())
-                memcpy((*it).peer_adj_sid, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_LINK_ADJACENCY_SID].data(), sizeof((*it).peer_adj_sid));
+            if (not (*it).isIPv4 and ls_attrs.has(bgp_msg::MPLinkStateAttr::ATTR_LINK_IPV6_ROUTER_ID_REMOTE))
+                ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_IPV6_ROUTER_ID_REMOTE, (*it).remote_router_id, 16);
+
+            else    // isIPv4 is only set for local rid
+                ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_IPV4_ROUTER_ID_REMOTE, (*it).remote_router_id, 4);
+
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID, (*it).isis_area_id, sizeof((*it).isis_area_id));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_ADMIN_GROUP, &(*it).admin_group, sizeof((*it).admin_group));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_MAX_LINK_BW, &(*it).max_link_bw, sizeof((*it).max_link_bw));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_MAX_RESV_BW, &(*it).max_resv_bw, sizeof((*it).max_resv_bw));
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_LINK_UNRESV_BW, (*it).unreserved_bw, sizeof((*it).unreserved_bw));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_TE_DEF_METRIC, &(*it).te_def_metric, sizeof((*it).te_def_metric));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_PROTECTION_TYPE, (*it).protection_type, sizeof((*it).protection_type));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_MPLS_PROTO_MASK, (*it).mpls_proto_mask, sizeof((*it).mpls_proto_mask));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_IGP_METRIC, &(*it).igp_metric, sizeof((*it).igp_metric));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_LINK_SRLG, (*it).srlg, sizeof((*it).srlg));
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_LINK_NAME, (*it).name, sizeof((*it).name));
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_LINK_PEER_EPE_NODE_SID, (*it).peer_node_sid, sizeof((*it).peer_node_sid));
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_LINK_ADJACENCY_SID, (*it).peer_adj_sid, sizeof((*it).peer_adj_sid));
         }
 
         if (remove)
@@ -890,37 +895,22 @@ void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_
         SELF_DEBUG("%s: Updating BGP-LS: Prefixes %d ", p_entry->peer_addr, ls_data.prefixes.size());
 
         // Merge attributes to each table entry
-        for (list<MsgBusInterface::obj_ls_prefix>::iterator it = ls_data.prefixes.begin();
+        for (vector<MsgBusInterface::obj_ls_prefix>::iterator it = ls_data.prefixes.begin();
              it != ls_data.prefixes.end(); it++) {
 
-            if (not (*it).isIPv4 and ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL) != ls_attrs.end())
-                memcpy((*it).router_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL].data(), 16);
+            if (not (*it).isIPv4 and ls_attrs.has(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL))
+                ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV6_ROUTER_ID_LOCAL, (*it).router_id, 16);
 
-            else if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL) != ls_attrs.end()) {
-                memcpy((*it).router_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL].data(), 4);
+            else if (ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_IPV4_ROUTER_ID_LOCAL, (*it).router_id, 4))
                 (*it).isIPv4 = true;
-            }
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID) != ls_attrs.end())
-                memcpy((*it).isis_area_id, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID].data(), sizeof((*it).isis_area_id));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_IGP_FLAGS) != ls_attrs.end())
-                memcpy((*it).igp_flags, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_PREFIX_IGP_FLAGS].data(), sizeof((*it).igp_flags));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_ROUTE_TAG) != ls_attrs.end())
-                memcpy(&(*it).route_tag, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_PREFIX_ROUTE_TAG].data(), sizeof((*it).route_tag));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_EXTEND_TAG) != ls_attrs.end())
-                memcpy(&(*it).ext_route_tag, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_PREFIX_EXTEND_TAG].data(), sizeof((*it).ext_route_tag));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_PREFIX_METRIC) != ls_attrs.end())
-                memcpy(&(*it).metric, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_PREFIX_PREFIX_METRIC].data(), sizeof((*it).metric));
-
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_OSPF_FWD_ADDR) != ls_attrs.end())
-                memcpy((*it).ospf_fwd_addr, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_PREFIX_OSPF_FWD_ADDR].data(), sizeof((*it).ospf_fwd_addr));
 
-            if (ls_attrs.find(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_SID) != ls_attrs.end())
-                memcpy((*it).sid_tlv, ls_attrs[bgp_msg::MPLinkStateAttr::ATTR_PREFIX_SID].data(), sizeof((*it).sid_tlv));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_NODE_ISIS_AREA_ID, (*it).isis_area_id, sizeof((*it).isis_area_id));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_IGP_FLAGS, (*it).igp_flags, sizeof((*it).igp_flags));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_ROUTE_TAG, &(*it).route_tag, sizeof((*it).route_tag));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_EXTEND_TAG, &(*it).ext_route_tag, sizeof((*it).ext_route_tag));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_PREFIX_METRIC, &(*it).metric, sizeof((*it).metric));
+            ls_attrs.copy(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_OSPF_FWD_ADDR, (*it).ospf_fwd_addr, sizeof((*it).ospf_fwd_addr));
+            ls_attrs.copyString(bgp_msg::MPLinkStateAttr::ATTR_PREFIX_SID, (*it).sid_tlv, sizeof((*it).sid_tlv));
         }
 
         if (remove)
@@ -929,11 +919,9 @@ void parseBGP::UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_
             mbus_ptr->update_LsPrefix(*p_entry, base_attr, ls_data.prefixes, mbus_ptr->LS_ACTION_ADD);
     }
 
-    // Data stored, no longer needed, purge it
+    // Data stored, no longer needed, purge it (capacity is kept for the next update)
     ls_attrs.clear();
-    ls_data.prefixes.clear();
-    ls_data.links.clear();
-    ls_data.nodes.clear();
+    ls_data.clear();
 }
 
 
@@ -17,6 +17,7 @@
 #include "Logger.h"
 #include "bgp_common.h"
 #include "UpdateMsg.h"
+#include "NlriArena.h"
 
 
 using namespace std;
@@ -76,10 +77,10 @@ public:
      * \param [in]     logPtr      Pointer to existing Logger for app logging
      * \param [in]     mbus_ptr     Pointer to exiting dB implementation
      * \param [in,out] peer_entry  Pointer to peer entry
-     * \param [in]     routerAddr  The router IP address - used for logging
+     * \param [in]     routerAddr  The router IP address - used for logging, must outlive the parser
      * \param [in,out] peer_info   Persistent peer information
      */
-    parseBGP(Logger *logPtr, MsgBusInterface *mbus_ptr, MsgBusInterface::obj_bgp_peer *peer_entry, string routerAddr,
+    parseBGP(Logger *logPtr, MsgBusInterface *mbus_ptr, MsgBusInterface::obj_bgp_peer *peer_entry, const char *routerAddr,
              BMPReader::peer_info *peer_info);
 
     virtual ~parseBGP();
@@ -152,8 +153,9 @@ private:
     MsgBusInterface::obj_path_attr   base_attr;      ///< Base attribute object
 
     MsgBusInterface *mbus_ptr;                       ///< Pointer to open DB implementation
-    string                           router_addr;    ///< Router IP address - used for logging
+    const char                       *router_addr;   ///< Router IP address - used for logging
     BMPReader::peer_info             *p_info;        ///< Persistent Peer information
+    bgp_msg::NlriArena               *arena;         ///< Prefix storage of the peer, set while handling an update
 
     unsigned char path_hash_id[16];                  ///< current path hash ID
 
@@ -184,33 +186,41 @@ private:
      */
     void UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data);
 
+    /**
+     * Count the update and its NLRIs by address family in the metrics
+     *
+     * \param  parsed_data          Reference to the parsed update data
+     */
+    void countMetrics(bgp_msg::UpdateMsg::parsed_update_data &parsed_data);
+
     /**
      * Update the Database path attributes
      *
      * \details This method will update the database for the supplied path attributes
      *
-     * \param  attrs            Reference to the parsed attributes map
+     * \param  attrs            Reference to the parsed attributes
+     * \param  cache_entry      Cached attribute set for attrs, NULL if not cached
      */
-    void UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
+    void UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs &attrs, bgp_msg::PathAttrCacheEntry *cache_entry);
 
     /**
      * Update the Database advertised prefixes
      *
      * \details This method will update the database for the supplied advertised prefixes
      *
-     * \param  adv_prefixes         Reference to the list<prefix_tuple> of advertised prefixes
-     * \param  attrs            Reference to the parsed attributes map
+     * \param  adv_prefixes         Reference to the vector<prefix_tuple> of advertised prefixes
+     * \param  attrs            Reference to the parsed attributes
      */
-    void UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes, bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
+    void UpdateDBAdvPrefixes(std::vector<bgp::prefix_tuple> &adv_prefixes, bgp_msg::UpdateMsg::parsed_attrs &attrs);
 
     /**
      * Update the Database withdrawn prefixes
      *
      * \details This method will update the database for the supplied advertised prefixes
      *
-     * \param  wdrawn_prefixes         Reference to the list<prefix_tuple> of withdrawn prefixes
+     * \param  wdrawn_prefixes         Reference to the vector<prefix_tuple> of withdrawn prefixes
      */
-    void UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefixes);
+    void UpdateDBWdrawnPrefixes(std::vector<bgp::prefix_tuple> &wdrawn_prefixes);
 
     /**
      * Update the Database advertised l3vpn 
@@ -218,19 +228,19 @@ private:
      * \details This method will update the database for the supplied advertised prefixes
      *
      * \param [in] remove       True if the records should be deleted, false if they are to be added/updated
-     * \param [in] adv_vpn      Reference to the list<vpn_tuple> of advertised vpns
-     * \param [in] attrs        Reference to the parsed attributes map
+     * \param [in] adv_vpn      Reference to the vector<vpn_tuple> of advertised vpns
+     * \param [in] attrs        Reference to the parsed attributes
      */ 
-    void UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &adv_vpn, bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
+    void UpdateDBL3Vpn(bool remove, std::vector<bgp::vpn_tuple> &adv_vpn, bgp_msg::UpdateMsg::parsed_attrs &attrs);
 
     /**
      * Updates for either advertised or withdrawn Evpn NLRI's
      *
      * \param [in] remove          True if the records should be deleted, false if they are to be added/updated
-     * \param [in] nlris           Reference to the list<evpn_tuple>
-     * \param [in] attrs           Reference to the parsed attributes map
+     * \param [in] nlris           Reference to the vector<evpn_tuple>
+     * \param [in] attrs           Reference to the parsed attributes
      */
-    void UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris, bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
+    void UpdateDBeVPN(bool remove, std::vector<bgp::evpn_tuple> &nlris, bgp_msg::UpdateMsg::parsed_attrs &attrs);
 
     /**
      * Update the Database for bgp-ls
@@ -241,8 +251,8 @@ private:
      * \param [in] ls_data     Reference to the parsed link state nlri information
      * \param [in] ls_attrs    Reference to the parsed link state attribute information
      */
-    void UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls ls_data,
-                                 bgp_msg::UpdateMsg::parsed_ls_attrs_map &ls_attrs);
+    void UpdateDbBgpLs(bool remove, bgp_msg::UpdateMsg::parsed_data_ls &ls_data,
+                       bgp_msg::LsAttrTable &ls_attrs);
 
 
 };
@@ -20,10 +20,12 @@
 #include <string>
 
 #include <poll.h>
+#include <netinet/tcp.h>
 #include <MsgBusInterface.hpp>
 
 #include "BMPListener.h"
-#include "md5.h"
+#include "HashEngine.h"
+#include "ClusterManager.h"
 
 using namespace std;
 
@@ -35,8 +37,7 @@ using namespace std;
  *
  */
 BMPListener::BMPListener(Logger *logPtr, Config *config) {
-    sock = 0;
-    sockv6 = 0;
+    next_sock = 0;
     debug = false;
 
     // Update pointer to the config
@@ -74,10 +75,11 @@ BMPListener::BMPListener(Logger *logPtr, Config *config) {
  * Destructor
  */
 BMPListener::~BMPListener() {
-    if (sock > 0)
-        close(sock);
-    if (sockv6 > 0)
-        close(sockv6);
+    for (size_t i = 0; i < socks.size(); i++)
+        close(socks[i]);
+
+    for (size_t i = 0; i < pending.size(); i++)
+        close(pending[i].c_sock);
 
     delete cfg;
 }
@@ -85,13 +87,39 @@ BMPListener::~BMPListener() {
 /**
  * Opens server (v4 or 6) listening socket(s)
  *
+ * \details socket.listeners sockets are opened for each address family.  When more than one,
+ *          they share the port with SO_REUSEPORT and the kernel spreads the connections
+ *          across their accept queues.
+ *
  * \param [in] ipv4     True to open v4 socket
  * \param [in] ipv6     True to open v6 socket
  */
 void BMPListener::open_socket(bool ipv4, bool ipv6) {
+    for (int i = 0; i < cfg->socket_listeners; i++) {
+        if (ipv4) {
+            socks.push_back(open_listener(true));
+            socks_v4.push_back(true);
+        }
+
+        if (ipv6) {
+            socks.push_back(open_listener(false));
+            socks_v4.push_back(false);
+        }
+    }
+}
+
+/**
+ * Open a listening socket
+ *
+ * \param [in] isIPv4   True to open a v4 socket, false for v6
+ *
+ * \return listening socket
+ */
+int BMPListener::open_listener(bool isIPv4) {
     int on = 1;
+    int sock;
 
-    if (ipv4) {
+    if (isIPv4) {
         if ((sock = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
             throw "ERROR: Cannot open IPv4 socket.";
         }
@@ -102,41 +130,50 @@ void BMPListener::open_socket(bool ipv4, bool ipv6) {
             throw "ERROR: Failed to set IPv4 socket option SO_REUSEADDR";
         }
 
-        // Bind to the address/port
-        if (::bind(sock, (struct sockaddr *) &svr_addr, sizeof(svr_addr)) < 0) {
-            close(sock);
-            throw "ERROR: Cannot bind to IPv4 address and port";
-        }
-
-        // listen for incoming connections
-        listen(sock, 10);
-    }
-
-    if (ipv6) {
-        if ((sockv6 = socket(AF_INET6, SOCK_STREAM, 0)) < 0) {
+    } else {
+        if ((sock = socket(AF_INET6, SOCK_STREAM, 0)) < 0) {
             throw "ERROR: Cannot open IPv6 socket.";
         }
 
         // Set socket options
-        if (setsockopt(sockv6, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0) {
-            close(sockv6);
+        if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0) {
+            close(sock);
             throw "ERROR: Failed to set IPv6 socket option SO_REUSEADDR";
         }
 
-        if (setsockopt(sockv6, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on)) < 0) {
-            close(sockv6);
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &on, sizeof(on)) < 0) {
+            close(sock);
             throw "ERROR: Failed to set IPv6 socket option IPV6_V6ONLY";
         }
+    }
 
-        // Bind to the address/port
-        if (::bind(sockv6, (struct sockaddr *) &svr_addrv6, sizeof(svr_addrv6)) < 0) {
-            close(sockv6);
-            throw "ERROR: Cannot bind to IPv6 address and port";
+    if (cfg->socket_listeners > 1 and setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        close(sock);
+        throw "ERROR: Failed to set socket option SO_REUSEPORT";
+    }
+
+    // Accepted sockets inherit the buffer size, it has to be set before listen for the TCP window scale
+    if (cfg->socket_rcvbuf > 0 and
+            setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &cfg->socket_rcvbuf, sizeof(cfg->socket_rcvbuf)) < 0) {
+        LOG_WARN("sock=%d: Unable to set the socket receive buffer to %d bytes", sock, cfg->socket_rcvbuf);
+    }
+
+    // Bind to the address/port
+    if (isIPv4) {
+        if (::bind(sock, (struct sockaddr *) &svr_addr, sizeof(svr_addr)) < 0) {
+            close(sock);
+            throw "ERROR: Cannot bind to IPv4 address and port";
         }
 
-        // listen for incoming connections
-        listen(sockv6, 10);
+    } else if (::bind(sock, (struct sockaddr *) &svr_addrv6, sizeof(svr_addrv6)) < 0) {
+        close(sock);
+        throw "ERROR: Cannot bind to IPv6 address and port";
     }
+
+    // listen for incoming connections
+    listen(sock, cfg->socket_backlog);
+
+    return sock;
 }
 
 /**
@@ -152,61 +189,90 @@ void BMPListener::open_socket(bool ipv4, bool ipv6) {
  * \return  True if accepted a connection, false if not (timed out waiting)
  */
 bool BMPListener::wait_and_accept_connection(ClientInfo &c, int timeout) {
-    pollfd pfd[4];
-    int fds_cnt = 0;
-    int cur_sock = 0;
+    std::vector<pollfd> pfd(socks.size());
+    int fds_cnt = socks.size();
+    int cur = -1;
     bool close_sock = false;
 
-    if (sock > 0) {
-        pfd[fds_cnt].fd = sock;
-        pfd[fds_cnt].events = POLLIN | POLLHUP | POLLERR;
-        pfd[fds_cnt].revents = 0;
-        fds_cnt++;
-    }
+    if (finish_pending(c))
+        return true;
 
-    if (sockv6 > 0) {
-        pfd[fds_cnt].fd = sockv6;
-        pfd[fds_cnt].events = POLLIN | POLLHUP | POLLERR;
-        pfd[fds_cnt].revents = 0;
-        fds_cnt++;
+    // Wake up to check the pending PROXY headers again
+    if (pending.size() > 0 and (timeout < 0 or timeout > 50))
+        timeout = 50;
+
+    for (int i = 0; i < fds_cnt; i++) {
+        pfd[i].fd = socks[i];
+        pfd[i].events = POLLIN | POLLHUP | POLLERR;
+        pfd[i].revents = 0;
     }
 
     // Check if the listening socket has a new connection
-    if (poll(pfd, fds_cnt + 1, timeout)) {
+    if (fds_cnt > 0 and poll(pfd.data(), fds_cnt, timeout) > 0) {
+
+        // Start after the last accepted socket so the listeners are served in turn
+        for (int n = 0; n < fds_cnt; n++) {
+            int i = (next_sock + n) % fds_cnt;
 
-        for (int i = 0; i < fds_cnt; i++) {
             if (pfd[i].revents & POLLHUP or pfd[i].revents & POLLERR) {
                 LOG_WARN("sock=%d: received POLLHUP/POLLHERR while accepting", pfd[i].fd);
-                cur_sock = pfd[i].fd;
+                cur = i;
                 close_sock = true;
                 break;
 
             } else if (pfd[i].revents & POLLIN) {
-                cur_sock = pfd[i].fd;
+                cur = i;
                 break;
             }
         }
     }
 
-    if (cur_sock > 0) {
+    if (cur >= 0) {
         if (close_sock) {
-            if (cur_sock == sock)
-                close(sock);
-            else if (cur_sock == sockv6)
-                close(sockv6);
+            close(socks[cur]);
+            socks.erase(socks.begin() + cur);
+            socks_v4.erase(socks_v4.begin() + cur);
         }
 
         else {
-            if (cur_sock == sock)  // IPv4
-                accept_connection(c, true);
+            next_sock = cur + 1;
+            return accept_connection(c, socks[cur], socks_v4[cur]);
+        }
+    }
 
-            else // IPv6
-                accept_connection(c, false);
-		
-	    gettimeofday(&c.startTime, NULL);	// Stores the start time for client	
+    return false;
+}
 
-            return true;
+/**
+ * Finish an accepted connection of a cluster member whose PROXY header was pending
+ *
+ * \param [out] c          Client info of the finished connection
+ *
+ * \return true if one is finished, its header arrived or CLUSTER_PROXY_WAIT_MS expired
+ */
+bool BMPListener::finish_pending(ClientInfo &c) {
+    timeval now;
+    gettimeofday(&now, NULL);
+
+    for (size_t i = 0; i < pending.size(); i++) {
+        ClientInfo &p = pending[i];
+        int proxy = ClusterManager::readProxyHeader(p);
+
+        if (proxy == ClusterManager::PROXY_PENDING) {
+            long waited = (now.tv_sec - p.startTime.tv_sec) * 1000 + (now.tv_usec - p.startTime.tv_usec) / 1000;
+
+            if (waited < CLUSTER_PROXY_WAIT_MS)
+                continue;
+
+            LOG_NOTICE("%s: sock=%d: No PROXY header from cluster node, collecting it as a router", p.c_ip, p.c_sock);
         }
+
+        p.forwarded = proxy == ClusterManager::PROXY_FORWARDED;
+        hashRouter(p);
+
+        c = p;
+        pending.erase(pending.begin() + i);
+        return true;
     }
 
     return false;
@@ -221,13 +287,20 @@ bool BMPListener::wait_and_accept_connection(ClientInfo &c, int timeout) {
  * Supports IPv4 and IPv6 sockets
  *
  * \param [out]  c       Client information reference to where the client info will be stored
+ * \param [in]   sock    Listening socket to accept from
  * \param [in]   isIPv4  True to indicate if IPv4, false if IPv6
+ *
+ * \return true if accepted, false if it waits for its PROXY header, see finish_pending()
  */
-void BMPListener::accept_connection(ClientInfo &c, bool isIPv4) {
+bool BMPListener::accept_connection(ClientInfo &c, int sock, bool isIPv4) {
     socklen_t c_addr_len = sizeof(c.c_addr);         // the client info length
     socklen_t s_addr_len = sizeof(c.s_addr);         // the client info length
     c.initRec=false;				     // To indicate INIT message not received
-    int sock = isIPv4 ? this->sock : this->sockv6;
+    c.ribDumpDone = false;                           // Set by the reader when the initial RIB dump is done
+    c.ring = NULL;                                   // Ring is setup by the client thread if enabled
+    c.incoming_cpu = -1;
+    c.placement_node = -1;
+    c.placement_cpu = -1;
 
     sockaddr_in *v4_addr = (sockaddr_in *) &c.c_addr;
     sockaddr_in6 *v6_addr = (sockaddr_in6 *) &c.c_addr;
@@ -281,8 +354,56 @@ void BMPListener::accept_connection(ClientInfo &c, bool isIPv4) {
     if (setsockopt(c.c_sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) < 0) {
         LOG_NOTICE("%s: sock=%d: Unable to enable tcp keepalives", c.c_ip, c.c_sock);
     }
-    
+
+    setSocketOptions(c);
+
+    gettimeofday(&c.startTime, NULL);   // Stores the start time for client
+
+    // Routers forwarded by another node of the cluster are hashed by their own address
+    int proxy = ClusterManager::enabled() ? ClusterManager::readProxyHeader(c) : ClusterManager::PROXY_NONE;
+
+    if (proxy == ClusterManager::PROXY_PENDING) {
+        // Not waited for here, the header is read by a later wait_and_accept_connection()
+        pending.push_back(c);
+        return false;
+    }
+
+    c.forwarded = proxy == ClusterManager::PROXY_FORWARDED;
     hashRouter(c);
+
+    return true;
+}
+
+/**
+ * Set the configured options of an accepted router socket
+ *
+ * \param [in,out] c        Client info of the accepted connection, incoming_cpu is updated
+ */
+void BMPListener::setSocketOptions(ClientInfo &c) {
+    int on = 1;
+
+    // Acks aren't delayed, the router isn't held back waiting for window updates
+    if (cfg->socket_quickack and setsockopt(c.c_sock, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on)) < 0) {
+        LOG_NOTICE("%s: sock=%d: Unable to enable tcp quickack", c.c_ip, c.c_sock);
+    }
+
+#ifdef SO_BUSY_POLL
+    if (cfg->socket_busy_poll > 0 and
+            setsockopt(c.c_sock, SOL_SOCKET, SO_BUSY_POLL, &cfg->socket_busy_poll, sizeof(cfg->socket_busy_poll)) < 0) {
+        LOG_NOTICE("%s: sock=%d: Unable to set busy poll to %d usecs", c.c_ip, c.c_sock, cfg->socket_busy_poll);
+    }
+#endif
+
+#ifdef SO_INCOMING_CPU
+    if (cfg->socket_incoming_cpu or cfg->placement_policy != "none") {
+        socklen_t len = sizeof(c.incoming_cpu);
+
+        if (getsockopt(c.c_sock, SOL_SOCKET, SO_INCOMING_CPU, &c.incoming_cpu, &len) < 0)
+            c.incoming_cpu = -1;
+        else
+            SELF_DEBUG("%s: sock=%d: Router packets are received on cpu %d", c.c_ip, c.c_sock, c.incoming_cpu);
+    }
+#endif
 }
 
 /**
@@ -296,15 +417,13 @@ void BMPListener::hashRouter(ClientInfo &client) {
     string c_hash_str;
     MsgBusInterface::hash_toStr(cfg->c_hash_id, c_hash_str);
 
-    MD5 hash;
+    HashEngine hash;
     hash.update((unsigned char *)client.c_ip, strlen(client.c_ip));
     hash.update((unsigned char *)c_hash_str.c_str(), c_hash_str.length());
     hash.finalize();
 
     // Save the hash
-    unsigned char *hash_bin = hash.raw_digest();
-    memcpy(client.hash_id, hash_bin, 16);
-    delete[] hash_bin;
+    hash.digest(client.hash_id);
 }
 
 /*
@@ -14,9 +14,11 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <ctime>
+#include <vector>
 
 #include "Logger.h"
 #include "Config.h"
+#include "spscRing.hpp"
 
 using namespace std;
 
@@ -27,8 +29,9 @@ using namespace std;
  * \details Maintains received connections and data from those connections.
  */
 class BMPListener {
-    int          sock;                           ///< Listening socket (ipv4)
-    int          sockv6;                         ///< IPv6 listening socket
+    std::vector<int>  socks;                     ///< Listening sockets
+    std::vector<bool> socks_v4;                  ///< Indicates if the listening socket of the same index is IPv4
+    int          next_sock;                      ///< Index of the listening socket checked first
     sockaddr_in  svr_addr;                       ///< Server v4 address
     sockaddr_in6 svr_addrv6;                     ///< Server v6 address
 
@@ -40,10 +43,16 @@ public:
     public:
         u_char      hash_id[16];            ///< Hash ID for router (is the unique ID)
 	bool	    initRec;		    ///< This bool is true if the init message is received
+        bool        ribDumpDone;            ///< Indicates the initial RIB dump is done, set by the reader
         sockaddr_storage c_addr;            ///< client address info
         sockaddr_storage s_addr;            ///< Server/collector address info
         int         c_sock;                 ///< Active client socket connection
         int         pipe_sock;              ///< Piped socket for client stream (buffered) - zero if not buffered
+        spscRing    *ring;                  ///< In-process ring for client stream (buffered) - NULL if not used
+        int         incoming_cpu;           ///< CPU receiving the router packets (SO_INCOMING_CPU), -1 if unknown
+        int         placement_node;         ///< Node the router threads are placed on (CpuPlacement), -1 if not placed
+        int         placement_cpu;          ///< Core the router threads are pinned to, -1 if the whole node
+        bool        forwarded;              ///< Connection was forwarded by another node of the cluster
         char        c_port[6];              ///< Client source port
         char        c_ip[46];               ///< Client IP source address
         char        s_port[6];              ///< Server/collector port
@@ -105,6 +114,22 @@ private:
      */
     void open_socket(bool ipv4, bool ipv6);
 
+    /**
+     * Open a listening socket
+     *
+     * \param [in] isIPv4   True to open a v4 socket, false for v6
+     *
+     * \return listening socket
+     */
+    int open_listener(bool isIPv4);
+
+    /**
+     * Set the configured options of an accepted router socket
+     *
+     * \param [in,out] c        Client info of the accepted connection, incoming_cpu is updated
+     */
+    void setSocketOptions(ClientInfo &c);
+
     /**
      * Accept new/pending connections
      *
@@ -112,9 +137,23 @@ private:
      * Supports IPv4 and IPv6 sockets
      *
      * \param [out]  c  Client information reference to where the client info will be stored
+     * \param [in]   sock    Listening socket to accept from
      * \param [in]   isIPv4  True to indicate if IPv4, false if IPv6
+     *
+     * \return true if accepted, false if it waits for its PROXY header, see finish_pending()
+     */
+    bool accept_connection(ClientInfo &c, int sock, bool isIPv4);
+
+    /**
+     * Finish an accepted connection of a cluster member whose PROXY header was pending
+     *
+     * \param [out] c          Client info of the finished connection
+     *
+     * \return true if one is finished, its header arrived or CLUSTER_PROXY_WAIT_MS expired
      */
-    void accept_connection(ClientInfo &c, bool isIPv4);
+    bool finish_pending(ClientInfo &c);
+
+    std::vector<ClientInfo> pending;        ///< Accepted connections waiting for their PROXY header
 
 };
 
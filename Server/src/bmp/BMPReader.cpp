@@ -18,25 +18,77 @@
 #include <cstdlib>
 #include <string>
 #include <cerrno>
+#include <cinttypes>
 
 #include "BMPListener.h"
 #include "BMPReader.h"
 #include "parseBMP.h"
+#include "BMPStreamReader.h"
 #include "parseBGP.h"
 #include "MsgBusInterface.hpp"
 #include "Logger.h"
-#include "md5.h"
+#include "HashEngine.h"
+#include "PathAttrCache.h"
+#include "NlriArena.h"
+#include "AdjRibIn.h"
+#include "CollectorState.h"
+#include "CpuPlacement.h"
+#include "MonotonicClock.h"
 
 using namespace std;
 
+/**
+ * Route monitoring message decoded by the parse pipeline
+ */
+class RouteMonTask : public ParsePipeline::Task {
+public:
+    /**
+     * Constructor, copies the message and peer entry
+     *
+     * \param [in] logPtr      Pointer to existing Logger for app logging
+     * \param [in] mbus_ptr    Message bus of the router
+     * \param [in] p_entry     Peer entry of the message
+     * \param [in] router_addr Router address
+     * \param [in] p_info      Persistent peer info, only used by the strand of the peer
+     * \param [in] data        BGP message
+     * \param [in] size        Size of the BGP message
+     * \param [in] debug       Enable BGP parser debug
+     */
+    RouteMonTask(Logger *logPtr, MsgBusInterface *mbus_ptr, MsgBusInterface::obj_bgp_peer &p_entry,
+                 char *router_addr, BMPReader::peer_info *p_info, u_char *data, size_t size, bool debug)
+            : logger(logPtr), mbus_ptr(mbus_ptr), p_entry(p_entry), router_addr(router_addr),
+              p_info(p_info), data(data, data + size), debug(debug) {
+    }
+
+    void run() {
+        parseBGP pBGP(logger, mbus_ptr, &p_entry, router_addr.c_str(), p_info);
+
+        if (debug)
+            pBGP.enableDebug();
+
+        pBGP.handleUpdate(data.data(), data.size());
+    }
+
+private:
+    Logger                          *logger;
+    MsgBusInterface                 *mbus_ptr;
+    MsgBusInterface::obj_bgp_peer   p_entry;
+    string                          router_addr;
+    BMPReader::peer_info            *p_info;
+    std::vector<u_char>             data;
+    bool                            debug;
+};
+
 /**
  * Class constructor
  *
- *  \param [in] logPtr  Pointer to existing Logger for app logging
- *  \param [in] config  Pointer to the loaded configuration
+ *  \param [in] logPtr      Pointer to existing Logger for app logging
+ *  \param [in] config      Pointer to the loaded configuration
+ *  \param [in] pipeline    Parse pipeline to decode route monitoring messages, NULL to decode inline
+ *  \param [in] admission   Paces the messages read, NULL if not used
  *
  */
-BMPReader::BMPReader(Logger *logPtr, Config *config) {
+BMPReader::BMPReader(Logger *logPtr, Config *config, ParsePipeline *pipeline, AdmissionController *admission) {
     debug = false;
 
     cfg = config;
@@ -46,18 +98,109 @@ BMPReader::BMPReader(Logger *logPtr, Config *config) {
     if (cfg->debug_bmp)
         enableDebug();
     
-    hasPrevRIBdumpTime = false;
-    maxRIBdumpRate = 0;
+    rib_dump_msgs = 0;
+    metrics = NULL;
+
+    stream = NULL;
+
+    batch_router_added = false;
+    raw_router_added = false;
+    raw_only = false;
+
+    this->pipeline = pipeline;
+    parse_group = pipeline != NULL ? pipeline->newGroup() : NULL;
+
+    this->admission = admission;
+    admission_wait = true;
+    admission_retry_ms = 0;
 }
 
 /**
  * Destructor
  */
 BMPReader::~BMPReader() {
+    // Queued messages use the peer info, wait for them
+    if (pipeline != NULL)
+        pipeline->freeGroup(parse_group, parse_strands);
+
+    if (stream != NULL)
+        delete stream;
+
+    if (metrics != NULL)
+        Metrics::removeRouter(metrics);
+
+    for (peer_info_map_iter it = peer_info_map.begin(); it != peer_info_map.end(); ++it) {
+        if (it->second.attr_cache != NULL)
+            delete it->second.attr_cache;
 
+        if (it->second.nlri_arena != NULL)
+            delete it->second.nlri_arena;
+
+        if (it->second.adj_rib != NULL)
+            delete it->second.adj_rib;
+    }
 }
 
 
+/**
+ * Restore the capabilities of a new peer saved before a collector restart
+ *
+ * \param [in]  key         Key of the peer in peer_info_map
+ * \param [out] info        Peer info of the new peer
+ */
+void BMPReader::restorePeer(const std::string &key, peer_info &info) {
+    CollectorState::Peer peer;
+
+    if (not CollectorState::getPeer(router_hash_id, key, peer))
+        return;
+
+    info.sent_four_octet_asn = peer.sent_four_octet_asn;
+    info.recv_four_octet_asn = peer.recv_four_octet_asn;
+    info.using_2_octet_asn = peer.using_2_octet_asn;
+
+    for (size_t i = 0; i < peer.add_path.size(); i++)
+        info.add_path_capability.setEnabled(peer.add_path[i].first, peer.add_path[i].second);
+
+    info.restored = true;
+    SELF_DEBUG("%s: restored the peer capabilities saved before the restart", key.c_str());
+}
+
+/**
+ * Save the capabilities of a peer
+ *
+ * \param [in]  key         Key of the peer in peer_info_map
+ * \param [in]  info        Peer info
+ */
+void BMPReader::savePeer(const std::string &key, const peer_info &info) {
+    if (cfg->state_file.empty())
+        return;
+
+    CollectorState::Peer peer;
+
+    peer.sent_four_octet_asn = info.sent_four_octet_asn;
+    peer.recv_four_octet_asn = info.recv_four_octet_asn;
+    peer.using_2_octet_asn = info.using_2_octet_asn;
+    info.add_path_capability.getEnabled(peer.add_path);
+
+    CollectorState::setPeer(router_hash_id, key, peer);
+}
+
+/**
+ * Get the buffered reader for the client stream
+ *
+ * \details The reader is created on first use and persists across messages.
+ *
+ * \param [in]  client      Client information pointer
+ *
+ * \return Pointer to the stream reader
+ */
+BMPStreamReader *BMPReader::getStream(BMPListener::ClientInfo *client) {
+    if (stream == NULL)
+        stream = new BMPStreamReader(client->pipe_sock > 0 ? client->pipe_sock : client->c_sock, client->ring);
+
+    return stream;
+}
+
 /**
  * Read messages from BMP stream in a loop
  *
@@ -81,6 +224,10 @@ void BMPReader::readerThreadLoop(bool &run, BMPListener::ClientInfo *client, Msg
             break;
         }
     }
+
+    // Let the client thread know that nothing more will be read from the ring
+    if (client->ring != NULL)
+        client->ring->close();
 }
 
 /**
@@ -88,6 +235,12 @@ void BMPReader::readerThreadLoop(bool &run, BMPListener::ClientInfo *client, Msg
  *
  * BMP routers send BMP/BGP messages, this method reads and parses those.
  *
+ * \details When batching is enabled (buffers.batch > 1), every complete message that is
+ *          already buffered is parsed in the same call, up to the batch size.  The parser,
+ *          router and peer state are reused for the batch and the message bus is flushed once
+ *          at the end of the batch.  Once no complete message is buffered, the rows coalesced
+ *          by the message bus are flushed.
+ *
  * \param [in]  client      Client information pointer
  * \param [in]  mbus_ptr     The database pointer referencer - DB should be already initialized
  *
@@ -97,23 +250,324 @@ void BMPReader::readerThreadLoop(bool &run, BMPListener::ClientInfo *client, Msg
  */
 bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr) {
     bool rval = true;
-    string peer_info_key;
+    bool batch = cfg->bmp_batch_size > 1;
+    int  msg_count = 0;
 
-    parseBGP *pBGP;                                 // Pointer to BGP parser
+    admission_retry_ms = 0;
+
+    if (cfg->bmp_raw_passthrough or raw_only)
+        return forwardRaw(client, mbus_ptr);
 
     int read_fd = client->pipe_sock > 0 ? client->pipe_sock : client->c_sock;
 
     // Data storage structures
     MsgBusInterface::obj_bgp_peer p_entry;
 
-    // Initialize the parser for BMP messages
-    parseBMP *pBMP = new parseBMP(logger, &p_entry);    // handler for BMP messages
+    // Initialize the parser for BMP messages, freed with the other parsers of the message by the arena reset
+    parseBMP *pBMP = msg_arena.create<parseBMP>(logger, &p_entry);    // handler for BMP messages
+    pBMP->setStream(getStream(client));
+    pBMP->setPeerCache(&peer_cache);
 
     if (cfg->debug_bmp) {
         enableDebug();
         pBMP->enableDebug();
     }
 
+    // Router and peer lookups are only reused within a batch
+    batch_router_added = false;
+
+    if (batch)
+        mbus_ptr->beginBatch();
+
+    try {
+        do {
+            // Wait while the collector is overloaded, the message stays buffered
+            if (not admitMessage())
+                break;
+
+            if (msg_count > 0)
+                pBMP->reset();
+
+            rval = processMessage(client, mbus_ptr, pBMP, p_entry, read_fd);     // Disconnects the router on error
+
+            if (Metrics::enabled)
+                countMessages(client, 1, pBMP->bmp_packet_len);
+
+            if (client->initRec and not client->ribDumpDone)
+                checkRibDump(client, mbus_ptr);
+
+            // Send BMP RAW packet data
+            mbus_ptr->send_bmp_raw(router_hash_id, p_entry, pBMP->bmp_packet, pBMP->bmp_packet_len);
+
+        } while (rval and batch and not raw_only and ++msg_count < cfg->bmp_batch_size and stream->hasFrame());
+
+        // The reader waits for the router next, rows coalesced by the message bus are not held meanwhile
+        if (not stream->hasFrame() or admission_retry_ms != 0) {
+            if (pipeline != NULL) {
+                try {
+                    pipeline->drain(parse_group);
+
+                } catch (char const *str) {
+                    LOG_INFO("%s: Caught: %s", client->c_ip, str);
+                    disconnect(client, mbus_ptr, parseBMP::TERM_REASON_OPENBMP_CONN_ERR, str);
+                    throw str;
+                }
+            }
+
+            mbus_ptr->flush();
+        }
+
+    } catch (char const *str) {
+        if (batch)
+            mbus_ptr->endBatch();
+
+        msg_arena.reset();              // Make sure to free the resources
+        throw str;
+    }
+
+    if (batch)
+        mbus_ptr->endBatch();
+
+    // Free the bmp and bgp parsers
+    msg_arena.reset();
+
+    return rval;
+}
+
+/**
+ * Update the router metrics after messages were read
+ *
+ * \param [in]  client      Client information pointer
+ * \param [in]  msgs        Number of messages read
+ * \param [in]  bytes       Number of bytes read
+ */
+void BMPReader::countMessages(BMPListener::ClientInfo *client, int msgs, size_t bytes) {
+    if (metrics == NULL)
+        metrics = Metrics::addRouter(client->c_ip);
+
+    metrics->messages.store(metrics->messages.load(std::memory_order_relaxed) + msgs,
+                            std::memory_order_relaxed);
+    metrics->bytes.store(metrics->bytes.load(std::memory_order_relaxed) + bytes,
+                         std::memory_order_relaxed);
+
+    CpuPlacement::count(client->placement_node, msgs, bytes);
+
+    if (client->ring != NULL) {
+        metrics->ring_fill.store(client->ring->available(), std::memory_order_relaxed);
+        metrics->ring_size.store(client->ring->capacity(), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Acquire the admission to read the next message
+ *
+ * \return true if it can be read, false if stopped for the rate (admission_retry_ms is set)
+ */
+bool BMPReader::admitMessage() {
+    if (admission == NULL)
+        return true;
+
+    if (admission_wait) {
+        admission->acquire();
+        return true;
+    }
+
+    admission_retry_ms = admission->tryAcquire();
+
+    return admission_retry_ms == 0;
+}
+
+/**
+ * Set if the reader waits for the admission rate, true by default
+ *
+ * \param [in]  wait        True to wait, false to return
+ */
+void BMPReader::setAdmissionWait(bool wait) {
+    admission_wait = wait;
+}
+
+/**
+ * Time the last ReadIncomingMsg() stopped at for the admission rate
+ *
+ * \return Time to call it again at (monotonicMs()), 0 if it didn't stop
+ */
+uint64_t BMPReader::admissionRetryMs() {
+    return admission_retry_ms;
+}
+
+/**
+ * Length of a raw BMP message from its common header
+ *
+ * \param [in] hdr      BMP common header
+ *
+ * \return Message length including the common header
+ *
+ * \throw (char const *str) message indicate error
+ */
+static size_t rawMessageLength(const u_char *hdr) {
+    uint32_t len;
+
+    if (hdr[0] != 3)
+        throw "BMPReader: raw passthrough only supports BMP version 3";
+
+    memcpy(&len, hdr + 1, sizeof(len));
+    bgp::SWAP_BYTES(&len);
+
+    if (len < BMP_HDRv3_LEN + 1 or len > BMP_STREAM_BUF_SIZE)
+        throw "BMPReader: invalid BMP message length";
+
+    return len;
+}
+
+/**
+ * Peer ASN of a raw BMP message
+ *
+ * \param [in] msg      BMP message, starting with the common header
+ * \param [in] len      Length of the message
+ *
+ * \return Peer ASN from the per-peer header, 0 if the message has no peer header
+ */
+static uint32_t rawPeerAsn(const u_char *msg, size_t len) {
+    uint32_t asn = 0;
+
+    // Common header, then peer type, flags, RD and address before the ASN
+    if (msg[5] <= parseBMP::TYPE_PEER_UP and len >= BMP_HDRv3_LEN + 1 + BMP_PEER_HDR_LEN) {
+        memcpy(&asn, msg + BMP_HDRv3_LEN + 1 + 26, sizeof(asn));
+        bgp::SWAP_BYTES(&asn);
+    }
+
+    return asn;
+}
+
+/**
+ * Forward consecutive BMP messages without parsing them (raw.passthrough)
+ *
+ * \details Messages are framed in the stream buffer by the common header length.  The
+ *          first message is waited for, following ones are added while they are already
+ *          buffered, up to raw.batch_size bytes.
+ *
+ * \param [in]  client      Client information pointer
+ * \param [in]  mbus_ptr    The database pointer referencer - DB should be already initialized
+ *
+ * \return true if more to read, false if the connection is done/closed
+ *
+ * \throw (char const *str) message indicate error
+ */
+bool BMPReader::forwardRaw(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr) {
+    BMPStreamReader *rd = getStream(client);
+    bool        by_asn = mbus_ptr->rawByPeerAsn();
+    bool        rval = true;
+    u_char      *batch = NULL;
+    size_t      len = 0;
+    int         count = 0;
+    uint32_t    peer_asn = 0;
+
+    memcpy(router_hash_id, client->hash_id, sizeof(router_hash_id));
+
+    // Wait while the collector is overloaded, the messages stay buffered
+    if (not admitMessage())
+        return true;
+
+    try {
+        if (not raw_router_added) {
+            MsgBusInterface::obj_router r_object;
+            bzero(&r_object, sizeof(r_object));
+            memcpy(r_object.hash_id, router_hash_id, sizeof(r_object.hash_id));
+            memcpy(r_object.ip_addr, client->c_ip, sizeof(client->c_ip));
+
+            mbus_ptr->update_Router(r_object, mbus_ptr->ROUTER_ACTION_FIRST);
+            raw_router_added = true;
+        }
+
+        while (rval and len < (size_t)cfg->bmp_raw_batch_bytes) {
+            u_char *msg;
+            size_t msg_len;
+
+            if (count == 0) {
+                // Wait for the first message, pointers of the buffer are stable from here on
+                if ((msg = rd->frame(BMP_HDRv3_LEN + 1)) == NULL)
+                    throw "BMPReader: Unable to read from client socket";
+
+                msg_len = rawMessageLength(msg);
+
+                if ((batch = rd->frame(msg_len)) == NULL)
+                    throw "BMPReader: Unable to read from client socket";
+
+                msg = batch;
+
+            } else {
+                if (rd->buffered() < len + BMP_HDRv3_LEN + 1)
+                    break;
+
+                msg = batch + len;
+                msg_len = rawMessageLength(msg);
+
+                if (rd->buffered() < len + msg_len or len + msg_len > (size_t)cfg->bmp_raw_batch_bytes)
+                    break;
+            }
+
+            uint32_t asn = rawPeerAsn(msg, msg_len);
+            if (count > 0 and by_asn and asn != peer_asn)
+                break;
+
+            peer_asn = asn;
+
+            switch (msg[5]) {
+                case parseBMP::TYPE_INIT_MSG :
+                    // No RIB is parsed, the router doesn't need to be paced by the RIB dump
+                    client->initRec = true;
+                    client->ribDumpDone = true;
+                    break;
+
+                case parseBMP::TYPE_TERM_MSG :
+                    rval = false;
+                    break;
+            }
+
+            len += msg_len;
+            ++count;
+        }
+
+        mbus_ptr->send_bmp_raw_batch(router_hash_id, peer_asn, batch, len);
+        rd->consume(len);
+
+        if (Metrics::enabled)
+            countMessages(client, count, len);
+
+        if (not rval) {
+            LOG_INFO("%s: Term message received, disconnecting router", client->c_ip);
+            disconnect(client, mbus_ptr, parseBMP::TERM_REASON_OPENBMP_CONN_CLOSED, "Termination message received");
+        }
+
+    } catch (char const *str) {
+        LOG_INFO("%s: Caught: %s", client->c_ip, str);
+        disconnect(client, mbus_ptr, parseBMP::TERM_REASON_OPENBMP_CONN_ERR, str);
+        throw str;
+    }
+
+    return rval;
+}
+
+/**
+ * Parse and process a single BMP message
+ *
+ * \param [in]  client      Client information pointer
+ * \param [in]  mbus_ptr    The database pointer referencer - DB should be already initialized
+ * \param [in]  pBMP        BMP parser, reset for this message
+ * \param [in]  p_entry     Peer entry used by pBMP
+ * \param [in]  read_fd     Socket to read the message from
+ *
+ * \return true if more to read, false if the connection is done/closed
+ *
+ * \throw (char const *str) message indicate error
+ */
+bool BMPReader::processMessage(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr, parseBMP *pBMP,
+                               MsgBusInterface::obj_bgp_peer &p_entry, int read_fd) {
+    bool rval = true;
+    peer_info *p_info = NULL;                       // Info of the message peer, NULL if no peer header
+
+    parseBGP *pBGP;                                 // Pointer to BGP parser
+
     char bmp_type = 0;
 
     MsgBusInterface::obj_router r_object;
@@ -127,26 +581,112 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
     try {
         bmp_type = pBMP->handleMessage(read_fd);
 
+        // Other messages use or change the peer state, the queued route monitoring messages are done first
+        if (pipeline != NULL and bmp_type != parseBMP::TYPE_ROUTE_MON)
+            pipeline->drain(parse_group);
+
         /*
          * Now that we have parsed the BMP message...
          *  add record to the database
          */
 
-        if (bmp_type != parseBMP::TYPE_INIT_MSG)
+        if (bmp_type != parseBMP::TYPE_INIT_MSG and not batch_router_added) {
             mbus_ptr->update_Router(r_object, mbus_ptr->ROUTER_ACTION_FIRST);              // add the router entry
+            batch_router_added = true;
+        }
 
         // only process the peering info if the message includes it
         if (bmp_type < 4) {
             // Update p_entry hash_id now that add_Router updated it.
             memcpy(p_entry.router_hash_id, r_object.hash_id, sizeof(r_object.hash_id));
-            peer_info_key =  p_entry.peer_addr;
-            peer_info_key += p_entry.peer_rd;
 
-            if (bmp_type != parseBMP::TYPE_PEER_UP)
-                mbus_ptr->update_Peer(p_entry, NULL, NULL, mbus_ptr->PEER_ACTION_FIRST);     // add the peer entry
+            // Peer info is looked up once per peer, the peer cache keeps it
+            PeerCacheEntry *peer = pBMP->peer;
+            if (peer->info == NULL) {
+                bool added = peer_info_map.find(peer->info_key) == peer_info_map.end();
+                peer->info = &peer_info_map[peer->info_key];
+
+                if (added)
+                    restorePeer(peer->info_key, *(peer_info *)peer->info);
+            }
+
+            p_info = (peer_info *)peer->info;
+
+            if (bmp_type != parseBMP::TYPE_PEER_UP) {
+                // Peer was already added, reuse the hash instead of looking it up again
+                if (bmp_type != parseBMP::TYPE_PEER_DOWN and peer->hash_gen == peer_cache.generation()) {
+                    memcpy(p_entry.hash_id, peer->hash_id, sizeof(p_entry.hash_id));
+
+                } else {
+                    mbus_ptr->update_Peer(p_entry, NULL, NULL, mbus_ptr->PEER_ACTION_FIRST);     // add the peer entry
+
+                    memcpy(peer->hash_id, p_entry.hash_id, sizeof(peer->hash_id));
+                    peer->hash_gen = peer_cache.generation();
+
+                    // Outputs are set with the peer group, data of the disabled outputs is not decoded
+                    uint32_t skip_outputs = ~mbus_ptr->getPeerOutputs(p_entry.hash_id) & MSGBUS_OUTPUT_ALL;
+                    if (skip_outputs != p_info->skip_outputs) {
+                        if (pipeline != NULL)
+                            pipeline->drain(parse_group);
+
+                        p_info->skip_outputs = skip_outputs;
+                    }
+                }
+            }
+
+            // Peer state changes, next message needs to add the peer again
+            if (bmp_type == parseBMP::TYPE_PEER_UP or bmp_type == parseBMP::TYPE_PEER_DOWN) {
+                peer->hash_gen = 0;
+
+                // Cached attributes are only valid for the peer session
+                bgp_msg::PathAttrCache *attr_cache = p_info->attr_cache;
+                if (attr_cache != NULL) {
+                    if (attr_cache->hits or attr_cache->misses)
+                        LOG_INFO("%s: rtr=%s: path attribute cache hits=%" PRIu64 " misses=%" PRIu64 " evictions=%" PRIu64
+                                 " hit rate=%.1f%%", p_entry.peer_addr, r_object.ip_addr, attr_cache->hits, attr_cache->misses,
+                                 attr_cache->evictions, 100.0 * attr_cache->hits / (attr_cache->hits + attr_cache->misses));
+
+                    attr_cache->clear();
+                }
+
+                // Routes are only valid for the peer session
+                bgp_msg::AdjRibIn *adj_rib = p_info->adj_rib;
+                if (adj_rib != NULL) {
+                    std::lock_guard<std::mutex> lock(adj_rib->mutex);
+
+                    LOG_INFO("%s: rtr=%s: adj-rib-in routes=%zu memory=%zu duplicates=%" PRIu64 " enriched withdraws=%" PRIu64,
+                             p_entry.peer_addr, r_object.ip_addr, adj_rib->size(), adj_rib->memory(),
+                             adj_rib->duplicates, adj_rib->enriched);
 
-            if (not peer_info_map[peer_info_key].using_2_octet_asn and p_entry.isTwoOctet) {
-                peer_info_map[peer_info_key].using_2_octet_asn = true;
+                    adj_rib->clear();
+
+                    // Peer up has the new peer session
+                    if (cfg->adj_rib_in_resync_rate > 0)
+                        adj_rib->setPublisher(mbus_ptr, p_entry);
+                }
+
+            } else if (bmp_type == parseBMP::TYPE_ROUTE_MON) {
+                if (cfg->attr_cache_size > 0 and p_info->attr_cache == NULL)
+                    p_info->attr_cache = new bgp_msg::PathAttrCache(cfg->attr_cache_size);
+
+                if (cfg->adj_rib_in and p_info->adj_rib == NULL) {
+                    p_info->adj_rib = new bgp_msg::AdjRibIn(p_entry.hash_id, p_entry.peer_addr, (char *)r_object.ip_addr,
+                                                            cfg->adj_rib_in_dedup);
+
+                    // Keeps the path attributes so the peer can be resynced
+                    if (cfg->adj_rib_in_resync_rate > 0) {
+                        std::lock_guard<std::mutex> lock(p_info->adj_rib->mutex);
+                        p_info->adj_rib->setPublisher(mbus_ptr, p_entry);
+                    }
+                }
+            }
+
+            if (not p_info->using_2_octet_asn and p_entry.isTwoOctet) {
+                if (pipeline != NULL)
+                    pipeline->drain(parse_group);
+
+                p_info->using_2_octet_asn = true;
+                savePeer(pBMP->peer->info_key, *p_info);
             }
         }
 
@@ -164,8 +704,8 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
 
 
                     // Prepare the BGP parser
-                    pBGP = new parseBGP(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
-                                        &peer_info_map[peer_info_key]);
+                    pBGP = msg_arena.create<parseBGP>(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
+                                                       p_info);
 
                     if (cfg->debug_bgp)
                        pBGP->enableDebug();
@@ -201,8 +741,6 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
                         }
                     }
 
-                    delete pBGP;            // Free the bgp parser after each use.
-
                     // Add event to the database
                     mbus_ptr->update_Peer(p_entry, NULL, &down_event, mbus_ptr->PEER_ACTION_DOWN);
 
@@ -225,17 +763,21 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
                     pBMP->bufferBMPMessage(read_fd);
 
                     // Prepare the BGP parser
-                    pBGP = new parseBGP(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
-                                        &peer_info_map[peer_info_key]);
+                    pBGP = msg_arena.create<parseBGP>(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
+                                                       p_info);
 
                     if (cfg->debug_bgp)
                        pBGP->enableDebug();
 
+                    // Restored capabilities are replaced by the ones of the OPEN messages
+                    if (p_info->restored) {
+                        p_info->add_path_capability = AddPathDataContainer();
+                        p_info->restored = false;
+                    }
+
                     // Parse the BGP sent/received open messages
                     int read = pBGP->handleUpEvent(pBMP->bmp_data, pBMP->bmp_data_len, &up_event);
-
-                                        // Free the bgp parser
-                    delete pBGP;
+                    savePeer(pBMP->peer->info_key, *p_info);
 
                     // Read info TLV data
                     if (((int)pBMP->bmp_data_len - read) > 0) {
@@ -253,36 +795,41 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
             }
 
             case parseBMP::TYPE_ROUTE_MON : { // Route monitoring type
+                uint64_t read_us = Metrics::enabled ? Metrics::now() : 0;
+
                 pBMP->bufferBMPMessage(read_fd);
 
-                /*
-                 * Read and parse the the BGP message from the client.
-                 *     parseBGP will update mysql directly
-                 */
-                pBGP = new parseBGP(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
-                                    &peer_info_map[peer_info_key]);
-
-                if (cfg->debug_bgp)
-                    pBGP->enableDebug();
-
-                pBGP->handleUpdate(pBMP->bmp_data, pBMP->bmp_data_len);
-   		
-		string str(reinterpret_cast<char*>(client->hash_id), 16);  //storing the client hash in a string 
-		if(client->initRec && cfg->router_baseline_time.find(str) == cfg->router_baseline_time.end())	
-                //check if client has received init message and Baseline time is not already calculated
-		{
-		    peer_info_map_iter it = peer_info_map.begin();
-		    while (it != peer_info_map.end() && it->second.endOfRIB)
-		        ++it;
-
-		    if (it == peer_info_map.end() || checkRIBdumpRate(p_entry.timestamp_secs,mbus_ptr->ribSeq)) {  //End-Of-RIBs are received for all peers.
-		        timeval now;
-		        gettimeofday(&now, NULL);
-		        cfg->router_baseline_time[str] = 1.2 * (now.tv_sec - client->startTime.tv_sec);  //20% buffer for baseline time 
-		    }		
-		}
-                delete pBGP;
+                if (read_us)
+                    Metrics::observe(Metrics::STAGE_READ, Metrics::now() - read_us);
 
+                if (pipeline != NULL) {
+                    /*
+                     * Decode and encode in the pipeline, in order with the other messages of the peer
+                     */
+                    if (p_info->strand == NULL) {
+                        p_info->strand = pipeline->newStrand(parse_group);
+                        parse_strands.push_back(p_info->strand);
+                    }
+
+                    pipeline->submit(p_info->strand, new RouteMonTask(logger, mbus_ptr, p_entry, (char *)r_object.ip_addr,
+                                                                      p_info, pBMP->bmp_data, pBMP->bmp_data_len,
+                                                                      cfg->debug_bgp));
+
+                } else {
+                    /*
+                     * Read and parse the the BGP message from the client.
+                     *     parseBGP will update mysql directly
+                     */
+                    pBGP = msg_arena.create<parseBGP>(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
+                                                       p_info);
+
+                    if (cfg->debug_bgp)
+                        pBGP->enableDebug();
+
+                    pBGP->handleUpdate(pBMP->bmp_data, pBMP->bmp_data_len);
+                }
+
+                ++rib_dump_msgs;
                 break;
             }
 
@@ -297,6 +844,7 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
 
             case parseBMP::TYPE_INIT_MSG : { // Initiation Message
                 client->initRec = true; 		//indicating that init message is received for the router/client.
+                rib_dump.start(monotonicMs(), rib_dump_msgs, mbus_ptr->ribSeq);
 		LOG_INFO("%s: Init message received with length of %u", client->c_ip, pBMP->getBMPLength());
                 pBMP->handleInitMsg(read_fd, r_object);
 		
@@ -305,6 +853,20 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
                 LOG_INFO("Router ID hashed with hash_type: %d", r_object.hash_type);
 		// Update the router entry with the details
                 mbus_ptr->update_Router(r_object, mbus_ptr->ROUTER_ACTION_INIT);
+                batch_router_added = false;
+
+                // Router hash may have changed, so the peer hashes
+                peer_cache.invalidate();
+
+                // Router group is known now, routers without parsed outputs don't need to be parsed
+                uint32_t outputs = mbus_ptr->getRouterOutputs();
+                if (not (outputs & MSGBUS_OUTPUT_ALL & ~MSGBUS_OUTPUT_BMP_RAW) and (outputs & MSGBUS_OUTPUT_BMP_RAW)) {
+                    LOG_INFO("%s: Router has no parsed outputs, forwarding its messages raw", client->c_ip);
+
+                    raw_only = true;
+                    raw_router_added = true;
+                    client->ribDumpDone = true;
+                }
 
 		break;
             }
@@ -328,46 +890,48 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
         // Mark the router as disconnected and update the error to be a local disconnect (no term message received)
         LOG_INFO("%s: Caught: %s", client->c_ip, str);
         disconnect(client, mbus_ptr, parseBMP::TERM_REASON_OPENBMP_CONN_ERR, str);
-
-        delete pBMP;                    // Make sure to free the resource
         throw str;
     }
-    
-    // Send BMP RAW packet data
-    mbus_ptr->send_bmp_raw(router_hash_id, p_entry, pBMP->bmp_packet, pBMP->bmp_packet_len);
-
-    // Free the bmp parser
-    delete pBMP;
 
     return rval;
 }
 
-bool BMPReader::checkRIBdumpRate(uint32_t timeStamp, int ribSeq) {
-    int time, currRate;                                  
+/**
+ * Checks if the initial RIB dump of the router is done
+ *
+ * \details The dump is done when End-of-RIB is received for all peers or the prefix rate
+ *          dropped (see RibDumpDetector).  When done, client->ribDumpDone is set and the dump
+ *          time is saved as the router baseline time.
+ *
+ * \param [in]  client      Client information pointer
+ * \param [in]  mbus_ptr    The database pointer referencer - DB should be already initialized
+ */
+void BMPReader::checkRibDump(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr) {
+    uint64_t now_ms = monotonicMs();
+    bool     all_eor = not peer_info_map.empty();
 
-    if(!hasPrevRIBdumpTime) {
-	prevRIBdumpTime = timeStamp;
-	hasPrevRIBdumpTime = true;
-    }
+    rib_dump.update(now_ms, rib_dump_msgs, mbus_ptr->ribSeq);
+
+    for (peer_info_map_iter it = peer_info_map.begin(); all_eor and it != peer_info_map.end(); ++it)
+        all_eor = it->second.endOfRIB;
+
+    if (not all_eor and not rib_dump.isIdle(now_ms))
+        return;
+
+    client->ribDumpDone = true;
 
-    else {
-	time = timeStamp - prevRIBdumpTime;
-	if(time > 0) { 
-            currRate = ribSeq / time;
-	    maxRIBdumpRate = max(currRate, maxRIBdumpRate);
-	    if(currRate < maxRIBdumpRate * 0.15) {
-		if (!isBelowThresholdDumpRate)
-		    belowThresholdInitTime = timeStamp;
-		isBelowThresholdDumpRate = true;
-		if (timeStamp - belowThresholdInitTime >= 3)
-	    	    return true;
-	    }
-	    else
-		isBelowThresholdDumpRate = false;
-	}
-	prevRIBdumpTime = timeStamp;
+    timeval now;
+    gettimeofday(&now, NULL);
+    int dump_time = now.tv_sec - client->startTime.tv_sec;
+
+    LOG_INFO("%s: Initial RIB dump done after %d seconds (%s), peak rate %.0f msgs/sec %.0f prefixes/sec",
+             client->c_ip, dump_time, all_eor ? "End-of-RIB from all peers" : "prefix rate dropped",
+             rib_dump.peak_msg_rate, rib_dump.peak_prefix_rate);
+
+    if (cfg->calculate_baseline) {
+        string str(reinterpret_cast<char*>(client->hash_id), 16);  //storing the client hash in a string
+        cfg->setRouterBaseline(str, 1.2 * dump_time);               //20% buffer for baseline time
     }
-    return false;
 }
 
 /**
@@ -383,6 +947,15 @@ bool BMPReader::checkRIBdumpRate(uint32_t timeStamp, int ribSeq) {
  */
 void BMPReader::disconnect(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr, int reason_code, char const *reason_text) {
 
+    // Term is sent after the queued messages
+    if (pipeline != NULL) {
+        try {
+            pipeline->drain(parse_group);
+        } catch (char const *str) {
+            // Already logged by the pipeline
+        }
+    }
+
     MsgBusInterface::obj_router r_object;
     bzero(&r_object, sizeof(r_object));
     memcpy(r_object.hash_id, router_hash_id, sizeof(r_object.hash_id));
@@ -416,15 +989,13 @@ void BMPReader::hashRouter(BMPListener::ClientInfo *client,MsgBusInterface::obj_
     string c_hash_str;
     MsgBusInterface::hash_toStr(cfg->c_hash_id, c_hash_str);
 
-    MD5 hash;
+    HashEngine hash;
     hash.update((unsigned char *)hash_val, strlen(hash_val));
     hash.update((unsigned char *)c_hash_str.c_str(), c_hash_str.length());
     hash.finalize();
 
     // Save the hash
-    unsigned char *hash_bin = hash.raw_digest();
-    memcpy(client->hash_id, hash_bin, 16);
-    delete[] hash_bin;
+    hash.digest(client->hash_id);
     memcpy(router_hash_id, client->hash_id, sizeof(router_hash_id));
     memcpy(r_object.hash_id, router_hash_id, sizeof(r_object.hash_id));
     LOG_INFO("Router ID hashed with hash_type: %d", r_object.hash_type);
@@ -12,13 +12,27 @@
 
 #include "BMPListener.h"
 #include "BMPReader.h"
+#include "BMPStreamReader.h"
 #include "AddPathDataContainer.h"
 #include "MsgBusInterface.hpp"
 #include "Logger.h"
 #include "Config.h"
+#include "ParsePipeline.h"
+#include "RibDumpDetector.h"
+#include "PeerCache.h"
+#include "AdmissionController.h"
+#include "Metrics.h"
+#include "MsgArena.h"
 
 #include <map>
 #include <memory>
+#include <vector>
+
+namespace bgp_msg {
+    class PathAttrCache;
+    struct NlriArena;
+    class AdjRibIn;
+}
 
 /**
  * \class   BMPReader
@@ -41,17 +55,32 @@ public:
         AddPathDataContainer add_path_capability;               ///< Stores data about Add Path capability
         string peer_group;                                      ///< Peer group name of defined
 	bool endOfRIB;						///< Indicates if End-Of-RIB marker is received
+        bgp_msg::PathAttrCache *attr_cache;                     ///< Path attribute cache, NULL if disabled
+        bgp_msg::NlriArena *nlri_arena;                         ///< Prefix storage reused per update, NULL until first update
+        bgp_msg::AdjRibIn *adj_rib;                             ///< Adj-RIB-In of the peer, NULL if disabled
+        ParsePipeline::Strand *strand;                          ///< Parse pipeline strand of the peer, NULL if not used
+        uint32_t skip_outputs;                                  ///< MSGBUS_OUTPUT_* bits not produced for the peer, not decoded
+        bool restored;                                          ///< Capabilities are from before a collector restart, until PEER_UP
+
+        /**
+         * Check if all of the outputs are not produced for the peer, their data doesn't need to be decoded
+         */
+        bool skips(uint32_t outputs) const {
+            return outputs != 0 and (skip_outputs & outputs) == outputs;
+        }
     };
 
 
     /**
      * Class constructor
      *
-     *  \param [in] logPtr  Pointer to existing Logger for app logging
-     *  \param [in] config  Pointer to the loaded configuration
+     *  \param [in] logPtr      Pointer to existing Logger for app logging
+     *  \param [in] config      Pointer to the loaded configuration
+     *  \param [in] pipeline    Parse pipeline to decode route monitoring messages, NULL to decode inline
+     *  \param [in] admission   Paces the messages read, NULL if not used
      *
      */
-    BMPReader(Logger *logPtr, Config *config);
+    BMPReader(Logger *logPtr, Config *config, ParsePipeline *pipeline=NULL, AdmissionController *admission=NULL);
 
     virtual ~BMPReader();
 
@@ -67,13 +96,16 @@ public:
     bool ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr);
 
     /**
-     * Checks if End-of-RIB is reached for all peers by checking the rate of RIB dumps
+     * Checks if the initial RIB dump of the router is done
      *
-     * \param [in]  timeStamp   stores the time the message was received  
-	\param [in]  ribSeq	unicast prefix sequence 
-     * \return true if RIB dump rate is below 85% of the initial rate for 3 seconds
+     * \details The dump is done when End-of-RIB is received for all peers or the prefix rate
+     *          dropped (see RibDumpDetector).  When done, client->ribDumpDone is set and the dump
+     *          time is saved as the router baseline time.
+     *
+     * \param [in]  client      Client information pointer
+     * \param [in]  mbus_ptr    The database pointer referencer - DB should be already initialized
      */
-    bool checkRIBdumpRate(uint32_t timeStamp, int ribSeq);
+    void checkRibDump(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr);
 
     /**
      * Read messages from BMP stream in a loop
@@ -111,6 +143,34 @@ public:
 
     void hashRouter(BMPListener::ClientInfo *client, MsgBusInterface::obj_router &r_entry);
 
+    /**
+     * Get the buffered reader for the client stream
+     *
+     * \details The reader is created on first use and persists across messages.
+     *
+     * \param [in]  client      Client information pointer
+     *
+     * \return Pointer to the stream reader
+     */
+    BMPStreamReader *getStream(BMPListener::ClientInfo *client);
+
+    /**
+     * Set if the reader waits for the admission rate, true by default
+     *
+     * \details When false, ReadIncomingMsg() returns without reading the next message while
+     *          the rate is limited, see admissionRetryMs().  Used by the router workers.
+     *
+     * \param [in]  wait        True to wait, false to return
+     */
+    void setAdmissionWait(bool wait);
+
+    /**
+     * Time the last ReadIncomingMsg() stopped at for the admission rate
+     *
+     * \return Time to call it again at (monotonicMs()), 0 if it didn't stop
+     */
+    uint64_t admissionRetryMs();
+
     // Debug methods
     void enableDebug();
     void disableDebug();
@@ -123,18 +183,94 @@ private:
     Config      *cfg;                       ///< Config pointer
     bool        debug;                      ///< debug flag to indicate debugging
     u_char      router_hash_id[16];         ///< Router hash ID
+    BMPStreamReader *stream;                ///< Buffered reader for the client stream, persists across messages
+
+    bool        batch_router_added;         ///< Router FIRST update was already sent in the current batch
+    bool        raw_router_added;           ///< Router FIRST update was sent by the raw passthrough
+    bool        raw_only;                   ///< Router has no parsed outputs, messages after the initiation are forwarded raw
+    PeerCache   peer_cache;                 ///< Peers of the router by binary peer header, with their info and hash ID
+    MsgArena    msg_arena;                  ///< BMP and BGP parsers of the message (or batch), reset after it
+
+    ParsePipeline           *pipeline;                  ///< Parse pipeline, NULL if messages are decoded inline
+    ParsePipeline::Group    *parse_group;               ///< Pipeline group of the router
+    std::vector<ParsePipeline::Strand *> parse_strands; ///< Pipeline strands of the peers
+    AdmissionController     *admission;                 ///< Paces the messages read, NULL if not used
+    bool                    admission_wait;             ///< Waits for the admission rate, see setAdmissionWait()
+    uint64_t                admission_retry_ms;         ///< Retry time of the last read stopped by the rate, 0 if not
 
-    bool 	hasPrevRIBdumpTime;	    ///< True if first RIB dump has been received
-    bool        isBelowThresholdDumpRate;   ///< True if RIB dump rate is below 15% of initial rate 
-    int32_t 	prevRIBdumpTime;            ///< Stores the time the previous message was received
-    int32_t 	maxRIBdumpRate;             ///< Stores the maximum RIB dump rate
-    int32_t     belowThresholdInitTime;     ///< Stores the time when the RIB dump rate has dropped below threshold
+    RibDumpDetector rib_dump;               ///< Rate based detection of the end of the initial RIB dump
+    uint64_t    rib_dump_msgs;              ///< Route monitoring messages received
+    Metrics::Router *metrics;               ///< Metrics of the router, NULL until the first message if enabled
     /**
      * Persistent peer info map, Key is the peer_hash_id.
      */
     std::map<std::string, peer_info> peer_info_map;
     typedef std::map<std::string, peer_info>::iterator peer_info_map_iter;
 
+    /**
+     * Restore the capabilities of a new peer saved before a collector restart, see CollectorState
+     *
+     * \param [in]  key         Key of the peer in peer_info_map
+     * \param [out] info        Peer info of the new peer
+     */
+    void restorePeer(const std::string &key, peer_info &info);
+
+    /**
+     * Save the capabilities of a peer, see CollectorState
+     *
+     * \param [in]  key         Key of the peer in peer_info_map
+     * \param [in]  info        Peer info
+     */
+    void savePeer(const std::string &key, const peer_info &info);
+
+    /**
+     * Parse and process a single BMP message
+     *
+     * \param [in]  client      Client information pointer
+     * \param [in]  mbus_ptr    The database pointer referencer - DB should be already initialized
+     * \param [in]  pBMP        BMP parser, reset for this message
+     * \param [in]  p_entry     Peer entry used by pBMP
+     * \param [in]  read_fd     Socket to read the message from
+     *
+     * \return true if more to read, false if the connection is done/closed
+     *
+     * \throw (char const *str) message indicate error
+     */
+    bool processMessage(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr, parseBMP *pBMP,
+                        MsgBusInterface::obj_bgp_peer &p_entry, int read_fd);
+
+    /**
+     * Forward consecutive BMP messages without parsing them (raw.passthrough)
+     *
+     * \details Messages are framed in the stream buffer by the common header length.  The
+     *          first message is waited for, following ones are added while they are already
+     *          buffered, up to raw.batch_size bytes.
+     *
+     * \param [in]  client      Client information pointer
+     * \param [in]  mbus_ptr    The database pointer referencer - DB should be already initialized
+     *
+     * \return true if more to read, false if the connection is done/closed
+     *
+     * \throw (char const *str) message indicate error
+     */
+    bool forwardRaw(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr);
+
+    /**
+     * Update the router metrics after messages were read
+     *
+     * \param [in]  client      Client information pointer
+     * \param [in]  msgs        Number of messages read
+     * \param [in]  bytes       Number of bytes read
+     */
+    void countMessages(BMPListener::ClientInfo *client, int msgs, size_t bytes);
+
+    /**
+     * Acquire the admission to read the next message
+     *
+     * \return true if it can be read, false if stopped for the rate (admission_retry_ms is set)
+     */
+    bool admitMessage();
+
 };
 
 #endif /* BMPReader_H_ */
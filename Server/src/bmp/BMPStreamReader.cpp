@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2013-2015 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring>
+
+#include "BMPStreamReader.h"
+#include "bgp_common.h"
+
+/**
+ * Constructor for class
+ *
+ * \param [in] sock     Socket to read from, used if ring is NULL
+ * \param [in] ring     Ring to read from instead of the socket, NULL if not used
+ */
+BMPStreamReader::BMPStreamReader(int sock, spscRing *ring) {
+    this->sock = sock;
+    this->ring = ring;
+
+    buf = new u_char[BMP_STREAM_BUF_SIZE];
+    start = 0;
+    end = 0;
+}
+
+BMPStreamReader::~BMPStreamReader() {
+    delete [] buf;
+}
+
+/**
+ * Fill the read ahead buffer until at least need bytes are buffered
+ *
+ * \param [in] need     Number of bytes needed
+ *
+ * \return Number of bytes buffered, or the result of the failed read (zero if closed, < 0 on error)
+ */
+ssize_t BMPStreamReader::fill(size_t need) {
+    ssize_t bytes_read;
+
+    if (need > BMP_STREAM_BUF_SIZE)
+        need = BMP_STREAM_BUF_SIZE;
+
+    if (end - start >= need)
+        return end - start;
+
+    // Move the remaining data to the front if there isn't enough room after it
+    if (start == end) {
+        start = end = 0;
+
+    } else if (start + need > BMP_STREAM_BUF_SIZE) {
+        memmove(buf, buf + start, end - start);
+        end -= start;
+        start = 0;
+    }
+
+    while (end - start < need) {
+        if (ring != NULL)
+            bytes_read = ring->read(buf + end, BMP_STREAM_BUF_SIZE - end, false, false);
+        else
+            bytes_read = recv(sock, buf + end, BMP_STREAM_BUF_SIZE - end, 0);
+
+        if (bytes_read < 0 and errno == EINTR)
+            continue;
+
+        else if (bytes_read <= 0)
+            return bytes_read;
+
+        end += bytes_read;
+    }
+
+    return end - start;
+}
+
+/**
+ * Read from the stream, mimics recv() semantics
+ *
+ * \param [out] data    Buffer to copy the data to
+ * \param [in]  len     Number of bytes to read
+ * \param [in]  flags   recv() flags, only MSG_PEEK and MSG_WAITALL are used
+ *
+ * \return Number of bytes read, zero if closed, < 0 on error
+ */
+ssize_t BMPStreamReader::read(void *data, size_t len, int flags) {
+    u_char *out = (u_char *)data;
+    size_t copied = 0;
+    size_t n;
+    ssize_t rval;
+
+    // Peek is only used for small look ahead reads, which are served from the buffer
+    if (flags & MSG_PEEK) {
+        if (len > BMP_STREAM_BUF_SIZE)
+            len = BMP_STREAM_BUF_SIZE;
+
+        rval = fill((flags & MSG_WAITALL) ? len : 1);
+
+        if (start == end)
+            return rval;
+
+        if (len > end - start)
+            len = end - start;
+
+        memcpy(out, buf + start, len);
+        return len;
+    }
+
+    while (copied < len) {
+        if (start == end) {
+            if (copied > 0 and not (flags & MSG_WAITALL))
+                break;
+
+            if ((rval = fill(1)) <= 0)
+                return copied > 0 ? copied : rval;
+        }
+
+        n = (end - start) < (len - copied) ? (end - start) : (len - copied);
+        memcpy(out + copied, buf + start, n);
+
+        start += n;
+        copied += n;
+    }
+
+    return copied;
+}
+
+/**
+ * Get a pointer to the next len bytes of the stream
+ *
+ * \details Data is buffered as needed, but is not consumed.
+ *
+ * \param [in] len      Number of contiguous bytes needed
+ *
+ * \return Pointer to the data in the read ahead buffer, NULL if len bytes cannot be buffered
+ */
+u_char *BMPStreamReader::frame(size_t len) {
+    if (len > BMP_STREAM_BUF_SIZE)
+        return NULL;
+
+    if (fill(len) < (ssize_t)len)
+        return NULL;
+
+    return buf + start;
+}
+
+/**
+ * Consume (skip) already buffered bytes
+ *
+ * \param [in] len      Number of bytes to consume, must not be more than is buffered
+ */
+void BMPStreamReader::consume(size_t len) {
+    if (len > end - start)
+        len = end - start;
+
+    start += len;
+}
+
+/**
+ * Number of bytes currently buffered
+ */
+size_t BMPStreamReader::buffered() {
+    return end - start;
+}
+
+/**
+ * Check if a complete BMPv3 message is already buffered
+ *
+ * \details Does not read from the socket/ring; used to drain buffered messages in a batch.
+ *
+ * \return True if the next message is BMPv3 and all of it is in the read ahead buffer
+ */
+bool BMPStreamReader::hasFrame() {
+    uint32_t len;
+
+    if (end - start < 1 + sizeof(len) or buf[start] != 3)
+        return false;
+
+    memcpy(&len, buf + start + 1, sizeof(len));
+    bgp::SWAP_BYTES(&len);
+
+    return len >= 1 + sizeof(len) and len <= end - start;
+}
+
+/**
+ * Read what is available from the socket without blocking
+ *
+ * \details Used by the event driven router workers when the socket is readable.
+ *
+ * \return Number of bytes read, zero if closed, < 0 on error (errno is EAGAIN if
+ *         nothing was available or the buffer is full)
+ */
+ssize_t BMPStreamReader::fillAvailable() {
+    ssize_t bytes_read;
+
+    // Move the remaining data to the front to make room
+    if (start == end) {
+        start = end = 0;
+
+    } else if (end == BMP_STREAM_BUF_SIZE and start > 0) {
+        memmove(buf, buf + start, end - start);
+        end -= start;
+        start = 0;
+    }
+
+    if (end == BMP_STREAM_BUF_SIZE) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    do {
+        bytes_read = recv(sock, buf + end, BMP_STREAM_BUF_SIZE - end, MSG_DONTWAIT);
+    } while (bytes_read < 0 and errno == EINTR);
+
+    if (bytes_read > 0)
+        end += bytes_read;
+
+    return bytes_read;
+}
+
+/**
+ * Add data received by the caller to the read ahead buffer
+ *
+ * \param [in] data     Received data
+ * \param [in] len      Length of data in bytes
+ *
+ * \return Number of bytes added, less than len if the buffer is full
+ */
+size_t BMPStreamReader::append(const u_char *data, size_t len) {
+
+    // Move the remaining data to the front to make room
+    if (start == end) {
+        start = end = 0;
+
+    } else if (BMP_STREAM_BUF_SIZE - end < len and start > 0) {
+        memmove(buf, buf + start, end - start);
+        end -= start;
+        start = 0;
+    }
+
+    if (len > BMP_STREAM_BUF_SIZE - end)
+        len = BMP_STREAM_BUF_SIZE - end;
+
+    memcpy(buf + end, data, len);
+    end += len;
+
+    return len;
+}
+
+/**
+ * Check if the next message can be parsed without waiting for more data
+ *
+ * \details True if a complete BMPv3 message is buffered.  Older BMP versions and
+ *          messages larger than the read ahead buffer can't be checked and are
+ *          parsed from the stream, which may block until the rest is received.
+ *
+ * \return True if the next message can be parsed
+ */
+bool BMPStreamReader::canParse() {
+    uint32_t len;
+
+    if (start == end)
+        return false;
+
+    if (buf[start] != 3)
+        return true;
+
+    if (end - start < 1 + sizeof(len))
+        return false;
+
+    memcpy(&len, buf + start + 1, sizeof(len));
+    bgp::SWAP_BYTES(&len);
+
+    return len <= end - start or len > BMP_STREAM_BUF_SIZE;
+}
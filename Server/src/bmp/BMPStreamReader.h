@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2013-2015 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef BMPSTREAMREADER_H_
+#define BMPSTREAMREADER_H_
+
+#include <sys/types.h>
+
+#include "parseBMP.h"
+#include "spscRing.hpp"
+
+#define BMP_STREAM_BUF_SIZE (BMP_PACKET_BUF_SIZE * 4)   ///< Read ahead buffer size, holds at least one max size message
+
+/**
+ * \class   BMPStreamReader
+ *
+ * \brief   Buffered reader for the BMP stream
+ * \details Reads the client stream (socket or ring) in large blocks into a read ahead
+ *          buffer.  parseBMP reads the header fields from memory instead of issuing a
+ *          recv() per field, and complete messages can be accessed in place via frame().
+ *
+ *          Pointers returned by frame() are valid until the next read beyond the
+ *          buffered data, which may compact the buffer.
+ */
+class BMPStreamReader {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] sock     Socket to read from, used if ring is NULL
+     * \param [in] ring     Ring to read from instead of the socket, NULL if not used
+     */
+    BMPStreamReader(int sock, spscRing *ring);
+
+    virtual ~BMPStreamReader();
+
+    /**
+     * Read from the stream, mimics recv() semantics
+     *
+     * \param [out] data    Buffer to copy the data to
+     * \param [in]  len     Number of bytes to read
+     * \param [in]  flags   recv() flags, only MSG_PEEK and MSG_WAITALL are used
+     *
+     * \return Number of bytes read, zero if closed, < 0 on error
+     */
+    ssize_t read(void *data, size_t len, int flags);
+
+    /**
+     * Get a pointer to the next len bytes of the stream
+     *
+     * \details Data is buffered as needed, but is not consumed.
+     *
+     * \param [in] len      Number of contiguous bytes needed
+     *
+     * \return Pointer to the data in the read ahead buffer, NULL if len bytes cannot be buffered
+     */
+    u_char *frame(size_t len);
+
+    /**
+     * Consume (skip) already buffered bytes
+     *
+     * \param [in] len      Number of bytes to consume, must not be more than is buffered
+     */
+    void consume(size_t len);
+
+    /**
+     * Number of bytes currently buffered
+     */
+    size_t buffered();
+
+    /**
+     * Check if a complete BMPv3 message is already buffered
+     *
+     * \details Does not read from the socket/ring; used to drain buffered messages in a batch.
+     *
+     * \return True if the next message is BMPv3 and all of it is in the read ahead buffer
+     */
+    bool hasFrame();
+
+    /**
+     * Read what is available from the socket without blocking
+     *
+     * \details Used by the event driven router workers when the socket is readable.
+     *
+     * \return Number of bytes read, zero if closed, < 0 on error (errno is EAGAIN if
+     *         nothing was available or the buffer is full)
+     */
+    ssize_t fillAvailable();
+
+    /**
+     * Add data received by the caller to the read ahead buffer
+     *
+     * \details Used by the io_uring router workers, which receive the socket into their
+     *          own buffers.  The socket must not also be read by the stream.
+     *
+     * \param [in] data     Received data
+     * \param [in] len      Length of data in bytes
+     *
+     * \return Number of bytes added, less than len if the buffer is full
+     */
+    size_t append(const u_char *data, size_t len);
+
+    /**
+     * Check if the next message can be parsed without waiting for more data
+     *
+     * \details True if a complete BMPv3 message is buffered.  Older BMP versions and
+     *          messages larger than the read ahead buffer can't be checked and are
+     *          parsed from the stream, which may block until the rest is received.
+     *
+     * \return True if the next message can be parsed
+     */
+    bool canParse();
+
+private:
+    int             sock;                   ///< Client socket
+    spscRing        *ring;                  ///< Client ring, NULL if reading from the socket
+
+    u_char          *buf;                   ///< Read ahead buffer
+    size_t          start;                  ///< Offset of the next byte to be read
+    size_t          end;                    ///< Offset after the last buffered byte
+
+    /**
+     * Fill the read ahead buffer until at least need bytes are buffered
+     *
+     * \param [in] need     Number of bytes needed
+     *
+     * \return Number of bytes buffered, or the result of the failed read (zero if closed, < 0 on error)
+     */
+    ssize_t fill(size_t need);
+};
+
+#endif /* BMPSTREAMREADER_H_ */
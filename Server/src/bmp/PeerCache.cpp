@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <cstring>
+
+#include "PeerCache.h"
+
+/**
+ * Constructor for class
+ */
+PeerCache::PeerCache() {
+    slots.resize(PEER_CACHE_MIN_SIZE);
+    count = 0;
+    gen = 1;
+
+    for (size_t i = 0; i < slots.size(); i++)
+        slots[i].used = false;
+}
+
+/**
+ * Build the key of a peer header
+ *
+ * \param [in]  isIPv4      True if the peer address is IPv4
+ * \param [in]  rd          8 byte peer RD
+ * \param [in]  addr        16 byte peer address
+ * \param [in]  as          4 byte peer ASN
+ * \param [in]  bgp_id      4 byte peer BGP ID
+ * \param [out] key         PEER_CACHE_KEY_LEN bytes key
+ */
+void PeerCache::makeKey(bool isIPv4, const u_char *rd, const u_char *addr, const u_char *as,
+                        const u_char *bgp_id, u_char *key) {
+    key[0] = isIPv4 ? 1 : 0;
+    memcpy(key + 1, rd, 8);
+    memcpy(key + 9, addr, 16);
+    memcpy(key + 25, as, 4);
+    memcpy(key + 29, bgp_id, 4);
+}
+
+/**
+ * Lookup a peer
+ *
+ * \param [in] key      Key from makeKey()
+ *
+ * \return Pointer to the entry, NULL if not found.  Valid until the next add()
+ */
+PeerCacheEntry *PeerCache::find(const u_char *key) {
+    size_t mask = slots.size() - 1;
+
+    for (size_t i = hashKey(key) & mask; slots[i].used; i = (i + 1) & mask) {
+        if (memcmp(slots[i].key, key, PEER_CACHE_KEY_LEN) == 0)
+            return &slots[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * Add a peer, the caller fills the printed fields
+ *
+ * \param [in] key      Key from makeKey(), must not be in the cache
+ *
+ * \return Pointer to the new entry.  Valid until the next add()
+ */
+PeerCacheEntry *PeerCache::add(const u_char *key) {
+    // Keep the load at or below half so probes stay short
+    if ((count + 1) * 2 > slots.size())
+        grow();
+
+    size_t mask = slots.size() - 1;
+    size_t i = hashKey(key) & mask;
+
+    while (slots[i].used)
+        i = (i + 1) & mask;
+
+    PeerCacheEntry &entry = slots[i];
+    memcpy(entry.key, key, PEER_CACHE_KEY_LEN);
+    entry.used = true;
+    entry.peer_addr[0] = 0;
+    entry.peer_rd[0] = 0;
+    entry.peer_bgp_id[0] = 0;
+    entry.peer_as = 0;
+    entry.info_key.clear();
+    entry.info = NULL;
+    entry.hash_gen = 0;
+
+    ++count;
+
+    return &entry;
+}
+
+/**
+ * Invalidate the hash IDs of all entries
+ */
+void PeerCache::invalidate() {
+    if (++gen == 0)
+        gen = 1;
+}
+
+/**
+ * Current hash ID generation, an entry hash_id is valid if hash_gen matches
+ */
+uint32_t PeerCache::generation() const {
+    return gen;
+}
+
+/**
+ * Number of cached peers
+ */
+size_t PeerCache::size() const {
+    return count;
+}
+
+/**
+ * Hash of a key (FNV-1a)
+ */
+uint32_t PeerCache::hashKey(const u_char *key) {
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < PEER_CACHE_KEY_LEN; i++) {
+        hash ^= key[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Double the number of slots and reinsert the entries
+ */
+void PeerCache::grow() {
+    std::vector<PeerCacheEntry> old;
+    old.swap(slots);
+
+    slots.resize(old.size() * 2);
+    for (size_t i = 0; i < slots.size(); i++)
+        slots[i].used = false;
+
+    size_t mask = slots.size() - 1;
+
+    for (size_t n = 0; n < old.size(); n++) {
+        if (not old[n].used)
+            continue;
+
+        size_t i = hashKey(old[n].key) & mask;
+        while (slots[i].used)
+            i = (i + 1) & mask;
+
+        slots[i] = old[n];
+    }
+}
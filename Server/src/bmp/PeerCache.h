@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PEERCACHE_H_
+#define PEERCACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#define PEER_CACHE_KEY_LEN      33          ///< IPv4 flag, RD, address, ASN and BGP ID of the peer header
+#define PEER_CACHE_MIN_SIZE     16          ///< Initial number of slots, power of 2
+
+/**
+ * Cached peer of a router
+ */
+struct PeerCacheEntry {
+    u_char          key[PEER_CACHE_KEY_LEN];    ///< Binary peer header fields the entry is for
+    bool            used;                       ///< True if the slot is in use
+
+    char            peer_addr[46];              ///< Printed form of the peer address
+    char            peer_rd[32];                ///< Printed form of the peer RD
+    char            peer_bgp_id[16];            ///< Printed form of the peer BGP ID
+    uint32_t        peer_as;                    ///< Peer ASN
+
+    std::string     info_key;                   ///< Key of the peer in the reader peer info map
+    void            *info;                      ///< BMPReader::peer_info of the peer, NULL until set by the reader
+
+    u_char          hash_id[16];                ///< Peer hash ID published by the message bus
+    uint32_t        hash_gen;                   ///< Generation hash_id is valid for, 0 if not valid
+};
+
+/**
+ * \class   PeerCache
+ *
+ * \brief   Per router cache of the peers, keyed by the binary BMP peer header fields
+ * \details Open addressing with linear probing.  The printed strings of a peer are formatted
+ *          once, when the peer is first seen; following messages of the peer only hash and
+ *          compare the header bytes.  The reader also keeps the peer info and the published
+ *          peer hash ID in the entry.
+ *
+ *          Entries are never removed; a router has a bounded set of peers.  The hash IDs are
+ *          invalidated with invalidate() when the peer or router state changes.
+ */
+class PeerCache {
+public:
+    PeerCache();
+
+    /**
+     * Build the key of a peer header
+     *
+     * \param [in]  isIPv4      True if the peer address is IPv4
+     * \param [in]  rd          8 byte peer RD
+     * \param [in]  addr        16 byte peer address
+     * \param [in]  as          4 byte peer ASN
+     * \param [in]  bgp_id      4 byte peer BGP ID
+     * \param [out] key         PEER_CACHE_KEY_LEN bytes key
+     */
+    static void makeKey(bool isIPv4, const u_char *rd, const u_char *addr, const u_char *as,
+                        const u_char *bgp_id, u_char *key);
+
+    /**
+     * Lookup a peer
+     *
+     * \param [in] key      Key from makeKey()
+     *
+     * \return Pointer to the entry, NULL if not found.  Valid until the next add()
+     */
+    PeerCacheEntry *find(const u_char *key);
+
+    /**
+     * Add a peer, the caller fills the printed fields
+     *
+     * \param [in] key      Key from makeKey(), must not be in the cache
+     *
+     * \return Pointer to the new entry.  Valid until the next add()
+     */
+    PeerCacheEntry *add(const u_char *key);
+
+    /**
+     * Invalidate the hash IDs of all entries
+     */
+    void invalidate();
+
+    /**
+     * Current hash ID generation, an entry hash_id is valid if hash_gen matches
+     */
+    uint32_t generation() const;
+
+    /**
+     * Number of cached peers
+     */
+    size_t size() const;
+
+private:
+    std::vector<PeerCacheEntry> slots;          ///< Slots, size is a power of 2
+    size_t                      count;          ///< Number of used slots
+    uint32_t                    gen;            ///< Hash ID generation, never 0
+
+    /**
+     * Hash of a key
+     */
+    static uint32_t hashKey(const u_char *key);
+
+    /**
+     * Double the number of slots and reinsert the entries
+     */
+    void grow();
+};
+
+#endif /* PEERCACHE_H_ */
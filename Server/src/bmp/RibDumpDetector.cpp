@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <cmath>
+
+#include "RibDumpDetector.h"
+
+/**
+ * Constructor for class
+ */
+RibDumpDetector::RibDumpDetector() {
+    start(0, 0, 0);
+
+    // Started by the first update() if start() isn't called
+    started = false;
+}
+
+/**
+ * Start (or restart) the detection
+ *
+ * \param [in] now_ms       Current monotonic time in milliseconds
+ * \param [in] messages     Current message count
+ * \param [in] prefixes     Current prefix count
+ */
+void RibDumpDetector::start(uint64_t now_ms, uint64_t messages, uint64_t prefixes) {
+    started = true;
+    start_ms = now_ms;
+    sample_ms = now_ms;
+    sample_messages = messages;
+    sample_prefixes = prefixes;
+    idle_since_ms = 0;
+
+    msg_rate = 0;
+    prefix_rate = 0;
+    peak_msg_rate = 0;
+    peak_prefix_rate = 0;
+}
+
+/**
+ * Update the rates with the current counts
+ *
+ * \param [in] now_ms       Current monotonic time in milliseconds
+ * \param [in] messages     Current message count
+ * \param [in] prefixes     Current prefix count
+ */
+void RibDumpDetector::update(uint64_t now_ms, uint64_t messages, uint64_t prefixes) {
+    double secs, alpha;
+
+    if (not started) {
+        start(now_ms, messages, prefixes);
+        return;
+    }
+
+    if (now_ms < sample_ms + RIB_DUMP_SAMPLE_MS)
+        return;
+
+    secs = (now_ms - sample_ms) / 1000.0;
+
+    // Weight for an irregular interval, same as sampling every interval of the gap
+    alpha = 1.0 - exp(-secs / RIB_DUMP_EWMA_SECS);
+
+    msg_rate += alpha * ((messages - sample_messages) / secs - msg_rate);
+    prefix_rate += alpha * ((prefixes - sample_prefixes) / secs - prefix_rate);
+
+    if (msg_rate > peak_msg_rate)
+        peak_msg_rate = msg_rate;
+
+    if (prefix_rate > peak_prefix_rate)
+        peak_prefix_rate = prefix_rate;
+
+    sample_ms = now_ms;
+    sample_messages = messages;
+    sample_prefixes = prefixes;
+
+    if (peak_prefix_rate >= RIB_DUMP_MIN_PEAK and prefix_rate < peak_prefix_rate * RIB_DUMP_IDLE_RATIO) {
+        if (idle_since_ms == 0)
+            idle_since_ms = now_ms;
+    } else
+        idle_since_ms = 0;
+}
+
+/**
+ * Check if the dump is done based on the rate
+ *
+ * \param [in] now_ms       Current monotonic time in milliseconds
+ *
+ * \return true if the prefix rate has been idle long enough
+ */
+bool RibDumpDetector::isIdle(uint64_t now_ms) const {
+    return idle_since_ms != 0 and now_ms - idle_since_ms >= RIB_DUMP_IDLE_MS;
+}
+
+/**
+ * Milliseconds since start()
+ *
+ * \param [in] now_ms       Current monotonic time in milliseconds
+ */
+uint64_t RibDumpDetector::elapsed(uint64_t now_ms) const {
+    return now_ms - start_ms;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef RIBDUMPDETECTOR_H_
+#define RIBDUMPDETECTOR_H_
+
+#include <cstdint>
+
+#define RIB_DUMP_SAMPLE_MS          250         ///< Min time between rate samples
+#define RIB_DUMP_EWMA_SECS          2.0         ///< Time constant of the rate averages
+#define RIB_DUMP_IDLE_RATIO         0.15        ///< Dump is idle when the prefix rate is below this ratio of the peak
+#define RIB_DUMP_IDLE_MS            3000        ///< Time the dump has to be idle to be considered done
+#define RIB_DUMP_MIN_PEAK           10.0        ///< Min peak prefixes per second before the idle check is used
+
+/**
+ * \class   RibDumpDetector
+ *
+ * \brief   Detects the end of the initial RIB dump of a router by its message and prefix rates
+ * \details The caller periodically passes the running message and prefix counts of the router.
+ *          Rates are sampled at most every RIB_DUMP_SAMPLE_MS and averaged with an exponentially
+ *          weighted moving average.  The weight of a sample depends on the time it covers, so
+ *          a gap without messages decays the averages as if each interval had been sampled.
+ *
+ *          The dump is done when the prefix rate average stayed below RIB_DUMP_IDLE_RATIO of its
+ *          peak for RIB_DUMP_IDLE_MS.  End-of-RIB markers are checked by the caller; this is the
+ *          fallback for peers that don't send them.
+ */
+class RibDumpDetector {
+public:
+    RibDumpDetector();
+
+    /**
+     * Start (or restart) the detection
+     *
+     * \param [in] now_ms       Current monotonic time in milliseconds
+     * \param [in] messages     Current message count
+     * \param [in] prefixes     Current prefix count
+     */
+    void start(uint64_t now_ms, uint64_t messages, uint64_t prefixes);
+
+    /**
+     * Update the rates with the current counts
+     *
+     * \param [in] now_ms       Current monotonic time in milliseconds
+     * \param [in] messages     Current message count
+     * \param [in] prefixes     Current prefix count
+     */
+    void update(uint64_t now_ms, uint64_t messages, uint64_t prefixes);
+
+    /**
+     * Check if the dump is done based on the rate
+     *
+     * \param [in] now_ms       Current monotonic time in milliseconds
+     *
+     * \return true if the prefix rate has been idle long enough
+     */
+    bool isIdle(uint64_t now_ms) const;
+
+    /**
+     * Milliseconds since start()
+     *
+     * \param [in] now_ms       Current monotonic time in milliseconds
+     */
+    uint64_t elapsed(uint64_t now_ms) const;
+
+    double      msg_rate;                   ///< Average messages per second
+    double      prefix_rate;                ///< Average prefixes per second
+    double      peak_msg_rate;              ///< Peak of msg_rate
+    double      peak_prefix_rate;           ///< Peak of prefix_rate
+
+private:
+    bool        started;                    ///< Indicates start() was called
+    uint64_t    start_ms;                   ///< Time of start()
+    uint64_t    sample_ms;                  ///< Time of the last sample
+    uint64_t    sample_messages;            ///< Message count of the last sample
+    uint64_t    sample_prefixes;            ///< Prefix count of the last sample
+    uint64_t    idle_since_ms;              ///< Time the prefix rate dropped below the idle ratio, 0 if not idle
+};
+
+#endif /* RIBDUMPDETECTOR_H_ */
@@ -8,6 +8,7 @@
  */
 
 #include "parseBMP.h"
+#include "BMPStreamReader.h"
 #include "MsgBusInterface.hpp"
 
 #include <cstdio>
@@ -37,12 +38,19 @@ parseBMP::parseBMP(Logger *logPtr, MsgBusInterface::obj_bgp_peer *peer_entry) {
     bmp_type = -1; // Initially set to error
     bmp_len = 0;
     logger = logPtr;
+    stream = NULL;
+    peer_cache = NULL;
+    peer = NULL;
+    framed = false;
+    frame_remaining = 0;
 
+    bmp_data = data_buf;
     bmp_data_len = 0;
-    bzero(bmp_data, sizeof(bmp_data));
+    bzero(data_buf, sizeof(data_buf));
 
+    bmp_packet = packet_buf;
     bmp_packet_len = 0;
-    bzero(bmp_packet, sizeof(bmp_packet));
+    bzero(packet_buf, sizeof(packet_buf));
 
     // Set the passed storage for the router entry items.
     p_entry = peer_entry;
@@ -50,14 +58,72 @@ parseBMP::parseBMP(Logger *logPtr, MsgBusInterface::obj_bgp_peer *peer_entry) {
 }
 
 parseBMP::~parseBMP() {
-    // clean up
+    // Skip anything left of a framed message so the stream stays aligned to the next message
+    if (framed and frame_remaining > 0)
+        stream->consume(frame_remaining);
+}
+
+/**
+ * Reset the parser for the next message
+ *
+ * \details Allows the same parser instance to be reused for multiple messages
+ *          (batch mode) without reallocating or clearing the packet buffers.
+ *          The peer entry is cleared.
+ */
+void parseBMP::reset() {
+    // Skip anything left of a framed message so the stream stays aligned to the next message
+    if (framed and frame_remaining > 0)
+        stream->consume(frame_remaining);
+
+    framed = false;
+    frame_remaining = 0;
+
+    bmp_type = -1;
+    bmp_len = 0;
+
+    bmp_data = data_buf;
+    bmp_data_len = 0;
+
+    bmp_packet = packet_buf;
+    bmp_packet_len = 0;
+
+    peer = NULL;
+
+    bzero(p_entry, sizeof(MsgBusInterface::obj_bgp_peer));
+}
+
+/**
+ * Set the peer cache of the router
+ *
+ * \param [in] cache       Pointer to the router peer cache, NULL to format every header
+ */
+void parseBMP::setPeerCache(PeerCache *cache) {
+    peer_cache = cache;
 }
 
 /**
  * Recv wrapper for recv() to enable packet buffering
  */
 ssize_t parseBMP::Recv(int sockfd, void *buf, size_t len, int flags) {
-    ssize_t read = recv(sockfd, buf, len, flags);
+    ssize_t read;
+
+    if (framed) {
+        // Message is already in the stream buffer (and bmp_packet), don't read past the end of it
+        if (len > frame_remaining)
+            len = frame_remaining;
+
+        read = stream->read(buf, len, flags);
+
+        if (read > 0 and not (flags & MSG_PEEK))
+            frame_remaining -= read;
+
+        return read;
+    }
+
+    if (stream != NULL)
+        read = stream->read(buf, len, flags);
+    else
+        read = recv(sockfd, buf, len, flags);
 
     if (read > 0)
         if ((bmp_packet_len + read) < BMP_PACKET_BUF_SIZE) {
@@ -68,6 +134,46 @@ ssize_t parseBMP::Recv(int sockfd, void *buf, size_t len, int flags) {
     return read;
 }
 
+/**
+ * Frame the next BMPv3 message in the stream buffer
+ *
+ * \details If the complete message can be buffered, bmp_packet is set to point to it
+ *          and following reads are served from memory.  Otherwise the message is read
+ *          as before.
+ */
+void parseBMP::frameMessage() {
+    u_char *hdr;
+    uint32_t len;
+
+    // Need the version and message length to frame
+    if ((hdr = stream->frame(1 + sizeof(len))) == NULL or hdr[0] != 3)
+        return;
+
+    memcpy(&len, hdr + 1, sizeof(len));
+    bgp::SWAP_BYTES(&len);
+
+    if (len < 1 + BMP_HDRv3_LEN or len > BMP_PACKET_BUF_SIZE)
+        return;                                 // Invalid or too large, parse is left to handle it
+
+    if ((hdr = stream->frame(len)) == NULL)
+        return;
+
+    bmp_packet = hdr;
+    bmp_packet_len = len;
+
+    frame_remaining = len;
+    framed = true;
+}
+
+/**
+ * Set the buffered stream reader to read the BMP stream from
+ *
+ * \param [in] streamPtr   Pointer to the client stream reader, NULL to read from the socket
+ */
+void parseBMP::setStream(BMPStreamReader *streamPtr) {
+    stream = streamPtr;
+}
+
 /**
  * Process the incoming BMP message
  *
@@ -83,6 +189,10 @@ char parseBMP::handleMessage(int sock) {
     unsigned char ver;
     ssize_t bytes_read;
 
+    // Read the complete message in one shot when possible
+    if (stream != NULL)
+        frameMessage();
+
     // Get the version in order to determine what we read next
     //    As of Junos 10.4R6.5, it supports version 1
     bytes_read = Recv(sock, &ver, 1, MSG_WAITALL);
@@ -254,6 +364,16 @@ void parseBMP::parseBMPv2(int sock) {
     strncpy(p_entry->peer_bgp_id, peer_bgp_id, sizeof(peer_bgp_id));
     strncpy(p_entry->peer_rd, peer_rd, sizeof(peer_rd));
 
+    // Strings are always formatted for the old versions, the cache only keeps the peer state
+    if (peer_cache != NULL) {
+        u_char key[PEER_CACHE_KEY_LEN];
+        PeerCache::makeKey(p_entry->isIPv4, c_hdr.peer_dist_id, c_hdr.peer_addr, c_hdr.peer_as,
+                           c_hdr.peer_bgp_id, key);
+
+        if ((peer = peer_cache->find(key)) == NULL)
+            addPeer(key);
+    }
+
     // Save the advertised timestamp
     uint32_t ts = c_hdr.ts_secs;
     bgp::SWAP_BYTES(&ts);
@@ -431,6 +551,74 @@ void parseBMP::parsePeerHdr(int sock) {
 
     parsePeerFlags(p_hdr.peer_type, p_hdr.peer_flags);
 
+    peer = NULL;
+
+    if (peer_cache != NULL) {
+        u_char key[PEER_CACHE_KEY_LEN];
+        PeerCache::makeKey(p_entry->isIPv4, p_hdr.peer_dist_id, p_hdr.peer_addr, p_hdr.peer_as,
+                           p_hdr.peer_bgp_id, key);
+
+        if ((peer = peer_cache->find(key)) == NULL) {
+            formatPeerHdr(sock, p_hdr);
+            addPeer(key);
+
+        } else {
+            memcpy(p_entry->peer_addr, peer->peer_addr, sizeof(p_entry->peer_addr));
+            memcpy(p_entry->peer_rd, peer->peer_rd, sizeof(p_entry->peer_rd));
+            memcpy(p_entry->peer_bgp_id, peer->peer_bgp_id, sizeof(p_entry->peer_bgp_id));
+            p_entry->peer_as = peer->peer_as;
+        }
+
+    } else
+        formatPeerHdr(sock, p_hdr);
+
+    // Save the advertised timestamp
+    bgp::SWAP_BYTES(&p_hdr.ts_secs);
+    bgp::SWAP_BYTES(&p_hdr.ts_usecs);
+
+    if (p_hdr.ts_secs != 0) {
+        p_entry->timestamp_secs = p_hdr.ts_secs;
+        p_entry->timestamp_us = p_hdr.ts_usecs;
+
+    } else {
+        timeval tv;
+
+        gettimeofday(&tv, NULL);
+        p_entry->timestamp_secs = tv.tv_sec;
+        p_entry->timestamp_us = tv.tv_usec;
+    }
+
+
+    SELF_DEBUG("sock=%d : Peer Address = %s", sock, p_entry->peer_addr);
+    SELF_DEBUG("sock=%d : Peer AS = (%x-%x)%x:%x", sock,
+                p_hdr.peer_as[0], p_hdr.peer_as[1], p_hdr.peer_as[2],
+                p_hdr.peer_as[3]);
+    SELF_DEBUG("sock=%d : Peer RD = %s", sock, p_entry->peer_rd);
+}
+
+/**
+ * Add the peer entry to the peer cache, peer is set to the new entry
+ *
+ * \param [in]  key         Key of the peer from PeerCache::makeKey()
+ */
+void parseBMP::addPeer(const u_char *key) {
+    peer = peer_cache->add(key);
+    memcpy(peer->peer_addr, p_entry->peer_addr, sizeof(peer->peer_addr));
+    memcpy(peer->peer_rd, p_entry->peer_rd, sizeof(peer->peer_rd));
+    memcpy(peer->peer_bgp_id, p_entry->peer_bgp_id, sizeof(peer->peer_bgp_id));
+    peer->peer_as = p_entry->peer_as;
+
+    peer->info_key = p_entry->peer_addr;
+    peer->info_key += p_entry->peer_rd;
+}
+
+/**
+ * Format the peer header address, ASN, BGP ID and RD into the peer entry
+ *
+ * \param [in]  sock        Socket the message is read from, used for logging
+ * \param [in]  p_hdr       Peer header
+ */
+void parseBMP::formatPeerHdr(int sock, peer_hdr_v3 &p_hdr) {
     if (p_entry->isIPv4) {
         snprintf(peer_addr, sizeof(peer_addr), "%d.%d.%d.%d",
                  p_hdr.peer_addr[12], p_hdr.peer_addr[13], p_hdr.peer_addr[14],
@@ -487,29 +675,6 @@ void parseBMP::parsePeerHdr(int sock) {
     p_entry->peer_as = strtoll(peer_as, NULL, 16);
     strncpy(p_entry->peer_bgp_id, peer_bgp_id, sizeof(p_entry->peer_bgp_id));
     strncpy(p_entry->peer_rd, peer_rd, sizeof(p_entry->peer_rd));
-
-    // Save the advertised timestamp
-    bgp::SWAP_BYTES(&p_hdr.ts_secs);
-    bgp::SWAP_BYTES(&p_hdr.ts_usecs);
-
-    if (p_hdr.ts_secs != 0) {
-        p_entry->timestamp_secs = p_hdr.ts_secs;
-        p_entry->timestamp_us = p_hdr.ts_usecs;
-
-    } else {
-        timeval tv;
-
-        gettimeofday(&tv, NULL);
-        p_entry->timestamp_secs = tv.tv_sec;
-        p_entry->timestamp_us = tv.tv_usec;
-    }
-
-
-    SELF_DEBUG("sock=%d : Peer Address = %s", sock, peer_addr);
-    SELF_DEBUG("sock=%d : Peer AS = (%x-%x)%x:%x", sock,
-                p_hdr.peer_as[0], p_hdr.peer_as[1], p_hdr.peer_as[2],
-                p_hdr.peer_as[3]);
-    SELF_DEBUG("sock=%d : Peer RD = %s", sock, peer_rd);
 }
 
 /**
@@ -558,12 +723,29 @@ void parseBMP::bufferBMPMessage(int sock) {
     if (bmp_len <= 0)
         return;
 
-    if (bmp_len > sizeof(bmp_data)) {
+    if (bmp_len > sizeof(data_buf)) {
         LOG_WARN("sock=%d: BMP message is invalid, length of %d is larger than max buffer size of %d",
-                sock, bmp_len, sizeof(bmp_data));
+                sock, bmp_len, sizeof(data_buf));
         throw "BMP message length is too large for buffer, invalid BMP sender";
     }
 
+    // Framed message is already in memory, point to it instead of copying
+    if (framed) {
+        if (bmp_len > frame_remaining) {
+            LOG_ERR("sock=%d: Couldn't read all %d bytes into buffer", sock, bmp_len);
+            throw "Error while reading BMP data into buffer";
+        }
+
+        bmp_data = stream->frame(bmp_len);
+        bmp_data_len = bmp_len;
+
+        stream->consume(bmp_len);
+        frame_remaining -= bmp_len;
+
+        bmp_len = 0;
+        return;
+    }
+
     SELF_DEBUG("sock=%d: Buffering %d from socket", sock, bmp_len);
     if ((bmp_data_len=Recv(sock, bmp_data, bmp_len, MSG_WAITALL)) != bmp_len) {
          LOG_ERR("sock=%d: Couldn't read all %d bytes into buffer",
@@ -13,6 +13,9 @@
 
 #include "MsgBusInterface.hpp"
 #include "Logger.h"
+#include "PeerCache.h"
+
+class BMPStreamReader;
 
 
 /*
@@ -151,7 +154,7 @@ public:
      *      BMP data message is read into this buffer so that it can be passed to the BGP parser for handling.
      *      Complete BGP message is read, otherwise error is generated.
      */
-    u_char      bmp_data[BMP_PACKET_BUF_SIZE + 1];
+    u_char      *bmp_data;                 ///< Points to data_buf, or directly into the stream buffer when framed
     size_t      bmp_data_len;              ///< Length/size of data in the data buffer
 
     /**
@@ -162,9 +165,11 @@ public:
      *
      * Length of packet is the common header message length (bytes)
      */
-    u_char      bmp_packet[BMP_PACKET_BUF_SIZE + 1];
+    u_char      *bmp_packet;               ///< Points to packet_buf, or directly into the stream buffer when framed
     size_t      bmp_packet_len;
 
+    PeerCacheEntry *peer;                  ///< Cached peer of the message peer header, NULL if no peer cache or header
+
     /**
      * Constructor for class
      *
@@ -182,11 +187,43 @@ public:
     // destructor
     virtual ~parseBMP();
 
+    /**
+     * Reset the parser for the next message
+     *
+     * \details Allows the same parser instance to be reused for multiple messages
+     *          (batch mode) without reallocating or clearing the packet buffers.
+     *          The peer entry is cleared.
+     */
+    void reset();
+
     /**
      * Recv wrapper for recv() to enable packet buffering
+     *
+     * \details When a stream reader is set, data is read from the stream buffer instead of the socket.
      */
     ssize_t Recv(int sockfd, void *buf, size_t len, int flags);
 
+    /**
+     * Set the buffered stream reader to read the BMP stream from
+     *
+     * \details With a stream reader, complete BMPv3 messages are framed in memory using the
+     *          common header length.  The header fields are then read from memory and
+     *          bmp_packet/bmp_data point directly into the stream buffer.
+     *
+     * \param [in] streamPtr   Pointer to the client stream reader, NULL to read from the socket
+     */
+    void setStream(BMPStreamReader *streamPtr);
+
+    /**
+     * Set the peer cache of the router
+     *
+     * \details With a peer cache, the peer header strings are only formatted the first time a
+     *          peer is seen and peer is set to the cached peer of the message.
+     *
+     * \param [in] cache       Pointer to the router peer cache, NULL to format every header
+     */
+    void setPeerCache(PeerCache *cache);
+
     /**
      * Process the incoming BMP message
      *
@@ -292,6 +329,13 @@ private:
     Logger          *logger;                    ///< Logging class pointer
 
     MsgBusInterface::obj_bgp_peer *p_entry;         ///< peer table entry - will be updated with BMP info
+    BMPStreamReader *stream;                    ///< Stream reader to read from instead of the socket, NULL if not used
+    PeerCache       *peer_cache;                ///< Peer cache of the router, NULL if not used
+    bool            framed;                     ///< True if the current message is framed in the stream buffer
+    size_t          frame_remaining;            ///< Bytes of the framed message not yet read
+
+    u_char          data_buf[BMP_PACKET_BUF_SIZE + 1];      ///< Storage for bmp_data when not framed
+    u_char          packet_buf[BMP_PACKET_BUF_SIZE + 1];    ///< Storage for bmp_packet when not framed
     char            bmp_type;                   ///< The BMP message type
     uint32_t        bmp_len;                    ///< Length of the BMP message - does not include the common header size
 
@@ -301,6 +345,30 @@ private:
     char peer_rd[32];                           ///< Printed format of the peer RD
     char peer_bgp_id[16];                       ///< Printed format of the peer bgp ID
 
+    /**
+     * Frame the next BMPv3 message in the stream buffer
+     *
+     * \details If the complete message can be buffered, bmp_packet is set to point to it
+     *          and following reads are served from memory.  Otherwise the message is read
+     *          as before.
+     */
+    void frameMessage();
+
+    /**
+     * Format the peer header address, ASN, BGP ID and RD into the peer entry
+     *
+     * \param [in]  sock        Socket the message is read from, used for logging
+     * \param [in]  p_hdr       Peer header
+     */
+    void formatPeerHdr(int sock, peer_hdr_v3 &p_hdr);
+
+    /**
+     * Add the peer entry to the peer cache, peer is set to the new entry
+     *
+     * \param [in]  key         Key of the peer from PeerCache::makeKey()
+     */
+    void addPeer(const u_char *key);
+
     /**
      * Parse v1 and v2 BMP header
      *
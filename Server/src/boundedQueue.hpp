@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#ifndef BOUNDEDQUEUE_HPP_
+#define BOUNDEDQUEUE_HPP_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#define BOUNDED_QUEUE_SPIN      100             ///< Number of retries before a blocking call waits
+
+/**
+ * \class   boundedQueue
+ *
+ * \brief   Lock-free bounded queue, multi or single producer and single consumer
+ * \details Used to hand off entries between threads.  push/pop do not take a lock, each
+ *          slot has a sequence number that indicates if it's free or filled (see
+ *          http://www.1024cores.net bounded MPMC queue).  With multi_producer false no
+ *          atomic read-modify-write is used.
+ *
+ *          The blocking methods spin briefly and then wait on a condition variable.  The
+ *          other side only takes the wait lock when a waiter is flagged, so the lock is
+ *          not used while entries are flowing.
+ *
+ *          There can only be one consumer at a time.  The consumer can change between
+ *          threads as long as the hand off is synchronized (e.g. by a mutex).
+ *
+ * \tparam type             Entry type, copied/moved in and out of the slots
+ * \tparam multi_producer   True if push can be called concurrently by more than one thread
+ */
+template <typename type, bool multi_producer=true>
+class boundedQueue {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] size     Max number of entries, rounded up to a power of 2
+     */
+    boundedQueue(size_t size) {
+        capacity = 2;
+        while (capacity < size)
+            capacity <<= 1;
+
+        mask = capacity - 1;
+        slots = new Slot[capacity];
+
+        for (size_t i = 0; i < capacity; i++)
+            slots[i].seq.store(i, std::memory_order_relaxed);
+
+        tail = 0;
+        head = 0;
+        consumer_waiting = false;
+        producers_waiting = 0;
+        closed = false;
+    }
+
+    ~boundedQueue() {
+        delete [] slots;
+    }
+
+    /*********************************************************************
+     * Producer methods
+     *********************************************************************/
+
+    /**
+     * Add an entry if there is space
+     *
+     * \param [in] value    Entry to add
+     *
+     * \return true if added, false if the queue is full
+     */
+    bool tryPush(type const &value) {
+        uint64_t pos;
+        Slot     *slot;
+
+        if ((slot = reserve(pos)) == NULL)
+            return false;
+
+        slot->value = value;
+        slot->seq.store(pos + 1, std::memory_order_release);
+
+        wakeConsumer();
+        return true;
+    }
+
+    /**
+     * Add an entry, waits while the queue is full
+     *
+     * \param [in] value    Entry to add
+     *
+     * \return true if added, false if the queue was closed
+     */
+    bool push(type const &value) {
+        for (int i = 0; not tryPush(value); i++) {
+            if (isClosed())
+                return false;
+
+            if (i < BOUNDED_QUEUE_SPIN) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(wait_mutex);
+            producers_waiting++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (full() and not isClosed())
+                not_full.wait(lock);
+
+            producers_waiting--;
+        }
+
+        return true;
+    }
+
+    /**
+     * Add entries, waits while the queue is full
+     *
+     * \details Entries are reserved in runs, so a batch uses one reserve per run instead of
+     *          one per entry.  With more than one producer, entries of different producers
+     *          can be interleaved between runs.
+     *
+     * \param [in] values   Entries to add
+     * \param [in] count    Number of entries
+     *
+     * \return Number of entries added, less than count only if the queue was closed
+     */
+    size_t pushBatch(type const *values, size_t count) {
+        size_t added = 0;
+
+        while (added < count) {
+            size_t n = reserveRun(values + added, count - added);
+
+            if (n > 0) {
+                added += n;
+                wakeConsumer();
+
+            } else if (not push(values[added]))
+                break;                          // Closed
+            else
+                added++;
+        }
+
+        return added;
+    }
+
+    /**
+     * Close the queue
+     *
+     * \details Waiting producers and consumer return.  The consumer can still pop the
+     *          remaining entries.
+     */
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    /**
+     * Check if the queue has been closed
+     */
+    bool isClosed() {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    /*********************************************************************
+     * Consumer methods
+     *********************************************************************/
+
+    /**
+     * Remove the front entry if there is one
+     *
+     * \param [out] value   Updated with the entry
+     *
+     * \return true if an entry was removed, false if the queue is empty
+     */
+    bool tryPop(type &value) {
+        uint64_t pos = head.load(std::memory_order_relaxed);
+        Slot     *slot = &slots[pos & mask];
+
+        if (slot->seq.load(std::memory_order_acquire) != pos + 1)
+            return false;
+
+        value = std::move(slot->value);
+        slot->seq.store(pos + capacity, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_release);
+
+        wakeProducers();
+        return true;
+    }
+
+    /**
+     * Remove the front entry, waits while the queue is empty
+     *
+     * \param [out] value   Updated with the entry
+     *
+     * \return true if an entry was removed, false if the queue is closed and empty
+     */
+    bool pop(type &value) {
+        for (int i = 0; not tryPop(value); i++) {
+            if (isClosed() and empty())
+                return false;
+
+            if (i < BOUNDED_QUEUE_SPIN) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            waitNotEmpty();
+        }
+
+        return true;
+    }
+
+    /**
+     * Remove up to max entries, waits while the queue is empty
+     *
+     * \param [out] values  Array of at least max entries, updated with the entries
+     * \param [in]  max     Max number of entries to remove
+     *
+     * \return Number of entries removed, zero if the queue is closed and empty
+     */
+    size_t popBatch(type *values, size_t max) {
+        size_t n;
+
+        for (int i = 0; (n = tryPopBatch(values, max)) == 0; i++) {
+            if (isClosed() and empty())
+                return 0;
+
+            if (i < BOUNDED_QUEUE_SPIN) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            waitNotEmpty();
+        }
+
+        return n;
+    }
+
+    /**
+     * Remove up to max entries without waiting
+     *
+     * \param [out] values  Array of at least max entries, updated with the entries
+     * \param [in]  max     Max number of entries to remove
+     *
+     * \return Number of entries removed, zero if the queue is empty
+     */
+    size_t tryPopBatch(type *values, size_t max) {
+        uint64_t pos = head.load(std::memory_order_relaxed);
+        size_t   n;
+
+        for (n = 0; n < max; n++, pos++) {
+            Slot *slot = &slots[pos & mask];
+
+            if (slot->seq.load(std::memory_order_acquire) != pos + 1)
+                break;
+
+            values[n] = std::move(slot->value);
+            slot->seq.store(pos + capacity, std::memory_order_release);
+        }
+
+        if (n > 0) {
+            head.store(pos, std::memory_order_release);
+            wakeProducers();
+        }
+
+        return n;
+    }
+
+    /**
+     * Check if the queue is empty
+     *
+     * \details Exact when called by the consumer, entries reserved but not yet
+     *          filled by a producer count as not empty.
+     */
+    bool empty() {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Approximate number of entries in the queue
+     */
+    size_t size() {
+        uint64_t h = head.load(std::memory_order_acquire);
+        uint64_t t = tail.load(std::memory_order_acquire);
+
+        return t > h ? (size_t)(t - h) : 0;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t>   seq;            ///< pos if free for pos, pos + 1 if filled for pos
+        type                    value;
+    };
+
+    Slot                    *slots;             ///< Ring of slots
+    size_t                  capacity;           ///< Number of slots, power of 2
+    size_t                  mask;               ///< capacity - 1
+
+    // Keep producer and consumer positions on different cache lines
+    alignas(64) std::atomic<uint64_t>   tail;               ///< Next position to reserve (producers)
+    alignas(64) std::atomic<uint64_t>   head;               ///< Next position to pop (consumer)
+    alignas(64) std::atomic<bool>       consumer_waiting;   ///< Consumer is waiting for an entry
+    std::atomic<int>                    producers_waiting;  ///< Number of producers waiting for space
+    std::atomic<bool>                   closed;             ///< Queue is closed
+
+    std::mutex              wait_mutex;         ///< Used by the blocking methods to wait
+    std::condition_variable not_empty;          ///< Signals the consumer
+    std::condition_variable not_full;           ///< Signals the producers
+
+    /**
+     * Check if the queue is full
+     */
+    bool full() {
+        uint64_t pos = tail.load(std::memory_order_acquire);
+
+        return slots[pos & mask].seq.load(std::memory_order_acquire) != pos;
+    }
+
+    /**
+     * Reserve the next slot
+     *
+     * \param [out] pos    Position reserved
+     *
+     * \return Slot to fill, NULL if the queue is full
+     */
+    Slot *reserve(uint64_t &pos) {
+        pos = tail.load(std::memory_order_relaxed);
+
+        while (true) {
+            Slot     *slot = &slots[pos & mask];
+            uint64_t seq = slot->seq.load(std::memory_order_acquire);
+
+            if (seq != pos) {
+                if ((int64_t)(seq - pos) < 0)
+                    return NULL;                // Not yet popped, full
+
+                pos = tail.load(std::memory_order_relaxed);     // Taken by another producer
+
+            } else if (not multi_producer) {
+                tail.store(pos + 1, std::memory_order_relaxed);
+                return slot;
+
+            } else if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                return slot;
+        }
+    }
+
+    /**
+     * Reserve and fill a run of free slots
+     *
+     * \param [in] values   Entries to add
+     * \param [in] count    Number of entries
+     *
+     * \return Number of entries added, zero if the queue is full
+     */
+    size_t reserveRun(type const *values, size_t count) {
+        uint64_t pos = tail.load(std::memory_order_relaxed);
+        size_t   n;
+
+        while (true) {
+            // Slots are freed in order, so if the last slot of the run is free all of them are
+            n = count;
+            while (n > 0 and slots[(pos + n - 1) & mask].seq.load(std::memory_order_acquire) != pos + n - 1)
+                n--;
+
+            if (n == 0)
+                return 0;
+
+            if (not multi_producer) {
+                tail.store(pos + n, std::memory_order_relaxed);
+                break;
+            }
+
+            if (tail.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+                break;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            slots[(pos + i) & mask].value = values[i];
+            slots[(pos + i) & mask].seq.store(pos + i + 1, std::memory_order_release);
+        }
+
+        return n;
+    }
+
+    /**
+     * Wait until the queue is not empty or closed
+     */
+    void waitNotEmpty() {
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        consumer_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (empty() and not isClosed())
+            not_empty.wait(lock);
+
+        consumer_waiting.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * Wake the consumer if it's waiting
+     */
+    void wakeConsumer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (consumer_waiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(wait_mutex);
+            not_empty.notify_one();
+        }
+    }
+
+    /**
+     * Wake the producers if any are waiting
+     */
+    void wakeProducers() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (producers_waiting.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(wait_mutex);
+            not_full.notify_all();
+        }
+    }
+};
+
+#endif /* BOUNDEDQUEUE_HPP_ */
@@ -16,6 +16,7 @@
 
 #include "client_thread.h"
 #include "BMPReader.h"
+#include "CpuPlacement.h"
 #include "Logger.h"
 
 
@@ -37,17 +38,78 @@ void ClientThread_cancel(void *arg) {
     shutdown(cInfo->client->c_sock, SHUT_RDWR);
     close (cInfo->client->c_sock);
 
-    close (cInfo->client->pipe_sock);
-    close (cInfo->bmp_write_end_sock);
-    cInfo->bmp_reader_thread->join();
+    if (cInfo->ring != NULL) {
+        cInfo->ring->close();
+    } else {
+        close (cInfo->client->pipe_sock);
+        close (cInfo->bmp_write_end_sock);
+    }
+
+    if (cInfo->bmp_reader_thread != NULL) {
+        cInfo->bmp_reader_thread->join();
+
+        delete cInfo->bmp_reader_thread;
+        cInfo->bmp_reader_thread = NULL;
+    }
 
-    delete cInfo->bmp_reader_thread;
-    cInfo->bmp_reader_thread = NULL;
+    if (cInfo->ring != NULL) {
+        delete cInfo->ring;
+        cInfo->ring = NULL;
+    }
 
     delete cInfo->mbus;
     cInfo->mbus = NULL;
 }
 
+/**
+ * Client socket to ring loop
+ *
+ * \details Reads the client socket directly into the ring memory until the
+ *          connection is closed or the reader is done with the ring.
+ *
+ * \param [in]     cInfo       Reference to the client thread info (ring must be set)
+ * \param [in,out] bmp_run     Reference to the run flag shared with the reader thread
+ */
+static void ClientThread_ringLoop(ClientThreadInfo &cInfo, bool &bmp_run) {
+    pollfd pfd;
+    unsigned char *write_ptr;
+    size_t write_space;
+    ssize_t bytes_read = 0;
+
+    while (bmp_run and not cInfo.ring->isClosed()) {
+
+        if ((write_space = cInfo.ring->writeSpace(&write_ptr)) == 0) {
+            cInfo.ring->waitSpace();            // Ring is full, woken when the reader catches up or closes
+            continue;
+        }
+
+        pfd.fd = cInfo.client->c_sock;
+        pfd.events = POLLIN | POLLHUP | POLLERR;
+        pfd.revents = 0;
+
+        if (poll(&pfd, 1, 5) == 0) {
+            // Idle, memory of a drained ring is given back
+            cInfo.ring->releaseIfDrained();
+
+        } else {
+            if (pfd.revents & POLLHUP or pfd.revents & POLLERR)
+                bytes_read = 0;                 // Indicate to close the connection
+            else
+                bytes_read = read(cInfo.client->c_sock, write_ptr, write_space);
+
+            if (bytes_read <= 0) {
+                cInfo.ring->close();            // Reader will drain what is left and then get EOF
+                close(cInfo.client->c_sock);
+
+                bmp_run = false;
+                break;
+            }
+
+            cInfo.ring->commitWrite(bytes_read);
+        }
+    }
+}
+
 /**
  * Client thread function
  *
@@ -66,10 +128,13 @@ void *ClientThread(void *arg) {
     cInfo.mbus = NULL;
     cInfo.client = &thr->client;
     cInfo.log = thr->log;
+    cInfo.bmp_reader_thread = NULL;
+    cInfo.bmp_write_end_sock = -1;
+    cInfo.ring = NULL;
 
-    int sock_fds[2];
+    int sock_fds[2] = { -1, -1 };
     pollfd pfd;
-    unsigned char *sock_buf = NULL;
+    RecvBuffer *sock_mem = NULL;
 
     /*
      * Setup the cleanup routine for when the thread is canceled.
@@ -78,31 +143,65 @@ void *ClientThread(void *arg) {
     pthread_cleanup_push(ClientThread_cancel, &cInfo);
 
     try {
-        // connect to message bus
-        cInfo.mbus = new msgBus_kafka(logger, thr->cfg, thr->cfg->c_hash_id);
+        // Pinned first, the buffers below are allocated on the node of the router and the reader inherits the affinity
+        CpuPlacement::pin(*cInfo.client);
 
-        if (thr->cfg->debug_msgbus)
-            cInfo.mbus->enableDebug();
+        // connect to message bus
+        cInfo.mbus = thr->msgbus_factory->create(cInfo.client->hash_id);
 
-        BMPReader rBMP(logger, thr->cfg);
+        BMPReader rBMP(logger, thr->cfg, thr->parse_pipeline, thr->admission);
         LOG_INFO("Thread started to monitor BMP from router %s using socket %d buffer in bytes = %u",
                 cInfo.client->c_ip, cInfo.client->c_sock, thr->cfg->bmp_buffer_size);
 
-        // Buffer client socket using pipe
-        socketpair(PF_LOCAL, SOCK_STREAM, 0, sock_fds);
-        cInfo.bmp_write_end_sock = sock_fds[1];
-        cInfo.client->pipe_sock = sock_fds[0];
-
-        /*
-         * Create and start the reader thread to monitor the pipe fd (read end)
-         */
         bool bmp_run = true;
-        //cInfo.bmp_reader_thread = new std::thread([&] {rBMP.readerThreadLoop(bmp_run,cInfo.client,
-        cInfo.bmp_reader_thread = new std::thread(&BMPReader::readerThreadLoop, &rBMP, std::ref(bmp_run), cInfo.client,
-                                                                             (MsgBusInterface *)cInfo.mbus );
+
+        if (thr->cfg->bmp_ring_buffer) {
+            // Buffer client socket using the in-process ring, the reader copies out of ring memory
+            cInfo.ring = new spscRing(thr->cfg->bmp_buffer_size, thr->cfg->bmp_buffer_hugepages,
+                                      thr->cfg->bmp_buffer_release);
+            cInfo.client->ring = cInfo.ring;
+
+            if (thr->cfg->bmp_buffer_hugepages == RecvBuffer::HUGEPAGES_EXPLICIT and
+                    cInfo.ring->hugepages() != RecvBuffer::HUGEPAGES_EXPLICIT)
+                LOG_WARN("%s: No explicit hugepages available for the router buffer, using transparent hugepages",
+                         cInfo.client->c_ip);
+            cInfo.client->pipe_sock = 0;
+
+            cInfo.bmp_reader_thread = new std::thread(&BMPReader::readerThreadLoop, &rBMP, std::ref(bmp_run),
+                                                      cInfo.client, cInfo.mbus);
+
+            ClientThread_ringLoop(cInfo, bmp_run);
+
+            // Reader uses rBMP, so make sure it is done before leaving scope
+            cInfo.bmp_reader_thread->join();
+
+            bmp_run = false;                    // The socketpair loop below is not used
+
+        } else {
+            // Buffer client socket using pipe
+            socketpair(PF_LOCAL, SOCK_STREAM, 0, sock_fds);
+            cInfo.bmp_write_end_sock = sock_fds[1];
+            cInfo.client->pipe_sock = sock_fds[0];
+
+            /*
+             * Create and start the reader thread to monitor the pipe fd (read end)
+             */
+            //cInfo.bmp_reader_thread = new std::thread([&] {rBMP.readerThreadLoop(bmp_run,cInfo.client,
+            cInfo.bmp_reader_thread = new std::thread(&BMPReader::readerThreadLoop, &rBMP, std::ref(bmp_run), cInfo.client,
+                                                                                 cInfo.mbus);
+
+            // Memory of the circular buffer is committed as it's written
+            sock_mem = new RecvBuffer(thr->cfg->bmp_buffer_size, thr->cfg->bmp_buffer_hugepages);
+
+            if (thr->cfg->bmp_buffer_hugepages == RecvBuffer::HUGEPAGES_EXPLICIT and
+                    sock_mem->hugepages() != RecvBuffer::HUGEPAGES_EXPLICIT)
+                LOG_WARN("%s: No explicit hugepages available for the router buffer, using transparent hugepages",
+                         cInfo.client->c_ip);
+        }
 
         // Variables to handle circular buffer
-        sock_buf = new unsigned char[thr->cfg->bmp_buffer_size];
+        unsigned char *sock_buf = sock_mem != NULL ? sock_mem->data() : NULL;
+        int dirty = 0;                              // Bytes received since the buffer memory was released
         int bytes_read = 0;
         int write_buf_pos = 0;
         int read_buf_pos = 0;
@@ -151,6 +250,7 @@ void *ClientThread(void *arg) {
                     else {
                         sock_buf_write_ptr += bytes_read;
                         write_buf_pos += bytes_read;
+                        dirty += bytes_read;
                     }
 
                 }
@@ -218,6 +318,19 @@ void *ClientThread(void *arg) {
                 wrap_state = false;
                 //LOG_INFO("read buffer wrapped");
             }
+
+            /*
+             * Everything was written to the bmp reader, start over at the beginning of the buffer
+             *      and give the memory back once enough was received
+             */
+            if (not wrap_state and read_buf_pos == write_buf_pos and thr->cfg->bmp_buffer_release > 0
+                    and dirty >= thr->cfg->bmp_buffer_release) {
+                sock_mem->release();
+                dirty = 0;
+
+                read_buf_pos = write_buf_pos = 0;
+                sock_buf_read_ptr = sock_buf_write_ptr = sock_buf;
+            }
         }
 
         LOG_INFO("%s: Thread for sock [%d] ended normally", cInfo.client->c_ip, cInfo.client->c_sock);
@@ -240,8 +353,8 @@ void *ClientThread(void *arg) {
         close(sock_fds[1]);
     }
 
-    if (sock_buf != NULL)
-        delete [] sock_buf;
+    if (sock_mem != NULL)
+        delete sock_mem;
 
     pthread_cleanup_pop(0);
 
@@ -252,6 +365,11 @@ void *ClientThread(void *arg) {
     if (cInfo.bmp_reader_thread != NULL)
         delete cInfo.bmp_reader_thread;
 
+    if (cInfo.ring != NULL) {
+        cInfo.client->ring = NULL;
+        delete cInfo.ring;
+    }
+
     if (cInfo.mbus != NULL)
         delete cInfo.mbus;
 
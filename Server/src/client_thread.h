@@ -10,10 +10,12 @@
 #ifndef CLIENT_THREAD_H_
 #define CLIENT_THREAD_H_
 
-#include "MsgBusImpl_kafka.h"
+#include "MsgBusFactory.h"
 #include "BMPListener.h"
 #include "Logger.h"
 #include "Config.h"
+#include "ParsePipeline.h"
+#include "AdmissionController.h"
 #include <thread>
 
 #define CLIENT_WRITE_BUFFER_BLOCK_SIZE    8192        // Number of bytes to write to BMP reader from buffer
@@ -23,17 +25,22 @@ struct ThreadMgmt {
     BMPListener::ClientInfo client;
     Config *cfg;
     Logger *log;
+    MsgBusFactory *msgbus_factory;      // Creates the message bus of the router
+    ParsePipeline *parse_pipeline;      // Shared parse pipeline, NULL if messages are decoded inline
+    AdmissionController *admission;     // Paces the reads of the routers, NULL if not used
     bool running;                       // true if running, zero if not running
+    bool pooled;                        // true if serviced by a RouterWorkerPool worker instead of thr
     bool baselineTimeout;		        // true if past the baseline time of the router
 };
 
 struct ClientThreadInfo {
-    msgBus_kafka *mbus;
+    MsgBusInterface *mbus;
     BMPListener::ClientInfo *client;
     Logger *log;
 
     std::thread *bmp_reader_thread;
     int bmp_write_end_sock;
+    spscRing *ring;                     ///< In-process ring used instead of the socketpair, NULL if not used
 
 };
 
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include <cstdlib>
+#include <new>
+
+#include "KafkaBufferPool.h"
+
+/**
+ * Constructor for class
+ *
+ * \param [in] buf_size     Size in bytes of each buffer
+ * \param [in] max_free     Maximum number of free buffers to keep, extra buffers are freed
+ */
+KafkaBufferPool::KafkaBufferPool(size_t buf_size, size_t max_free) {
+    this->buf_size = buf_size;
+    this->max_free = max_free;
+}
+
+KafkaBufferPool::~KafkaBufferPool() {
+    for (size_t i = 0; i < free_bufs.size(); i++)
+        free(free_bufs[i]);
+
+    free_bufs.clear();
+}
+
+/**
+ * Get a buffer from the pool, allocates a new one if none are free
+ *
+ * \return Pointer to buffer of buf_size bytes
+ */
+char *KafkaBufferPool::get() {
+    char *buf = NULL;
+
+    mutex.lock();
+    if (free_bufs.size() > 0) {
+        buf = free_bufs.back();
+        free_bufs.pop_back();
+    }
+    mutex.unlock();
+
+    if (buf == NULL and (buf = (char *)malloc(buf_size)) == NULL)
+        throw std::bad_alloc();
+
+    return buf;
+}
+
+/**
+ * Return a buffer to the pool
+ *
+ * \param [in] buf      Buffer previously returned by get()
+ */
+void KafkaBufferPool::release(char *buf) {
+    if (buf == NULL)
+        return;
+
+    mutex.lock();
+    if (free_bufs.size() < max_free) {
+        free_bufs.push_back(buf);
+        buf = NULL;
+    }
+    mutex.unlock();
+
+    if (buf != NULL)
+        free(buf);
+}
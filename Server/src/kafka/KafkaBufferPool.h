@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OPENBMP_KAFKABUFFERPOOL_H
+#define OPENBMP_KAFKABUFFERPOOL_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * \class   KafkaBufferPool
+ *
+ * \brief   Pool of message working buffers that are handed to librdkafka
+ * \details Large messages are produced without copying by handing the working buffer
+ *          to librdkafka.  The buffer is returned to the pool by the delivery report
+ *          callback once librdkafka is done with it; messages still queued when the
+ *          producer disconnects are purged so their reports return them too.  Buffers are
+ *          allocated with malloc().
+ */
+class KafkaBufferPool {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] buf_size     Size in bytes of each buffer
+     * \param [in] max_free     Maximum number of free buffers to keep, extra buffers are freed
+     */
+    KafkaBufferPool(size_t buf_size, size_t max_free);
+
+    ~KafkaBufferPool();
+
+    /**
+     * Get a buffer from the pool, allocates a new one if none are free
+     *
+     * \return Pointer to buffer of buf_size bytes
+     */
+    char *get();
+
+    /**
+     * Return a buffer to the pool
+     *
+     * \param [in] buf      Buffer previously returned by get()
+     */
+    void release(char *buf);
+
+    /**
+     * Size in bytes of each buffer
+     */
+    size_t bufSize() { return buf_size; }
+
+private:
+    size_t              buf_size;           ///< Size of each buffer
+    size_t              max_free;           ///< Max number of free buffers to keep
+    std::vector<char *> free_bufs;          ///< Free buffers
+    std::mutex          mutex;              ///< Protects free_bufs, release is called from the delivery callback
+};
+
+#endif //OPENBMP_KAFKABUFFERPOOL_H
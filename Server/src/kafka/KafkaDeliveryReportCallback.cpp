@@ -8,7 +8,18 @@
  */
 
 #include "KafkaDeliveryReportCallback.h"
+#include "Metrics.h"
+
+KafkaDeliveryReportCallback::KafkaDeliveryReportCallback(KafkaBufferPool *pool) {
+    this->pool = pool;
+}
 
 void KafkaDeliveryReportCallback::dr_cb (RdKafka::Message &message) {
+    if (pool != NULL and message.msg_opaque() != NULL)
+        pool->release((char *)message.msg_opaque());
+
+    if (Metrics::enabled and message.latency() >= 0)
+        Metrics::observe(Metrics::STAGE_DELIVERY, message.latency());
+
     //std::cout << "Message delivery for (" << message.len() << " bytes): " << message.errstr() << std::endl;
 }
\ No newline at end of file
@@ -12,10 +12,27 @@
 
 #include <librdkafka/rdkafkacpp.h>
 #include "Logger.h"
+#include "KafkaBufferPool.h"
 
 class KafkaDeliveryReportCallback : public RdKafka::DeliveryReportCb {
 public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] pool     Pool to return zero copy message buffers to, NULL if not used
+     */
+    KafkaDeliveryReportCallback(KafkaBufferPool *pool=NULL);
+
+    /**
+     * Delivery report callback
+     *
+     * \details Messages produced without copy carry their pool buffer as the message
+     *          opaque.  The buffer is released back to the pool here.
+     */
     void dr_cb (RdKafka::Message &message);
+
+private:
+    KafkaBufferPool *pool;                  ///< Pool for zero copy message buffers
 };
 
 #endif //OPENBMP_KAFKADELIVERYREPORTCALLBACK_H
@@ -10,8 +10,9 @@
 #include <string>
 #include <ctime>
 
-KafkaPeerPartitionerCallback::KafkaPeerPartitionerCallback()
+KafkaPeerPartitionerCallback::KafkaPeerPartitionerCallback(bool legacy)
             : RdKafka::PartitionerCb() {
+    this->legacy = legacy;
 }
 
 int32_t KafkaPeerPartitionerCallback::partitioner_cb (const RdKafka::Topic *topic,
@@ -19,5 +20,49 @@ int32_t KafkaPeerPartitionerCallback::partitioner_cb (const RdKafka::Topic *topi
                                                   int32_t partition_cnt,
                                                   void *msg_opaque) {
 
-    return (key->at(0) + key->at(key->size() - 1)) % partition_cnt;
-}
\ No newline at end of file
+    if (key == NULL or key->size() == 0)
+        return 0;
+
+    if (legacy)
+        return (key->at(0) + key->at(key->size() - 1)) % partition_cnt;
+
+    // Same as the Java client, the sign bit is masked off instead of using abs()
+    return (murmur2(key->data(), key->size()) & 0x7fffffff) % partition_cnt;
+}
+
+uint32_t KafkaPeerPartitionerCallback::murmur2(const char *data, size_t len) {
+    const uint32_t  m = 0x5bd1e995;
+    const int       r = 24;
+    const u_char    *p = (const u_char *)data;
+    uint32_t        h = 0x9747b28c ^ (uint32_t)len;
+    uint32_t        k;
+
+    for (; len >= 4; len -= 4, p += 4) {
+        k = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h *= m;
+        h ^= k;
+    }
+
+    switch (len) {
+        case 3:
+            h ^= p[2] << 16;
+            // fall through
+        case 2:
+            h ^= p[1] << 8;
+            // fall through
+        case 1:
+            h ^= p[0];
+            h *= m;
+    }
+
+    h ^= h >> 13;
+    h *= m;
+    h ^= h >> 15;
+
+    return h;
+}
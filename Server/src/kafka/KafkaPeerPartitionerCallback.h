@@ -11,17 +11,41 @@
 #define OPENBMP_KAFKAPEERPARTITIONERCALLBACK_H
 
 #include <map>
+#include <cstdint>
 #include <librdkafka/rdkafkacpp.h>
 
+/**
+ * \class   KafkaPeerPartitionerCallback
+ *
+ * \brief   Maps the message key (peer or router hash) to a partition
+ * \details murmur2 is the same hash as the Java client default partitioner, so keys
+ *          are placed on the same partition as Java producers would place them.
+ */
 class KafkaPeerPartitionerCallback : public RdKafka::PartitionerCb{
 
 public:
-    KafkaPeerPartitionerCallback();
+    /**
+     * Constructor for class
+     *
+     * \param [in] legacy   True to use the previous first + last character partitioner
+     */
+    KafkaPeerPartitionerCallback(bool legacy=false);
 
     int32_t partitioner_cb (const RdKafka::Topic *topic, const std::string *key,
                             int32_t partition_cnt, void *msg_opaque);
 
+    /**
+     * Murmur2 hash of the Java client (org.apache.kafka.common.utils.Utils.murmur2)
+     *
+     * \param [in] data     Data to hash
+     * \param [in] len      Length of data in bytes
+     *
+     * \return 32 bit hash
+     */
+    static uint32_t murmur2(const char *data, size_t len);
+
 private:
+    bool    legacy;                 ///< Use the first + last character partitioner
 };
 
 
@@ -0,0 +1,567 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "KafkaProducer.h"
+#include "MsgBusImpl_kafka.h"
+#include "Metrics.h"
+
+using namespace std;
+
+std::mutex KafkaProducer::all_mutex;
+std::set<KafkaProducer *> KafkaProducer::all_producers;
+
+/**
+ * Constructor for class
+ *
+ * \details Does not connect, call connect() before producing.
+ *
+ * \param [in] logPtr   Pointer to Logger instance
+ * \param [in] cfg      Pointer to the config instance
+ * \param [in] brokers  Broker list to connect to, empty is cfg->kafka_brokers
+ * \param [in] linger_ms    queue.buffering.max.ms of the producer, < 0 is cfg->q_buf_max_ms
+ */
+KafkaProducer::KafkaProducer(Logger *logPtr, Config *cfg, const std::string &brokers, int linger_ms) {
+    logger = logPtr;
+    this->cfg = cfg;
+    this->brokers = brokers.size() > 0 ? brokers : cfg->kafka_brokers;
+    this->linger_ms = linger_ms >= 0 ? linger_ms : cfg->q_buf_max_ms;
+
+    connected = false;
+    connecting = false;
+    topic_gen = 1;
+    outq = 0;
+    active = 0;
+
+    event_callback       = NULL;
+    delivery_callback    = NULL;
+    producer             = NULL;
+    topicSel             = NULL;
+
+    // Working buffers are handed to librdkafka for large messages, keep a few around for reuse
+    buf_pool = new KafkaBufferPool(MSGBUS_HDR_RESERVE + MSGBUS_WORKING_BUF_SIZE, 4);
+
+    conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
+
+    disableDebug();
+
+    // The replay thread of the spool reconnects the producer
+    spool = KafkaSpool::find(this->brokers);
+    if (spool != NULL)
+        spool->attach(this);
+
+    std::lock_guard<std::mutex> lock(all_mutex);
+    all_producers.insert(this);
+}
+
+/**
+ * Destructor, disconnects and waits for queued messages to be sent
+ */
+KafkaProducer::~KafkaProducer() {
+    {
+        std::lock_guard<std::mutex> lock(all_mutex);
+        all_producers.erase(this);
+    }
+
+    if (spool != NULL)
+        spool->detach(this);
+
+    // Queued zero copy buffers are returned to the pool by their (purged) delivery reports
+    disconnect(500);
+
+    delete buf_pool;
+
+    delete conf;
+}
+
+/**
+ * Disconnect from kafka
+ *
+ * \param [in] wait_ms      Time in ms to wait for librdkafka to be destroyed
+ */
+void KafkaProducer::disconnect(int wait_ms) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    if (connected) {
+        int i = 0;
+        while (producer->outq_len() > 0 and i < 8) {
+            LOG_INFO("Waiting for producer to finish before disconnecting: outq=%d", producer->outq_len());
+            producer->poll(500);
+            i++;
+        }
+    }
+
+    // Calls that took the producer before the lock are short, poll() is bounded by its timeout
+    while (active > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    /*
+     * Zero copy buffers are only returned to the pool by their delivery report, purge
+     *    what is still queued so the reports of the messages are served before the destroy
+     */
+    if (producer != NULL) {
+#if RD_KAFKA_VERSION >= 0x01000000
+        producer->purge(RdKafka::Producer::PURGE_QUEUE | RdKafka::Producer::PURGE_INFLIGHT);
+#endif
+        for (int i = 0; producer->outq_len() > 0 and i < 10; i++)
+            producer->poll(100);
+
+        if (producer->outq_len() > 0)
+            LOG_WARN("Disconnecting producer with %d messages not delivered", producer->outq_len());
+    }
+
+    if (topicSel != NULL) delete topicSel;
+
+    topicSel = NULL;
+    topic_gen++;                    // Topics cached by the callers are no longer valid
+
+    if (producer != NULL) delete producer;
+    producer = NULL;
+
+    // suggested by librdkafka to free memory
+    RdKafka::wait_destroyed(wait_ms);
+
+    if (event_callback != NULL) delete event_callback;
+    event_callback = NULL;
+
+    if (delivery_callback != NULL) delete delivery_callback;
+    delivery_callback = NULL;
+
+    connected = false;
+    outq = 0;
+}
+
+/**
+ * Indicates if connected and the topics are initialized
+ */
+bool KafkaProducer::isConnected() {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    return connected and topicSel != NULL;
+}
+
+/**
+ * Connects to the kafka brokers if not already connected
+ *
+ * \details If another thread has already reconnected, this is a no-op.
+ */
+void KafkaProducer::connect() {
+    string errstr;
+    string value;
+    std::ostringstream rx_bytes, tx_bytes, sess_timeout, socket_timeout;
+    std::ostringstream q_buf_max_msgs, q_buf_max_ms,
+		msg_send_max_retry, retry_backoff_ms;
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    if (connected and topicSel != NULL)
+        return;
+
+    // Messages are spooled while connecting instead of waiting for the producer lock
+    struct ConnectingFlag {
+        std::atomic<bool> &flag;
+        ConnectingFlag(std::atomic<bool> &flag) : flag(flag) { flag = true; }
+        ~ConnectingFlag() { flag = false; }
+    } connecting_flag(connecting);
+
+    disconnect();
+
+    /*
+     * Configure Kafka Producer (https://kafka.apache.org/08/configuration.html)
+     */
+    //TODO: Add config options to change these settings
+
+    // Disable logging of connection close/idle timeouts caused by Kafka 0.9.x (connections.max.idle.ms)
+    //    See https://github.com/edenhill/librdkafka/issues/437 for more details.
+    // TODO: change this when librdkafka has better handling of the idle disconnects
+    value = "false";
+    if (conf->set("log.connection.close", value, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure log.connection.close=false: %s.", errstr.c_str());
+    }
+
+    value = "true";
+    if (conf->set("api.version.request", value, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure api.version.request=true: %s.", errstr.c_str());
+    }
+
+    // TODO: Add config for address family - default is any
+    /*value = "v4";
+    if (conf->set("broker.address.family", value, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure broker.address.family: %s.", errstr.c_str());
+    }*/
+
+
+    // Batch message number
+    value = "100";
+    if (conf->set("batch.num.messages", value, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure batch.num.messages for kafka: %s.", errstr.c_str());
+        throw "ERROR: Failed to configure kafka batch.num.messages";
+    }
+
+    // Batch message max wait time (in ms)
+    q_buf_max_ms << linger_ms;
+    if (conf->set("queue.buffering.max.ms", q_buf_max_ms.str(), errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure queue.buffering.max.ms for kafka: %s.", errstr.c_str());
+        throw "ERROR: Failed to configure kafka queue.buffer.max.ms";
+    }
+
+
+    // compression
+    value = cfg->compression;
+    if (conf->set("compression.codec", value, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure %s compression for kafka: %s.", value.c_str(), errstr.c_str());
+        throw "ERROR: Failed to configure kafka compression";
+    }
+
+    // broker list
+    if (conf->set("metadata.broker.list", brokers, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure broker list for kafka: %s", errstr.c_str());
+        throw "ERROR: Failed to configure kafka broker list";
+    }
+
+    // Maximum transmit byte size
+    tx_bytes << cfg->tx_max_bytes;
+    if (conf->set("message.max.bytes", tx_bytes.str(), 
+                             errstr) != RdKafka::Conf::CONF_OK) 
+    {
+       LOG_ERR("Failed to configure transmit max message size for kafka: %s",
+                               errstr.c_str());
+       throw "ERROR: Failed to configure transmit max message size";
+    } 
+ 
+    // Maximum receive byte size
+    rx_bytes << cfg->rx_max_bytes;
+    if (conf->set("receive.message.max.bytes", rx_bytes.str(), 
+                             errstr) != RdKafka::Conf::CONF_OK)
+    {
+       LOG_ERR("Failed to configure receive max message size for kafka: %s",
+                               errstr.c_str());
+       throw "ERROR: Failed to configure receive max message size";
+    }
+
+    // Client group session and failure detection timeout
+    sess_timeout << cfg->session_timeout;
+    if (conf->set("session.timeout.ms", sess_timeout.str(), 
+                             errstr) != RdKafka::Conf::CONF_OK) 
+    {
+       LOG_ERR("Failed to configure session timeout for kafka: %s",
+                               errstr.c_str());
+       throw "ERROR: Failed to configure session timeout ";
+    } 
+    
+    // Timeout for network requests 
+    socket_timeout << cfg->socket_timeout;
+    if (conf->set("socket.timeout.ms", socket_timeout.str(), 
+                             errstr) != RdKafka::Conf::CONF_OK) 
+    {
+       LOG_ERR("Failed to configure socket timeout for kafka: %s",
+                               errstr.c_str());
+       throw "ERROR: Failed to configure socket timeout ";
+    } 
+    
+    // Maximum number of messages allowed on the producer queue 
+    q_buf_max_msgs << cfg->q_buf_max_msgs;
+    if (conf->set("queue.buffering.max.messages", q_buf_max_msgs.str(), 
+                             errstr) != RdKafka::Conf::CONF_OK) 
+    {
+       LOG_ERR("Failed to configure max messages in buffer for kafka: %s",
+                               errstr.c_str());
+       throw "ERROR: Failed to configure max messages in buffer ";
+    } 
+
+    // How many times to retry sending a failing MessageSet
+    msg_send_max_retry << cfg->msg_send_max_retry;
+    if (conf->set("message.send.max.retries", msg_send_max_retry.str(), 
+                             errstr) != RdKafka::Conf::CONF_OK) 
+    {
+       LOG_ERR("Failed to configure max retries for sending "
+               "failed message for kafka: %s",
+                               errstr.c_str());
+       throw "ERROR: Failed to configure max retries for sending failed message";
+    } 
+    
+    // Backoff time in ms before retrying a message send
+    retry_backoff_ms << cfg->retry_backoff_ms;
+    if (conf->set("retry.backoff.ms", retry_backoff_ms.str(), 
+                             errstr) != RdKafka::Conf::CONF_OK) 
+    {
+       LOG_ERR("Failed to configure backoff time before retrying to send"
+               "failed message for kafka: %s",
+                               errstr.c_str());
+       throw "ERROR: Failed to configure backoff time before resending"
+             " failed messages ";
+    } 
+    
+    // Register event callback
+    event_callback = new KafkaEventCallback(&connected, logger);
+    if (conf->set("event_cb", event_callback, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure kafka event callback: %s", errstr.c_str());
+        throw "ERROR: Failed to configure kafka event callback";
+    }
+
+    // Register delivery report callback
+    delivery_callback = new KafkaDeliveryReportCallback(buf_pool);
+
+    if (conf->set("dr_cb", delivery_callback, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure kafka delivery report callback: %s", errstr.c_str());
+        throw "ERROR: Failed to configure kafka delivery report callback";
+    }
+
+    // Create producer and connect
+    producer = RdKafka::Producer::create(conf, errstr);
+    if (producer == NULL) {
+        LOG_ERR("Failed to create producer: %s", errstr.c_str());
+        throw "ERROR: Failed to create producer";
+    }
+
+    connected = true;
+
+    producer->poll(1000);
+
+    if (not connected) {
+        LOG_ERR("Failed to connect to Kafka, will try again in a few");
+        return;
+
+    }
+
+    /*
+     * Initialize the topic selector/handler
+     */
+    try {
+        topicSel = new KafkaTopicSelector(logger, cfg, producer);
+
+    } catch (char const *str) {
+        LOG_ERR("Failed to create one or more topics, will try again in a few: err=%s", str);
+        connected = false;
+        return;
+    }
+
+    producer->poll(100);
+}
+
+/**
+ * Produce a message
+ *
+ * \param [in] topic_var        Topic var to use in KafkaTopicSelector::getTopic() MSGBUS_TOPIC_VAR_*
+ * \param [in] router_group     Router group name - empty/NULL if not set or used
+ * \param [in] peer_group       Peer group name - empty/NULL if not set or used
+ * \param [in] peer_asn         Peer ASN
+ * \param [in] msgflags         RdKafka::Producer::RK_MSG_* flags
+ * \param [in] payload          Message payload
+ * \param [in] len              Length of the payload in bytes
+ * \param [in] key              Message key
+ * \param [in] msg_opaque       Opaque passed to the delivery report callback
+ * \param [in,out] cache        Topic resolved by a previous call with the same topic var, groups
+ *                              and peer ASN; NULL to always look the topic up
+ *
+ * \return ERR_NO_ERROR on success, ERR__UNKNOWN_TOPIC if the topic couldn't be found,
+ *         otherwise the librdkafka produce error
+ */
+RdKafka::ErrorCode KafkaProducer::produce(const char *topic_var, const std::string *router_group,
+                                          const std::string *peer_group, uint32_t peer_asn,
+                                          int msgflags, void *payload, size_t len,
+                                          const std::string *key, void *msg_opaque,
+                                          TopicCache *cache) {
+    RdKafka::Topic *topic;
+    RdKafka::Producer *rk;
+
+    // Router threads don't wait for a reconnect
+    if (spool != NULL and connecting and
+            spoolMessage(topic_var, router_group, peer_group, peer_asn, msgflags, payload, len, key, msg_opaque, false))
+        return RdKafka::ERR_NO_ERROR;
+
+    std::unique_lock<std::recursive_mutex> lock(mutex);
+
+    // Once spooled, messages are spooled until the spool is replayed so they stay in order
+    if (spool != NULL and spoolMessage(topic_var, router_group, peer_group, peer_asn, msgflags, payload, len,
+                                       key, msg_opaque, connected and topicSel != NULL))
+        return RdKafka::ERR_NO_ERROR;
+
+    if (topicSel == NULL)
+        return RdKafka::ERR__UNKNOWN_TOPIC;
+
+    if (cache != NULL and cache->gen == topic_gen) {
+        topic = cache->topic;
+
+    } else {
+        topic = topicSel->getTopic(topic_var, router_group, peer_group, peer_asn);
+        if (topic == NULL)
+            return RdKafka::ERR__UNKNOWN_TOPIC;
+
+        if (cache != NULL) {
+            cache->topic = topic;
+            cache->gen = topic_gen;
+        }
+    }
+
+    SELF_DEBUG("Producing message: topic=%s key=%s, msg size = %lu",
+               topic->name().c_str(), key->c_str(), len);
+
+    // librdkafka produce is thread safe, the producer and topic are kept until active drops
+    rk = producer;
+    active++;
+    lock.unlock();
+
+    uint64_t start_us = Metrics::enabled ? Metrics::now() : 0;
+
+    RdKafka::ErrorCode err = rk->produce(topic, RdKafka::Topic::PARTITION_UA, msgflags,
+                                         payload, len, key, msg_opaque);
+    outq = rk->outq_len();
+
+    if (start_us)
+        Metrics::observe(Metrics::STAGE_PRODUCE, Metrics::now() - start_us);
+
+    active--;
+
+    if (err == RdKafka::ERR__QUEUE_FULL and spool != NULL and
+            spoolMessage(topic_var, router_group, peer_group, peer_asn, msgflags, payload, len, key, msg_opaque, false))
+        return RdKafka::ERR_NO_ERROR;
+
+    return err;
+}
+
+/**
+ * Spool a message, see produce()
+ *
+ * \param [in] if_pending       True to only spool if the spool has messages to replay
+ *
+ * \return true if the spool took the message, the payload is released
+ */
+bool KafkaProducer::spoolMessage(const char *topic_var, const std::string *router_group,
+                                 const std::string *peer_group, uint32_t peer_asn,
+                                 int msgflags, void *payload, size_t len,
+                                 const std::string *key, void *msg_opaque, bool if_pending) {
+    if (not spool->append(topic_var, router_group, peer_group, peer_asn, payload, len, key, if_pending))
+        return false;
+
+    // Released as the delivery report callback would
+    if (msgflags & RdKafka::Producer::RK_MSG_FREE)
+        free(payload);
+    else if (msg_opaque != NULL)
+        buf_pool->release((char *)msg_opaque);
+
+    return true;
+}
+
+/**
+ * Serve the producer callbacks (delivery reports and events)
+ *
+ * \param [in] timeout_ms   Time in ms to block waiting for events
+ */
+void KafkaProducer::poll(int timeout_ms) {
+    RdKafka::Producer *rk;
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+
+        if (producer == NULL)
+            return;
+
+        rk = producer;
+        active++;
+    }
+
+    // Not blocking connect/produce for the timeout, see disconnect()
+    rk->poll(timeout_ms);
+    outq = rk->outq_len();
+
+    active--;
+}
+
+/**
+ * Largest producer queue (messages waiting to be sent) of all producers
+ *
+ * \details The queue length is updated by each produce() and poll().
+ */
+int KafkaProducer::maxOutqLen() {
+    std::lock_guard<std::mutex> lock(all_mutex);
+    int max = 0;
+
+    for (std::set<KafkaProducer *>::iterator it = all_producers.begin(); it != all_producers.end(); ++it) {
+        if ((*it)->outq > max)
+            max = (*it)->outq;
+    }
+
+    return max;
+}
+
+/**
+ * Sum of the producer queues of all producers
+ */
+int KafkaProducer::totalOutqLen() {
+    std::lock_guard<std::mutex> lock(all_mutex);
+    int total = 0;
+
+    for (std::set<KafkaProducer *>::iterator it = all_producers.begin(); it != all_producers.end(); ++it)
+        total += (*it)->outq;
+
+    return total;
+}
+
+/**
+ * Lookup the router group - See KafkaTopicSelector::lookupRouterGroup()
+ */
+void KafkaProducer::lookupRouterGroup(std::string hostname, std::string ip_addr, std::string &router_group_name) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    if (topicSel != NULL)
+        topicSel->lookupRouterGroup(hostname, ip_addr, router_group_name);
+}
+
+/**
+ * Lookup the peer group - See KafkaTopicSelector::lookupPeerGroup()
+ */
+void KafkaProducer::lookupPeerGroup(std::string hostname, std::string ip_addr, uint32_t peer_asn,
+                                    std::string &peer_group_name) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    if (topicSel != NULL)
+        topicSel->lookupPeerGroup(hostname, ip_addr, peer_asn, peer_group_name);
+}
+
+/**
+ * Pool of working buffers returned by the delivery report callback
+ */
+KafkaBufferPool *KafkaProducer::getBufferPool() {
+    return buf_pool;
+}
+
+/*
+ * Enable/disable debugs
+ */
+void KafkaProducer::enableDebug() {
+    string value = "all";
+    string errstr;
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    disconnect();
+
+    if (conf->set("debug", value, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to enable debug on kafka producer confg: %s", errstr.c_str());
+    }
+
+    connect();
+
+    debug = true;
+}
+
+void KafkaProducer::disableDebug() {
+    string errstr;
+    string value = "";
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    if (conf)
+        conf->set("debug", value, errstr);
+
+    debug = false;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OPENBMP_KAFKAPRODUCER_H
+#define OPENBMP_KAFKAPRODUCER_H
+
+#include <librdkafka/rdkafkacpp.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "Config.h"
+#include "Logger.h"
+#include "KafkaEventCallback.h"
+#include "KafkaDeliveryReportCallback.h"
+#include "KafkaBufferPool.h"
+#include "KafkaTopicSelector.h"
+#include "KafkaSpool.h"
+
+/**
+ * \class   KafkaProducer
+ *
+ * \brief   Kafka producer connection
+ * \details Owns the librdkafka producer, its configuration, callbacks and topic selector.
+ *          A producer is either owned by a single msgBus_kafka instance or shared by
+ *          several router threads via KafkaProducerPool.  All methods are thread safe;
+ *          message sequence numbers and keys are kept by msgBus_kafka per router.
+ *
+ *          If the cluster is spooled (see KafkaSpool), messages are spooled instead of
+ *          produced while the producer is not connected, its queue is full or the spool has
+ *          messages to replay.
+ */
+class KafkaProducer {
+public:
+    /**
+     * Topic cached by the caller, see produce()
+     *
+     * \details Topics are freed when the producer disconnects, gen is compared with the
+     *          producer topic generation before the cached topic is used.
+     */
+    struct TopicCache {
+        RdKafka::Topic      *topic;         ///< Resolved topic, valid if gen matches the producer
+        uint64_t            gen;            ///< Producer topic generation of topic, 0 if not resolved
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \details Does not connect, call connect() before producing.
+     *
+     * \param [in] logPtr   Pointer to Logger instance
+     * \param [in] cfg      Pointer to the config instance
+     * \param [in] brokers  Broker list to connect to, empty is cfg->kafka_brokers
+     * \param [in] linger_ms    queue.buffering.max.ms of the producer, < 0 is cfg->q_buf_max_ms
+     */
+    KafkaProducer(Logger *logPtr, Config *cfg, const std::string &brokers = "", int linger_ms = -1);
+
+    /**
+     * Destructor, disconnects and waits for queued messages to be sent
+     */
+    ~KafkaProducer();
+
+    /**
+     * Connects to the kafka brokers if not already connected
+     *
+     * \details If another thread has already reconnected, this is a no-op.
+     */
+    void connect();
+
+    /**
+     * Disconnect from kafka
+     *
+     * \param [in] wait_ms      Time in ms to wait for librdkafka to be destroyed
+     */
+    void disconnect(int wait_ms=2000);
+
+    /**
+     * Indicates if connected and the topics are initialized
+     */
+    bool isConnected();
+
+    /**
+     * Produce a message
+     *
+     * \param [in] topic_var        Topic var to use in KafkaTopicSelector::getTopic() MSGBUS_TOPIC_VAR_*
+     * \param [in] router_group     Router group name - empty/NULL if not set or used
+     * \param [in] peer_group       Peer group name - empty/NULL if not set or used
+     * \param [in] peer_asn         Peer ASN
+     * \param [in] msgflags         RdKafka::Producer::RK_MSG_* flags
+     * \param [in] payload          Message payload
+     * \param [in] len              Length of the payload in bytes
+     * \param [in] key              Message key
+     * \param [in] msg_opaque       Opaque passed to the delivery report callback
+     * \param [in,out] cache        Topic resolved by a previous call with the same topic var, groups
+     *                              and peer ASN; NULL to always look the topic up
+     *
+     * \details A spooled message is copied, the payload is freed (RK_MSG_FREE) or returned to
+     *          the buffer pool (msg_opaque) as if it was delivered.
+     *
+     * \return ERR_NO_ERROR on success or if spooled, ERR__UNKNOWN_TOPIC if the topic couldn't
+     *         be found, otherwise the librdkafka produce error
+     */
+    RdKafka::ErrorCode produce(const char *topic_var, const std::string *router_group,
+                               const std::string *peer_group, uint32_t peer_asn,
+                               int msgflags, void *payload, size_t len,
+                               const std::string *key, void *msg_opaque,
+                               TopicCache *cache=NULL);
+
+    /**
+     * Serve the producer callbacks (delivery reports and events)
+     *
+     * \param [in] timeout_ms   Time in ms to block waiting for events
+     */
+    void poll(int timeout_ms);
+
+    /**
+     * Producer queue length at the last produce/poll
+     */
+    int outqLen()                               { return outq; }
+
+    /**
+     * Indicates if the messages are spooled when kafka can't take them, see KafkaSpool
+     */
+    bool hasSpool()                             { return spool != NULL; }
+
+    /**
+     * Largest producer queue (messages waiting to be sent) of all producers
+     *
+     * \details The queue length is updated by each produce() and poll().
+     */
+    static int maxOutqLen();
+
+    /**
+     * Sum of the producer queues of all producers
+     */
+    static int totalOutqLen();
+
+    /**
+     * Lookup the router group - See KafkaTopicSelector::lookupRouterGroup()
+     */
+    void lookupRouterGroup(std::string hostname, std::string ip_addr, std::string &router_group_name);
+
+    /**
+     * Lookup the peer group - See KafkaTopicSelector::lookupPeerGroup()
+     */
+    void lookupPeerGroup(std::string hostname, std::string ip_addr, uint32_t peer_asn,
+                         std::string &peer_group_name);
+
+    /**
+     * Pool of working buffers returned by the delivery report callback
+     */
+    KafkaBufferPool *getBufferPool();
+
+    // Debug methods
+    void enableDebug();
+    void disableDebug();
+
+private:
+    Config                          *cfg;                   ///< Pointer to config instance
+    Logger                          *logger;                ///< Logging class pointer
+    bool                            debug;                  ///< debug flag to indicate debugging
+    std::string                     brokers;                ///< metadata.broker.list of the producer
+    int                             linger_ms;              ///< queue.buffering.max.ms of the producer
+
+    std::recursive_mutex            mutex;                  ///< Serializes connect/disconnect and topic lookups, not
+                                                            ///< held by the librdkafka produce and poll calls
+
+    RdKafka::Conf                   *conf;                  ///< Kafka Configuration object (global)
+    RdKafka::Producer               *producer;              ///< Kafka Producer instance
+    KafkaTopicSelector              *topicSel;              ///< Kafka topic selector/handler
+
+    KafkaEventCallback              *event_callback;        ///< Event callback handler
+    KafkaDeliveryReportCallback     *delivery_callback;     ///< Delivery report callback handler
+
+    KafkaBufferPool                 *buf_pool;              ///< Working buffers handed to librdkafka
+
+    bool                            connected;              ///< Indicates if Kafka is connected or not
+    uint64_t                        topic_gen;              ///< Topic generation, incremented when the topics are freed
+    std::atomic<int>                outq;                   ///< Producer queue length at the last produce/poll
+    std::atomic<int>                active;                 ///< produce/poll calls using the producer outside the lock
+
+    KafkaSpool                      *spool;                 ///< Spool of the cluster, NULL if not spooled
+    std::atomic<bool>               connecting;             ///< True while connect() is connecting
+
+    /**
+     * Spool a message, see produce()
+     *
+     * \param [in] if_pending       True to only spool if the spool has messages to replay
+     *
+     * \return true if the spool took the message, the payload is released
+     */
+    bool spoolMessage(const char *topic_var, const std::string *router_group, const std::string *peer_group,
+                      uint32_t peer_asn, int msgflags, void *payload, size_t len, const std::string *key,
+                      void *msg_opaque, bool if_pending);
+
+    static std::mutex               all_mutex;              ///< Guards all_producers
+    static std::set<KafkaProducer *> all_producers;         ///< All producers, used by maxOutqLen()
+};
+
+#endif //OPENBMP_KAFKAPRODUCER_H
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <thread>
+
+#include "KafkaProducerPool.h"
+#include "CpuPlacement.h"
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr   Pointer to Logger instance
+ * \param [in] cfg      Pointer to the config instance
+ * \param [in] size     Number of producers in the pool, < 0 is one per CPU core
+ * \param [in] brokers  Broker list of the producers, empty is cfg->kafka_brokers
+ */
+KafkaProducerPool::KafkaProducerPool(Logger *logPtr, Config *cfg, int size, const std::string &brokers) {
+    logger = logPtr;
+    this->cfg = cfg;
+    this->brokers = brokers;
+    debug = cfg->debug_msgbus;
+
+    if (size < 0)
+        size = std::thread::hardware_concurrency();
+
+    if (size < 1)
+        size = 1;
+
+    producers.assign(size, NULL);
+    refs.assign(size, 0);
+    nodes.assign(size, -1);
+
+    LOG_INFO("Using a pool of %d shared kafka producers", size);
+}
+
+/**
+ * Destructor, disconnects and frees all producers
+ */
+KafkaProducerPool::~KafkaProducerPool() {
+    for (size_t i = 0; i < producers.size(); i++) {
+        if (producers[i] != NULL)
+            delete producers[i];
+    }
+
+    producers.clear();
+    refs.clear();
+}
+
+/**
+ * Get the least used producer from the pool
+ *
+ * \details When the router threads are placed (see CpuPlacement), the producers created on
+ *          the node of the calling thread and the producers not created yet are preferred.
+ *          A producer is created by the calling thread, so its librdkafka threads and memory
+ *          are on the node of the router.
+ *
+ * \return Pointer to the producer, must be returned with release()
+ */
+KafkaProducer *KafkaProducerPool::acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    int node = CpuPlacement::currentNode();
+
+    // Producers of other nodes are only used if the node has none
+    bool local = false;
+    for (size_t i = 0; node >= 0 and i < producers.size(); i++) {
+        if (producers[i] == NULL or nodes[i] == node)
+            local = true;
+    }
+
+    size_t idx = producers.size();
+    for (size_t i = 0; i < refs.size(); i++) {
+        if (local and producers[i] != NULL and nodes[i] != node)
+            continue;
+
+        if (idx == producers.size() or refs[i] < refs[idx])
+            idx = i;
+    }
+
+    if (producers[idx] == NULL) {
+        // The librdkafka threads are shared by the routers of the node, not pinned to the core of this router
+        CpuPlacement::NodeScope scope;
+
+        producers[idx] = new KafkaProducer(logger, cfg, brokers);
+        nodes[idx] = node;
+    }
+
+    refs[idx]++;
+
+    SELF_DEBUG("Acquired kafka producer %lu, refs=%d", idx, refs[idx]);
+
+    return producers[idx];
+}
+
+/**
+ * Return a producer obtained by acquire()
+ *
+ * \details The producer stays connected for the next router.
+ *
+ * \param [in] producer     Producer to release
+ */
+void KafkaProducerPool::release(KafkaProducer *producer) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (size_t i = 0; i < producers.size(); i++) {
+        if (producers[i] == producer) {
+            if (refs[i] > 0)
+                refs[i]--;
+
+            SELF_DEBUG("Released kafka producer %lu, refs=%d", i, refs[i]);
+            break;
+        }
+    }
+}
+
+/**
+ * Number of producers in the pool
+ */
+size_t KafkaProducerPool::size() {
+    return producers.size();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OPENBMP_KAFKAPRODUCERPOOL_H
+#define OPENBMP_KAFKAPRODUCERPOOL_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "Logger.h"
+#include "KafkaProducer.h"
+
+/**
+ * \class   KafkaProducerPool
+ *
+ * \brief   Pool of kafka producers shared by the router threads
+ * \details Instead of a producer (broker connections, queues and librdkafka threads)
+ *          per router, routers are assigned to one of a fixed number of producers.
+ *          Producers are created on first use and assigned to the router with the
+ *          fewest references, of the NUMA node of the router if placed.
+ */
+class KafkaProducerPool {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr   Pointer to Logger instance
+     * \param [in] cfg      Pointer to the config instance
+     * \param [in] size     Number of producers in the pool, < 0 is one per CPU core
+     * \param [in] brokers  Broker list of the producers, empty is cfg->kafka_brokers
+     */
+    KafkaProducerPool(Logger *logPtr, Config *cfg, int size, const std::string &brokers = "");
+
+    /**
+     * Destructor, disconnects and frees all producers
+     */
+    ~KafkaProducerPool();
+
+    /**
+     * Get the least used producer from the pool
+     *
+     * \return Pointer to the producer, must be returned with release()
+     */
+    KafkaProducer *acquire();
+
+    /**
+     * Return a producer obtained by acquire()
+     *
+     * \param [in] producer     Producer to release
+     */
+    void release(KafkaProducer *producer);
+
+    /**
+     * Number of producers in the pool
+     */
+    size_t size();
+
+private:
+    Config                      *cfg;                   ///< Pointer to config instance
+    Logger                      *logger;                ///< Logging class pointer
+    bool                        debug;                  ///< debug flag to indicate debugging
+    std::string                 brokers;                ///< Broker list of the producers, empty is the default
+
+    std::mutex                  mutex;                  ///< Protects producers and refs
+
+    std::vector<KafkaProducer *> producers;             ///< Producers, NULL until first used
+    std::vector<int>             refs;                  ///< Number of routers using each producer
+    std::vector<int>             nodes;                 ///< Placement node each producer was created on, -1 if not placed
+};
+
+#endif //OPENBMP_KAFKAPRODUCERPOOL_H
@@ -0,0 +1,585 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "KafkaSpool.h"
+#include "KafkaProducer.h"
+#include "HashEngine.h"
+#include "MsgBusInterface.hpp"
+
+std::mutex                  KafkaSpool::all_mutex;
+std::vector<KafkaSpool *>   KafkaSpool::spools;
+
+/**
+ * Create the spool of a cluster and start its replay thread
+ *
+ * \param [in] logPtr   Pointer to Logger instance
+ * \param [in] cfg      Pointer to the config instance
+ * \param [in] brokers  Broker list of the cluster, empty is cfg->kafka_brokers
+ *
+ * \throw (const char *) if the spool directory can't be created
+ */
+void KafkaSpool::open(Logger *logPtr, Config *cfg, const std::string &brokers) {
+    const std::string &list = brokers.size() > 0 ? brokers : cfg->kafka_brokers;
+
+    if (find(list) != NULL)
+        return;
+
+    // Created before it's registered, so the replay producer isn't attached to it
+    KafkaSpool *spool = new KafkaSpool(logPtr, cfg, list);
+
+    std::lock_guard<std::mutex> lock(all_mutex);
+    spools.push_back(spool);
+}
+
+/**
+ * Stop the replay threads and close all spools, the segments are kept
+ */
+void KafkaSpool::closeAll() {
+    std::vector<KafkaSpool *> list;
+
+    {
+        std::lock_guard<std::mutex> lock(all_mutex);
+        list.swap(spools);
+    }
+
+    for (size_t i = 0; i < list.size(); i++)
+        delete list[i];
+}
+
+/**
+ * Find the spool of a cluster
+ *
+ * \param [in] brokers  Broker list of the cluster
+ *
+ * \return Spool, or NULL if the cluster is not spooled
+ */
+KafkaSpool *KafkaSpool::find(const std::string &brokers) {
+    std::lock_guard<std::mutex> lock(all_mutex);
+
+    for (size_t i = 0; i < spools.size(); i++) {
+        if (spools[i]->brokers == brokers)
+            return spools[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * Total size in bytes of the segments of all spools
+ */
+uint64_t KafkaSpool::totalBytes() {
+    std::lock_guard<std::mutex> lock(all_mutex);
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < spools.size(); i++) {
+        std::lock_guard<std::mutex> spool_lock(spools[i]->mutex);
+        total += spools[i]->bytes;
+    }
+
+    return total;
+}
+
+/**
+ * Total messages dropped because a spool was full
+ */
+uint64_t KafkaSpool::totalDropped() {
+    std::lock_guard<std::mutex> lock(all_mutex);
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < spools.size(); i++) {
+        std::lock_guard<std::mutex> spool_lock(spools[i]->mutex);
+        total += spools[i]->dropped;
+    }
+
+    return total;
+}
+
+/**
+ * Constructor for class, the segments in the spool directory are loaded
+ *
+ * \param [in] logPtr   Pointer to Logger instance
+ * \param [in] cfg      Pointer to the config instance
+ * \param [in] brokers  Broker list of the cluster
+ *
+ * \throw (const char *) if the spool directory can't be created
+ */
+KafkaSpool::KafkaSpool(Logger *logPtr, Config *cfg, const std::string &brokers) {
+    logger = logPtr;
+    debug = cfg->debug_msgbus;
+    this->brokers = brokers;
+    segment_size = (size_t)cfg->kafka_spool_segment_size * 1024 * 1024;
+    max_bytes = (uint64_t)cfg->kafka_spool_max_size * 1024 * 1024;
+
+    next_seq = 1;
+    bytes = 0;
+    dropped = 0;
+    spooled = 0;
+    pending = false;
+    running = true;
+
+    // Each cluster has its own directory, named by the hash of the broker list
+    u_char      digest[HASH_ENGINE_DIGEST_SIZE];
+    std::string name;
+    HashEngine  hash;
+
+    hash.update(brokers.data(), brokers.size());
+    hash.finalize();
+    hash.digest(digest);
+    MsgBusInterface::hash_toStr(digest, name);
+
+    dir = cfg->kafka_spool_dir + "/" + name;
+
+    if ((mkdir(cfg->kafka_spool_dir.c_str(), 0750) != 0 and errno != EEXIST) or
+            (mkdir(dir.c_str(), 0750) != 0 and errno != EEXIST)) {
+        LOG_ERR("Failed to create kafka spool directory %s: %s", dir.c_str(), strerror(errno));
+        throw "ERROR: Failed to create the kafka spool directory";
+    }
+
+    load();
+
+    replay = new KafkaProducer(logger, cfg, brokers);
+
+    LOG_INFO("Kafka spool of %s is %s, %lu bytes to replay", brokers.c_str(), dir.c_str(),
+             (unsigned long)bytes);
+
+    thr = new std::thread(&KafkaSpool::run, this);
+}
+
+/**
+ * Destructor, stops the replay thread and unmaps the segments
+ */
+KafkaSpool::~KafkaSpool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+
+    cond.notify_all();
+
+    thr->join();
+    delete thr;
+
+    delete replay;
+
+    // Segments are replayed on the next start, drained ones were already removed
+    for (size_t i = 0; i < segments.size(); i++)
+        closeSegment(segments[i], false);
+
+    segments.clear();
+}
+
+/**
+ * Load the segments of a previous run
+ */
+void KafkaSpool::load() {
+    std::vector<uint64_t> seqs;
+    DIR *d = opendir(dir.c_str());
+
+    if (d == NULL)
+        return;
+
+    for (struct dirent *ent = readdir(d); ent != NULL; ent = readdir(d)) {
+        char *end;
+        uint64_t seq = strtoull(ent->d_name, &end, 10);
+
+        if (seq > 0 and strcmp(end, ".seg") == 0)
+            seqs.push_back(seq);
+    }
+
+    closedir(d);
+
+    std::sort(seqs.begin(), seqs.end());
+
+    for (size_t i = 0; i < seqs.size(); i++) {
+        char file[32];
+        snprintf(file, sizeof(file), "%020llu.seg", (unsigned long long)seqs[i]);
+
+        Segment *seg = new Segment;
+        seg->seq = seqs[i];
+        seg->path = dir + "/" + file;
+        seg->base = NULL;
+
+        struct stat st;
+        int fd = ::open(seg->path.c_str(), O_RDWR);
+
+        if (fd >= 0 and fstat(fd, &st) == 0 and (size_t)st.st_size > sizeof(SegHeader))
+            seg->base = (char *)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (fd >= 0)
+            close(fd);
+
+        if (seg->base == NULL or seg->base == MAP_FAILED or
+                ((SegHeader *)seg->base)->magic != KAFKA_SPOOL_SEG_MAGIC or
+                ((SegHeader *)seg->base)->version != KAFKA_SPOOL_VERSION) {
+            LOG_WARN("Kafka spool segment %s is not valid, it's skipped", seg->path.c_str());
+
+            if (seg->base != NULL and seg->base != MAP_FAILED)
+                munmap(seg->base, st.st_size);
+
+            delete seg;
+            continue;
+        }
+
+        seg->size = st.st_size;
+        seg->read_off = ((SegHeader *)seg->base)->read_off;
+
+        // Records end at the first one that wasn't completely written
+        size_t off = sizeof(SegHeader);
+        while (off + sizeof(RecHeader) <= seg->size) {
+            RecHeader *rec = (RecHeader *)(seg->base + off);
+
+            if (rec->magic != KAFKA_SPOOL_REC_MAGIC or rec->size < sizeof(RecHeader) or
+                    off + rec->size > seg->size)
+                break;
+
+            off += rec->size;
+        }
+
+        seg->write_off = off;
+
+        if (seg->read_off < sizeof(SegHeader) or seg->read_off > seg->write_off)
+            seg->read_off = sizeof(SegHeader);
+
+        segments.push_back(seg);
+        bytes += seg->size;
+        next_seq = seg->seq + 1;
+
+        if (seg->read_off < seg->write_off)
+            pending = true;
+    }
+}
+
+/**
+ * Create a segment file for at least need bytes of records, mutex must be locked
+ *
+ * \param [in] need     Size of the record to append
+ *
+ * \return Segment, or NULL if it can't be created
+ */
+KafkaSpool::Segment *KafkaSpool::addSegment(size_t need) {
+    size_t size = std::max(segment_size, sizeof(SegHeader) + need);
+
+    if (bytes + size > max_bytes)
+        return NULL;
+
+    char file[32];
+    snprintf(file, sizeof(file), "%020llu.seg", (unsigned long long)next_seq);
+
+    Segment *seg = new Segment;
+    seg->seq = next_seq;
+    seg->path = dir + "/" + file;
+
+    int fd = ::open(seg->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0640);
+    if (fd < 0 or ftruncate(fd, size) != 0 or
+            (seg->base = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        LOG_ERR("Failed to create kafka spool segment %s: %s", seg->path.c_str(), strerror(errno));
+
+        if (fd >= 0) {
+            close(fd);
+            unlink(seg->path.c_str());
+        }
+
+        delete seg;
+        return NULL;
+    }
+
+    close(fd);
+
+    SegHeader *hdr = (SegHeader *)seg->base;
+    hdr->magic = KAFKA_SPOOL_SEG_MAGIC;
+    hdr->version = KAFKA_SPOOL_VERSION;
+    hdr->read_off = sizeof(SegHeader);
+
+    seg->size = size;
+    seg->write_off = sizeof(SegHeader);
+    seg->read_off = sizeof(SegHeader);
+
+    // The previous segment is complete, start writing it back
+    if (segments.size() > 0)
+        msync(segments.back()->base, segments.back()->size, MS_ASYNC);
+
+    segments.push_back(seg);
+    bytes += size;
+    next_seq++;
+
+    return seg;
+}
+
+/**
+ * Unmap a segment, the file is removed if unlink is set
+ *
+ * \param [in] seg      Segment to close, freed
+ * \param [in] unlink   True to remove the file
+ */
+void KafkaSpool::closeSegment(Segment *seg, bool unlink) {
+    if (unlink)
+        ::unlink(seg->path.c_str());
+    else
+        msync(seg->base, seg->size, MS_SYNC);
+
+    munmap(seg->base, seg->size);
+    delete seg;
+}
+
+/**
+ * Add a producer that is reconnected by the replay thread
+ */
+void KafkaSpool::attach(KafkaProducer *producer) {
+    std::lock_guard<std::mutex> lock(attach_mutex);
+    attached.insert(producer);
+}
+
+/**
+ * Remove a producer added by attach(), waits for a reconnect in progress
+ */
+void KafkaSpool::detach(KafkaProducer *producer) {
+    std::lock_guard<std::mutex> lock(attach_mutex);
+    attached.erase(producer);
+}
+
+/**
+ * Append a message
+ *
+ * \param [in] topic_var        Topic var MSGBUS_TOPIC_VAR_*
+ * \param [in] router_group     Router group name - NULL if not set or used
+ * \param [in] peer_group       Peer group name - NULL if not set or used
+ * \param [in] peer_asn         Peer ASN
+ * \param [in] payload          Message payload
+ * \param [in] len              Length of the payload in bytes
+ * \param [in] key              Message key
+ * \param [in] if_pending       True to only append if the spool has messages to replay
+ *
+ * \return true if the message was taken (spooled, or dropped because the spool is full),
+ *         false if if_pending is set and there is nothing to replay
+ */
+bool KafkaSpool::append(const char *topic_var, const std::string *router_group, const std::string *peer_group,
+                        uint32_t peer_asn, const void *payload, size_t len, const std::string *key,
+                        bool if_pending) {
+    size_t topic_len = strlen(topic_var);
+    size_t router_group_len = router_group != NULL ? router_group->size() : 0;
+    size_t peer_group_len = peer_group != NULL ? peer_group->size() : 0;
+    size_t key_len = key != NULL ? key->size() : 0;
+
+    size_t need = (sizeof(RecHeader) + topic_len + router_group_len + peer_group_len + key_len + len + 7) & ~(size_t)7;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (if_pending and not pending)
+        return false;
+
+    Segment *seg = segments.size() > 0 ? segments.back() : NULL;
+
+    if (seg == NULL or seg->write_off + need > seg->size)
+        seg = addSegment(need);
+
+    if (seg == NULL) {
+        if (dropped++ % 100000 == 0)
+            LOG_WARN("Kafka spool %s is full, %lu messages dropped", dir.c_str(), (unsigned long)dropped);
+
+        return true;
+    }
+
+    if (not pending)
+        LOG_INFO("Kafka is not taking messages, spooling to %s", dir.c_str());
+
+    RecHeader *rec = (RecHeader *)(seg->base + seg->write_off);
+    char *ptr = (char *)(rec + 1);
+
+    rec->size = need;
+    rec->payload_len = len;
+    rec->peer_asn = peer_asn;
+    rec->topic_len = topic_len;
+    rec->router_group_len = router_group_len;
+    rec->peer_group_len = peer_group_len;
+    rec->key_len = key_len;
+
+    memcpy(ptr, topic_var, topic_len);
+    ptr += topic_len;
+
+    if (router_group_len > 0)
+        memcpy(ptr, router_group->data(), router_group_len);
+    ptr += router_group_len;
+
+    if (peer_group_len > 0)
+        memcpy(ptr, peer_group->data(), peer_group_len);
+    ptr += peer_group_len;
+
+    if (key_len > 0)
+        memcpy(ptr, key->data(), key_len);
+    ptr += key_len;
+
+    memcpy(ptr, payload, len);
+
+    // Complete once the magic is set, a record cut short by a crash is not loaded
+    rec->magic = KAFKA_SPOOL_REC_MAGIC;
+
+    seg->write_off += need;
+    spooled++;
+
+    if (not pending) {
+        pending = true;
+        lock.unlock();
+        cond.notify_all();
+    }
+
+    return true;
+}
+
+/**
+ * Replay thread
+ */
+void KafkaSpool::run() {
+    std::chrono::steady_clock::time_point last_reconnect;
+
+    while (true) {
+        Segment *seg;
+        size_t   off, end;
+        bool     last;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (running and not pending) {
+                lock.unlock();
+                reconnect();
+                lock.lock();
+
+                if (running and not pending)
+                    cond.wait_for(lock, std::chrono::seconds(1));
+            }
+
+            if (not running)
+                return;
+
+            seg = segments.front();
+            off = seg->read_off;
+            end = seg->write_off;
+            last = segments.size() == 1;
+        }
+
+        if (off >= end) {
+            if (not last) {
+                // Segment is replayed and no longer written to
+                std::lock_guard<std::mutex> lock(mutex);
+                segments.pop_front();
+                bytes -= seg->size;
+                closeSegment(seg, true);
+                continue;
+            }
+
+            // Replayed everything appended so far, the producers can produce again once delivered
+            flush();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (seg->write_off == off and segments.size() == 1) {
+                LOG_INFO("Kafka spool %s drained, %lu messages replayed", dir.c_str(), (unsigned long)spooled);
+
+                segments.pop_front();
+                bytes -= seg->size;
+                closeSegment(seg, true);
+
+                pending = false;
+                spooled = 0;
+            }
+
+            continue;
+        }
+
+        if (not replay->isConnected()) {
+            replay->connect();
+
+            if (not replay->isConnected() and not sleep(1000))
+                return;
+
+            continue;
+        }
+
+        // The producers of the cluster are reconnected while replaying, so they're ready when drained
+        if (std::chrono::steady_clock::now() - last_reconnect > std::chrono::seconds(1)) {
+            reconnect();
+            last_reconnect = std::chrono::steady_clock::now();
+        }
+
+        // Records before write_off are not changed, they're produced without the lock
+        RecHeader *rec = (RecHeader *)(seg->base + off);
+        char *ptr = (char *)(rec + 1);
+
+        std::string topic_var(ptr, rec->topic_len);
+        ptr += rec->topic_len;
+        std::string router_group(ptr, rec->router_group_len);
+        ptr += rec->router_group_len;
+        std::string peer_group(ptr, rec->peer_group_len);
+        ptr += rec->peer_group_len;
+        std::string key(ptr, rec->key_len);
+        ptr += rec->key_len;
+
+        RdKafka::ErrorCode resp = replay->produce(topic_var.c_str(), &router_group, &peer_group, rec->peer_asn,
+                                                  RdKafka::Producer::RK_MSG_COPY, ptr, rec->payload_len,
+                                                  &key, NULL);
+
+        if (resp == RdKafka::ERR__QUEUE_FULL) {
+            replay->poll(100);
+            continue;
+
+        } else if (resp != RdKafka::ERR_NO_ERROR)
+            LOG_ERR("Failed to replay spooled message, it's dropped: topic=%s: %s", topic_var.c_str(),
+                    RdKafka::err2str(resp).c_str());
+
+        seg->read_off = off + rec->size;
+        ((SegHeader *)seg->base)->read_off = seg->read_off;
+
+        replay->poll(0);
+    }
+}
+
+/**
+ * Reconnect the attached producers that are not connected
+ */
+void KafkaSpool::reconnect() {
+    std::lock_guard<std::mutex> lock(attach_mutex);
+
+    for (std::set<KafkaProducer *>::iterator it = attached.begin(); it != attached.end(); ++it) {
+        if (not (*it)->isConnected())
+            (*it)->connect();
+    }
+}
+
+/**
+ * Wait for the replayed records to be delivered, so they are not overtaken by the producers
+ */
+void KafkaSpool::flush() {
+    for (int i = 0; i < 100 and replay->outqLen() > 0; i++)
+        replay->poll(100);
+}
+
+/**
+ * Sleep up to ms, returns early on stop
+ *
+ * \param [in] ms   Time to sleep in milliseconds
+ *
+ * \return false if stopped
+ */
+bool KafkaSpool::sleep(int ms) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    cond.wait_for(lock, std::chrono::milliseconds(ms), [this] { return not running; });
+
+    return running;
+}
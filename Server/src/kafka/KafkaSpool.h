@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OPENBMP_KAFKASPOOL_H
+#define OPENBMP_KAFKASPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Config.h"
+#include "Logger.h"
+
+class KafkaProducer;
+
+#define KAFKA_SPOOL_SEG_MAGIC       0x5053424f      ///< "OBSP", start of a segment file
+#define KAFKA_SPOOL_REC_MAGIC       0x4352424f      ///< "OBRC", start of a record
+#define KAFKA_SPOOL_VERSION         1               ///< Version of the segment format
+
+/**
+ * \class   KafkaSpool
+ *
+ * \brief   Disk spool of the messages of a kafka cluster while it can't take them
+ * \details Enabled by kafka spool.dir.  Producers of the cluster append their messages to
+ *          the spool instead of blocking the router threads when they are not connected or
+ *          the librdkafka queue is full.  Once a message is spooled, all messages of the
+ *          cluster are spooled until the spool is drained, so messages keep their order.
+ *
+ *          The spool is an append only log of memory mapped segment files.  A replay thread
+ *          produces the records in order with its own producer, once the cluster is back,
+ *          and removes the segments it has produced.  The replay thread also reconnects
+ *          the producers of the cluster in the background.
+ *
+ *          Segments are kept on shutdown and replayed on the next start.  The replay
+ *          position is saved in each segment, so records are produced at least once.
+ *
+ *          Segment file:
+ *
+ *              header  = uint32 magic, uint32 version, uint64 replay offset
+ *              record  = uint32 magic, uint32 size, uint32 payload length, uint32 peer ASN,
+ *                        uint16 topic var, router group, peer group and key lengths, followed
+ *                        by the topic var, groups, key and payload; padded to 8 bytes
+ *
+ *          Spools are created by MsgBusFactory, one per broker list, before the producers.
+ */
+class KafkaSpool {
+public:
+    /**
+     * Create the spool of a cluster and start its replay thread
+     *
+     * \details Segments left by a previous run are replayed.
+     *
+     * \param [in] logPtr   Pointer to Logger instance
+     * \param [in] cfg      Pointer to the config instance
+     * \param [in] brokers  Broker list of the cluster, empty is cfg->kafka_brokers
+     *
+     * \throw (const char *) if the spool directory can't be created
+     */
+    static void open(Logger *logPtr, Config *cfg, const std::string &brokers = "");
+
+    /**
+     * Stop the replay threads and close all spools, the segments are kept
+     */
+    static void closeAll();
+
+    /**
+     * Find the spool of a cluster
+     *
+     * \param [in] brokers  Broker list of the cluster
+     *
+     * \return Spool, or NULL if the cluster is not spooled
+     */
+    static KafkaSpool *find(const std::string &brokers);
+
+    /**
+     * Total size in bytes of the segments of all spools
+     */
+    static uint64_t totalBytes();
+
+    /**
+     * Total messages dropped because a spool was full
+     */
+    static uint64_t totalDropped();
+
+    /**
+     * Add a producer that is reconnected by the replay thread
+     */
+    void attach(KafkaProducer *producer);
+
+    /**
+     * Remove a producer added by attach(), waits for a reconnect in progress
+     */
+    void detach(KafkaProducer *producer);
+
+    /**
+     * Append a message
+     *
+     * \param [in] topic_var        Topic var MSGBUS_TOPIC_VAR_*
+     * \param [in] router_group     Router group name - NULL if not set or used
+     * \param [in] peer_group       Peer group name - NULL if not set or used
+     * \param [in] peer_asn         Peer ASN
+     * \param [in] payload          Message payload
+     * \param [in] len              Length of the payload in bytes
+     * \param [in] key              Message key
+     * \param [in] if_pending       True to only append if the spool has messages to replay
+     *
+     * \return true if the message was taken (spooled, or dropped because the spool is full),
+     *         false if if_pending is set and there is nothing to replay
+     */
+    bool append(const char *topic_var, const std::string *router_group, const std::string *peer_group,
+                uint32_t peer_asn, const void *payload, size_t len, const std::string *key,
+                bool if_pending);
+
+private:
+    /**
+     * Memory mapped segment file
+     */
+    struct Segment {
+        uint64_t    seq;                    ///< Sequence of the segment, the file name
+        std::string path;                   ///< Path of the file
+        char        *base;                  ///< Mapped file
+        size_t      size;                   ///< Size of the file
+        size_t      write_off;              ///< End of the records, guarded by mutex
+        size_t      read_off;               ///< Next record to replay, only used by the replay thread
+    };
+
+    /**
+     * Segment file header
+     */
+    struct SegHeader {
+        uint32_t    magic;                  ///< KAFKA_SPOOL_SEG_MAGIC
+        uint32_t    version;                ///< KAFKA_SPOOL_VERSION
+        uint64_t    read_off;               ///< Replay offset
+    };
+
+    /**
+     * Record header, followed by the strings and payload
+     */
+    struct RecHeader {
+        uint32_t    magic;                  ///< KAFKA_SPOOL_REC_MAGIC, written last
+        uint32_t    size;                   ///< Size of the record including the header and padding
+        uint32_t    payload_len;            ///< Length of the payload
+        uint32_t    peer_asn;               ///< Peer ASN
+        uint16_t    topic_len;              ///< Length of the topic var
+        uint16_t    router_group_len;       ///< Length of the router group
+        uint16_t    peer_group_len;         ///< Length of the peer group
+        uint16_t    key_len;                ///< Length of the key
+    };
+
+    Logger                      *logger;                ///< Logging class pointer
+    bool                        debug;                  ///< debug flag to indicate debugging
+    std::string                 brokers;                ///< Broker list of the cluster
+    std::string                 dir;                    ///< Directory of the segment files
+    size_t                      segment_size;           ///< Size of new segments
+    uint64_t                    max_bytes;              ///< Max size of all segments
+
+    std::mutex                  mutex;                  ///< Guards the segments and counters below
+    std::condition_variable     cond;                   ///< Signaled when a record is appended or on stop
+    std::deque<Segment *>       segments;               ///< Segments, oldest first
+    uint64_t                    next_seq;               ///< Sequence of the next segment
+    uint64_t                    bytes;                  ///< Size of all segments
+    uint64_t                    dropped;                ///< Messages dropped because the spool was full
+    uint64_t                    spooled;                ///< Messages appended since the spool was last empty
+    bool                        pending;                ///< True if there are records to replay
+    bool                        running;                ///< Indicates the replay thread should run
+
+    std::mutex                  attach_mutex;           ///< Guards attached, held while reconnecting
+    std::set<KafkaProducer *>   attached;               ///< Producers of the cluster
+
+    KafkaProducer               *replay;                ///< Producer of the replayed records
+    std::thread                 *thr;                   ///< Replay thread
+
+    static std::mutex                   all_mutex;      ///< Guards spools
+    static std::vector<KafkaSpool *>    spools;         ///< Spools of the clusters
+
+    /**
+     * Constructor for class, the segments in the spool directory are loaded
+     *
+     * \throw (const char *) if the spool directory can't be created
+     */
+    KafkaSpool(Logger *logPtr, Config *cfg, const std::string &brokers);
+
+    /**
+     * Destructor, stops the replay thread and unmaps the segments
+     */
+    ~KafkaSpool();
+
+    /**
+     * Load the segments of a previous run
+     */
+    void load();
+
+    /**
+     * Create a segment file for at least need bytes of records, mutex must be locked
+     *
+     * \return Segment, or NULL if it can't be created
+     */
+    Segment *addSegment(size_t need);
+
+    /**
+     * Unmap a segment, the file is removed if unlink is set
+     */
+    void closeSegment(Segment *seg, bool unlink);
+
+    /**
+     * Replay thread
+     */
+    void run();
+
+    /**
+     * Reconnect the attached producers that are not connected
+     */
+    void reconnect();
+
+    /**
+     * Wait for the replayed records to be delivered, so they are not overtaken by the producers
+     */
+    void flush();
+
+    /**
+     * Sleep up to ms, returns early on stop
+     *
+     * \return false if stopped
+     */
+    bool sleep(int ms);
+};
+
+#endif //OPENBMP_KAFKASPOOL_H
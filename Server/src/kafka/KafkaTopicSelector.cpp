@@ -32,8 +32,7 @@ KafkaTopicSelector::KafkaTopicSelector(Logger *logPtr, Config *cfg,  RdKafka::Pr
 
     this->producer = producer;
 
-    peer_partitioner_callback = new KafkaPeerPartitionerCallback();
-    tconf = RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC);
+    peer_partitioner_callback = new KafkaPeerPartitionerCallback(cfg->partitioner == "legacy");
 
 }
 
@@ -47,9 +46,6 @@ KafkaTopicSelector::~KafkaTopicSelector() {
 
     if (peer_partitioner_callback != NULL)
         delete peer_partitioner_callback;
-
-    delete tconf;
-
 }
 
 /*********************************************************************//**
@@ -97,105 +93,14 @@ RdKafka::Topic * KafkaTopicSelector::getTopic(const std::string &topic_var,
 void KafkaTopicSelector::lookupPeerGroup(std::string hostname, std::string ip_addr, uint32_t peer_asn,
                                          std::string &peer_group_name) {
 
-    peer_group_name = "";
-
-    /*
-     * Match against hostname regexp
-     */
-    if (hostname.size() > 0) {
-
-        // Loop through all groups and their regular expressions
-        for (Config::match_peer_group_by_name_iter it = cfg->match_peer_group_by_name.begin();
-            it != cfg->match_peer_group_by_name.end(); ++it) {
-
-            // loop through all regexps to see if there is a match
-            for (std::list<Config::match_type_regex>::iterator lit = it->second.begin();
-                    lit != it->second.end(); ++lit) {
-                if (regex_search(hostname, lit->regexp)) {
-                    SELF_DEBUG("Regexp matched hostname %s to peer group '%s'",
-                                hostname.c_str(), it->first.c_str());
-                    peer_group_name = it->first;
-                    return;
-                }
-            }
-        }
-    }
-
-    /*
-     * Match against prefix ranges
-     */
-    bool isIPv4 = ip_addr.find_first_of(':') == std::string::npos ? true : false;
-    uint8_t bits;
-
-    uint32_t prefix[4]  __attribute__ ((aligned));
-    bzero(prefix,sizeof(prefix));
-
-    inet_pton(isIPv4 ? AF_INET : AF_INET6, ip_addr.c_str(), prefix);
-
-    // Loop through all groups and their regular expressions
-    for (Config::match_peer_group_by_ip_iter it = cfg->match_peer_group_by_ip.begin();
-         it != cfg->match_peer_group_by_ip.end(); ++it) {
-
-        // loop through all prefix ranges to see if there is a match
-        for (std::list<Config::match_type_ip>::iterator lit = it->second.begin();
-             lit != it->second.end(); ++lit) {
-
-            if (lit->isIPv4 == isIPv4) { // IPv4
-                bits = 32 - lit->bits;
-
-                // Big endian
-                prefix[0] <<= bits;
-                prefix[0] >>= bits;
-
-                if (prefix[0] == lit->prefix[0]) {
-                    SELF_DEBUG("IP %s matched peer group %s", ip_addr.c_str(), it->first.c_str());
-                    peer_group_name = it->first;
-                    return;
-                }
-            } else { // IPv6
-                uint8_t end_idx = lit->bits / 32;
-                bits = lit->bits - (32 * end_idx);
-
-                if (bits == 0)
-                    end_idx--;
-
-                if (end_idx < 4 and bits < 32) {    // end_idx should be less than 4 and bits less than 32
-
-                    // Big endian
-                    prefix[end_idx] <<= bits;
-                    prefix[end_idx] >>= bits;
-                }
-
-                if (prefix[0] == lit->prefix[0] and prefix[1] == lit->prefix[1]
-                        and prefix[2] == lit->prefix[2] and prefix[3] == lit->prefix[3]) {
-
-                    SELF_DEBUG("IP %s matched peer group %s", ip_addr.c_str(), it->first.c_str());
-                    peer_group_name = it->first;
-                    return;
-                }
-            }
-        }
-    }
-
-    /*
-     * Match against asn list
-     */
-    // Loop through all groups and their regular expressions
-    for (Config::match_peer_group_by_asn_iter it = cfg->match_peer_group_by_asn.begin();
-         it != cfg->match_peer_group_by_asn.end(); ++it) {
-
-        // loop through all prefix ranges to see if there is a match
-        for (std::list<uint32_t>::iterator lit = it->second.begin();
-             lit != it->second.end(); ++lit) {
-
-            if (*lit == peer_asn) {
-                SELF_DEBUG("Peer ASN %u matched peer group %s", peer_asn, it->first.c_str());
-                peer_group_name = it->first;
-                return;
-            }
-        }
-    }
+    const std::string *group = cfg->peer_group_matcher.lookup(hostname, ip_addr, &peer_asn);
 
+    if (group != NULL) {
+        SELF_DEBUG("Peer %s/%s AS %u matched peer group '%s'", hostname.c_str(), ip_addr.c_str(),
+                   peer_asn, group->c_str());
+        peer_group_name = *group;
+    } else
+        peer_group_name = "";
 }
 
 /*********************************************************************//**
@@ -210,89 +115,16 @@ void KafkaTopicSelector::lookupPeerGroup(std::string hostname, std::string ip_ad
 void KafkaTopicSelector::lookupRouterGroup(std::string hostname, std::string ip_addr,
                                          std::string &router_group_name) {
 
-    router_group_name = "";
-
     SELF_DEBUG("router lookup for hostname=%s and ip_addr=%s", hostname.c_str(), ip_addr.c_str());
 
-    /*
-     * Match against hostname regexp
-     */
-    if (hostname.size() > 0) {
-
-        // Loop through all groups and their regular expressions
-        for (Config::match_router_group_by_name_iter it = cfg->match_router_group_by_name.begin();
-             it != cfg->match_router_group_by_name.end(); ++it) {
-
-            // loop through all regexps to see if there is a match
-            for (std::list<Config::match_type_regex>::iterator lit = it->second.begin();
-                 lit != it->second.end(); ++lit) {
-
-                if (regex_search(hostname, lit->regexp)) {
-                    SELF_DEBUG("Regexp matched hostname %s to router group '%s'",
-                               hostname.c_str(), it->first.c_str());
-                    router_group_name = it->first;
-                    return;
-                }
-            }
-        }
-    }
+    const std::string *group = cfg->router_group_matcher.lookup(hostname, ip_addr);
 
-    /*
-     * Match against prefix ranges
-     */
-    bool isIPv4 = ip_addr.find_first_of(':') == std::string::npos ? true : false;
-    uint8_t bits;
-
-    uint32_t prefix[4]  __attribute__ ((aligned));
-    bzero(prefix,sizeof(prefix));
-
-    inet_pton(isIPv4 ? AF_INET : AF_INET6, ip_addr.c_str(), prefix);
-
-    // Loop through all groups and their regular expressions
-    for (Config::match_router_group_by_ip_iter it = cfg->match_router_group_by_ip.begin();
-         it != cfg->match_router_group_by_ip.end(); ++it) {
-
-        // loop through all prefix ranges to see if there is a match
-        for (std::list<Config::match_type_ip>::iterator lit = it->second.begin();
-             lit != it->second.end(); ++lit) {
-
-            if (lit->isIPv4 == isIPv4) { // IPv4
-
-                bits = 32 - lit->bits;
-
-                // Big endian
-                prefix[0] <<= bits;
-                prefix[0] >>= bits;
-
-                if (prefix[0] == lit->prefix[0]) {
-                    SELF_DEBUG("IP %s matched router group %s", ip_addr.c_str(), it->first.c_str());
-                    router_group_name = it->first;
-                    return;
-                }
-            } else { // IPv6
-                uint8_t end_idx = lit->bits / 32;
-                bits = lit->bits - (32 * end_idx);
-
-                if (bits == 0)
-                    end_idx--;
-
-                if (end_idx < 4 and bits < 32) {    // end_idx should be less than 4 and bits less than 32
-
-                    // Big endian
-                    prefix[end_idx] <<= bits;
-                    prefix[end_idx] >>= bits;
-                }
-
-                if (prefix[0] == lit->prefix[0] and prefix[1] == lit->prefix[1]
-                    and prefix[2] == lit->prefix[2] and prefix[3] == lit->prefix[3]) {
-
-                    SELF_DEBUG("IP %s matched router group %s", ip_addr.c_str(), it->first.c_str());
-                    router_group_name = it->first;
-                    return;
-                }
-            }
-        }
-    }
+    if (group != NULL) {
+        SELF_DEBUG("Router %s/%s matched router group '%s'", hostname.c_str(), ip_addr.c_str(),
+                   group->c_str());
+        router_group_name = *group;
+    } else
+        router_group_name = "";
 }
 
 
@@ -363,14 +195,12 @@ RdKafka::Topic * KafkaTopicSelector::initTopic(const std::string &topic_var,
     }
 
     /*
-     * Topic configuration
+     * Topic configuration, librdkafka copies it when the topic is created
      */
-    if (tconf->set("partitioner_cb", peer_partitioner_callback, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure kafka partitioner callback: %s", errstr.c_str());
-        throw "ERROR: Failed to configure kafka partitioner callback";
-    }
+    RdKafka::Conf *tconf = createTopicConf(topic_var);
 
     topic[topic_key] = RdKafka::Topic::create(producer, topic_name.c_str(), tconf, errstr);
+    delete tconf;
 
     if (topic[topic_key] == NULL) {
         LOG_ERR("Failed to create '%s' topic: %s", topic_name.c_str(), errstr.c_str());
@@ -383,6 +213,44 @@ RdKafka::Topic * KafkaTopicSelector::initTopic(const std::string &topic_var,
     return NULL;
 }
 
+/**
+ * Create the topic level configuration of a topic
+ *
+ * \details The topic profile (kafka.topics.profiles) of the topic var is applied
+ *          over the producer defaults.
+ *
+ * \param [in]  topic_var       MSGBUS_TOPIC_VAR_<name>
+ *
+ * \return (RdKafka::Conf *) allocated configuration, caller must delete it
+ */
+RdKafka::Conf * KafkaTopicSelector::createTopicConf(const std::string &topic_var) {
+    std::string errstr;
+    RdKafka::Conf *tconf = RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC);
+
+    if (tconf->set("partitioner_cb", peer_partitioner_callback, errstr) != RdKafka::Conf::CONF_OK) {
+        LOG_ERR("Failed to configure kafka partitioner callback: %s", errstr.c_str());
+        delete tconf;
+        throw "ERROR: Failed to configure kafka partitioner callback";
+    }
+
+    Config::topic_profile_map_iter it = cfg->topic_profile_map.find(topic_var);
+    if (it == cfg->topic_profile_map.end())
+        return tconf;
+
+    for (std::map<std::string, std::string>::iterator p_it = it->second.begin(); p_it != it->second.end(); ++p_it) {
+        if (tconf->set(p_it->first, p_it->second, errstr) != RdKafka::Conf::CONF_OK) {
+            LOG_ERR("Failed to configure %s=%s for topic %s: %s", p_it->first.c_str(), p_it->second.c_str(),
+                    topic_var.c_str(), errstr.c_str());
+            delete tconf;
+            throw "ERROR: Failed to configure kafka topic profile";
+        }
+
+        SELF_DEBUG("Topic %s profile: %s = %s", topic_var.c_str(), p_it->first.c_str(), p_it->second.c_str());
+    }
+
+    return tconf;
+}
+
 /**
  * Get the topic map key name
  *
@@ -112,7 +112,6 @@ private:
 
 
     RdKafka::Producer *producer;                ///< Kafka Producer instance
-    RdKafka::Conf     *tconf;                   ///< rdkafka topic level configuration
 
     ///< Partition callback for peer
     KafkaPeerPartitionerCallback *peer_partitioner_callback;
@@ -176,6 +175,18 @@ private:
                             const std::string *router_group, const std::string *peer_group,
                             uint32_t peer_asn);
 
+    /**
+     * Create the topic level configuration of a topic
+     *
+     * \details The topic profile (kafka.topics.profiles) of the topic var is applied
+     *          over the producer defaults.
+     *
+     * \param [in]  topic_var       MSGBUS_TOPIC_VAR_<name>
+     *
+     * \return (RdKafka::Conf *) allocated configuration, caller must delete it
+     */
+    RdKafka::Conf * createTopicConf(const std::string &topic_var);
+
 
 };
 
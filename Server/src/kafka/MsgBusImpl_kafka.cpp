@@ -6,8 +6,10 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  *
  */
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <iostream>
 
 #include <cinttypes>
@@ -20,16 +22,17 @@
 #include <arpa/inet.h>
 
 #include "MsgBusImpl_kafka.h"
-#include "KafkaEventCallback.h"
-#include "KafkaDeliveryReportCallback.h"
-#include "KafkaTopicSelector.h"
 
-#include <boost/algorithm/string/replace.hpp>
 
 #include <librdkafka/rdkafka.h>
 
 
-#include "md5.h"
+#include "HashEngine.h"
+#include "PrefixKernel.h"
+#include "VpnKernel.h"
+#include "MsgBusRowSchema.hpp"
+#include "HostResolver.h"
+#include "MonotonicClock.h"
 
 using namespace std;
 
@@ -41,19 +44,30 @@ using namespace std;
  *  \param [in] logPtr      Pointer to Logger instance
  *  \param [in] cfg         Pointer to the config instance
  *  \param [in] c_hash_id   Collector Hash ID
+ *  \param [in] pool        Shared producer pool, NULL to use a dedicated producer
+ *  \param [in] priority    Shared producer of the collector, router and peer messages,
+ *                          NULL to use the same producer as the other messages
  ********************************************************************/
-msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
+msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id, KafkaProducerPool *pool,
+                           KafkaProducer *priority) {
     logger = logPtr;
+    priority_kafka = priority;
 
-    producer_buf = new unsigned char[MSGBUS_WORKING_BUF_SIZE];
-    prep_buf = new char[MSGBUS_WORKING_BUF_SIZE];
+    // Sequences and keys are per instance, only the producer connection is shared
+    producer_pool = pool;
+    if (producer_pool != NULL)
+        kafka = producer_pool->acquire();
+    else
+        kafka = new KafkaProducer(logPtr, cfg);
 
-    hash_toStr(c_hash_id, collector_hash);
+    // Working buffers are handed to librdkafka for large messages, they are returned to the producer pool
+    prep_block = kafka->getBufferPool()->get();
+    prep_buf = prep_block + MSGBUS_HDR_RESERVE;
 
-    isConnected = false;
-    conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
+    hash_toStr(c_hash_id, collector_hash);
 
-    disableDebug();
+    inBatch = false;
+    debug = false;
 
     // TODO: Init the topic selector class
 
@@ -70,17 +84,38 @@ msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
     bmp_stat_seq        = 0L;
 
     this->cfg           = cfg;
-
-    // Make the connection to the server
-    event_callback       = NULL;
-    delivery_callback    = NULL;
-    producer             = NULL;
-    topicSel             = NULL;
+    use_router_key      = cfg->partition_key == "router";
+
+    Config::topic_names_map_iter raw_it = cfg->topic_names_map.find(MSGBUS_TOPIC_VAR_BMP_RAW);
+    raw_by_peer_asn = raw_it != cfg->topic_names_map.end() and raw_it->second.find("{peer_asn}") != string::npos;
+
+    last_peer           = NULL;
+    router_outputs      = cfg->getOutputs("", "");
+
+    // Coalesced messages with their header must fit in a working buffer and in a kafka message
+    coalesce_max_bytes  = cfg->kafka_coalesce_max_bytes;
+    coalesce_max_bytes  = min(coalesce_max_bytes, (size_t)MSGBUS_WORKING_BUF_SIZE);
+    if (cfg->tx_max_bytes > MSGBUS_HDR_RESERVE)
+        coalesce_max_bytes = min(coalesce_max_bytes, (size_t)cfg->tx_max_bytes - MSGBUS_HDR_RESERVE);
+    coalesce_max_ms     = cfg->kafka_coalesce_max_ms;
+    coalesce_since      = 0;
+    zero_copy_min_bytes = cfg->kafka_zero_copy_min_bytes;
+    rd_rfc4364          = cfg->rd_format == "rfc4364";
+
+    // Row encoding per topic var, topics not listed are TSV
+    for (Config::topic_format_map_iter it = cfg->topic_format_map.begin(); it != cfg->topic_format_map.end(); ++it) {
+        if (it->second == "binary")
+            topic_format[it->first] = MsgBusWriter::FORMAT_BINARY;
+    }
 
     router_ip.assign("");
     bzero(router_hash, sizeof(router_hash));
 
-    connect();
+    // Make the connection to the server, a shared producer may already be connected
+    kafka->connect();
+
+    if (priority_kafka != NULL)
+        priority_kafka->connect();
 }
 
 /**
@@ -90,6 +125,8 @@ msgBus_kafka::~msgBus_kafka() {
 
     SELF_DEBUG("Destory msgBus Kafka instance");
 
+    flushCoalesced();
+
     // Disconnect/term the router if not already done
     MsgBusInterface::obj_router r_object;
     bool router_defined = false;
@@ -113,298 +150,373 @@ msgBus_kafka::~msgBus_kafka() {
 
     sleep(2);
 
-    delete [] producer_buf;
-    delete [] prep_buf;
-
     peer_list.clear();
+    last_peer = NULL;
 
-    disconnect(500);
+    for (size_t i = 0; i < coalesce_free.size(); i++)
+        delete coalesce_free[i];
+    coalesce_free.clear();
 
-    delete conf;
+    kafka->poll(0);
+    kafka->getBufferPool()->release(prep_block);
+
+    // Shared producers stay connected for the other routers
+    if (producer_pool != NULL)
+        producer_pool->release(kafka);
+    else
+        delete kafka;
 }
 
 /**
- * Disconnect from Kafka
+ * Connects to Kafka broker, waits until connected
+ *
+ * \details Doesn't wait if the producer is spooled, see KafkaSpool.
+ *
+ * \param [in] producer     Producer to connect, NULL is kafka
  */
-void msgBus_kafka::disconnect(int wait_ms) {
-
-    if (isConnected) {
-        int i = 0;
-        while (producer->outq_len() > 0 and i < 8) {
-            LOG_INFO("Waiting for producer to finish before disconnecting: outq=%d", producer->outq_len());
-            producer->poll(500);
-            i++;
-        }
-    }
+void msgBus_kafka::connect(KafkaProducer *producer) {
+    if (producer == NULL)
+        producer = kafka;
 
-    if (topicSel != NULL) delete topicSel;
-
-    topicSel = NULL;
+    // Spooled producers are reconnected by the spool, messages are spooled meanwhile
+    if (producer->hasSpool())
+        return;
 
-    if (producer != NULL) delete producer;
-    producer = NULL;
+    while (not producer->isConnected()) {
+        // Do not attempt to reconnect if this is the main process (router ip is null)
+        // Changed on 10/29/15 to support docker startup delay with kafka
+        /*
+        if (router_ip.size() <= 0) {
+            return;
+        }*/
 
-    // suggested by librdkafka to free memory
-    RdKafka::wait_destroyed(wait_ms);
+        LOG_WARN("rtr=%s: Not connected to Kafka, attempting to reconnect", router_ip.c_str());
+        producer->connect();
 
-    if (event_callback != NULL) delete event_callback;
-    event_callback = NULL;
+        if (not producer->isConnected())
+            sleep(1);
+    }
+}
 
-    if (delivery_callback != NULL) delete delivery_callback;
-    delivery_callback = NULL;
+/**
+ * Row encoding of a topic
+ *
+ * \param [in] topic_var     Topic var MSGBUS_TOPIC_VAR_*
+ *
+ * \return Format configured for the topic, TSV if not configured
+ */
+MsgBusWriter::Format msgBus_kafka::getFormat(const char *topic_var) {
+    topic_format_iter it = topic_format.find(topic_var);
 
-    isConnected = false;
+    return it != topic_format.end() ? it->second : MsgBusWriter::FORMAT_TSV;
 }
 
 /**
- * Connects to Kafka broker
+ * Get the cached state of a peer
+ *
+ * \details The last peer is remembered, so consecutive messages of the same peer
+ *          don't lookup peer_list.  The entry is added if it's not in peer_list.
+ *
+ * \param [in] hash_id       Peer hash ID (binary)
+ * \param [in] p_hash_str    Peer hash ID in printed format, the peer_list key
+ *
+ * \return pointer to the peer_list entry, valid until the peer is erased
  */
-void msgBus_kafka::connect() {
-    string errstr;
-    string value;
-    std::ostringstream rx_bytes, tx_bytes, sess_timeout, socket_timeout;
-    std::ostringstream q_buf_max_msgs, q_buf_max_ms, 
-		msg_send_max_retry, retry_backoff_ms;
-
-    disconnect();
-
-    /*
-     * Configure Kafka Producer (https://kafka.apache.org/08/configuration.html)
-     */
-    //TODO: Add config options to change these settings
-
-    // Disable logging of connection close/idle timeouts caused by Kafka 0.9.x (connections.max.idle.ms)
-    //    See https://github.com/edenhill/librdkafka/issues/437 for more details.
-    // TODO: change this when librdkafka has better handling of the idle disconnects
-    value = "false";
-    if (conf->set("log.connection.close", value, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure log.connection.close=false: %s.", errstr.c_str());
-    }
+msgBus_kafka::peer_cache *msgBus_kafka::getPeer(const u_char *hash_id, const string &p_hash_str) {
+    if (last_peer != NULL and memcmp(last_peer_hash, hash_id, sizeof(last_peer_hash)) == 0)
+        return last_peer;
 
-    value = "true";
-    if (conf->set("api.version.request", value, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure api.version.request=true: %s.", errstr.c_str());
-    }
+    last_peer = &peer_list[p_hash_str];
+    memcpy(last_peer_hash, hash_id, sizeof(last_peer_hash));
 
-    // TODO: Add config for address family - default is any
-    /*value = "v4";
-    if (conf->set("broker.address.family", value, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure broker.address.family: %s.", errstr.c_str());
-    }*/
+    if (last_peer->hash_str.empty())
+        last_peer->hash_str = p_hash_str;
 
+    return last_peer;
+}
 
-    // Batch message number
-    value = "100";
-    if (conf->set("batch.num.messages", value, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure batch.num.messages for kafka: %s.", errstr.c_str());
-        throw "ERROR: Failed to configure kafka batch.num.messages";
-    }
+/**
+ * Get the cached state of a peer, the hash ID is printed only if it's not the last peer
+ *
+ * \param [in] hash_id       Peer hash ID (binary)
+ *
+ * \return pointer to the peer_list entry, valid until the peer is erased
+ */
+msgBus_kafka::peer_cache *msgBus_kafka::getPeer(const u_char *hash_id) {
+    if (last_peer != NULL and memcmp(last_peer_hash, hash_id, sizeof(last_peer_hash)) == 0)
+        return last_peer;
 
-    // Batch message max wait time (in ms)
-    q_buf_max_ms << cfg->q_buf_max_ms;
-    if (conf->set("queue.buffering.max.ms", q_buf_max_ms.str(), errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure queue.buffering.max.ms for kafka: %s.", errstr.c_str());
-        throw "ERROR: Failed to configure kafka queue.buffer.max.ms";
-    }
+    char p_hash_str[33];
+    hash_toStr(hash_id, p_hash_str);
 
+    return getPeer(hash_id, string(p_hash_str, 32));
+}
 
-    // compression
-    value = cfg->compression;
-    if (conf->set("compression.codec", value, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure %s compression for kafka: %s.", value.c_str(), errstr.c_str());
-        throw "ERROR: Failed to configure kafka compression";
-    }
+/**
+ * produce message to Kafka
+ *
+ * \details The rows of the parsed peer topics (base_attribute and after in topic_idx) are held
+ *          back in the coalesce buffer of the peer topic and produced as one message once the
+ *          next rows don't fit in kafka.coalesce.max.bytes or the oldest held rows are
+ *          kafka.coalesce.max.ms old.  Messages of kafka.coalesce.max.bytes or more are
+ *          produced right away, after the held rows of the topic.
+ *
+ * \param [in] topic_var     Topic var to use in KafkaTopicSelector::getTopic() MSGBUS_TOPIC_VAR_*
+ * \param [in] idx           Index of the topic in the peer topic cache, not used if peer is NULL
+ * \param [in] msg           message to produce
+ * \param [in] msg_size      Length in bytes of the message
+ * \param [in] rows          Number of rows
+ * \param [in] key           Hash key
+ * \param [in] peer          Peer of the message - NULL if not a peer message
+ * \param [in] peer_asn      Peer ASN
+ * \param [in] priority      True to use priority_kafka, if set
+ */
+void msgBus_kafka::produce(const char *topic_var, topic_idx idx, char *msg, size_t msg_size, int rows,
+                           const string &key, peer_cache *peer, uint32_t peer_asn, bool priority) {
 
-    // broker list
-    if (conf->set("metadata.broker.list", cfg->kafka_brokers, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure broker list for kafka: %s", errstr.c_str());
-        throw "ERROR: Failed to configure kafka broker list";
+    if (coalesce_max_bytes == 0 or peer == NULL or priority or idx < TOPIC_IDX_BASE_ATTRIBUTE or idx >= TOPIC_IDX_MAX) {
+        send(topic_var, idx, msg, msg_size, rows, key, peer, peer_asn, priority);
+        return;
     }
 
-    // Maximum transmit byte size
-    tx_bytes << cfg->tx_max_bytes;
-    if (conf->set("message.max.bytes", tx_bytes.str(), 
-                             errstr) != RdKafka::Conf::CONF_OK) 
-    {
-       LOG_ERR("Failed to configure transmit max message size for kafka: %s",
-                               errstr.c_str());
-       throw "ERROR: Failed to configure transmit max message size";
-    } 
- 
-    // Maximum receive byte size
-    rx_bytes << cfg->rx_max_bytes;
-    if (conf->set("receive.message.max.bytes", rx_bytes.str(), 
-                             errstr) != RdKafka::Conf::CONF_OK)
-    {
-       LOG_ERR("Failed to configure receive max message size for kafka: %s",
-                               errstr.c_str());
-       throw "ERROR: Failed to configure receive max message size";
+    coalesce_buf *buf = peer->pending[idx];
+
+    // Rows that don't fit are produced after the held rows of the topic
+    if (buf != NULL and buf->data.size() + msg_size > coalesce_max_bytes) {
+        flushCoalesced(buf);
+        buf = NULL;
     }
 
-    // Client group session and failure detection timeout
-    sess_timeout << cfg->session_timeout;
-    if (conf->set("session.timeout.ms", sess_timeout.str(), 
-                             errstr) != RdKafka::Conf::CONF_OK) 
-    {
-       LOG_ERR("Failed to configure session timeout for kafka: %s",
-                               errstr.c_str());
-       throw "ERROR: Failed to configure session timeout ";
-    } 
-    
-    // Timeout for network requests 
-    socket_timeout << cfg->socket_timeout;
-    if (conf->set("socket.timeout.ms", socket_timeout.str(), 
-                             errstr) != RdKafka::Conf::CONF_OK) 
-    {
-       LOG_ERR("Failed to configure socket timeout for kafka: %s",
-                               errstr.c_str());
-       throw "ERROR: Failed to configure socket timeout ";
-    } 
-    
-    // Maximum number of messages allowed on the producer queue 
-    q_buf_max_msgs << cfg->q_buf_max_msgs;
-    if (conf->set("queue.buffering.max.messages", q_buf_max_msgs.str(), 
-                             errstr) != RdKafka::Conf::CONF_OK) 
-    {
-       LOG_ERR("Failed to configure max messages in buffer for kafka: %s",
-                               errstr.c_str());
-       throw "ERROR: Failed to configure max messages in buffer ";
-    } 
-
-    // How many times to retry sending a failing MessageSet
-    msg_send_max_retry << cfg->msg_send_max_retry;
-    if (conf->set("message.send.max.retries", msg_send_max_retry.str(), 
-                             errstr) != RdKafka::Conf::CONF_OK) 
-    {
-       LOG_ERR("Failed to configure max retries for sending "
-               "failed message for kafka: %s",
-                               errstr.c_str());
-       throw "ERROR: Failed to configure max retries for sending failed message";
-    } 
-    
-    // Backoff time in ms before retrying a message send
-    retry_backoff_ms << cfg->retry_backoff_ms;
-    if (conf->set("retry.backoff.ms", retry_backoff_ms.str(), 
-                             errstr) != RdKafka::Conf::CONF_OK) 
-    {
-       LOG_ERR("Failed to configure backoff time before retrying to send"
-               "failed message for kafka: %s",
-                               errstr.c_str());
-       throw "ERROR: Failed to configure backoff time before resending"
-             " failed messages ";
-    } 
-    
-    // Register event callback
-    event_callback = new KafkaEventCallback(&isConnected, logger);
-    if (conf->set("event_cb", event_callback, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure kafka event callback: %s", errstr.c_str());
-        throw "ERROR: Failed to configure kafka event callback";
+    if (msg_size >= coalesce_max_bytes) {
+        send(topic_var, idx, msg, msg_size, rows, key, peer, peer_asn, priority);
+        return;
     }
 
-    // Register delivery report callback
-    delivery_callback = new KafkaDeliveryReportCallback();
+    uint64_t now = monotonicMs();
 
-    if (conf->set("dr_cb", delivery_callback, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure kafka delivery report callback: %s", errstr.c_str());
-        throw "ERROR: Failed to configure kafka delivery report callback";
-    }
+    if (buf == NULL) {
+        if (coalesce_free.empty()) {
+            buf = new coalesce_buf;
+            buf->data.reserve(coalesce_max_bytes);
+        } else {
+            buf = coalesce_free.back();
+            coalesce_free.pop_back();
+        }
 
+        buf->peer       = peer;
+        buf->idx        = idx;
+        buf->topic_var  = topic_var;
+        buf->peer_asn   = peer_asn;
+        buf->rows       = 0;
 
+        if (coalesce_list.empty())
+            coalesce_since = now;
 
-    // Create producer and connect
-    producer = RdKafka::Producer::create(conf, errstr);
-    if (producer == NULL) {
-        LOG_ERR("rtr=%s: Failed to create producer: %s", router_ip.c_str(), errstr.c_str());
-        throw "ERROR: Failed to create producer";
+        coalesce_list.push_back(buf);
+        peer->pending[idx] = buf;
     }
 
-    isConnected = true;
+    buf->data.append(msg, msg_size);
+    buf->rows += rows;
 
-    producer->poll(1000);
+    if (now - coalesce_since >= coalesce_max_ms)
+        flushCoalesced();
+}
 
-    if (not isConnected) {
-        LOG_ERR("rtr=%s: Failed to connect to Kafka, will try again in a few", router_ip.c_str());
-        return;
+/**
+ * Produce the held rows of a peer topic
+ *
+ * \param [in] buf           Held rows, returned to coalesce_free
+ */
+void msgBus_kafka::flushCoalesced(coalesce_buf *buf) {
+    send(buf->topic_var, buf->idx, &buf->data[0], buf->data.size(), buf->rows, buf->peer->hash_str,
+         buf->peer, buf->peer_asn, false);
 
-    }
+    buf->peer->pending[buf->idx] = NULL;
+    buf->data.clear();
 
-    /*
-     * Initialize the topic selector/handler
-     */
-    try {
-        topicSel = new KafkaTopicSelector(logger, cfg, producer);
+    coalesce_list.erase(std::find(coalesce_list.begin(), coalesce_list.end(), buf));
+    coalesce_free.push_back(buf);
 
-    } catch (char const *str) {
-        LOG_ERR("rtr=%s: Failed to create one or more topics, will try again in a few: err=%s", router_ip.c_str(), str);
-        isConnected = false;
-        return;
+    // The other held rows keep the time of the oldest rows, they are not held longer
+    if (coalesce_list.empty())
+        coalesce_since = 0;
+}
+
+/**
+ * Produce all held rows, in order of their first row
+ */
+void msgBus_kafka::flushCoalesced() {
+    for (size_t i = 0; i < coalesce_list.size(); i++) {
+        coalesce_buf *buf = coalesce_list[i];
+
+        send(buf->topic_var, buf->idx, &buf->data[0], buf->data.size(), buf->rows, buf->peer->hash_str,
+             buf->peer, buf->peer_asn, false);
+
+        buf->peer->pending[buf->idx] = NULL;
+        buf->data.clear();
+        coalesce_free.push_back(buf);
     }
 
-    producer->poll(100);
+    coalesce_list.clear();
+    coalesce_since = 0;
 }
 
 /**
- * produce message to Kafka
+ * Send a message to the producer, with its header
  *
  * \param [in] topic_var     Topic var to use in KafkaTopicSelector::getTopic() MSGBUS_TOPIC_VAR_*
+ * \param [in] idx           Index of the topic in the peer topic cache, not used if peer is NULL
  * \param [in] msg           message to produce
  * \param [in] msg_size      Length in bytes of the message
  * \param [in] rows          Number of rows
  * \param [in] key           Hash key
- * \param [in] peer_group    Peer group name - empty/NULL if not set or used
+ * \param [in] peer          Peer of the message - NULL if not a peer message
  * \param [in] peer_asn      Peer ASN
+ * \param [in] priority      True to use priority_kafka, if set
  */
-void msgBus_kafka::produce(const char *topic_var, char *msg, size_t msg_size, int rows, string key,
-                           const string *peer_group, uint32_t peer_asn) {
+void msgBus_kafka::send(const char *topic_var, topic_idx idx, char *msg, size_t msg_size, int rows,
+                        const string &key, peer_cache *peer, uint32_t peer_asn, bool priority) {
     size_t len;
-    RdKafka::Topic *topic = NULL;
 
-    while (isConnected == false or topicSel == NULL) {
-        // Do not attempt to reconnect if this is the main process (router ip is null)
-        // Changed on 10/29/15 to support docker startup delay with kafka
+    // State messages are not queued behind the buffered prefix messages
+    KafkaProducer *producer = priority and priority_kafka != NULL ? priority_kafka : kafka;
+
+    connect(producer);
+
+    // Peer level messages can be keyed by the router instead, once the router hash is known
+    const string *msg_key = &key;
+    if (use_router_key and peer != NULL and router_hash_str.size() > 0)
+        msg_key = &router_hash_str;
+
+    char headers[MSGBUS_HDR_RESERVE];
+
+    // Binary rows are flagged in the header with the version of the encoding, TSV headers are unchanged
+    if (getFormat(topic_var) == MsgBusWriter::FORMAT_BINARY)
+        len = snprintf(headers, sizeof(headers), "V: %s\nC_HASH_ID: %s\nT: %s\nL: %lu\nR: %d\nF: binary/%d\n\n",
+                MSGBUS_API_VERSION, collector_hash.c_str(), topic_var, msg_size, rows, MSGBUS_BINARY_VERSION);
+    else
+        len = snprintf(headers, sizeof(headers), "V: %s\nC_HASH_ID: %s\nT: %s\nL: %lu\nR: %d\n\n",
+                MSGBUS_API_VERSION, collector_hash.c_str(), topic_var, msg_size, rows);
+
+    if (len >= sizeof(headers))
+        len = sizeof(headers) - 1;
+
+    char *payload;
+    char *block = NULL;                     // Pool buffer handed to librdkafka, NULL if the message was copied
+    int  msgflags;
+
+    // Working buffers belong to the buffer pool of kafka, the priority producer always copies
+    if (msg == prep_buf and zero_copy_min_bytes > 0 and msg_size >= zero_copy_min_bytes and producer == kafka) {
         /*
-        if (router_ip.size() <= 0) {
+         * Zero copy - The header is written into the space reserved in front of the body
+         *      and the working buffer is handed to librdkafka.  The delivery report
+         *      callback returns it to the pool.
+         */
+        payload = msg - len;
+        memcpy(payload, headers, len);
+
+        block = prep_block;
+        msgflags = 0;
+
+    } else {
+        // Single copy into a buffer that librdkafka frees
+        if ((payload = (char *)malloc(len + msg_size)) == NULL) {
+            LOG_ERR("rtr=%s: Failed to allocate %lu bytes for message", router_ip.c_str(), len + msg_size);
             return;
-        }*/
+        }
 
-        LOG_WARN("rtr=%s: Not connected to Kafka, attempting to reconnect", router_ip.c_str());
-        connect();
+        memcpy(payload, headers, len);
+        memcpy(payload + len, msg, msg_size);
 
-        sleep(1);
+        msgflags = RdKafka::Producer::RK_MSG_FREE;
     }
 
-    char headers[256];
-    len = snprintf(headers, sizeof(headers), "V: %s\nC_HASH_ID: %s\nT: %s\nL: %lu\nR: %d\n\n",
-            MSGBUS_API_VERSION, collector_hash.c_str(), topic_var, msg_size, rows);
+    SELF_DEBUG("rtr=%s: Producing message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
+               topic_var, msg_key->c_str(), msg_size);
+
+    RdKafka::ErrorCode resp = producer->produce(topic_var, &router_group_name, peer != NULL ? &peer->group : NULL,
+                                                peer_asn, msgflags, payload, msg_size + len, msg_key, block,
+                                                peer != NULL ? &peer->topics[idx] : NULL);
+    if (resp != RdKafka::ERR_NO_ERROR) {
+        if (resp == RdKafka::ERR__UNKNOWN_TOPIC)
+            LOG_NOTICE("rtr=%s: failed to produce message because topic couldn't be found: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
+                       topic_var, msg_key->c_str(), msg_size);
+        else
+            LOG_ERR("rtr=%s: Failed to produce message: %s", router_ip.c_str(), RdKafka::err2str(resp).c_str());
 
-    memcpy(producer_buf, headers, len);
-    memcpy(producer_buf+len, msg, msg_size);
+        // librdkafka does not take ownership of the payload on failure
+        if (block == NULL)
+            free(payload);
 
+    } else if (block != NULL) {
+        // Working buffer now belongs to librdkafka, switch to another one
+        prep_block = kafka->getBufferPool()->get();
+        prep_buf = prep_block + MSGBUS_HDR_RESERVE;
+    }
 
-    topic = topicSel->getTopic(topic_var, &router_group_name, peer_group, peer_asn);
-    if (topic != NULL) {
-        SELF_DEBUG("rtr=%s: Producing message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
-                   topic->name().c_str(), key.c_str(), msg_size);
+    // The priority producer is served right away, batches only defer the bulk producer
+    if (producer != kafka)
+        producer->poll(0);
+    else if (not inBatch)
+        kafka->poll(0);
+}
 
-        RdKafka::ErrorCode resp = producer->produce(topic, RdKafka::Topic::PARTITION_UA,
-                                                    RdKafka::Producer::RK_MSG_COPY,
-                                                    producer_buf, msg_size + len,
-                                                    (const std::string *) &key, NULL);
-        if (resp != RdKafka::ERR_NO_ERROR)
-            LOG_ERR("rtr=%s: Failed to produce message: %s", router_ip.c_str(), RdKafka::err2str(resp).c_str());
-    } else {
-        LOG_NOTICE("rtr=%s: failed to produce message because topic couldn't be found: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
-                   topic_var, key.c_str(), msg_size);
+/**
+ * Check if a BGP-LS row should be published
+ *
+ * \param [in] peer          Peer of the row
+ * \param [in] type          Record type; 'N' node, 'L' link or 'P' prefix
+ * \param [in] hash_id       Hash ID of the record
+ * \param [in] remove        True if the record is withdrawn
+ * \param [in] data          Row fields to compare, everything after the timestamp
+ * \param [in] len           Length of data in bytes
+ *
+ * \return true if the row should be published, false if it's unchanged
+ */
+bool msgBus_kafka::lsChanged(peer_cache *peer, char type, const u_char *hash_id, bool remove,
+                             const char *data, size_t len) {
+    if (not cfg->ls_delta or peer == NULL)
+        return true;
+
+    string key(1, type);
+    key.append((const char *)hash_id, 16);
+
+    if (remove) {
+        peer->ls_rows.erase(key);
+        return true;
     }
 
-    producer->poll(0);
+    u_char      digest[HASH_ENGINE_DIGEST_SIZE];
+    HashEngine  hash;
+
+    hash.update(data, len);
+    hash.finalize();
+    hash.digest(digest);
+
+    time_t now = time(NULL);
+    ls_row &row = peer->ls_rows[key];           // New rows are zero initialized
+
+    // Unchanged rows are republished once the snapshot interval has passed
+    if (row.published != 0 and memcmp(row.digest, digest, sizeof(digest)) == 0 and
+            (cfg->ls_snapshot_interval == 0 or now - row.published < cfg->ls_snapshot_interval))
+        return false;
+
+    memcpy(row.digest, digest, sizeof(row.digest));
+    row.published = now;
+
+    return true;
 }
 
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
 void msgBus_kafka::update_Collector(obj_collector &c_object, collector_action_code action_code) {
-    char buf[4096]; // Misc working buffer
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    flushCoalesced();
+
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_COLLECTOR));
 
     string ts;
     getTimestamp(c_object.timestamp_secs, c_object.timestamp_us, ts);
@@ -426,12 +538,17 @@ void msgBus_kafka::update_Collector(obj_collector &c_object, collector_action_co
             break;
     }
 
-    snprintf(buf, sizeof(buf),
-             "%s\t%" PRIu64 "\t%s\t%s\t%s\t%u\t%s\n",
-             action, collector_seq, c_object.admin_id, collector_hash.c_str(),
-             c_object.routers, c_object.router_count, ts.c_str());
+    out.beginRow();
+    out.field(action);
+    out.field(collector_seq);
+    out.field(c_object.admin_id);
+    out.field(collector_hash);
+    out.field(c_object.routers);
+    out.field(c_object.router_count);
+    out.field(ts);
+    out.endRow();
 
-    produce(MSGBUS_TOPIC_VAR_COLLECTOR, buf, strlen(buf), 1, collector_hash, NULL, 0);
+    produce(MSGBUS_TOPIC_VAR_COLLECTOR, TOPIC_IDX_MAX, out.data(), out.length(), 1, collector_hash, NULL, 0, true);
 
     collector_seq++;
 }
@@ -440,7 +557,10 @@ void msgBus_kafka::update_Collector(obj_collector &c_object, collector_action_co
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
 void msgBus_kafka::update_Router(obj_router &r_object, router_action_code code) {
-    char buf[4096]; // Misc working buffer
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    // Held rows are produced before the router state, the peer topics may change with the router group
+    flushCoalesced();
 
     // Convert binary hash to string
     string r_hash_str;
@@ -464,6 +584,7 @@ void msgBus_kafka::update_Router(obj_router &r_object, router_action_code code)
             skip_if_defined = false;
             action.assign("term");
             bzero(router_hash, sizeof(router_hash));
+            router_hash_str.clear();
             break;
     }
 
@@ -476,23 +597,13 @@ void msgBus_kafka::update_Router(obj_router &r_object, router_action_code code)
         }
     }
 
-    if (code != ROUTER_ACTION_TERM)
+    if (code != ROUTER_ACTION_TERM) {
         memcpy(router_hash, r_object.hash_id, sizeof(router_hash));
+        router_hash_str = r_hash_str;
+    }
 
     router_ip.assign((char *)r_object.ip_addr);                     // Update router IP for logging
 
-    string descr((char *)r_object.descr);
-    boost::replace_all(descr, "\n", "\\n");
-    boost::replace_all(descr, "\t", " ");
-
-    string initData(r_object.initiate_data);
-    boost::replace_all(initData, "\n", "\\n");
-    boost::replace_all(initData, "\t", " ");
-
-    string termData(r_object.term_data);
-    boost::replace_all(termData, "\n", "\\n");
-    boost::replace_all(termData, "\t", " ");
-
     string ts;
     getTimestamp(r_object.timestamp_secs, r_object.timestamp_us, ts);
 
@@ -503,16 +614,30 @@ void msgBus_kafka::update_Router(obj_router &r_object, router_action_code code)
         snprintf((char *)r_object.name, sizeof(r_object.name)-1, "%s", hostname.c_str());
     }
 
-    if (topicSel != NULL)
-        topicSel->lookupRouterGroup((char *)r_object.name, (char *)r_object.ip_addr, router_group_name);
+    string prev_router_group = router_group_name;
+    kafka->lookupRouterGroup((char *)r_object.name, (char *)r_object.ip_addr, router_group_name);
 
-    size_t size = snprintf(buf, sizeof(buf),
-             "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%" PRIu16 "\t%s\t%s\t%s\t%s\t%s\n", action.c_str(),
-             router_seq, r_object.name, r_hash_str.c_str(), r_object.ip_addr, descr.c_str(),
-             r_object.term_reason_code, r_object.term_reason_text,
-             initData.c_str(), termData.c_str(), ts.c_str(), r_object.bgp_id);
+    // Cached topics and outputs of the peers include the router group
+    if (router_group_name != prev_router_group) {
+        router_outputs = cfg->getOutputs(router_group_name, "");
 
-    produce(MSGBUS_TOPIC_VAR_ROUTER, buf, size, 1, r_hash_str, NULL, 0);
+        for (peer_list_iter it = peer_list.begin(); it != peer_list.end(); ++it) {
+            it->second.resetTopics();
+            it->second.outputs = cfg->getOutputs(router_group_name, it->second.group);
+        }
+    }
+
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_ROUTER));
+
+    out.beginRow();
+    out.field(action);
+    out.field(router_seq);
+    msgbus_row::RouterFields::write(out, r_object);
+    out.field(ts);
+    out.field(r_object.bgp_id);
+    out.endRow();
+
+    produce(MSGBUS_TOPIC_VAR_ROUTER, TOPIC_IDX_MAX, out.data(), out.length(), 1, r_hash_str, NULL, 0, true);
 
     router_seq++;
 }
@@ -521,14 +646,18 @@ void msgBus_kafka::update_Router(obj_router &r_object, router_action_code code)
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
 void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
 
-    char buf[4096]; // Misc working buffer
+    // Held rows are produced first, they stay in order with the peer up/down
+    flushCoalesced();
+
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_PEER));
 
     string r_hash_str;
     hash_toStr(peer.router_hash_id, r_hash_str);
 
     // Generate the hash
-    MD5 hash;
+    HashEngine hash;
 
     hash.update((unsigned char *) peer.peer_addr,
                 strlen(peer.peer_addr));
@@ -546,9 +675,7 @@ void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_pe
     hash.finalize();
 
     // Save the hash
-    unsigned char *hash_raw = hash.raw_digest();
-    memcpy(peer.hash_id, hash_raw, 16);
-    delete[] hash_raw;
+    hash.digest(peer.hash_id);
 
     // Convert binary hash to string
     string p_hash_str;
@@ -575,8 +702,10 @@ void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_pe
             action.assign("down");
             add_to_cache = false;
 
-            if (peer_list.find(p_hash_str) != peer_list.end())
+            if (peer_list.find(p_hash_str) != peer_list.end()) {
                 peer_list.erase(p_hash_str);
+                last_peer = NULL;
+            }
 
             break;
     }
@@ -595,71 +724,49 @@ void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_pe
 
     // Insert/Update map entry
     if (add_to_cache) {
-        if (topicSel != NULL)
-            topicSel->lookupPeerGroup(hostname, peer.peer_addr, peer.peer_as, peer_list[p_hash_str]);
-    }
-
-    switch (code) {
-        case PEER_ACTION_FIRST :
-            snprintf(buf, sizeof(buf),
-                     "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t%d\t%d\t%d\t%d\t%d\t%s\n",
-                     action.c_str(), peer_seq, p_hash_str.c_str(), r_hash_str.c_str(), hostname.c_str(),
-                     peer.peer_bgp_id,router_ip.c_str(), ts.c_str(), peer.peer_as, peer.peer_addr,peer.peer_rd,
-                     peer.isL3VPN, peer.isPrePolicy, peer.isIPv4, peer.isLocRib, peer.isLocRibFiltered, peer.table_name);
-            action.assign("first");
-            break;
-
-        case PEER_ACTION_UP : {
-            if (up == NULL)
-                return;
-
-            string infoData(up->info_data);
-            if (up->info_data[0] != 0) {
-                boost::replace_all(infoData, "\n", "\\n");
-                boost::replace_all(infoData, "\t", " ");
-            }
-
-            snprintf(buf, sizeof(buf),
-                     "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%" PRIu16 "\t%" PRIu32 "\t%s\t%" PRIu16
-                             "\t%s\t%s\t%s\t%s\t%" PRIu16 "\t%" PRIu16 "\t\t\t\t\t%d\t%d\t%d\t%d\t%d\t%s\n",
-                     action.c_str(), peer_seq, p_hash_str.c_str(), r_hash_str.c_str(), hostname.c_str(),
-                     peer.peer_bgp_id, router_ip.c_str(), ts.c_str(), peer.peer_as, peer.peer_addr, peer.peer_rd,
+        peer_cache &p_cache = peer_list[p_hash_str];
 
-                    /* Peer UP specific fields */
-                     up->remote_port, up->local_asn, up->local_ip, up->local_port, up->local_bgp_id, infoData.c_str(), up->sent_cap,
-                     up->recv_cap, up->remote_hold_time, up->local_hold_time,
-                     peer.isL3VPN, peer.isPrePolicy, peer.isIPv4, peer.isLocRib, peer.isLocRibFiltered, peer.table_name);
+        kafka->lookupPeerGroup(hostname, peer.peer_addr, peer.peer_as, p_cache.group);
+        p_cache.resetTopics();                  // Group may have changed
+        p_cache.outputs = cfg->getOutputs(router_group_name, p_cache.group);
+    }
 
-            skip_if_in_cache = false;
-            action.assign("up");
-            break;
-        }
-        case PEER_ACTION_DOWN: {
-            if (down == NULL)
-                return;
+    if ((code == PEER_ACTION_UP and up == NULL) or (code == PEER_ACTION_DOWN and down == NULL))
+        return;
 
-            snprintf(buf, sizeof(buf),
-                     "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t\t\t\t\t\t\t\t\t\t\t%d\t%d\t%d\t%s\t%d\t%d\t%d\t%d\t%d\t\n",
-                     action.c_str(), peer_seq, p_hash_str.c_str(), r_hash_str.c_str(), hostname.c_str(),
-                     peer.peer_bgp_id, router_ip.c_str(), ts.c_str(), peer.peer_as, peer.peer_addr, peer.peer_rd,
+    out.beginRow();
+    out.field(action);
+    out.field(peer_seq);
+    out.field(p_hash_str);
+    out.field(r_hash_str);
+    out.field(hostname);
+    out.field(peer.peer_bgp_id);
+    out.field(router_ip);
+    out.field(ts);
+    msgbus_row::PeerAddrFields::write(out, peer);
 
-                     /* Peer DOWN specific fields */
-                     down->bmp_reason, down->bgp_err_code, down->bgp_err_subcode, down->error_text,
+    // Only the fields of the event are set, the others are empty
+    if (code == PEER_ACTION_UP)
+        msgbus_row::PeerUpFields::write(out, *up);
+    else
+        msgbus_row::PeerUpFields::empty(out);
 
-                     peer.isL3VPN, peer.isPrePolicy, peer.isIPv4, peer.isLocRib, peer.isLocRibFiltered);
+    if (code == PEER_ACTION_DOWN)
+        msgbus_row::PeerDownFields::write(out, *down);
+    else
+        msgbus_row::PeerDownFields::empty(out);
 
-            skip_if_in_cache = false;
-            action.assign("down");
-            add_to_cache = false;
+    msgbus_row::PeerFlagFields::write(out, peer);
 
-            if (peer_list.find(p_hash_str) != peer_list.end())
-                peer_list.erase(p_hash_str);
+    if (code == PEER_ACTION_DOWN)
+        out.fieldEmpty();
+    else
+        out.field((const char *)peer.table_name);
 
-            break;
-        }
-    }
+    out.endRow();
 
-    produce(MSGBUS_TOPIC_VAR_PEER, buf, strlen(buf), 1, p_hash_str, &peer_list[p_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_PEER, TOPIC_IDX_PEER, out.data(), out.length(), 1, p_hash_str, getPeer(peer.hash_id, p_hash_str),
+            peer.peer_as, true);
 
     peer_seq++;
 }
@@ -668,19 +775,15 @@ void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_pe
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
 void msgBus_kafka::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
 
-    prep_buf[0] = 0;
-    size_t  buf_len;                    // size of the message in buf
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE));
 
-    string path_hash_str;
-    string p_hash_str;
-    string r_hash_str;
-    hash_toStr(peer.hash_id, p_hash_str);
-    hash_toStr(peer.router_hash_id, r_hash_str);
+    const string &p_hash_str = getPeer(peer.hash_id)->hash_str;
 
 
     // Generate the hash
-    MD5 hash;
+    HashEngine hash;
 
     //hash.update(path_object.peer_hash_id, HASH_SIZE);
     hash.update((unsigned char *) attr.as_path.c_str(), attr.as_path.length());
@@ -696,31 +799,36 @@ void msgBus_kafka::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr,
 
     hash.update((unsigned char *) attr.community_list.c_str(), attr.community_list.length());
     hash.update((unsigned char *) attr.ext_community_list.c_str(), attr.ext_community_list.length());
+    hash.update((unsigned char *) attr.large_community_list.c_str(), attr.large_community_list.length());
     hash.update((unsigned char *) p_hash_str.c_str(), p_hash_str.length());
 
     hash.finalize();
 
     // Save the hash
-    unsigned char *hash_raw = hash.raw_digest();
-    memcpy(attr.hash_id, hash_raw, 16);
-    delete[] hash_raw;
+    hash.digest(attr.hash_id);
 
-    hash_toStr(attr.hash_id, path_hash_str);
+    // The hash is still needed by the prefix rows when the topic is disabled
+    if (not (getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_BASE_ATTRIBUTE))
+        return;
 
     string ts;
     getTimestamp(peer.timestamp_secs, peer.timestamp_us, ts);
 
-    buf_len =
-            snprintf(prep_buf, MSGBUS_WORKING_BUF_SIZE,
-                     "add\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIu16 "\t%" PRIu32
-                             "\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%d\t%d\t%s\n",
-                     base_attr_seq, path_hash_str.c_str(), r_hash_str.c_str(), router_ip.c_str(), p_hash_str.c_str(),
-                     peer.peer_addr,peer.peer_as, ts.c_str(),
-                     attr.origin, attr.as_path.c_str(), attr.as_path_count, attr.origin_as, attr.next_hop, attr.med,
-                     attr.local_pref, attr.aggregator, attr.community_list.c_str(), attr.ext_community_list.c_str(), attr.cluster_list.c_str(),
-                     attr.atomic_agg, attr.nexthop_isIPv4, attr.originator_id);
-
-    produce(MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE, prep_buf, buf_len, 1, p_hash_str, &peer_list[p_hash_str], peer.peer_as);
+    out.beginRow();
+    out.field("add");
+    out.field(base_attr_seq);
+    out.fieldHash(attr.hash_id);
+    out.fieldHash(peer.router_hash_id);
+    out.field(router_ip);
+    out.fieldHash(peer.hash_id);
+    out.field(peer.peer_addr);
+    out.field(peer.peer_as);
+    out.field(ts);
+    msgbus_row::AttrFields::write(out, attr);
+    out.field(attr.large_community_list);
+    out.endRow();
+
+    produce(MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE, TOPIC_IDX_BASE_ATTRIBUTE, out.data(), out.length(), 1, p_hash_str, getPeer(peer.hash_id, p_hash_str), peer.peer_as);
 
     ++base_attr_seq;
 }
@@ -730,23 +838,18 @@ void msgBus_kafka::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr,
  */
 void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
                                 obj_path_attr *attr, vpn_action_code code) {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
 
-    prep_buf[0] = 0;
-
-    char    buf2[80000];                         // Second working buffer
-    size_t  buf_len = 0;                         // query buffer length
-
-    string vpn_hash_str;
-    string path_hash_str;
-    string p_hash_str;
-    string r_hash_str;
+    if (not (getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_L3VPN))
+        return;
 
-    hash_toStr(peer.router_hash_id, r_hash_str);
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_L3VPN));
+    u_char  label_flag = 1;                      // Constant hashed when labels are present
+    bool    hash_printed = HashEngine::getAlgorithm() == HashEngine::HASH_MD5;
+    char    rd[BGP_RD_STRLEN];
+    char    labels[BGP_LABELS_STRLEN];
 
-    if (attr != NULL)
-        hash_toStr(attr->hash_id, path_hash_str);
-
-    hash_toStr(peer.hash_id, p_hash_str);
+    const string &p_hash_str = getPeer(peer.hash_id)->hash_str;
 
     string ts;
     getTimestamp(peer.timestamp_secs, peer.timestamp_us, ts);
@@ -754,15 +857,23 @@ void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
     // Loop through the vector array of vpn entries
     for (size_t i = 0; i < vpn.size(); i++) {
 
-        // Generate the hash
-        MD5 hash;
+        /*
+         * Generate the hash
+         *      md5 hash ids hash the printed prefix and RD as previous versions did, so they don't
+         *      change.  Other algorithms hash the binary prefix and RD.
+         */
+        HashEngine hash;
+
+        if (hash_printed) {
+            hash.update((unsigned char *) vpn[i].prefix, strlen(vpn[i].prefix));
+            hash.update(&vpn[i].prefix_len, sizeof(vpn[i].prefix_len));
+            hash.update((unsigned char *) rd, bgp::formatRouteDistinguisherHash(vpn[i].rd, rd));
 
-        hash.update((unsigned char *) vpn[i].prefix, strlen(vpn[i].prefix));
-        hash.update(&vpn[i].prefix_len, sizeof(vpn[i].prefix_len));
-        hash.update((unsigned char *) vpn[i].rd_administrator_subfield.c_str(),
-                    vpn[i].rd_administrator_subfield.length());
-        hash.update((unsigned char *) vpn[i].rd_assigned_number.c_str(),
-                    vpn[i].rd_assigned_number.length());
+        } else {
+            hash.update(vpn[i].prefix_bin, vpn[i].isIPv4 ? 4 : 16);
+            hash.update(&vpn[i].prefix_len, sizeof(vpn[i].prefix_len));
+            hash.update(vpn[i].rd, sizeof(vpn[i].rd));
+        }
 
         hash.update((unsigned char *) p_hash_str.c_str(), p_hash_str.length());
 
@@ -775,69 +886,59 @@ void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
          *      Withdrawn and updated NLRI's do not carry the original label, therefore we cannot
          *      hash on the label string.  Instead, we has on a constant value of 1.
          */
-        if (vpn[i].labels[0] != 0) {
-            buf2[0] = 1;
-            hash.update((unsigned char *) buf2, 1);
-            buf2[0] = 0;
-        }
+        if (vpn[i].labels.count > 0)
+            hash.update(&label_flag, 1);
 
         hash.finalize();
 
         // Save the hash
-        unsigned char *hash_raw = hash.raw_digest();
-        memcpy(vpn[i].hash_id, hash_raw, 16);
-        delete[] hash_raw;
+        hash.digest(vpn[i].hash_id);
 
         // Build the query
-        hash_toStr(vpn[i].hash_id, vpn_hash_str);
-
-        switch (code) {
-
-            case VPN_ACTION_ADD:
-                if (attr == NULL)
-                    return;
-
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "add\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%d\t%d\t%s\t%s\t%" PRIu16
-                                            "\t%" PRIu32 "\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%d\t%d\t%s\t%" PRIu32
-                                            "\t%s\t%d\t%d\t%s:%s\t%d\n",
-                                    l3vpn_seq, vpn_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(),path_hash_str.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(), vpn[i].prefix, vpn[i].prefix_len,
-                                    vpn[i].isIPv4, attr->origin,
-                                    attr->as_path.c_str(), attr->as_path_count, attr->origin_as, attr->next_hop, attr->med, attr->local_pref,
-                                    attr->aggregator,
-                                    attr->community_list.c_str(), attr->ext_community_list.c_str(), attr->cluster_list.c_str(),
-                                    attr->atomic_agg, attr->nexthop_isIPv4,
-                                    attr->originator_id, vpn[i].path_id, vpn[i].labels, peer.isPrePolicy, peer.isAdjIn,
-                                    vpn[i].rd_administrator_subfield.c_str(), vpn[i].rd_assigned_number.c_str(), vpn[i].rd_type);
-
-                break;
-
-            case VPN_ACTION_DEL:
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "del\t%" PRIu64 "\t%s\t%s\t%s\t\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%d\t%d\t\t\t"
-                                            "\t\t\t\t\t\t\t\t\t\t\t\t%" PRIu32
-                                            "\t%s\t%d\t%d\t%s:%s\t%d\n",
-                                    l3vpn_seq, vpn_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(), vpn[i].prefix, vpn[i].prefix_len,
-                                    vpn[i].isIPv4, vpn[i].path_id, vpn[i].labels, peer.isPrePolicy, peer.isAdjIn,
-                                    vpn[i].rd_administrator_subfield.c_str(), vpn[i].rd_assigned_number.c_str(),
-                                    vpn[i].rd_type);
-                break;
-
-        }
+        if (code == VPN_ACTION_ADD and attr == NULL)
+            return;
 
-        // Cat the entry to the query buff
-        if (buf_len < MSGBUS_WORKING_BUF_SIZE /* size of buf */)
-            strcat(prep_buf, buf2);
+        out.beginRow();
+        out.field(code == VPN_ACTION_ADD ? "add" : "del");
+        out.field(l3vpn_seq);
+        out.fieldHash(vpn[i].hash_id);
+        out.fieldHash(peer.router_hash_id);
+        out.field(router_ip);
+
+        if (code == VPN_ACTION_ADD)
+            out.fieldHash(attr->hash_id);
+        else
+            out.fieldEmpty();
+
+        out.fieldHash(peer.hash_id);
+        out.field(peer.peer_addr);
+        out.field(peer.peer_as);
+        out.field(ts);
+        out.fieldIp(vpn[i].isIPv4, vpn[i].prefix_bin);
+        out.field(vpn[i].prefix_len);
+        out.field(vpn[i].isIPv4);
+
+        if (code == VPN_ACTION_ADD)
+            msgbus_row::AttrFields::write(out, *attr);
+        else
+            msgbus_row::AttrFields::empty(out);
+
+        bgp::formatLabels(vpn[i].labels, labels);
+        bgp::formatRouteDistinguisher(vpn[i].rd, rd, rd_rfc4364);
+
+        out.field(vpn[i].path_id);
+        out.field(labels);
+        out.field(peer.isPrePolicy);
+        out.field(peer.isAdjIn);
+        out.field(rd);
+        out.field(vpn[i].rd[1]);
+        out.endRow();
 
         ++l3vpn_seq;
     }
 
-    produce(MSGBUS_TOPIC_VAR_L3VPN, prep_buf, strlen(prep_buf), vpn.size(), p_hash_str,
-            &peer_list[p_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_L3VPN, TOPIC_IDX_L3VPN, out.data(), out.length(), vpn.size(), p_hash_str,
+            getPeer(peer.hash_id, p_hash_str), peer.peer_as);
 }
 
 
@@ -846,43 +947,64 @@ void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
  */
 void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn,
                               obj_path_attr *attr, vpn_action_code code) {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
 
-    prep_buf[0] = 0;
-
-    char    buf2[80000];                         // Second working buffer
-    size_t  buf_len = 0;                         // query buffer length
-
-    string vpn_hash_str;
-    string path_hash_str;
-    string p_hash_str;
-    string r_hash_str;
-
-    hash_toStr(peer.router_hash_id, r_hash_str);
+    if (not (getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_EVPN))
+        return;
 
-    if (attr != NULL)
-        hash_toStr(attr->hash_id, path_hash_str);
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_EVPN));
+    bool    hash_printed = HashEngine::getAlgorithm() == HashEngine::HASH_MD5;
+    char    rd[BGP_RD_STRLEN];
+    char    esi[BGP_ESI_STRLEN];
+    char    tag[9];
+    char    mac[BGP_MAC_STRLEN];
+    char    ip[46];
+    char    originating_router_ip[46];
 
-    hash_toStr(peer.hash_id, p_hash_str);
+    const string &p_hash_str = getPeer(peer.hash_id)->hash_str;
 
     string ts;
     getTimestamp(peer.timestamp_secs, peer.timestamp_us, ts);
 
     // Loop through the vector array of vpn entries
     for (size_t i = 0; i < vpn.size(); i++) {
+        obj_evpn &route = vpn[i];
 
-        // Generate the hash
-        MD5 hash;
+        // Print the fields of the route type, the others are empty
+        bool has_esi = route.route_type == 1 or route.route_type == 2 or route.route_type == 4;
+        bool has_orig_ip = (route.route_type == 3 or route.route_type == 4) and route.originating_router_ip_len > 0;
+
+        size_t esi_str_len = has_esi ? bgp::formatEsi(route.ethernet_segment_identifier, esi) : 0;
+        size_t mac_str_len = route.route_type == 2 ? bgp::formatMac(route.mac, mac) : 0;
+        size_t ip_str_len = route.route_type == 2 and route.ip_len > 0 ? bgp::formatIp(route.ip_len <= 32, route.ip, ip) : 0;
+
+        esi[esi_str_len] = 0;
+        mac[mac_str_len] = 0;
+        ip[ip_str_len] = 0;
+
+        /*
+         * Generate the hash
+         *      md5 hash ids hash the printed fields as previous versions did, so they don't change.
+         *      Other algorithms hash the binary fields.
+         */
+        HashEngine hash;
 
         hash.update((unsigned char *) p_hash_str.c_str(), p_hash_str.length());
 
-        hash.update((unsigned char *) vpn[i].mac, strlen(vpn[i].mac));
-        hash.update((unsigned char *) vpn[i].ip, strlen(vpn[i].ip));
-        hash.update(&vpn[i].ip_len, sizeof(vpn[i].ip_len));
-        hash.update((unsigned char *) vpn[i].ethernet_segment_identifier, strlen(vpn[i].ethernet_segment_identifier));
-        hash.update((unsigned char *) vpn[i].rd_administrator_subfield.c_str(),
-                    vpn[i].rd_administrator_subfield.length());
-        hash.update((unsigned char *) vpn[i].rd_assigned_number.c_str(),
-                    vpn[i].rd_assigned_number.length());
+        if (hash_printed) {
+            hash.update((unsigned char *) mac, mac_str_len);
+            hash.update((unsigned char *) ip, ip_str_len);
+            hash.update(&route.ip_len, sizeof(route.ip_len));
+            hash.update((unsigned char *) esi, esi_str_len);
+            hash.update((unsigned char *) rd, bgp::formatRouteDistinguisherHash(route.rd, rd));
+
+        } else {
+            hash.update(route.mac, sizeof(route.mac));
+            hash.update(route.ip, sizeof(route.ip));
+            hash.update(&route.ip_len, sizeof(route.ip_len));
+            hash.update(route.ethernet_segment_identifier, sizeof(route.ethernet_segment_identifier));
+            hash.update(route.rd, sizeof(route.rd));
+        }
 
         // Add path ID to hash only if exists
         if (vpn[i].path_id > 0)
@@ -891,66 +1013,68 @@ void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn,
         hash.finalize();
 
         // Save the hash
-        unsigned char *hash_raw = hash.raw_digest();
-        memcpy(vpn[i].hash_id, hash_raw, 16);
-        delete[] hash_raw;
+        hash.digest(vpn[i].hash_id);
 
         // Build the query
-        hash_toStr(vpn[i].hash_id, vpn_hash_str);
-
-        switch (code) {
-
-            case VPN_ACTION_ADD:
-                if (attr == NULL)
-                    return;
-
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "add\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIu16
-                                        "\t%" PRIu32 "\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%d\t%d\t%s\t%" PRIu32
-                                        "\t%d\t%d\t%s:%s\t%d\t%d\t%s\t%s\t%s\t%d\t%s\t%d\t%s\t%" PRIu32 "\t%" PRIu32 "\n",
-                                    evpn_seq, vpn_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(),path_hash_str.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(),
-                                    attr->origin,
-                                    attr->as_path.c_str(), attr->as_path_count, attr->origin_as, attr->next_hop, attr->med, attr->local_pref,
-                                    attr->aggregator,
-                                    attr->community_list.c_str(), attr->ext_community_list.c_str(), attr->cluster_list.c_str(),
-                                    attr->atomic_agg, attr->nexthop_isIPv4,
-                                    attr->originator_id, vpn[i].path_id, peer.isPrePolicy, peer.isAdjIn,
-                                    vpn[i].rd_administrator_subfield.c_str(), vpn[i].rd_assigned_number.c_str(), vpn[i].rd_type,
-                                    vpn[i].originating_router_ip_len, vpn[i].originating_router_ip, vpn[i].ethernet_tag_id_hex,
-                                    vpn[i].ethernet_segment_identifier, vpn[i].mac_len,
-                                    vpn[i].mac, vpn[i].ip_len, vpn[i].ip, vpn[i].mpls_label_1, vpn[i].mpls_label_2);
-
-                break;
-
-            case VPN_ACTION_DEL:
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "del\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t\t\t"
-                                            "\t\t\t\t\t\t\t\t\t\t\t\t%" PRIu32
-                                            "\t%d\t%d\t%s:%s\t%d\t%d\t%s\t%s\t%s\t%d\t%s\t%d\t%s\t%" PRIu32 "\t%" PRIu32 "\n",
-                                    evpn_seq, vpn_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(),path_hash_str.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(),
-                                    vpn[i].path_id, peer.isPrePolicy, peer.isAdjIn,
-                                    vpn[i].rd_administrator_subfield.c_str(), vpn[i].rd_assigned_number.c_str(), vpn[i].rd_type,
-                                    vpn[i].originating_router_ip_len, vpn[i].originating_router_ip, vpn[i].ethernet_tag_id_hex,
-                                    vpn[i].ethernet_segment_identifier, vpn[i].mac_len,
-                                    vpn[i].mac, vpn[i].ip_len, vpn[i].ip, vpn[i].mpls_label_1, vpn[i].mpls_label_2);
-
-                break;
-
-        }
+        if (code == VPN_ACTION_ADD and attr == NULL)
+            return;
 
-        // Cat the entry to the query buff
-        if (buf_len < MSGBUS_WORKING_BUF_SIZE /* size of buf */)
-            strcat(prep_buf, buf2);
+        out.beginRow();
+        out.field(code == VPN_ACTION_ADD ? "add" : "del");
+        out.field(evpn_seq);
+        out.fieldHash(vpn[i].hash_id);
+        out.fieldHash(peer.router_hash_id);
+        out.field(router_ip);
+
+        if (attr != NULL)
+            out.fieldHash(attr->hash_id);
+        else
+            out.fieldEmpty();
+
+        out.fieldHash(peer.hash_id);
+        out.field(peer.peer_addr);
+        out.field(peer.peer_as);
+        out.field(ts);
+
+        if (code == VPN_ACTION_ADD)
+            msgbus_row::AttrFields::write(out, *attr);
+        else
+            msgbus_row::AttrFields::empty(out);
+
+        bgp::formatRouteDistinguisher(route.rd, rd, rd_rfc4364);
+
+        if (has_orig_ip)
+            bgp::formatIp(route.originating_router_ip_len <= 32, route.originating_router_ip, originating_router_ip);
+        else
+            originating_router_ip[0] = 0;
+
+        if (route.route_type >= 1 and route.route_type <= 3)
+            bgp::formatHex(route.ethernet_tag_id, sizeof(route.ethernet_tag_id), tag);
+        else
+            tag[0] = 0;
+
+        out.field(vpn[i].path_id);
+        out.field(peer.isPrePolicy);
+        out.field(peer.isAdjIn);
+        out.field(rd);
+        out.field(route.rd[1]);
+        out.field(route.originating_router_ip_len);
+        out.field(originating_router_ip);
+        out.field(tag);
+        out.field(esi);
+        out.field(route.mac_len);
+        out.field(mac);
+        out.field(route.ip_len);
+        out.field(ip);
+        out.field((uint32_t)route.mpls_label_1);
+        out.field((uint32_t)route.mpls_label_2);
+        out.endRow();
 
         ++evpn_seq;
     }
 
-    produce(MSGBUS_TOPIC_VAR_EVPN, prep_buf, strlen(prep_buf), vpn.size(), p_hash_str,
-            &peer_list[p_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_EVPN, TOPIC_IDX_EVPN, out.data(), out.length(), vpn.size(), p_hash_str,
+            getPeer(peer.hash_id, p_hash_str), peer.peer_as);
 }
 
 
@@ -959,23 +1083,16 @@ void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn,
  */
 void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib,
                                         obj_path_attr *attr, unicast_prefix_action_code code) {
-    //bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
-    prep_buf[0] = 0;
-
-    char    buf2[80000];                         // Second working buffer
-    size_t  buf_len = 0;                         // query buffer length
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
 
-    string rib_hash_str;
-    string path_hash_str;
-    string p_hash_str;
-    string r_hash_str;
-
-    hash_toStr(peer.router_hash_id, r_hash_str);
+    if (not (getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_UNICAST_PREFIX))
+        return;
 
-    if (attr != NULL)
-        hash_toStr(attr->hash_id, path_hash_str);
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_UNICAST_PREFIX));
+    u_char  label_flag = 1;                      // Constant hashed when labels are present
+    static const u_char zero_hash[16] = { 0 };   // Path hash of a withdrawal that is not known
 
-    hash_toStr(peer.hash_id, p_hash_str);
+    const string &p_hash_str = getPeer(peer.hash_id)->hash_str;
 
     string action = "add";
     switch (code) {
@@ -994,7 +1111,7 @@ void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib>
     for (size_t i = 0; i < rib.size(); i++) {
 
         // Generate the hash
-        MD5 hash;
+        HashEngine hash;
 
         hash.update((unsigned char *) rib[i].prefix, strlen(rib[i].prefix));
         hash.update(&rib[i].prefix_len, sizeof(rib[i].prefix_len));
@@ -1009,114 +1126,124 @@ void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib>
          *      Withdrawn and updated NLRI's do not carry the original label, therefore we cannot
          *      hash on the label string.  Instead, we has on a constant value of 1.
          */
-        if (rib[i].labels[0] != 0) {
-            buf2[0] = 1;
-            hash.update((unsigned char *) buf2, 1);
-            buf2[0] = 0;
-        }
+        if (rib[i].labels.count > 0)
+            hash.update(&label_flag, 1);
 
         hash.finalize();
 
         // Save the hash
-        unsigned char *hash_raw = hash.raw_digest();
-        memcpy(rib[i].hash_id, hash_raw, 16);
-        delete[] hash_raw;
+        hash.digest(rib[i].hash_id);
 
         // Build the query
-        hash_toStr(rib[i].hash_id, rib_hash_str);
-
-        switch (code) {
-
-            case UNICAST_PREFIX_ACTION_ADD:
-                if (attr == NULL)
-                    return;
-
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%d\t%d\t%s\t%s\t%" PRIu16
-                                            "\t%" PRIu32 "\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%d\t%d\t%s\t%" PRIu32
-                                            "\t%s\t%d\t%d\n",
-                                    action.c_str(), unicast_prefix_seq, rib_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(),path_hash_str.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(), rib[i].prefix, rib[i].prefix_len,
-                                    rib[i].isIPv4, attr->origin,
-                                    attr->as_path.c_str(), attr->as_path_count, attr->origin_as, attr->next_hop, attr->med, attr->local_pref,
-                                    attr->aggregator,
-                                    attr->community_list.c_str(), attr->ext_community_list.c_str(), attr->cluster_list.c_str(),
-                                    attr->atomic_agg, attr->nexthop_isIPv4,
-                                    attr->originator_id, rib[i].path_id, rib[i].labels, peer.isPrePolicy, peer.isAdjIn);
-                break;
-
-            case UNICAST_PREFIX_ACTION_DEL:
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "%s\t%" PRIu64 "\t%s\t%s\t%s\t\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%d\t%d\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t%" PRIu32
-                                            "\t%s\t%d\t%d\n",
-                                    action.c_str(), unicast_prefix_seq, rib_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(), rib[i].prefix, rib[i].prefix_len,
-                                    rib[i].isIPv4, rib[i].path_id, rib[i].labels, peer.isPrePolicy, peer.isAdjIn);
-                break;
-        }
+        if (code == UNICAST_PREFIX_ACTION_ADD and attr == NULL)
+            return;
 
-        // Cat the entry to the query buff
-        if (buf_len < MSGBUS_WORKING_BUF_SIZE /* size of buf */)
-            strcat(prep_buf, buf2);
+        out.beginRow();
+        out.field(action);
+        out.field(unicast_prefix_seq);
+        out.fieldHash(rib[i].hash_id);
+        out.fieldHash(peer.router_hash_id);
+        out.field(router_ip);
+
+        // Withdrawals carry the path hash of the removed route when the Adj-RIB-In knows it
+        if (code == UNICAST_PREFIX_ACTION_ADD)
+            out.fieldHash(attr->hash_id);
+        else if (memcmp(rib[i].path_attr_hash_id, zero_hash, sizeof(zero_hash)) != 0)
+            out.fieldHash(rib[i].path_attr_hash_id);
+        else
+            out.fieldEmpty();
+
+        out.fieldHash(peer.hash_id);
+        out.field(peer.peer_addr);
+        out.field(peer.peer_as);
+        out.field(ts);
+        out.fieldIp(rib[i].isIPv4, rib[i].prefix_bin);
+        out.field(rib[i].prefix_len);
+        out.field(rib[i].isIPv4);
+
+        if (code == UNICAST_PREFIX_ACTION_ADD)
+            msgbus_row::AttrFields::write(out, *attr);
+        else
+            msgbus_row::AttrFields::empty(out);
+
+        out.field(rib[i].path_id);
+
+        if (rib[i].labels.count > 0) {
+            char labels[BGP_LABELS_STRLEN];
+            bgp::formatLabels(rib[i].labels, labels);
+            out.field(labels);
+        } else
+            out.field("");
+        out.field(peer.isPrePolicy);
+        out.field(peer.isAdjIn);
+
+        if (code == UNICAST_PREFIX_ACTION_ADD)
+            out.field(attr->large_community_list);
+        else
+            out.fieldEmpty();
+
+        out.endRow();
 
         ++unicast_prefix_seq;
 	++ribSeq;
     }
 
 
-    produce(MSGBUS_TOPIC_VAR_UNICAST_PREFIX, prep_buf, strlen(prep_buf), rib.size(), p_hash_str,
-            &peer_list[p_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_UNICAST_PREFIX, TOPIC_IDX_UNICAST_PREFIX, out.data(), out.length(), rib.size(), p_hash_str,
+            getPeer(peer.hash_id, p_hash_str), peer.peer_as);
 }
 
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
 void msgBus_kafka::add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
-    char buf[4096];                 // Misc working buffer
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    if (not (getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_BMP_STAT))
+        return;
+
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_BMP_STAT));
 
     // Build the query
-    string p_hash_str;
+    const string &p_hash_str = getPeer(peer.hash_id)->hash_str;
     string r_hash_str;
-    hash_toStr(peer.hash_id, p_hash_str);
     hash_toStr(peer.router_hash_id, r_hash_str);
 
     string ts;
     getTimestamp(peer.timestamp_secs, peer.timestamp_us, ts);
 
-    snprintf(buf, sizeof(buf),
-             "add\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32
-                     "\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu64 "\t%" PRIu64 "\n",
-             bmp_stat_seq, r_hash_str.c_str(), router_ip.c_str(),p_hash_str.c_str(), peer.peer_addr, peer.peer_as, ts.c_str(),
-             stats.prefixes_rej,stats.known_dup_prefixes, stats.known_dup_withdraws, stats.invalid_cluster_list,
-             stats.invalid_as_path_loop, stats.invalid_originator_id, stats.invalid_as_confed_loop,
-             stats.routes_adj_rib_in, stats.routes_loc_rib);
-
-
-    produce(MSGBUS_TOPIC_VAR_BMP_STAT, buf, strlen(buf), 1, p_hash_str, &peer_list[p_hash_str], peer.peer_as);
+    out.beginRow();
+    out.field("add");
+    out.field(bmp_stat_seq);
+    out.field(r_hash_str);
+    out.field(router_ip);
+    out.field(p_hash_str);
+    out.field(peer.peer_addr);
+    out.field(peer.peer_as);
+    out.field(ts);
+    msgbus_row::StatsFields::write(out, stats);
+    out.endRow();
+
+    produce(MSGBUS_TOPIC_VAR_BMP_STAT, TOPIC_IDX_BMP_STAT, out.data(), out.length(), 1, p_hash_str, getPeer(peer.hash_id, p_hash_str), peer.peer_as);
     ++bmp_stat_seq;
 }
 
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
-void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
+void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<MsgBusInterface::obj_ls_node> &nodes,
                                   ls_action_code code) {
-    bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    if (not (getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_LS_NODE))
+        return;
+
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_LS_NODE));
 
     char    buf2[8192];                          // Second working buffer
-    int     buf_len = 0;                         // query buffer length
     int     i;
 
-    string hash_str;
-    string r_hash_str;
-    string path_hash_str;
-    string peer_hash_str;
-
-    hash_toStr(peer.router_hash_id, r_hash_str);
-    hash_toStr(attr.hash_id, path_hash_str);
-    hash_toStr(peer.hash_id, peer_hash_str);
+    const string &peer_hash_str = getPeer(peer.hash_id)->hash_str;
 
     string action = "add";
     switch (code) {
@@ -1132,26 +1259,21 @@ void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::l
     getTimestamp(peer.timestamp_secs, peer.timestamp_us, ts);
 
     char igp_router_id[46];
-    char router_id[46];
     char ospf_area_id[16] = {0};
     char isis_area_id[32] = {0};
     char dr[16];
 
+    peer_cache *p_cache = getPeer(peer.hash_id, peer_hash_str);
+    size_t     row_begin;
+    size_t     cmp_begin;
+
     // Loop through the vector array of entries
     int rows = 0;
-    for (std::list<MsgBusInterface::obj_ls_node>::iterator it = nodes.begin();
+    for (std::vector<MsgBusInterface::obj_ls_node>::iterator it = nodes.begin();
             it != nodes.end(); it++) {
         ++rows;
         MsgBusInterface::obj_ls_node &node = (*it);
 
-        hash_toStr(node.hash_id, hash_str);
-
-        if (node.isIPv4) {
-            inet_ntop(PF_INET, node.router_id, router_id, sizeof(router_id));
-        } else {
-            inet_ntop(PF_INET6, node.router_id, router_id, sizeof(router_id));
-        }
-
         if (!strcmp(node.protocol, "OSPFv3") or !strcmp(node.protocol, "OSPFv2") ) {
             bzero(isis_area_id, sizeof(isis_area_id));
             bzero(igp_router_id, sizeof(igp_router_id));
@@ -1191,45 +1313,69 @@ void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::l
                 }
         }
 
-        buf_len += snprintf(buf2, sizeof(buf2),
-                        "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIx64 "\t%" PRIx32 "\t%s"
-                                "\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%d\t%d\t%s\n",
-                        action.c_str(),ls_node_seq, hash_str.c_str(),path_hash_str.c_str(), r_hash_str.c_str(),
-                        router_ip.c_str(), peer_hash_str.c_str(), peer.peer_addr, peer.peer_as, ts.c_str(),
-                        igp_router_id, router_id, node.id, node.bgp_ls_id,node.mt_id, ospf_area_id, isis_area_id,
-                        node.protocol, node.flags, attr.as_path.c_str(), attr.local_pref, attr.med, attr.next_hop, node.name,
-                        peer.isPrePolicy, peer.isAdjIn, node.sr_capabilities_tlv);
-
-        // Cat the entry to the query buff
-        if (buf_len < MSGBUS_WORKING_BUF_SIZE /* size of buf */)
-            strcat(prep_buf, buf2);
+        row_begin = out.length();
+        out.beginRow();
+        out.field(action);
+        out.field(ls_node_seq);
+        out.fieldHash(node.hash_id);
+        out.fieldHash(attr.hash_id);
+        out.fieldHash(peer.router_hash_id);
+        out.field(router_ip);
+        out.fieldHash(peer.hash_id);
+        out.field(peer.peer_addr);
+        out.field(peer.peer_as);
+        out.field(ts);
+        cmp_begin = out.length();
+        out.field(igp_router_id);
+        out.fieldIp(node.isIPv4, node.router_id);
+        out.fieldHex(node.id);
+        out.fieldHex(node.bgp_ls_id);
+        out.field(node.mt_id);
+        out.field(ospf_area_id);
+        out.field(isis_area_id);
+        out.field(node.protocol);
+        out.field(node.flags);
+        out.field(attr.as_path);
+        out.field(attr.local_pref);
+        out.field(attr.med);
+        out.field(attr.next_hop);
+        out.field(node.name);
+        out.field(peer.isPrePolicy);
+        out.field(peer.isAdjIn);
+        out.field(node.sr_capabilities_tlv);
+
+        // Rows that did not change since last published are dropped (linkstate.delta)
+        if (out.endRow() and not lsChanged(p_cache, 'N', node.hash_id, code == LS_ACTION_DEL,
+                                           out.data() + cmp_begin, out.length() - cmp_begin)) {
+            out.truncate(row_begin);
+            --rows;
+            continue;
+        }
 
         ++ls_node_seq;
     }
 
 
-    produce(MSGBUS_TOPIC_VAR_LS_NODE, prep_buf, buf_len, rows, peer_hash_str, &peer_list[peer_hash_str], peer.peer_as);
+    if (rows > 0)
+        produce(MSGBUS_TOPIC_VAR_LS_NODE, TOPIC_IDX_LS_NODE, out.data(), out.length(), rows, peer_hash_str, p_cache, peer.peer_as);
 }
 
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
-void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
+void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<MsgBusInterface::obj_ls_link> &links,
                                  ls_action_code code) {
-    bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    if (not (getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_LS_LINK))
+        return;
+
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_LS_LINK));
 
     char    buf2[8192];                          // Second working buffer
-    int     buf_len = 0;                         // query buffer length
     int     i;
 
-    string hash_str;
-    string r_hash_str;
-    string path_hash_str;
-    string peer_hash_str;
-
-    hash_toStr(peer.router_hash_id, r_hash_str);
-    hash_toStr(attr.hash_id, path_hash_str);
-    hash_toStr(peer.hash_id, peer_hash_str);
+    const string &peer_hash_str = getPeer(peer.hash_id)->hash_str;
 
     string action = "add";
     switch (code) {
@@ -1244,11 +1390,6 @@ void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::l
     string ts;
     getTimestamp(peer.timestamp_secs, peer.timestamp_us, ts);
 
-    string local_node_hash_id;
-    string remote_node_hash_id;
-
-    char intf_ip[46];
-    char nei_ip[46];
     char igp_router_id[46];
     char remote_igp_router_id[46];
     char router_id[46];
@@ -1257,15 +1398,19 @@ void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::l
     char isis_area_id[33] = {0};
     char dr[16];
 
+    peer_cache *p_cache = getPeer(peer.hash_id, peer_hash_str);
+    size_t     row_begin;
+    size_t     cmp_begin;
+
     // Loop through the vector array of entries
     int rows = 0;
-    for (std::list<MsgBusInterface::obj_ls_link>::iterator it = links.begin();
+    for (std::vector<MsgBusInterface::obj_ls_link>::iterator it = links.begin();
          it != links.end(); it++) {
 
         ++rows;
         MsgBusInterface::obj_ls_link &link = (*it);
 
-        MD5 hash;
+        HashEngine hash;
 
         hash.update(link.intf_addr, sizeof(link.intf_addr));
         hash.update(link.nei_addr, sizeof(link.nei_addr));
@@ -1279,18 +1424,10 @@ void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::l
         hash.finalize();
 
         // Save the hash
-        unsigned char *hash_bin = hash.raw_digest();
-        memcpy(link.hash_id, hash_bin, 16);
-        delete[] hash_bin;
-
-        hash_toStr(link.hash_id, hash_str);
-        hash_toStr(link.local_node_hash_id, local_node_hash_id);
-        hash_toStr(link.remote_node_hash_id, remote_node_hash_id);
+        hash.digest(link.hash_id);
 
         int afi = link.isIPv4 ? PF_INET : PF_INET6;
 
-        inet_ntop(afi, link.intf_addr, intf_ip, sizeof(intf_ip));
-        inet_ntop(afi, link.nei_addr, nei_ip, sizeof(nei_ip));
         inet_ntop(afi, link.router_id, router_id, sizeof(router_id));
         inet_ntop(afi, link.remote_router_id, remote_router_id, sizeof(remote_router_id));
 
@@ -1353,52 +1490,88 @@ void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::l
         }
 
 
-        buf_len += snprintf(buf2, sizeof(buf2),
-                "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIx64 "\t%" PRIx32 "\t%s\t%s\t%s\t%s\t%"
-                        PRIu32 "\t%" PRIu32 "\t%s\t%" PRIx32 "\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%" PRIu32 "\t%" PRIu32
-                        "\t%" PRIu32 "\t%" PRIu32 "\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 ""
-                        "\t%" PRIu32 "\t%s\t%d\t%d\t%s\n",
-                            action.c_str(), ls_link_seq, hash_str.c_str(), path_hash_str.c_str(),r_hash_str.c_str(),
-                            router_ip.c_str(), peer_hash_str.c_str(), peer.peer_addr, peer.peer_as, ts.c_str(),
-                            igp_router_id, router_id, link.id, link.bgp_ls_id, ospf_area_id,
-                            isis_area_id, link.protocol, attr.as_path.c_str(), attr.local_pref, attr.med, attr.next_hop,
-                            link.mt_id, link.local_link_id, link.remote_link_id, intf_ip, nei_ip, link.igp_metric,
-                            link.admin_group, link.max_link_bw, link.max_resv_bw, link.unreserved_bw, link.te_def_metric,
-                            link.protection_type, link.mpls_proto_mask, link.srlg, link.name, remote_node_hash_id.c_str(),
-                            local_node_hash_id.c_str(),remote_igp_router_id, remote_router_id,
-                            link.local_node_asn,link.remote_node_asn, link.peer_node_sid, peer.isPrePolicy, peer.isAdjIn,
-                            link.peer_adj_sid);
-
-        // Cat the entry to the query buff
-        if (buf_len < MSGBUS_WORKING_BUF_SIZE /* size of buf */)
-            strcat(prep_buf, buf2);
+        row_begin = out.length();
+        out.beginRow();
+        out.field(action);
+        out.field(ls_link_seq);
+        out.fieldHash(link.hash_id);
+        out.fieldHash(attr.hash_id);
+        out.fieldHash(peer.router_hash_id);
+        out.field(router_ip);
+        out.fieldHash(peer.hash_id);
+        out.field(peer.peer_addr);
+        out.field(peer.peer_as);
+        out.field(ts);
+        cmp_begin = out.length();
+        out.field(igp_router_id);
+        out.field(router_id);
+        out.fieldHex(link.id);
+        out.fieldHex(link.bgp_ls_id);
+        out.field(ospf_area_id);
+        out.field(isis_area_id);
+        out.field(link.protocol);
+        out.field(attr.as_path);
+        out.field(attr.local_pref);
+        out.field(attr.med);
+        out.field(attr.next_hop);
+        out.fieldHex(link.mt_id);
+        out.field(link.local_link_id);
+        out.field(link.remote_link_id);
+        out.fieldIp(link.isIPv4, link.intf_addr);
+        out.fieldIp(link.isIPv4, link.nei_addr);
+        out.field(link.igp_metric);
+        out.field(link.admin_group);
+        out.field(link.max_link_bw);
+        out.field(link.max_resv_bw);
+        out.field(link.unreserved_bw);
+        out.field(link.te_def_metric);
+        out.field(link.protection_type);
+        out.field(link.mpls_proto_mask);
+        out.field(link.srlg);
+        out.field(link.name);
+        out.fieldHash(link.remote_node_hash_id);
+        out.fieldHash(link.local_node_hash_id);
+        out.field(remote_igp_router_id);
+        out.field(remote_router_id);
+        out.field(link.local_node_asn);
+        out.field(link.remote_node_asn);
+        out.field(link.peer_node_sid);
+        out.field(peer.isPrePolicy);
+        out.field(peer.isAdjIn);
+        out.field(link.peer_adj_sid);
+
+        // Rows that did not change since last published are dropped (linkstate.delta)
+        if (out.endRow() and not lsChanged(p_cache, 'L', link.hash_id, code == LS_ACTION_DEL,
+                                           out.data() + cmp_begin, out.length() - cmp_begin)) {
+            out.truncate(row_begin);
+            --rows;
+            continue;
+        }
 
         ++ls_link_seq;
     }
 
-    produce(MSGBUS_TOPIC_VAR_LS_LINK, prep_buf, strlen(prep_buf), rows, peer_hash_str,
-            &peer_list[peer_hash_str], peer.peer_as);
+    if (rows > 0)
+        produce(MSGBUS_TOPIC_VAR_LS_LINK, TOPIC_IDX_LS_LINK, out.data(), out.length(), rows, peer_hash_str,
+                p_cache, peer.peer_as);
 }
 
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
-void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
+void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<MsgBusInterface::obj_ls_prefix> &prefixes,
                                    ls_action_code code) {
-    bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    if (not (getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_LS_PREFIX))
+        return;
+
+    MsgBusWriter out(prep_buf, MSGBUS_WORKING_BUF_SIZE, getFormat(MSGBUS_TOPIC_VAR_LS_PREFIX));
 
     char    buf2[8192];                          // Second working buffer
-    int     buf_len = 0;                         // query buffer length
     int     i;
 
-    string hash_str;
-    string r_hash_str;
-    string path_hash_str;
-    string peer_hash_str;
-
-    hash_toStr(peer.router_hash_id, r_hash_str);
-    hash_toStr(attr.hash_id, path_hash_str);
-    hash_toStr(peer.hash_id, peer_hash_str);
+    const string &peer_hash_str = getPeer(peer.hash_id)->hash_str;
 
     string action = "add";
     switch (code) {
@@ -1413,27 +1586,24 @@ void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std:
     string ts;
     getTimestamp(peer.timestamp_secs, peer.timestamp_us, ts);
 
-    string local_node_hash_id;
-
-    char intf_ip[46];
-    char nei_ip[46];
     char igp_router_id[46];
-    char router_id[46];
-    char ospf_fwd_addr[46];
-    char prefix_ip[46];
     char ospf_area_id[16] = {0};
     char isis_area_id[32] = {0};
     char dr[16];
 
+    peer_cache *p_cache = getPeer(peer.hash_id, peer_hash_str);
+    size_t     row_begin;
+    size_t     cmp_begin;
+
     // Loop through the vector array of entries
     int rows = 0;
-    for (std::list<MsgBusInterface::obj_ls_prefix>::iterator it = prefixes.begin();
+    for (std::vector<MsgBusInterface::obj_ls_prefix>::iterator it = prefixes.begin();
          it != prefixes.end(); it++) {
 
         ++rows;
         MsgBusInterface::obj_ls_prefix &prefix = (*it);
 
-        MD5 hash;
+        HashEngine hash;
 
         hash.update(prefix.prefix_bin, sizeof(prefix.prefix_bin));
         hash.update(&prefix.prefix_len, 1);
@@ -1444,28 +1614,9 @@ void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std:
         hash.finalize();
 
         // Save the hash
-        unsigned char *hash_bin = hash.raw_digest();
-        memcpy(prefix.hash_id, hash_bin, 16);
-        delete[] hash_bin;
+        hash.digest(prefix.hash_id);
 
         // Build the query
-        hash_toStr(prefix.hash_id, hash_str);
-        hash_toStr(prefix.local_node_hash_id, local_node_hash_id);
-
-        if (prefix.isIPv4) {
-            inet_ntop(PF_INET, prefix.intf_addr, intf_ip, sizeof(intf_ip));
-            inet_ntop(PF_INET, prefix.nei_addr, nei_ip, sizeof(nei_ip));
-            inet_ntop(PF_INET, prefix.ospf_fwd_addr, ospf_fwd_addr, sizeof(ospf_fwd_addr));
-            inet_ntop(PF_INET, prefix.prefix_bin, prefix_ip, sizeof(prefix_ip));
-            inet_ntop(PF_INET, prefix.router_id, router_id, sizeof(router_id));
-        } else {
-            inet_ntop(PF_INET6, prefix.intf_addr, intf_ip, sizeof(intf_ip));
-            inet_ntop(PF_INET6, prefix.nei_addr, nei_ip, sizeof(nei_ip));
-            inet_ntop(PF_INET6, prefix.router_id, router_id, sizeof(router_id));
-            inet_ntop(PF_INET6, prefix.ospf_fwd_addr, ospf_fwd_addr, sizeof(ospf_fwd_addr));
-            inet_ntop(PF_INET6, prefix.prefix_bin, prefix_ip, sizeof(prefix_ip));
-        }
-
         if (!strcmp(prefix.protocol, "OSPFv3") or !strcmp(prefix.protocol, "OSPFv2") ) {
             bzero(isis_area_id, sizeof(isis_area_id));
 
@@ -1499,27 +1650,58 @@ void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std:
         }
 
 
-        buf_len += snprintf(buf2, sizeof(buf2),
-                "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIx64 "\t%" PRIx32
-                        "\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%" PRIx32 "\t%s\t%s\t%" PRIu32 "\t%" PRIx64
-                            "\t%s\t%" PRIu32 "\t%s\t%d\t%d\t%d\t%s\n",
-                            action.c_str(), ls_prefix_seq, hash_str.c_str(), path_hash_str.c_str(), r_hash_str.c_str(),
-                            router_ip.c_str(), peer_hash_str.c_str(), peer.peer_addr, peer.peer_as, ts.c_str(),
-                            igp_router_id, router_id, prefix.id, prefix.bgp_ls_id, ospf_area_id, isis_area_id,
-                            prefix.protocol, attr.as_path.c_str(), attr.local_pref, attr.med, attr.next_hop, local_node_hash_id.c_str(),
-                            prefix.mt_id, prefix.ospf_route_type, prefix.igp_flags, prefix.route_tag, prefix.ext_route_tag,
-                            ospf_fwd_addr, prefix.metric, prefix_ip, prefix.prefix_len, peer.isPrePolicy, peer.isAdjIn,
-                            prefix.sid_tlv);
-
-        // Cat the entry to the query buff
-        if (buf_len < MSGBUS_WORKING_BUF_SIZE /* size of buf */)
-            strcat(prep_buf, buf2);
+        row_begin = out.length();
+        out.beginRow();
+        out.field(action);
+        out.field(ls_prefix_seq);
+        out.fieldHash(prefix.hash_id);
+        out.fieldHash(attr.hash_id);
+        out.fieldHash(peer.router_hash_id);
+        out.field(router_ip);
+        out.fieldHash(peer.hash_id);
+        out.field(peer.peer_addr);
+        out.field(peer.peer_as);
+        out.field(ts);
+        cmp_begin = out.length();
+        out.field(igp_router_id);
+        out.fieldIp(prefix.isIPv4, prefix.router_id);
+        out.fieldHex(prefix.id);
+        out.fieldHex(prefix.bgp_ls_id);
+        out.field(ospf_area_id);
+        out.field(isis_area_id);
+        out.field(prefix.protocol);
+        out.field(attr.as_path);
+        out.field(attr.local_pref);
+        out.field(attr.med);
+        out.field(attr.next_hop);
+        out.fieldHash(prefix.local_node_hash_id);
+        out.fieldHex(prefix.mt_id);
+        out.field(prefix.ospf_route_type);
+        out.field(prefix.igp_flags);
+        out.field(prefix.route_tag);
+        out.fieldHex(prefix.ext_route_tag);
+        out.fieldIp(prefix.isIPv4, prefix.ospf_fwd_addr);
+        out.field(prefix.metric);
+        out.fieldIp(prefix.isIPv4, prefix.prefix_bin);
+        out.field(prefix.prefix_len);
+        out.field(peer.isPrePolicy);
+        out.field(peer.isAdjIn);
+        out.field(prefix.sid_tlv);
+
+        // Rows that did not change since last published are dropped (linkstate.delta)
+        if (out.endRow() and not lsChanged(p_cache, 'P', prefix.hash_id, code == LS_ACTION_DEL,
+                                           out.data() + cmp_begin, out.length() - cmp_begin)) {
+            out.truncate(row_begin);
+            --rows;
+            continue;
+        }
 
         ++ls_prefix_seq;
     }
 
-    produce(MSGBUS_TOPIC_VAR_LS_PREFIX, prep_buf, strlen(prep_buf), rows, peer_hash_str,
-            &peer_list[peer_hash_str], peer.peer_as);
+    if (rows > 0)
+        produce(MSGBUS_TOPIC_VAR_LS_PREFIX, TOPIC_IDX_LS_PREFIX, out.data(), out.length(), rows, peer_hash_str,
+                p_cache, peer.peer_as);
 }
 
 /**
@@ -1528,49 +1710,170 @@ void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std:
  * TODO: Consolidate this to single produce method
  */
 void msgBus_kafka::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) {
-    string r_hash_str;
-    string p_hash_str;
-    RdKafka::Topic *topic = NULL;
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
 
-    hash_toStr(peer.hash_id, p_hash_str);
+    // Router messages (e.g. initiation) don't have a peer, the router outputs apply
+    if (not (router_outputs & getPeer(peer.hash_id)->outputs & MSGBUS_OUTPUT_BMP_RAW))
+        return;
+
+    string r_hash_str;
+    const string &p_hash_str = getPeer(peer.hash_id)->hash_str;
     hash_toStr(r_hash, r_hash_str);
 
     if (data_len == 0)
         return;
 
-    while (isConnected == false) {
-        LOG_WARN("rtr=%s: Not connected to Kafka, attempting to reconnect", router_ip.c_str());
-        connect();
-
-        sleep(2);
-    }
+    connect();
 
     char headers[256];
     size_t hdr_len = snprintf(headers, sizeof(headers), "V: %s\nC_HASH_ID: %s\nR_HASH: %s\nR_IP: %s\nL: %lu\n\n",
              MSGBUS_API_VERSION, collector_hash.c_str(), r_hash_str.c_str(), router_ip.c_str(), data_len);
 
-    memcpy(producer_buf, headers, hdr_len);
-    memcpy(producer_buf+hdr_len, data, data_len);
+    if (hdr_len >= sizeof(headers))
+        hdr_len = sizeof(headers) - 1;
 
-    topic = topicSel->getTopic(MSGBUS_TOPIC_VAR_BMP_RAW, &router_group_name, &peer_list[p_hash_str], peer.peer_as);
-    if (topic != NULL) {
-        SELF_DEBUG("rtr=%s: Producing bmp raw message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
-                   topic->name().c_str(), r_hash_str.c_str(), data_len);
+    SELF_DEBUG("rtr=%s: Producing bmp raw message: key=%s, msg size = %lu", router_ip.c_str(),
+               r_hash_str.c_str(), data_len);
 
-        RdKafka::ErrorCode resp = producer->produce(topic, RdKafka::Topic::PARTITION_UA,
-                                                    RdKafka::Producer::RK_MSG_COPY /* Copy payload */,
-                                                    producer_buf, data_len + hdr_len,
-                                                    (const std::string *)&r_hash_str, NULL);
+    // Single copy into a buffer that librdkafka frees
+    char *payload = (char *)malloc(hdr_len + data_len);
+    if (payload == NULL) {
+        LOG_ERR("rtr=%s: Failed to allocate %lu bytes for bmp raw message", router_ip.c_str(), hdr_len + data_len);
+        return;
+    }
+
+    memcpy(payload, headers, hdr_len);
+    memcpy(payload + hdr_len, data, data_len);
 
-        if (resp != RdKafka::ERR_NO_ERROR)
+    peer_cache *p_cache = getPeer(peer.hash_id, p_hash_str);
+
+    RdKafka::ErrorCode resp = kafka->produce(MSGBUS_TOPIC_VAR_BMP_RAW, &router_group_name, &p_cache->group,
+                                             peer.peer_as,
+                                             RdKafka::Producer::RK_MSG_FREE /* librdkafka frees payload */,
+                                             payload, data_len + hdr_len,
+                                             (const std::string *)&r_hash_str, NULL,
+                                             &p_cache->topics[TOPIC_IDX_BMP_RAW]);
+
+    if (resp != RdKafka::ERR_NO_ERROR) {
+        if (resp == RdKafka::ERR__UNKNOWN_TOPIC) {
+            SELF_DEBUG("rtr=%s: failed to produce bmp raw message because topic couldn't be found: topic=%s key=%s, msg size = %lu",
+                       router_ip.c_str(), MSGBUS_TOPIC_VAR_BMP_RAW, r_hash_str.c_str(), data_len);
+        } else
             LOG_ERR("rtr=%s: Failed to produce bmp raw message: %s", router_ip.c_str(), RdKafka::err2str(resp).c_str());
+
+        free(payload);
     }
-    else {
-        SELF_DEBUG("rtr=%s: failed to produce bmp raw message because topic couldn't be found: topic=%s key=%s, msg size = %lu",
-                   router_ip.c_str(), MSGBUS_TOPIC_VAR_BMP_RAW, r_hash_str.c_str(), data_len);
+
+    if (not inBatch)
+        kafka->poll(0);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_kafka::send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len) {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    if (data_len == 0 or not (router_outputs & MSGBUS_OUTPUT_BMP_RAW))
+        return;
+
+    string r_hash_str;
+    hash_toStr(r_hash, r_hash_str);
+
+    connect();
+
+    char headers[256];
+    size_t hdr_len = snprintf(headers, sizeof(headers), "V: %s\nC_HASH_ID: %s\nR_HASH: %s\nR_IP: %s\nL: %lu\n\n",
+             MSGBUS_API_VERSION, collector_hash.c_str(), r_hash_str.c_str(), router_ip.c_str(), data_len);
+
+    if (hdr_len >= sizeof(headers))
+        hdr_len = sizeof(headers) - 1;
+
+    SELF_DEBUG("rtr=%s: Producing bmp raw batch: key=%s, size = %lu", router_ip.c_str(),
+               r_hash_str.c_str(), data_len);
+
+    // Single copy into a buffer that librdkafka frees, the reader buffer is reused
+    char *payload = (char *)malloc(hdr_len + data_len);
+    if (payload == NULL) {
+        LOG_ERR("rtr=%s: Failed to allocate %lu bytes for bmp raw batch", router_ip.c_str(), hdr_len + data_len);
+        return;
     }
 
-    producer->poll(0);
+    memcpy(payload, headers, hdr_len);
+    memcpy(payload + hdr_len, data, data_len);
+
+    RdKafka::ErrorCode resp = kafka->produce(MSGBUS_TOPIC_VAR_BMP_RAW, &router_group_name, NULL, peer_asn,
+                                             RdKafka::Producer::RK_MSG_FREE, payload, data_len + hdr_len,
+                                             (const std::string *)&r_hash_str, NULL);
+
+    if (resp != RdKafka::ERR_NO_ERROR) {
+        if (resp == RdKafka::ERR__UNKNOWN_TOPIC) {
+            SELF_DEBUG("rtr=%s: failed to produce bmp raw batch because topic couldn't be found: topic=%s key=%s, size = %lu",
+                       router_ip.c_str(), MSGBUS_TOPIC_VAR_BMP_RAW, r_hash_str.c_str(), data_len);
+        } else
+            LOG_ERR("rtr=%s: Failed to produce bmp raw batch: %s", router_ip.c_str(), RdKafka::err2str(resp).c_str());
+
+        free(payload);
+    }
+
+    if (not inBatch)
+        kafka->poll(0);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+bool msgBus_kafka::rawByPeerAsn() {
+    return raw_by_peer_asn;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+uint32_t msgBus_kafka::getRouterOutputs() {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    return router_outputs;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+uint32_t msgBus_kafka::getPeerOutputs(const u_char *peer_hash) {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    return getPeer(peer_hash)->outputs;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_kafka::beginBatch() {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    inBatch = true;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ *
+ * \details Services the producer once for everything produced in the batch
+ */
+void msgBus_kafka::endBatch() {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    inBatch = false;
+
+    kafka->poll(0);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_kafka::flush() {
+    std::lock_guard<std::recursive_mutex> lock(bus_mutex);
+
+    flushCoalesced();
 }
 
 /**
@@ -1579,50 +1882,25 @@ void msgBus_kafka::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data
 *  \param [in]   name      String name (ip address)
 *  \param [out]  hostname  String reference for hostname
 *
+*  \details Lookups are cached and bounded by resolver.timeout, see HostResolver
+*
 *  \returns true if error, false if no error
 */
 bool msgBus_kafka::resolveIp(string name, string &hostname) {
-    addrinfo *ai;
-    char host[255];
-
-    if (!getaddrinfo(name.c_str(), NULL, NULL, &ai)) {
-
-        if (!getnameinfo(ai->ai_addr,ai->ai_addrlen, host, sizeof(host), NULL, 0, NI_NAMEREQD)) {
-            hostname.assign(host);
-            LOG_INFO("resolve: %s to %s", name.c_str(), hostname.c_str());
-        }
-
-        freeaddrinfo(ai);
-        return false;
-    }
-
-    return true;
+    return not HostResolver::resolve(name, hostname);
 }
 
 /*
  * Enable/disable debugs
  */
 void msgBus_kafka::enableDebug() {
-    string value = "all";
-    string errstr;
-
-    disconnect();
-
-    if (conf->set("debug", value, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to enable debug on kafka producer confg: %s", errstr.c_str());
-    }
-
-    connect();
+    kafka->enableDebug();
 
     debug = true;
-
 }
-void msgBus_kafka::disableDebug() {
-    string errstr;
-    string value = "";
 
-    if (conf)
-        conf->set("debug", value, errstr);
+void msgBus_kafka::disableDebug() {
+    kafka->disableDebug();
 
     debug = false;
 }
@@ -22,22 +22,36 @@
 #include <librdkafka/rdkafkacpp.h>
 
 #include <thread>
+#include <mutex>
 #include "safeQueue.hpp"
-#include "KafkaEventCallback.h"
-#include "KafkaDeliveryReportCallback.h"
+#include "MsgBusWriter.hpp"
+#include "KafkaBufferPool.h"
+#include "KafkaProducer.h"
+#include "KafkaProducerPool.h"
 #include "KafkaTopicSelector.h"
 
 #include "Config.h"
+#include "HashEngine.h"
 
 /**
  * \class   msgBus_kafka
  *
  * \brief   Kafka message bus implementation
+ * \details The update methods are serialized by a per router lock, so that BGP messages
+ *          of the router can be decoded by more than one thread (see ParsePipeline).
+ *
+ *          The rows of consecutive messages of a peer are coalesced per topic into one kafka
+ *          message, up to kafka.coalesce.max.bytes or kafka.coalesce.max.ms.  The held rows
+ *          are produced before any collector, router or peer message and when the reader is
+ *          idle (flush()), so the rows of a peer keep their order with its state messages.
+ *          coalesce.max.ms is checked when rows are added; rows added by another thread (a
+ *          RibResync chunk) are flushed by that thread, the reader may be idle meanwhile.
   */
 class msgBus_kafka: public MsgBusInterface {
 public:
     #define MSGBUS_WORKING_BUF_SIZE         1800000
-    #define MSGBUS_API_VERSION              "1.6"
+    #define MSGBUS_HDR_RESERVE              256         ///< Space reserved in front of prep_buf for the message header
+    #define MSGBUS_API_VERSION              "1.7"
 
     /******************************************************************//**
      * \brief This function will initialize and connect to Kafka.
@@ -47,8 +61,12 @@ public:
      *  \param [in] logPtr      Pointer to Logger instance
      *  \param [in] cfg         Pointer to the config instance
      *  \param [in] c_hash_id   Collector Hash ID
+     *  \param [in] pool        Shared producer pool, NULL to use a dedicated producer
+     *  \param [in] priority    Shared producer of the collector, router and peer messages,
+     *                          NULL to use the same producer as the other messages
      ********************************************************************/
-    msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id);
+    msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id, KafkaProducerPool *pool=NULL,
+                 KafkaProducer *priority=NULL);
     ~msgBus_kafka();
 
     /*
@@ -62,11 +80,11 @@ public:
     void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr, unicast_prefix_action_code code);
     void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats);
 
-    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<MsgBusInterface::obj_ls_node> &nodes,
                      ls_action_code code);
-    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_link> &links,
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<MsgBusInterface::obj_ls_link> &links,
                      ls_action_code code);
-    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<MsgBusInterface::obj_ls_prefix> &prefixes,
                       ls_action_code code);
     
     void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code);
@@ -74,14 +92,22 @@ public:
     void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code);
 
     void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len);
+    void send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len);
+    bool rawByPeerAsn();
+    uint32_t getRouterOutputs();
+    uint32_t getPeerOutputs(const u_char *peer_hash);
+
+    void beginBatch();
+    void endBatch();
+    void flush();
 
     // Debug methods
     void enableDebug();
     void disableDebug();
 
-private:
-    char            *prep_buf;                  ///< Large working buffer for message preparation
-    unsigned char   *producer_buf;              ///< Producer message buffer
+protected:
+    char            *prep_buf;                  ///< Large working buffer for message preparation (in prep_block)
+    char            *prep_block;                ///< Pool buffer holding the header reserve and prep_buf
     bool            debug;                      ///< debug flag to indicate debugging
     Logger          *logger;                    ///< Logging class pointer
 
@@ -101,57 +127,201 @@ private:
 
     Config          *cfg;                       ///< Pointer to config instance
 
+    KafkaProducer     *kafka;                   ///< Kafka producer, dedicated or shared from producer_pool
+    KafkaProducerPool *producer_pool;           ///< Pool the producer was acquired from, NULL if dedicated
+    KafkaProducer     *priority_kafka;          ///< Producer of the collector, router and peer messages, NULL if kafka
+
+    bool inBatch;                               ///< Indicates a batch is active, producer is polled at end of batch
+
+    std::recursive_mutex bus_mutex;             ///< Serializes the update methods, guards the buffers, sequences and peer_list
+
     /**
-     * Kafka Configuration object (global)
+     * Peer level topics, index into peer_cache::topics
      */
-    RdKafka::Conf   *conf;
-
-    RdKafka::Producer *producer;                ///< Kafka Producer instance
+    enum topic_idx {
+        TOPIC_IDX_PEER=0,
+        TOPIC_IDX_BMP_STAT,
+        TOPIC_IDX_BMP_RAW,
+        TOPIC_IDX_BASE_ATTRIBUTE,
+        TOPIC_IDX_UNICAST_PREFIX,
+        TOPIC_IDX_L3VPN,
+        TOPIC_IDX_EVPN,
+        TOPIC_IDX_LS_NODE,
+        TOPIC_IDX_LS_LINK,
+        TOPIC_IDX_LS_PREFIX,
+        TOPIC_IDX_MAX                           ///< Number of topics, used for non-peer topics
+    };
 
     /**
-     * Callback handlers
+     * Per peer state, the topics are resolved on first use and reset on peer up
      */
-    KafkaEventCallback              *event_callback;
-    KafkaDeliveryReportCallback     *delivery_callback;
+    /**
+     * Last published BGP-LS row, used by linkstate.delta
+     */
+    struct ls_row {
+        u_char      digest[HASH_ENGINE_DIGEST_SIZE];            ///< Hash of the row fields after the timestamp
+        time_t      published;                                  ///< Time the row was last published
+    };
+
+    struct coalesce_buf;
+
+    struct peer_cache {
+        std::string                 hash_str;                   ///< Peer hash ID in printed format, the peer_list key
+        std::string                 group;                      ///< Peer group name - empty if not matched
+        uint32_t                    outputs;                    ///< MSGBUS_OUTPUT_* bits of the peer, set with the group
+        KafkaProducer::TopicCache   topics[TOPIC_IDX_MAX];      ///< Resolved topics by topic_idx
+        std::map<std::string, ls_row> ls_rows;                  ///< Published BGP-LS rows by record type and hash ID
+        coalesce_buf                *pending[TOPIC_IDX_MAX];    ///< Coalesced rows by topic_idx, NULL if none
+
+        peer_cache() {
+            outputs = MSGBUS_OUTPUT_ALL;
+            bzero(pending, sizeof(pending));
+            resetTopics();
+        }
+
+        void resetTopics() {
+            bzero(topics, sizeof(topics));
+        }
+    };
 
-    bool isConnected;                           ///< Indicates if Kafka is connected or not
+    /**
+     * Rows of a peer topic held back to be produced as one message
+     */
+    struct coalesce_buf {
+        peer_cache                  *peer;                      ///< Peer of the rows
+        topic_idx                   idx;                        ///< Topic of the rows
+        const char                  *topic_var;                 ///< Topic var of the rows
+        uint32_t                    peer_asn;                   ///< Peer ASN
+        int                         rows;                       ///< Number of rows in data
+        std::string                 data;                       ///< Encoded rows
+    };
 
     // array of hashes
-    std::map<std::string, std::string> peer_list;
-    typedef std::map<std::string, std::string>::iterator peer_list_iter;
+    std::map<std::string, peer_cache> peer_list;
+    typedef std::map<std::string, peer_cache>::iterator peer_list_iter;
+
+    peer_cache  *last_peer;                     ///< Last peer returned by getPeer(), NULL if none
+    u_char      last_peer_hash[16];             ///< Hash ID of last_peer
 
     std::string router_ip;                      ///< Router IP in printed format
     u_char      router_hash[16];                ///< Router Hash in binary format
+    std::string router_hash_str;                ///< Router Hash in printed format, empty until the router is known
+    bool        use_router_key;                 ///< Key peer level messages by router_hash_str instead of the peer hash
+    bool        raw_by_peer_asn;                ///< bmp_raw topic name includes the peer ASN
     std::string router_group_name;              ///< Router group name - if matched
+    uint32_t    router_outputs;                 ///< MSGBUS_OUTPUT_* bits of the router, set with the router group
+
+    size_t      coalesce_max_bytes;             ///< Max size of a coalesced message, 0 if not coalesced
+    uint64_t    coalesce_max_ms;                ///< Max ms rows are held back
+    uint64_t    coalesce_since;                 ///< Monotonic ms of the oldest held rows
+    size_t      zero_copy_min_bytes;            ///< Messages this size or larger are produced without copy, 0 is never
+    bool        rd_rfc4364;                     ///< Print the route distinguishers as administrator:assigned number
+    std::vector<coalesce_buf *> coalesce_list;  ///< Held rows, in order of their first row
+    std::vector<coalesce_buf *> coalesce_free;  ///< Buffers not in use, reused by the next held rows
 
+    std::map<std::string, MsgBusWriter::Format> topic_format;  ///< Row encoding by topic var, only non-TSV topics are listed
+    typedef std::map<std::string, MsgBusWriter::Format>::iterator topic_format_iter;
 
-    std::map<std::string, RdKafka::Topic*> topic;
+    /**
+     * Connects to kafka broker, waits until connected
+     *
+     * \details Doesn't wait if the producer is spooled, see KafkaSpool.
+     *
+     * \param [in] producer     Producer to connect, NULL is kafka
+     */
+    void connect(KafkaProducer *producer=NULL);
 
-    KafkaTopicSelector *topicSel;               ///< Kafka topic selector/handler
+    /**
+     * Row encoding of a topic
+     *
+     * \param [in] topic_var     Topic var MSGBUS_TOPIC_VAR_*
+     *
+     * \return Format configured for the topic, TSV if not configured
+     */
+    MsgBusWriter::Format getFormat(const char *topic_var);
 
     /**
-     * Connects to kafka broker
+     * Get the cached state of a peer
+     *
+     * \param [in] hash_id       Peer hash ID (binary)
+     * \param [in] p_hash_str    Peer hash ID in printed format, the peer_list key
+     *
+     * \return pointer to the peer_list entry, valid until the peer is erased
      */
-    void connect();
+    peer_cache *getPeer(const u_char *hash_id, const std::string &p_hash_str);
 
     /**
-     * Disconnects from kafka broker
+     * Get the cached state of a peer, the hash ID is printed only if it's not the last peer
+     *
+     * \param [in] hash_id       Peer hash ID (binary)
+     *
+     * \return pointer to the peer_list entry, valid until the peer is erased
      */
-    void disconnect(int wait_ms=2000);
+    peer_cache *getPeer(const u_char *hash_id);
 
     /**
      * produce message to Kafka
      *
+     * \details Virtual so the row encoders can be measured without a broker, see bench/bgp_microbench.cpp
+     *
+     * \param [in] topic_var     Topic var to use in KafkaTopicSelector::getTopic()
+     * \param [in] idx           Index of the topic in the peer topic cache, not used if peer is NULL
+     * \param [in] msg           message to produce
+     * \param [in] msg_size      Length in bytes of the message
+     * \param [in] rows          Number of rows in data
+     * \param [in] key           Hash key
+     * \param [in] peer          Peer of the message - NULL if not a peer message
+     * \param [in] peer_asn      Peer ASN
+     * \param [in] priority      True to use priority_kafka, if set
+     */
+    virtual void produce(const char *topic_var, topic_idx idx, char *msg, size_t msg_size, int rows,
+                         const std::string &key, peer_cache *peer, uint32_t peer_asn, bool priority=false);
+
+    /**
+     * Send a message to the producer, with its header
+     *
      * \param [in] topic_var     Topic var to use in KafkaTopicSelector::getTopic()
+     * \param [in] idx           Index of the topic in the peer topic cache, not used if peer is NULL
      * \param [in] msg           message to produce
      * \param [in] msg_size      Length in bytes of the message
      * \param [in] rows          Number of rows in data
      * \param [in] key           Hash key
-     * \param [in] peer_group    Peer group name - empty/NULL if not set or used
+     * \param [in] peer          Peer of the message - NULL if not a peer message
      * \param [in] peer_asn      Peer ASN
+     * \param [in] priority      True to use priority_kafka, if set
+     */
+    void send(const char *topic_var, topic_idx idx, char *msg, size_t msg_size, int rows,
+              const std::string &key, peer_cache *peer, uint32_t peer_asn, bool priority);
+
+    /**
+     * Produce the held rows of a peer topic
+     *
+     * \param [in] buf           Held rows, returned to coalesce_free
+     */
+    void flushCoalesced(coalesce_buf *buf);
+
+    /**
+     * Produce all held rows, in order of their first row
+     */
+    void flushCoalesced();
+
+    /**
+     * Check if a BGP-LS row should be published
+     *
+     * \details With linkstate.delta the row is compared with the last published row of the
+     *          same node, link or prefix.  Withdrawn records are always published.
+     *
+     * \param [in] peer          Peer of the row
+     * \param [in] type          Record type; 'N' node, 'L' link or 'P' prefix
+     * \param [in] hash_id       Hash ID of the record
+     * \param [in] remove        True if the record is withdrawn
+     * \param [in] data          Row fields to compare, everything after the timestamp
+     * \param [in] len           Length of data in bytes
+     *
+     * \return true if the row should be published, false if it's unchanged
      */
-    void produce(const char *topic_var, char *msg, size_t msg_size, int rows,
-                 std::string key, const std::string *peer_group, uint32_t);
+    bool lsChanged(peer_cache *peer, char type, const u_char *hash_id, bool remove,
+                   const char *data, size_t len);
 
     /**
     * \brief Method to resolve the IP address to a hostname
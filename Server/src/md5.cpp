@@ -45,6 +45,8 @@ documentation and/or software.
 
 #include <assert.h>
 #include <strings.h>
+#include <string.h>
+#include <endian.h>
 #include <iostream>
 
 using namespace std;
@@ -239,6 +241,32 @@ MD5::MD5(ifstream& stream){
 
 
 
+// Copy the digest to a caller supplied 16 byte buffer, avoids the allocation
+// of raw_digest().
+
+void MD5::raw_digest(unsigned char *out){
+
+  if (!finalized){
+    cerr << "MD5::raw_digest:  Can't get digest if you haven't "<<
+      "finalized the digest!" <<endl;
+    ::memset(out, 0, 16);
+    return;
+  }
+
+  ::memcpy(out, digest, 16);
+}
+
+
+
+// Reset the context to start a new digest
+
+void MD5::reset(){
+
+  init();
+}
+
+
+
 unsigned char *MD5::raw_digest(){
 
   uint1 *s = new uint1[16];
@@ -416,9 +444,7 @@ void MD5::transform (uint1 block[64]){
   state[2] += c;
   state[3] += d;
 
-  // Zeroize sensitive information.
-  memset ( (uint1 *) x, 0, sizeof(x));
-
+  // Hash ids are not secret, so x is not zeroized here
 }
 
 
@@ -444,35 +470,32 @@ void MD5::encode (uint1 *output, uint4 *input, uint4 len) {
 // a multiple of 4.
 void MD5::decode (uint4 *output, uint1 *input, uint4 len){
 
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+  // Byte order already matches, also handles unaligned input
+  ::memcpy(output, input, len);
+#else
   unsigned int i, j;
 
   for (i = 0, j = 0; j < len; i++, j += 4)
     output[i] = ((uint4)input[j]) | (((uint4)input[j+1]) << 8) |
       (((uint4)input[j+2]) << 16) | (((uint4)input[j+3]) << 24);
+#endif
 }
 
 
 
 
 
-// Note: Replace "for loop" with standard memcpy if possible.
 void MD5::memcpy (uint1 *output, uint1 *input, uint4 len){
 
-  unsigned int i;
-
-  for (i = 0; i < len; i++)
-    output[i] = input[i];
+  ::memcpy(output, input, len);
 }
 
 
 
-// Note: Replace "for loop" with standard memset if possible.
 void MD5::memset (uint1 *output, uint1 value, uint4 len){
 
-  unsigned int i;
-
-  for (i = 0; i < len; i++)
-    output[i] = value;
+  ::memset(output, value, len);
 }
 
 
@@ -56,6 +56,7 @@ public:
   void  update     (FILE *file);
   void  update     (ifstream& stream);
   void  finalize   ();
+  void  reset      ();  // start a new digest, reuses the context
 
 // constructors for special circumstances.  All these constructors finalize
 // the MD5 context.
@@ -66,6 +67,7 @@ public:
 
 // methods to acquire finalized result
   unsigned char    *raw_digest ();  // digest as a 16-byte binary array
+  void              raw_digest (unsigned char *out);  // copy digest to out[16], no allocation
   char *            hex_digest ();  // digest as a 33-byte ascii-hex string
   friend ostream&   operator<< (ostream&, MD5 context);
 
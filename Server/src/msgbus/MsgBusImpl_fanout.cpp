@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include "MsgBusImpl_fanout.h"
+
+using namespace std;
+
+/**
+ * Constructor
+ *
+ * \param [in] buses    Message buses to send to, freed by the destructor
+ */
+msgBus_fanout::msgBus_fanout(const std::vector<MsgBusInterface *> &buses) {
+    this->buses = buses;
+    ribSeq = 0;
+}
+
+/**
+ * Destructor, frees the message buses
+ */
+msgBus_fanout::~msgBus_fanout() {
+    for (size_t i = 0; i < buses.size(); i++)
+        delete buses[i];
+
+    buses.clear();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_Collector(obj_collector &c_obj, collector_action_code action_code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_Collector(c_obj, action_code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_Router(obj_router &r_object, router_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_Router(r_object, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_Peer(peer, up, down, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_baseAttribute(peer, attr, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                                         unicast_prefix_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_unicastPrefix(peer, rib, attr, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->add_StatReport(peer, stats);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_node> &nodes,
+                                  ls_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_LsNode(peer, attr, nodes, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_link> &links,
+                                  ls_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_LsLink(peer, attr, links, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_prefix> &prefixes,
+                                    ls_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_LsPrefix(peer, attr, prefixes, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr,
+                                 vpn_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_L3Vpn(peer, vpn, attr, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr,
+                                vpn_action_code code) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->update_eVPN(peer, vpn, attr, code);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->send_bmp_raw(r_hash, peer, data, data_len);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len) {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->send_bmp_raw_batch(r_hash, peer_asn, data, data_len);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::beginBatch() {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->beginBatch();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::endBatch() {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->endBatch();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_fanout::flush() {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->flush();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+bool msgBus_fanout::rawByPeerAsn() {
+    for (size_t i = 0; i < buses.size(); i++) {
+        if (buses[i]->rawByPeerAsn())
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+uint32_t msgBus_fanout::getRouterOutputs() {
+    uint32_t outputs = 0;
+
+    // Decoded if any of the buses produces it
+    for (size_t i = 0; i < buses.size(); i++)
+        outputs |= buses[i]->getRouterOutputs();
+
+    return outputs;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+uint32_t msgBus_fanout::getPeerOutputs(const u_char *peer_hash) {
+    uint32_t outputs = 0;
+
+    for (size_t i = 0; i < buses.size(); i++)
+        outputs |= buses[i]->getPeerOutputs(peer_hash);
+
+    return outputs;
+}
+
+/*
+ * Enable/Disable debug
+ */
+void msgBus_fanout::enableDebug() {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->enableDebug();
+}
+
+void msgBus_fanout::disableDebug() {
+    for (size_t i = 0; i < buses.size(); i++)
+        buses[i]->disableDebug();
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MSGBUSIMPL_NULL_H_
+#define MSGBUSIMPL_NULL_H_
+
+#include "MsgBusInterface.hpp"
+
+/**
+ * \class   msgBus_null
+ *
+ * \brief   Message bus that discards everything
+ * \details Used to measure the cost of reading and parsing alone, nothing is encoded
+ *          or sent.  Selected with msgbus.backend: null.
+ */
+class msgBus_null: public MsgBusInterface {
+public:
+    msgBus_null() {
+        ribSeq = 0;
+    }
+
+    /*
+     * abstract methods implemented
+     * See MsgBusInterface.hpp for method details
+     */
+    void update_Collector(struct obj_collector &c_obj, collector_action_code action_code) { }
+    void update_Router(struct obj_router &r_entry, router_action_code code) { }
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code) { }
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) { }
+    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                              unicast_prefix_action_code code) { }
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) { }
+
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_node> &nodes,
+                       ls_action_code code) { }
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_link> &links,
+                       ls_action_code code) { }
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_prefix> &prefixes,
+                         ls_action_code code) { }
+
+    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code) { }
+    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code) { }
+
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) { }
+    void send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len) { }
+};
+
+#endif /* MSGBUSIMPL_NULL_H_ */
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MsgBusImpl_shm.h"
+
+using namespace std;
+
+#define SHM_ALIGN(len)      (((len) + 7) & ~(size_t)7)
+#define SHM_HDR_SIZE        SHM_ALIGN(sizeof(shm_ring))
+
+/**
+ * Constructor, creates and maps the ring
+ *
+ * \param [in] logPtr       Pointer to Logger instance
+ * \param [in] cfg          Pointer to the config instance
+ * \param [in] router_hash  Router hash ID, NULL for the collector bus
+ *
+ * \throw (const char *) if the ring can't be created
+ */
+msgBus_shm::msgBus_shm(Logger *logPtr, Config *cfg, const u_char *router_hash) {
+    logger = logPtr;
+    debug = false;
+    ribSeq = 0;
+    seq = 0;
+    pending = 0;
+
+    name = cfg->msgbus_shm_prefix;
+    if (router_hash != NULL) {
+        string hash_str;
+        hash_toStr(router_hash, hash_str);
+        name.append(hash_str);
+    } else
+        name.append("collector");
+
+    size_t size = cfg->msgbus_shm_size & ~(size_t)7;
+    map_size = SHM_HDR_SIZE + size;
+
+    // A ring left by a previous session of the router is replaced
+    shm_unlink(name.c_str());
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        LOG_ERR("Failed to create shm ring %s: %s", name.c_str(), strerror(errno));
+        throw "ERROR: Failed to create shm ring";
+    }
+
+    if (ftruncate(fd, map_size) != 0) {
+        LOG_ERR("Failed to size shm ring %s to %lu bytes: %s", name.c_str(), map_size, strerror(errno));
+        close(fd);
+        shm_unlink(name.c_str());
+        throw "ERROR: Failed to size shm ring";
+    }
+
+    void *ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (ptr == MAP_FAILED) {
+        LOG_ERR("Failed to map shm ring %s: %s", name.c_str(), strerror(errno));
+        shm_unlink(name.c_str());
+        throw "ERROR: Failed to map shm ring";
+    }
+
+    // ftruncate zero fills, only the non-zero fields are set
+    ring = new (ptr) shm_ring;
+    ring->version = MSGBUS_SHM_VERSION;
+    ring->hdr_size = SHM_HDR_SIZE;
+    ring->size = size;
+    if (router_hash != NULL)
+        memcpy(ring->router_hash, router_hash, sizeof(ring->router_hash));
+
+    ring_data = (u_char *)ptr + SHM_HDR_SIZE;
+
+    // Consumers check magic last, the header is complete once it's set
+    atomic_thread_fence(memory_order_release);
+    ring->magic = MSGBUS_SHM_MAGIC;
+
+    LOG_INFO("Writing decoded messages to shm ring %s of %lu bytes", name.c_str(), size);
+}
+
+/**
+ * Destructor, flags the ring closed and unlinks it
+ */
+msgBus_shm::~msgBus_shm() {
+    ring->closed.store(1, memory_order_release);
+
+    munmap(ring, map_size);
+    shm_unlink(name.c_str());
+}
+
+/**
+ * Reserve space for a record
+ *
+ * \param [in] type         Record type
+ * \param [in] action       Action code
+ * \param [in] body_len     Length of the record body
+ *
+ * \return Pointer to the record body, NULL if the record doesn't fit and was dropped
+ */
+u_char *msgBus_shm::reserve(shm_rec_type type, uint8_t action, size_t body_len) {
+    size_t len = SHM_ALIGN(sizeof(shm_rec) + body_len);
+    uint64_t head = ring->head.load(memory_order_relaxed);
+    uint64_t used = head - ring->tail.load(memory_order_acquire);
+
+    size_t off = head % ring->size;
+    size_t skip = 0;
+
+    // Records don't wrap, the rest of the data is skipped
+    if (off + len > ring->size)
+        skip = ring->size - off;
+
+    if (len > UINT32_MAX or used + skip + len > ring->size) {
+        ring->dropped.fetch_add(1, memory_order_relaxed);
+        SELF_DEBUG("shm ring %s is full, dropped record type %d of %lu bytes", name.c_str(), type, len);
+        return NULL;
+    }
+
+    if (skip >= sizeof(shm_rec)) {
+        shm_rec *pad = (shm_rec *)(ring_data + off);
+        pad->len = skip;
+        pad->type = SHM_REC_PAD;
+        pad->action = 0;
+        pad->seq = seq;
+    }
+
+    if (skip > 0)
+        off = 0;
+
+    shm_rec *rec = (shm_rec *)(ring_data + off);
+    rec->len = len;
+    rec->type = type;
+    rec->action = action;
+    rec->reserved = 0;
+    rec->seq = seq;
+
+    pending = head + skip + len;
+
+    return (u_char *)(rec + 1);
+}
+
+/**
+ * Publish the record returned by the last reserve()
+ */
+void msgBus_shm::commit() {
+    ++seq;
+    ring->head.store(pending, memory_order_release);
+}
+
+/**
+ * Length of the encoded path attributes
+ */
+size_t msgBus_shm::attrLen(obj_path_attr &attr) {
+    return SHM_ALIGN(sizeof(shm_attr) + 5 * sizeof(uint32_t) + attr.as_path.size() + attr.community_list.size() +
+                     attr.ext_community_list.size() + attr.large_community_list.size() + attr.cluster_list.size());
+}
+
+/**
+ * Encode path attributes
+ *
+ * \param [out] buf     Buffer of at least attrLen() bytes
+ * \param [in]  attr    Path attributes
+ */
+void msgBus_shm::writeAttr(u_char *buf, obj_path_attr &attr) {
+    shm_attr *a = (shm_attr *)buf;
+
+    a->len = attrLen(attr);
+    a->origin_as = attr.origin_as;
+    a->med = attr.med;
+    a->local_pref = attr.local_pref;
+    a->as_path_count = attr.as_path_count;
+    a->nexthop_isIPv4 = attr.nexthop_isIPv4;
+    a->atomic_agg = attr.atomic_agg;
+    memcpy(a->hash_id, attr.hash_id, sizeof(a->hash_id));
+    memcpy(a->origin, attr.origin, sizeof(a->origin));
+    memcpy(a->next_hop, attr.next_hop, sizeof(a->next_hop));
+    memcpy(a->aggregator, attr.aggregator, sizeof(a->aggregator));
+    memcpy(a->originator_id, attr.originator_id, sizeof(a->originator_id));
+
+    const string *strs[] = { &attr.as_path, &attr.community_list, &attr.ext_community_list,
+                             &attr.large_community_list, &attr.cluster_list };
+
+    u_char *p = buf + sizeof(shm_attr);
+    for (int i = 0; i < 5; i++) {
+        uint32_t len = strs[i]->size();
+
+        memcpy(p, &len, sizeof(len));
+        memcpy(p + sizeof(len), strs[i]->data(), len);
+        p += sizeof(len) + len;
+    }
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_shm::update_Collector(obj_collector &c_obj, collector_action_code action_code) {
+    lock_guard<mutex> lock(bus_mutex);
+
+    u_char *body = reserve(SHM_REC_COLLECTOR, action_code, sizeof(c_obj));
+    if (body == NULL)
+        return;
+
+    memcpy(body, &c_obj, sizeof(c_obj));
+    commit();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_shm::update_Router(obj_router &r_object, router_action_code code) {
+    lock_guard<mutex> lock(bus_mutex);
+
+    u_char *body = reserve(SHM_REC_ROUTER, code, sizeof(r_object));
+    if (body == NULL)
+        return;
+
+    memcpy(body, &r_object, sizeof(r_object));
+    commit();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_shm::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down,
+                             peer_action_code code) {
+    lock_guard<mutex> lock(bus_mutex);
+
+    size_t event_len = 0;
+    if (code == PEER_ACTION_UP and up != NULL)
+        event_len = sizeof(*up);
+    else if (code == PEER_ACTION_DOWN and down != NULL)
+        event_len = sizeof(*down);
+
+    u_char *body = reserve(SHM_REC_PEER, code, sizeof(peer) + event_len);
+    if (body == NULL)
+        return;
+
+    memcpy(body, &peer, sizeof(peer));
+    if (event_len > 0)
+        memcpy(body + sizeof(peer), code == PEER_ACTION_UP ? (void *)up : (void *)down, event_len);
+
+    commit();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_shm::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code) {
+    lock_guard<mutex> lock(bus_mutex);
+
+    u_char *body = reserve(SHM_REC_BASE_ATTR, code, sizeof(shm_peer_ref) + attrLen(attr));
+    if (body == NULL)
+        return;
+
+    memcpy(body, peer.hash_id, sizeof(shm_peer_ref));
+    writeAttr(body + sizeof(shm_peer_ref), attr);
+    commit();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_shm::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                                      unicast_prefix_action_code code) {
+    if (rib.size() == 0)
+        return;
+
+    lock_guard<mutex> lock(bus_mutex);
+
+    size_t attr_len = attr != NULL ? attrLen(*attr) : 0;
+    u_char *body = reserve(SHM_REC_UNICAST_PREFIX, code,
+                           sizeof(shm_prefix_hdr) + attr_len + rib.size() * sizeof(shm_prefix));
+    if (body == NULL)
+        return;
+
+    shm_prefix_hdr *hdr = (shm_prefix_hdr *)body;
+    memcpy(hdr->peer_hash, peer.hash_id, sizeof(hdr->peer_hash));
+    hdr->count = rib.size();
+    hdr->has_attr = attr != NULL;
+    bzero(hdr->reserved, sizeof(hdr->reserved));
+
+    u_char *p = body + sizeof(shm_prefix_hdr);
+    if (attr != NULL) {
+        writeAttr(p, *attr);
+        p += attr_len;
+    }
+
+    shm_prefix *prefix = (shm_prefix *)p;
+    for (size_t i = 0; i < rib.size(); i++, prefix++) {
+        memcpy(prefix->prefix_bin, rib[i].prefix_bin, sizeof(prefix->prefix_bin));
+        prefix->path_id = rib[i].path_id;
+        prefix->prefix_len = rib[i].prefix_len;
+        prefix->isIPv4 = rib[i].isIPv4;
+        prefix->reserved[0] = prefix->reserved[1] = 0;
+    }
+
+    ribSeq += rib.size();
+    commit();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_shm::add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
+    lock_guard<mutex> lock(bus_mutex);
+
+    u_char *body = reserve(SHM_REC_STATS, 0, sizeof(shm_peer_ref) + sizeof(stats));
+    if (body == NULL)
+        return;
+
+    memcpy(body, peer.hash_id, sizeof(shm_peer_ref));
+    memcpy(body + sizeof(shm_peer_ref), &stats, sizeof(stats));
+    commit();
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_shm::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) {
+    send_bmp_raw_batch(r_hash, peer.peer_as, data, data_len);
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_shm::send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len) {
+    lock_guard<mutex> lock(bus_mutex);
+
+    u_char *body = reserve(SHM_REC_BMP_RAW, 0, sizeof(shm_raw) + data_len);
+    if (body == NULL)
+        return;
+
+    shm_raw *raw = (shm_raw *)body;
+    raw->peer_asn = peer_asn;
+    raw->data_len = data_len;
+    memcpy(body + sizeof(shm_raw), data, data_len);
+    commit();
+}
+
+/*
+ * Enable/Disable debug
+ */
+void msgBus_shm::enableDebug() {
+    debug = true;
+}
+
+void msgBus_shm::disableDebug() {
+    debug = false;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MSGBUSIMPL_SHM_H_
+#define MSGBUSIMPL_SHM_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "MsgBusInterface.hpp"
+#include "Logger.h"
+#include "Config.h"
+
+#define MSGBUS_SHM_MAGIC        0x504d424f      ///< "OBMP" in little endian
+#define MSGBUS_SHM_VERSION      1               ///< Version of the ring and record layout
+
+/**
+ * \class   msgBus_shm
+ *
+ * \brief   Message bus that writes decoded objects to a POSIX shared memory ring
+ * \details Each router gets its own ring, named msgbus.shm.prefix followed by the router
+ *          hash (or "collector" for the collector bus), so a ring has a single writer.
+ *          Consumers on the same host shm_open() the ring read-only for the header and
+ *          read/write for tail, and read the records from tail up to head.
+ *
+ *          Records are binary, host byte order, and start on an 8 byte boundary.  A record
+ *          never wraps; when fewer than len bytes are left before the end of the data, a
+ *          SHM_REC_PAD record fills the rest (if there is room for its header) and the
+ *          record is written at the start.  A reader that has less than sizeof(shm_rec)
+ *          bytes left before the end skips to the start.
+ *
+ *          The writer never waits for the consumers, records that don't fit are dropped
+ *          and counted in shm_ring::dropped.  On close the ring is flagged closed and
+ *          unlinked; a router that reconnects gets a new ring with the same name.
+ *
+ *          BGP-LS, L3VPN and EVPN objects are not written to the ring.
+ */
+class msgBus_shm: public MsgBusInterface {
+public:
+    /**
+     * Record types
+     */
+    enum shm_rec_type {
+        SHM_REC_PAD=0,                      ///< Filler up to the end of the data, skip to the start
+        SHM_REC_COLLECTOR,                  ///< obj_collector
+        SHM_REC_ROUTER,                     ///< obj_router
+        SHM_REC_PEER,                       ///< obj_bgp_peer, then obj_peer_up_event or obj_peer_down_event
+        SHM_REC_BASE_ATTR,                  ///< shm_peer_ref, shm_attr
+        SHM_REC_UNICAST_PREFIX,             ///< shm_prefix_hdr, shm_attr if has_attr, count shm_prefix
+        SHM_REC_STATS,                      ///< shm_peer_ref, obj_stats_report
+        SHM_REC_BMP_RAW                     ///< shm_raw, data_len bytes of BMP messages
+    };
+
+    /**
+     * Header of the ring, data follows at hdr_size
+     */
+    struct shm_ring {
+        uint32_t                magic;              ///< MSGBUS_SHM_MAGIC
+        uint16_t                version;            ///< MSGBUS_SHM_VERSION
+        uint16_t                hdr_size;           ///< Offset of the data from the start of the ring
+        uint64_t                size;               ///< Size of the data in bytes
+        u_char                  router_hash[16];    ///< Router hash ID, zero for the collector bus
+        std::atomic<uint32_t>   closed;             ///< Set when the writer is done, the ring is unlinked
+
+        alignas(64) std::atomic<uint64_t> head;     ///< Bytes written, updated by the writer after a record is written
+        alignas(64) std::atomic<uint64_t> tail;     ///< Bytes consumed, updated by the consumer
+        alignas(64) std::atomic<uint64_t> dropped;  ///< Records dropped because the ring was full
+    };
+
+    /**
+     * Header of a record
+     */
+    struct shm_rec {
+        uint32_t    len;                    ///< Length of the record, including the header, multiple of 8
+        uint16_t    type;                   ///< shm_rec_type
+        uint8_t     action;                 ///< Action code of the object, as in MsgBusInterface
+        uint8_t     reserved;
+        uint64_t    seq;                    ///< Sequence of the record in the ring
+    };
+
+    /**
+     * Peer of a record
+     */
+    struct shm_peer_ref {
+        u_char      peer_hash[16];          ///< Peer hash ID, as in obj_bgp_peer
+    };
+
+    /**
+     * Path attributes, followed by the strings
+     *
+     * \details The strings are as_path, community_list, ext_community_list, large_community_list
+     *          and cluster_list, each a uint32_t length followed by the characters (not terminated).
+     *          len includes the strings and the padding to 8 bytes.
+     */
+    struct shm_attr {
+        uint32_t    len;                    ///< Length of the attributes, including the strings
+        uint32_t    origin_as;              ///< Origin ASN
+        uint32_t    med;                    ///< bgp MED
+        uint32_t    local_pref;             ///< bgp local pref
+        uint16_t    as_path_count;          ///< Count of AS PATH's in the path
+        uint8_t     nexthop_isIPv4;         ///< 1 if the next-hop is IPv4
+        uint8_t     atomic_agg;             ///< 1 for atomic_aggregate
+        u_char      hash_id[16];            ///< Path hash
+        char        origin[16];             ///< bgp origin as string name
+        char        next_hop[40];           ///< Next-hop IP in printed form
+        char        aggregator[40];         ///< Aggregator IP in printed form
+        char        originator_id[16];      ///< Originator ID in printed form
+    };
+
+    /**
+     * Header of a unicast prefix record
+     */
+    struct shm_prefix_hdr {
+        u_char      peer_hash[16];          ///< Peer hash ID
+        uint32_t    count;                  ///< Number of prefixes
+        uint8_t     has_attr;               ///< 1 if shm_attr follows, withdraws have none
+        uint8_t     reserved[3];
+    };
+
+    /**
+     * Unicast prefix
+     */
+    struct shm_prefix {
+        uint8_t     prefix_bin[16];         ///< Prefix in binary form
+        uint32_t    path_id;                ///< Add path ID - zero if not used
+        uint8_t     prefix_len;             ///< Length of prefix in bits
+        uint8_t     isIPv4;                 ///< 1 if IPv4, 0 if IPv6
+        uint8_t     reserved[2];
+    };
+
+    /**
+     * Header of a raw BMP record
+     */
+    struct shm_raw {
+        uint32_t    peer_asn;               ///< Peer ASN, 0 if not known
+        uint32_t    data_len;               ///< Length of the BMP messages
+    };
+
+    /**
+     * Constructor, creates and maps the ring
+     *
+     * \param [in] logPtr       Pointer to Logger instance
+     * \param [in] cfg          Pointer to the config instance
+     * \param [in] router_hash  Router hash ID, NULL for the collector bus
+     *
+     * \throw (const char *) if the ring can't be created
+     */
+    msgBus_shm(Logger *logPtr, Config *cfg, const u_char *router_hash);
+    ~msgBus_shm();
+
+    /*
+     * abstract methods implemented
+     * See MsgBusInterface.hpp for method details
+     */
+    void update_Collector(struct obj_collector &c_obj, collector_action_code action_code);
+    void update_Router(struct obj_router &r_entry, router_action_code code);
+    void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code);
+    void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code);
+    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+                              unicast_prefix_action_code code);
+    void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats);
+
+    void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_node> &nodes,
+                       ls_action_code code) { }
+    void update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_link> &links,
+                       ls_action_code code) { }
+    void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::vector<obj_ls_prefix> &prefixes,
+                         ls_action_code code) { }
+
+    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code) { }
+    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code) { }
+
+    void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len);
+    void send_bmp_raw_batch(u_char *r_hash, uint32_t peer_asn, u_char *data, size_t data_len);
+
+    // Debug methods
+    void enableDebug();
+    void disableDebug();
+
+private:
+    Logger          *logger;                ///< Logging class pointer
+    bool            debug;                  ///< debug flag to indicate debugging
+
+    std::string     name;                   ///< shm object name of the ring
+    shm_ring        *ring;                  ///< Mapped ring
+    size_t          map_size;               ///< Size of the mapping, header and data
+    u_char          *ring_data;             ///< Start of the ring data
+    uint64_t        seq;                    ///< Sequence of the next record
+    uint64_t        pending;                ///< head once the reserved record is committed
+
+    std::mutex      bus_mutex;              ///< Serializes the writers (router thread and parse pipeline)
+
+    /**
+     * Reserve space for a record
+     *
+     * \details Must be called with bus_mutex locked.  The record header is filled in,
+     *          commit() publishes the record.
+     *
+     * \param [in] type         Record type
+     * \param [in] action       Action code
+     * \param [in] body_len     Length of the record body
+     *
+     * \return Pointer to the record body, NULL if the record doesn't fit and was dropped
+     */
+    u_char *reserve(shm_rec_type type, uint8_t action, size_t body_len);
+
+    /**
+     * Publish the record returned by the last reserve()
+     */
+    void commit();
+
+    /**
+     * Length of the encoded path attributes
+     */
+    static size_t attrLen(obj_path_attr &attr);
+
+    /**
+     * Encode path attributes
+     *
+     * \param [out] buf     Buffer of at least attrLen() bytes
+     * \param [in]  attr    Path attributes
+     */
+    static void writeAttr(u_char *buf, obj_path_attr &attr);
+};
+
+#endif /* MSGBUSIMPL_SHM_H_ */
@@ -16,9 +16,17 @@
  */
 
 #include "BMPListener.h"
-#include "MsgBusImpl_kafka.h"
+#include "MsgBusFactory.h"
 #include "MsgBusInterface.hpp"
 #include "client_thread.h"
+#include "RouterWorkerPool.h"
+#include "ParsePipeline.h"
+#include "Metrics.h"
+#include "RibResync.h"
+#include "HostResolver.h"
+#include "CollectorState.h"
+#include "ClusterManager.h"
+#include "CpuPlacement.h"
 #include "openbmpd_version.h"
 #include "Config.h"
 
@@ -27,7 +35,7 @@
 #include <csignal>
 #include <cstring>
 #include <sys/stat.h>
-#include "md5.h"
+#include "HashEngine.h"
 
 using namespace std;
 
@@ -40,6 +48,7 @@ const char *debug_filename  = NULL;                 // Debug file to log message
 const char *pid_filename    = NULL;                 // PID file to record the daemon pid
 bool        run             = true;                 // Indicates if server should run
 bool        run_foreground  = false;                // Indicates if server should run in forground
+bool        drain_node      = false;                // Indicates the routers should be handed off to the cluster
 
 
 // Global thread list
@@ -155,6 +164,10 @@ void signal_handler(int signum)
         case SIGCHLD : // Handle the child cleanup
 
             for (size_t i=0; i < thr_list.size(); i++) {
+                // Pooled routers are closed when the worker pool is freed
+                if (thr_list.at(i)->pooled)
+                    continue;
+
                 pthread_cancel(thr_list.at(i)->thr);
                 thr_list.at(i)->running = false;
                 pthread_join(thr_list.at(i)->thr, NULL);
@@ -165,6 +178,10 @@ void signal_handler(int signum)
             run = false;
             break;
 
+        case SIGUSR1 : // Hand off the routers to the other nodes of the cluster and stop
+            drain_node = true;
+            break;
+
         default:
             LOG_INFO("Ignoring signal %d", signum);
             break;
@@ -356,11 +373,11 @@ bool ReadCmdArgs(int argc, char **argv, Config &cfg) {
 /**
  * Collector Update Message
  *
- * \param [in] kafka                 Pointer to kafka instance
+ * \param [in] mbus                  Pointer to the collector message bus
  * \param [in] cfg                   Reference to configuration
  * \param [in] code                  reason code for the update
  */
-void collector_update_msg(msgBus_kafka *kafka, Config &cfg,
+void collector_update_msg(MsgBusInterface *mbus, Config &cfg,
                           MsgBusInterface::collector_action_code code) {
 
     MsgBusInterface::obj_collector oc;
@@ -385,7 +402,7 @@ void collector_update_msg(msgBus_kafka *kafka, Config &cfg,
     oc.timestamp_secs = tv.tv_sec;
     oc.timestamp_us = tv.tv_usec;
 
-    kafka->update_Collector(oc, code);
+    mbus->update_Collector(oc, code);
 }
 
 /**
@@ -394,32 +411,61 @@ void collector_update_msg(msgBus_kafka *kafka, Config &cfg,
  * \param [in]  cfg    Reference to the config options
  */
 void runServer(Config &cfg) {
-    msgBus_kafka *kafka;
+    MsgBusInterface *mbus;                      // Collector message bus
+    MsgBusFactory *msgbus_factory = NULL;       // Creates the collector and router message buses
+    RouterWorkerPool *worker_pool = NULL;       // Event driven router workers, NULL if thread per router
+    ParsePipeline *parse_pipeline = NULL;       // Shared BGP decode workers, NULL if decoded by the router thread
+    AdmissionController *admission = NULL;      // Paces the routers by the collector load, NULL if disabled
     int active_connections = 0;                 // Number of active connections/threads
     int concurrent_routers = 0;			// Number of concurrent routers
     time_t last_heartbeat_time = 0;
+    time_t last_cluster_time = 0;               // Time the cluster load was last updated
+    time_t last_handoff_time = 0;               // Time a router was last handed off by a draining node
    
     LOG_INFO("Initializing server");
 
     try {
-        // Define the collector hash
-        MD5 hash;
-        hash.update((unsigned char *)cfg.admin_id, strlen(cfg.admin_id));
+        // Select the hash id algorithm before any hashes are generated
+        HashEngine::setAlgorithm(cfg.hash_algorithm);
+
+        // Define the collector hash, shared by the nodes of a cluster so a router hash doesn't depend on the node
+        HashEngine hash;
+        if (cfg.cluster_enabled)
+            hash.update(cfg.cluster_name.data(), cfg.cluster_name.size());
+        else
+            hash.update((unsigned char *)cfg.admin_id, strlen(cfg.admin_id));
         hash.finalize();
 
         // Save the hash
-        unsigned char *hash_raw = hash.raw_digest();
-        memcpy(cfg.c_hash_id, hash_raw, 16);
-        delete[] hash_raw;
+        hash.digest(cfg.c_hash_id);
+
+        // Message bus backend, owns the shared kafka producers
+        msgbus_factory = new MsgBusFactory(logger, &cfg);
+
+        // Message bus connection
+        mbus = msgbus_factory->create(NULL);
+
+        // BGP decode workers
+        if (cfg.parse_threads != 0)
+            parse_pipeline = new ParsePipeline(logger, &cfg, cfg.parse_threads);
+
+        // Collector load based pacing of the routers
+        if (cfg.admission_control)
+            admission = new AdmissionController(logger, &cfg, parse_pipeline);
 
-        // Kafka connection
-        kafka = new msgBus_kafka(logger, &cfg, cfg.c_hash_id);
+        // Event driven router workers
+        if (cfg.router_workers != 0)
+            worker_pool = new RouterWorkerPool(logger, &cfg, cfg.router_workers, msgbus_factory, parse_pipeline,
+                                               admission);
+
+        // Join the cluster before accepting routers, so they are assigned to their owner
+        ClusterManager::start(logger, &cfg);
 
         // allocate and start a new bmp server
         BMPListener *bmp_svr = new BMPListener(logger, &cfg);
 
         BMPListener::ClientInfo client;
-        collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_STARTED);
+        collector_update_msg(mbus, cfg, MsgBusInterface::COLLECTOR_ACTION_STARTED);
         last_heartbeat_time = time(NULL);
 
         LOG_INFO("Ready. Waiting for connections");
@@ -435,9 +481,12 @@ void runServer(Config &cfg) {
                 if (!thr_list.at(i)->running) {
 
                     // Join the thread to clean up
-                    pthread_join(thr_list.at(i)->thr, NULL);
+                    if (!thr_list.at(i)->pooled)
+                        pthread_join(thr_list.at(i)->thr, NULL);
                     --active_connections;
 
+                    CpuPlacement::release(thr_list.at(i)->client);
+
                     if (!thr_list.at(i)->baselineTimeout)
                         --concurrent_routers;
 
@@ -445,7 +494,7 @@ void runServer(Config &cfg) {
                     delete thr_list.at(i);
                     thr_list.erase(thr_list.begin() + i);
 
-                    collector_update_msg(kafka, cfg,
+                    collector_update_msg(mbus, cfg,
                                          MsgBusInterface::COLLECTOR_ACTION_CHANGE);
 
                 }
@@ -456,14 +505,15 @@ void runServer(Config &cfg) {
                     string hash(reinterpret_cast<char*>(thr_list.at(i)->client.hash_id), 16);
 
                     //if calculate_baseline is true and the baseline time for the router is calculated, use the baseline time
-                    if (cfg.calculate_baseline && cfg.router_baseline_time.find(hash) != cfg.router_baseline_time.end())
-                        initial_time = cfg.router_baseline_time[hash];
+                    if (cfg.calculate_baseline)
+                        cfg.getRouterBaseline(hash, initial_time);
 
                     timeval now;
                     gettimeofday(&now, NULL);
 
-                    //If past the baseline time, decrement concurrent router count
-                    if(now.tv_sec - thr_list.at(i)->client.startTime.tv_sec >= initial_time) {
+                    //If the RIB dump is done or past the baseline time, decrement concurrent router count
+                    if((cfg.calculate_baseline && thr_list.at(i)->client.ribDumpDone) ||
+                            now.tv_sec - thr_list.at(i)->client.startTime.tv_sec >= initial_time) {
                         --concurrent_routers;
                     thr_list.at(i)->baselineTimeout = true;		// Indicating that this router is not counted in the concurrent routers count
                     }
@@ -472,18 +522,80 @@ void runServer(Config &cfg) {
                 //TODO: Add code to check for a socket that is open, but not really connected/half open
             }
 
+            if (admission != NULL)
+                admission->sample();
+
+            if (ClusterManager::enabled() and time(NULL) != last_cluster_time) {
+                last_cluster_time = time(NULL);
+
+                // Load of the node is the dump time of its routers
+                double load = 0;
+                for (size_t i=0; i < thr_list.size(); i++) {
+                    int initial_time = cfg.initial_router_time;
+                    string hash(reinterpret_cast<char*>(thr_list.at(i)->client.hash_id), 16);
+
+                    cfg.getRouterBaseline(hash, initial_time);
+                    load += initial_time;
+                }
+
+                ClusterManager::setLoad(thr_list.size(), load);
+
+                /*
+                 * A draining node closes its routers one at a time, they reconnect to their new owner.
+                 *      Stops once all routers are handed off
+                 */
+                if (drain_node) {
+                    ClusterManager::drain();
+
+                    if (thr_list.empty()) {
+                        LOG_NOTICE("All routers are handed off to the cluster, stopping");
+                        run = false;
+                        break;
+
+                    } else if (last_cluster_time - last_handoff_time >= cfg.cluster_drain_interval) {
+                        last_handoff_time = last_cluster_time;
+
+                        for (size_t i=0; i < thr_list.size(); i++) {
+                            if (thr_list.at(i)->running) {
+                                LOG_INFO("%s: Handing off the router to the cluster", thr_list.at(i)->client.c_ip);
+                                shutdown(thr_list.at(i)->client.c_sock, SHUT_RDWR);
+
+                                if (cfg.cluster_drain_interval > 0)
+                                    break;
+                            }
+                        }
+                    }
+                }
+            }
+
             /*
-             * Create a new client thread if we aren't at the max number of active sessions
+             * Create a new client thread if we aren't at the max number of active sessions.
+             *    When the collector is overloaded, new connections wait in the listen backlog
              */
-	    if(concurrent_routers < cfg.max_concurrent_routers)
+	    if (admission != NULL and not admission->admitRouter()) {
+                usleep(10000);
+
+            } else if(concurrent_routers < cfg.max_concurrent_routers)
 	    {
-                if (active_connections <= MAX_THREADS) {
+                // Router workers don't use a thread per router
+                if (worker_pool != NULL or active_connections <= MAX_THREADS) {
                     ThreadMgmt *thr = new ThreadMgmt;
                     thr->cfg = &cfg;
                     thr->log = logger;
+                    thr->msgbus_factory = msgbus_factory;
+                    thr->parse_pipeline = parse_pipeline;
+                    thr->admission = admission;
+                    thr->pooled = worker_pool != NULL;
 
                     // wait for a new connection and accept
                     if (bmp_svr->wait_and_accept_connection(thr->client, 500)) {
+                        // Routers owned by another node of the cluster are forwarded to it
+                        if (ClusterManager::enabled() and not thr->client.forwarded and
+                                ClusterManager::forward(thr->client)) {
+                            delete thr;
+                            continue;
+                        }
+
                         // Bump the current thread count
                         ++active_connections;
 
@@ -497,24 +609,34 @@ void runServer(Config &cfg) {
                         LOG_INFO("Client Connected => %s:%s, sock = %d",
                                  thr->client.c_ip, thr->client.c_port, thr->client.c_sock);
 
-                        pthread_attr_t thr_attr;            // thread attribute
-                        pthread_attr_init(&thr_attr);
-                        //pthread_attr_setdetachstate(&thr.thr_attr, PTHREAD_CREATE_DETACHED);
-                        pthread_attr_setdetachstate(&thr_attr, PTHREAD_CREATE_JOINABLE);
                         thr->running = 1;
                         thr->baselineTimeout = false;
 
-                        // Start the thread to handle the client connection
-                        pthread_create(&thr->thr, &thr_attr,
-                                       ClientThread, thr);
+                        if (worker_pool != NULL) {
+                            // Hand the connection to a router worker
+                            worker_pool->addRouter(thr);
+
+                        } else {
+                            // Node and core of the router threads, the thread pins itself before allocating its buffers
+                            CpuPlacement::assign(thr->client);
+
+                            pthread_attr_t thr_attr;            // thread attribute
+                            pthread_attr_init(&thr_attr);
+                            //pthread_attr_setdetachstate(&thr.thr_attr, PTHREAD_CREATE_DETACHED);
+                            pthread_attr_setdetachstate(&thr_attr, PTHREAD_CREATE_JOINABLE);
+
+                            // Start the thread to handle the client connection
+                            pthread_create(&thr->thr, &thr_attr,
+                                           ClientThread, thr);
+
+                            // Free attribute
+                            pthread_attr_destroy(&thr_attr);
+                        }
 
                         // Add thread to vector
                         thr_list.insert(thr_list.end(), thr);
 
-                        // Free attribute
-                        pthread_attr_destroy(&thr_attr);
-
-                        collector_update_msg(kafka, cfg,
+                        collector_update_msg(mbus, cfg,
                                              MsgBusInterface::COLLECTOR_ACTION_CHANGE);
 
                         last_heartbeat_time = time(NULL);
@@ -525,7 +647,7 @@ void runServer(Config &cfg) {
                         // Send heartbeat if needed
                         if ( (time(NULL) - last_heartbeat_time) >= cfg.heartbeat_interval) {
                             BMPListener::ClientInfo client;
-                            collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_HEARTBEAT);
+                            collector_update_msg(mbus, cfg, MsgBusInterface::COLLECTOR_ACTION_HEARTBEAT);
                             last_heartbeat_time = time(NULL);
                         }
 
@@ -538,8 +660,25 @@ void runServer(Config &cfg) {
 	        }
 	    }
 	}
-        collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_STOPPED);
-        delete kafka;
+        // Close the router sessions of the workers
+        if (worker_pool != NULL)
+            delete worker_pool;
+
+        // Leave the cluster, the other nodes are assigned the routers that reconnect
+        ClusterManager::stop();
+
+        // Routers are closed, nothing is queued
+        if (parse_pipeline != NULL)
+            delete parse_pipeline;
+
+        if (admission != NULL)
+            delete admission;
+
+        collector_update_msg(mbus, cfg, MsgBusInterface::COLLECTOR_ACTION_STOPPED);
+        delete mbus;
+
+        if (msgbus_factory != NULL)
+            delete msgbus_factory;
 
     } catch (char const *str) {
         LOG_WARN(str);
@@ -595,6 +734,26 @@ int main(int argc, char **argv) {
         daemonize();
     }
 
+    // Flusher thread is started after daemonize, threads don't survive the fork
+    if (cfg.log_async)
+        logger->startAsync(cfg.log_rate_limit);
+
+    HostResolver::start(logger, &cfg);
+    CollectorState::start(logger, &cfg);
+    CpuPlacement::start(logger, &cfg);
+
+    if (cfg.metrics_port > 0 or not cfg.metrics_control_socket.empty()) {
+        try {
+            Metrics::start(logger, &cfg);
+
+        } catch (char const *str) {
+            LOG_ERR("Failed to start the metrics endpoint: %s", str);
+        }
+    }
+
+    if (cfg.adj_rib_in and cfg.adj_rib_in_resync_rate > 0)
+        bgp_msg::RibResync::start(logger, &cfg);
+
     /*
      * Setup the signal handlers
      */
@@ -615,6 +774,11 @@ int main(int argc, char **argv) {
     // Run the server (loop)
     runServer(cfg);
 
+    Metrics::stop();
+    bgp_msg::RibResync::stop();
+    CollectorState::stop();
+    HostResolver::stop();
+
 	LOG_NOTICE("Program ended normally");
 
 	return 0;
@@ -10,7 +10,6 @@
 #define SAFEQUEUE_HPP_
 
 #include <pthread.h>
-#include <unistd.h>
 
 #include <cstdlib>
 #include <queue>
@@ -21,11 +20,16 @@ namespace std {
  *
  * At this point we are not making the operator overloads thread safe, therefore
  *    they should not be used.
+ *
+ * Blocking push/wait use condition variables.  See boundedQueue.hpp for a lock-free
+ *    queue to hand off entries between threads.
  */
 template <typename type>
 class safeQueue : public queue<type> {
 private:
     pthread_mutex_t mutex;              // Pthread mutex lock for reading and modifying the trie.
+    pthread_cond_t  not_full;           // Signaled when an entry is removed
+    pthread_cond_t  not_empty;          // Signaled when an entry is added
 
     uint32_t        limit;
 
@@ -45,10 +49,14 @@ public:
 
         // Initialize the mutex variable
         pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&not_full, NULL);
+        pthread_cond_init(&not_empty, NULL);
     }
 
     ~safeQueue(){
         // Free the mutex
+        pthread_cond_destroy(&not_empty);
+        pthread_cond_destroy(&not_full);
         pthread_mutex_destroy(&mutex);
     }
 
@@ -59,18 +67,12 @@ public:
         /*
          * Wait/block if limit has been reached
          */
-        if (limit and size() >= limit) {
-            pthread_mutex_unlock (&mutex);
-
-            while (size() >= limit) {
-                usleep(10000);
-            }
-
-            pthread_mutex_lock (&mutex);
-        }
+        while (limit and size() >= limit)
+            pthread_cond_wait(&not_full, &mutex);
 
         // Add
         queue<type>::push(elem);
+        pthread_cond_signal(&not_empty);
 
         // Unlock
         pthread_mutex_unlock (&mutex);
@@ -84,6 +86,7 @@ public:
         // Before getting element, check if there are any
         if (queue<type>::size() > 0) {
             queue<type>::pop();
+            pthread_cond_signal(&not_full);
         }
 
         // Unlock
@@ -175,6 +178,7 @@ public:
 
             // pop the front object
             queue<type>::pop();
+            pthread_cond_signal(&not_full);
 
         } else
             rval = false;
@@ -190,15 +194,21 @@ public:
      *    calling this method will cause the caller to block until there are new entries
      */
     bool wait() {
-        while (size() <= 0) {
-            usleep(10000);
-        }
+        pthread_mutex_lock (&mutex);
+
+        while (size() <= 0)
+            pthread_cond_wait(&not_empty, &mutex);
+
+        pthread_mutex_unlock (&mutex);
 
         return true;
     }
 
     void setLimit(uint32_t limit) {
+        pthread_mutex_lock (&mutex);
         this->limit = limit;
+        pthread_cond_broadcast(&not_full);
+        pthread_mutex_unlock (&mutex);
     }
 };
 
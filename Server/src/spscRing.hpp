@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2013-2015 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#ifndef SPSCRING_HPP_
+#define SPSCRING_HPP_
+
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include "RecvBuffer.h"
+#include "CacheAligned.h"
+
+/**
+ * \class   spscRing
+ *
+ * \brief   Single producer/single consumer lock-free byte ring
+ * \details Used in place of the socketpair between the client socket thread and the
+ *          BMP reader thread.  The producer reads from the router socket directly into
+ *          ring memory and the consumer (BMPStreamReader) copies it once into its read
+ *          ahead buffer, where messages are parsed in place.  This replaces the write()
+ *          and recv() kernel copies and syscalls of the socketpair hop.
+ *
+ *          Positions are free running 64bit counters, so full/empty never need a spare slot.
+ *          Only the producer updates write_pos and only the consumer updates read_pos.
+ *
+ *          A side that has to wait (empty ring for the consumer, full ring for the producer)
+ *          sleeps on a condition variable and is woken by the other side's commit or by
+ *          close().  The mutex is only taken by a side about to sleep or waking one up.
+ */
+class spscRing : public CacheAligned {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] size             Size in bytes of the ring buffer
+     * \param [in] hugepages        Hugepage backing of the ring memory
+     * \param [in] release_bytes    Bytes written before a drained ring gives its memory back, 0 to keep it
+     *
+     * \throw (const char *) if the ring memory can't be reserved
+     */
+    spscRing(size_t size, RecvBuffer::Hugepages hugepages=RecvBuffer::HUGEPAGES_OFF, size_t release_bytes=0)
+            : mem(size, hugepages) {
+        this->size = size;
+        this->release_bytes = release_bytes;
+        buf = mem.data();
+        dirty = 0;
+
+        write_pos = 0;
+        read_pos = 0;
+        closed = false;
+        reader_waiting = false;
+        writer_waiting = false;
+    }
+
+    /*********************************************************************
+     * Producer methods
+     *********************************************************************/
+
+    /**
+     * Get the contiguous free space available for writing
+     *
+     * \details The returned region never wraps, so it can be passed directly to read()/recv().
+     *          Call commitWrite() with the number of bytes actually written.
+     *
+     * \param [out] ptr     Updated with the pointer to the start of the free space
+     *
+     * \return Number of contiguous bytes that can be written, zero if the ring is full
+     */
+    size_t writeSpace(unsigned char **ptr) {
+        uint64_t w = write_pos.load(std::memory_order_relaxed);
+        uint64_t r = read_pos.load(std::memory_order_acquire);
+
+        size_t free_bytes = size - (size_t)(w - r);
+        size_t offset = (size_t)(w % size);
+
+        *ptr = buf + offset;
+
+        return free_bytes < (size - offset) ? free_bytes : (size - offset);
+    }
+
+    /**
+     * Make written bytes visible to the consumer
+     *
+     * \param [in] len      Number of bytes written to the region returned by writeSpace()
+     */
+    void commitWrite(size_t len) {
+        write_pos.store(write_pos.load(std::memory_order_relaxed) + len, std::memory_order_release);
+        dirty += len;
+
+        // Pairs with the fence in read(), either the reader sees the data or we see it waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (reader_waiting.load(std::memory_order_relaxed))
+            wake();
+    }
+
+    /**
+     * Wait until the ring has free space or is closed
+     *
+     * \return true if there is free space, false if the ring is closed
+     */
+    bool waitSpace() {
+        unsigned char *ptr;
+
+        if (writeSpace(&ptr) > 0)
+            return true;
+
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        writer_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        while (writeSpace(&ptr) == 0 and not isClosed())
+            wait_cond.wait(lock);
+
+        writer_waiting.store(false, std::memory_order_relaxed);
+
+        return not isClosed();
+    }
+
+    /**
+     * Give the memory of a drained ring back
+     *
+     * \details Once the consumer has read everything, no byte of the ring is in use.  The
+     *          memory is released if more than release_bytes were written since the last
+     *          release, the pages are committed again as they are written.
+     *
+     * \return true if the memory was released
+     */
+    bool releaseIfDrained() {
+        if (release_bytes == 0 or dirty < release_bytes)
+            return false;
+
+        // Acquire orders the consumer's copy out of the ring before the release
+        if (read_pos.load(std::memory_order_acquire) != write_pos.load(std::memory_order_relaxed))
+            return false;
+
+        mem.release();
+        dirty = 0;
+
+        return true;
+    }
+
+    /**
+     * Mark the ring closed
+     *
+     * \details Either side can close the ring.  When closed by the producer, the consumer
+     *          reads the remaining data and then gets EOF.  When closed by the consumer,
+     *          the producer should stop writing.
+     */
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        wake();
+    }
+
+    /**
+     * Check if the ring has been closed by either side
+     */
+    bool isClosed() {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    /*********************************************************************
+     * Consumer methods
+     *********************************************************************/
+
+    /**
+     * Read from the ring, mimics recv() semantics
+     *
+     * \param [out] data     Buffer to copy data to
+     * \param [in]  len      Number of bytes to read
+     * \param [in]  peek     True to leave the data in the ring (MSG_PEEK)
+     * \param [in]  waitall  True to wait until len bytes are available (MSG_WAITALL), at
+     *                      most the ring size is waited for
+     *
+     * \return Number of bytes read, zero if the ring is closed and empty
+     */
+    ssize_t read(void *data, size_t len, bool peek, bool waitall) {
+        size_t need = waitall ? (len < size ? len : size) : 1;
+        size_t avail;
+
+        // Wait for data, or for all data if waitall
+        if ((avail = available()) < need) {
+            std::unique_lock<std::mutex> lock(wait_mutex);
+            reader_waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // Producer may have committed before closing
+            while ((avail = available()) < need and not isClosed())
+                wait_cond.wait(lock);
+
+            reader_waiting.store(false, std::memory_order_relaxed);
+            avail = available();
+        }
+
+        if (avail == 0)
+            return 0;
+
+        if (len > avail)
+            len = avail;
+
+        uint64_t r = read_pos.load(std::memory_order_relaxed);
+        size_t offset = (size_t)(r % size);
+        size_t first = (size - offset) < len ? (size - offset) : len;
+
+        memcpy(data, buf + offset, first);
+        if (first < len)
+            memcpy((unsigned char *)data + first, buf, len - first);
+
+        if (not peek) {
+            read_pos.store(r + len, std::memory_order_release);
+
+            // Pairs with the fence in waitSpace()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (writer_waiting.load(std::memory_order_relaxed))
+                wake();
+        }
+
+        return len;
+    }
+
+    /**
+     * Number of bytes available to the consumer
+     */
+    size_t available() {
+        return (size_t)(write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * Size in bytes of the ring buffer
+     */
+    size_t capacity() {
+        return size;
+    }
+
+    /**
+     * Hugepage backing of the ring memory
+     */
+    RecvBuffer::Hugepages hugepages() {
+        return mem.hugepages();
+    }
+
+private:
+    /**
+     * Wake the side waiting for data or space
+     *
+     * \details The mutex orders the wakeup after the waiter's check, so it isn't lost.
+     */
+    void wake() {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        wait_cond.notify_all();
+    }
+
+    RecvBuffer              mem;                ///< Ring memory, committed as it's written
+    unsigned char           *buf;               ///< Start of the ring memory
+    size_t                  size;               ///< Size of the ring memory in bytes
+    size_t                  release_bytes;      ///< Bytes written before a drained ring is released, 0 to keep it
+    size_t                  dirty;              ///< Bytes written since the last release (producer owned)
+
+    // Keep producer and consumer positions on different cache lines
+    alignas(64) std::atomic<uint64_t>   write_pos;      ///< Total bytes written (producer owned)
+    alignas(64) std::atomic<uint64_t>   read_pos;       ///< Total bytes read (consumer owned)
+    alignas(64) std::atomic<bool>       closed;         ///< True when either side is done with the ring
+    std::atomic<bool>                   reader_waiting; ///< True while the consumer waits for data
+    std::atomic<bool>                   writer_waiting; ///< True while the producer waits for space
+    std::mutex                          wait_mutex;     ///< Guards the waits, see wake()
+    std::condition_variable             wait_cond;      ///< Signaled on commit and close
+};
+
+#endif /* SPSCRING_HPP_ */